@@ -167,6 +167,7 @@ tizyoutube::tizyoutube (const std::string &api_key)
     current_stream_view_count_ (),
     current_stream_description_ (),
     current_stream_file_extension_ (),
+    current_stream_itag_ (),
     current_stream_video_id_ (),
     current_stream_published_ (),
     current_queue_progress_ ()
@@ -462,6 +463,11 @@ const char *tizyoutube::get_current_audio_stream_file_extension ()
              : current_stream_file_extension_.c_str ();
 }
 
+const char *tizyoutube::get_current_audio_stream_itag ()
+{
+  return current_stream_itag_.empty () ? NULL : current_stream_itag_.c_str ();
+}
+
 const char *tizyoutube::get_current_audio_stream_video_id ()
 {
   return current_stream_video_id_.empty () ? NULL
@@ -487,6 +493,7 @@ void tizyoutube::get_current_stream ()
   current_stream_view_count_.clear ();
   current_stream_description_.clear ();
   current_stream_file_extension_.clear ();
+  current_stream_itag_.clear ();
   current_stream_video_id_.clear ();
   current_stream_published_.clear ();
 
@@ -582,6 +589,9 @@ void tizyoutube::get_current_stream ()
   current_stream_file_extension_ = bp::extract< std::string > (
       py_yt_proxy_.attr ("current_audio_stream_file_extension") ());
 
+  current_stream_itag_ = bp::extract< std::string > (
+      py_yt_proxy_.attr ("current_audio_stream_itag") ());
+
   current_stream_video_id_ = bp::extract< std::string > (
       py_yt_proxy_.attr ("current_audio_stream_video_id") ());
 
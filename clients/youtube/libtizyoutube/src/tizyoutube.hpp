@@ -84,6 +84,7 @@ public:
   const char *get_current_audio_stream_view_count ();
   const char *get_current_audio_stream_description ();
   const char *get_current_audio_stream_file_extension ();
+  const char *get_current_audio_stream_itag ();
   const char *get_current_audio_stream_video_id ();
   const char *get_current_audio_stream_published ();
 
@@ -105,6 +106,7 @@ private:
   std::string current_stream_view_count_;
   std::string current_stream_description_;
   std::string current_stream_file_extension_;
+  std::string current_stream_itag_;
   std::string current_stream_video_id_;
   std::string current_stream_published_;
   std::string current_queue_progress_;
@@ -297,6 +297,14 @@ extern "C" const char *tiz_youtube_get_current_audio_stream_file_extension (
   return ap_youtube->p_proxy_->get_current_audio_stream_file_extension ();
 }
 
+extern "C" const char *tiz_youtube_get_current_audio_stream_itag (
+    tiz_youtube_t *ap_youtube)
+{
+  assert (ap_youtube);
+  assert (ap_youtube->p_proxy_);
+  return ap_youtube->p_proxy_->get_current_audio_stream_itag ();
+}
+
 extern "C" const char *tiz_youtube_get_current_audio_stream_video_id (
     tiz_youtube_t *ap_youtube)
 {
@@ -391,6 +391,17 @@ extern "C"
   const char *tiz_youtube_get_current_audio_stream_file_extension (
       tiz_youtube_t *ap_youtube);
 
+  /**
+   * Retrieve the current audio stream's itag (i.e. the format that has been
+   * selected).
+   *
+   * @ingroup libtizyoutube
+   *
+   * @param ap_youtube The tiz_youtube handle.
+   */
+  const char *tiz_youtube_get_current_audio_stream_itag (
+      tiz_youtube_t *ap_youtube);
+
   /**
    * Retrieve the current streams video id.
    *
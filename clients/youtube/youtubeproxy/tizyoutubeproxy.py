@@ -795,6 +795,16 @@ class tizyoutubeproxy(object):
             file_extension = to_ascii(stream["a"].extension)
         return file_extension
 
+    def current_audio_stream_itag(self):
+        """ Retrieve the current stream's itag (i.e. the format selected).
+
+        """
+        stream = self.now_playing_stream
+        itag = ""
+        if stream:
+            itag = to_ascii(str(stream["a"].itag))
+        return itag
+
     def current_audio_stream_video_id(self):
         """ Retrieve the current stream's video id.
 
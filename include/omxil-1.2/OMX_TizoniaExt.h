@@ -82,6 +82,7 @@
 #define OMX_TizoniaIndexParamAudioIheartPlaylist     OMX_IndexVendorStartUnused + 26 /**< reference: OMX_TIZONIA_AUDIO_PARAM_IHEARTPLAYLISTTYPE */
 #define OMX_TizoniaIndexConfigPlaylistPosition       OMX_IndexVendorStartUnused + 27 /**< reference: OMX_TIZONIA_PLAYLISTPOSITIONTYPE */
 #define OMX_TizoniaIndexConfigPlaylistPrintAction    OMX_IndexVendorStartUnused + 28 /**< reference: OMX_TIZONIA_PLAYLISTPRINTACTIONTYPE */
+#define OMX_TizoniaIndexConfigBufferFlowStats        OMX_IndexVendorStartUnused + 29 /**< reference: OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE */
 
 /**
  * OMX_AUDIO_CODINGTYPE extensions
@@ -114,6 +115,42 @@ typedef struct OMX_TIZONIA_PARAM_BUFFER_PREANNOUNCEMENTSMODETYPE
   OMX_BOOL bEnabled;
 } OMX_TIZONIA_PARAM_BUFFER_PREANNOUNCEMENTSMODETYPE;
 
+/**
+ * The name of the buffer flow statistics extension.
+ */
+#define OMX_TIZONIA_INDEX_CONFIG_BUFFER_FLOW_STATS     \
+  "OMX.Tizonia.index.config.bufferflowstats"
+
+/**
+ * Read-only counters that describe the flow of buffers through a port, plus
+ * the counters of the component's scheduler (the latter are the same on all
+ * the ports of a component). All times are in microseconds. The buffer times
+ * add up, for every buffer of the port, the time spent owned by the component
+ * and the time spent owned by the tunneled component (or the IL client).
+ */
+typedef struct OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE
+{
+  OMX_U32 nSize;
+  OMX_VERSIONTYPE nVersion;
+  OMX_U32 nPortIndex;
+  OMX_U64 nBuffersReceived;     /**< Empty/FillThisBuffer calls received */
+  OMX_U64 nBuffersClaimed;      /**< Headers claimed by the processor */
+  OMX_U64 nBuffersReleased;     /**< Headers released by the processor */
+  OMX_U64 nBuffersReturned;     /**< Headers handed back to the peer/client */
+  OMX_U64 nBytesReturned;       /**< Data (nFilledLen) in those headers */
+  OMX_U64 nComponentBufferTime; /**< Buffer time owned by the component */
+  OMX_U64 nPeerBufferTime;      /**< Buffer time owned by the peer/client */
+  OMX_U32 nIngressDepth;        /**< Headers waiting to be claimed */
+  OMX_U32 nIngressDepthMax;
+  OMX_U64 nSchedMessages;       /**< Messages dispatched by the scheduler */
+  OMX_U64 nSchedLatency;        /**< Total time from sending to dispatching */
+  OMX_U32 nSchedLatencyMax;
+  OMX_U32 nSchedQueueDepthMax;  /**< Messages pending in the scheduler queue */
+  OMX_U64 nTicks;               /**< Servant ticks run by the scheduler */
+  OMX_U64 nTickTime;            /**< Total time spent in servant ticks */
+  OMX_U32 nTickTimeMax;
+} OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE;
+
 /**
  * Extension to jump to another track in a playlist,
  * an absolute position relative to the beginning of
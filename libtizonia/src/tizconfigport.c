@@ -52,7 +52,12 @@ clear_metadata_lst (tiz_configport_t * ap_obj)
     {
       pp_metadata_item = tiz_vector_back (ap_obj->p_metadata_lst_);
       assert (pp_metadata_item);
-      tiz_mem_free (*pp_metadata_item);
+      /* Items allocated from the component's arena are released when the
+         arena is reset */
+      if (!tiz_arena_owned (handleOf (ap_obj), *pp_metadata_item))
+        {
+          tiz_mem_free (*pp_metadata_item);
+        }
       tiz_vector_pop_back (ap_obj->p_metadata_lst_);
     }
 }
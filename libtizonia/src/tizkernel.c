@@ -51,6 +51,14 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.krn"
 #endif
 
+/* Maximum number of headers handed over to a tunneled component with a single
+   scheduler message */
+#define TIZ_KRN_MAX_BUFFER_BATCH 8
+
+/* Maximum number of back-to-back EmptyThisBuffer/FillThisBuffer messages
+   processed in a single tick */
+#define TIZ_KRN_MAX_INGRESS_BATCH 32
+
 /* Forward declarations */
 static bool
 all_populated (const void * ap_obj);
@@ -130,6 +138,8 @@ init_ports_and_lists (void * ap_obj)
     tiz_vector_init (&(p_obj->p_ingress_), sizeof (tiz_vector_t *)));
   tiz_check_omx_ret_oom (
     tiz_vector_init (&(p_obj->p_egress_), sizeof (tiz_vector_t *)));
+  tiz_check_omx_ret_oom (
+    tiz_vector_init (&(p_obj->p_idx_map_), sizeof (tiz_krn_idx_entry_t)));
 
   p_obj->p_cport_ = NULL;
   p_obj->p_proc_ = NULL;
@@ -158,6 +168,10 @@ deinit_ports_and_lists (void * ap_obj)
   OMX_PTR * pp_port = NULL;
   tiz_vector_t * p_list = NULL;
 
+  /* delete the index dispatch table */
+  tiz_vector_destroy (p_obj->p_idx_map_);
+  p_obj->p_idx_map_ = NULL;
+
   /* delete the config port */
   factory_delete (p_obj->p_cport_);
   p_obj->p_cport_ = NULL;
@@ -966,6 +980,41 @@ krn_dispatch_msg (const void * ap_obj, OMX_PTR ap_msg)
   return rc;
 }
 
+static bool
+is_efb_msg_next (const tiz_krn_t * ap_obj)
+{
+  tiz_krn_msg_t * p_msg = NULL;
+  assert (ap_obj);
+  return (OMX_ErrorNone
+            == tiz_pqueue_first (ap_obj->_.p_pq_, (void **) &p_msg)
+          && p_msg
+          && (ETIZKrnMsgEmptyThisBuffer == p_msg->class
+              || ETIZKrnMsgFillThisBuffer == p_msg->class));
+}
+
+static OMX_ERRORTYPE
+krn_tick (const void * ap_obj)
+{
+  const tiz_krn_t * p_obj = ap_obj;
+  OMX_S32 nmsgs = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  /* Buffer headers received back-to-back (e.g. a batch delivered by a
+     tunneled component) are moved to the ingress lists in the same tick,
+     instead of paying a full round of the scheduler for each one. Other
+     messages keep their usual one-per-tick treatment. */
+  do
+    {
+      rc = tiz_srv_super_tick (typeOf (ap_obj, "tizkrn"), ap_obj);
+    }
+  while (OMX_ErrorNone == rc && ++nmsgs < TIZ_KRN_MAX_INGRESS_BATCH
+         && is_efb_msg_next (p_obj));
+
+  return rc;
+}
+
 static OMX_ERRORTYPE
 krn_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
@@ -1408,11 +1457,68 @@ tiz_krn_get_port (const void * ap_obj, const OMX_U32 a_pid)
   return class->get_port (ap_obj, a_pid);
 }
 
+static int
+cmp_idx_entries (const void * ap_left, const void * ap_right)
+{
+  const OMX_U32 left = ((const tiz_krn_idx_entry_t *) ap_left)->index;
+  const OMX_U32 right = ((const tiz_krn_idx_entry_t *) ap_right)->index;
+  return (left > right) - (left < right);
+}
+
+/* Returns the dispatch table entry for an index. The table is filled the
+   first time each index is looked up; since ports only ever add indexes
+   (normally from their constructors), a cached entry never goes stale. */
+static const tiz_krn_idx_entry_t *
+find_idx_entry (const tiz_krn_t * ap_krn, const OMX_INDEXTYPE a_index)
+{
+  tiz_krn_idx_entry_t entry = {a_index, false};
+  const tiz_krn_idx_entry_t * p_entry = NULL;
+  bool found = false;
+
+  assert (ap_krn);
+  assert (ap_krn->p_idx_map_);
+
+  if ((p_entry = tiz_vector_bsearch (ap_krn->p_idx_map_, &entry,
+                                     cmp_idx_entries)))
+    {
+      return p_entry;
+    }
+
+  /* Slow path: ask the ports */
+  if (ap_krn->p_cport_
+      && OMX_ErrorNone == tiz_port_find_index (ap_krn->p_cport_, a_index))
+    {
+      entry.in_cport = true;
+      found = true;
+    }
+  else
+    {
+      OMX_S32 i = 0;
+      OMX_S32 num_ports = tiz_vector_length (ap_krn->p_ports_);
+      for (i = 0; i < num_ports && !found; ++i)
+        {
+          OMX_PTR * pp_port = tiz_vector_at (ap_krn->p_ports_, i);
+          found = (OMX_ErrorNone == tiz_port_find_index (*pp_port, a_index));
+        }
+    }
+
+  if (found
+      && OMX_ErrorNone == tiz_vector_insert_sorted (ap_krn->p_idx_map_, &entry,
+                                                    cmp_idx_entries))
+    {
+      p_entry
+        = tiz_vector_bsearch (ap_krn->p_idx_map_, &entry, cmp_idx_entries);
+    }
+
+  return p_entry;
+}
+
 OMX_ERRORTYPE
 krn_find_managing_port (const tiz_krn_t * ap_krn, const OMX_INDEXTYPE a_index,
                         const OMX_PTR ap_struct, OMX_PTR * app_port)
 {
   OMX_ERRORTYPE rc = OMX_ErrorUnsupportedIndex;
+  const tiz_krn_idx_entry_t * p_entry = NULL;
   OMX_PTR * pp_port = NULL;
   OMX_U32 * p_port_index;
 
@@ -1420,7 +1526,9 @@ krn_find_managing_port (const tiz_krn_t * ap_krn, const OMX_INDEXTYPE a_index,
   assert (app_port);
   assert (ap_struct);
 
-  if (OMX_ErrorNone == tiz_port_find_index (ap_krn->p_cport_, a_index))
+  p_entry = find_idx_entry (ap_krn, a_index);
+
+  if (p_entry && p_entry->in_cport)
     {
       *app_port = ap_krn->p_cport_;
       TIZ_TRACE (handleOf (ap_krn),
@@ -1429,40 +1537,25 @@ krn_find_managing_port (const tiz_krn_t * ap_krn, const OMX_INDEXTYPE a_index,
                  tiz_idx_to_str (a_index));
       return OMX_ErrorNone;
     }
-  else
+  else if (p_entry)
     {
-      OMX_S32 i = 0;
-      OMX_S32 num_ports = tiz_vector_length (ap_krn->p_ports_);
-      for (i = 0; i < num_ports; ++i)
-        {
-          pp_port = tiz_vector_at (ap_krn->p_ports_, i);
-          if (OMX_ErrorNone == tiz_port_find_index (*pp_port, a_index))
-            {
-              rc = OMX_ErrorNone;
-              break;
-            }
-        }
+      /* Now we retrieve the port index from the struct. */
+      /* TODO: This is not the best way to do this */
+      p_port_index = (OMX_U32 *) ap_struct
+                     + sizeof (OMX_U32) / sizeof (OMX_U32)
+                     + sizeof (OMX_VERSIONTYPE) / sizeof (OMX_U32);
 
-      if (OMX_ErrorNone == rc)
+      if (OMX_ErrorNone != (rc = check_pid (ap_krn, *p_port_index)))
         {
-          /* Now we retrieve the port index from the struct. */
-          /* TODO: This is not the best way to do this */
-          p_port_index = (OMX_U32 *) ap_struct
-                         + sizeof (OMX_U32) / sizeof (OMX_U32)
-                         + sizeof (OMX_VERSIONTYPE) / sizeof (OMX_U32);
-
-          if (OMX_ErrorNone != (rc = check_pid (ap_krn, *p_port_index)))
-            {
-              return rc;
-            }
-
-          TIZ_TRACE (handleOf (ap_krn), "[%s] : Found in port index [%d]...",
-                     tiz_idx_to_str (a_index), *p_port_index);
-
-          pp_port = tiz_vector_at (ap_krn->p_ports_, *p_port_index);
-          *app_port = *pp_port;
           return rc;
         }
+
+      TIZ_TRACE (handleOf (ap_krn), "[%s] : Found in port index [%d]...",
+                 tiz_idx_to_str (a_index), *p_port_index);
+
+      pp_port = tiz_vector_at (ap_krn->p_ports_, *p_port_index);
+      *app_port = *pp_port;
+      return rc;
     }
 
   TIZ_TRACE (handleOf (ap_krn), "[%s] : Could not find the managing port...",
@@ -1704,6 +1797,7 @@ krn_claim_buffer (const void * ap_obj, const OMX_U32 a_pid, const OMX_U32 a_pos,
 
       /* Now increment by one the claimed buffers count on this port */
       (void) TIZ_PORT_INC_CLAIMED_COUNT (p_port);
+      update_flow_stats (p_obj, p_port, ETIZPortFlowClaimed, 0);
 
       /* ...and if its an input buffer, mark the header, if any marks
        * available... */
@@ -1790,6 +1884,8 @@ krn_release_buffer (const void * ap_obj, const OMX_U32 a_pid,
 
   assert (tiz_vector_length (p_list) < tiz_port_buffer_count (p_port));
 
+  update_flow_stats (p_obj, p_port, ETIZPortFlowReleased, 0);
+
   return enqueue_callback_msg (p_obj, ap_hdr, a_pid, tiz_port_dir (p_port));
 }
 
@@ -2357,6 +2453,8 @@ tiz_krn_init (void * ap_tos, void * ap_hdl)
      tiz_api_FillThisBuffer, krn_FillThisBuffer,
      /* TIZ_CLASS_COMMENT: dispatch_msg */
      tiz_srv_dispatch_msg, krn_dispatch_msg,
+     /* TIZ_CLASS_COMMENT: tick */
+     tiz_srv_tick, krn_tick,
      /* TIZ_CLASS_COMMENT: allocate_resources */
      tiz_srv_allocate_resources, krn_allocate_resources,
      /* TIZ_CLASS_COMMENT: deallocate_resources */
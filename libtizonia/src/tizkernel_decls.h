@@ -105,6 +105,14 @@ struct tiz_krn_msg_str
   OMX_STRING str;
 };
 
+/* An entry in the kernel's index-to-port dispatch table */
+typedef struct tiz_krn_idx_entry tiz_krn_idx_entry_t;
+struct tiz_krn_idx_entry
+{
+  OMX_INDEXTYPE index;
+  bool in_cport; /* true if the index is managed by the config port */
+};
+
 typedef struct tiz_krn tiz_krn_t;
 struct tiz_krn
 {
@@ -114,6 +122,7 @@ struct tiz_krn
   tiz_vector_t * p_ingress_;
   tiz_vector_t * p_egress_;
   OMX_PTR p_cport_;
+  tiz_vector_t * p_idx_map_; /* sorted tiz_krn_idx_entry_t items */
   OMX_PTR p_proc_;
   bool eos_;
   tiz_rm_t rm_;
@@ -815,6 +815,8 @@ static OMX_ERRORTYPE dispatch_efb (void *ap_obj, OMX_PTR ap_msg,
 
   TIZ_TRACE (p_hdl, "ingress list length [%d]", nbufs);
 
+  update_flow_stats (p_obj, p_port, ETIZPortFlowReceived, 0);
+
   if (TIZ_PORT_IS_BEING_DISABLED (p_port))
     {
       return dispatch_efb_port_disable_in_progress (ap_obj, p_port, pid, nbufs);
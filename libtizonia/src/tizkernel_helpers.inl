@@ -229,6 +229,20 @@ static OMX_S32 add_to_buflst (void *ap_obj, tiz_vector_t *ap_dst2darr,
     }
 }
 
+static void update_flow_stats (const tiz_krn_t *ap_obj, void *ap_port,
+                               const tiz_port_flow_event_t a_event,
+                               const OMX_U32 a_nbytes)
+{
+  const OMX_U32 pid = tiz_port_index (ap_port);
+  const OMX_U32 ningress = tiz_vector_length (get_ingress_lst (ap_obj, pid));
+  const OMX_U32 negress = tiz_vector_length (get_egress_lst (ap_obj, pid));
+  /* The component owns the headers waiting in the ingress and egress lists
+     plus the ones claimed by the processor */
+  tiz_port_update_flow_stats (
+      ap_port, a_event, ningress + negress + TIZ_PORT_GET_CLAIMED_COUNT (ap_port),
+      ningress, a_nbytes);
+}
+
 static OMX_S32 clear_hdr_contents (tiz_vector_t *ap_hdr_lst, OMX_U32 a_pid)
 {
   tiz_vector_t *p_list = NULL;
@@ -575,6 +589,72 @@ static OMX_ERRORTYPE flush_marks (void *ap_obj, OMX_PTR ap_port)
   return rc;
 }
 
+static OMX_ERRORTYPE issue_tunneled_buf_batch (tiz_krn_t *ap_krn,
+                                               OMX_PTR ap_port,
+                                               tiz_vector_t *ap_list,
+                                               OMX_BUFFERHEADERTYPE **app_hdrs,
+                                               const OMX_U32 a_nhdrs,
+                                               const OMX_DIRTYPE a_pdir,
+                                               OMX_HANDLETYPE ap_thdl)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_U32 nbytes[TIZ_KRN_MAX_BUFFER_BATCH];
+  OMX_U32 ndelivered = 0;
+  OMX_U32 i = 0;
+  OMX_U64 start = 0;
+
+  assert (ap_krn);
+  assert (ap_port);
+  assert (ap_list);
+  assert (app_hdrs);
+  assert (ap_thdl);
+  assert (a_nhdrs <= TIZ_KRN_MAX_BUFFER_BATCH);
+
+  /* The peer may start using the headers as soon as they are delivered */
+  for (i = 0; i < a_nhdrs; ++i)
+    {
+      nbytes[i] = app_hdrs[i]->nFilledLen;
+    }
+
+  TIZ_DEBUG (handleOf (ap_krn), "[%s] : [%u] HEADERS [%s]",
+             OMX_DirInput == a_pdir ? "OMX_FillThisBuffer"
+                                    : "OMX_EmptyThisBuffer",
+             a_nhdrs, TIZ_CNAME (ap_thdl));
+
+  /* Buffers leaving an input port go back to the tunneled output port, and
+     vice versa */
+  start = tiz_comp_trace_begin (handleOf (ap_krn));
+  rc = tiz_comp_empty_fill_buffers (
+      ap_thdl, OMX_DirInput == a_pdir ? OMX_DirOutput : OMX_DirInput,
+      app_hdrs, a_nhdrs, &ndelivered);
+  tiz_comp_trace_end (handleOf (ap_krn),
+                      OMX_DirInput == a_pdir ? "FillThisBuffer (batch)"
+                                             : "EmptyThisBuffer (batch)",
+                      start);
+
+  /* The batch is the head of the egress list; only the headers that the
+     peer has accepted leave it */
+  assert (ndelivered <= a_nhdrs);
+  if (ndelivered > 0)
+    {
+      tiz_vector_erase (ap_list, 0, ndelivered);
+    }
+  for (i = 0; i < ndelivered; ++i)
+    {
+      update_flow_stats (ap_krn, ap_port, ETIZPortFlowReturned, nbytes[i]);
+    }
+
+  if (OMX_ErrorNone != rc)
+    {
+      TIZ_ERROR (handleOf (ap_krn),
+                 "[%s] : [%u] of [%u] headers not delivered to [%s]",
+                 tiz_err_to_str (rc), a_nhdrs - ndelivered, a_nhdrs,
+                 TIZ_CNAME (ap_thdl));
+    }
+
+  return rc;
+}
+
 static OMX_ERRORTYPE flush_egress (void *ap_obj, const OMX_U32 a_pid,
                                    const OMX_BOOL a_clear)
 {
@@ -582,12 +662,16 @@ static OMX_ERRORTYPE flush_egress (void *ap_obj, const OMX_U32 a_pid,
   tiz_vector_t *p_list = NULL;
   OMX_PTR p_port = NULL;
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
+  OMX_BUFFERHEADERTYPE *batch[TIZ_KRN_MAX_BUFFER_BATCH];
+  OMX_U32 nbatch = 0;
   OMX_S32 i = 0;
   OMX_U32 pid = 0;
   OMX_DIRTYPE pdir = OMX_DirMax;
   OMX_HANDLETYPE p_hdl = handleOf (p_obj);
   OMX_HANDLETYPE p_thdl = NULL;
   OMX_S32 nports = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_ERRORTYPE batch_rc = OMX_ErrorNone;
 
   assert (ap_obj);
 
@@ -611,10 +695,13 @@ static OMX_ERRORTYPE flush_egress (void *ap_obj, const OMX_U32 a_pid,
                  "- p_thdl [%p]...",
                  pid, i, tiz_vector_length (p_list), p_thdl);
 
-      while (tiz_vector_length (p_list) > 0)
+      /* Headers stay in the egress list until they have been handed over;
+         the pending batch is always the head of the list */
+      while (OMX_ErrorNone == batch_rc
+             && tiz_vector_length (p_list) > (OMX_S32)nbatch)
         {
           /* Retrieve the header... */
-          p_hdr = get_header (p_list, 0);
+          p_hdr = get_header (p_list, nbatch);
 
           TIZ_TRACE (p_hdl, "HEADER [%p] BUFFER [%p]", p_hdr, p_hdr->pBuffer);
 
@@ -627,11 +714,20 @@ static OMX_ERRORTYPE flush_egress (void *ap_obj, const OMX_U32 a_pid,
              * if pre-announcements are enabled on the port. */
             if (OMX_DirInput == pdir && TIZ_PORT_IS_ALLOCATOR (p_port))
               {
-                tiz_check_omx (tiz_port_populate_header (p_port, p_hdr));
+                rc = tiz_port_populate_header (p_port, p_hdr);
               }
 
             /* Propagate buffer marks... */
-            tiz_check_omx (process_marks (p_obj, p_hdr, pid, p_hdl));
+            if (OMX_ErrorNone == rc)
+              {
+                rc = process_marks (p_obj, p_hdr, pid, p_hdl);
+              }
+
+            if (OMX_ErrorNone != rc)
+              {
+                /* The headers already processed are still delivered */
+                break;
+              }
 
             if (OMX_TRUE == a_clear)
               {
@@ -671,13 +767,43 @@ static OMX_ERRORTYPE flush_egress (void *ap_obj, const OMX_U32 a_pid,
                   }
               }
 
-            /* get rid of the buffer */
-            tiz_srv_issue_buf_callback ((OMX_PTR)ap_obj, p_hdr, pid, pdir,
-                                        p_thdl);
-            /* ... and delete it from the list. */
-            tiz_vector_erase (p_list, 0, 1);
+            /* get rid of the buffer; tunneled buffers are handed over to
+               the peer in batches, and leave the list once delivered */
+            if (p_thdl)
+              {
+                batch[nbatch++] = p_hdr;
+                if (TIZ_KRN_MAX_BUFFER_BATCH == nbatch)
+                  {
+                    batch_rc = issue_tunneled_buf_batch (
+                        p_obj, p_port, p_list, batch, nbatch, pdir, p_thdl);
+                    nbatch = 0;
+                  }
+              }
+            else
+              {
+                /* The client owns the header once the callback is issued */
+                const OMX_U32 nbytes = p_hdr->nFilledLen;
+                tiz_srv_issue_buf_callback ((OMX_PTR)ap_obj, p_hdr, pid,
+                                            pdir, p_thdl);
+                /* ... and delete it from the list. */
+                tiz_vector_erase (p_list, 0, 1);
+                update_flow_stats (p_obj, p_port, ETIZPortFlowReturned,
+                                   nbytes);
+              }
           }
         }
+
+      if (nbatch > 0)
+        {
+          batch_rc = issue_tunneled_buf_batch (p_obj, p_port, p_list, batch,
+                                               nbatch, pdir, p_thdl);
+          nbatch = 0;
+        }
+
+      /* Headers that could not be processed or delivered remain in the
+         egress list */
+      tiz_check_omx (rc);
+      tiz_check_omx (batch_rc);
       ++i;
     }
   while (OMX_ALL == a_pid && i < nports);
@@ -900,6 +1026,7 @@ static OMX_BOOL process_efb_from_servant_queue (OMX_PTR ap_elem,
           /* Add this buffer to the ingress hdr list */
           if (0 < add_to_buflst (p_obj, p_obj->p_ingress_, p_hdr, p_port))
             {
+              update_flow_stats (p_obj, p_port, ETIZPortFlowReceived, 0);
               rc = OMX_TRUE;
             }
           else
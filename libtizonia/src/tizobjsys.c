@@ -31,6 +31,8 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <tizplatform.h>
@@ -88,7 +90,9 @@
 
 struct tiz_os
 {
-  tiz_map_t * p_map;
+  tiz_map_t * p_map;    /* types registered at runtime (e.g. by plugins) */
+  tiz_mutex_t mutex;    /* protects p_map */
+  void ** pp_types;     /* libtizonia's own types, indexed by type id */
   OMX_HANDLETYPE p_hdl;
   tiz_soa_t * p_soa;
 };
@@ -135,7 +139,7 @@ enum tiz_os_type
   ETIZPort_class,
   ETIZPort,
   ETIZConfigport_class,
-  ETIZConfigport, /* TIZ_OS_BASE_TYPE_END */
+  ETIZConfigport,
   ETIZAudioport_class,
   ETIZAudioport,
   ETIZPcmport_class,
@@ -182,8 +186,6 @@ enum tiz_os_type
   ETIZMp4port,
 };
 
-#define TIZ_OS_BASE_TYPE_END ETIZConfigport
-
 static const tiz_os_type_init_f tiz_os_type_to_fnt_tbl[] = {
   tiz_class_init,
   tiz_object_init,
@@ -365,6 +367,45 @@ static tiz_os_type_str_t tiz_os_type_to_str_tbl[] = {
   {ETIZMp4port, "tizmp4port"},
 };
 
+#define TIZ_OS_TYPE_COUNT \
+  (sizeof (tiz_os_type_to_str_tbl) / sizeof (tiz_os_type_str_t))
+
+/* Process-wide name -> type id index, sorted by name. It is built once and
+   never modified afterwards, so it is shared by all the object systems. Only
+   the index is shared: the class objects stay per component, because each
+   one carries the component handle that handleOf () returns. */
+static tiz_os_type_str_t g_os_type_idx[TIZ_OS_TYPE_COUNT];
+static pthread_once_t g_os_type_idx_once = PTHREAD_ONCE_INIT;
+
+static int
+os_type_idx_compare_func (const void * ap_left, const void * ap_right)
+{
+  return strcmp (((const tiz_os_type_str_t *) ap_left)->str,
+                 ((const tiz_os_type_str_t *) ap_right)->str);
+}
+
+static void
+init_os_type_idx (void)
+{
+  assert (sizeof (tiz_os_type_to_fnt_tbl) / sizeof (tiz_os_type_init_f)
+          == TIZ_OS_TYPE_COUNT);
+  memcpy (g_os_type_idx, tiz_os_type_to_str_tbl,
+          sizeof (tiz_os_type_to_str_tbl));
+  qsort (g_os_type_idx, TIZ_OS_TYPE_COUNT, sizeof (tiz_os_type_str_t),
+         os_type_idx_compare_func);
+}
+
+static OMX_S32
+find_base_type_id (const char * a_type_name)
+{
+  tiz_os_type_str_t key = {ETIZClass, (OMX_STRING) a_type_name};
+  const tiz_os_type_str_t * p_entry = NULL;
+  (void) pthread_once (&g_os_type_idx_once, init_os_type_idx);
+  p_entry = bsearch (&key, g_os_type_idx, TIZ_OS_TYPE_COUNT,
+                     sizeof (tiz_os_type_str_t), os_type_idx_compare_func);
+  return p_entry ? (OMX_S32) p_entry->type : -1;
+}
+
 static /*@null@ */ void *
 os_calloc (/*@null@ */ tiz_soa_t * p_soa, size_t a_size)
 {
@@ -415,30 +456,9 @@ os_map_free_func (OMX_PTR ap_key, OMX_PTR ap_value)
   tiz_mem_free (ap_value);
 }
 
-#ifdef _DEBUG
-static OMX_S32
-print_function (OMX_PTR ap_key, OMX_PTR ap_value, OMX_PTR ap_arg)
-{
-  const char * name = ap_key;
-  tiz_os_t * p_os = ap_arg;
-  TIZ_TRACE (p_os->p_hdl, "type [%s]->[%p]", name, ap_value);
-  return 0;
-}
-#endif
-
-static void
-print_types (const tiz_os_t * ap_os)
-{
-#ifdef _DEBUG
-  assert (ap_os);
-  assert (ap_os->p_map);
-  tiz_map_for_each (ap_os->p_map, print_function, (tiz_os_t *) ap_os);
-#endif
-}
-
 static OMX_ERRORTYPE
 os_register_type (tiz_os_t * ap_os, const tiz_os_type_init_f a_type_init_f,
-                  const char * a_type_name, const OMX_S32 a_type_id)
+                  const char * a_type_name)
 {
   OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
   void * p_obj = NULL;
@@ -449,49 +469,80 @@ os_register_type (tiz_os_t * ap_os, const tiz_os_type_init_f a_type_init_f,
   assert (a_type_name);
   assert (strnlen (a_type_name, OMX_MAX_STRINGNAME_SIZE)
           < OMX_MAX_STRINGNAME_SIZE);
-  assert (a_type_id >= 0);
 
-  /* Call the type init function */
+  /* Call the type init function. This is done without holding the lock, as
+     it looks up the super class types. */
   p_obj = a_type_init_f (ap_os, ap_os->p_hdl);
 
   if (p_obj)
     {
-      /* Register the class or object type */
+      OMX_U32 index = 0;
+      char * p_key = NULL;
+      tiz_check_omx_ret_oom (tiz_mutex_lock (&(ap_os->mutex)));
+      /* Runtime type ids follow libtizonia's own, so the two never clash */
       TIZ_TRACE (ap_os->p_hdl,
-                 "Registering type #[%d] : [%s] -> [%p] "
+                 "Registering type #[%u] : [%s] -> [%p] "
                  "nameOf [%s]",
-                 a_type_id, a_type_name, p_obj, nameOf (p_obj));
-      rc = tiz_map_insert (ap_os->p_map, os_strndup (ap_os->p_soa, a_type_name,
-                                                     OMX_MAX_STRINGNAME_SIZE),
-                           p_obj, (OMX_U32 *) (&a_type_id));
+                 (unsigned) (TIZ_OS_TYPE_COUNT + tiz_map_size (ap_os->p_map)),
+                 a_type_name, p_obj, nameOf (p_obj));
+      p_key
+        = os_strndup (ap_os->p_soa, a_type_name, OMX_MAX_STRINGNAME_SIZE);
+      if (p_key)
+        {
+          rc = tiz_map_insert (ap_os->p_map, p_key, p_obj, &index);
+        }
+      tiz_check_omx_ret_oom (tiz_mutex_unlock (&(ap_os->mutex)));
+      if (OMX_ErrorNone != rc)
+        {
+          tiz_mem_free (p_obj);
+        }
     }
 
-  /*   print_types (ap_os); */
-
   return rc;
 }
 
-static OMX_ERRORTYPE
-register_base_types (tiz_os_t * ap_os)
+static void *
+get_base_type (tiz_os_t * ap_os, const OMX_S32 a_type_id)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  const OMX_S32 count
-    = sizeof (tiz_os_type_to_str_tbl) / sizeof (tiz_os_type_str_t);
-  OMX_S32 type_id = 0;
-  OMX_S32 last_element = 0;
-
+  void * p_type = NULL;
   assert (ap_os);
-  assert (count >= TIZ_OS_BASE_TYPE_END);
-  last_element = TIZ_OS_BASE_TYPE_END;
-
-  for (type_id = 0; type_id <= last_element && OMX_ErrorNone == rc; ++type_id)
+  assert (ap_os->pp_types);
+  assert (a_type_id >= 0 && (size_t) a_type_id < TIZ_OS_TYPE_COUNT);
+
+  /* libtizonia's types are instantiated the first time they are needed, so
+     a component only pays for the classes it actually uses. Types are looked
+     up from both the IL client's thread and the component's thread, so the
+     slot is published with a compare-and-swap; a thread that loses the race
+     drops its copy and uses the winner's. A lock can't be used here, as type
+     init functions recurse into this function for their super classes. */
+  p_type = __atomic_load_n (&(ap_os->pp_types[a_type_id]), __ATOMIC_ACQUIRE);
+  if (!p_type)
     {
-      TIZ_TRACE (ap_os->p_hdl, "Registering type [%s]...",
-                 tiz_os_type_to_str_tbl[type_id].str);
-      rc = os_register_type (ap_os, tiz_os_type_to_fnt_tbl[type_id],
-                             tiz_os_type_to_str_tbl[type_id].str, type_id);
+      void * p_expected = NULL;
+      TIZ_TRACE (ap_os->p_hdl, "Registering type #[%d] : [%s]", a_type_id,
+                 tiz_os_type_to_str_tbl[a_type_id].str);
+      p_type = tiz_os_type_to_fnt_tbl[a_type_id](ap_os, ap_os->p_hdl);
+      if (p_type
+          && !__atomic_compare_exchange_n (
+               &(ap_os->pp_types[a_type_id]), &p_expected, p_type, false,
+               __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+          tiz_mem_free (p_type);
+          p_type = p_expected;
+        }
     }
-  return rc;
+  return p_type;
+}
+
+static OMX_ERRORTYPE
+register_base_types (tiz_os_t * ap_os)
+{
+  assert (ap_os);
+  /* Only the root types are created upfront; the tizobject type init
+     function patches the tizclass type, so both must always exist. */
+  return (get_base_type (ap_os, ETIZClass) && get_base_type (ap_os, ETIZObject))
+           ? OMX_ErrorNone
+           : OMX_ErrorInsufficientResources;
 }
 
 OMX_ERRORTYPE
@@ -520,6 +571,26 @@ tiz_os_init (tiz_os_t ** app_os, const OMX_HANDLETYPE ap_hdl,
       return OMX_ErrorInsufficientResources;
     }
 
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_os->mutex)))
+    {
+      tiz_map_destroy (p_os->p_map);
+      os_free (ap_soa, p_os);
+      p_os = NULL;
+      return OMX_ErrorInsufficientResources;
+    }
+
+  /* Too large for the small object allocator */
+  if (NULL
+      == (p_os->pp_types
+          = (void **) tiz_mem_calloc (TIZ_OS_TYPE_COUNT, sizeof (void *))))
+    {
+      tiz_mutex_destroy (&(p_os->mutex));
+      tiz_map_destroy (p_os->p_map);
+      os_free (ap_soa, p_os);
+      p_os = NULL;
+      return OMX_ErrorInsufficientResources;
+    }
+
   p_os->p_hdl = ap_hdl;
   p_os->p_soa = ap_soa;
 
@@ -538,6 +609,16 @@ tiz_os_destroy (tiz_os_t * ap_os)
           tiz_map_erase_at (ap_os->p_map, 0);
         };
       tiz_map_destroy (ap_os->p_map);
+      tiz_mutex_destroy (&(ap_os->mutex));
+      if (ap_os->pp_types)
+        {
+          size_t i = 0;
+          for (i = 0; i < TIZ_OS_TYPE_COUNT; ++i)
+            {
+              tiz_mem_free (ap_os->pp_types[i]);
+            }
+          tiz_mem_free (ap_os->pp_types);
+        }
       os_free (ap_os->p_soa, ap_os);
     }
 }
@@ -547,8 +628,7 @@ tiz_os_register_type (tiz_os_t * ap_os, const tiz_os_type_init_f a_type_init_f,
                       const OMX_STRING a_type_name)
 {
   assert (ap_os);
-  return os_register_type (ap_os, a_type_init_f, a_type_name,
-                           tiz_map_size (ap_os->p_map));
+  return os_register_type (ap_os, a_type_init_f, a_type_name);
 }
 
 OMX_ERRORTYPE
@@ -558,50 +638,26 @@ tiz_os_register_base_types (tiz_os_t * ap_os)
   return register_base_types (ap_os);
 }
 
-static OMX_ERRORTYPE
-register_additional_type (tiz_os_t * ap_os, const char * a_type_name)
-{
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  const OMX_S32 count
-    = sizeof (tiz_os_type_to_str_tbl) / sizeof (tiz_os_type_str_t);
-  OMX_S32 type_id = TIZ_OS_BASE_TYPE_END + 1;
-
-  assert (ap_os);
-
-  for (; type_id < count && OMX_ErrorNone == rc; ++type_id)
-    {
-      if (0 == strncmp (a_type_name, tiz_os_type_to_str_tbl[type_id].str,
-                        OMX_MAX_STRINGNAME_SIZE))
-        {
-          TIZ_TRACE (ap_os->p_hdl, "Registering additional type [%s]...",
-                     a_type_name);
-          rc = os_register_type (ap_os, tiz_os_type_to_fnt_tbl[type_id],
-                                 a_type_name, type_id);
-          break;
-        }
-    }
-  return rc;
-}
-
 void *
 tiz_os_get_type (const tiz_os_t * ap_os, const char * a_type_name)
 {
   void * res = NULL;
+  OMX_S32 type_id = -1;
   assert (ap_os);
   assert (ap_os->p_map);
   assert (a_type_name);
-  res = tiz_map_find (ap_os->p_map, (OMX_PTR) a_type_name);
-  TIZ_TRACE (ap_os->p_hdl, "Get type [%s]->[%p] - total types [%d]",
-             a_type_name, res, tiz_map_size (ap_os->p_map));
-  if (!res)
+  if ((type_id = find_base_type_id (a_type_name)) >= 0)
     {
-      if (OMX_ErrorNone
-          == register_additional_type ((tiz_os_t *) ap_os, a_type_name))
-        {
-          print_types (ap_os);
-          res = tiz_map_find (ap_os->p_map, (OMX_PTR) a_type_name);
-        }
+      res = get_base_type ((tiz_os_t *) ap_os, type_id);
+    }
+  else
+    {
+      tiz_mutex_t * p_mutex = (tiz_mutex_t *) &(ap_os->mutex);
+      (void) tiz_mutex_lock (p_mutex);
+      res = tiz_map_find (ap_os->p_map, (OMX_PTR) a_type_name);
+      (void) tiz_mutex_unlock (p_mutex);
     }
+  TIZ_TRACE (ap_os->p_hdl, "Get type [%s]->[%p]", a_type_name, res);
   assert (res);
   return res;
 }
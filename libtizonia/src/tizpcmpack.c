@@ -0,0 +1,500 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizpcmpack.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - PCM sample interleaving and quantization
+ *
+ * Samples are quantized into a small interleaved scratch area and then
+ * written out in the requested byte layout; both loops are simple enough for
+ * the compiler to vectorize. The common 16-bit cases (FLAC, MP3, Opus) have
+ * an explicit SSE2 path.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <tizplatform.h>
+
+#include "tizpcmpack.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.pcmpack"
+#endif
+
+/* Number of samples quantized in one go, across all channels */
+#define PCM_PACK_SCRATCH_SAMPLES 1024
+
+static inline uint32_t
+dither_next (tiz_pcm_dither_t * ap_dither)
+{
+  /* xorshift32 */
+  uint32_t x = ap_dither->state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  ap_dither->state = x;
+  return x;
+}
+
+/* Triangular noise spanning +/- one output step, where an output step is
+   2^a_shift input steps */
+static inline int64_t
+tpdf_noise (tiz_pcm_dither_t * ap_dither, const int a_shift)
+{
+  const int64_t r1 = dither_next (ap_dither) >> (32 - a_shift);
+  const int64_t r2 = dither_next (ap_dither) >> (32 - a_shift);
+  return r1 + r2 - (((int64_t) 1 << a_shift) - 1);
+}
+
+/* Triangular noise spanning +/- one output step, in output steps */
+static inline double
+tpdf_noise_float (tiz_pcm_dither_t * ap_dither)
+{
+  return ((double) dither_next (ap_dither) + (double) dither_next (ap_dither))
+           / 4294967296.0
+         - 1.0;
+}
+
+static inline int
+fmt_bits (const tiz_pcm_fmt_t a_fmt)
+{
+  switch (a_fmt)
+    {
+      case TIZ_PCM_FMT_S8:
+        return 8;
+      case TIZ_PCM_FMT_S16_LE:
+      case TIZ_PCM_FMT_S16_BE:
+        return 16;
+      case TIZ_PCM_FMT_S24_LE:
+        return 24;
+      case TIZ_PCM_FMT_S32_LE:
+      case TIZ_PCM_FMT_F32:
+      default:
+        return 32;
+    };
+}
+
+static inline int32_t
+requantize (tiz_pcm_dither_t * ap_dither, const int32_t a_sample,
+            const int a_shift, const int32_t a_lo, const int32_t a_hi)
+{
+  int64_t v = a_sample;
+  if (a_shift > 0)
+    {
+      if (ap_dither)
+        {
+          v += tpdf_noise (ap_dither, a_shift);
+        }
+      v = (v + ((int64_t) 1 << (a_shift - 1))) >> a_shift;
+    }
+  else if (a_shift < 0)
+    {
+      v *= ((int64_t) 1 << -a_shift);
+    }
+  return (int32_t) (v < a_lo ? a_lo : (v > a_hi ? a_hi : v));
+}
+
+static void
+store_ints (uint8_t * ap_dst, const int32_t * ap_src, const size_t a_nsamples,
+            const tiz_pcm_fmt_t a_fmt)
+{
+  size_t i = 0;
+  switch (a_fmt)
+    {
+      case TIZ_PCM_FMT_S8:
+        {
+          for (i = 0; i < a_nsamples; ++i)
+            {
+              ap_dst[i] = (uint8_t) ap_src[i];
+            }
+        }
+        break;
+      case TIZ_PCM_FMT_S16_LE:
+        {
+          for (i = 0; i < a_nsamples; ++i)
+            {
+              ap_dst[2 * i] = (uint8_t) ap_src[i];
+              ap_dst[2 * i + 1] = (uint8_t) (ap_src[i] >> 8);
+            }
+        }
+        break;
+      case TIZ_PCM_FMT_S16_BE:
+        {
+          for (i = 0; i < a_nsamples; ++i)
+            {
+              ap_dst[2 * i] = (uint8_t) (ap_src[i] >> 8);
+              ap_dst[2 * i + 1] = (uint8_t) ap_src[i];
+            }
+        }
+        break;
+      case TIZ_PCM_FMT_S24_LE:
+        {
+          for (i = 0; i < a_nsamples; ++i)
+            {
+              ap_dst[3 * i] = (uint8_t) ap_src[i];
+              ap_dst[3 * i + 1] = (uint8_t) (ap_src[i] >> 8);
+              ap_dst[3 * i + 2] = (uint8_t) (ap_src[i] >> 16);
+            }
+        }
+        break;
+      case TIZ_PCM_FMT_S32_LE:
+        {
+          for (i = 0; i < a_nsamples; ++i)
+            {
+              ap_dst[4 * i] = (uint8_t) ap_src[i];
+              ap_dst[4 * i + 1] = (uint8_t) (ap_src[i] >> 8);
+              ap_dst[4 * i + 2] = (uint8_t) (ap_src[i] >> 16);
+              ap_dst[4 * i + 3] = (uint8_t) (ap_src[i] >> 24);
+            }
+        }
+        break;
+      default:
+        {
+          assert (0);
+        }
+        break;
+    };
+}
+
+#if defined(__SSE2__)
+/* Stereo int32 -> S16 without dither. Returns the number of frames written;
+   the caller finishes the tail with the scalar code, which rounds and
+   saturates identically. */
+static size_t
+pack_s16_stereo_sse2 (uint8_t * ap_dst, const int32_t * ap_l,
+                      const int32_t * ap_r, const size_t a_nframes,
+                      const int a_shift, const bool a_big_endian)
+{
+  const __m128i one = _mm_set1_epi32 (1);
+  const __m128i count = _mm_cvtsi32_si128 (a_shift > 0 ? a_shift - 1 : 0);
+  size_t i = 0;
+
+  for (i = 0; i + 4 <= a_nframes; i += 4)
+    {
+      __m128i l = _mm_loadu_si128 ((const __m128i *) (ap_l + i));
+      __m128i r = _mm_loadu_si128 ((const __m128i *) (ap_r + i));
+      __m128i out;
+      if (a_shift > 0)
+        {
+          /* Round to nearest without overflowing: ((v >> (s - 1)) + 1) >> 1 */
+          l = _mm_srai_epi32 (_mm_add_epi32 (_mm_sra_epi32 (l, count), one),
+                              1);
+          r = _mm_srai_epi32 (_mm_add_epi32 (_mm_sra_epi32 (r, count), one),
+                              1);
+        }
+      out = _mm_packs_epi32 (_mm_unpacklo_epi32 (l, r),
+                             _mm_unpackhi_epi32 (l, r));
+      if (a_big_endian)
+        {
+          out = _mm_or_si128 (_mm_slli_epi16 (out, 8), _mm_srli_epi16 (out, 8));
+        }
+      _mm_storeu_si128 ((__m128i *) (ap_dst + i * 4), out);
+    }
+  return i;
+}
+
+/* Clamped float -> int32, rounding half away from zero like the scalar
+   code. _mm_cvtps_epi32 rounds half to even, so truncate instead, and add the
+   sign where the (exact) fractional part is at least one half. */
+static inline __m128i
+round_ps_epi32 (const __m128 a_v)
+{
+  const __m128 half = _mm_set1_ps (0.5f);
+  const __m128 minus_half = _mm_set1_ps (-0.5f);
+  const __m128i i = _mm_cvttps_epi32 (a_v);
+  const __m128 frac = _mm_sub_ps (a_v, _mm_cvtepi32_ps (i));
+  /* Comparison masks are all ones, i.e. -1 */
+  const __m128i up = _mm_castps_si128 (_mm_cmpge_ps (frac, half));
+  const __m128i down = _mm_castps_si128 (_mm_cmple_ps (frac, minus_half));
+  return _mm_add_epi32 (_mm_sub_epi32 (i, up), down);
+}
+
+/* Single channel (or already interleaved) float -> S16 without dither */
+static size_t
+pack_float_s16_mono_sse2 (uint8_t * ap_dst, const float * ap_src,
+                          const size_t a_nsamples, const bool a_big_endian)
+{
+  const __m128 scale = _mm_set1_ps (32768.0f);
+  const __m128 hi = _mm_set1_ps (32767.0f);
+  const __m128 lo = _mm_set1_ps (-32768.0f);
+  size_t i = 0;
+
+  for (i = 0; i + 8 <= a_nsamples; i += 8)
+    {
+      __m128 a = _mm_mul_ps (_mm_loadu_ps (ap_src + i), scale);
+      __m128 b = _mm_mul_ps (_mm_loadu_ps (ap_src + i + 4), scale);
+      __m128i out
+        = _mm_packs_epi32 (round_ps_epi32 (_mm_max_ps (_mm_min_ps (a, hi), lo)),
+                           round_ps_epi32 (_mm_max_ps (_mm_min_ps (b, hi), lo)));
+      if (a_big_endian)
+        {
+          out = _mm_or_si128 (_mm_slli_epi16 (out, 8), _mm_srli_epi16 (out, 8));
+        }
+      _mm_storeu_si128 ((__m128i *) (ap_dst + i * 2), out);
+    }
+  return i;
+}
+
+/* Stereo float -> S16 without dither */
+static size_t
+pack_float_s16_stereo_sse2 (uint8_t * ap_dst, const float * ap_l,
+                            const float * ap_r, const size_t a_nframes,
+                            const bool a_big_endian)
+{
+  const __m128 scale = _mm_set1_ps (32768.0f);
+  const __m128 hi = _mm_set1_ps (32767.0f);
+  const __m128 lo = _mm_set1_ps (-32768.0f);
+  size_t i = 0;
+
+  for (i = 0; i + 4 <= a_nframes; i += 4)
+    {
+      __m128 l = _mm_mul_ps (_mm_loadu_ps (ap_l + i), scale);
+      __m128 r = _mm_mul_ps (_mm_loadu_ps (ap_r + i), scale);
+      __m128i li = round_ps_epi32 (_mm_max_ps (_mm_min_ps (l, hi), lo));
+      __m128i ri = round_ps_epi32 (_mm_max_ps (_mm_min_ps (r, hi), lo));
+      __m128i out = _mm_packs_epi32 (_mm_unpacklo_epi32 (li, ri),
+                                     _mm_unpackhi_epi32 (li, ri));
+      if (a_big_endian)
+        {
+          out = _mm_or_si128 (_mm_slli_epi16 (out, 8), _mm_srli_epi16 (out, 8));
+        }
+      _mm_storeu_si128 ((__m128i *) (ap_dst + i * 4), out);
+    }
+  return i;
+}
+#endif
+
+/* a_scale_bits is the position of the full-scale bit in the source, i.e. a
+   sample of 1 << a_scale_bits maps to 1.0 */
+static void
+pack_ints (uint8_t * ap_dst, const int32_t * const ap_src[],
+           const size_t a_nframes, const unsigned int a_nchannels,
+           const int a_scale_bits, const tiz_pcm_fmt_t a_fmt,
+           tiz_pcm_dither_t * ap_dither)
+{
+  const size_t sample_bytes = tiz_pcm_fmt_bytes (a_fmt);
+  const size_t chunk = PCM_PACK_SCRATCH_SAMPLES / a_nchannels;
+  size_t done = 0;
+
+  assert (ap_dst);
+  assert (ap_src);
+  assert (a_nchannels > 0 && a_nchannels <= PCM_PACK_SCRATCH_SAMPLES);
+
+  if (TIZ_PCM_FMT_F32 == a_fmt)
+    {
+      const float scale = (float) (1.0 / (double) ((int64_t) 1 << a_scale_bits));
+      float * p_out = (float *) ap_dst;
+      unsigned int c = 0;
+      for (c = 0; c < a_nchannels; ++c)
+        {
+          const int32_t * p_in = ap_src[c];
+          size_t f = 0;
+          for (f = 0; f < a_nframes; ++f)
+            {
+              const float v = (float) p_in[f] * scale;
+              p_out[f * a_nchannels + c]
+                = v > 1.0f ? 1.0f : (v < -1.0f ? -1.0f : v);
+            }
+        }
+      return;
+    }
+
+  {
+    const int out_bits = fmt_bits (a_fmt);
+    const int shift = a_scale_bits - (out_bits - 1);
+    const int32_t hi
+      = out_bits == 32 ? INT32_MAX : (int32_t) ((1u << (out_bits - 1)) - 1);
+    const int32_t lo = -hi - 1;
+    int32_t scratch[PCM_PACK_SCRATCH_SAMPLES];
+
+#if defined(__SSE2__)
+    if (2 == a_nchannels && 16 == out_bits && !ap_dither && shift >= 0)
+      {
+        done = pack_s16_stereo_sse2 (ap_dst, ap_src[0], ap_src[1], a_nframes,
+                                     shift, TIZ_PCM_FMT_S16_BE == a_fmt);
+      }
+#endif
+
+    while (done < a_nframes)
+      {
+        const size_t n = MIN (chunk, a_nframes - done);
+        unsigned int c = 0;
+        for (c = 0; c < a_nchannels; ++c)
+          {
+            const int32_t * p_in = ap_src[c] + done;
+            size_t f = 0;
+            for (f = 0; f < n; ++f)
+              {
+                scratch[f * a_nchannels + c]
+                  = requantize (ap_dither, p_in[f], shift, lo, hi);
+              }
+          }
+        store_ints (ap_dst + done * a_nchannels * sample_bytes, scratch,
+                    n * a_nchannels, a_fmt);
+        done += n;
+      }
+  }
+}
+
+void
+tiz_pcm_dither_init (tiz_pcm_dither_t * ap_dither, uint32_t a_seed)
+{
+  assert (ap_dither);
+  /* xorshift must not start at zero */
+  ap_dither->state = a_seed ? a_seed : 0x9e3779b9u;
+}
+
+size_t
+tiz_pcm_fmt_bytes (tiz_pcm_fmt_t a_fmt)
+{
+  return (size_t) fmt_bits (a_fmt) / 8;
+}
+
+void
+tiz_pcm_pack_s32 (void * ap_dst, const int32_t * const ap_src[],
+                  size_t a_nframes, unsigned int a_nchannels,
+                  unsigned int a_src_bits, tiz_pcm_fmt_t a_fmt,
+                  tiz_pcm_dither_t * ap_dither)
+{
+  assert (a_src_bits > 0 && a_src_bits <= 32);
+  pack_ints (ap_dst, ap_src, a_nframes, a_nchannels, (int) a_src_bits - 1,
+             a_fmt, ap_dither);
+}
+
+void
+tiz_pcm_pack_fixed (void * ap_dst, const int32_t * const ap_src[],
+                    size_t a_nframes, unsigned int a_nchannels,
+                    unsigned int a_frac_bits, tiz_pcm_fmt_t a_fmt,
+                    tiz_pcm_dither_t * ap_dither)
+{
+  assert (a_frac_bits < 32);
+  pack_ints (ap_dst, ap_src, a_nframes, a_nchannels, (int) a_frac_bits, a_fmt,
+             ap_dither);
+}
+
+void
+tiz_pcm_pack_float (void * ap_dst, const float * const ap_src[],
+                    size_t a_nframes, unsigned int a_nchannels,
+                    tiz_pcm_fmt_t a_fmt, tiz_pcm_dither_t * ap_dither)
+{
+  uint8_t * p_dst = ap_dst;
+  size_t done = 0;
+
+  assert (ap_dst);
+  assert (ap_src);
+  assert (a_nchannels > 0 && a_nchannels <= PCM_PACK_SCRATCH_SAMPLES);
+
+  if (TIZ_PCM_FMT_F32 == a_fmt)
+    {
+      float * p_out = ap_dst;
+      unsigned int c = 0;
+      if (1 == a_nchannels)
+        {
+          memcpy (p_out, ap_src[0], a_nframes * sizeof (float));
+          return;
+        }
+      for (c = 0; c < a_nchannels; ++c)
+        {
+          const float * p_in = ap_src[c];
+          size_t f = 0;
+          for (f = 0; f < a_nframes; ++f)
+            {
+              p_out[f * a_nchannels + c] = p_in[f];
+            }
+        }
+      return;
+    }
+
+  {
+    const int out_bits = fmt_bits (a_fmt);
+    const double scale = (double) ((int64_t) 1 << (out_bits - 1));
+    const double hi = scale - 1.0;
+    const double lo = -scale;
+    const size_t sample_bytes = tiz_pcm_fmt_bytes (a_fmt);
+    const size_t chunk = PCM_PACK_SCRATCH_SAMPLES / a_nchannels;
+    int32_t scratch[PCM_PACK_SCRATCH_SAMPLES];
+
+#if defined(__SSE2__)
+    if (1 == a_nchannels && 16 == out_bits && !ap_dither)
+      {
+        done = pack_float_s16_mono_sse2 (p_dst, ap_src[0], a_nframes,
+                                         TIZ_PCM_FMT_S16_BE == a_fmt);
+      }
+    else if (2 == a_nchannels && 16 == out_bits && !ap_dither)
+      {
+        done = pack_float_s16_stereo_sse2 (p_dst, ap_src[0], ap_src[1],
+                                           a_nframes,
+                                           TIZ_PCM_FMT_S16_BE == a_fmt);
+      }
+#endif
+
+    while (done < a_nframes)
+      {
+        const size_t n = MIN (chunk, a_nframes - done);
+        unsigned int c = 0;
+        for (c = 0; c < a_nchannels; ++c)
+          {
+            const float * p_in = ap_src[c] + done;
+            size_t f = 0;
+            for (f = 0; f < n; ++f)
+              {
+                double v = (double) p_in[f] * scale;
+                if (ap_dither)
+                  {
+                    v += tpdf_noise_float (ap_dither);
+                  }
+                v = v > hi ? hi : (v < lo ? lo : v);
+                /* Round to nearest */
+                scratch[f * a_nchannels + c]
+                  = (int32_t) (v < 0 ? v - 0.5 : v + 0.5);
+              }
+          }
+        store_ints (p_dst + done * a_nchannels * sample_bytes, scratch,
+                    n * a_nchannels, a_fmt);
+        done += n;
+      }
+  }
+}
+
+void
+tiz_pcm_pack_float_ilv (void * ap_dst, const float * ap_src,
+                        size_t a_nframes, unsigned int a_nchannels,
+                        tiz_pcm_fmt_t a_fmt, tiz_pcm_dither_t * ap_dither)
+{
+  /* Interleaved in, interleaved out: this is a flat conversion of
+     a_nframes * a_nchannels samples */
+  const float * const src[] = {ap_src};
+  assert (a_nchannels > 0);
+  tiz_pcm_pack_float (ap_dst, src, a_nframes * a_nchannels, 1, a_fmt,
+                      ap_dither);
+}
@@ -0,0 +1,149 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizpcmpack.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - PCM sample interleaving and quantization
+ *
+ *
+ */
+
+#ifndef TIZPCMPACK_H
+#define TIZPCMPACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @defgroup tizpcmpack PCM packing helpers
+ *
+ * Conversion of decoder output (planar or interleaved, integer, fixed point
+ * or float) into the interleaved PCM layouts that are exchanged on OpenMAX IL
+ * PCM ports. All decoders share the same clipping rules: values are rounded
+ * to the nearest output step and saturated to the output range.
+ *
+ * @ingroup libtizonia
+ */
+
+/**
+ * Interleaved output sample formats.
+ * @ingroup tizpcmpack
+ */
+typedef enum tiz_pcm_fmt
+{
+  TIZ_PCM_FMT_S8,     /**< Signed 8-bit */
+  TIZ_PCM_FMT_S16_LE, /**< Signed 16-bit, little endian */
+  TIZ_PCM_FMT_S16_BE, /**< Signed 16-bit, big endian */
+  TIZ_PCM_FMT_S24_LE, /**< Signed 24-bit packed in 3 bytes, little endian */
+  TIZ_PCM_FMT_S32_LE, /**< Signed 32-bit, little endian */
+  TIZ_PCM_FMT_F32     /**< 32-bit float, host byte order */
+} tiz_pcm_fmt_t;
+
+/**
+ * TPDF dither state. Pass a pointer to one of these to the pack functions to
+ * enable dithering whenever samples are requantized to a lower resolution;
+ * pass NULL to disable it.
+ * @ingroup tizpcmpack
+ */
+typedef struct tiz_pcm_dither tiz_pcm_dither_t;
+struct tiz_pcm_dither
+{
+  uint32_t state;
+};
+
+/**
+ * Seed a dither state.
+ * @ingroup tizpcmpack
+ */
+void
+tiz_pcm_dither_init (tiz_pcm_dither_t * ap_dither, uint32_t a_seed);
+
+/**
+ * Size in bytes of one sample in the given format.
+ * @ingroup tizpcmpack
+ */
+size_t
+tiz_pcm_fmt_bytes (tiz_pcm_fmt_t a_fmt);
+
+/**
+ * Interleave planar integer samples that carry @a a_src_bits significant
+ * bits (e.g. the FLAC decoder's output).
+ *
+ * @ingroup tizpcmpack
+ *
+ * @param ap_dst The destination buffer (a_nframes * a_nchannels samples).
+ * @param ap_src One pointer per channel.
+ * @param a_nframes Number of frames to convert.
+ * @param a_nchannels Number of channels.
+ * @param a_src_bits Bits per sample in the source (1-32).
+ * @param a_fmt The output format.
+ * @param ap_dither Dither state, or NULL.
+ */
+void
+tiz_pcm_pack_s32 (void * ap_dst, const int32_t * const ap_src[],
+                  size_t a_nframes, unsigned int a_nchannels,
+                  unsigned int a_src_bits, tiz_pcm_fmt_t a_fmt,
+                  tiz_pcm_dither_t * ap_dither);
+
+/**
+ * Interleave planar fixed point samples with @a a_frac_bits fractional bits,
+ * where 1.0 is full scale (e.g. libmad's mad_fixed_t). Out-of-range values
+ * are clipped.
+ *
+ * @ingroup tizpcmpack
+ */
+void
+tiz_pcm_pack_fixed (void * ap_dst, const int32_t * const ap_src[],
+                    size_t a_nframes, unsigned int a_nchannels,
+                    unsigned int a_frac_bits, tiz_pcm_fmt_t a_fmt,
+                    tiz_pcm_dither_t * ap_dither);
+
+/**
+ * Interleave planar float samples in the [-1.0, 1.0] range. Out-of-range
+ * values are clipped for integer output formats; F32 output is copied
+ * verbatim.
+ *
+ * @ingroup tizpcmpack
+ */
+void
+tiz_pcm_pack_float (void * ap_dst, const float * const ap_src[],
+                    size_t a_nframes, unsigned int a_nchannels,
+                    tiz_pcm_fmt_t a_fmt, tiz_pcm_dither_t * ap_dither);
+
+/**
+ * Same as tiz_pcm_pack_float, but for already interleaved input.
+ *
+ * @ingroup tizpcmpack
+ */
+void
+tiz_pcm_pack_float_ilv (void * ap_dst, const float * ap_src,
+                        size_t a_nframes, unsigned int a_nchannels,
+                        tiz_pcm_fmt_t a_fmt, tiz_pcm_dither_t * ap_dither);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZPCMPACK_H */
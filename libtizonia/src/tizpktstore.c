@@ -0,0 +1,152 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizpktstore.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Reassembly of packet-aligned input
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "tizpktstore.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.pktstore"
+#endif
+
+static OMX_ERRORTYPE
+stage (tiz_pkt_store_t * ap_store, OMX_BUFFERHEADERTYPE * ap_in)
+{
+  assert (ap_store);
+  assert (ap_in);
+
+  if (ap_store->offset + ap_in->nFilledLen > ap_store->size)
+    {
+      const OMX_U32 new_size = ap_store->offset + ap_in->nFilledLen;
+      OMX_U8 * p_new_data = tiz_mem_realloc (ap_store->p_data, new_size);
+      tiz_check_null_ret_oom (p_new_data);
+      ap_store->p_data = p_new_data;
+      ap_store->size = new_size;
+    }
+
+  memcpy (ap_store->p_data + ap_store->offset, ap_in->pBuffer + ap_in->nOffset,
+          ap_in->nFilledLen);
+  ap_store->offset += ap_in->nFilledLen;
+  ap_in->nFilledLen = 0;
+  ap_in->nOffset = 0;
+
+  return OMX_ErrorNone;
+}
+
+void
+tiz_pkt_store_init (tiz_pkt_store_t * ap_store)
+{
+  assert (ap_store);
+  ap_store->p_data = NULL;
+  ap_store->size = 0;
+  ap_store->offset = 0;
+  ap_store->packetized = false;
+}
+
+void
+tiz_pkt_store_destroy (tiz_pkt_store_t * ap_store)
+{
+  assert (ap_store);
+  tiz_mem_free (ap_store->p_data);
+  tiz_pkt_store_init (ap_store);
+}
+
+void
+tiz_pkt_store_reset (tiz_pkt_store_t * ap_store)
+{
+  assert (ap_store);
+  ap_store->offset = 0;
+  ap_store->packetized = false;
+}
+
+void
+tiz_pkt_store_clear (tiz_pkt_store_t * ap_store)
+{
+  assert (ap_store);
+  ap_store->offset = 0;
+}
+
+OMX_ERRORTYPE
+tiz_pkt_store_obtain (tiz_pkt_store_t * ap_store, OMX_BUFFERHEADERTYPE * ap_in,
+                      const OMX_U8 ** app_data, OMX_U32 * ap_len,
+                      OMX_TICKS * ap_end_time)
+{
+  const bool end_of_packet = (ap_in->nFlags & OMX_BUFFERFLAG_ENDOFFRAME) > 0;
+
+  assert (ap_store);
+  assert (ap_in);
+  assert (app_data);
+  assert (ap_len);
+
+  if (end_of_packet)
+    {
+      ap_store->packetized = true;
+    }
+
+  if (ap_in->nFilledLen > 0 && ap_store->packetized
+      && (!end_of_packet || ap_store->offset > 0))
+    {
+      tiz_check_omx (stage (ap_store, ap_in));
+    }
+
+  if (ap_in->nFilledLen > 0)
+    {
+      *app_data = ap_in->pBuffer + ap_in->nOffset;
+      *ap_len = ap_in->nFilledLen;
+    }
+  else if (end_of_packet && ap_store->offset > 0)
+    {
+      *app_data = ap_store->p_data;
+      *ap_len = ap_store->offset;
+    }
+  else
+    {
+      *app_data = NULL;
+      *ap_len = 0;
+    }
+
+  if (ap_end_time)
+    {
+      /* Only the buffer that completes a packet carries its time */
+      *ap_end_time
+        = (end_of_packet && *ap_len > 0
+           && 0 == (ap_in->nFlags & OMX_BUFFERFLAG_TIMESTAMPINVALID))
+            ? ap_in->nTimeStamp
+            : -1;
+    }
+
+  return OMX_ErrorNone;
+}
@@ -0,0 +1,125 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizpktstore.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Reassembly of packet-aligned input
+ *
+ *
+ */
+
+#ifndef TIZPKTSTORE_H
+#define TIZPKTSTORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * @defgroup tizpktstore Packet store
+ *
+ * Decoders fed by a demuxer receive packet-aligned input: every buffer holds
+ * bytes of one packet only, and the buffer that completes a packet is
+ * flagged with OMX_BUFFERFLAG_ENDOFFRAME. Whole packets are decoded straight
+ * from the input buffer; the leading parts of a packet that spans several
+ * buffers are staged in the packet store until its last part arrives. Input
+ * that never carries the flag is passed through one buffer at a time.
+ *
+ * @ingroup libtizonia
+ */
+
+/**
+ * Packet store. Zero-initialise, or call tiz_pkt_store_init.
+ * @ingroup tizpktstore
+ */
+typedef struct tiz_pkt_store tiz_pkt_store_t;
+struct tiz_pkt_store
+{
+  OMX_U8 * p_data;
+  OMX_U32 size;
+  OMX_U32 offset;
+  bool packetized; /**< ENDOFFRAME has been seen on this stream */
+};
+
+/**
+ * Initialise an empty packet store.
+ * @ingroup tizpktstore
+ */
+void
+tiz_pkt_store_init (tiz_pkt_store_t * ap_store);
+
+/**
+ * Release the packet store's memory and reinitialise it.
+ * @ingroup tizpktstore
+ */
+void
+tiz_pkt_store_destroy (tiz_pkt_store_t * ap_store);
+
+/**
+ * Drop any staged data and forget whether the stream is packet-aligned
+ * (e.g. on flush or on a new stream). The memory is kept.
+ * @ingroup tizpktstore
+ */
+void
+tiz_pkt_store_reset (tiz_pkt_store_t * ap_store);
+
+/**
+ * Drop the staged packet once it has been consumed.
+ * @ingroup tizpktstore
+ */
+void
+tiz_pkt_store_clear (tiz_pkt_store_t * ap_store);
+
+/**
+ * Obtain the next complete packet from an input buffer.
+ *
+ * Staged bytes are removed from the input header (its nFilledLen becomes
+ * zero). If @a ap_in holds a whole packet, *app_data points into the input
+ * buffer; if it completes a staged packet, *app_data points to the store.
+ * Once the packet has been decoded, the caller consumes the input header's
+ * bytes and calls tiz_pkt_store_clear.
+ *
+ * @ingroup tizpktstore
+ *
+ * @param ap_store The packet store.
+ * @param ap_in The input buffer header.
+ * @param app_data The packet's data, or NULL.
+ * @param ap_len The packet's length; zero while the packet is incomplete.
+ * @param ap_end_time If not NULL, receives the time at the end of the
+ * packet's samples, as stamped by the demuxer (i.e. from the packet's Ogg
+ * granule position, with no codec-specific offset removed), or -1 if unknown.
+ * @return OMX_ErrorNone, or OMX_ErrorInsufficientResources.
+ */
+OMX_ERRORTYPE
+tiz_pkt_store_obtain (tiz_pkt_store_t * ap_store, OMX_BUFFERHEADERTYPE * ap_in,
+                      const OMX_U8 ** app_data, OMX_U32 * ap_len,
+                      OMX_TICKS * ap_end_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZPKTSTORE_H */
@@ -301,6 +301,24 @@ unregister_header (const void * ap_obj, OMX_S32 hdr_pos)
   return p_hdr;
 }
 
+static void
+update_flow_times (tiz_port_t * ap_obj)
+{
+  const OMX_U64 now = tiz_monotonic_usec ();
+  assert (ap_obj);
+  if (ap_obj->flow_stamp_ > 0)
+    {
+      /* Integrate the number of headers owned by each side over the time
+         elapsed since the last update */
+      const OMX_U64 elapsed = now - ap_obj->flow_stamp_;
+      const OMX_U32 nbufs = tiz_vector_length (ap_obj->p_hdrs_);
+      const OMX_U32 held = MIN (ap_obj->flow_held_, nbufs);
+      ap_obj->flow_stats_.nComponentBufferTime += held * elapsed;
+      ap_obj->flow_stats_.nPeerBufferTime += (nbufs - held) * elapsed;
+    }
+  ap_obj->flow_stamp_ = now;
+}
+
 /*
  * tizport class
  */
@@ -315,6 +333,7 @@ port_ctor (void * ap_obj, va_list * app)
   OMX_INDEXTYPE id2 = OMX_IndexParamCompBufferSupplier;
   OMX_INDEXTYPE id3 = OMX_IndexConfigTunneledPortStatus;
   OMX_INDEXTYPE id4 = OMX_TizoniaIndexParamBufferPreAnnouncementsMode;
+  OMX_INDEXTYPE id5 = OMX_TizoniaIndexConfigBufferFlowStats;
 
   assert (ap_obj);
 
@@ -325,6 +344,7 @@ port_ctor (void * ap_obj, va_list * app)
   tiz_check_omx_ret_null (tiz_vector_push_back (p_obj->p_indexes_, &id2));
   tiz_check_omx_ret_null (tiz_vector_push_back (p_obj->p_indexes_, &id3));
   tiz_check_omx_ret_null (tiz_vector_push_back (p_obj->p_indexes_, &id4));
+  tiz_check_omx_ret_null (tiz_vector_push_back (p_obj->p_indexes_, &id5));
 
   /* Init buffer headers list */
   tiz_check_omx_ret_null (
@@ -410,6 +430,13 @@ port_ctor (void * ap_obj, va_list * app)
 
   (void) tiz_mem_set (&p_obj->eglimage_hook_, 0, sizeof p_obj->eglimage_hook_);
 
+  (void) tiz_mem_set (&p_obj->flow_stats_, 0, sizeof p_obj->flow_stats_);
+  p_obj->flow_stats_.nSize
+    = (OMX_U32) sizeof (OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE);
+  p_obj->flow_stats_.nVersion.nVersion = (OMX_U32) OMX_VERSION;
+  p_obj->flow_held_ = 0;
+  p_obj->flow_stamp_ = 0;
+
   return p_obj;
 }
 
@@ -654,7 +681,19 @@ port_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
 
       default:
         {
-          return OMX_ErrorUnsupportedIndex;
+          if (OMX_TizoniaIndexConfigBufferFlowStats == a_index)
+            {
+              OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE * p_stats
+                = (OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE *) ap_struct;
+              /* Bring the buffer times up to date first */
+              update_flow_times (p_obj);
+              *p_stats = p_obj->flow_stats_;
+              p_stats->nPortIndex = p_obj->pid_;
+            }
+          else
+            {
+              return OMX_ErrorUnsupportedIndex;
+            }
         }
     };
 
@@ -716,6 +755,13 @@ port_GetExtensionIndex (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
       *ap_index_type = OMX_TizoniaIndexParamBufferPreAnnouncementsMode;
       rc = OMX_ErrorNone;
     }
+  else if (0 == strncmp (ap_param_name,
+                         OMX_TIZONIA_INDEX_CONFIG_BUFFER_FLOW_STATS,
+                         strlen (OMX_TIZONIA_INDEX_CONFIG_BUFFER_FLOW_STATS)))
+    {
+      *ap_index_type = OMX_TizoniaIndexConfigBufferFlowStats;
+      rc = OMX_ErrorNone;
+    }
 
   return rc;
 }
@@ -1896,6 +1942,64 @@ tiz_port_update_claimed_count (void * ap_obj, OMX_S32 a_offset)
   return class->update_claimed_count (ap_obj, a_offset);
 }
 
+static void
+port_update_flow_stats (void * ap_obj, const tiz_port_flow_event_t a_event,
+                        const OMX_U32 a_nheld, const OMX_U32 a_ningress,
+                        const OMX_U32 a_nbytes)
+{
+  tiz_port_t * p_obj = ap_obj;
+  OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE * p_stats = NULL;
+  assert (p_obj);
+  assert (a_event < ETIZPortFlowMax);
+
+  p_stats = &p_obj->flow_stats_;
+  update_flow_times (p_obj);
+
+  switch (a_event)
+    {
+      case ETIZPortFlowReceived:
+        {
+          p_stats->nBuffersReceived++;
+        }
+        break;
+      case ETIZPortFlowClaimed:
+        {
+          p_stats->nBuffersClaimed++;
+        }
+        break;
+      case ETIZPortFlowReleased:
+        {
+          p_stats->nBuffersReleased++;
+        }
+        break;
+      case ETIZPortFlowReturned:
+        {
+          p_stats->nBuffersReturned++;
+          p_stats->nBytesReturned += a_nbytes;
+        }
+        break;
+      default:
+        break;
+    };
+
+  p_obj->flow_held_ = a_nheld;
+  p_stats->nIngressDepth = a_ningress;
+  if (a_ningress > p_stats->nIngressDepthMax)
+    {
+      p_stats->nIngressDepthMax = a_ningress;
+    }
+}
+
+void
+tiz_port_update_flow_stats (void * ap_obj, const tiz_port_flow_event_t a_event,
+                            const OMX_U32 a_nheld, const OMX_U32 a_ningress,
+                            const OMX_U32 a_nbytes)
+{
+  const tiz_port_class_t * class = classOf (ap_obj);
+  assert (class->update_flow_stats);
+  class->update_flow_stats (ap_obj, a_event, a_nheld, a_ningress, a_nbytes);
+}
+
 /* NOTE: Ignore splint warnings in this section of code */
 /*@ignore@*/
 static OMX_ERRORTYPE
@@ -2417,6 +2521,10 @@ port_class_ctor (void * ap_obj, va_list * app)
         {
           *(voidf *) &p_obj->update_claimed_count = method;
         }
+      else if (selector == (voidf) tiz_port_update_flow_stats)
+        {
+          *(voidf *) &p_obj->update_flow_stats = method;
+        }
       else if (selector == (voidf) tiz_port_store_mark)
         {
           *(voidf *) &p_obj->store_mark = method;
@@ -2568,6 +2676,8 @@ tiz_port_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_port_update_claimed_count, port_update_claimed_count,
      /* TIZ_CLASS_COMMENT: */
+     tiz_port_update_flow_stats, port_update_flow_stats,
+     /* TIZ_CLASS_COMMENT: */
      tiz_port_store_mark, port_store_mark,
      /* TIZ_CLASS_COMMENT: */
      tiz_port_mark_buffer, port_mark_buffer,
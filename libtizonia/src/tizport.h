@@ -59,6 +59,16 @@ enum tiz_port_flag_ids
   EFlagMax
 };
 
+typedef enum tiz_port_flow_event tiz_port_flow_event_t;
+enum tiz_port_flow_event
+{
+  ETIZPortFlowReceived = 0, /* A header has been received from the peer */
+  ETIZPortFlowClaimed,      /* A header has been claimed by the processor */
+  ETIZPortFlowReleased,     /* A header has been released by the processor */
+  ETIZPortFlowReturned,     /* A header has been returned to the peer */
+  ETIZPortFlowMax
+};
+
 typedef struct tiz_port_options tiz_port_options_t;
 struct tiz_port_options
 {
@@ -150,6 +160,11 @@ tiz_port_check_tunnel_compat (const void * ap_obj,
 OMX_S32
 tiz_port_update_claimed_count (void * ap_obj, OMX_S32 a_offset);
 
+void
+tiz_port_update_flow_stats (void * ap_obj, const tiz_port_flow_event_t a_event,
+                            const OMX_U32 a_nheld, const OMX_U32 a_ningress,
+                            const OMX_U32 a_nbytes);
+
 OMX_ERRORTYPE
 tiz_port_store_mark (void * ap_obj, const OMX_MARKTYPE * ap_mark_info,
                      OMX_BOOL a_owned);
@@ -60,6 +60,9 @@ struct tiz_port
   OMX_BOOL announce_bufs_;
   OMX_CONFIG_TUNNELEDPORTSTATUSTYPE peer_port_status_;
   tiz_eglimage_hook_t eglimage_hook_; /* EGL image validation hook */
+  OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE flow_stats_;
+  OMX_U32 flow_held_;  /* headers currently owned by the component */
+  OMX_U64 flow_stamp_; /* last time the buffer times were updated */
 };
 
 OMX_ERRORTYPE
@@ -118,6 +121,10 @@ struct tiz_port_class
                                OMX_PARAM_PORTDEFINITIONTYPE * ap_this_def,
                                OMX_PARAM_PORTDEFINITIONTYPE * ap_other_def);
   OMX_S32 (*update_claimed_count) (void * ap_obj, OMX_S32 a_offset);
+  void (*update_flow_stats) (void * ap_obj,
+                             const tiz_port_flow_event_t a_event,
+                             const OMX_U32 a_nheld, const OMX_U32 a_ningress,
+                             const OMX_U32 a_nbytes);
   OMX_ERRORTYPE (*store_mark)
   (void * ap_obj, const OMX_MARKTYPE * ap_mark_info, OMX_BOOL a_owned);
   OMX_ERRORTYPE (*mark_buffer) (void * ap_obj, OMX_BUFFERHEADERTYPE * ap_hdr);
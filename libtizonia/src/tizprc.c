@@ -81,12 +81,33 @@ dispatch_loaded_to_idle (tiz_prc_t * ap_prc, bool * ap_done)
   return tiz_srv_allocate_resources (ap_prc, OMX_ALL);
 }
 
+static void
+release_arena (tiz_prc_t * ap_prc)
+{
+  tiz_arena_info_t info;
+  assert (ap_prc);
+  assert (ap_prc->_.p_arena_);
+  tiz_arena_info (ap_prc->_.p_arena_, &info);
+  if (info.objects > 0)
+    {
+      /* Metadata items may live in the arena; drop them before the arena is
+         reset */
+      tiz_krn_clear_metadata (tiz_get_krn (handleOf (ap_prc)));
+      tiz_srv_arena_reset (ap_prc);
+    }
+}
+
 static OMX_ERRORTYPE
 dispatch_exe_or_pause_to_idle (tiz_prc_t * ap_prc, bool * ap_done)
 {
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_done);
   *ap_done = true;
-  return tiz_srv_stop_and_return (ap_prc);
+  rc = tiz_srv_stop_and_return (ap_prc);
+  /* The kernel has already been stopped at this point, and the processor is
+     done with its per-track data */
+  release_arena (ap_prc);
+  return rc;
 }
 
 static OMX_ERRORTYPE
@@ -0,0 +1,383 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizschedtrace.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - scheduler latency histograms and tracing
+ *
+ * Both features are configured in the [ilcore] section of tizonia.conf and
+ * are off by default, in which case the scheduler does not even allocate a
+ * trace object.
+ *
+ * The trace file is written in the Chrome trace event format (a JSON array
+ * of events) and can be loaded in chrome://tracing or Perfetto. Each
+ * component gets its own track, named after the component. The closing
+ * bracket of the array is written at exit; both tools also accept files that
+ * have been cut short.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "tizschedtrace.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.schedtrace"
+#endif
+
+struct tiz_sched_trace
+{
+  char cname[OMX_MAX_STRINGNAME_SIZE];
+  OMX_U32 track;
+  tiz_sched_hist_t hists[ETIZSchedHistMax];
+};
+
+typedef struct tiz_sched_trace_cfg tiz_sched_trace_cfg_t;
+struct tiz_sched_trace_cfg
+{
+  bool hists_enabled;
+  FILE * p_file;      /* NULL unless the trace file is enabled */
+  tiz_mutex_t mutex;  /* Protects the fields below */
+  bool first_event;
+  OMX_U32 next_track;
+  OMX_U64 next_async_id;
+  int pid;
+};
+
+static pthread_once_t g_trace_once = PTHREAD_ONCE_INIT;
+static tiz_sched_trace_cfg_t g_trace_cfg;
+
+static const char * tiz_sched_hist_names[ETIZSchedHistMax] = {
+  "queue wait", "fsm tick", "ker tick", "prc tick", "callback",
+};
+
+static void
+close_trace_file (void)
+{
+  tiz_sched_trace_cfg_t * p_cfg = &g_trace_cfg;
+  (void) tiz_mutex_lock (&(p_cfg->mutex));
+  if (p_cfg->p_file)
+    {
+      fputs ("\n]\n", p_cfg->p_file);
+      fclose (p_cfg->p_file);
+      p_cfg->p_file = NULL;
+    }
+  (void) tiz_mutex_unlock (&(p_cfg->mutex));
+}
+
+static void
+init_trace_cfg (void)
+{
+  tiz_sched_trace_cfg_t * p_cfg = &g_trace_cfg;
+  const char * p_hists
+    = tiz_rcfile_get_value ("ilcore", "scheduler-histograms");
+  const char * p_path
+    = tiz_rcfile_get_value ("ilcore", "scheduler-trace-file");
+
+  (void) tiz_mem_set (p_cfg, 0, sizeof (tiz_sched_trace_cfg_t));
+  p_cfg->hists_enabled = (p_hists && 0 == strncmp (p_hists, "true", 4));
+  p_cfg->first_event = true;
+  p_cfg->pid = (int) getpid ();
+
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_cfg->mutex)))
+    {
+      p_cfg->hists_enabled = false;
+      return;
+    }
+
+  if (p_path && strlen (p_path) > 0)
+    {
+      if ((p_cfg->p_file = fopen (p_path, "w")))
+        {
+          fputs ("[\n", p_cfg->p_file);
+          (void) atexit (close_trace_file);
+        }
+      else
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to open trace file [%s]",
+                   p_path);
+        }
+    }
+}
+
+static inline tiz_sched_trace_cfg_t *
+get_trace_cfg (void)
+{
+  (void) pthread_once (&g_trace_once, init_trace_cfg);
+  return &g_trace_cfg;
+}
+
+/* Must be called with the mutex locked */
+static void
+write_event_prefix (tiz_sched_trace_cfg_t * ap_cfg)
+{
+  assert (ap_cfg);
+  assert (ap_cfg->p_file);
+  if (!ap_cfg->first_event)
+    {
+      fputs (",\n", ap_cfg->p_file);
+    }
+  ap_cfg->first_event = false;
+}
+
+static void
+write_complete_event (tiz_sched_trace_t * ap_trace, const char * ap_name,
+                      const char * ap_cat, const OMX_U64 a_start,
+                      const OMX_U32 a_dur)
+{
+  tiz_sched_trace_cfg_t * p_cfg = &g_trace_cfg;
+  (void) tiz_mutex_lock (&(p_cfg->mutex));
+  if (p_cfg->p_file)
+    {
+      write_event_prefix (p_cfg);
+      fprintf (p_cfg->p_file,
+               "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,"
+               "\"dur\":%u,\"pid\":%d,\"tid\":%u}",
+               ap_name, ap_cat, (unsigned long long) a_start,
+               (unsigned) a_dur, p_cfg->pid, (unsigned) ap_trace->track);
+    }
+  (void) tiz_mutex_unlock (&(p_cfg->mutex));
+}
+
+/* Queue waits of consecutive messages overlap without nesting, so they are
+   written as async events, which the viewers lay out in rows of their own */
+static void
+write_async_event (tiz_sched_trace_t * ap_trace, const char * ap_name,
+                   const OMX_U64 a_start, const OMX_U32 a_dur)
+{
+  tiz_sched_trace_cfg_t * p_cfg = &g_trace_cfg;
+  (void) tiz_mutex_lock (&(p_cfg->mutex));
+  if (p_cfg->p_file)
+    {
+      const unsigned long long id = p_cfg->next_async_id++;
+      write_event_prefix (p_cfg);
+      fprintf (p_cfg->p_file,
+               "{\"name\":\"%s\",\"cat\":\"queue\",\"ph\":\"b\",\"ts\":%llu,"
+               "\"id\":%llu,\"pid\":%d,\"tid\":%u},\n"
+               "{\"name\":\"%s\",\"cat\":\"queue\",\"ph\":\"e\",\"ts\":%llu,"
+               "\"id\":%llu,\"pid\":%d,\"tid\":%u}",
+               ap_name, (unsigned long long) a_start, id, p_cfg->pid,
+               (unsigned) ap_trace->track, ap_name,
+               (unsigned long long) a_start + a_dur, id, p_cfg->pid,
+               (unsigned) ap_trace->track);
+    }
+  (void) tiz_mutex_unlock (&(p_cfg->mutex));
+}
+
+OMX_U32
+tiz_sched_hist_bucket_index (const OMX_U32 a_usec)
+{
+  /* OMX_U32 may be wider than 32 bits; larger values go to the last bucket */
+  const unsigned int usec = MIN (a_usec, UINT_MAX);
+  OMX_U32 shift = 0;
+  if (usec < TIZ_SCHED_HIST_SUB_BUCKETS)
+    {
+      return usec;
+    }
+  shift = (31 - __builtin_clz (usec)) - TIZ_SCHED_HIST_SUB_BITS;
+  return (shift + 1) * TIZ_SCHED_HIST_SUB_BUCKETS
+         + ((usec >> shift) - TIZ_SCHED_HIST_SUB_BUCKETS);
+}
+
+OMX_U32
+tiz_sched_hist_bucket_upper_bound (const OMX_U32 a_index)
+{
+  OMX_U32 shift = 0;
+  OMX_U64 sub = 0;
+  if (a_index < TIZ_SCHED_HIST_SUB_BUCKETS)
+    {
+      return a_index;
+    }
+  shift = a_index / TIZ_SCHED_HIST_SUB_BUCKETS - 1;
+  sub = a_index % TIZ_SCHED_HIST_SUB_BUCKETS + TIZ_SCHED_HIST_SUB_BUCKETS;
+  return (OMX_U32) (((sub + 1) << shift) - 1);
+}
+
+void
+tiz_sched_hist_record (tiz_sched_hist_t * ap_hist, const OMX_U32 a_usec)
+{
+  const OMX_U32 idx = tiz_sched_hist_bucket_index (a_usec);
+  assert (ap_hist);
+  assert (idx < TIZ_SCHED_HIST_BUCKETS);
+  ap_hist->buckets[idx]++;
+  ap_hist->count++;
+  ap_hist->total += a_usec;
+  ap_hist->max = MAX (ap_hist->max, a_usec);
+}
+
+OMX_U32
+tiz_sched_hist_percentile (const tiz_sched_hist_t * ap_hist,
+                           const double a_pct)
+{
+  OMX_U64 target = 0;
+  OMX_U64 seen = 0;
+  OMX_U32 i = 0;
+
+  assert (ap_hist);
+
+  if (0 == ap_hist->count)
+    {
+      return 0;
+    }
+
+  target = (OMX_U64) (ap_hist->count * a_pct / 100.0 + 0.5);
+  target = MAX (target, 1);
+  for (i = 0; i < TIZ_SCHED_HIST_BUCKETS; ++i)
+    {
+      seen += ap_hist->buckets[i];
+      if (seen >= target)
+        {
+          return MIN (tiz_sched_hist_bucket_upper_bound (i), ap_hist->max);
+        }
+    }
+  return ap_hist->max;
+}
+
+tiz_sched_trace_t *
+tiz_sched_trace_init (const char * ap_cname)
+{
+  tiz_sched_trace_cfg_t * p_cfg = get_trace_cfg ();
+  tiz_sched_trace_t * p_trace = NULL;
+
+  assert (ap_cname);
+
+  if (!p_cfg->hists_enabled && !p_cfg->p_file)
+    {
+      return NULL;
+    }
+
+  if ((p_trace = tiz_mem_calloc (1, sizeof (tiz_sched_trace_t))))
+    {
+      strncpy (p_trace->cname, ap_cname, OMX_MAX_STRINGNAME_SIZE - 1);
+      (void) tiz_mutex_lock (&(p_cfg->mutex));
+      p_trace->track = ++p_cfg->next_track;
+      if (p_cfg->p_file)
+        {
+          /* Name the component's track */
+          write_event_prefix (p_cfg);
+          fprintf (p_cfg->p_file,
+                   "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                   "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                   p_cfg->pid, (unsigned) p_trace->track, p_trace->cname);
+        }
+      (void) tiz_mutex_unlock (&(p_cfg->mutex));
+    }
+
+  return p_trace;
+}
+
+void
+tiz_sched_trace_destroy (tiz_sched_trace_t * ap_trace)
+{
+  tiz_sched_trace_cfg_t * p_cfg = get_trace_cfg ();
+  OMX_U32 i = 0;
+
+  if (!ap_trace)
+    {
+      return;
+    }
+
+  for (i = 0; i < ETIZSchedHistMax; ++i)
+    {
+      const tiz_sched_hist_t * p_hist = &(ap_trace->hists[i]);
+      const unsigned p50 = tiz_sched_hist_percentile (p_hist, 50.0);
+      const unsigned p90 = tiz_sched_hist_percentile (p_hist, 90.0);
+      const unsigned p99 = tiz_sched_hist_percentile (p_hist, 99.0);
+      const unsigned p999 = tiz_sched_hist_percentile (p_hist, 99.9);
+      const unsigned max = p_hist->max;
+      const unsigned long long avg
+        = p_hist->count ? p_hist->total / p_hist->count : 0;
+
+      if (0 == p_hist->count)
+        {
+          continue;
+        }
+
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "[%s] %s : count [%llu] avg [%llu] p50 [%u] p90 [%u] "
+               "p99 [%u] p99.9 [%u] max [%u] (usecs)",
+               ap_trace->cname, tiz_sched_hist_names[i],
+               (unsigned long long) p_hist->count, avg, p50, p90, p99, p999,
+               max);
+
+      (void) tiz_mutex_lock (&(p_cfg->mutex));
+      if (p_cfg->p_file)
+        {
+          write_event_prefix (p_cfg);
+          fprintf (p_cfg->p_file,
+                   "{\"name\":\"%s histogram\",\"cat\":\"histogram\","
+                   "\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":%d,"
+                   "\"tid\":%u,\"args\":{\"count\":%llu,\"avg\":%llu,"
+                   "\"p50\":%u,\"p90\":%u,\"p99\":%u,\"p999\":%u,"
+                   "\"max\":%u}}",
+                   tiz_sched_hist_names[i],
+                   (unsigned long long) tiz_monotonic_usec (), p_cfg->pid,
+                   (unsigned) ap_trace->track,
+                   (unsigned long long) p_hist->count, avg, p50, p90, p99,
+                   p999, max);
+          fflush (p_cfg->p_file);
+        }
+      (void) tiz_mutex_unlock (&(p_cfg->mutex));
+    }
+
+  tiz_mem_free (ap_trace);
+}
+
+void
+tiz_sched_trace_record (tiz_sched_trace_t * ap_trace,
+                        const tiz_sched_hist_id_t a_hist, const char * ap_name,
+                        const OMX_U64 a_start, const OMX_U32 a_dur)
+{
+  assert (ap_trace);
+  assert (a_hist < ETIZSchedHistMax);
+  assert (ap_name);
+
+  if (g_trace_cfg.hists_enabled)
+    {
+      tiz_sched_hist_record (&(ap_trace->hists[a_hist]), a_dur);
+    }
+
+  if (g_trace_cfg.p_file)
+    {
+      if (ETIZSchedHistQueueWait == a_hist)
+        {
+          write_async_event (ap_trace, ap_name, a_start, a_dur);
+        }
+      else
+        {
+          write_complete_event (ap_trace, ap_name,
+                                tiz_sched_hist_names[a_hist], a_start, a_dur);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizschedtrace.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - scheduler latency histograms and tracing
+ *
+ *
+ */
+
+#ifndef TIZSCHEDTRACE_H
+#define TIZSCHEDTRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Types.h>
+
+/* Histograms have 2^TIZ_SCHED_HIST_SUB_BITS linear sub-buckets per power of
+   two, i.e. values are recorded with a relative error below 12.5%. */
+#define TIZ_SCHED_HIST_SUB_BITS 3
+#define TIZ_SCHED_HIST_SUB_BUCKETS (1 << TIZ_SCHED_HIST_SUB_BITS)
+#define TIZ_SCHED_HIST_BUCKETS \
+  ((32 - TIZ_SCHED_HIST_SUB_BITS + 1) * TIZ_SCHED_HIST_SUB_BUCKETS)
+
+typedef enum tiz_sched_hist_id tiz_sched_hist_id_t;
+enum tiz_sched_hist_id
+{
+  ETIZSchedHistQueueWait = 0, /* From sending a message to dispatching it */
+  ETIZSchedHistTickFsm,       /* Duration of an fsm servant tick */
+  ETIZSchedHistTickKer,       /* Duration of a kernel servant tick */
+  ETIZSchedHistTickPrc,       /* Duration of a processor servant tick */
+  ETIZSchedHistCallback,      /* Duration of an IL callback or tunnel call */
+  ETIZSchedHistMax
+};
+
+typedef struct tiz_sched_hist tiz_sched_hist_t;
+struct tiz_sched_hist
+{
+  OMX_U64 count;
+  OMX_U64 total;
+  OMX_U32 max;
+  OMX_U32 buckets[TIZ_SCHED_HIST_BUCKETS];
+};
+
+typedef struct tiz_sched_trace tiz_sched_trace_t;
+
+/* Returns NULL unless histograms or the trace file have been enabled in
+   tizonia.conf. */
+tiz_sched_trace_t *
+tiz_sched_trace_init (const char * ap_cname);
+
+/* Logs the component's histograms and frees the object. */
+void
+tiz_sched_trace_destroy (tiz_sched_trace_t * ap_trace);
+
+/* Values below TIZ_SCHED_HIST_SUB_BUCKETS get a bucket each; above that,
+   every power of two is split into TIZ_SCHED_HIST_SUB_BUCKETS buckets. */
+OMX_U32
+tiz_sched_hist_bucket_index (const OMX_U32 a_usec);
+
+/* Returns the largest value that falls in bucket a_index. */
+OMX_U32
+tiz_sched_hist_bucket_upper_bound (const OMX_U32 a_index);
+
+void
+tiz_sched_hist_record (tiz_sched_hist_t * ap_hist, const OMX_U32 a_usec);
+
+/* Returns the upper bound of the bucket that contains the requested
+   percentile (0-100). */
+OMX_U32
+tiz_sched_hist_percentile (const tiz_sched_hist_t * ap_hist,
+                           const double a_pct);
+
+/* Records a duration in one of the histograms and, if the trace file is
+   enabled, emits a complete event for it. */
+void
+tiz_sched_trace_record (tiz_sched_trace_t * ap_trace,
+                        const tiz_sched_hist_id_t a_hist, const char * ap_name,
+                        const OMX_U64 a_start, const OMX_U32 a_dur);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSCHEDTRACE_H */
@@ -31,7 +31,10 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <OMX_Core.h>
 #include <OMX_Component.h>
@@ -47,6 +50,7 @@
 #include "tizport.h"
 #include "tizobjsys.h"
 #include "tizscheduler.h"
+#include "tizschedtrace.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -55,6 +59,9 @@
 
 #define SCHED_OMX_DEFAULT_ROLE "default"
 #define SCHED_QUEUE_MAX_ITEMS 30
+#define SCHED_POOL_MAX_THREADS 64
+#define SCHED_POOL_MAX_COMPONENTS 512
+#define SCHED_POOL_STALL_USEC 100000
 
 #ifndef S_SPLINT_S
 #define TIZ_COMP_INIT_MSG(hdl, msg, msgtype)         \
@@ -122,6 +129,23 @@ struct tiz_srv_group
   OMX_COMPONENTTYPE * p_hdl;
 };
 
+/* Message and servant timing counters, reported through the
+   OMX_TizoniaIndexConfigBufferFlowStats extension. Only the scheduler's
+   thread updates them. */
+typedef struct tiz_sched_stats tiz_sched_stats_t;
+struct tiz_sched_stats
+{
+  OMX_U64 nmsgs;
+  OMX_U64 latency;
+  OMX_U32 latency_max;
+  OMX_U32 queue_depth_max;
+  OMX_U64 nticks;
+  OMX_U64 tick_time;
+  OMX_U32 tick_time_max;
+};
+
+typedef struct tiz_sched_pool tiz_sched_pool_t;
+
 typedef struct tiz_scheduler tiz_scheduler_t;
 struct tiz_scheduler
 {
@@ -134,6 +158,7 @@ struct tiz_scheduler
   tiz_sem_t sem;
   tiz_queue_t * p_queue;
   tiz_soa_t * p_soa;
+  tiz_arena_t * p_arena;
   tiz_os_t * p_objsys;
   OMX_S32 error;
   tiz_srv_group_t child;
@@ -142,8 +167,81 @@ struct tiz_scheduler
   appdata; /* For use during setting of the component callbacks, not owned */
   OMX_CALLBACKTYPE *
     cbacks; /* For use during setting of the component callbacks, not owned */
+  OMX_BOOL pooled; /* OMX_TRUE if run by the shared worker pool */
+  tiz_sched_pool_t * p_pool; /* The pool, if pooled, not owned */
+  OMX_U32 home;    /* The pool worker whose run queue this scheduler goes to;
+                      protected by the pool mutex */
+  OMX_BOOL queued; /* OMX_TRUE while in a run queue or running in a pool
+                      worker; protected by the pool mutex */
+  tiz_sched_stats_t stats;
+  tiz_sched_trace_t * p_trace; /* NULL unless histograms or tracing are
+                                  enabled in tizonia.conf */
+};
+
+/* When the 'scheduler-pool-threads' key in tizonia.conf (or the
+   TIZONIA_SCHEDULER_POOL_THREADS environment variable) is set to a non-zero
+   value, components do not get a thread each. Instead, a pool of worker
+   threads runs the component schedulers as tasks. A worker dispatches a
+   scheduler's messages and runs its servants until idle. A scheduler is never
+   run by two workers at the same time.
+
+   - Each worker has its own run queue. A scheduler with pending messages goes
+     into the run queue of its 'home' worker. A worker with an empty run queue
+     steals from the back of the longest one.
+   - Two components in a tunnel are given the same home worker, so that the
+     buffers they exchange usually stay on one thread (and, with
+     'scheduler-pool-pin-threads', on one cpu).
+   - A worker that is about to block (an IL call into another component, or a
+     send to a full message queue) says so. When every worker is blocked, or
+     has been running the same scheduler for longer than
+     SCHED_POOL_STALL_USEC while there is work waiting, another worker is
+     started, up to SCHED_POOL_MAX_THREADS.
+   - Components configured with 'sched_policy', 'cpu_affinity' or
+     'dedicated_thread' keep a thread of their own.
+   - The pool is created along with the first pooled component and torn down
+     with the last one.
+
+   The run queues, the worker state and the scheduler's 'home' and 'queued'
+   fields are all protected by the pool mutex. */
+typedef struct tiz_sched_worker tiz_sched_worker_t;
+struct tiz_sched_worker
+{
+  tiz_sched_pool_t * p_pool;
+  OMX_U32 id;
+  tiz_thread_t thread;
+  tiz_cond_t cond;
+  OMX_BOOL waiting; /* OMX_TRUE while idle; cleared by whoever wakes it */
+  OMX_BOOL blocked; /* OMX_TRUE while blocked inside an IL call */
+  tiz_scheduler_t * p_running;
+  OMX_U64 running_since_us;
+  tiz_scheduler_t * ready[SCHED_POOL_MAX_COMPONENTS]; /* run queue (ring) */
+  OMX_U32 head;
+  OMX_U32 count;
 };
 
+struct tiz_sched_pool
+{
+  tiz_sched_worker_t * workers[SCHED_POOL_MAX_THREADS];
+  OMX_U32 nworkers; /* workers started */
+  OMX_U32 nhomes;   /* workers that schedulers are homed on */
+  OMX_U32 nidle;
+  OMX_U32 nblocked;
+  OMX_U32 nscheds; /* pooled schedulers alive */
+  OMX_U32 next_home;
+  long ncpus; /* pin worker i to cpu i % ncpus, if > 0 */
+  OMX_BOOL stopping;
+  tiz_mutex_t mutex;
+  tiz_cond_t released_cond;
+};
+
+/* Serialises the creation and teardown of the pool */
+static pthread_mutex_t g_sched_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static tiz_sched_pool_t * gp_sched_pool = NULL;
+/* Identifies the pool worker running on the calling thread, if any */
+static pthread_once_t g_sched_pool_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_sched_pool_key;
+static bool g_sched_pool_key_ok = false;
+
 typedef enum tiz_sched_msg_class tiz_sched_msg_class_t;
 enum tiz_sched_msg_class
 {
@@ -175,6 +273,7 @@ enum tiz_sched_msg_class
   ETIZSchedMsgEvIo,
   ETIZSchedMsgEvTimer,
   ETIZSchedMsgEvStat,
+  ETIZSchedMsgEmptyFillBuffers,
   ETIZSchedMsgMax,
 };
 
@@ -273,6 +372,17 @@ struct tiz_sched_msg_emptyfillbuffer
   OMX_BUFFERHEADERTYPE * p_hdr;
 };
 
+/* A batch of headers delivered with a single message; 'dir' is the direction
+   of the receiving ports (OMX_DirInput means EmptyThisBuffer). The array is
+   allocated with the message, and freed when the message is processed */
+typedef struct tiz_sched_msg_emptyfillbuffers tiz_sched_msg_emptyfillbuffers_t;
+struct tiz_sched_msg_emptyfillbuffers
+{
+  OMX_DIRTYPE dir;
+  OMX_U32 nhdrs;
+  OMX_BUFFERHEADERTYPE ** pp_hdrs;
+};
+
 typedef struct tiz_sched_msg_tunnelrequest tiz_sched_msg_tunnelrequest_t;
 struct tiz_sched_msg_tunnelrequest
 {
@@ -356,6 +466,7 @@ struct tiz_sched_msg
   OMX_BOOL will_block;
   OMX_BOOL may_block;
   tiz_sched_msg_class_t class;
+  OMX_U64 sent_us; /* time of sending, or zero */
   union
   {
     tiz_sched_msg_getcomponentversion_t gcv;
@@ -370,6 +481,7 @@ struct tiz_sched_msg
     tiz_sched_msg_allocbuffer_t ab;
     tiz_sched_msg_freebuffer_t fb;
     tiz_sched_msg_emptyfillbuffer_t efb;
+    tiz_sched_msg_emptyfillbuffers_t efbs;
     tiz_sched_msg_tunnelrequest_t tr;
     tiz_sched_msg_plg_event_t pe;
     tiz_sched_msg_regroles_t rr;
@@ -440,6 +552,8 @@ static OMX_ERRORTYPE
 do_etmr (tiz_scheduler_t *, tiz_sched_state_t *, tiz_sched_msg_t *);
 static OMX_ERRORTYPE
 do_estat (tiz_scheduler_t *, tiz_sched_state_t *, tiz_sched_msg_t *);
+static OMX_ERRORTYPE
+do_efbs (tiz_scheduler_t *, tiz_sched_state_t *, tiz_sched_msg_t *);
 
 static OMX_ERRORTYPE
 init_servants (tiz_scheduler_t *, tiz_sched_msg_t *);
@@ -454,6 +568,20 @@ start_scheduler (tiz_scheduler_t *);
 static void
 delete_scheduler (tiz_scheduler_t *);
 static OMX_ERRORTYPE
+pool_schedule (tiz_scheduler_t *);
+static tiz_sched_worker_t *
+current_pool_worker (void);
+static void
+pool_enter_blocking (tiz_sched_worker_t *);
+static void
+pool_leave_blocking (tiz_sched_worker_t *);
+static void
+pool_share_home (tiz_scheduler_t *, OMX_HANDLETYPE);
+static const char *
+get_comp_rc_value (tiz_scheduler_t *, const char *);
+static OMX_ERRORTYPE
+sched_ComponentDeInit (OMX_HANDLETYPE);
+static OMX_ERRORTYPE
 restore_hooks (tiz_scheduler_t * ap_sched, const OMX_U32 a_role_pos);
 static void
 delete_hooks (tiz_scheduler_t * ap_sched, tiz_map_t * ap_map);
@@ -466,6 +594,7 @@ static const tiz_sched_msg_dispatch_f tiz_sched_msg_to_fnt_tbl[] = {
   do_sconfig, do_gei,    do_gs,    do_tr,   do_ub,     do_ab,     do_fb,
   do_etb,     do_ftb,    do_scbs,  do_uei,  do_cre,    do_plgevt, do_rr,
   do_rt,      do_rph,    do_reh,   do_rreh, do_eio,    do_etmr,   do_estat,
+  do_efbs,
 };
 
 static OMX_BOOL
@@ -509,6 +638,7 @@ static tiz_sched_msg_str_t tiz_sched_msg_to_str_tbl[] = {
   {ETIZSchedMsgEvIo, "{ETIZSchedMsgEvIo,"},
   {ETIZSchedMsgEvTimer, "ETIZSchedMsgEvTimer"},
   {ETIZSchedMsgEvStat, "ETIZSchedMsgEvStat"},
+  {ETIZSchedMsgEmptyFillBuffers, "ETIZSchedMsgEmptyFillBuffers"},
   {ETIZSchedMsgMax, "ETIZSchedMsgMax"},
 };
 
@@ -569,6 +699,11 @@ static OMX_BOOL tiz_sched_blocking_apis_tbl[] = {
   OMX_FALSE,    /* ETIZSchedMsgEvIo */
   OMX_FALSE,    /* ETIZSchedMsgEvTimer */
   OMX_FALSE,    /* ETIZSchedMsgEvStat */
+#ifdef EFB_FTB_SHOULD_BLOCK
+  OMX_TRUE, /* ETIZSchedMsgEmptyFillBuffers */
+#else
+  OMX_FALSE, /* ETIZSchedMsgEmptyFillBuffers */
+#endif
   OMX_BOOL_MAX, /* ETIZSchedMsgMax */
 };
 
@@ -765,14 +900,56 @@ store_hooks (tiz_map_t ** app_map, OMX_U32 a_pid, const void * ap_hooks,
   return rc;
 }
 
+static OMX_ERRORTYPE
+queue_msg (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg,
+           tiz_sched_worker_t * ap_worker)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (ap_sched);
+  assert (ap_msg);
+
+  if (!ap_worker)
+    {
+      return tiz_queue_send (ap_sched->p_queue, ap_msg);
+    }
+
+  /* A pool worker must not block on a full queue without telling the pool;
+     the scheduler that drains it may be waiting for a worker */
+  rc = tiz_queue_try_send (ap_sched->p_queue, ap_msg);
+  if (OMX_ErrorOverflow == rc)
+    {
+      pool_enter_blocking (ap_worker);
+      rc = tiz_queue_send (ap_sched->p_queue, ap_msg);
+      pool_leave_blocking (ap_worker);
+    }
+  return rc;
+}
+
 static inline OMX_ERRORTYPE
 send_msg_blocking (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
 {
+  tiz_sched_worker_t * p_worker = current_pool_worker ();
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_msg);
   assert (ap_sched);
+  ap_msg->sent_us = tiz_monotonic_usec ();
   ap_msg->will_block = OMX_TRUE;
-  tiz_check_omx_ret_oom (tiz_queue_send (ap_sched->p_queue, ap_msg));
-  tiz_check_omx_ret_oom (tiz_sem_wait (&(ap_sched->sem)));
+  tiz_check_omx_ret_oom (queue_msg (ap_sched, ap_msg, p_worker));
+  if (ap_sched->pooled)
+    {
+      tiz_check_omx_ret_oom (pool_schedule (ap_sched));
+    }
+  if (p_worker)
+    {
+      pool_enter_blocking (p_worker);
+    }
+  rc = tiz_sem_wait (&(ap_sched->sem));
+  if (p_worker)
+    {
+      pool_leave_blocking (p_worker);
+    }
+  tiz_check_omx_ret_oom (rc);
   return ap_sched->error;
 }
 
@@ -781,8 +958,10 @@ send_msg_non_blocking (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
 {
   assert (ap_msg);
   assert (ap_sched);
+  ap_msg->sent_us = tiz_monotonic_usec ();
   ap_msg->will_block = OMX_FALSE;
-  return tiz_queue_send (ap_sched->p_queue, ap_msg);
+  tiz_check_omx_ret_oom (queue_msg (ap_sched, ap_msg, current_pool_worker ()));
+  return ap_sched->pooled ? pool_schedule (ap_sched) : OMX_ErrorNone;
 }
 
 static inline OMX_ERRORTYPE
@@ -1013,6 +1192,7 @@ do_gconfig (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
             tiz_sched_msg_t * ap_msg)
 {
   tiz_sched_msg_setget_paramconfig_t * p_msg_gconfig = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
 
   assert (ap_sched);
   assert (ap_msg);
@@ -1020,8 +1200,25 @@ do_gconfig (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
   p_msg_gconfig = &(ap_msg->sgpc);
   assert (p_msg_gconfig);
 
-  return tiz_api_GetConfig (ap_sched->child.p_fsm, ap_msg->p_hdl,
-                            p_msg_gconfig->index, p_msg_gconfig->p_struct);
+  rc = tiz_api_GetConfig (ap_sched->child.p_fsm, ap_msg->p_hdl,
+                          p_msg_gconfig->index, p_msg_gconfig->p_struct);
+
+  if (OMX_ErrorNone == rc
+      && OMX_TizoniaIndexConfigBufferFlowStats == p_msg_gconfig->index)
+    {
+      /* The port has filled in its own counters; add the scheduler's */
+      OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE * p_stats
+        = (OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE *) p_msg_gconfig->p_struct;
+      p_stats->nSchedMessages = ap_sched->stats.nmsgs;
+      p_stats->nSchedLatency = ap_sched->stats.latency;
+      p_stats->nSchedLatencyMax = ap_sched->stats.latency_max;
+      p_stats->nSchedQueueDepthMax = ap_sched->stats.queue_depth_max;
+      p_stats->nTicks = ap_sched->stats.nticks;
+      p_stats->nTickTime = ap_sched->stats.tick_time;
+      p_stats->nTickTimeMax = ap_sched->stats.tick_time_max;
+    }
+
+  return rc;
 }
 
 static OMX_ERRORTYPE
@@ -1044,7 +1241,7 @@ do_sconfig (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
      non-blocking */
   if (OMX_FALSE == tiz_sched_blocking_apis_tbl[ETIZSchedMsgSetConfig])
     {
-      tiz_mem_free (p_msg_sconfig->p_struct);
+      tiz_slab_free (p_msg_sconfig->p_struct);
       p_msg_sconfig->p_struct = NULL;
     }
 
@@ -1089,6 +1286,7 @@ do_tr (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
        tiz_sched_msg_t * ap_msg)
 {
   tiz_sched_msg_tunnelrequest_t * p_msg_tr = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
 
   assert (ap_sched);
   assert (ap_msg);
@@ -1096,9 +1294,14 @@ do_tr (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
   p_msg_tr = &(ap_msg->tr);
   assert (p_msg_tr);
 
-  return tiz_api_ComponentTunnelRequest (ap_sched->child.p_fsm, ap_msg->p_hdl,
-                                         p_msg_tr->pid, p_msg_tr->p_thdl,
-                                         p_msg_tr->tpid, p_msg_tr->p_tsetup);
+  rc = tiz_api_ComponentTunnelRequest (ap_sched->child.p_fsm, ap_msg->p_hdl,
+                                       p_msg_tr->pid, p_msg_tr->p_thdl,
+                                       p_msg_tr->tpid, p_msg_tr->p_tsetup);
+  if (OMX_ErrorNone == rc && p_msg_tr->p_thdl)
+    {
+      pool_share_home (ap_sched, p_msg_tr->p_thdl);
+    }
+  return rc;
 }
 
 static OMX_ERRORTYPE
@@ -1183,6 +1386,45 @@ do_ftb (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
                                  p_msg_efb->p_hdr);
 }
 
+static OMX_ERRORTYPE
+do_efbs (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
+         tiz_sched_msg_t * ap_msg)
+{
+  tiz_sched_msg_emptyfillbuffers_t * p_msg_efbs = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_ERRORTYPE hdr_rc = OMX_ErrorNone;
+  OMX_U32 i = 0;
+
+  assert (ap_sched);
+  assert (ap_msg);
+  assert (ap_state && ETIZSchedStateStarted == *ap_state);
+  p_msg_efbs = &(ap_msg->efbs);
+  assert (p_msg_efbs);
+  assert (p_msg_efbs->pp_hdrs);
+
+  /* Hand all the headers to the fsm before the servants get to run, so that
+     the kernel finds the whole batch in its queue */
+  for (i = 0; i < p_msg_efbs->nhdrs; ++i)
+    {
+      hdr_rc = (OMX_DirInput == p_msg_efbs->dir
+                  ? tiz_api_EmptyThisBuffer (ap_sched->child.p_fsm,
+                                             ap_msg->p_hdl,
+                                             p_msg_efbs->pp_hdrs[i])
+                  : tiz_api_FillThisBuffer (ap_sched->child.p_fsm,
+                                            ap_msg->p_hdl,
+                                            p_msg_efbs->pp_hdrs[i]));
+      if (OMX_ErrorNone == rc)
+        {
+          rc = hdr_rc;
+        }
+    }
+
+  tiz_slab_free (p_msg_efbs->pp_hdrs);
+  p_msg_efbs->pp_hdrs = NULL;
+
+  return rc;
+}
+
 static OMX_ERRORTYPE
 do_scbs (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
          tiz_sched_msg_t * ap_msg)
@@ -1668,8 +1910,10 @@ init_scheduler_message (OMX_HANDLETYPE ap_hdl,
   assert (ap_hdl);
   assert (a_msg_class < ETIZSchedMsgMax);
 
+  /* Messages are created on the client's thread and deleted on the
+     component's thread */
   if (!(p_msg
-        = (tiz_sched_msg_t *) tiz_mem_calloc (1, sizeof (tiz_sched_msg_t))))
+        = (tiz_sched_msg_t *) tiz_slab_calloc (sizeof (tiz_sched_msg_t))))
     {
       TIZ_ERROR (ap_hdl,
                  "[OMX_ErrorInsufficientResources] : "
@@ -1946,9 +2190,9 @@ sched_SetConfig (OMX_HANDLETYPE ap_hdl, OMX_INDEXTYPE a_index,
   if (OMX_FALSE == tiz_sched_blocking_apis_tbl[ETIZSchedMsgSetConfig])
     {
       if (!(p_msg_sconf->p_struct
-            = tiz_mem_calloc (1, (*(OMX_U32 *) ap_struct))))
+            = tiz_slab_calloc ((*(OMX_U32 *) ap_struct))))
         {
-          tiz_mem_free (p_msg);
+          tiz_slab_free (p_msg);
           TIZ_ERROR (ap_hdl,
                      "[OMX_ErrorInsufficientResources] : "
                      "(While allocating memory for config struct)");
@@ -2302,6 +2546,51 @@ sched_ComponentRoleEnum (OMX_HANDLETYPE ap_hdl, OMX_U8 * ap_role,
   return send_msg (p_sched, p_msg);
 }
 
+static void
+update_msg_stats (tiz_scheduler_t * ap_sched, const tiz_sched_msg_t * ap_msg)
+{
+  tiz_sched_stats_t * p_stats = &(ap_sched->stats);
+  const OMX_U64 now = tiz_monotonic_usec ();
+  const OMX_U32 latency
+    = now > ap_msg->sent_us ? (OMX_U32) (now - ap_msg->sent_us) : 0;
+  /* The message being dispatched has already been removed from the queue */
+  const OMX_U32 depth = tiz_queue_length (ap_sched->p_queue) + 1;
+
+  p_stats->nmsgs++;
+  p_stats->latency += latency;
+  p_stats->latency_max = MAX (p_stats->latency_max, latency);
+  p_stats->queue_depth_max = MAX (p_stats->queue_depth_max, depth);
+
+  if (ap_sched->p_trace)
+    {
+      tiz_sched_trace_record (ap_sched->p_trace, ETIZSchedHistQueueWait,
+                              tiz_sched_msg_to_str (ap_msg->class),
+                              ap_msg->sent_us, latency);
+    }
+}
+
+static OMX_ERRORTYPE
+tick_servant (tiz_scheduler_t * ap_sched, void * ap_srv,
+              const tiz_sched_hist_id_t a_hist)
+{
+  tiz_sched_stats_t * p_stats = &(ap_sched->stats);
+  const OMX_U64 start = tiz_monotonic_usec ();
+  const OMX_ERRORTYPE rc = tiz_srv_tick (ap_srv);
+  const OMX_U32 elapsed = (OMX_U32) (tiz_monotonic_usec () - start);
+
+  p_stats->nticks++;
+  p_stats->tick_time += elapsed;
+  p_stats->tick_time_max = MAX (p_stats->tick_time_max, elapsed);
+
+  if (ap_sched->p_trace)
+    {
+      tiz_sched_trace_record (ap_sched->p_trace, a_hist,
+                              nameOf (ap_srv), start, elapsed);
+    }
+
+  return rc;
+}
+
 static OMX_BOOL
 dispatch_msg (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
               tiz_sched_msg_t * ap_msg)
@@ -2319,12 +2608,17 @@ dispatch_msg (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
 
   signal_client = ap_msg->will_block;
 
+  if (ap_msg->sent_us > 0)
+    {
+      update_msg_stats (ap_sched, ap_msg);
+    }
+
   rc = tiz_sched_msg_to_fnt_tbl[ap_msg->class](ap_sched, ap_state, ap_msg);
 
   /* Return error to client */
   ap_sched->error = rc;
 
-  tiz_mem_free (ap_msg);
+  tiz_slab_free (ap_msg);
 
   return signal_client;
 }
@@ -2359,19 +2653,19 @@ schedule_servants (tiz_scheduler_t * ap_sched, const tiz_sched_state_t ap_state)
       if (tiz_srv_is_ready (ap_sched->child.p_fsm))
         {
           p_ready = ap_sched->child.p_fsm;
-          rc = tiz_srv_tick (p_ready);
+          rc = tick_servant (ap_sched, p_ready, ETIZSchedHistTickFsm);
         }
 
       if (OMX_ErrorNone == rc && tiz_srv_is_ready (ap_sched->child.p_ker))
         {
           p_ready = ap_sched->child.p_ker;
-          rc = tiz_srv_tick (p_ready);
+          rc = tick_servant (ap_sched, p_ready, ETIZSchedHistTickKer);
         }
 
       if (OMX_ErrorNone == rc && tiz_srv_is_ready (ap_sched->child.p_prc))
         {
           p_ready = ap_sched->child.p_prc;
-          rc = tiz_srv_tick (p_ready);
+          rc = tick_servant (ap_sched, p_ready, ETIZSchedHistTickPrc);
         }
 
       if (tiz_queue_length (ap_sched->p_queue) > 0)
@@ -2425,11 +2719,647 @@ il_sched_thread_func (void * p_arg)
   return NULL;
 }
 
+static inline tiz_sched_worker_t *
+current_pool_worker (void)
+{
+  return g_sched_pool_key_ok ? pthread_getspecific (g_sched_pool_key) : NULL;
+}
+
+static inline void
+worker_push (tiz_sched_worker_t * ap_worker, tiz_scheduler_t * ap_sched)
+{
+  assert (ap_worker);
+  assert (ap_worker->count < SCHED_POOL_MAX_COMPONENTS);
+  ap_worker->ready[(ap_worker->head + ap_worker->count)
+                   % SCHED_POOL_MAX_COMPONENTS]
+    = ap_sched;
+  ap_worker->count++;
+}
+
+static inline tiz_scheduler_t *
+worker_pop_front (tiz_sched_worker_t * ap_worker)
+{
+  tiz_scheduler_t * p_sched = NULL;
+  assert (ap_worker);
+  assert (ap_worker->count > 0);
+  p_sched = ap_worker->ready[ap_worker->head];
+  ap_worker->head = (ap_worker->head + 1) % SCHED_POOL_MAX_COMPONENTS;
+  ap_worker->count--;
+  return p_sched;
+}
+
+static inline tiz_scheduler_t *
+worker_pop_back (tiz_sched_worker_t * ap_worker)
+{
+  assert (ap_worker);
+  assert (ap_worker->count > 0);
+  ap_worker->count--;
+  return ap_worker->ready[(ap_worker->head + ap_worker->count)
+                          % SCHED_POOL_MAX_COMPONENTS];
+}
+
+static OMX_BOOL
+pool_has_work (const tiz_sched_pool_t * ap_pool)
+{
+  OMX_U32 i = 0;
+  for (i = 0; i < ap_pool->nworkers; ++i)
+    {
+      if (ap_pool->workers[i]->count > 0)
+        {
+          return OMX_TRUE;
+        }
+    }
+  return OMX_FALSE;
+}
+
+static tiz_scheduler_t *
+pool_take (tiz_sched_pool_t * ap_pool, tiz_sched_worker_t * ap_worker)
+{
+  tiz_sched_worker_t * p_victim = NULL;
+  OMX_U32 i = 0;
+
+  assert (ap_pool);
+  assert (ap_worker);
+
+  if (ap_worker->count > 0)
+    {
+      return worker_pop_front (ap_worker);
+    }
+
+  /* Steal from the back of the longest run queue, leaving the schedulers
+     that have waited the longest to their home worker */
+  for (i = 0; i < ap_pool->nworkers; ++i)
+    {
+      tiz_sched_worker_t * p_other = ap_pool->workers[i];
+      if (p_other != ap_worker && p_other->count > 0
+          && (!p_victim || p_other->count > p_victim->count))
+        {
+          p_victim = p_other;
+        }
+    }
+  return p_victim ? worker_pop_back (p_victim) : NULL;
+}
+
+static void *
+pool_thread_func (void * p_arg);
+
+/* Must be called with the pool mutex held */
+static OMX_ERRORTYPE
+pool_start_worker (tiz_sched_pool_t * ap_pool)
+{
+  tiz_sched_worker_t * p_worker = NULL;
+  char thread_name[16];
+
+  assert (ap_pool);
+
+  if (ap_pool->nworkers >= SCHED_POOL_MAX_THREADS
+      || !(p_worker = tiz_mem_calloc (1, sizeof (tiz_sched_worker_t))))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_worker->p_pool = ap_pool;
+  p_worker->id = ap_pool->nworkers;
+  if (OMX_ErrorNone != tiz_cond_init (&(p_worker->cond)))
+    {
+      tiz_mem_free (p_worker);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if (OMX_ErrorNone
+      != tiz_thread_create (&(p_worker->thread), 0, 0, pool_thread_func,
+                            p_worker))
+    {
+      (void) tiz_cond_destroy (&(p_worker->cond));
+      tiz_mem_free (p_worker);
+      return OMX_ErrorInsufficientResources;
+    }
+  ap_pool->workers[ap_pool->nworkers++] = p_worker;
+
+  (void) snprintf (thread_name, sizeof (thread_name), "tizsched%u",
+                   (unsigned int) p_worker->id);
+  (void) tiz_thread_setname (&(p_worker->thread), thread_name);
+
+  if (ap_pool->ncpus > 0)
+    {
+      char cpu[16];
+      (void) snprintf (cpu, sizeof (cpu), "%ld",
+                       (long) p_worker->id % ap_pool->ncpus);
+      if (OMX_ErrorNone != tiz_thread_setaffinity (&(p_worker->thread), cpu))
+        {
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "Unable to pin scheduler pool thread [%u] to cpu [%s].",
+                   (unsigned int) p_worker->id, cpu);
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
+/* Must be called with the pool mutex held */
+static void
+pool_grow (tiz_sched_pool_t * ap_pool, const char * ap_reason)
+{
+  assert (ap_pool);
+  assert (ap_reason);
+  if (OMX_ErrorNone == pool_start_worker (ap_pool))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "Scheduler pool grown to [%u] threads (%s)",
+               (unsigned int) ap_pool->nworkers, ap_reason);
+    }
+}
+
+/* Must be called with the pool mutex held, when no worker is idle */
+static void
+pool_check_stalls (tiz_sched_pool_t * ap_pool)
+{
+  const OMX_U64 now = tiz_monotonic_usec ();
+  OMX_U32 nstuck = ap_pool->nblocked;
+  OMX_U32 i = 0;
+
+  for (i = 0; i < ap_pool->nworkers; ++i)
+    {
+      const tiz_sched_worker_t * p_worker = ap_pool->workers[i];
+      if (!p_worker->blocked && p_worker->p_running
+          && now - p_worker->running_since_us > SCHED_POOL_STALL_USEC)
+        {
+          ++nstuck;
+        }
+    }
+
+  if (nstuck >= ap_pool->nworkers)
+    {
+      pool_grow (ap_pool, "all threads blocked or busy");
+    }
+}
+
+/* Must be called with the pool mutex held */
+static void
+pool_wake (tiz_sched_pool_t * ap_pool, tiz_sched_worker_t * ap_home)
+{
+  tiz_sched_worker_t * p_worker = ap_home->waiting ? ap_home : NULL;
+  OMX_U32 i = 0;
+
+  /* Prefer the home worker; any other idle worker will steal the work */
+  for (i = 0; !p_worker && i < ap_pool->nworkers; ++i)
+    {
+      if (ap_pool->workers[i]->waiting)
+        {
+          p_worker = ap_pool->workers[i];
+        }
+    }
+
+  if (p_worker)
+    {
+      p_worker->waiting = OMX_FALSE;
+      ap_pool->nidle--;
+      (void) tiz_cond_signal (&(p_worker->cond));
+    }
+  else
+    {
+      pool_check_stalls (ap_pool);
+    }
+}
+
+static OMX_ERRORTYPE
+pool_schedule (tiz_scheduler_t * ap_sched)
+{
+  tiz_sched_pool_t * p_pool = NULL;
+
+  assert (ap_sched);
+  p_pool = ap_sched->p_pool;
+  assert (p_pool);
+
+  tiz_check_omx_ret_oom (tiz_mutex_lock (&(p_pool->mutex)));
+  if (!ap_sched->queued)
+    {
+      tiz_sched_worker_t * p_home = p_pool->workers[ap_sched->home];
+      ap_sched->queued = OMX_TRUE;
+      worker_push (p_home, ap_sched);
+      pool_wake (p_pool, p_home);
+    }
+  tiz_check_omx_ret_oom (tiz_mutex_unlock (&(p_pool->mutex)));
+
+  return OMX_ErrorNone;
+}
+
+static void
+pool_enter_blocking (tiz_sched_worker_t * ap_worker)
+{
+  tiz_sched_pool_t * p_pool = NULL;
+
+  assert (ap_worker);
+  p_pool = ap_worker->p_pool;
+
+  (void) tiz_mutex_lock (&(p_pool->mutex));
+  ap_worker->blocked = OMX_TRUE;
+  p_pool->nblocked++;
+  if (p_pool->nblocked == p_pool->nworkers && pool_has_work (p_pool))
+    {
+      /* Nobody is left to run the scheduler this worker is waiting on */
+      pool_grow (p_pool, "all threads blocked");
+    }
+  (void) tiz_mutex_unlock (&(p_pool->mutex));
+}
+
+static void
+pool_leave_blocking (tiz_sched_worker_t * ap_worker)
+{
+  tiz_sched_pool_t * p_pool = NULL;
+
+  assert (ap_worker);
+  p_pool = ap_worker->p_pool;
+
+  (void) tiz_mutex_lock (&(p_pool->mutex));
+  ap_worker->blocked = OMX_FALSE;
+  p_pool->nblocked--;
+  (void) tiz_mutex_unlock (&(p_pool->mutex));
+}
+
+static void
+pool_share_home (tiz_scheduler_t * ap_sched, OMX_HANDLETYPE ap_peer)
+{
+  tiz_scheduler_t * p_peer = NULL;
+  tiz_sched_pool_t * p_pool = NULL;
+
+  assert (ap_sched);
+  assert (ap_peer);
+
+  /* The peer may be a component of another IL implementation */
+  if (!ap_sched->pooled
+      || sched_ComponentDeInit
+           != ((OMX_COMPONENTTYPE *) ap_peer)->ComponentDeInit)
+    {
+      return;
+    }
+
+  p_peer = get_sched (ap_peer);
+  p_pool = ap_sched->p_pool;
+  if (!p_peer || p_peer->p_pool != p_pool)
+    {
+      return;
+    }
+
+  (void) tiz_mutex_lock (&(p_pool->mutex));
+  ap_sched->home = MIN (ap_sched->home, p_peer->home);
+  p_peer->home = ap_sched->home;
+  (void) tiz_mutex_unlock (&(p_pool->mutex));
+}
+
+static void
+pool_run_scheduler (tiz_scheduler_t * ap_sched)
+{
+  OMX_PTR p_data = NULL;
+  OMX_BOOL signal_client = OMX_FALSE;
+  OMX_S32 nmsgs = 0;
+
+  assert (ap_sched);
+
+  /* Let send_msg detect API calls made from IL callback context */
+  ap_sched->thread_id = tiz_thread_id ();
+
+  /* Process a bounded number of messages, so that a busy component does not
+     starve the others, and run the servants until idle after each one */
+  while (nmsgs++ < SCHED_QUEUE_MAX_ITEMS
+         && tiz_queue_length (ap_sched->p_queue) > 0)
+    {
+      if (OMX_ErrorNone != tiz_queue_receive (ap_sched->p_queue, &p_data))
+        {
+          break;
+        }
+
+      assert (p_data);
+      signal_client = dispatch_msg (ap_sched, &(ap_sched->state),
+                                    (tiz_sched_msg_t *) p_data);
+
+      if (ETIZSchedStateStopped == ap_sched->state)
+        {
+          break;
+        }
+
+      if (OMX_TRUE == signal_client)
+        {
+          (void) tiz_sem_post (&(ap_sched->sem));
+        }
+
+      schedule_servants (ap_sched, ap_sched->state);
+    }
+
+  ap_sched->thread_id = 0;
+
+  if (ETIZSchedStateStopped == ap_sched->state)
+    {
+      /* The client of ComponentDeInit is waiting on the semaphore, and will
+         then wait in delete_scheduler for the 'queued' flag to clear */
+      (void) tiz_sem_post (&(ap_sched->sem));
+    }
+}
+
+/* Must be called with the pool mutex held */
+static void
+pool_release_scheduler (tiz_sched_pool_t * ap_pool,
+                        tiz_sched_worker_t * ap_worker,
+                        tiz_scheduler_t * ap_sched)
+{
+  assert (ap_pool);
+  assert (ap_worker);
+  assert (ap_sched);
+
+  if (ETIZSchedStateStopped == ap_sched->state)
+    {
+      /* This must be the last time this worker touches the scheduler */
+      ap_sched->queued = OMX_FALSE;
+      (void) tiz_cond_broadcast (&(ap_pool->released_cond));
+    }
+  else if (tiz_queue_length (ap_sched->p_queue) > 0)
+    {
+      /* Messages sent while it ran found the 'queued' flag set, so they must
+         be picked up here */
+      tiz_sched_worker_t * p_home = ap_pool->workers[ap_sched->home];
+      worker_push (p_home, ap_sched);
+      if (p_home != ap_worker)
+        {
+          pool_wake (ap_pool, p_home);
+        }
+    }
+  else
+    {
+      ap_sched->queued = OMX_FALSE;
+    }
+}
+
+static void *
+pool_thread_func (void * p_arg)
+{
+  tiz_sched_worker_t * p_worker = (tiz_sched_worker_t *) (p_arg);
+  tiz_sched_pool_t * p_pool = NULL;
+  tiz_scheduler_t * p_sched = NULL;
+
+  assert (p_worker);
+  p_pool = p_worker->p_pool;
+  assert (p_pool);
+
+  (void) pthread_setspecific (g_sched_pool_key, p_worker);
+  (void) tiz_mutex_lock (&(p_pool->mutex));
+  for (;;)
+    {
+      if (!(p_sched = pool_take (p_pool, p_worker)))
+        {
+          if (p_pool->stopping)
+            {
+              break;
+            }
+          p_worker->waiting = OMX_TRUE;
+          p_pool->nidle++;
+          while (p_worker->waiting)
+            {
+              (void) tiz_cond_wait (&(p_worker->cond), &(p_pool->mutex));
+            }
+          continue;
+        }
+
+      p_worker->p_running = p_sched;
+      p_worker->running_since_us = tiz_monotonic_usec ();
+      (void) tiz_mutex_unlock (&(p_pool->mutex));
+
+      pool_run_scheduler (p_sched);
+
+      (void) tiz_mutex_lock (&(p_pool->mutex));
+      p_worker->p_running = NULL;
+      pool_release_scheduler (p_pool, p_worker, p_sched);
+    }
+  (void) tiz_mutex_unlock (&(p_pool->mutex));
+
+  return NULL;
+}
+
+static void
+child_sched_pool_reset (void)
+{
+  /* The workers do not exist in a forked child; forget the parent's pool, so
+     that a new one is created there */
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  memcpy (&g_sched_pool_mutex, &mutex, sizeof (g_sched_pool_mutex));
+  gp_sched_pool = NULL;
+  (void) pthread_setspecific (g_sched_pool_key, NULL);
+}
+
+static void
+init_sched_pool_key (void)
+{
+  g_sched_pool_key_ok = (0 == pthread_key_create (&g_sched_pool_key, NULL));
+  (void) pthread_atfork (NULL, NULL, child_sched_pool_reset);
+}
+
+static void
+destroy_sched_pool (tiz_sched_pool_t * ap_pool)
+{
+  OMX_PTR p_result = NULL;
+  OMX_U32 i = 0;
+
+  if (!ap_pool)
+    {
+      return;
+    }
+
+  if (ap_pool->mutex)
+    {
+      (void) tiz_mutex_lock (&(ap_pool->mutex));
+      ap_pool->stopping = OMX_TRUE;
+      for (i = 0; i < ap_pool->nworkers; ++i)
+        {
+          tiz_sched_worker_t * p_worker = ap_pool->workers[i];
+          if (p_worker->waiting)
+            {
+              p_worker->waiting = OMX_FALSE;
+              ap_pool->nidle--;
+              (void) tiz_cond_signal (&(p_worker->cond));
+            }
+        }
+      (void) tiz_mutex_unlock (&(ap_pool->mutex));
+    }
+
+  for (i = 0; i < ap_pool->nworkers; ++i)
+    {
+      tiz_sched_worker_t * p_worker = ap_pool->workers[i];
+      (void) tiz_thread_join (&(p_worker->thread), &p_result);
+      (void) tiz_cond_destroy (&(p_worker->cond));
+      tiz_mem_free (p_worker);
+    }
+
+  if (ap_pool->mutex)
+    {
+      (void) tiz_mutex_destroy (&(ap_pool->mutex));
+    }
+  if (ap_pool->released_cond)
+    {
+      (void) tiz_cond_destroy (&(ap_pool->released_cond));
+    }
+  tiz_mem_free (ap_pool);
+}
+
+/* Must be called with g_sched_pool_mutex held */
+static tiz_sched_pool_t *
+create_sched_pool (void)
+{
+  tiz_sched_pool_t * p_pool = NULL;
+  const char * p_nthreads = getenv ("TIZONIA_SCHEDULER_POOL_THREADS");
+  const char * p_pin = NULL;
+  long nthreads = 0;
+
+  if (!p_nthreads)
+    {
+      p_nthreads = tiz_rcfile_get_value ("ilcore", "scheduler-pool-threads");
+    }
+  nthreads = p_nthreads ? strtol (p_nthreads, NULL, 10) : 0;
+
+  if (nthreads <= 0)
+    {
+      /* One thread per component (default) */
+      return NULL;
+    }
+
+  (void) pthread_once (&g_sched_pool_key_once, init_sched_pool_key);
+  if (!g_sched_pool_key_ok
+      || !(p_pool = tiz_mem_calloc (1, sizeof (tiz_sched_pool_t))))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "[OMX_ErrorInsufficientResources] : "
+               "Could not allocate the scheduler pool; "
+               "using one thread per component.");
+      return NULL;
+    }
+
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_pool->mutex))
+      || OMX_ErrorNone != tiz_cond_init (&(p_pool->released_cond)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "[OMX_ErrorInsufficientResources] : "
+               "Could not initialise the scheduler pool; "
+               "using one thread per component.");
+      destroy_sched_pool (p_pool);
+      return NULL;
+    }
+
+  p_pin = tiz_rcfile_get_value ("ilcore", "scheduler-pool-pin-threads");
+  if (p_pin && 0 == strncmp (p_pin, "true", 4))
+    {
+      p_pool->ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+    }
+
+  (void) tiz_mutex_lock (&(p_pool->mutex));
+  nthreads = MIN (nthreads, SCHED_POOL_MAX_THREADS);
+  while (p_pool->nworkers < (OMX_U32) nthreads
+         && OMX_ErrorNone == pool_start_worker (p_pool))
+    {
+    }
+  p_pool->nhomes = p_pool->nworkers;
+  (void) tiz_mutex_unlock (&(p_pool->mutex));
+
+  if (0 == p_pool->nhomes)
+    {
+      destroy_sched_pool (p_pool);
+      return NULL;
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Scheduler pool started with [%u] threads",
+           (unsigned int) p_pool->nhomes);
+  return p_pool;
+}
+
+static tiz_sched_pool_t *
+pool_attach (tiz_scheduler_t * ap_sched)
+{
+  tiz_sched_pool_t * p_pool = NULL;
+
+  assert (ap_sched);
+
+  (void) pthread_mutex_lock (&g_sched_pool_mutex);
+  if (!gp_sched_pool)
+    {
+      gp_sched_pool = create_sched_pool ();
+    }
+  if ((p_pool = gp_sched_pool))
+    {
+      (void) tiz_mutex_lock (&(p_pool->mutex));
+      if (p_pool->nscheds < SCHED_POOL_MAX_COMPONENTS)
+        {
+          p_pool->nscheds++;
+          ap_sched->home = p_pool->next_home++ % p_pool->nhomes;
+        }
+      else
+        {
+          TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                   "Scheduler pool full; [%s] gets a thread of its own.",
+                   ap_sched->cname);
+          p_pool = NULL;
+        }
+      (void) tiz_mutex_unlock (&(gp_sched_pool->mutex));
+    }
+  (void) pthread_mutex_unlock (&g_sched_pool_mutex);
+
+  return p_pool;
+}
+
+static void
+pool_detach (tiz_scheduler_t * ap_sched)
+{
+  tiz_sched_pool_t * p_pool = NULL;
+  OMX_BOOL last = OMX_FALSE;
+
+  assert (ap_sched);
+  p_pool = ap_sched->p_pool;
+  assert (p_pool);
+
+  /* Wait until the pool worker has let go of the scheduler */
+  (void) tiz_mutex_lock (&(p_pool->mutex));
+  while (ap_sched->queued)
+    {
+      (void) tiz_cond_wait (&(p_pool->released_cond), &(p_pool->mutex));
+    }
+  (void) tiz_mutex_unlock (&(p_pool->mutex));
+
+  (void) pthread_mutex_lock (&g_sched_pool_mutex);
+  (void) tiz_mutex_lock (&(p_pool->mutex));
+  last = (0 == --p_pool->nscheds) ? OMX_TRUE : OMX_FALSE;
+  (void) tiz_mutex_unlock (&(p_pool->mutex));
+  /* A worker cannot join itself; when the last component is freed from a
+     pool thread, the pool is kept for the next one */
+  if (last && !current_pool_worker ())
+    {
+      gp_sched_pool = NULL;
+      destroy_sched_pool (p_pool);
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "Scheduler pool stopped");
+    }
+  (void) pthread_mutex_unlock (&g_sched_pool_mutex);
+}
+
+static bool
+wants_dedicated_thread (tiz_scheduler_t * ap_sched)
+{
+  const char * p_dedicated = get_comp_rc_value (ap_sched, "dedicated_thread");
+  /* Thread attributes can only be applied to a thread of the component's
+     own */
+  return (p_dedicated && 0 == strncmp (p_dedicated, "true", 4))
+         || get_comp_rc_value (ap_sched, "sched_policy")
+         || get_comp_rc_value (ap_sched, "cpu_affinity");
+}
+
 static OMX_ERRORTYPE
 start_scheduler (tiz_scheduler_t * ap_sched)
 {
   assert (ap_sched);
 
+  if (!wants_dedicated_thread (ap_sched)
+      && (ap_sched->p_pool = pool_attach (ap_sched)))
+    {
+      /* No dedicated thread; the pool runs this scheduler when it has
+         messages to process */
+      ap_sched->pooled = OMX_TRUE;
+      return OMX_ErrorNone;
+    }
+
   /* Create scheduler thread */
   tiz_check_omx_ret_oom (tiz_mutex_lock (&(ap_sched->mutex)));
   tiz_check_omx_ret_oom (tiz_thread_create (&(ap_sched->thread), 0, 0,
@@ -2446,7 +3376,14 @@ delete_scheduler (tiz_scheduler_t * ap_sched)
 {
   OMX_PTR p_result = NULL;
   assert (ap_sched);
-  (void) tiz_thread_join (&(ap_sched->thread), &p_result);
+  if (ap_sched->pooled)
+    {
+      pool_detach (ap_sched);
+    }
+  else
+    {
+      (void) tiz_thread_join (&(ap_sched->thread), &p_result);
+    }
   delete_roles (ap_sched);
   delete_hooks (ap_sched, ap_sched->child.p_alloc_hooks_map);
   ap_sched->child.p_alloc_hooks_map = NULL;
@@ -2456,6 +3393,8 @@ delete_scheduler (tiz_scheduler_t * ap_sched)
   (void) tiz_sem_destroy (&(ap_sched->sem));
   tiz_queue_destroy (ap_sched->p_queue);
   ap_sched->p_queue = NULL;
+  tiz_sched_trace_destroy (ap_sched->p_trace);
+  ap_sched->p_trace = NULL;
   tiz_mem_free (ap_sched);
 }
 
@@ -2492,6 +3431,11 @@ instantiate_scheduler (OMX_HANDLETYPE ap_hdl, const char * ap_cname)
   p_sched->state = ETIZSchedStateStarting;
   p_sched->appdata = NULL;
   p_sched->cbacks = NULL;
+  p_sched->pooled = OMX_FALSE;
+  p_sched->p_pool = NULL;
+  p_sched->home = 0;
+  p_sched->queued = OMX_FALSE;
+  p_sched->p_trace = tiz_sched_trace_init (ap_cname);
 
   len = strnlen (ap_cname, OMX_MAX_STRINGNAME_SIZE - 1);
   strncpy (p_sched->cname, ap_cname, len);
@@ -2542,6 +3486,64 @@ set_thread_name (tiz_scheduler_t * ap_sched)
   return tiz_thread_setname (&(ap_sched->thread), thread_name);
 }
 
+static const char *
+get_comp_rc_value (tiz_scheduler_t * ap_sched, const char * ap_key)
+{
+  char fqd_key[OMX_MAX_STRINGNAME_SIZE];
+  assert (ap_sched);
+  assert (ap_key);
+  /* OMX.component.name.key */
+  (void) snprintf (fqd_key, OMX_MAX_STRINGNAME_SIZE, "%s.%s", ap_sched->cname,
+                   ap_key);
+  return tiz_rcfile_get_value ("plugins", fqd_key);
+}
+
+static void
+set_thread_attributes (tiz_scheduler_t * ap_sched)
+{
+  const char * p_policy = NULL;
+  const char * p_priority = NULL;
+  const char * p_cpus = NULL;
+  const char * p_mlockall = NULL;
+
+  assert (ap_sched);
+
+  /* These are all optional. Failing to apply any of them (typically because
+     the process lacks CAP_SYS_NICE/CAP_IPC_LOCK or the corresponding rlimits)
+     is not fatal: the component carries on with the default attributes. */
+  p_policy = get_comp_rc_value (ap_sched, "sched_policy");
+  p_priority = get_comp_rc_value (ap_sched, "sched_priority");
+  if (p_policy)
+    {
+      const OMX_S32 priority = p_priority ? strtol (p_priority, NULL, 10) : 0;
+      if (OMX_ErrorNone
+          != tiz_thread_setschedparam (&(ap_sched->thread), p_policy, priority))
+        {
+          TIZ_NOTICE (ap_sched->child.p_hdl,
+                      "Unable to set scheduling policy [%s] priority [%d]; "
+                      "using the default policy.",
+                      p_policy, (int) priority);
+        }
+    }
+
+  p_cpus = get_comp_rc_value (ap_sched, "cpu_affinity");
+  if (p_cpus
+      && OMX_ErrorNone != tiz_thread_setaffinity (&(ap_sched->thread), p_cpus))
+    {
+      TIZ_NOTICE (ap_sched->child.p_hdl,
+                  "Unable to set cpu affinity [%s]; not pinning the thread.",
+                  p_cpus);
+    }
+
+  p_mlockall = get_comp_rc_value (ap_sched, "mlockall");
+  if (p_mlockall && 0 == strncmp (p_mlockall, "true", 4)
+      && OMX_ErrorNone != tiz_mem_lock_all ())
+    {
+      TIZ_NOTICE (ap_sched->child.p_hdl,
+                  "Unable to lock the process memory; pages may be swapped.");
+    }
+}
+
 static OMX_ERRORTYPE
 init_servants (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
 {
@@ -2550,7 +3552,11 @@ init_servants (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
   assert (ap_sched);
   assert (ap_msg);
 
-  tiz_check_omx_ret_oom (set_thread_name (ap_sched));
+  if (!ap_sched->pooled)
+    {
+      tiz_check_omx_ret_oom (set_thread_name (ap_sched));
+      set_thread_attributes (ap_sched);
+    }
 
   p_hdl = ap_sched->child.p_hdl;
 
@@ -2583,6 +3589,10 @@ init_servants (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
   /* Init the small object allocator */
   tiz_check_omx_ret_oom (tiz_soa_init (&(ap_sched->p_soa)));
 
+  /* Init the per-component arena used for transient, per-track data */
+  tiz_check_omx_ret_oom (
+    tiz_arena_init (&(ap_sched->p_arena), TIZ_ARENA_DEFAULT_BLOCK_SIZE));
+
   /* Init the object system */
   tiz_check_omx_ret_oom (
     tiz_os_init (&(ap_sched->p_objsys), p_hdl, ap_sched->p_soa));
@@ -2610,11 +3620,12 @@ init_servants (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
       return OMX_ErrorInsufficientResources;
     }
 
-  /* All servants will use the same small object allocator */
+  /* All servants will use the same small object allocator. The arena is only
+     handed to the processor (see below), which is its sole owner */
   tiz_check_omx_ret_oom (
-    tiz_srv_set_allocator (ap_sched->child.p_fsm, ap_sched->p_soa));
+    tiz_srv_set_allocator (ap_sched->child.p_fsm, ap_sched->p_soa, NULL));
   tiz_check_omx_ret_oom (
-    tiz_srv_set_allocator (ap_sched->child.p_ker, ap_sched->p_soa));
+    tiz_srv_set_allocator (ap_sched->child.p_ker, ap_sched->p_soa, NULL));
 
   return OMX_ErrorNone;
 }
@@ -2645,6 +3656,10 @@ deinit_servants (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
   tiz_soa_destroy (ap_sched->p_soa);
   ap_sched->p_soa = NULL;
 
+  /* Destroy the arena, now that the config port is gone */
+  tiz_arena_destroy (ap_sched->p_arena);
+  ap_sched->p_arena = NULL;
+
   return OMX_ErrorNone;
 }
 
@@ -2692,8 +3707,10 @@ init_and_register_role (tiz_scheduler_t * ap_sched, const OMX_U32 a_role_pos)
       assert (!ap_sched->child.p_prc);
       ap_sched->child.p_prc = p_proc;
 
-      /* All servants will use the same object allocator */
-      tiz_check_omx_ret_oom (tiz_srv_set_allocator (p_proc, ap_sched->p_soa));
+      /* The processor is the only servant that allocates from, and resets,
+         the component's arena */
+      tiz_check_omx_ret_oom (
+        tiz_srv_set_allocator (p_proc, ap_sched->p_soa, ap_sched->p_arena));
     }
 
   return rc;
@@ -3039,6 +4056,86 @@ tiz_comp_event_stat (const OMX_HANDLETYPE ap_hdl, tiz_event_stat_t * ap_ev_stat,
   (void) send_msg (get_sched (ap_hdl), p_msg);
 }
 
+OMX_ERRORTYPE
+tiz_comp_empty_fill_buffers (const OMX_HANDLETYPE ap_hdl,
+                             const OMX_DIRTYPE a_dir,
+                             OMX_BUFFERHEADERTYPE ** app_hdrs,
+                             const OMX_U32 a_nhdrs, OMX_U32 * ap_ndelivered)
+{
+  OMX_COMPONENTTYPE * p_comp = (OMX_COMPONENTTYPE *) ap_hdl;
+  tiz_sched_msg_t * p_msg = NULL;
+  tiz_sched_msg_emptyfillbuffers_t * p_msg_efbs = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_U32 ndelivered = 0;
+  OMX_U32 i = 0;
+
+  if (ap_ndelivered)
+    {
+      *ap_ndelivered = 0;
+    }
+
+  if (!ap_hdl || !app_hdrs
+      || (OMX_DirInput != a_dir && OMX_DirOutput != a_dir))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "[OMX_ErrorBadParameter] : "
+               "(Bad argument received)");
+      return OMX_ErrorBadParameter;
+    }
+
+  /* A component not implemented with this library gets the headers one at a
+     time, through its standard entry points */
+  if (p_comp->EmptyThisBuffer != sched_EmptyThisBuffer)
+    {
+      for (i = 0; i < a_nhdrs && OMX_ErrorNone == rc; ++i)
+        {
+          rc = (OMX_DirInput == a_dir
+                  ? p_comp->EmptyThisBuffer (ap_hdl, app_hdrs[i])
+                  : p_comp->FillThisBuffer (ap_hdl, app_hdrs[i]));
+          if (OMX_ErrorNone == rc)
+            {
+              ++ndelivered;
+            }
+        }
+    }
+  else if (a_nhdrs > 0)
+    {
+      /* The whole batch goes in a single message */
+      OMX_BUFFERHEADERTYPE ** pp_hdrs
+        = tiz_slab_calloc (a_nhdrs * sizeof (OMX_BUFFERHEADERTYPE *));
+      tiz_check_null_ret_oom (pp_hdrs);
+      if (!(p_msg = init_scheduler_message (ap_hdl,
+                                            ETIZSchedMsgEmptyFillBuffers)))
+        {
+          tiz_slab_free (pp_hdrs);
+          return OMX_ErrorInsufficientResources;
+        }
+
+      for (i = 0; i < a_nhdrs; ++i)
+        {
+          assert (app_hdrs[i]);
+          pp_hdrs[i] = app_hdrs[i];
+        }
+      p_msg_efbs = &(p_msg->efbs);
+      assert (p_msg_efbs);
+      p_msg_efbs->dir = a_dir;
+      p_msg_efbs->nhdrs = a_nhdrs;
+      p_msg_efbs->pp_hdrs = pp_hdrs;
+
+      if (OMX_ErrorNone == (rc = send_msg (get_sched (ap_hdl), p_msg)))
+        {
+          ndelivered = a_nhdrs;
+        }
+    }
+
+  if (ap_ndelivered)
+    {
+      *ap_ndelivered = ndelivered;
+    }
+
+  return rc;
+}
+
 size_t
 tiz_comp_event_queue_unused_spaces (const OMX_HANDLETYPE ap_hdl)
 {
@@ -3053,6 +4150,26 @@ tiz_get_sched (const OMX_HANDLETYPE ap_hdl)
   return get_sched (ap_hdl);
 }
 
+OMX_U64
+tiz_comp_trace_begin (const OMX_HANDLETYPE ap_hdl)
+{
+  const tiz_scheduler_t * p_sched = get_sched (ap_hdl);
+  return (p_sched && p_sched->p_trace) ? tiz_monotonic_usec () : 0;
+}
+
+void
+tiz_comp_trace_end (const OMX_HANDLETYPE ap_hdl, const char * ap_name,
+                    const OMX_U64 a_start)
+{
+  tiz_scheduler_t * p_sched = NULL;
+  if (a_start > 0 && (p_sched = get_sched (ap_hdl)) && p_sched->p_trace)
+    {
+      tiz_sched_trace_record (p_sched->p_trace, ETIZSchedHistCallback, ap_name,
+                              a_start,
+                              (OMX_U32) (tiz_monotonic_usec () - a_start));
+    }
+}
+
 void *
 tiz_get_fsm (const OMX_HANDLETYPE ap_hdl)
 {
@@ -3061,6 +4178,14 @@ tiz_get_fsm (const OMX_HANDLETYPE ap_hdl)
   return p_sched->child.p_fsm;
 }
 
+bool
+tiz_arena_owned (const OMX_HANDLETYPE ap_hdl, const void * ap_addr)
+{
+  tiz_scheduler_t * p_sched = get_sched (ap_hdl);
+  assert (p_sched);
+  return p_sched->p_arena && tiz_arena_owns (p_sched->p_arena, ap_addr);
+}
+
 void *
 tiz_get_krn (const OMX_HANDLETYPE ap_hdl)
 {
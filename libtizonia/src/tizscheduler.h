@@ -403,6 +403,32 @@ void
 tiz_comp_event_stat (const OMX_HANDLETYPE ap_hdl, tiz_event_stat_t * ap_ev_stat,
                      void * ap_arg, const uint32_t a_id, const int a_events);
 
+/**
+ * Deliver several buffer headers to a component in one go.
+ *
+ * This is equivalent to calling OMX_EmptyThisBuffer (or OMX_FillThisBuffer)
+ * once per header, but when the receiving component is implemented with this
+ * library, the headers are delivered with a single scheduler message, and
+ * the component's kernel processes the whole batch in one tick.
+ *
+ * @ingroup tizscheduler
+ *
+ * @param ap_hdl The OpenMAX IL handle of the receiving component.
+ * @param a_dir The direction of the receiving ports, OMX_DirInput for
+ * OMX_EmptyThisBuffer, OMX_DirOutput for OMX_FillThisBuffer.
+ * @param app_hdrs The buffer headers.
+ * @param a_nhdrs The number of buffer headers.
+ * @param ap_ndelivered On return, the number of headers, from the start of
+ * the array, that the component has accepted. On error, the rest of the
+ * headers still belong to the caller. May be NULL.
+ * @return OMX_ErrorNone on success, other OMX_ERRORTYPE on error.
+ */
+OMX_ERRORTYPE
+tiz_comp_empty_fill_buffers (const OMX_HANDLETYPE ap_hdl,
+                             const OMX_DIRTYPE a_dir,
+                             OMX_BUFFERHEADERTYPE ** app_hdrs,
+                             const OMX_U32 a_nhdrs, OMX_U32 * ap_ndelivered);
+
 /**
  * Retrieve the current maximum number of items that could be insterted into the queue.
  * @ingroup tizscheduler
@@ -412,6 +438,30 @@ tiz_comp_event_stat (const OMX_HANDLETYPE ap_hdl, tiz_event_stat_t * ap_ev_stat,
 size_t
 tiz_comp_event_queue_unused_spaces (const OMX_HANDLETYPE ap_hdl);
 
+/**
+ * Start timing a callback issued by the component (an IL client callback or
+ * a call into a tunneled component), for the scheduler's latency histograms
+ * and trace file (see the 'scheduler-histograms' and 'scheduler-trace-file'
+ * keys in tizonia.conf).
+ * @ingroup tizscheduler
+ * @param ap_hdl The OpenMAX IL handle.
+ * @return The current time in micro seconds, or zero if neither histograms
+ * nor tracing are enabled.
+ */
+OMX_U64
+tiz_comp_trace_begin (const OMX_HANDLETYPE ap_hdl);
+
+/**
+ * Finish timing a callback started with tiz_comp_trace_begin.
+ * @ingroup tizscheduler
+ * @param ap_hdl The OpenMAX IL handle.
+ * @param ap_name The name of the callback.
+ * @param a_start The value returned by tiz_comp_trace_begin.
+ */
+void
+tiz_comp_trace_end (const OMX_HANDLETYPE ap_hdl, const char * ap_name,
+                    const OMX_U64 a_start);
+
 /* Utility functions */
 
 /**
@@ -423,6 +473,19 @@ tiz_comp_event_queue_unused_spaces (const OMX_HANDLETYPE ap_hdl);
 void *
 tiz_get_fsm (const OMX_HANDLETYPE ap_hdl);
 
+/**
+ * Find out whether an address was allocated from the component's arena. The
+ * arena belongs to the processor, which is the only servant allowed to
+ * allocate from it or reset it (see tiz_srv_arena_calloc); other servants
+ * and ports can only query ownership.
+ * @ingroup tizscheduler
+ * @param ap_hdl The OpenMAX IL handle.
+ * @param ap_addr The address to check.
+ * @return true if the address is owned by the arena.
+ */
+bool
+tiz_arena_owned (const OMX_HANDLETYPE ap_hdl, const void * ap_addr);
+
 /**
  * Retrieve the component's 'kernel' servant object.
  * @ingroup tizscheduler
@@ -134,6 +134,7 @@ srv_ctor (void * ap_obj, va_list * app)
    * set_allocator */
   p_srv->p_pq_ = NULL;
   p_srv->p_soa_ = NULL;
+  p_srv->p_arena_ = NULL;
   /* We also lazily initialise the watchers map, when the first watcher is
      allocated */
   p_srv->p_watchers_ = NULL;
@@ -172,22 +173,24 @@ srv_dtor (void * ap_obj)
 }
 
 static OMX_ERRORTYPE
-srv_set_allocator (void * ap_obj, tiz_soa_t * p_soa)
+srv_set_allocator (void * ap_obj, tiz_soa_t * p_soa, tiz_arena_t * p_arena)
 {
   tiz_srv_t * p_srv = ap_obj;
   assert (ap_obj);
   assert (p_soa);
   p_srv->p_soa_ = p_soa;
+  p_srv->p_arena_ = p_arena;
   return tiz_pqueue_init (&p_srv->p_pq_, 5, &pqueue_cmp, p_soa,
                           nameOf (ap_obj));
 }
 
 OMX_ERRORTYPE
-tiz_srv_set_allocator (void * ap_obj, tiz_soa_t * p_soa)
+tiz_srv_set_allocator (void * ap_obj, tiz_soa_t * p_soa,
+                       tiz_arena_t * p_arena)
 {
   const tiz_srv_class_t * class = classOf (ap_obj);
   assert (class->set_allocator);
-  return class->set_allocator (ap_obj, p_soa);
+  return class->set_allocator (ap_obj, p_soa, p_arena);
 }
 
 static void
@@ -507,15 +510,18 @@ srv_issue_event (const void * ap_obj, OMX_EVENTTYPE a_event, OMX_U32 a_data1,
                  /*@null@*/ OMX_PTR ap_eventdata)
 {
   tiz_srv_t * p_srv = (tiz_srv_t *) ap_obj;
+  OMX_U64 start = 0;
   assert (p_srv);
   assert (p_srv->p_cbacks_);
   assert (p_srv->p_cbacks_->EventHandler);
   /* NOTE: Start ignoring splint warnings in this section of code */
   /*@ignore@*/
   TIZ_NOTICE (handleOf (ap_obj), "[%s]", tiz_evt_to_str (a_event));
+  start = tiz_comp_trace_begin (handleOf (ap_obj));
   (void) p_srv->p_cbacks_->EventHandler (handleOf (ap_obj), p_srv->p_appdata_,
                                          a_event, a_data1, a_data2,
                                          ap_eventdata);
+  tiz_comp_trace_end (handleOf (ap_obj), "EventHandler", start);
   /*@end@*/
   /* NOTE: Stop ignoring splint warnings in this section  */
 }
@@ -607,9 +613,11 @@ srv_issue_buf_callback (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr,
                         OMX_U32 pid, OMX_DIRTYPE dir, OMX_HANDLETYPE ap_tcomp)
 {
   tiz_srv_t * p_srv = (tiz_srv_t *) ap_obj;
+  OMX_U64 start = 0;
   assert (p_srv);
   assert (p_srv->p_cbacks_);
   assert (p_srv->p_cbacks_->EventHandler);
+  start = tiz_comp_trace_begin (handleOf (ap_obj));
   if (ap_tcomp)
     {
       if (OMX_DirInput == dir)
@@ -645,6 +653,11 @@ srv_issue_buf_callback (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr,
 
       (void) fp_buf_done (handleOf (ap_obj), p_srv->p_appdata_, p_hdr);
     }
+  tiz_comp_trace_end (handleOf (ap_obj),
+                      OMX_DirInput == dir
+                        ? (ap_tcomp ? "FillThisBuffer" : "EmptyBufferDone")
+                        : (ap_tcomp ? "EmptyThisBuffer" : "FillBufferDone"),
+                      start);
 }
 
 void
@@ -704,6 +717,50 @@ tiz_srv_soa_free (void * ap_obj, void * ap_addr)
   class->soa_free (ap_obj, ap_addr);
 }
 
+static void *
+srv_arena_calloc (void * ap_obj, size_t a_size)
+{
+  tiz_srv_t * p_srv = ap_obj;
+  assert (p_srv);
+  /* Only the processor is given the arena */
+  assert (p_srv->p_arena_);
+  if (!p_srv->p_arena_)
+    {
+      TIZ_ERROR (handleOf (ap_obj), "[%s] does not own the arena",
+                 nameOf (ap_obj));
+      return NULL;
+    }
+  return tiz_arena_calloc (p_srv->p_arena_, a_size);
+}
+
+void *
+tiz_srv_arena_calloc (void * ap_obj, size_t a_size)
+{
+  const tiz_srv_class_t * class = classOf (ap_obj);
+  assert (class->arena_calloc);
+  return class->arena_calloc (ap_obj, a_size);
+}
+
+static void
+srv_arena_reset (void * ap_obj)
+{
+  tiz_srv_t * p_srv = ap_obj;
+  assert (p_srv);
+  assert (p_srv->p_arena_);
+  if (p_srv->p_arena_)
+    {
+      tiz_arena_reset (p_srv->p_arena_);
+    }
+}
+
+void
+tiz_srv_arena_reset (void * ap_obj)
+{
+  const tiz_srv_class_t * class = classOf (ap_obj);
+  assert (class->arena_reset);
+  class->arena_reset (ap_obj);
+}
+
 static OMX_ERRORTYPE
 srv_io_watcher_init (void * ap_obj, tiz_event_io_t ** app_ev_io, int a_fd,
                      tiz_event_io_event_t a_event, bool only_once)
@@ -1247,6 +1304,14 @@ srv_class_ctor (void * ap_obj, va_list * app)
         {
           *(voidf *) &p_srv->soa_free = method;
         }
+      else if (selector == (voidf) tiz_srv_arena_calloc)
+        {
+          *(voidf *) &p_srv->arena_calloc = method;
+        }
+      else if (selector == (voidf) tiz_srv_arena_reset)
+        {
+          *(voidf *) &p_srv->arena_reset = method;
+        }
       else if (selector == (voidf) tiz_srv_io_watcher_init)
         {
           *(voidf *) &p_srv->io_watcher_init = method;
@@ -1396,6 +1461,10 @@ tiz_srv_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_soa_free, srv_soa_free,
      /* TIZ_CLASS_COMMENT: */
+     tiz_srv_arena_calloc, srv_arena_calloc,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_arena_reset, srv_arena_reset,
+     /* TIZ_CLASS_COMMENT: */
      tiz_srv_io_watcher_init, srv_io_watcher_init,
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_io_watcher_start, srv_io_watcher_start,
@@ -46,7 +46,8 @@ void *
 tiz_srv_init (void * ap_tos, void * ap_hdl);
 
 OMX_ERRORTYPE
-tiz_srv_set_allocator (void * ap_obj, tiz_soa_t * p_soa);
+tiz_srv_set_allocator (void * ap_obj, tiz_soa_t * p_soa,
+                       tiz_arena_t * p_arena);
 
 void
 tiz_srv_set_callbacks (void * ap_obj, OMX_PTR ap_appdata,
@@ -127,6 +128,19 @@ tiz_srv_soa_calloc (void * ap_obj, size_t a_size);
 void
 tiz_srv_soa_free (void * ap_obj, void * ap_addr);
 
+/* Per-component arena access. Only the processor owns the arena; other
+ * servants are not given one and must not call these. Arena memory is for
+ * transient, per-track data (e.g. metadata items): it is never freed
+ * individually, and remains valid until the next tiz_srv_arena_reset. The
+ * arena is also reset when the processor leaves Executing or Pause, so
+ * pointers into it must not be kept across a stop. Processors that keep
+ * allocating while executing (e.g. once per track or per connection) must
+ * reset it themselves at those boundaries. */
+void *
+tiz_srv_arena_calloc (void * ap_obj, size_t a_size);
+void
+tiz_srv_arena_reset (void * ap_obj);
+
 /* io event helpers */
 OMX_ERRORTYPE
 tiz_srv_io_watcher_init (void * ap_obj, tiz_event_io_t ** app_ev_io, int a_fd,
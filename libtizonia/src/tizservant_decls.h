@@ -43,6 +43,7 @@ struct tiz_srv
   const tiz_api_t _;
   tiz_pqueue_t * p_pq_;
   tiz_soa_t * p_soa_; /* Not owned */
+  tiz_arena_t * p_arena_; /* Not owned */
   tiz_map_t * p_watchers_;
   uint32_t watcher_id_;
   OMX_PTR p_appdata_;
@@ -91,7 +92,8 @@ struct tiz_srv_class
 {
   /* Class */
   const tiz_api_class_t _;
-  OMX_ERRORTYPE (*set_allocator) (void * ap_obj, tiz_soa_t * p_soa);
+  OMX_ERRORTYPE (*set_allocator) (void * ap_obj, tiz_soa_t * p_soa,
+                                  tiz_arena_t * p_arena);
   void (*set_callbacks) (void * ap_obj, OMX_PTR ap_appdata,
                          OMX_CALLBACKTYPE * ap_cbacks);
   OMX_ERRORTYPE (*tick) (const void * ap_obj);
@@ -125,6 +127,9 @@ struct tiz_srv_class
   void * (*soa_calloc) (void * ap_obj, size_t a_size);
   void (*soa_free) (void * ap_obj, void * ap_addr);
 
+  void * (*arena_calloc) (void * ap_obj, size_t a_size);
+  void (*arena_reset) (void * ap_obj);
+
   OMX_ERRORTYPE (*io_watcher_init)
   (void * ap_obj, tiz_event_io_t ** app_ev_io, int a_fd,
    tiz_event_io_event_t a_event, bool only_once);
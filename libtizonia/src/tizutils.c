@@ -31,6 +31,9 @@
 #endif
 
 #include <assert.h>
+#include <string.h>
+
+#include <tizplatform.h>
 
 #include "tizutils.h"
 
@@ -92,3 +95,40 @@ tiz_fsm_state_to_str (tiz_fsm_state_id_t a_id)
 
   return "Unknown OpenMAX IL state";
 }
+
+OMX_CONFIG_METADATAITEMTYPE *
+tiz_metadata_item_new (const char * ap_key, const char * ap_value)
+{
+  OMX_CONFIG_METADATAITEMTYPE * p_meta = NULL;
+  size_t key_len = 0;
+  size_t value_len = 0;
+  size_t metadata_len = 0;
+
+  assert (ap_key);
+  assert (ap_value);
+
+  key_len = strnlen (ap_key, OMX_MAX_STRINGNAME_SIZE - 1) + 1;
+  value_len = strlen (ap_value) + 1;
+  metadata_len = sizeof (OMX_CONFIG_METADATAITEMTYPE) + value_len;
+
+  if ((p_meta = (OMX_CONFIG_METADATAITEMTYPE *) tiz_mem_calloc (
+         1, metadata_len)))
+    {
+      memcpy (p_meta->nKey, ap_key, key_len - 1);
+      p_meta->nKey[key_len - 1] = '\0';
+      p_meta->nKeySizeUsed = key_len;
+      memcpy (p_meta->nValue, ap_value, value_len);
+      p_meta->nValueMaxSize = value_len;
+      p_meta->nValueSizeUsed = value_len;
+
+      p_meta->nSize = metadata_len;
+      p_meta->nVersion.nVersion = OMX_VERSION;
+      p_meta->eScopeMode = OMX_MetadataScopeAllLevels;
+      p_meta->nScopeSpecifier = 0;
+      p_meta->nMetadataItemIndex = 0;
+      p_meta->eSearchMode = OMX_MetadataSearchValueSizeByIndex;
+      p_meta->eKeyCharset = OMX_MetadataCharsetASCII;
+      p_meta->eValueCharset = OMX_MetadataCharsetASCII;
+    }
+  return p_meta;
+}
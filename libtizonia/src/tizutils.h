@@ -35,6 +35,7 @@ extern "C" {
 
 #include <OMX_Types.h>
 #include <OMX_Core.h>
+#include <OMX_Component.h>
 
 #include "tizfsm.h"
 
@@ -121,6 +122,19 @@ tiz_clear_header (OMX_BUFFERHEADERTYPE * ap_hdr);
 const OMX_STRING
 tiz_fsm_state_to_str (tiz_fsm_state_id_t a_id);
 
+/**
+ * Allocate a metadata item that holds a pair of ASCII strings, ready to be
+ * handed over to tiz_krn_store_metadata. The item is allocated with
+ * tiz_mem_calloc, and is released by the kernel when the component's
+ * metadata is cleared.
+ *
+ * @param ap_key The item's key.
+ * @param ap_value The item's value.
+ * @return The new item, or NULL if out of memory.
+ */
+OMX_CONFIG_METADATAITEMTYPE *
+tiz_metadata_item_new (const char * ap_key, const char * ap_value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,7 @@
 #include <signal.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include <OMX_Component.h>
 #include <OMX_TizoniaExt.h>
@@ -49,6 +50,9 @@
 #include "tizscheduler.h"
 #include "tizfsm.h"
 #include "tizkernel.h"
+#include "tizpcmpack.h"
+#include "tizpktstore.h"
+#include "tizschedtrace.h"
 
 #include "check_tizonia.h"
 
@@ -82,6 +86,7 @@ struct check_common_context
   OMX_ERRORTYPE error;
   OMX_U32 port;
   OMX_BUFFERHEADERTYPE *p_hdr;
+  OMX_U32 nbufs; /* buffers returned since the last reset */
 };
 
 static bool
@@ -206,6 +211,7 @@ _ctx_init (cc_ctx_t * app_ctx)
   p_ctx->error = OMX_ErrorMax;
   p_ctx->port = OMX_ALL;
   p_ctx->p_hdr = NULL;
+  p_ctx->nbufs = 0;
 
   * app_ctx = p_ctx;
 
@@ -326,6 +332,7 @@ _ctx_reset (cc_ctx_t * app_ctx)
   p_ctx->error = OMX_ErrorMax;
   p_ctx->port = OMX_ALL;
   p_ctx->p_hdr = NULL;
+  p_ctx->nbufs = 0;
 
   tiz_mutex_unlock (&p_ctx->mutex);
 
@@ -600,6 +607,259 @@ START_TEST (test_tizonia_getparameter)
 }
 END_TEST
 
+START_TEST (test_tizonia_pcmpack)
+{
+  int32_t left[37];
+  int32_t right[37];
+  const int32_t * planar[2] = {left, right};
+  uint8_t out[37 * 2 * 4];
+  float fleft[37];
+  float fright[37];
+  const float * fplanar[2] = {fleft, fright};
+  int16_t s16[37 * 2];
+  tiz_pcm_dither_t dither;
+  int i = 0;
+
+  /* 16-bit samples go through untouched, odd frame counts included */
+  for (i = 0; i < 37; ++i)
+    {
+      left[i] = i * 887 - 16000;
+      right[i] = -left[i];
+    }
+  tiz_pcm_pack_s32 (s16, planar, 37, 2, 16, TIZ_PCM_FMT_S16_LE, NULL);
+  for (i = 0; i < 37; ++i)
+    {
+      fail_if (s16[2 * i] != left[i] || s16[2 * i + 1] != right[i]);
+    }
+
+  /* 24-bit output is packed in three bytes, little endian */
+  tiz_pcm_pack_s32 (out, planar, 1, 2, 16, TIZ_PCM_FMT_S24_LE, NULL);
+  fail_if (out[0] != 0x00 || out[1] != 0x80 || out[2] != 0xc1);
+
+  /* Fixed point (mad-style, 28 fractional bits) is rounded and clipped */
+  left[0] = 1 << 28;        /* 1.0 */
+  left[1] = -(1 << 28);     /* -1.0 */
+  left[2] = 3 << 27;        /* 1.5 */
+  left[3] = 1 << 12;        /* exactly half a 16-bit step */
+  right[0] = right[1] = right[2] = right[3] = 0;
+  tiz_pcm_pack_fixed (out, planar, 4, 2, 28, TIZ_PCM_FMT_S16_BE, NULL);
+  fail_if (out[0] != 0x7f || out[1] != 0xff);
+  fail_if (out[4] != 0x80 || out[5] != 0x00);
+  fail_if (out[8] != 0x7f || out[9] != 0xff);
+  fail_if (out[12] != 0x00 || out[13] != 0x01);
+
+  /* Float is clipped to the output range */
+  for (i = 0; i < 37; ++i)
+    {
+      fleft[i] = (i - 18) / 16.0f;
+      fright[i] = 0.5f;
+    }
+  tiz_pcm_pack_float (s16, fplanar, 37, 2, TIZ_PCM_FMT_S16_LE, NULL);
+  fail_if (s16[0] != -32768 || s16[72] != 32767 || s16[36] != 0);
+  fail_if (s16[1] != 16384);
+
+  /* TPDF dither stays within one step of the undithered value */
+  tiz_pcm_dither_init (&dither, 1);
+  for (i = 0; i < 37; ++i)
+    {
+      left[i] = right[i] = 100 << 8;
+    }
+  tiz_pcm_pack_s32 (s16, planar, 37, 2, 24, TIZ_PCM_FMT_S16_LE, &dither);
+  for (i = 0; i < 37 * 2; ++i)
+    {
+      fail_if (s16[i] < 99 || s16[i] > 101);
+    }
+}
+END_TEST
+
+/* Values that end in .5 once scaled to 16 bits, positive and negative, plus
+   the float just below one half */
+static const float pcmpack_halves[]
+  = {0.5f, 1.5f, 2.5f, -0.5f, -1.5f, -2.5f, 32766.5f, 0.49999997f};
+#define PCMPACK_NUM_HALVES (sizeof (pcmpack_halves) / sizeof (pcmpack_halves[0]))
+
+static int16_t
+pcmpack_round_s16 (const float a_scaled)
+{
+  /* Half away from zero */
+  const double v = a_scaled;
+  return (int16_t) (v < 0 ? v - 0.5 : v + 0.5);
+}
+
+START_TEST (test_tizonia_pcmpack_rounding)
+{
+  /* The vectorized code converts whole blocks (of 8 mono samples, or 4
+     stereo frames), and the scalar code the tail; the same values are placed
+     in both, and must round the same way */
+  float mono[2 * PCMPACK_NUM_HALVES - 1];
+  float left[PCMPACK_NUM_HALVES + 3];
+  float right[PCMPACK_NUM_HALVES + 3];
+  const float * planar[2] = {left, right};
+  const size_t nmono = 2 * PCMPACK_NUM_HALVES - 1;
+  const size_t nstereo = PCMPACK_NUM_HALVES + 3;
+  int16_t out[2 * (PCMPACK_NUM_HALVES + 3)];
+  size_t i = 0;
+
+  for (i = 0; i < nmono; ++i)
+    {
+      mono[i] = pcmpack_halves[i % PCMPACK_NUM_HALVES] / 32768.0f;
+    }
+  tiz_pcm_pack_float_ilv (out, mono, nmono, 1, TIZ_PCM_FMT_S16_LE, NULL);
+  for (i = 0; i < nmono; ++i)
+    {
+      fail_if (out[i]
+               != pcmpack_round_s16 (pcmpack_halves[i % PCMPACK_NUM_HALVES]));
+    }
+
+  for (i = 0; i < nstereo; ++i)
+    {
+      left[i] = pcmpack_halves[i % PCMPACK_NUM_HALVES] / 32768.0f;
+      right[i] = -left[i];
+    }
+  tiz_pcm_pack_float (out, planar, nstereo, 2, TIZ_PCM_FMT_S16_LE, NULL);
+  for (i = 0; i < nstereo; ++i)
+    {
+      const float v = pcmpack_halves[i % PCMPACK_NUM_HALVES];
+      fail_if (out[2 * i] != pcmpack_round_s16 (v));
+      fail_if (out[2 * i + 1] != pcmpack_round_s16 (-v));
+    }
+}
+END_TEST
+
+START_TEST (test_tizonia_pkt_store)
+{
+  tiz_pkt_store_t store;
+  OMX_BUFFERHEADERTYPE hdr;
+  OMX_U8 buf[8];
+  const OMX_U8 * p_data = NULL;
+  OMX_U32 len = 0;
+  OMX_TICKS end_time = 0;
+
+  tiz_pkt_store_init (&store);
+  memset (&hdr, 0, sizeof (hdr));
+  hdr.pBuffer = buf;
+
+  /* Input with no packet boundaries is passed through, with no time */
+  memcpy (buf, "abcd", 4);
+  hdr.nFilledLen = 4;
+  fail_if (OMX_ErrorNone
+           != tiz_pkt_store_obtain (&store, &hdr, &p_data, &len, &end_time));
+  fail_if (p_data != buf || len != 4 || end_time != -1);
+
+  /* A whole packet is decoded in place */
+  hdr.nFlags = OMX_BUFFERFLAG_ENDOFFRAME;
+  hdr.nTimeStamp = 20000;
+  fail_if (OMX_ErrorNone
+           != tiz_pkt_store_obtain (&store, &hdr, &p_data, &len, &end_time));
+  fail_if (p_data != buf || len != 4 || end_time != 20000);
+
+  /* A packet in two buffers is staged until its last part arrives */
+  hdr.nFlags = 0;
+  hdr.nOffset = 2;
+  hdr.nFilledLen = 2;
+  fail_if (OMX_ErrorNone
+           != tiz_pkt_store_obtain (&store, &hdr, &p_data, &len, &end_time));
+  fail_if (len != 0 || hdr.nFilledLen != 0 || end_time != -1);
+
+  memcpy (buf, "efg", 3);
+  hdr.nFlags = OMX_BUFFERFLAG_ENDOFFRAME | OMX_BUFFERFLAG_TIMESTAMPINVALID;
+  hdr.nOffset = 0;
+  hdr.nFilledLen = 3;
+  fail_if (OMX_ErrorNone
+           != tiz_pkt_store_obtain (&store, &hdr, &p_data, &len, &end_time));
+  fail_if (len != 5 || p_data == buf || 0 != memcmp (p_data, "cdefg", 5));
+  fail_if (hdr.nFilledLen != 0 || end_time != -1);
+
+  tiz_pkt_store_clear (&store);
+  fail_if (store.offset != 0 || !store.packetized);
+  tiz_pkt_store_reset (&store);
+  fail_if (store.packetized);
+  tiz_pkt_store_destroy (&store);
+  fail_if (store.p_data || store.size);
+}
+END_TEST
+
+START_TEST (test_tizonia_sched_hist_buckets)
+{
+  OMX_U32 i = 0;
+
+  for (i = 0; i < TIZ_SCHED_HIST_SUB_BUCKETS; ++i)
+    {
+      fail_if (tiz_sched_hist_bucket_index (i) != i);
+      fail_if (tiz_sched_hist_bucket_upper_bound (i) != i);
+    }
+
+  /* First split power of two: 16 and 17 share a bucket */
+  fail_if (tiz_sched_hist_bucket_index (15) != 15);
+  fail_if (tiz_sched_hist_bucket_index (16) != 16);
+  fail_if (tiz_sched_hist_bucket_index (17) != 16);
+  fail_if (tiz_sched_hist_bucket_index (18) != 17);
+  fail_if (tiz_sched_hist_bucket_upper_bound (16) != 17);
+  fail_if (tiz_sched_hist_bucket_index (UINT32_MAX)
+           != TIZ_SCHED_HIST_BUCKETS - 1);
+  fail_if (tiz_sched_hist_bucket_upper_bound (TIZ_SCHED_HIST_BUCKETS - 1)
+           != UINT32_MAX);
+
+  /* Buckets are contiguous and each upper bound is the bucket's last value */
+  for (i = 1; i < TIZ_SCHED_HIST_BUCKETS; ++i)
+    {
+      const OMX_U32 lower = tiz_sched_hist_bucket_upper_bound (i - 1) + 1;
+      const OMX_U32 upper = tiz_sched_hist_bucket_upper_bound (i);
+      fail_if (upper < lower);
+      fail_if (tiz_sched_hist_bucket_index (lower) != i);
+      fail_if (tiz_sched_hist_bucket_index (upper) != i);
+    }
+
+  /* Powers of two start a new bucket */
+  for (i = 3; i < 32; ++i)
+    {
+      const OMX_U32 pow2 = (OMX_U32) 1 << i;
+      fail_if (tiz_sched_hist_bucket_index (pow2)
+               != tiz_sched_hist_bucket_index (pow2 - 1) + 1);
+      fail_if (tiz_sched_hist_bucket_upper_bound (
+                 tiz_sched_hist_bucket_index (pow2 - 1))
+               != pow2 - 1);
+    }
+}
+END_TEST
+
+START_TEST (test_tizonia_sched_hist_percentile)
+{
+  tiz_sched_hist_t hist;
+  OMX_U32 i = 0;
+
+  memset (&hist, 0, sizeof (hist));
+  fail_if (tiz_sched_hist_percentile (&hist, 50.0) != 0);
+
+  /* 100 lands in [96, 103]; the top bucket is capped at the maximum */
+  tiz_sched_hist_record (&hist, 100);
+  tiz_sched_hist_record (&hist, 1000);
+  fail_if (tiz_sched_hist_percentile (&hist, 0.0) != 103);
+  fail_if (tiz_sched_hist_percentile (&hist, 50.0) != 103);
+  fail_if (tiz_sched_hist_percentile (&hist, 74.0) != 103);
+  fail_if (tiz_sched_hist_percentile (&hist, 75.0) != 1000);
+  fail_if (tiz_sched_hist_percentile (&hist, 100.0) != 1000);
+
+  /* The rank is rounded to the nearest sample */
+  memset (&hist, 0, sizeof (hist));
+  for (i = 0; i < 999; ++i)
+    {
+      tiz_sched_hist_record (&hist, 5);
+    }
+  tiz_sched_hist_record (&hist, 10000);
+  fail_if (hist.count != 1000 || hist.max != 10000);
+  fail_if (tiz_sched_hist_percentile (&hist, 99.9) != 5);
+  fail_if (tiz_sched_hist_percentile (&hist, 99.95) != 10000);
+
+  /* Samples exactly on a bucket's upper bound report that bound */
+  memset (&hist, 0, sizeof (hist));
+  tiz_sched_hist_record (&hist, 17);
+  tiz_sched_hist_record (&hist, UINT32_MAX);
+  fail_if (tiz_sched_hist_percentile (&hist, 50.0) != 17);
+  fail_if (tiz_sched_hist_percentile (&hist, 100.0) != UINT32_MAX);
+}
+END_TEST
+
 START_TEST (test_tizonia_roles)
 {
   OMX_S8 role [OMX_MAX_STRINGNAME_SIZE];
@@ -905,6 +1165,197 @@ START_TEST (test_tizonia_move_to_exe_and_transfer_with_allocbuffer)
 }
 END_TEST
 
+/* 256 frames of 16-bit stereo, i.e. the test component's minimum buffer
+   size */
+#define EFB_TEST_FRAMES 256
+#define EFB_TEST_BUFFERS 8
+#define EFB_TEST_ROUNDS 16
+
+static OMX_ERRORTYPE
+check_efb_EmptyBufferDone (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                           OMX_BUFFERHEADERTYPE * ap_buf)
+{
+  check_common_context_t *p_ctx = NULL;
+
+  assert (ap_app_data);
+  assert (ap_buf);
+  p_ctx = * (cc_ctx_t *) ap_app_data;
+
+  tiz_mutex_lock (&p_ctx->mutex);
+  if (++p_ctx->nbufs == EFB_TEST_BUFFERS)
+    {
+      p_ctx->signaled = OMX_TRUE;
+      tiz_cond_signal (&p_ctx->cond);
+    }
+  tiz_mutex_unlock (&p_ctx->mutex);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE _check_efb_cbacks = {
+  check_EventHandler,
+  check_efb_EmptyBufferDone,
+  check_FillBufferDone
+};
+
+static void
+run_efb_rounds (OMX_HANDLETYPE ap_hdl, cc_ctx_t * ap_ctx,
+                OMX_BUFFERHEADERTYPE ** app_hdrs, OMX_BOOL a_batched)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_BOOL timedout = OMX_FALSE;
+  OMX_U32 ndelivered = 0;
+  int i, j;
+
+  for (i = 0; i < EFB_TEST_ROUNDS; ++i)
+    {
+      error = _ctx_reset (ap_ctx);
+      fail_if (OMX_ErrorNone != error);
+
+      if (a_batched)
+        {
+          error = tiz_comp_empty_fill_buffers (ap_hdl, OMX_DirInput, app_hdrs,
+                                               EFB_TEST_BUFFERS, &ndelivered);
+          fail_if (OMX_ErrorNone != error);
+          fail_if (EFB_TEST_BUFFERS != ndelivered);
+        }
+      else
+        {
+          for (j = 0; j < EFB_TEST_BUFFERS; ++j)
+            {
+              error = OMX_EmptyThisBuffer (ap_hdl, app_hdrs[j]);
+              fail_if (OMX_ErrorNone != error);
+            }
+        }
+
+      error = _ctx_wait (ap_ctx, TIMEOUT_EXPECTING_SUCCESS, &timedout);
+      fail_if (OMX_ErrorNone != error);
+      fail_if (OMX_TRUE == timedout);
+    }
+}
+
+START_TEST (test_tizonia_efb_batch)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_HANDLETYPE p_hdl = 0;
+  OMX_COMMANDTYPE cmd = OMX_CommandStateSet;
+  cc_ctx_t ctx;
+  check_common_context_t *p_ctx = NULL;
+  OMX_BOOL timedout = OMX_FALSE;
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  OMX_BUFFERHEADERTYPE *hdrs[EFB_TEST_BUFFERS];
+  OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE flow_stats;
+  OMX_INDEXTYPE flow_stats_idx = OMX_IndexMax;
+  OMX_U32 i;
+
+  error = _ctx_init (&ctx);
+  fail_if (OMX_ErrorNone != error);
+
+  p_ctx = (check_common_context_t *) (ctx);
+
+  error = OMX_Init ();
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_GetHandle (&p_hdl, COMPONENT_NAME, (OMX_PTR *) (&ctx),
+                         &_check_efb_cbacks);
+  fail_if (OMX_ErrorNone != error);
+
+  port_def.nSize = sizeof (OMX_PARAM_PORTDEFINITIONTYPE);
+  port_def.nVersion.nVersion = OMX_VERSION;
+  port_def.nPortIndex = 0;
+  error = OMX_GetParameter (p_hdl, OMX_IndexParamPortDefinition, &port_def);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (port_def.nBufferSize > EFB_TEST_FRAMES * 2 * sizeof (OMX_S16));
+
+  port_def.nBufferCountActual = EFB_TEST_BUFFERS;
+  error = OMX_SetParameter (p_hdl, OMX_IndexParamPortDefinition, &port_def);
+  fail_if (OMX_ErrorNone != error);
+
+  /* Loaded -> Idle */
+  error = OMX_SendCommand (p_hdl, cmd, OMX_StateIdle, NULL);
+  fail_if (OMX_ErrorNone != error);
+
+  for (i = 0; i < EFB_TEST_BUFFERS; ++i)
+    {
+      error = OMX_AllocateBuffer (p_hdl, &hdrs[i], 0, 0,
+                                  EFB_TEST_FRAMES * 2 * sizeof (OMX_S16));
+      fail_if (OMX_ErrorNone != error);
+      hdrs[i]->nFilledLen = hdrs[i]->nAllocLen;
+    }
+
+  error = _ctx_wait (&ctx, TIMEOUT_EXPECTING_SUCCESS, &timedout);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (OMX_TRUE == timedout);
+  fail_if (OMX_StateIdle != p_ctx->state);
+
+  /* Idle -> Executing */
+  error = _ctx_reset (&ctx);
+  error = OMX_SendCommand (p_hdl, cmd, OMX_StateExecuting, NULL);
+  fail_if (OMX_ErrorNone != error);
+
+  error = _ctx_wait (&ctx, TIMEOUT_EXPECTING_SUCCESS, &timedout);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (OMX_TRUE == timedout);
+  fail_if (OMX_StateExecuting != p_ctx->state);
+
+  run_efb_rounds (p_hdl, &ctx, hdrs, OMX_FALSE);
+  run_efb_rounds (p_hdl, &ctx, hdrs, OMX_TRUE);
+
+  /* All the buffers must be accounted for in the port's flow stats */
+  error = OMX_GetExtensionIndex (
+    p_hdl, OMX_TIZONIA_INDEX_CONFIG_BUFFER_FLOW_STATS, &flow_stats_idx);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (OMX_TizoniaIndexConfigBufferFlowStats != flow_stats_idx);
+
+  flow_stats.nSize = sizeof (OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE);
+  flow_stats.nVersion.nVersion = OMX_VERSION;
+  flow_stats.nPortIndex = 0;
+  error = OMX_GetConfig (p_hdl, flow_stats_idx, &flow_stats);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (flow_stats.nBuffersReceived
+           != 2 * EFB_TEST_BUFFERS * EFB_TEST_ROUNDS);
+  fail_if (flow_stats.nBuffersReturned != flow_stats.nBuffersReceived);
+  fail_if (flow_stats.nBuffersReleased != flow_stats.nBuffersClaimed);
+  fail_if (flow_stats.nIngressDepthMax > EFB_TEST_BUFFERS);
+  fail_if (0 == flow_stats.nSchedMessages);
+  fail_if (0 == flow_stats.nTicks);
+
+  /* Executing -> Idle */
+  error = _ctx_reset (&ctx);
+  error = OMX_SendCommand (p_hdl, cmd, OMX_StateIdle, NULL);
+  fail_if (OMX_ErrorNone != error);
+
+  error = _ctx_wait (&ctx, TIMEOUT_EXPECTING_SUCCESS, &timedout);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (OMX_TRUE == timedout);
+  fail_if (OMX_StateIdle != p_ctx->state);
+
+  /* Idle -> Loaded */
+  error = _ctx_reset (&ctx);
+  error = OMX_SendCommand (p_hdl, cmd, OMX_StateLoaded, NULL);
+  fail_if (OMX_ErrorNone != error);
+
+  for (i = 0; i < EFB_TEST_BUFFERS; ++i)
+    {
+      error = OMX_FreeBuffer (p_hdl, 0, hdrs[i]);
+      fail_if (OMX_ErrorNone != error);
+    }
+
+  error = _ctx_wait (&ctx, TIMEOUT_EXPECTING_SUCCESS, &timedout);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (OMX_TRUE == timedout);
+  fail_if (OMX_StateLoaded != p_ctx->state);
+
+  error = OMX_FreeHandle (p_hdl);
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_Deinit ();
+  fail_if (OMX_ErrorNone != error);
+
+  _ctx_destroy(&ctx);
+}
+END_TEST
+
 START_TEST (test_tizonia_command_cancellation_loaded_to_idle_no_buffers)
 {
   OMX_ERRORTYPE error = OMX_ErrorNone;
@@ -2050,7 +2501,13 @@ tiz_suite (void)
   tcase_add_test (tc_tizonia, test_tizonia_gethandle_freehandle);
   tcase_add_test (tc_tizonia, test_tizonia_getparameter);
   tcase_add_test (tc_tizonia, test_tizonia_roles);
+  tcase_add_test (tc_tizonia, test_tizonia_pcmpack);
+  tcase_add_test (tc_tizonia, test_tizonia_pcmpack_rounding);
+  tcase_add_test (tc_tizonia, test_tizonia_pkt_store);
+  tcase_add_test (tc_tizonia, test_tizonia_sched_hist_buckets);
+  tcase_add_test (tc_tizonia, test_tizonia_sched_hist_percentile);
   tcase_add_test (tc_tizonia, test_tizonia_preannouncements_extension);
+  tcase_add_test (tc_tizonia, test_tizonia_efb_batch);
   /* TEST DISABLED */
 /*   tcase_add_test (tc_tizonia, */
 /*                   test_tizonia_move_to_exe_and_transfer_with_allocbuffer); */
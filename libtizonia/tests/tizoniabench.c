@@ -0,0 +1,758 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizoniabench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Microbenchmarks for libtizonia
+ *
+ * Measures the cost of component instantiation (time, and resident memory
+ * per live component), of the component entry points and of buffer delivery
+ * (one header at a time and batched), the context switches and memory of a
+ * thread per component vs the scheduler pool, using the test component and
+ * the same tizonia.conf as the unit tests, and the realtime factor of the
+ * decoders' PCM packing helpers. Not part of 'make check': 'make bench'
+ * builds and runs it.
+ *
+ * Usage: tizonia-bench [-b name prefix]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <OMX_Component.h>
+#include <OMX_Core.h>
+
+#include <tizplatform.h>
+
+#include "tizscheduler.h"
+#include "tizpcmpack.h"
+
+#include "check_tizonia.h"
+
+#define COMPONENT_NAME "OMX.Aratelia.tizonia.test_component"
+
+#define GETCONFIG_BENCH_ITERATIONS 100000
+
+#define GETHANDLE_BENCH_ITERATIONS 200
+#define GETHANDLE_BENCH_LIVE 16
+
+/* 256 frames of 16-bit stereo, i.e. the test component's minimum buffer
+   size */
+#define EFB_BENCH_FRAMES 256
+#define EFB_BENCH_BUFFERS 8
+#define EFB_BENCH_ROUNDS 2000
+#define EFB_BENCH_TIMEOUT_MS 1000
+
+/* Test components fed at the same time, each with the efb workload */
+#define SCHED_BENCH_COMPONENTS 8
+#define SCHED_BENCH_ROUNDS 500
+#define SCHED_BENCH_POOL_THREADS "2"
+
+/* A decoder's worth of output per call */
+#define PCMPACK_BENCH_RATE 44100
+#define PCMPACK_BENCH_FRAMES 4608
+#define PCMPACK_BENCH_ITERATIONS 2000
+
+typedef int (*bench_body_f) (void);
+
+typedef struct bench_case bench_case_t;
+struct bench_case
+{
+  const char * p_name;
+  bench_body_f pf_body;
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+report (const char * ap_name, const long a_ops, const double a_secs)
+{
+  fprintf (stdout, "%-32s %10ld %8.3f %12.0f\n", ap_name, a_ops, a_secs,
+           a_secs > 0 ? a_ops / a_secs : 0);
+}
+
+static OMX_ERRORTYPE
+bench_EventHandler (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                    OMX_EVENTTYPE a_event, OMX_U32 a_data1, OMX_U32 a_data2,
+                    OMX_PTR ap_event_data)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+bench_BufferDone (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                  OMX_BUFFERHEADERTYPE * ap_buf)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE bench_cbacks
+  = {bench_EventHandler, bench_BufferDone, bench_BufferDone};
+
+/*
+ * OMX_GetConfig / OMX_GetParameter, i.e. the managing port look-up
+ */
+
+static int
+bench_getconfig (void)
+{
+  OMX_HANDLETYPE p_hdl = NULL;
+  OMX_PRIORITYMGMTTYPE prio;
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  double start = 0;
+  int i = 0;
+
+  if (OMX_ErrorNone
+      != OMX_GetHandle (&p_hdl, COMPONENT_NAME, NULL, &bench_cbacks))
+    {
+      return -1;
+    }
+
+  /* A config port index */
+  prio.nSize = sizeof (OMX_PRIORITYMGMTTYPE);
+  prio.nVersion.nVersion = OMX_VERSION;
+  start = now_secs ();
+  for (i = 0; i < GETCONFIG_BENCH_ITERATIONS; ++i)
+    {
+      if (OMX_ErrorNone
+          != OMX_GetConfig (p_hdl, OMX_IndexConfigPriorityMgmt, &prio))
+        {
+          break;
+        }
+    }
+  report ("getconfig.priority_mgmt", i, now_secs () - start);
+
+  /* A regular port index */
+  port_def.nSize = sizeof (OMX_PARAM_PORTDEFINITIONTYPE);
+  port_def.nVersion.nVersion = OMX_VERSION;
+  port_def.nPortIndex = 0;
+  start = now_secs ();
+  for (i = 0; i < GETCONFIG_BENCH_ITERATIONS; ++i)
+    {
+      if (OMX_ErrorNone
+          != OMX_GetParameter (p_hdl, OMX_IndexParamPortDefinition, &port_def))
+        {
+          break;
+        }
+    }
+  report ("getparameter.port_definition", i, now_secs () - start);
+
+  (void) OMX_FreeHandle (p_hdl);
+  return i == GETCONFIG_BENCH_ITERATIONS ? 0 : -1;
+}
+
+/*
+ * OMX_GetHandle / OMX_FreeHandle, i.e. component instantiation, and the
+ * resident memory a live component adds
+ */
+
+static long
+rss_kbytes (void)
+{
+  long pages = 0;
+  long rss = 0;
+  FILE * p_file = fopen ("/proc/self/statm", "r");
+  if (p_file)
+    {
+      if (2 != fscanf (p_file, "%ld %ld", &pages, &rss))
+        {
+          rss = 0;
+        }
+      fclose (p_file);
+    }
+  return rss * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static int
+bench_gethandle (void)
+{
+  OMX_HANDLETYPE hdls[GETHANDLE_BENCH_LIVE];
+  double start = 0;
+  long rss_before = 0;
+  int i = 0;
+  int live = 0;
+
+  start = now_secs ();
+  for (i = 0; i < GETHANDLE_BENCH_ITERATIONS; ++i)
+    {
+      OMX_HANDLETYPE p_hdl = NULL;
+      if (OMX_ErrorNone
+          != OMX_GetHandle (&p_hdl, COMPONENT_NAME, NULL, &bench_cbacks))
+        {
+          break;
+        }
+      (void) OMX_FreeHandle (p_hdl);
+    }
+  report ("gethandle.get_free", i, now_secs () - start);
+
+  rss_before = rss_kbytes ();
+  for (live = 0; live < GETHANDLE_BENCH_LIVE; ++live)
+    {
+      hdls[live] = NULL;
+      if (OMX_ErrorNone
+          != OMX_GetHandle (&hdls[live], COMPONENT_NAME, NULL, &bench_cbacks))
+        {
+          break;
+        }
+    }
+  fprintf (stdout, "%-32s %10d %8s %12ld\n", "gethandle.rss_kb_per_component",
+           live, "-", live > 0 ? (rss_kbytes () - rss_before) / live : 0);
+  while (live > 0)
+    {
+      (void) OMX_FreeHandle (hdls[--live]);
+    }
+
+  return i == GETHANDLE_BENCH_ITERATIONS ? 0 : -1;
+}
+
+/*
+ * OMX_EmptyThisBuffer vs tiz_comp_empty_fill_buffers
+ */
+
+typedef struct bench_efb_ctx bench_efb_ctx_t;
+struct bench_efb_ctx
+{
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  OMX_STATETYPE state;
+  OMX_U32 nbufs;
+};
+
+static OMX_ERRORTYPE
+bench_efb_EventHandler (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                        OMX_EVENTTYPE a_event, OMX_U32 a_data1,
+                        OMX_U32 a_data2, OMX_PTR ap_event_data)
+{
+  bench_efb_ctx_t * p_ctx = ap_app_data;
+  assert (p_ctx);
+  if (OMX_EventCmdComplete == a_event && OMX_CommandStateSet == a_data1)
+    {
+      tiz_mutex_lock (&p_ctx->mutex);
+      p_ctx->state = (OMX_STATETYPE) a_data2;
+      tiz_cond_signal (&p_ctx->cond);
+      tiz_mutex_unlock (&p_ctx->mutex);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+bench_efb_EmptyBufferDone (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                           OMX_BUFFERHEADERTYPE * ap_buf)
+{
+  bench_efb_ctx_t * p_ctx = ap_app_data;
+  assert (p_ctx);
+  tiz_mutex_lock (&p_ctx->mutex);
+  if (++p_ctx->nbufs == EFB_BENCH_BUFFERS)
+    {
+      tiz_cond_signal (&p_ctx->cond);
+    }
+  tiz_mutex_unlock (&p_ctx->mutex);
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE bench_efb_cbacks
+  = {bench_efb_EventHandler, bench_efb_EmptyBufferDone, bench_BufferDone};
+
+static int
+efb_wait_state (bench_efb_ctx_t * ap_ctx, const OMX_STATETYPE a_state)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  tiz_mutex_lock (&ap_ctx->mutex);
+  while (a_state != ap_ctx->state && OMX_ErrorNone == rc)
+    {
+      rc = tiz_cond_timedwait (&ap_ctx->cond, &ap_ctx->mutex,
+                               EFB_BENCH_TIMEOUT_MS);
+    }
+  tiz_mutex_unlock (&ap_ctx->mutex);
+  return a_state == ap_ctx->state ? 0 : -1;
+}
+
+static int
+efb_wait_buffers (bench_efb_ctx_t * ap_ctx)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  int ret = 0;
+  tiz_mutex_lock (&ap_ctx->mutex);
+  while (ap_ctx->nbufs < EFB_BENCH_BUFFERS && OMX_ErrorNone == rc)
+    {
+      rc = tiz_cond_timedwait (&ap_ctx->cond, &ap_ctx->mutex,
+                               EFB_BENCH_TIMEOUT_MS);
+    }
+  ret = ap_ctx->nbufs == EFB_BENCH_BUFFERS ? 0 : -1;
+  ap_ctx->nbufs = 0;
+  tiz_mutex_unlock (&ap_ctx->mutex);
+  return ret;
+}
+
+static double
+cpu_seconds (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static int
+run_efb_rounds (OMX_HANDLETYPE ap_hdl, bench_efb_ctx_t * ap_ctx,
+                OMX_BUFFERHEADERTYPE ** app_hdrs, const OMX_BOOL a_batched)
+{
+  const long nbufs = EFB_BENCH_BUFFERS * EFB_BENCH_ROUNDS;
+  const double start = now_secs ();
+  double cpu = cpu_seconds ();
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  int i, j;
+
+  for (i = 0; i < EFB_BENCH_ROUNDS && OMX_ErrorNone == error; ++i)
+    {
+      if (a_batched)
+        {
+          error = tiz_comp_empty_fill_buffers (ap_hdl, OMX_DirInput, app_hdrs,
+                                               EFB_BENCH_BUFFERS, NULL);
+        }
+      else
+        {
+          for (j = 0; j < EFB_BENCH_BUFFERS && OMX_ErrorNone == error; ++j)
+            {
+              error = OMX_EmptyThisBuffer (ap_hdl, app_hdrs[j]);
+            }
+        }
+      if (OMX_ErrorNone != error || efb_wait_buffers (ap_ctx) < 0)
+        {
+          return -1;
+        }
+    }
+  cpu = cpu_seconds () - cpu;
+
+  report (a_batched ? "efb.batched" : "efb.one_by_one", nbufs,
+          now_secs () - start);
+  fprintf (stdout, "%-32s %10s %8.3f %12.2f us/buffer\n", "  cpu", "", cpu,
+           cpu * 1e6 / nbufs);
+  return 0;
+}
+
+static int
+efb_start (bench_efb_ctx_t * ap_ctx, OMX_HANDLETYPE * ap_hdl,
+           OMX_BUFFERHEADERTYPE ** app_hdrs, OMX_U32 * ap_nhdrs)
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+
+  memset (ap_ctx, 0, sizeof (bench_efb_ctx_t));
+  ap_ctx->state = OMX_StateLoaded;
+  *ap_hdl = NULL;
+  *ap_nhdrs = 0;
+  if (OMX_ErrorNone != tiz_mutex_init (&ap_ctx->mutex))
+    {
+      return -1;
+    }
+  if (OMX_ErrorNone != tiz_cond_init (&ap_ctx->cond))
+    {
+      tiz_mutex_destroy (&ap_ctx->mutex);
+      return -1;
+    }
+
+  if (OMX_ErrorNone
+      != OMX_GetHandle (ap_hdl, COMPONENT_NAME, ap_ctx, &bench_efb_cbacks))
+    {
+      return -1;
+    }
+
+  port_def.nSize = sizeof (OMX_PARAM_PORTDEFINITIONTYPE);
+  port_def.nVersion.nVersion = OMX_VERSION;
+  port_def.nPortIndex = 0;
+  if (OMX_ErrorNone
+      != OMX_GetParameter (*ap_hdl, OMX_IndexParamPortDefinition, &port_def))
+    {
+      return -1;
+    }
+  port_def.nBufferCountActual = EFB_BENCH_BUFFERS;
+  if (OMX_ErrorNone
+        != OMX_SetParameter (*ap_hdl, OMX_IndexParamPortDefinition, &port_def)
+      || OMX_ErrorNone
+           != OMX_SendCommand (*ap_hdl, OMX_CommandStateSet, OMX_StateIdle,
+                               NULL))
+    {
+      return -1;
+    }
+
+  for (*ap_nhdrs = 0; *ap_nhdrs < EFB_BENCH_BUFFERS; ++(*ap_nhdrs))
+    {
+      OMX_BUFFERHEADERTYPE ** pp_hdr = &app_hdrs[*ap_nhdrs];
+      if (OMX_ErrorNone
+          != OMX_AllocateBuffer (*ap_hdl, pp_hdr, 0, 0,
+                                 EFB_BENCH_FRAMES * 2 * sizeof (OMX_S16)))
+        {
+          return -1;
+        }
+      (*pp_hdr)->nFilledLen = (*pp_hdr)->nAllocLen;
+    }
+
+  if (efb_wait_state (ap_ctx, OMX_StateIdle) < 0
+      || OMX_ErrorNone
+           != OMX_SendCommand (*ap_hdl, OMX_CommandStateSet,
+                               OMX_StateExecuting, NULL)
+      || efb_wait_state (ap_ctx, OMX_StateExecuting) < 0)
+    {
+      return -1;
+    }
+
+  return 0;
+}
+
+static void
+efb_stop (bench_efb_ctx_t * ap_ctx, OMX_HANDLETYPE ap_hdl,
+          OMX_BUFFERHEADERTYPE ** app_hdrs, OMX_U32 a_nhdrs)
+{
+  if (ap_hdl && OMX_StateExecuting == ap_ctx->state)
+    {
+      (void) OMX_SendCommand (ap_hdl, OMX_CommandStateSet, OMX_StateIdle,
+                              NULL);
+      (void) efb_wait_state (ap_ctx, OMX_StateIdle);
+    }
+  if (ap_hdl && OMX_StateIdle == ap_ctx->state)
+    {
+      (void) OMX_SendCommand (ap_hdl, OMX_CommandStateSet, OMX_StateLoaded,
+                              NULL);
+    }
+  while (a_nhdrs > 0)
+    {
+      (void) OMX_FreeBuffer (ap_hdl, 0, app_hdrs[--a_nhdrs]);
+    }
+  if (ap_hdl)
+    {
+      (void) efb_wait_state (ap_ctx, OMX_StateLoaded);
+      (void) OMX_FreeHandle (ap_hdl);
+    }
+  if (ap_ctx->cond)
+    {
+      tiz_cond_destroy (&ap_ctx->cond);
+    }
+  if (ap_ctx->mutex)
+    {
+      tiz_mutex_destroy (&ap_ctx->mutex);
+    }
+}
+
+static int
+bench_efb (void)
+{
+  bench_efb_ctx_t ctx;
+  OMX_HANDLETYPE p_hdl = NULL;
+  OMX_BUFFERHEADERTYPE * hdrs[EFB_BENCH_BUFFERS];
+  OMX_U32 nhdrs = 0;
+  int rc = -1;
+
+  if (0 == efb_start (&ctx, &p_hdl, hdrs, &nhdrs)
+      && 0 == run_efb_rounds (p_hdl, &ctx, hdrs, OMX_FALSE)
+      && 0 == run_efb_rounds (p_hdl, &ctx, hdrs, OMX_TRUE))
+    {
+      rc = 0;
+    }
+  efb_stop (&ctx, p_hdl, hdrs, nhdrs);
+  return rc;
+}
+
+/*
+ * A thread per component vs the scheduler pool: several components fed at
+ * the same time, and the context switches and memory that each mode costs
+ */
+
+static long
+context_switches (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+static int
+run_sched_mode (const char * ap_name, const char * ap_pool_threads)
+{
+  bench_efb_ctx_t ctxs[SCHED_BENCH_COMPONENTS];
+  OMX_HANDLETYPE hdls[SCHED_BENCH_COMPONENTS];
+  OMX_BUFFERHEADERTYPE * hdrs[SCHED_BENCH_COMPONENTS][EFB_BENCH_BUFFERS];
+  OMX_U32 nhdrs[SCHED_BENCH_COMPONENTS];
+  const long nbufs
+    = (long) SCHED_BENCH_COMPONENTS * EFB_BENCH_BUFFERS * SCHED_BENCH_ROUNDS;
+  long rss = rss_kbytes ();
+  long csw = 0;
+  double start = 0;
+  double cpu = 0;
+  int live = 0;
+  int rc = -1;
+  int i, c, j;
+
+  /* Read when the pool is created, i.e. while no component is alive */
+  setenv ("TIZONIA_SCHEDULER_POOL_THREADS", ap_pool_threads, 1);
+
+  for (live = 0; live < SCHED_BENCH_COMPONENTS; ++live)
+    {
+      if (efb_start (&ctxs[live], &hdls[live], hdrs[live], &nhdrs[live]) < 0)
+        {
+          ++live;
+          goto end;
+        }
+    }
+  rss = rss_kbytes () - rss;
+
+  start = now_secs ();
+  cpu = cpu_seconds ();
+  csw = context_switches ();
+  for (i = 0; i < SCHED_BENCH_ROUNDS; ++i)
+    {
+      for (c = 0; c < SCHED_BENCH_COMPONENTS; ++c)
+        {
+          for (j = 0; j < EFB_BENCH_BUFFERS; ++j)
+            {
+              if (OMX_ErrorNone != OMX_EmptyThisBuffer (hdls[c], hdrs[c][j]))
+                {
+                  goto end;
+                }
+            }
+        }
+      for (c = 0; c < SCHED_BENCH_COMPONENTS; ++c)
+        {
+          if (efb_wait_buffers (&ctxs[c]) < 0)
+            {
+              goto end;
+            }
+        }
+    }
+  cpu = cpu_seconds () - cpu;
+  csw = context_switches () - csw;
+
+  report (ap_name, nbufs, now_secs () - start);
+  fprintf (stdout, "%-32s %10s %8.3f %12.2f us/buffer\n", "  cpu", "", cpu,
+           cpu * 1e6 / nbufs);
+  fprintf (stdout, "%-32s %10ld %8s %12.2f per buffer\n",
+           "  context switches", csw, "", (double) csw / nbufs);
+  fprintf (stdout, "%-32s %10s %8s %12ld kB/component\n", "  rss", "", "",
+           rss / SCHED_BENCH_COMPONENTS);
+  rc = 0;
+
+end:
+  while (live > 0)
+    {
+      --live;
+      efb_stop (&ctxs[live], hdls[live], hdrs[live], nhdrs[live]);
+    }
+  unsetenv ("TIZONIA_SCHEDULER_POOL_THREADS");
+  return rc;
+}
+
+static int
+bench_sched (void)
+{
+  if (run_sched_mode ("sched.thread_per_component", "0") < 0
+      || run_sched_mode ("sched.pool", SCHED_BENCH_POOL_THREADS) < 0)
+    {
+      return -1;
+    }
+  return 0;
+}
+
+/*
+ * PCM packing, as done by the decoders
+ */
+
+static void
+report_pcmpack_rtf (const char * ap_name, const double a_start)
+{
+  const double elapsed = now_secs () - a_start;
+  const double audio = (double) PCMPACK_BENCH_FRAMES * PCMPACK_BENCH_ITERATIONS
+                       / PCMPACK_BENCH_RATE;
+  report (ap_name, (long) PCMPACK_BENCH_FRAMES * PCMPACK_BENCH_ITERATIONS,
+          elapsed);
+  fprintf (stdout, "%-32s %10s %8.1f %12.0f x realtime\n", "  audio secs", "",
+           audio, elapsed > 0 ? audio / elapsed : 0);
+}
+
+static int
+bench_pcmpack (void)
+{
+  int32_t * p_left = tiz_mem_alloc (PCMPACK_BENCH_FRAMES * sizeof (int32_t));
+  int32_t * p_right = tiz_mem_alloc (PCMPACK_BENCH_FRAMES * sizeof (int32_t));
+  float * p_float = tiz_mem_alloc (2 * PCMPACK_BENCH_FRAMES * sizeof (float));
+  uint8_t * p_out = tiz_mem_alloc (2 * PCMPACK_BENCH_FRAMES * 4);
+  const int32_t * planar[2] = {p_left, p_right};
+  tiz_pcm_dither_t dither;
+  double start = 0;
+  int rc = -1;
+  int i = 0;
+
+  if (!p_left || !p_right || !p_float || !p_out)
+    {
+      goto end;
+    }
+
+  for (i = 0; i < PCMPACK_BENCH_FRAMES; ++i)
+    {
+      p_left[i] = (i * 7919) % 65536 - 32768;
+      p_right[i] = -p_left[i];
+      p_float[2 * i] = p_left[i] / 32768.0f;
+      p_float[2 * i + 1] = p_right[i] / 32768.0f;
+    }
+
+  /* FLAC, 16-bit stereo */
+  start = now_secs ();
+  for (i = 0; i < PCMPACK_BENCH_ITERATIONS; ++i)
+    {
+      tiz_pcm_pack_s32 (p_out, planar, PCMPACK_BENCH_FRAMES, 2, 16,
+                        TIZ_PCM_FMT_S16_LE, NULL);
+    }
+  report_pcmpack_rtf ("pcmpack.flac_s16", start);
+
+  /* FLAC, 24-bit stereo */
+  start = now_secs ();
+  for (i = 0; i < PCMPACK_BENCH_ITERATIONS; ++i)
+    {
+      tiz_pcm_pack_s32 (p_out, planar, PCMPACK_BENCH_FRAMES, 2, 24,
+                        TIZ_PCM_FMT_S24_LE, NULL);
+    }
+  report_pcmpack_rtf ("pcmpack.flac_s24", start);
+
+  /* MP3, mad fixed point to big endian S16, with and without dither */
+  start = now_secs ();
+  for (i = 0; i < PCMPACK_BENCH_ITERATIONS; ++i)
+    {
+      tiz_pcm_pack_fixed (p_out, planar, PCMPACK_BENCH_FRAMES, 2, 28,
+                          TIZ_PCM_FMT_S16_BE, NULL);
+    }
+  report_pcmpack_rtf ("pcmpack.mp3", start);
+
+  tiz_pcm_dither_init (&dither, 1);
+  start = now_secs ();
+  for (i = 0; i < PCMPACK_BENCH_ITERATIONS; ++i)
+    {
+      tiz_pcm_pack_fixed (p_out, planar, PCMPACK_BENCH_FRAMES, 2, 28,
+                          TIZ_PCM_FMT_S16_BE, &dither);
+    }
+  report_pcmpack_rtf ("pcmpack.mp3_dithered", start);
+
+  /* Vorbis, interleaved float passthrough */
+  start = now_secs ();
+  for (i = 0; i < PCMPACK_BENCH_ITERATIONS; ++i)
+    {
+      tiz_pcm_pack_float_ilv (p_out, p_float, PCMPACK_BENCH_FRAMES, 2,
+                              TIZ_PCM_FMT_F32, NULL);
+    }
+  report_pcmpack_rtf ("pcmpack.vorbis", start);
+
+  /* Opus, interleaved float to S16 */
+  start = now_secs ();
+  for (i = 0; i < PCMPACK_BENCH_ITERATIONS; ++i)
+    {
+      tiz_pcm_pack_float_ilv (p_out, p_float, PCMPACK_BENCH_FRAMES, 2,
+                              TIZ_PCM_FMT_S16_LE, NULL);
+    }
+  report_pcmpack_rtf ("pcmpack.opus", start);
+  rc = 0;
+
+end:
+  tiz_mem_free (p_left);
+  tiz_mem_free (p_right);
+  tiz_mem_free (p_float);
+  tiz_mem_free (p_out);
+  return rc;
+}
+
+static const bench_case_t bench_cases[] = {
+  {"getconfig", bench_getconfig},
+  {"gethandle", bench_gethandle},
+  {"efb", bench_efb},
+  {"sched", bench_sched},
+  {"pcmpack", bench_pcmpack},
+};
+
+#define BENCH_NUM_CASES (sizeof (bench_cases) / sizeof (bench_cases[0]))
+
+int
+main (int argc, char ** argv)
+{
+  const char * p_prefix = NULL;
+  int failed = 0;
+  size_t c = 0;
+  int opt = 0;
+
+  while ((opt = getopt (argc, argv, "b:")) != -1)
+    {
+      switch (opt)
+        {
+          case 'b':
+            p_prefix = optarg;
+            break;
+          default:
+            fprintf (stderr, "Usage: %s [-b name prefix]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  putenv (TIZ_PLATFORM_RC_FILE_ENV);
+  tiz_log_init ();
+
+  if (OMX_ErrorNone != OMX_Init ())
+    {
+      fprintf (stderr, "Could not initialise the IL core\n");
+      return EXIT_FAILURE;
+    }
+
+  fprintf (stdout, "%-32s %10s %8s %12s\n", "name", "ops", "secs", "ops/s");
+  for (c = 0; c < BENCH_NUM_CASES; ++c)
+    {
+      if (p_prefix
+          && 0 != strncmp (bench_cases[c].p_name, p_prefix, strlen (p_prefix)))
+        {
+          continue;
+        }
+      if (bench_cases[c].pf_body () < 0)
+        {
+          fprintf (stderr, "%s: failed\n", bench_cases[c].p_name);
+          ++failed;
+        }
+    }
+
+  (void) OMX_Deinit ();
+  tiz_log_deinit ();
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make bench" */
+/* End: */
@@ -0,0 +1,1245 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizplatformbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Microbenchmarks for the libtizplatform primitives
+ *
+ * Measures the throughput and per-operation latency of the queues, the
+ * small object and slab allocators, the map, the vector, the dynamic buffer,
+ * the event loop's watchers and the HTTP parser.
+ *
+ * Containers that are not thread-safe (everything but tiz_queue_t) are
+ * measured on one thread, and then on several threads that each use their
+ * own instance, which shows how they scale (e.g. contention in the memory
+ * allocator). tiz_queue_t is measured between threads, and so are objects
+ * that are allocated on one thread and freed on another.
+ *
+ * Operations run in batches; each batch is timed, and the latency
+ * percentiles are those of the per-operation time of the batches (round
+ * trips are timed one by one).
+ *
+ * Usage: tizplatform-bench [-f text|json|csv] [-s scale] [-t threads]
+ *                          [-b name prefix] [-o file]
+ *
+ * The json and csv formats are meant to be stored, and compared between
+ * releases.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+#include "http-parser/http_parser.h"
+
+#define BENCH_BATCH 64
+#define BENCH_MAX_THREADS 64
+#define BENCH_MAX_SAMPLES (64 * 1024)
+#define BENCH_BUFFER_CHUNK 4096
+#define BENCH_MAP_BACKGROUND 1024
+#define BENCH_PQUEUE_MAX_PRIO 4
+
+typedef struct bench_thread bench_thread_t;
+typedef int (*bench_body_f) (bench_thread_t * ap_thr);
+
+struct bench_thread
+{
+  int index;
+  int nthreads;
+  long ops;      /* operations this thread runs */
+  long done;     /* operations measured so far */
+  void * p_shared;
+  double * p_samples; /* ns per operation, one per batch */
+  size_t nsamples;
+  double start;
+  double end;
+  pthread_barrier_t * p_barrier;
+  bench_body_f pf_body;
+  int rc;
+};
+
+typedef struct bench_case bench_case_t;
+struct bench_case
+{
+  const char * p_name;
+  bench_body_f pf_body;
+  long ops;            /* per thread, at scale 1 */
+  int fixed_threads;   /* 0: run with 1 thread and with -t threads */
+  size_t bytes_per_op; /* 0 when throughput in bytes is meaningless */
+  void * (*pf_shared_init) (int a_nthreads);
+  void (*pf_shared_destroy) (void * ap_shared);
+};
+
+typedef enum bench_format
+{
+  EBenchFormatText,
+  EBenchFormatJson,
+  EBenchFormatCsv
+} bench_format_t;
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Called by a body once its set up is done: every thread starts together */
+static void
+bench_go (bench_thread_t * ap_thr)
+{
+  pthread_barrier_wait (ap_thr->p_barrier);
+  ap_thr->start = now_ns ();
+}
+
+/* Called by a body before it tears down */
+static void
+bench_stop (bench_thread_t * ap_thr)
+{
+  ap_thr->end = now_ns ();
+}
+
+static inline void
+bench_sample (bench_thread_t * ap_thr, const double a_start, const long a_nops)
+{
+  if (ap_thr->nsamples < BENCH_MAX_SAMPLES)
+    {
+      ap_thr->p_samples[ap_thr->nsamples++] = (now_ns () - a_start) / a_nops;
+    }
+  ap_thr->done += a_nops;
+}
+
+/*
+ * tiz_queue_t
+ */
+
+typedef struct bench_queues bench_queues_t;
+struct bench_queues
+{
+  tiz_queue_t * p_q;
+  tiz_queue_t * p_reply;
+};
+
+static void *
+queues_init (int a_nthreads)
+{
+  bench_queues_t * p_qs = calloc (1, sizeof (bench_queues_t));
+  (void) a_nthreads;
+  if (p_qs
+      && (OMX_ErrorNone != tiz_queue_init (&(p_qs->p_q), 1024)
+          || OMX_ErrorNone != tiz_queue_init (&(p_qs->p_reply), 1024)))
+    {
+      tiz_queue_destroy (p_qs->p_q);
+      free (p_qs);
+      p_qs = NULL;
+    }
+  return p_qs;
+}
+
+static void
+queues_destroy (void * ap_shared)
+{
+  bench_queues_t * p_qs = ap_shared;
+  if (p_qs)
+    {
+      tiz_queue_destroy (p_qs->p_q);
+      tiz_queue_destroy (p_qs->p_reply);
+      free (p_qs);
+    }
+}
+
+/* Send and receive on the same thread, the queue never blocks */
+static int
+bench_queue_send_receive (bench_thread_t * ap_thr)
+{
+  tiz_queue_t * p_q = NULL;
+  OMX_PTR p_data = NULL;
+  int i = 0;
+
+  if (OMX_ErrorNone != tiz_queue_init (&p_q, BENCH_BATCH))
+    {
+      return -1;
+    }
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          (void) tiz_queue_send (p_q, (OMX_PTR) (intptr_t) (i + 1));
+        }
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          (void) tiz_queue_receive (p_q, &p_data);
+        }
+      bench_sample (ap_thr, start, 2 * BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  tiz_queue_destroy (p_q);
+  return 0;
+}
+
+/* Thread 0 receives what the other threads send */
+static int
+bench_queue_fan_in (bench_thread_t * ap_thr)
+{
+  bench_queues_t * p_qs = ap_thr->p_shared;
+  OMX_PTR p_data = NULL;
+  long i = 0;
+
+  bench_go (ap_thr);
+  if (0 == ap_thr->index)
+    {
+      const long total = ap_thr->ops * (ap_thr->nthreads - 1);
+      while (ap_thr->done < total)
+        {
+          const long n = total - ap_thr->done < BENCH_BATCH
+                           ? total - ap_thr->done
+                           : BENCH_BATCH;
+          const double start = now_ns ();
+          for (i = 0; i < n; ++i)
+            {
+              (void) tiz_queue_receive (p_qs->p_q, &p_data);
+            }
+          bench_sample (ap_thr, start, n);
+        }
+    }
+  else
+    {
+      for (i = 0; i < ap_thr->ops; ++i)
+        {
+          (void) tiz_queue_send (p_qs->p_q, (OMX_PTR) (intptr_t) (i + 1));
+        }
+    }
+  bench_stop (ap_thr);
+  return 0;
+}
+
+/* Thread 0 sends an item and waits for thread 1 to send it back */
+static int
+bench_queue_ping_pong (bench_thread_t * ap_thr)
+{
+  bench_queues_t * p_qs = ap_thr->p_shared;
+  OMX_PTR p_data = NULL;
+  long i = 0;
+
+  bench_go (ap_thr);
+  if (0 == ap_thr->index)
+    {
+      while (ap_thr->done < ap_thr->ops)
+        {
+          const double start = now_ns ();
+          (void) tiz_queue_send (p_qs->p_q, (OMX_PTR) (intptr_t) 1);
+          (void) tiz_queue_receive (p_qs->p_reply, &p_data);
+          bench_sample (ap_thr, start, 1);
+        }
+    }
+  else
+    {
+      for (i = 0; i < ap_thr->ops; ++i)
+        {
+          (void) tiz_queue_receive (p_qs->p_q, &p_data);
+          (void) tiz_queue_send (p_qs->p_reply, p_data);
+        }
+    }
+  bench_stop (ap_thr);
+  return 0;
+}
+
+/*
+ * tiz_pqueue_t
+ */
+
+static OMX_S32
+pqueue_cmp (void * ap_left, void * ap_right)
+{
+  return (OMX_S32) ((intptr_t) ap_left - (intptr_t) ap_right);
+}
+
+static int
+bench_pqueue_send_receive (bench_thread_t * ap_thr)
+{
+  tiz_pqueue_t * p_pq = NULL;
+  void * p_data = NULL;
+  int i = 0;
+
+  if (OMX_ErrorNone
+      != tiz_pqueue_init (&p_pq, BENCH_PQUEUE_MAX_PRIO, pqueue_cmp, NULL,
+                          "bench"))
+    {
+      return -1;
+    }
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          (void) tiz_pqueue_send (p_pq, (void *) (intptr_t) (i + 1),
+                                  i % (BENCH_PQUEUE_MAX_PRIO + 1));
+        }
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          (void) tiz_pqueue_receive (p_pq, &p_data);
+        }
+      bench_sample (ap_thr, start, 2 * BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  tiz_pqueue_destroy (p_pq);
+  return 0;
+}
+
+/*
+ * tiz_soa_t, and tiz_mem_calloc as a baseline
+ */
+
+/* Sizes that fall in each of the allocator's chunk classes */
+static const size_t bench_object_sizes[] = {16, 40, 72, 104, 200};
+#define BENCH_NUM_OBJECT_SIZES \
+  (sizeof (bench_object_sizes) / sizeof (bench_object_sizes[0]))
+
+static int
+bench_soa_calloc_free (bench_thread_t * ap_thr)
+{
+  tiz_soa_t * p_soa = NULL;
+  void * objs[BENCH_BATCH];
+  int i = 0;
+
+  if (OMX_ErrorNone != tiz_soa_init (&p_soa))
+    {
+      return -1;
+    }
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          objs[i] = tiz_soa_calloc (
+            p_soa, bench_object_sizes[i % BENCH_NUM_OBJECT_SIZES]);
+        }
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          tiz_soa_free (p_soa, objs[i]);
+        }
+      bench_sample (ap_thr, start, 2 * BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  tiz_soa_destroy (p_soa);
+  return 0;
+}
+
+static int
+bench_mem_calloc_free (bench_thread_t * ap_thr)
+{
+  void * objs[BENCH_BATCH];
+  int i = 0;
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          objs[i]
+            = tiz_mem_calloc (1, bench_object_sizes[i % BENCH_NUM_OBJECT_SIZES]);
+        }
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          tiz_mem_free (objs[i]);
+        }
+      bench_sample (ap_thr, start, 2 * BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  return 0;
+}
+
+static int
+bench_slab_calloc_free (bench_thread_t * ap_thr)
+{
+  void * objs[BENCH_BATCH];
+  int i = 0;
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          objs[i]
+            = tiz_slab_calloc (bench_object_sizes[i % BENCH_NUM_OBJECT_SIZES]);
+        }
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          tiz_slab_free (objs[i]);
+        }
+      bench_sample (ap_thr, start, 2 * BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  tiz_slab_thread_flush ();
+  return 0;
+}
+
+static void *
+mem_calloc_one (size_t a_size)
+{
+  return tiz_mem_calloc (1, a_size);
+}
+
+/* Thread 0 frees the objects that the other threads allocate, the way
+   scheduler and event loop messages travel */
+static int
+bench_xthread_free (bench_thread_t * ap_thr, void * (*apf_calloc) (size_t),
+                    void (*apf_free) (void *))
+{
+  bench_queues_t * p_qs = ap_thr->p_shared;
+  OMX_PTR p_data = NULL;
+  long i = 0;
+
+  bench_go (ap_thr);
+  if (0 == ap_thr->index)
+    {
+      const long total = ap_thr->ops * (ap_thr->nthreads - 1);
+      while (ap_thr->done < total)
+        {
+          const long n = total - ap_thr->done < BENCH_BATCH
+                           ? total - ap_thr->done
+                           : BENCH_BATCH;
+          const double start = now_ns ();
+          for (i = 0; i < n; ++i)
+            {
+              (void) tiz_queue_receive (p_qs->p_q, &p_data);
+              apf_free (p_data);
+            }
+          bench_sample (ap_thr, start, n);
+        }
+    }
+  else
+    {
+      for (i = 0; i < ap_thr->ops; ++i)
+        {
+          void * p_obj
+            = apf_calloc (bench_object_sizes[i % BENCH_NUM_OBJECT_SIZES]);
+          (void) tiz_queue_send (p_qs->p_q, p_obj);
+        }
+    }
+  bench_stop (ap_thr);
+  return 0;
+}
+
+static int
+bench_slab_xthread_free (bench_thread_t * ap_thr)
+{
+  return bench_xthread_free (ap_thr, tiz_slab_calloc, tiz_slab_free);
+}
+
+static int
+bench_mem_xthread_free (bench_thread_t * ap_thr)
+{
+  return bench_xthread_free (ap_thr, mem_calloc_one, tiz_mem_free);
+}
+
+/*
+ * tiz_map_t
+ */
+
+static OMX_S32
+map_cmp (OMX_PTR ap_key1, OMX_PTR ap_key2)
+{
+  const int left = *(int *) ap_key1;
+  const int right = *(int *) ap_key2;
+  return (left < right) ? -1 : (left > right);
+}
+
+static void
+map_free (OMX_PTR ap_key, OMX_PTR ap_value)
+{
+  (void) ap_key;
+  (void) ap_value;
+}
+
+/* Insert, find and erase a batch of keys in a map of BENCH_MAP_BACKGROUND
+   other keys */
+static int
+bench_map_insert_find_erase (bench_thread_t * ap_thr)
+{
+  tiz_map_t * p_map = NULL;
+  int * p_keys = NULL;
+  OMX_U32 index = 0;
+  int i = 0;
+
+  p_keys = calloc (BENCH_MAP_BACKGROUND + BENCH_BATCH, sizeof (int));
+  if (!p_keys || OMX_ErrorNone != tiz_map_init (&p_map, map_cmp, map_free, NULL))
+    {
+      free (p_keys);
+      return -1;
+    }
+  for (i = 0; i < BENCH_MAP_BACKGROUND + BENCH_BATCH; ++i)
+    {
+      /* Batch keys are interleaved with the background ones */
+      p_keys[i] = i < BENCH_MAP_BACKGROUND
+                    ? 2 * i
+                    : 2 * ((i - BENCH_MAP_BACKGROUND) * 16) + 1;
+    }
+  for (i = 0; i < BENCH_MAP_BACKGROUND; ++i)
+    {
+      (void) tiz_map_insert (p_map, &p_keys[i], &p_keys[i], &index);
+    }
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      int * p_batch = p_keys + BENCH_MAP_BACKGROUND;
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          (void) tiz_map_insert (p_map, &p_batch[i], &p_batch[i], &index);
+        }
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          (void) tiz_map_find (p_map, &p_batch[i]);
+        }
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          tiz_map_erase (p_map, &p_batch[i]);
+        }
+      bench_sample (ap_thr, start, 3 * BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  (void) tiz_map_clear (p_map);
+  tiz_map_destroy (p_map);
+  free (p_keys);
+  return 0;
+}
+
+/*
+ * tiz_vector_t
+ */
+
+static int
+bench_vector_push_at_clear (bench_thread_t * ap_thr)
+{
+  tiz_vector_t * p_vec = NULL;
+  int i = 0;
+
+  if (OMX_ErrorNone != tiz_vector_init (&p_vec, sizeof (OMX_PTR)))
+    {
+      return -1;
+    }
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          OMX_PTR p_item = (OMX_PTR) (intptr_t) (i + 1);
+          (void) tiz_vector_push_back (p_vec, &p_item);
+        }
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          (void) tiz_vector_at (p_vec, (i * 7) % BENCH_BATCH);
+        }
+      tiz_vector_clear (p_vec);
+      bench_sample (ap_thr, start, 2 * BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  tiz_vector_destroy (p_vec);
+  return 0;
+}
+
+/*
+ * tiz_buffer_t
+ */
+
+/* Append a chunk and consume it, the way a decoder's input buffer is used */
+static int
+bench_buffer_push_advance (bench_thread_t * ap_thr)
+{
+  tiz_buffer_t * p_buf = NULL;
+  char chunk[BENCH_BUFFER_CHUNK];
+  int i = 0;
+
+  memset (chunk, 0x5a, sizeof (chunk));
+  if (OMX_ErrorNone != tiz_buffer_init (&p_buf, 4 * BENCH_BUFFER_CHUNK))
+    {
+      return -1;
+    }
+  (void) tiz_buffer_push (p_buf, chunk, BENCH_BUFFER_CHUNK / 2);
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          (void) tiz_buffer_push (p_buf, chunk, BENCH_BUFFER_CHUNK);
+          (void) tiz_buffer_advance (p_buf, BENCH_BUFFER_CHUNK);
+        }
+      bench_sample (ap_thr, start, BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  tiz_buffer_destroy (p_buf);
+  return 0;
+}
+
+/*
+ * HTTP parser
+ */
+
+static const char bench_http_request[]
+  = "GET /stream/metallica.mp3 HTTP/1.1\r\n"
+    "Host: osoton:8010\r\n"
+    "User-Agent: Tizonia/0.22.0\r\n"
+    "Accept: */*\r\n"
+    "Accept-Encoding: identity\r\n"
+    "Connection: keep-alive\r\n"
+    "Icy-MetaData: 1\r\n"
+    "Range: bytes=0-\r\n"
+    "\r\n";
+
+/* tiz_http_parser_t, as used by the HTTP renderer on each request */
+static int
+bench_http_request_parse (bench_thread_t * ap_thr)
+{
+  const size_t len = sizeof (bench_http_request) - 1;
+  int i = 0;
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH; ++i)
+        {
+          tiz_http_parser_t * p_parser = NULL;
+          if (OMX_ErrorNone
+              != tiz_http_parser_init (&p_parser, ETIZHttpParserTypeRequest))
+            {
+              return -1;
+            }
+          if (tiz_http_parser_parse (p_parser, bench_http_request, len)
+                != (int) len
+              || !tiz_http_parser_get_header (p_parser, "Icy-MetaData"))
+            {
+              tiz_http_parser_destroy (p_parser);
+              return -1;
+            }
+          tiz_http_parser_destroy (p_parser);
+        }
+      bench_sample (ap_thr, start, BENCH_BATCH);
+    }
+  bench_stop (ap_thr);
+  return 0;
+}
+
+#define BENCH_HTTP_BODY 16384
+#define BENCH_HTTP_READ 1024
+
+static int
+http_on_body (http_parser * ap_parser, const char * ap_at, size_t a_len)
+{
+  (void) ap_at;
+  *(size_t *) ap_parser->data += a_len;
+  return 0;
+}
+
+/* Responses with a body, parsed in socket-sized pieces */
+static int
+bench_http_response_parse (bench_thread_t * ap_thr)
+{
+  static const char head[] = "HTTP/1.1 200 OK\r\n"
+                             "Content-Type: audio/mpeg\r\n"
+                             "Content-Length: 16384\r\n"
+                             "Accept-Ranges: bytes\r\n"
+                             "Cache-Control: no-cache\r\n"
+                             "icy-name: Tizonia\r\n"
+                             "icy-br: 128\r\n"
+                             "icy-metaint: 16000\r\n"
+                             "\r\n";
+  const size_t head_len = sizeof (head) - 1;
+  const size_t len = head_len + BENCH_HTTP_BODY;
+  http_parser_settings settings;
+  http_parser parser;
+  char * p_msg = malloc (len);
+  size_t body = 0;
+  int i = 0;
+
+  if (!p_msg)
+    {
+      return -1;
+    }
+  memcpy (p_msg, head, head_len);
+  memset (p_msg + head_len, 0x33, BENCH_HTTP_BODY);
+  http_parser_settings_init (&settings);
+  settings.on_body = http_on_body;
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      for (i = 0; i < BENCH_BATCH / 4; ++i)
+        {
+          size_t pos = 0;
+          http_parser_init (&parser, HTTP_RESPONSE);
+          parser.data = &body;
+          while (pos < len)
+            {
+              const size_t n
+                = len - pos < BENCH_HTTP_READ ? len - pos : BENCH_HTTP_READ;
+              if (http_parser_execute (&parser, &settings, p_msg + pos, n) != n)
+                {
+                  free (p_msg);
+                  return -1;
+                }
+              pos += n;
+            }
+        }
+      bench_sample (ap_thr, start, BENCH_BATCH / 4);
+    }
+  bench_stop (ap_thr);
+  free (p_msg);
+  return body > 0 ? 0 : -1;
+}
+
+/*
+ * Event loop watchers. Callbacks run on the event loop's thread.
+ */
+
+typedef struct bench_event bench_event_t;
+struct bench_event
+{
+  tiz_sem_t sem;
+  int fds[2];
+};
+
+static void
+bench_io_cback (void * ap_arg0, tiz_event_io_t * ap_ev_io, void * ap_arg1,
+                const uint32_t a_id, int a_fd, int a_events)
+{
+  bench_event_t * p_ev = ap_arg1;
+  char byte = 0;
+  (void) ap_arg0;
+  (void) ap_ev_io;
+  (void) a_id;
+  (void) a_events;
+  while (read (a_fd, &byte, 1) > 0)
+    {
+    }
+  tiz_sem_post (&(p_ev->sem));
+}
+
+static void
+bench_timer_cback (void * ap_arg0, tiz_event_timer_t * ap_ev_timer,
+                   void * ap_arg1, const uint32_t a_id)
+{
+  bench_event_t * p_ev = ap_arg1;
+  (void) ap_arg0;
+  (void) ap_ev_timer;
+  (void) a_id;
+  tiz_sem_post (&(p_ev->sem));
+}
+
+static int
+bench_event_init (bench_event_t * ap_ev)
+{
+  if (OMX_ErrorNone != tiz_sem_init (&(ap_ev->sem), 0))
+    {
+      return -1;
+    }
+  if (pipe (ap_ev->fds) < 0)
+    {
+      tiz_sem_destroy (&(ap_ev->sem));
+      return -1;
+    }
+  (void) fcntl (ap_ev->fds[0], F_SETFL, O_NONBLOCK);
+  return 0;
+}
+
+static void
+bench_event_destroy (bench_event_t * ap_ev)
+{
+  close (ap_ev->fds[0]);
+  close (ap_ev->fds[1]);
+  tiz_sem_destroy (&(ap_ev->sem));
+}
+
+/* io watcher that stays started, as a socket's watcher in a source */
+static int
+bench_event_io_round_trip (bench_thread_t * ap_thr)
+{
+  bench_event_t ev;
+  tiz_event_io_t * p_io = NULL;
+  const char byte = 1;
+
+  if (bench_event_init (&ev) < 0)
+    {
+      return -1;
+    }
+  if (OMX_ErrorNone != tiz_event_io_init (&p_io, NULL, bench_io_cback, &ev))
+    {
+      bench_event_destroy (&ev);
+      return -1;
+    }
+  tiz_event_io_set (p_io, ev.fds[0], TIZ_EVENT_READ, false);
+  (void) tiz_event_io_start (p_io, 1);
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      if (write (ev.fds[1], &byte, 1) != 1)
+        {
+          break;
+        }
+      (void) tiz_sem_wait (&(ev.sem));
+      bench_sample (ap_thr, start, 1);
+    }
+  bench_stop (ap_thr);
+
+  (void) tiz_event_io_stop (p_io);
+  tiz_event_io_destroy (p_io);
+  bench_event_destroy (&ev);
+  return 0;
+}
+
+/* One-shot io watcher, restarted for every event */
+static int
+bench_event_io_once_round_trip (bench_thread_t * ap_thr)
+{
+  bench_event_t ev;
+  tiz_event_io_t * p_io = NULL;
+  uint32_t id = 1;
+  const char byte = 1;
+
+  if (bench_event_init (&ev) < 0)
+    {
+      return -1;
+    }
+  if (OMX_ErrorNone != tiz_event_io_init (&p_io, NULL, bench_io_cback, &ev))
+    {
+      bench_event_destroy (&ev);
+      return -1;
+    }
+  tiz_event_io_set (p_io, ev.fds[0], TIZ_EVENT_READ, true);
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      (void) tiz_event_io_start (p_io, id++);
+      if (write (ev.fds[1], &byte, 1) != 1)
+        {
+          break;
+        }
+      (void) tiz_sem_wait (&(ev.sem));
+      bench_sample (ap_thr, start, 1);
+    }
+  bench_stop (ap_thr);
+
+  (void) tiz_event_io_stop (p_io);
+  tiz_event_io_destroy (p_io);
+  bench_event_destroy (&ev);
+  return 0;
+}
+
+/* Zero-delay one-shot timer */
+static int
+bench_event_timer_round_trip (bench_thread_t * ap_thr)
+{
+  bench_event_t ev;
+  tiz_event_timer_t * p_timer = NULL;
+  uint32_t id = 1;
+
+  if (bench_event_init (&ev) < 0)
+    {
+      return -1;
+    }
+  if (OMX_ErrorNone
+      != tiz_event_timer_init (&p_timer, NULL, bench_timer_cback, &ev))
+    {
+      bench_event_destroy (&ev);
+      return -1;
+    }
+  tiz_event_timer_set (p_timer, 0., 0.);
+
+  bench_go (ap_thr);
+  while (ap_thr->done < ap_thr->ops)
+    {
+      const double start = now_ns ();
+      (void) tiz_event_timer_start (p_timer, id++);
+      (void) tiz_sem_wait (&(ev.sem));
+      bench_sample (ap_thr, start, 1);
+    }
+  bench_stop (ap_thr);
+
+  (void) tiz_event_timer_stop (p_timer);
+  tiz_event_timer_destroy (p_timer);
+  bench_event_destroy (&ev);
+  return 0;
+}
+
+static const bench_case_t bench_cases[] = {
+  {"queue.send_receive", bench_queue_send_receive, 2000000, 0, 0, NULL, NULL},
+  {"queue.fan_in", bench_queue_fan_in, 500000, -1, 0, queues_init,
+   queues_destroy},
+  {"queue.ping_pong", bench_queue_ping_pong, 50000, 2, 0, queues_init,
+   queues_destroy},
+  {"pqueue.send_receive", bench_pqueue_send_receive, 2000000, 0, 0, NULL,
+   NULL},
+  {"soa.calloc_free", bench_soa_calloc_free, 4000000, 0, 0, NULL, NULL},
+  {"mem.calloc_free", bench_mem_calloc_free, 4000000, 0, 0, NULL, NULL},
+  {"slab.calloc_free", bench_slab_calloc_free, 4000000, 0, 0, NULL, NULL},
+  {"slab.xthread_free", bench_slab_xthread_free, 500000, -1, 0, queues_init,
+   queues_destroy},
+  {"mem.xthread_free", bench_mem_xthread_free, 500000, -1, 0, queues_init,
+   queues_destroy},
+  {"map.insert_find_erase", bench_map_insert_find_erase, 1000000, 0, 0, NULL,
+   NULL},
+  {"vector.push_at_clear", bench_vector_push_at_clear, 4000000, 0, 0, NULL,
+   NULL},
+  {"buffer.push_advance", bench_buffer_push_advance, 500000, 0,
+   BENCH_BUFFER_CHUNK, NULL, NULL},
+  {"http.request_parse", bench_http_request_parse, 200000, 0,
+   sizeof (bench_http_request) - 1, NULL, NULL},
+  {"http.response_parse", bench_http_response_parse, 20000, 0,
+   BENCH_HTTP_BODY, NULL, NULL},
+  {"event.io_round_trip", bench_event_io_round_trip, 20000, 1, 0, NULL, NULL},
+  {"event.io_once_round_trip", bench_event_io_once_round_trip, 20000, 1, 0,
+   NULL, NULL},
+  {"event.timer_round_trip", bench_event_timer_round_trip, 2000, 1, 0, NULL,
+   NULL},
+};
+
+#define BENCH_NUM_CASES (sizeof (bench_cases) / sizeof (bench_cases[0]))
+
+typedef struct bench_result bench_result_t;
+struct bench_result
+{
+  const char * p_name;
+  int threads;
+  long ops;
+  double secs;
+  double ops_per_sec;
+  double mb_per_sec;
+  double p50_ns;
+  double p99_ns;
+  double max_ns;
+};
+
+static void *
+bench_thread_func (void * ap_arg)
+{
+  bench_thread_t * p_thr = ap_arg;
+  p_thr->rc = p_thr->pf_body (p_thr);
+  return NULL;
+}
+
+static int
+cmp_doubles (const void * ap_left, const void * ap_right)
+{
+  const double left = *(const double *) ap_left;
+  const double right = *(const double *) ap_right;
+  return (left < right) ? -1 : (left > right);
+}
+
+static int
+run_case (const bench_case_t * ap_case, const int a_nthreads,
+          const double a_scale, bench_result_t * ap_result)
+{
+  bench_thread_t thrs[BENCH_MAX_THREADS];
+  pthread_t tids[BENCH_MAX_THREADS];
+  pthread_barrier_t barrier;
+  void * p_shared = NULL;
+  double * p_all = NULL;
+  double first_start = 0;
+  double last_end = 0;
+  size_t nall = 0;
+  long ops = 0;
+  int rc = 0;
+  int i = 0;
+
+  if (ap_case->pf_shared_init
+      && !(p_shared = ap_case->pf_shared_init (a_nthreads)))
+    {
+      return -1;
+    }
+
+  pthread_barrier_init (&barrier, NULL, a_nthreads);
+  memset (thrs, 0, sizeof (thrs));
+  for (i = 0; i < a_nthreads; ++i)
+    {
+      thrs[i].index = i;
+      thrs[i].nthreads = a_nthreads;
+      thrs[i].ops = (long) (ap_case->ops * a_scale);
+      thrs[i].ops = thrs[i].ops > 0 ? thrs[i].ops : 1;
+      thrs[i].p_shared = p_shared;
+      thrs[i].p_samples = calloc (BENCH_MAX_SAMPLES, sizeof (double));
+      thrs[i].p_barrier = &barrier;
+      thrs[i].pf_body = ap_case->pf_body;
+    }
+
+  /* The body runs on this thread when there is only one */
+  for (i = 1; i < a_nthreads; ++i)
+    {
+      pthread_create (&tids[i], NULL, bench_thread_func, &thrs[i]);
+    }
+  bench_thread_func (&thrs[0]);
+  for (i = 1; i < a_nthreads; ++i)
+    {
+      pthread_join (tids[i], NULL);
+    }
+
+  for (i = 0; i < a_nthreads; ++i)
+    {
+      nall += thrs[i].nsamples;
+    }
+  p_all = calloc (nall ? nall : 1, sizeof (double));
+  nall = 0;
+  for (i = 0; i < a_nthreads; ++i)
+    {
+      if (thrs[i].rc < 0 || !thrs[i].p_samples)
+        {
+          rc = -1;
+        }
+      if (thrs[i].p_samples && p_all)
+        {
+          memcpy (p_all + nall, thrs[i].p_samples,
+                  thrs[i].nsamples * sizeof (double));
+          nall += thrs[i].nsamples;
+        }
+      ops += thrs[i].done;
+      if (0 == i || thrs[i].start < first_start)
+        {
+          first_start = thrs[i].start;
+        }
+      if (thrs[i].end > last_end)
+        {
+          last_end = thrs[i].end;
+        }
+      free (thrs[i].p_samples);
+    }
+
+  if (0 == rc && p_all && nall > 0)
+    {
+      qsort (p_all, nall, sizeof (double), cmp_doubles);
+      ap_result->p_name = ap_case->p_name;
+      ap_result->threads = a_nthreads;
+      ap_result->ops = ops;
+      ap_result->secs = (last_end - first_start) / 1e9;
+      ap_result->ops_per_sec
+        = ap_result->secs > 0 ? ops / ap_result->secs : 0;
+      ap_result->mb_per_sec
+        = ap_case->bytes_per_op
+            ? ap_result->ops_per_sec * ap_case->bytes_per_op / 1e6
+            : 0;
+      ap_result->p50_ns = p_all[nall / 2];
+      ap_result->p99_ns = p_all[(nall * 99) / 100];
+      ap_result->max_ns = p_all[nall - 1];
+    }
+  else
+    {
+      rc = -1;
+    }
+
+  free (p_all);
+  pthread_barrier_destroy (&barrier);
+  if (ap_case->pf_shared_destroy)
+    {
+      ap_case->pf_shared_destroy (p_shared);
+    }
+  return rc;
+}
+
+static void
+print_header (FILE * ap_out, const bench_format_t a_format,
+              const double a_scale, const int a_threads)
+{
+  switch (a_format)
+    {
+      case EBenchFormatJson:
+        fprintf (ap_out,
+                 "{\n  \"suite\": \"tizplatform\",\n  \"cpus\": %ld,\n"
+                 "  \"scale\": %g,\n  \"threads\": %d,\n  \"results\": [",
+                 sysconf (_SC_NPROCESSORS_ONLN), a_scale, a_threads);
+        break;
+      case EBenchFormatCsv:
+        fprintf (ap_out, "name,threads,ops,secs,ops_per_sec,mb_per_sec,"
+                         "p50_ns,p99_ns,max_ns\n");
+        break;
+      default:
+        fprintf (ap_out, "%-26s %7s %10s %8s %12s %9s %10s %10s\n", "name",
+                 "threads", "ops", "secs", "ops/s", "MB/s", "p50 ns",
+                 "p99 ns");
+        break;
+    }
+}
+
+static void
+print_result (FILE * ap_out, const bench_format_t a_format,
+              const bench_result_t * ap_res, const bool a_first)
+{
+  switch (a_format)
+    {
+      case EBenchFormatJson:
+        fprintf (ap_out,
+                 "%s\n    {\"name\": \"%s\", \"threads\": %d, \"ops\": %ld, "
+                 "\"secs\": %.6f, \"ops_per_sec\": %.1f, \"mb_per_sec\": %.2f, "
+                 "\"p50_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f}",
+                 a_first ? "" : ",", ap_res->p_name, ap_res->threads,
+                 ap_res->ops, ap_res->secs, ap_res->ops_per_sec,
+                 ap_res->mb_per_sec, ap_res->p50_ns, ap_res->p99_ns,
+                 ap_res->max_ns);
+        break;
+      case EBenchFormatCsv:
+        fprintf (ap_out, "%s,%d,%ld,%.6f,%.1f,%.2f,%.1f,%.1f,%.1f\n",
+                 ap_res->p_name, ap_res->threads, ap_res->ops, ap_res->secs,
+                 ap_res->ops_per_sec, ap_res->mb_per_sec, ap_res->p50_ns,
+                 ap_res->p99_ns, ap_res->max_ns);
+        break;
+      default:
+        fprintf (ap_out, "%-26s %7d %10ld %8.3f %12.0f %9.1f %10.1f %10.1f\n",
+                 ap_res->p_name, ap_res->threads, ap_res->ops, ap_res->secs,
+                 ap_res->ops_per_sec, ap_res->mb_per_sec, ap_res->p50_ns,
+                 ap_res->p99_ns);
+        break;
+    }
+}
+
+int
+main (int argc, char ** argv)
+{
+  bench_format_t format = EBenchFormatText;
+  double scale = 1.0;
+  long ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+  int threads = ncpus > 4 ? 4 : (ncpus > 1 ? (int) ncpus : 2);
+  const char * p_prefix = NULL;
+  FILE * p_out = stdout;
+  bool first = true;
+  int failed = 0;
+  int opt = 0;
+  size_t c = 0;
+
+  while ((opt = getopt (argc, argv, "f:s:t:b:o:")) != -1)
+    {
+      switch (opt)
+        {
+          case 'f':
+            format = (0 == strcmp (optarg, "json"))
+                       ? EBenchFormatJson
+                       : (0 == strcmp (optarg, "csv")) ? EBenchFormatCsv
+                                                       : EBenchFormatText;
+            break;
+          case 's':
+            scale = atof (optarg);
+            break;
+          case 't':
+            threads = atoi (optarg);
+            break;
+          case 'b':
+            p_prefix = optarg;
+            break;
+          case 'o':
+            if (!(p_out = fopen (optarg, "w")))
+              {
+                fprintf (stderr, "%s: %s\n", optarg, strerror (errno));
+                return EXIT_FAILURE;
+              }
+            break;
+          default:
+            fprintf (stderr,
+                     "Usage: %s [-f text|json|csv] [-s scale] [-t threads] "
+                     "[-b name prefix] [-o file]\n",
+                     argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (scale <= 0 || threads < 2 || threads > BENCH_MAX_THREADS)
+    {
+      fprintf (stderr, "Invalid arguments (2 to %d threads)\n",
+               BENCH_MAX_THREADS);
+      return EXIT_FAILURE;
+    }
+
+  print_header (p_out, format, scale, threads);
+  for (c = 0; c < BENCH_NUM_CASES; ++c)
+    {
+      const bench_case_t * p_case = &bench_cases[c];
+      int counts[2] = {1, threads};
+      int nruns = 2;
+      int r = 0;
+
+      if (p_prefix && 0 != strncmp (p_case->p_name, p_prefix, strlen (p_prefix)))
+        {
+          continue;
+        }
+
+      if (p_case->fixed_threads > 0)
+        {
+          counts[0] = p_case->fixed_threads;
+          nruns = 1;
+        }
+      else if (p_case->fixed_threads < 0)
+        {
+          /* Shared between all the threads */
+          counts[0] = threads;
+          nruns = 1;
+        }
+
+      for (r = 0; r < nruns; ++r)
+        {
+          bench_result_t result;
+          memset (&result, 0, sizeof (result));
+          if (run_case (p_case, counts[r], scale, &result) < 0)
+            {
+              fprintf (stderr, "%s: failed with %d threads\n", p_case->p_name,
+                       counts[r]);
+              failed = 1;
+              continue;
+            }
+          print_result (p_out, format, &result, first);
+          first = false;
+          fflush (p_out);
+        }
+    }
+
+  if (EBenchFormatJson == format)
+    {
+      fprintf (p_out, "\n  ]\n}\n");
+    }
+  if (p_out != stdout)
+    {
+      fclose (p_out);
+    }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,291 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizarena.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Arena (bump) allocator
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "tizplatform.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.arena"
+#endif
+
+#define ARENA_ALIGN 16
+#define ARENA_ROUND_UP(x) (((x) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+typedef struct block block_t;
+struct block
+{
+  block_t * p_next;
+  size_t size;
+  size_t used;
+};
+#define BLOCK_HEADER_SZ ARENA_ROUND_UP (sizeof (block_t))
+
+static inline uint8_t *
+block_data (block_t * p_block)
+{
+  return ((uint8_t *) p_block + BLOCK_HEADER_SZ);
+}
+
+struct tiz_arena
+{
+  /* Blocks in use; the head is the block being bumped */
+  block_t * p_blocks;
+  /* The first standard-sized block; survives resets */
+  block_t * p_first;
+  size_t block_sz;
+  int32_t n_blocks;
+  int32_t n_objects;
+  int32_t n_resets;
+};
+
+/*@null@*/ static block_t *
+alloc_block (tiz_arena_t * p_arena, size_t a_size)
+{
+  block_t * p_block = NULL;
+
+  assert (p_arena);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "block size [%zu] ", a_size);
+
+  if ((p_block = tiz_mem_alloc (BLOCK_HEADER_SZ + a_size)))
+    {
+      p_block->p_next = NULL;
+      p_block->size = a_size;
+      p_block->used = 0;
+      p_arena->n_blocks += 1;
+    }
+
+  return p_block;
+}
+
+OMX_ERRORTYPE
+tiz_arena_init (/*@null@ */ tiz_arena_ptr_t * app_arena, size_t a_block_size)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  tiz_arena_t * p_arena = NULL;
+
+  assert (app_arena);
+
+  if (NULL == (p_arena = tiz_mem_calloc (1, sizeof (tiz_arena_t))))
+    {
+      rc = OMX_ErrorInsufficientResources;
+    }
+  else
+    {
+      p_arena->block_sz = ARENA_ROUND_UP (
+        a_block_size > 0 ? a_block_size : TIZ_ARENA_DEFAULT_BLOCK_SIZE);
+    }
+
+  *app_arena = p_arena;
+
+  return rc;
+}
+
+void
+tiz_arena_destroy (tiz_arena_t * p_arena)
+{
+  if (p_arena)
+    {
+      block_t * p_block = p_arena->p_blocks;
+      block_t * p_next = NULL;
+
+      while (p_block != NULL)
+        {
+          p_next = p_block->p_next;
+          tiz_mem_free (p_block);
+          p_block = p_next;
+        }
+
+      tiz_mem_free (p_arena);
+    }
+}
+
+/*@null@*/ void *
+tiz_arena_calloc (tiz_arena_t * p_arena, size_t a_size)
+{
+  const size_t alloc_sz = ARENA_ROUND_UP (a_size > 0 ? a_size : 1);
+  block_t * p_head = NULL;
+  uint8_t * p_usr = NULL;
+
+  assert (p_arena);
+
+  p_head = p_arena->p_blocks;
+
+  if (alloc_sz > p_arena->block_sz)
+    {
+      /* Oversized request: give it a block of its own, and link it behind
+         the head so that the head can still be bumped */
+      block_t * p_big = alloc_block (p_arena, alloc_sz);
+      if (p_big)
+        {
+          p_big->used = alloc_sz;
+          if (p_head)
+            {
+              p_big->p_next = p_head->p_next;
+              p_head->p_next = p_big;
+            }
+          else
+            {
+              p_arena->p_blocks = p_big;
+            }
+          p_usr = block_data (p_big);
+        }
+    }
+  else
+    {
+      if (!p_head || p_head->size < p_head->used + alloc_sz)
+        {
+          block_t * p_new = alloc_block (p_arena, p_arena->block_sz);
+          if (p_new)
+            {
+              p_new->p_next = p_head;
+              p_arena->p_blocks = p_head = p_new;
+              if (!p_arena->p_first)
+                {
+                  p_arena->p_first = p_new;
+                }
+            }
+          else
+            {
+              p_head = NULL;
+            }
+        }
+
+      if (p_head)
+        {
+          p_usr = block_data (p_head) + p_head->used;
+          p_head->used += alloc_sz;
+        }
+    }
+
+  if (p_usr)
+    {
+      p_arena->n_objects += 1;
+      (void) tiz_mem_set (p_usr, 0, a_size);
+    }
+
+  return p_usr;
+}
+
+/*@null@*/ char *
+tiz_arena_strndup (tiz_arena_t * p_arena, const char * ap_str, size_t a_len)
+{
+  char * p_dup = NULL;
+  size_t len = 0;
+
+  assert (p_arena);
+  assert (ap_str);
+
+  len = strnlen (ap_str, a_len);
+  if ((p_dup = tiz_arena_calloc (p_arena, len + 1)))
+    {
+      memcpy (p_dup, ap_str, len);
+      p_dup[len] = '\0';
+    }
+
+  return p_dup;
+}
+
+void
+tiz_arena_reset (tiz_arena_t * p_arena)
+{
+  block_t * p_block = NULL;
+  block_t * p_next = NULL;
+
+  assert (p_arena);
+
+  p_block = p_arena->p_blocks;
+  while (p_block != NULL)
+    {
+      p_next = p_block->p_next;
+      if (p_block != p_arena->p_first)
+        {
+          tiz_mem_free (p_block);
+          p_arena->n_blocks -= 1;
+        }
+      p_block = p_next;
+    }
+
+  p_arena->p_blocks = p_arena->p_first;
+  if (p_arena->p_first)
+    {
+      p_arena->p_first->p_next = NULL;
+      p_arena->p_first->used = 0;
+    }
+  p_arena->n_objects = 0;
+  p_arena->n_resets += 1;
+}
+
+OMX_BOOL
+tiz_arena_owns (const tiz_arena_t * p_arena, const void * ap_addr)
+{
+  const block_t * p_block = NULL;
+  const uint8_t * p_addr = ap_addr;
+
+  assert (p_arena);
+
+  for (p_block = p_arena->p_blocks; p_block; p_block = p_block->p_next)
+    {
+      const uint8_t * p_begin = (const uint8_t *) p_block + BLOCK_HEADER_SZ;
+      if (p_addr >= p_begin && p_addr < p_begin + p_block->used)
+        {
+          return OMX_TRUE;
+        }
+    }
+
+  return OMX_FALSE;
+}
+
+void
+tiz_arena_info (const tiz_arena_t * p_arena, tiz_arena_info_t * p_info)
+{
+  const block_t * p_block = NULL;
+
+  assert (p_arena);
+  assert (p_info);
+
+  p_info->blocks = p_arena->n_blocks;
+  p_info->objects = p_arena->n_objects;
+  p_info->used = 0;
+  p_info->capacity = 0;
+  p_info->resets = p_arena->n_resets;
+
+  for (p_block = p_arena->p_blocks; p_block; p_block = p_block->p_next)
+    {
+      p_info->used += p_block->used;
+      p_info->capacity += p_block->size;
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizarena.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Arena (bump) allocator
+ *
+ * Allocations are carved sequentially out of a chain of blocks and are never
+ * freed individually; the whole arena is released at once with
+ * tiz_arena_reset. Not thread-safe: an arena belongs to a single thread (in
+ * libtizonia, to a component's servant thread).
+ *
+ */
+
+#ifndef TIZARENA_H
+#define TIZARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <OMX_Types.h>
+#include <OMX_Core.h>
+
+#define TIZ_ARENA_DEFAULT_BLOCK_SIZE 4096
+
+typedef struct tiz_arena tiz_arena_t;
+typedef /*@null@ */ tiz_arena_t * tiz_arena_ptr_t;
+
+/**
+ * Create an arena. The first block is allocated lazily.
+ *
+ * @param app_arena Returns the new arena.
+ * @param a_block_size The size of each block (0 selects
+ * TIZ_ARENA_DEFAULT_BLOCK_SIZE). Requests larger than this get a block of
+ * their own.
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_arena_init (/*@null@ */ tiz_arena_ptr_t * app_arena, size_t a_block_size);
+
+void
+tiz_arena_destroy (tiz_arena_t * p_arena);
+
+/**
+ * Allocate a zero-initialised, suitably aligned, region from the arena.
+ *
+ * @return The new region, or NULL if the system is out of memory.
+ */
+/*@null@ */ void *
+tiz_arena_calloc (tiz_arena_t * p_arena, size_t a_size);
+
+/**
+ * Copy at most a_len characters of a string into the arena. The copy is
+ * always null-terminated.
+ */
+/*@null@ */ char *
+tiz_arena_strndup (tiz_arena_t * p_arena, const char * ap_str, size_t a_len);
+
+/**
+ * Release every allocation made since the last reset. The first block is
+ * retained, so an arena that is reset regularly does not go back to the
+ * system allocator in the steady state.
+ */
+void
+tiz_arena_reset (tiz_arena_t * p_arena);
+
+/**
+ * Returns OMX_TRUE if ap_addr points into memory currently handed out by the
+ * arena.
+ */
+OMX_BOOL
+tiz_arena_owns (const tiz_arena_t * p_arena, const void * ap_addr);
+
+typedef struct tiz_arena_info tiz_arena_info_t;
+struct tiz_arena_info
+{
+  /* Number of blocks currently allocated */
+  int32_t blocks;
+  /* Number of allocations since the last reset */
+  int32_t objects;
+  /* Bytes handed out since the last reset (including alignment padding) */
+  size_t used;
+  /* Total capacity of the blocks currently allocated */
+  size_t capacity;
+  /* Number of resets performed so far */
+  int32_t resets;
+};
+
+void
+tiz_arena_info (const tiz_arena_t * p_arena, tiz_arena_info_t * p_info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZARENA_H */
@@ -117,7 +117,6 @@ struct tiz_event_loop
   tiz_mutex_t mutex;
   tiz_sem_t sem;
   tiz_pqueue_t * p_pq;
-  tiz_soa_t * p_soa;
   ev_async * p_async_watcher;
   struct ev_loop * p_loop;
   tiz_event_loop_state_t state;
@@ -268,16 +267,16 @@ tiz_event_loop_msg_to_str (const tiz_event_loop_msg_class_t a_msg)
 /* NOTE: Start ignoring splint warnings in this section of code */
 /*@ignore@*/
 static inline tiz_event_loop_msg_t *
-init_event_loop_msg (tiz_event_loop_t * ap_event_loop,
-                     tiz_event_loop_msg_class_t a_msg_class)
+init_event_loop_msg (tiz_event_loop_msg_class_t a_msg_class)
 {
   tiz_event_loop_msg_t * p_msg = NULL;
 
-  assert (ap_event_loop);
   assert (a_msg_class < ETIZEventLoopMsgMax);
 
-  if (!(p_msg = (tiz_event_loop_msg_t *) tiz_soa_calloc (
-          ap_event_loop->p_soa, sizeof (tiz_event_loop_msg_t))))
+  /* Messages are allocated on the clients' threads and deleted on the event
+     loop's thread */
+  if (!(p_msg = (tiz_event_loop_msg_t *) tiz_slab_calloc (
+          sizeof (tiz_event_loop_msg_t))))
     {
       TIZ_LOG (TIZ_PRIORITY_ERROR,
                "[OMX_ErrorInsufficientResources] : "
@@ -340,15 +339,13 @@ enqueue_io_msg (tiz_event_io_t * ap_ev_io, const uint32_t a_id,
           || ETIZEventLoopMsgIoStop == a_class
           || ETIZEventLoopMsgIoDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
-  tiz_goto_end_on_null (
-    (p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
-    "Failed to initialise the event loop");
-
-  assert (p_msg);
+  /* The message is prepared before taking the lock */
+  tiz_check_null_ret_oom ((p_msg = init_event_loop_msg (a_class)));
   p_msg_io = &(p_msg->io);
   p_msg_io->p_ev_io = ap_ev_io;
   p_msg_io->id = a_id;
+
+  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
   tiz_goto_end_on_omx_err (
     (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
     "Failed to insert into the queue");
@@ -362,6 +359,7 @@ enqueue_io_msg (tiz_event_io_t * ap_ev_io, const uint32_t a_id,
 
   if (OMX_ErrorNone != rc)
     {
+      tiz_slab_free (p_msg);
       tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
     }
 
@@ -382,15 +380,13 @@ enqueue_timer_msg (tiz_event_timer_t * ap_ev_timer, const uint32_t a_id,
           || ETIZEventLoopMsgTimerRestart == a_class
           || ETIZEventLoopMsgTimerDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
-  tiz_goto_end_on_null (
-    (p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
-    "Failed to initialise the event loop");
-
-  assert (p_msg);
+  /* The message is prepared before taking the lock */
+  tiz_check_null_ret_oom ((p_msg = init_event_loop_msg (a_class)));
   p_msg_timer = &(p_msg->timer);
   p_msg_timer->p_ev_timer = ap_ev_timer;
   p_msg_timer->id = a_id;
+
+  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
   tiz_goto_end_on_omx_err (
     (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
     "Failed to insert into the queue");
@@ -404,6 +400,7 @@ enqueue_timer_msg (tiz_event_timer_t * ap_ev_timer, const uint32_t a_id,
 
   if (OMX_ErrorNone != rc)
     {
+      tiz_slab_free (p_msg);
       tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
     }
 
@@ -423,14 +420,13 @@ enqueue_stat_msg (tiz_event_stat_t * ap_ev_stat, const uint32_t a_id,
           || ETIZEventLoopMsgStatStop == a_class
           || ETIZEventLoopMsgStatDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
-  tiz_goto_end_on_null ((p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
-                        "Failed to initialise the event loop");
-
-  assert (p_msg);
+  /* The message is prepared before taking the lock */
+  tiz_check_null_ret_oom ((p_msg = init_event_loop_msg (a_class)));
   p_msg_stat = &(p_msg->stat);
   p_msg_stat->p_ev_stat = ap_ev_stat;
   p_msg_stat->id = a_id;
+
+  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
   tiz_goto_end_on_omx_err (
     (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
     "Failed to insert into the queue");
@@ -444,6 +440,7 @@ enqueue_stat_msg (tiz_event_stat_t * ap_ev_stat, const uint32_t a_id,
 
   if (OMX_ErrorNone != rc)
     {
+      tiz_slab_free (p_msg);
       tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
     }
 
@@ -502,7 +499,8 @@ ev_io_msg_dequeue (void * ap_elem, OMX_S32 a_data1, void * ap_data2)
           if (p_ev_io_needle->id == p_msg_io->id)
             {
               /* Found, return TRUE so that the msg will be removed from the
-                 queue */
+                 queue, and delete it */
+              tiz_slab_free (p_msg);
               rc = OMX_TRUE;
             }
         }
@@ -546,7 +544,8 @@ ev_timer_msg_dequeue (void * ap_elem, OMX_S32 a_data1, void * ap_data2)
           if (p_ev_timer_needle->id == p_msg_timer->id)
             {
               /* Found, return TRUE so that the msg will be removed from the
-                 queue */
+                 queue, and delete it */
+              tiz_slab_free (p_msg);
               rc = OMX_TRUE;
             }
         }
@@ -590,7 +589,8 @@ ev_stat_msg_dequeue (void * ap_elem, OMX_S32 a_data1, void * ap_data2)
           if (p_ev_stat_needle->id == p_msg_stat->id)
             {
               /* Found, return TRUE so that the msg will be removed from the
-                 queue */
+                 queue, and delete it */
+              tiz_slab_free (p_msg);
               rc = OMX_TRUE;
             }
         }
@@ -944,7 +944,7 @@ async_watcher_cback (struct ev_loop * ap_loop, ev_async * ap_watcher,
               /* Process the message */
               dispatch_msg (p_msg);
               /* Delete the message */
-              tiz_soa_free (gp_event_loop->p_soa, p_msg);
+              tiz_slab_free (p_msg);
             }
           (void) tiz_mutex_unlock (&(gp_event_loop->mutex));
         }
@@ -1062,16 +1062,17 @@ clean_up_thread_data (tiz_event_loop_t * ap_lp)
 
       if (ap_lp->p_pq)
         {
+          void * p_msg = NULL;
+          /* Delete any messages left in the queue */
+          while (0 < tiz_pqueue_length (ap_lp->p_pq)
+                 && OMX_ErrorNone == tiz_pqueue_receive (ap_lp->p_pq, &p_msg))
+            {
+              tiz_slab_free (p_msg);
+            }
           tiz_pqueue_destroy (ap_lp->p_pq);
           ap_lp->p_pq = NULL;
         }
 
-      if (ap_lp->p_soa)
-        {
-          tiz_soa_destroy (ap_lp->p_soa);
-          ap_lp->p_soa = NULL;
-        }
-
       tiz_mem_free (gp_event_loop);
       gp_event_loop = NULL;
     }
@@ -1125,14 +1126,11 @@ init_event_loop_thread (void)
       tiz_goto_end_on_omx_err (tiz_sem_init (&(gp_event_loop->sem), 0),
                            "Error initializing sem.");
 
-      /* Init the small object allocator */
-      tiz_goto_end_on_omx_err (tiz_soa_init (&(gp_event_loop->p_soa)),
-                           "Error initializing the small object allocator.");
-
-      /* Init the priority queue */
+      /* Init the priority queue; its items come from the slab allocator, as
+         they are created and deleted on different threads */
       tiz_goto_end_on_omx_err (
-        tiz_pqueue_init (&gp_event_loop->p_pq, 2, &pqueue_cmp,
-                         gp_event_loop->p_soa, TIZ_EVENT_LOOP_THREAD_NAME),
+        tiz_pqueue_init (&gp_event_loop->p_pq, 2, &pqueue_cmp, NULL,
+                         TIZ_EVENT_LOOP_THREAD_NAME),
         "Error initializing pqueue.");
 
       /* All good */
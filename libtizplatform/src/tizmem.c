@@ -33,6 +33,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
 
 #include "tizplatform.h"
 
@@ -69,3 +71,18 @@ tiz_mem_set (OMX_PTR ap_dest, OMX_S32 a_orig, size_t a_num_bytes)
 {
   return memset (ap_dest, (int) a_orig, a_num_bytes);
 }
+
+OMX_ERRORTYPE
+tiz_mem_lock_all (void)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  if (0 != mlockall (MCL_CURRENT | MCL_FUTURE))
+    {
+      /* EPERM: the process lacks CAP_IPC_LOCK; ENOMEM: RLIMIT_MEMLOCK is too
+         low */
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Could not lock the process memory (%s).",
+               strerror (errno));
+      rc = OMX_ErrorInsufficientResources;
+    }
+  return rc;
+}
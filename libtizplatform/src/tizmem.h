@@ -34,6 +34,7 @@ extern "C" {
 #endif
 
 #include <sys/types.h>
+#include <OMX_Core.h>
 #include <OMX_Types.h>
 
 /*@only@*/ /*@null@*/ /*@out@*/
@@ -50,6 +51,9 @@ OMX_PTR
 tiz_mem_calloc (size_t nmemb, size_t size);
 OMX_PTR
 tiz_mem_set (OMX_PTR ap_dest, OMX_S32 a_orig, size_t a_num_bytes);
+/* Lock all current and future pages of the process into RAM (mlockall) */
+OMX_ERRORTYPE
+tiz_mem_lock_all (void);
 
 #ifdef __cplusplus
 }
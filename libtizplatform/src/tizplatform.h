@@ -49,6 +49,8 @@
 #include "tizomxutils.h"
 #include "tizrc.h"
 #include "tizsoa.h"
+#include "tizarena.h"
+#include "tizslab.h"
 #include "tizev.h"
 #include "tizhttp.h"
 #include "tizmap.h"
@@ -56,6 +58,7 @@
 #include "tizprintf.h"
 #include "tizshufflelst.h"
 #include "tizurltransfer.h"
+#include "tizshmring.h"
 
 /** @} */
 
@@ -30,6 +30,9 @@
 #ifndef TIZINT_H
 #define TIZINT_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 /**
  * Value struct used in the Tizonia Platform config file data structure
  *
@@ -102,4 +105,46 @@ tiz_rcfile_destroy (tiz_rcfile_t * rcfile);
 tiz_rcfile_t *
 tiz_rcfile_get_handle (void);
 
+/**
+ * What the headers of a response to a range request have told the URL
+ * transfer so far
+ *
+ * @private
+ */
+typedef struct tiz_urltrans_range tiz_urltrans_range_t;
+struct tiz_urltrans_range
+{
+  long long resume_offset; /* first byte that was requested */
+  bool partial;            /* the response is a 206 */
+  long long skip_bytes;    /* bytes to drop, if the range was ignored */
+  long long total_bytes;   /* size of the whole resource */
+  long long next_offset;   /* first byte after the range received */
+};
+
+/**
+ * Process one header line of a response to a range request.
+ *
+ * The status line tells whether the server honoured the range. In a 206
+ * response, the Content-Length describes the range only, so it is dropped;
+ * the Content-Range gives the size of the whole resource, which, when the
+ * range starts at byte 0, is written to ap_length as the Content-Length
+ * header that the client expects (ap_length is left empty otherwise).
+ *
+ * @private
+ *
+ * @param ap_range The state of the response.
+ * @param ap_header The header line (not null-terminated).
+ * @param a_nbytes The length of the header line.
+ * @param ap_length A buffer for the replacement Content-Length header.
+ * @param a_length_size The size of ap_length.
+ *
+ * @return true if the header has been dealt with, false if it must be
+ * forwarded as is.
+ */
+bool
+tiz_urltrans_process_range_header (tiz_urltrans_range_t * ap_range,
+                                   const char * ap_header,
+                                   const size_t a_nbytes, char * ap_length,
+                                   const size_t a_length_size);
+
 #endif /* TIZINT_H */
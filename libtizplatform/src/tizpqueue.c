@@ -76,13 +76,13 @@ struct tiz_pqueue
 static /*@null@ */ void *
 pqueue_calloc (/*@null@ */ tiz_soa_t * p_soa, size_t a_size)
 {
-  return p_soa ? tiz_soa_calloc (p_soa, a_size) : tiz_mem_calloc (1, a_size);
+  return p_soa ? tiz_soa_calloc (p_soa, a_size) : tiz_slab_calloc (a_size);
 }
 
 static inline void
 pqueue_free (tiz_soa_t * p_soa, void * ap_addr)
 {
-  p_soa ? tiz_soa_free (p_soa, ap_addr) : tiz_mem_free (ap_addr);
+  p_soa ? tiz_soa_free (p_soa, ap_addr) : tiz_slab_free (ap_addr);
 }
 
 static inline void
@@ -105,7 +105,7 @@ init_queue_struct (void)
   TIZ_Q_GOTO_END_ON_ERROR (tiz_cond_init (&(p_q->cond_full)));
   TIZ_Q_GOTO_END_ON_ERROR (tiz_cond_init (&(p_q->cond_empty)));
   p_q->p_first
-    = (tiz_queue_item_t *) tiz_mem_calloc (1, sizeof (tiz_queue_item_t));
+    = (tiz_queue_item_t *) tiz_slab_calloc (sizeof (tiz_queue_item_t));
   TIZ_Q_GOTO_END_ON_NULL (p_q->p_first);
 
   /* All OK */
@@ -147,8 +147,8 @@ tiz_queue_init (tiz_queue_ptr_t * app_q, OMX_S32 a_capacity)
 
       for (i = 0; i < (a_capacity - 1); ++i)
         {
-          if ((p_new_item = (tiz_queue_item_t *) tiz_mem_calloc (
-                 1, sizeof (tiz_queue_item_t))))
+          if ((p_new_item = (tiz_queue_item_t *) tiz_slab_calloc (
+                 sizeof (tiz_queue_item_t))))
             {
               p_cur_item->p_next = p_new_item;
               p_cur_item = p_new_item;
@@ -164,7 +164,7 @@ tiz_queue_init (tiz_queue_ptr_t * app_q, OMX_S32 a_capacity)
               while (p_q->p_first)
                 {
                   p_cur_item = p_q->p_first->p_next;
-                  tiz_mem_free ((OMX_PTR) p_q->p_first);
+                  tiz_slab_free ((OMX_PTR) p_q->p_first);
                   p_q->p_first = p_cur_item;
                 }
               /* end loop  */
@@ -208,10 +208,11 @@ tiz_queue_destroy (/*@null@ */ tiz_queue_t * p_q)
       tiz_queue_item_t * p_cur_item = 0;
       int i = 0;
 
-      for (i = 0; p_q->p_first && i < (p_q->capacity - 1); ++i)
+      /* The items form a ring of capacity elements */
+      for (i = 0; p_q->p_first && i < p_q->capacity; ++i)
         {
           p_cur_item = p_q->p_first->p_next;
-          tiz_mem_free (p_q->p_first);
+          tiz_slab_free (p_q->p_first);
           p_q->p_first = p_cur_item;
         }
 
@@ -229,7 +230,6 @@ tiz_queue_send (tiz_queue_t * p_q, OMX_PTR ap_data)
   tiz_check_omx_ret_oom (tiz_mutex_lock (&(p_q->mutex)));
 
   assert (p_q->p_last);
-  assert (NULL == (p_q->p_last->p_data));
   assert (p_q->length <= p_q->capacity);
 
   while (p_q->length == p_q->capacity)
@@ -239,6 +239,8 @@ tiz_queue_send (tiz_queue_t * p_q, OMX_PTR ap_data)
 
   if (OMX_ErrorNone == rc)
     {
+      /* The slot is only free once there is room in the queue */
+      assert (NULL == (p_q->p_last->p_data));
       p_q->p_last->p_data = ap_data;
       p_q->p_last = p_q->p_last->p_next;
       p_q->length++;
@@ -250,6 +252,39 @@ tiz_queue_send (tiz_queue_t * p_q, OMX_PTR ap_data)
   return rc;
 }
 
+OMX_ERRORTYPE
+tiz_queue_try_send (tiz_queue_t * p_q, OMX_PTR ap_data)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_q);
+
+  tiz_check_omx_ret_oom (tiz_mutex_lock (&(p_q->mutex)));
+
+  assert (p_q->p_last);
+  assert (p_q->length <= p_q->capacity);
+
+  if (p_q->length == p_q->capacity)
+    {
+      rc = OMX_ErrorOverflow;
+    }
+  else
+    {
+      assert (NULL == (p_q->p_last->p_data));
+      p_q->p_last->p_data = ap_data;
+      p_q->p_last = p_q->p_last->p_next;
+      p_q->length++;
+    }
+
+  tiz_check_omx_ret_oom (tiz_mutex_unlock (&(p_q->mutex)));
+  if (OMX_ErrorNone == rc)
+    {
+      tiz_check_omx_ret_oom (tiz_cond_broadcast (&(p_q->cond_empty)));
+    }
+
+  return rc;
+}
+
 OMX_ERRORTYPE
 tiz_queue_receive (tiz_queue_t * p_q, OMX_PTR * app_data)
 {
@@ -85,6 +85,17 @@ tiz_queue_destroy (/*@null@ */ tiz_queue_t * ap_q);
 OMX_ERRORTYPE
 tiz_queue_send (tiz_queue_t * ap_q, OMX_PTR ap_data);
 
+/**
+ * Add an item onto the end of the queue, without blocking.
+ *
+ * @ingroup tizqueue
+ *
+ * @return OMX_ErrorNone if the item was added, OMX_ErrorOverflow if the queue
+ * is full.
+ */
+OMX_ERRORTYPE
+tiz_queue_try_send (tiz_queue_t * ap_q, OMX_PTR ap_data);
+
 /**
  * Retrieve an item from the head of the queue. If the queue is empty, it
  * blocks until an item becomes available.
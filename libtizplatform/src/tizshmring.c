@@ -0,0 +1,1009 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Single-writer, multi-reader shared memory ring
+ *
+ * The mapping starts with a header (positions, futex words and the reader
+ * slots), followed by the data area. Positions are byte counts that only
+ * grow; the offset in the data area is the position modulo the capacity.
+ *
+ * A record is a header followed by the payload, padded to 8 bytes. Records
+ * never wrap around the end of the data area: when a record does not fit
+ * before the end, a pad record (or, if not even a record header fits, just
+ * the remaining bytes) is skipped.
+ *
+ * The oldest record still in the ring starts at 'tail_pos'. Before
+ * overwriting anything, the writer moves the tail past the records it is
+ * about to reuse. Backpressure readers never let it get that far (the writer
+ * waits for them first). Drop-oldest readers check the tail again after
+ * copying a record: if the tail has moved past it, the copy may be torn, so
+ * it is discarded and the reader continues from the tail.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tizplatform.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.shmring"
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define SHMRING_MAGIC 0x544d5352 /* "TMSR" */
+#define SHMRING_VERSION 1
+#define SHMRING_MIN_CAPACITY 4096
+#define SHMRING_MAX_NAME_LEN 64
+#define SHMRING_ALIGN 8
+#define SHMRING_REC_DATA 0
+#define SHMRING_REC_PAD 1
+#define SHMRING_SLOT_FREE 0
+#define SHMRING_SLOT_CLAIMED 1
+#define SHMRING_SLOT_ACTIVE 2
+
+#define load_acq(p) __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define load_rlx(p) __atomic_load_n ((p), __ATOMIC_RELAXED)
+#define store_rel(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+#define store_rlx(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELAXED)
+
+typedef struct shmring_rec shmring_rec_t;
+struct shmring_rec
+{
+  uint32_t len;
+  uint32_t flags;
+  uint32_t kind;
+  uint32_t reserved;
+  uint64_t seq;
+};
+
+#define SHMRING_REC_HDR_SIZE (sizeof (shmring_rec_t))
+
+/* Written by the reader that owns the slot; read by the writer (read_pos)
+   and by anyone asking for statistics */
+typedef struct shmring_slot shmring_slot_t;
+struct shmring_slot
+{
+  uint32_t state;
+  uint32_t policy;
+  int32_t pid;
+  uint32_t reserved;
+  uint64_t read_pos;   /* start of the next record to read */
+  uint64_t rec_offset; /* bytes of that record already returned */
+  uint64_t next_seq;
+  uint64_t read_records;
+  uint64_t dropped_records;
+  uint64_t dropped_bytes;
+  uint64_t overruns;
+} __attribute__ ((aligned (64)));
+
+typedef struct shmring_hdr shmring_hdr_t;
+struct shmring_hdr
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  uint64_t data_offset;
+  int32_t writer_pid;
+  uint32_t closed;
+  /* Written by the writer only */
+  uint64_t write_pos __attribute__ ((aligned (64)));
+  uint64_t tail_pos;
+  uint64_t write_seq;
+  uint64_t written_bytes;
+  /* Futex words, and the number of threads sleeping on each */
+  uint32_t data_futex __attribute__ ((aligned (64)));
+  uint32_t data_waiters;
+  uint32_t space_futex;
+  uint32_t space_waiters;
+  shmring_slot_t slots[TIZ_SHMRING_MAX_READERS];
+};
+
+struct tiz_shmring
+{
+  shmring_hdr_t * p_hdr_;
+  uint8_t * p_data_;
+  size_t map_size_;
+  uint64_t cap_;
+  int fd_;
+  bool writer_;
+  uint32_t wakeups_; /* tiz_shmring_wake calls on this handle */
+  char path_[PATH_MAX];
+};
+
+static inline uint64_t
+align_up (const uint64_t a_val, const uint64_t a_align)
+{
+  return (a_val + a_align - 1) / a_align * a_align;
+}
+
+static bool
+valid_name (const char * ap_name)
+{
+  size_t i = 0;
+  if (!ap_name || !ap_name[0] || strlen (ap_name) > SHMRING_MAX_NAME_LEN)
+    {
+      return false;
+    }
+  for (i = 0; ap_name[i]; ++i)
+    {
+      const char c = ap_name[i];
+      if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+            || (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.'))
+        {
+          return false;
+        }
+    }
+  return ap_name[0] != '.';
+}
+
+/* The file that publishes a ring: $XDG_RUNTIME_DIR/tizonia-shmring-<name>,
+   or /tmp/tizonia-shmring-<name> */
+static bool
+name_path (const char * ap_name, char * ap_path, const size_t a_size)
+{
+  const char * p_dir = getenv ("XDG_RUNTIME_DIR");
+  int n = 0;
+  if (!p_dir || !p_dir[0])
+    {
+      p_dir = "/tmp";
+    }
+  n = snprintf (ap_path, a_size, "%s/tizonia-shmring-%s", p_dir, ap_name);
+  return n > 0 && (size_t) n < a_size;
+}
+
+static bool
+publish (tiz_shmring_t * ap_ring)
+{
+  char tmp[PATH_MAX + 16];
+  char line[64];
+  int fd = -1;
+  int len = 0;
+  bool ok = false;
+
+  /* The directory may be /tmp: the temporary file must be a new one (mkstemp
+     opens with O_EXCL, so it neither reuses nor follows anything planted
+     there), and rename replaces a link at the final name, not its target */
+  snprintf (tmp, sizeof (tmp), "%s.XXXXXX", ap_ring->path_);
+  len = snprintf (line, sizeof (line), "%d %d\n", (int) getpid (),
+                  ap_ring->fd_);
+  fd = mkstemp (tmp);
+  if (fd >= 0)
+    {
+      (void) fcntl (fd, F_SETFD, FD_CLOEXEC);
+      ok = (write (fd, line, len) == len);
+      ok = (0 == close (fd)) && ok;
+      /* rename is atomic: readers see either the old ring or this one */
+      ok = ok && (0 == rename (tmp, ap_ring->path_));
+      if (!ok)
+        {
+          (void) unlink (tmp);
+        }
+    }
+  return ok;
+}
+
+static bool
+read_name (const char * ap_path, int * ap_pid, int * ap_fd)
+{
+  char line[64];
+  struct stat st;
+  int fd = open (ap_path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+  ssize_t n = 0;
+  if (fd < 0)
+    {
+      return false;
+    }
+  /* Only trust names published by this user */
+  if (0 != fstat (fd, &st) || !S_ISREG (st.st_mode) || st.st_uid != geteuid ())
+    {
+      (void) close (fd);
+      return false;
+    }
+  n = read (fd, line, sizeof (line) - 1);
+  (void) close (fd);
+  if (n <= 0)
+    {
+      return false;
+    }
+  line[n] = '\0';
+  return 2 == sscanf (line, "%d %d", ap_pid, ap_fd);
+}
+
+static void
+unpublish (tiz_shmring_t * ap_ring)
+{
+  int pid = -1;
+  int fd = -1;
+  /* Only remove the name if it still refers to this ring */
+  if (read_name (ap_ring->path_, &pid, &fd) && pid == (int) getpid ()
+      && fd == ap_ring->fd_)
+    {
+      (void) unlink (ap_ring->path_);
+    }
+}
+
+/*
+ * Futexes
+ */
+
+static void
+futex_wake_all (uint32_t * ap_word)
+{
+  (void) syscall (SYS_futex, ap_word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void
+deadline_from_now (const int a_timeout_ms, struct timespec * ap_deadline)
+{
+  clock_gettime (CLOCK_MONOTONIC, ap_deadline);
+  if (a_timeout_ms > 0)
+    {
+      ap_deadline->tv_sec += a_timeout_ms / 1000;
+      ap_deadline->tv_nsec += (long) (a_timeout_ms % 1000) * 1000000L;
+      if (ap_deadline->tv_nsec >= 1000000000L)
+        {
+          ap_deadline->tv_sec++;
+          ap_deadline->tv_nsec -= 1000000000L;
+        }
+    }
+}
+
+/* Sleeps while *ap_word is a_val, until woken up or until the deadline (a
+   negative timeout has none). Returns false if the deadline had passed. */
+static bool
+sleep_on (uint32_t * ap_word, const uint32_t a_val, const int a_timeout_ms,
+          const struct timespec * ap_deadline)
+{
+  struct timespec rel;
+  struct timespec * p_rel = NULL;
+
+  if (a_timeout_ms >= 0)
+    {
+      struct timespec now;
+      clock_gettime (CLOCK_MONOTONIC, &now);
+      rel.tv_sec = ap_deadline->tv_sec - now.tv_sec;
+      rel.tv_nsec = ap_deadline->tv_nsec - now.tv_nsec;
+      if (rel.tv_nsec < 0)
+        {
+          rel.tv_sec--;
+          rel.tv_nsec += 1000000000L;
+        }
+      if (rel.tv_sec < 0 || (0 == rel.tv_sec && 0 == rel.tv_nsec))
+        {
+          return false;
+        }
+      p_rel = &rel;
+    }
+
+  /* Shared futex: the word may be mapped in other processes */
+  (void) syscall (SYS_futex, ap_word, FUTEX_WAIT, a_val, p_rel, NULL, 0);
+  return true;
+}
+
+/* Bumps a futex word, and wakes up whoever sleeps on it */
+static void
+notify (uint32_t * ap_word, uint32_t * ap_waiters)
+{
+  (void) __atomic_add_fetch (ap_word, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n (ap_waiters, __ATOMIC_SEQ_CST) > 0)
+    {
+      futex_wake_all (ap_word);
+    }
+}
+
+/*
+ * Records
+ */
+
+static inline uint64_t
+rec_size (const uint32_t a_len)
+{
+  return SHMRING_REC_HDR_SIZE + align_up (a_len, SHMRING_ALIGN);
+}
+
+/* The position of the record that follows the one at a_pos */
+static uint64_t
+next_record (const tiz_shmring_t * ap_ring, const uint64_t a_pos)
+{
+  const uint64_t off = a_pos % ap_ring->cap_;
+  const uint64_t contig = ap_ring->cap_ - off;
+  shmring_rec_t rec;
+
+  if (contig < SHMRING_REC_HDR_SIZE)
+    {
+      return a_pos + contig;
+    }
+  memcpy (&rec, ap_ring->p_data_ + off, SHMRING_REC_HDR_SIZE);
+  if (SHMRING_REC_PAD == rec.kind)
+    {
+      return a_pos + contig;
+    }
+  return a_pos + rec_size (rec.len);
+}
+
+static bool
+reader_is_gone (const shmring_slot_t * ap_slot)
+{
+  const pid_t pid = (pid_t) load_rlx (&ap_slot->pid);
+  return pid > 0 && pid != getpid () && -1 == kill (pid, 0) && ESRCH == errno;
+}
+
+/* Whether the backpressure readers leave room for the ring to reach a_end.
+   Readers whose process has died are detached. */
+static bool
+has_room (tiz_shmring_t * ap_ring, const uint64_t a_end)
+{
+  shmring_hdr_t * p_hdr = ap_ring->p_hdr_;
+  int i = 0;
+
+  for (i = 0; i < TIZ_SHMRING_MAX_READERS; ++i)
+    {
+      shmring_slot_t * p_slot = &(p_hdr->slots[i]);
+      if (SHMRING_SLOT_ACTIVE == load_acq (&p_slot->state)
+          && ETIZShmringPolicyBackpressure == load_rlx (&p_slot->policy)
+          && a_end - load_acq (&p_slot->read_pos) > ap_ring->cap_)
+        {
+          uint32_t active = SHMRING_SLOT_ACTIVE;
+          if (!reader_is_gone (p_slot))
+            {
+              return false;
+            }
+          TIZ_LOG (TIZ_PRIORITY_NOTICE, "Detaching dead reader [%d] (pid %d)",
+                   i, (int) p_slot->pid);
+          (void) __atomic_compare_exchange_n (
+            &p_slot->state, &active, SHMRING_SLOT_FREE, false,
+            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+        }
+    }
+  return true;
+}
+
+/*
+ * Setup
+ */
+
+static tiz_shmring_t *
+map_ring (const int a_fd, const size_t a_map_size)
+{
+  tiz_shmring_t * p_ring = tiz_mem_calloc (1, sizeof (tiz_shmring_t));
+  void * p_map = NULL;
+
+  if (!p_ring)
+    {
+      return NULL;
+    }
+  p_map
+    = mmap (NULL, a_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, a_fd, 0);
+  if (MAP_FAILED == p_map)
+    {
+      tiz_mem_free (p_ring);
+      return NULL;
+    }
+  p_ring->p_hdr_ = p_map;
+  p_ring->map_size_ = a_map_size;
+  p_ring->fd_ = a_fd;
+  return p_ring;
+}
+
+OMX_ERRORTYPE
+tiz_shmring_create (tiz_shmring_ptr_t * app_ring, const char * ap_name,
+                    const size_t a_capacity)
+{
+  const long page = sysconf (_SC_PAGESIZE);
+  tiz_shmring_t * p_ring = NULL;
+  shmring_hdr_t * p_hdr = NULL;
+  char memfd_name[SHMRING_MAX_NAME_LEN + 16];
+  uint64_t data_offset = 0;
+  uint64_t cap = 0;
+  int fd = -1;
+
+  assert (app_ring);
+  assert (page > 0);
+
+  if (!valid_name (ap_name))
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  cap = align_up (a_capacity < SHMRING_MIN_CAPACITY ? SHMRING_MIN_CAPACITY
+                                                    : a_capacity,
+                  page);
+  data_offset = align_up (sizeof (shmring_hdr_t), page);
+
+  snprintf (memfd_name, sizeof (memfd_name), "tizshmring-%s", ap_name);
+  fd = (int) syscall (SYS_memfd_create, memfd_name, MFD_CLOEXEC);
+  if (fd < 0 || 0 != ftruncate (fd, (off_t) (data_offset + cap)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : memfd (%s)", ap_name,
+               strerror (errno));
+      if (fd >= 0)
+        {
+          (void) close (fd);
+        }
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if (!(p_ring = map_ring (fd, data_offset + cap)))
+    {
+      (void) close (fd);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  /* ftruncate has zero-filled the mapping */
+  p_hdr = p_ring->p_hdr_;
+  p_hdr->magic = SHMRING_MAGIC;
+  p_hdr->version = SHMRING_VERSION;
+  p_hdr->capacity = cap;
+  p_hdr->data_offset = data_offset;
+  p_hdr->writer_pid = (int32_t) getpid ();
+  p_ring->p_data_ = (uint8_t *) p_hdr + data_offset;
+  p_ring->cap_ = cap;
+  p_ring->writer_ = true;
+
+  if (!name_path (ap_name, p_ring->path_, sizeof (p_ring->path_))
+      || !publish (p_ring))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : unable to publish the ring",
+               ap_name);
+      (void) munmap (p_hdr, p_ring->map_size_);
+      (void) close (fd);
+      tiz_mem_free (p_ring);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : capacity [%llu] path [%s]", ap_name,
+           (unsigned long long) cap, p_ring->path_);
+  *app_ring = p_ring;
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_shmring_open (tiz_shmring_ptr_t * app_ring, const char * ap_name)
+{
+  char path[PATH_MAX];
+  char proc_path[64];
+  tiz_shmring_t * p_ring = NULL;
+  const shmring_hdr_t * p_hdr = NULL;
+  struct stat st;
+  int pid = -1;
+  int wfd = -1;
+  int fd = -1;
+
+  assert (app_ring);
+
+  if (!valid_name (ap_name) || !name_path (ap_name, path, sizeof (path)))
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  if (!read_name (path, &pid, &wfd))
+    {
+      return OMX_ErrorNotReady;
+    }
+
+  /* This reopens the writer's memfd; it works in the writer's own process
+     too */
+  snprintf (proc_path, sizeof (proc_path), "/proc/%d/fd/%d", pid, wfd);
+  fd = open (proc_path, O_RDWR | O_CLOEXEC);
+  if (fd < 0)
+    {
+      /* The writer has gone away */
+      return OMX_ErrorNotReady;
+    }
+
+  if (0 != fstat (fd, &st) || (size_t) st.st_size < sizeof (shmring_hdr_t)
+      || !(p_ring = map_ring (fd, (size_t) st.st_size)))
+    {
+      (void) close (fd);
+      return OMX_ErrorNotReady;
+    }
+
+  p_hdr = p_ring->p_hdr_;
+  if (SHMRING_MAGIC != p_hdr->magic || SHMRING_VERSION != p_hdr->version
+      || p_hdr->data_offset + p_hdr->capacity != (uint64_t) st.st_size
+      || load_acq (&p_hdr->closed))
+    {
+      /* Not a ring, or one whose writer has closed it */
+      (void) munmap (p_ring->p_hdr_, p_ring->map_size_);
+      (void) close (fd);
+      tiz_mem_free (p_ring);
+      return OMX_ErrorNotReady;
+    }
+
+  p_ring->p_data_ = (uint8_t *) p_ring->p_hdr_ + p_hdr->data_offset;
+  p_ring->cap_ = p_hdr->capacity;
+  p_ring->writer_ = false;
+  snprintf (p_ring->path_, sizeof (p_ring->path_), "%s", path);
+
+  *app_ring = p_ring;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_shmring_destroy (tiz_shmring_t * ap_ring)
+{
+  if (ap_ring)
+    {
+      shmring_hdr_t * p_hdr = ap_ring->p_hdr_;
+      if (ap_ring->writer_)
+        {
+          unpublish (ap_ring);
+          store_rel (&p_hdr->closed, 1);
+          notify (&p_hdr->data_futex, &p_hdr->data_waiters);
+        }
+      (void) munmap (p_hdr, ap_ring->map_size_);
+      (void) close (ap_ring->fd_);
+      tiz_mem_free (ap_ring);
+    }
+}
+
+size_t
+tiz_shmring_max_record (const tiz_shmring_t * ap_ring)
+{
+  uint64_t max = 0;
+  assert (ap_ring);
+  /* A record, and the pad that may precede it, always fit in the ring */
+  max = ap_ring->cap_ / 2 - SHMRING_REC_HDR_SIZE;
+  return (size_t) (max > UINT32_MAX ? UINT32_MAX : max);
+}
+
+/*
+ * Writer
+ */
+
+OMX_ERRORTYPE
+tiz_shmring_write (tiz_shmring_t * ap_ring, const void * ap_data,
+                   const size_t a_nbytes, const OMX_U32 a_flags,
+                   const int a_timeout_ms)
+{
+  shmring_hdr_t * p_hdr = NULL;
+  struct timespec deadline;
+  shmring_rec_t rec;
+  uint64_t wpos = 0;
+  uint64_t off = 0;
+  uint64_t contig = 0;
+  uint64_t need = 0;
+  uint64_t end = 0;
+  uint64_t tail = 0;
+
+  assert (ap_ring);
+  assert (ap_data || 0 == a_nbytes);
+
+  if (!ap_ring->writer_)
+    {
+      return OMX_ErrorIncorrectStateOperation;
+    }
+  if (a_nbytes > tiz_shmring_max_record (ap_ring))
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  p_hdr = ap_ring->p_hdr_;
+  wpos = p_hdr->write_pos;
+  off = wpos % ap_ring->cap_;
+  contig = ap_ring->cap_ - off;
+  need = rec_size ((uint32_t) a_nbytes);
+  end = wpos + (contig < need ? contig + need : need);
+
+  deadline_from_now (a_timeout_ms, &deadline);
+  while (!has_room (ap_ring, end))
+    {
+      uint32_t val = 0;
+      bool waited = false;
+      if (0 == a_timeout_ms)
+        {
+          return OMX_ErrorNotReady;
+        }
+      (void) __atomic_add_fetch (&p_hdr->space_waiters, 1, __ATOMIC_SEQ_CST);
+      val = __atomic_load_n (&p_hdr->space_futex, __ATOMIC_SEQ_CST);
+      waited = has_room (ap_ring, end)
+               || sleep_on (&p_hdr->space_futex, val, a_timeout_ms, &deadline);
+      (void) __atomic_sub_fetch (&p_hdr->space_waiters, 1, __ATOMIC_SEQ_CST);
+      if (!waited)
+        {
+          return OMX_ErrorNotReady;
+        }
+    }
+
+  /* Move the tail past the records about to be overwritten. Drop-oldest
+     readers check the tail after copying, so the new tail must be visible
+     before the data changes. */
+  tail = p_hdr->tail_pos;
+  if (end > ap_ring->cap_)
+    {
+      const uint64_t first_kept = end - ap_ring->cap_;
+      while (tail < first_kept)
+        {
+          tail = next_record (ap_ring, tail);
+        }
+      if (tail != p_hdr->tail_pos)
+        {
+          store_rlx (&p_hdr->tail_pos, tail);
+          __atomic_thread_fence (__ATOMIC_RELEASE);
+        }
+    }
+
+  if (contig < need)
+    {
+      if (contig >= SHMRING_REC_HDR_SIZE)
+        {
+          memset (&rec, 0, sizeof (rec));
+          rec.kind = SHMRING_REC_PAD;
+          rec.len = (uint32_t) (contig - SHMRING_REC_HDR_SIZE);
+          memcpy (ap_ring->p_data_ + off, &rec, SHMRING_REC_HDR_SIZE);
+        }
+      off = 0;
+    }
+
+  rec.len = (uint32_t) a_nbytes;
+  rec.flags = a_flags;
+  rec.kind = SHMRING_REC_DATA;
+  rec.reserved = 0;
+  rec.seq = p_hdr->write_seq;
+  memcpy (ap_ring->p_data_ + off, &rec, SHMRING_REC_HDR_SIZE);
+  if (a_nbytes > 0)
+    {
+      memcpy (ap_ring->p_data_ + off + SHMRING_REC_HDR_SIZE, ap_data,
+              a_nbytes);
+    }
+
+  store_rel (&p_hdr->write_seq, rec.seq + 1);
+  store_rlx (&p_hdr->written_bytes, p_hdr->written_bytes + a_nbytes);
+  store_rel (&p_hdr->write_pos, end);
+  notify (&p_hdr->data_futex, &p_hdr->data_waiters);
+
+  return OMX_ErrorNone;
+}
+
+/*
+ * Readers
+ */
+
+OMX_ERRORTYPE
+tiz_shmring_attach (tiz_shmring_t * ap_ring, const tiz_shmring_policy_t a_policy,
+                    int * ap_reader)
+{
+  shmring_hdr_t * p_hdr = NULL;
+  int i = 0;
+
+  assert (ap_ring);
+  assert (ap_reader);
+  assert (ETIZShmringPolicyBackpressure == a_policy
+          || ETIZShmringPolicyDropOldest == a_policy);
+
+  p_hdr = ap_ring->p_hdr_;
+  for (i = 0; i < TIZ_SHMRING_MAX_READERS; ++i)
+    {
+      shmring_slot_t * p_slot = &(p_hdr->slots[i]);
+      uint32_t free_state = SHMRING_SLOT_FREE;
+      if (__atomic_compare_exchange_n (&p_slot->state, &free_state,
+                                       SHMRING_SLOT_CLAIMED, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+          store_rlx (&p_slot->policy, (uint32_t) a_policy);
+          store_rlx (&p_slot->pid, (int32_t) getpid ());
+          store_rlx (&p_slot->rec_offset, 0);
+          store_rlx (&p_slot->read_records, 0);
+          store_rlx (&p_slot->dropped_records, 0);
+          store_rlx (&p_slot->dropped_bytes, 0);
+          store_rlx (&p_slot->overruns, 0);
+          /* The writer updates the sequence number first: if a record is
+             written meanwhile, this can only miss counting it as dropped */
+          store_rel (&p_slot->read_pos, load_acq (&p_hdr->write_pos));
+          store_rlx (&p_slot->next_seq, load_acq (&p_hdr->write_seq));
+          store_rel (&p_slot->state, SHMRING_SLOT_ACTIVE);
+          *ap_reader = i;
+          return OMX_ErrorNone;
+        }
+    }
+
+  return OMX_ErrorInsufficientResources;
+}
+
+void
+tiz_shmring_detach (tiz_shmring_t * ap_ring, const int a_reader)
+{
+  shmring_hdr_t * p_hdr = NULL;
+  assert (ap_ring);
+  assert (a_reader >= 0 && a_reader < TIZ_SHMRING_MAX_READERS);
+  p_hdr = ap_ring->p_hdr_;
+  store_rel (&p_hdr->slots[a_reader].state, SHMRING_SLOT_FREE);
+  /* The writer may be waiting for this reader */
+  notify (&p_hdr->space_futex, &p_hdr->space_waiters);
+}
+
+static OMX_ERRORTYPE
+wait_for_data (tiz_shmring_t * ap_ring, const uint64_t a_pos,
+               const int a_timeout_ms, const struct timespec * ap_deadline)
+{
+  shmring_hdr_t * p_hdr = ap_ring->p_hdr_;
+  const uint32_t wakeups = __atomic_load_n (&ap_ring->wakeups_,
+                                            __ATOMIC_SEQ_CST);
+
+  for (;;)
+    {
+      uint32_t val = 0;
+      bool waited = false;
+
+      if (a_pos < load_acq (&p_hdr->write_pos))
+        {
+          return OMX_ErrorNone;
+        }
+      if (load_acq (&p_hdr->closed))
+        {
+          return OMX_ErrorNoMore;
+        }
+      if (0 == a_timeout_ms)
+        {
+          return OMX_ErrorNotReady;
+        }
+
+      (void) __atomic_add_fetch (&p_hdr->data_waiters, 1, __ATOMIC_SEQ_CST);
+      val = __atomic_load_n (&p_hdr->data_futex, __ATOMIC_SEQ_CST);
+      waited = a_pos < load_acq (&p_hdr->write_pos)
+               || load_acq (&p_hdr->closed)
+               || sleep_on (&p_hdr->data_futex, val, a_timeout_ms,
+                            ap_deadline);
+      (void) __atomic_sub_fetch (&p_hdr->data_waiters, 1, __ATOMIC_SEQ_CST);
+
+      if (!waited
+          || wakeups != __atomic_load_n (&ap_ring->wakeups_, __ATOMIC_SEQ_CST))
+        {
+          return OMX_ErrorNotReady;
+        }
+    }
+}
+
+/* The writer has overtaken a drop-oldest reader: skip to the tail */
+static uint64_t
+resync (shmring_slot_t * ap_slot, const uint64_t a_pos, const uint64_t a_tail)
+{
+  store_rlx (&ap_slot->dropped_bytes,
+             ap_slot->dropped_bytes + (a_tail - a_pos));
+  store_rlx (&ap_slot->overruns, ap_slot->overruns + 1);
+  store_rlx (&ap_slot->rec_offset, 0);
+  store_rel (&ap_slot->read_pos, a_tail);
+  return a_tail;
+}
+
+OMX_ERRORTYPE
+tiz_shmring_read (tiz_shmring_t * ap_ring, const int a_reader, void * ap_buf,
+                  const size_t a_size, size_t * ap_nbytes, OMX_U32 * ap_flags,
+                  OMX_BOOL * ap_end, const int a_timeout_ms)
+{
+  shmring_hdr_t * p_hdr = NULL;
+  shmring_slot_t * p_slot = NULL;
+  struct timespec deadline;
+  bool drop_oldest = false;
+  uint64_t pos = 0;
+
+  assert (ap_ring);
+  assert (a_reader >= 0 && a_reader < TIZ_SHMRING_MAX_READERS);
+  assert (ap_buf || 0 == a_size);
+  assert (ap_nbytes);
+  assert (ap_flags);
+  assert (ap_end);
+
+  p_hdr = ap_ring->p_hdr_;
+  p_slot = &(p_hdr->slots[a_reader]);
+  assert (SHMRING_SLOT_ACTIVE == p_slot->state);
+  drop_oldest = (ETIZShmringPolicyDropOldest == p_slot->policy);
+  pos = p_slot->read_pos;
+  *ap_nbytes = 0;
+  *ap_flags = 0;
+  *ap_end = OMX_FALSE;
+
+  deadline_from_now (a_timeout_ms, &deadline);
+  for (;;)
+    {
+      const OMX_ERRORTYPE rc
+        = wait_for_data (ap_ring, pos, a_timeout_ms, &deadline);
+      uint64_t off = 0;
+      uint64_t contig = 0;
+      uint64_t tail = 0;
+      uint64_t rec_offset = 0;
+      size_t chunk = 0;
+      bool valid = false;
+      shmring_rec_t rec;
+
+      if (OMX_ErrorNone != rc)
+        {
+          return rc;
+        }
+
+      if (drop_oldest && pos < (tail = load_acq (&p_hdr->tail_pos)))
+        {
+          const bool torn = (0 != p_slot->rec_offset);
+          pos = resync (p_slot, pos, tail);
+          if (torn)
+            {
+              return OMX_ErrorOverflow;
+            }
+          continue;
+        }
+
+      off = pos % ap_ring->cap_;
+      contig = ap_ring->cap_ - off;
+      if (contig < SHMRING_REC_HDR_SIZE)
+        {
+          pos += contig;
+          store_rel (&p_slot->read_pos, pos);
+          continue;
+        }
+
+      rec_offset = p_slot->rec_offset;
+      memcpy (&rec, ap_ring->p_data_ + off, SHMRING_REC_HDR_SIZE);
+      valid = (SHMRING_REC_PAD == rec.kind
+               || (SHMRING_REC_DATA == rec.kind
+                   && rec_size (rec.len) <= contig && rec_offset <= rec.len));
+      if (valid && SHMRING_REC_DATA == rec.kind)
+        {
+          chunk = rec.len - rec_offset;
+          chunk = chunk > a_size ? a_size : chunk;
+          memcpy (ap_buf,
+                  ap_ring->p_data_ + off + SHMRING_REC_HDR_SIZE + rec_offset,
+                  chunk);
+        }
+
+      if (drop_oldest)
+        {
+          /* Pairs with the fence in tiz_shmring_write: if the tail has not
+             moved past this record, nothing that was copied changed */
+          __atomic_thread_fence (__ATOMIC_ACQUIRE);
+          tail = load_rlx (&p_hdr->tail_pos);
+          if (pos < tail)
+            {
+              pos = resync (p_slot, pos, tail);
+              if (rec_offset > 0)
+                {
+                  return OMX_ErrorOverflow;
+                }
+              continue;
+            }
+        }
+
+      if (!valid)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Corrupted record at [%llu]",
+                   (unsigned long long) pos);
+          return OMX_ErrorUndefined;
+        }
+
+      if (SHMRING_REC_PAD == rec.kind)
+        {
+          pos += contig;
+          store_rel (&p_slot->read_pos, pos);
+          continue;
+        }
+
+      *ap_nbytes = chunk;
+      if (rec_offset + chunk < rec.len)
+        {
+          store_rlx (&p_slot->rec_offset, rec_offset + chunk);
+        }
+      else
+        {
+          const uint64_t next_seq = p_slot->next_seq;
+          if (rec.seq > next_seq)
+            {
+              store_rlx (&p_slot->dropped_records,
+                         p_slot->dropped_records + (rec.seq - next_seq));
+            }
+          store_rlx (&p_slot->next_seq, rec.seq + 1);
+          store_rlx (&p_slot->read_records, p_slot->read_records + 1);
+          store_rlx (&p_slot->rec_offset, 0);
+          *ap_flags = rec.flags;
+          *ap_end = OMX_TRUE;
+          /* The release makes sure the copy is done before the writer may
+             reuse the space */
+          store_rel (&p_slot->read_pos, pos + rec_size (rec.len));
+          if (!drop_oldest)
+            {
+              notify (&p_hdr->space_futex, &p_hdr->space_waiters);
+            }
+        }
+      return OMX_ErrorNone;
+    }
+}
+
+OMX_ERRORTYPE
+tiz_shmring_wait (tiz_shmring_t * ap_ring, const int a_reader,
+                  const int a_timeout_ms)
+{
+  struct timespec deadline;
+  assert (ap_ring);
+  assert (a_reader >= 0 && a_reader < TIZ_SHMRING_MAX_READERS);
+  deadline_from_now (a_timeout_ms, &deadline);
+  return wait_for_data (ap_ring, ap_ring->p_hdr_->slots[a_reader].read_pos,
+                        a_timeout_ms, &deadline);
+}
+
+void
+tiz_shmring_wake (tiz_shmring_t * ap_ring)
+{
+  assert (ap_ring);
+  (void) __atomic_add_fetch (&ap_ring->wakeups_, 1, __ATOMIC_SEQ_CST);
+  (void) __atomic_add_fetch (&ap_ring->p_hdr_->data_futex, 1,
+                             __ATOMIC_SEQ_CST);
+  futex_wake_all (&ap_ring->p_hdr_->data_futex);
+}
+
+OMX_ERRORTYPE
+tiz_shmring_stats (const tiz_shmring_t * ap_ring, const int a_reader,
+                   tiz_shmring_stats_t * ap_stats)
+{
+  const shmring_hdr_t * p_hdr = NULL;
+  const shmring_slot_t * p_slot = NULL;
+  uint64_t wpos = 0;
+  uint64_t rpos = 0;
+
+  assert (ap_ring);
+  assert (ap_stats);
+
+  if (a_reader < 0 || a_reader >= TIZ_SHMRING_MAX_READERS)
+    {
+      return OMX_ErrorNoMore;
+    }
+
+  p_hdr = ap_ring->p_hdr_;
+  p_slot = &(p_hdr->slots[a_reader]);
+  if (SHMRING_SLOT_ACTIVE != load_acq (&p_slot->state))
+    {
+      return OMX_ErrorNoMore;
+    }
+
+  rpos = load_acq (&p_slot->read_pos);
+  wpos = load_acq (&p_hdr->write_pos);
+  ap_stats->written_records = load_rlx (&p_hdr->write_seq);
+  ap_stats->written_bytes = load_rlx (&p_hdr->written_bytes);
+  ap_stats->lag_bytes = wpos > rpos ? wpos - rpos : 0;
+  ap_stats->read_records = load_rlx (&p_slot->read_records);
+  ap_stats->dropped_records = load_rlx (&p_slot->dropped_records);
+  ap_stats->dropped_bytes = load_rlx (&p_slot->dropped_bytes);
+  ap_stats->overruns = load_rlx (&p_slot->overruns);
+  ap_stats->policy = (tiz_shmring_policy_t) load_rlx (&p_slot->policy);
+  return OMX_ErrorNone;
+}
@@ -0,0 +1,268 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Single-writer, multi-reader shared memory ring
+ *
+ *
+ */
+
+#ifndef TIZSHMRING_H
+#define TIZSHMRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* @defgroup tizshmring Single-writer, multi-reader shared memory ring.
+*
+* A ring of variable-sized records in a memfd-backed shared mapping, that one
+* writer fills and several readers consume, each at its own pace, in the same
+* process or in others. Readers and a blocked writer sleep on futexes in the
+* shared mapping.
+*
+* The writer publishes the ring under a name; readers open it by that name
+* (the name file records the writer's pid and the descriptor of the memfd,
+* which is reopened through /proc).
+*
+* Each reader chooses what happens when it falls behind by a full ring:
+* either the writer waits for it (backpressure), or the oldest records it
+* has not read yet are dropped (drop-oldest). The per-reader statistics
+* record its lag and what it has lost.
+*
+* @ingroup libtizplatform
+*/
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * The maximum number of readers attached to a ring at the same time.
+ * @ingroup tizshmring
+ */
+#define TIZ_SHMRING_MAX_READERS 16
+
+/**
+ * Shared memory ring opaque handle.
+ * @ingroup tizshmring
+ */
+typedef struct tiz_shmring tiz_shmring_t;
+typedef /*@null@ */ tiz_shmring_t * tiz_shmring_ptr_t;
+
+/**
+ * What the writer does when a reader is a full ring behind.
+ * @ingroup tizshmring
+ */
+typedef enum tiz_shmring_policy
+{
+  ETIZShmringPolicyBackpressure = 0, /**< The writer waits for the reader. */
+  ETIZShmringPolicyDropOldest        /**< The reader loses the oldest records
+                                        it has not read yet. */
+} tiz_shmring_policy_t;
+
+/**
+ * Per-reader statistics.
+ * @ingroup tizshmring
+ */
+typedef struct tiz_shmring_stats tiz_shmring_stats_t;
+struct tiz_shmring_stats
+{
+  OMX_U64 written_records; /**< Records written to the ring so far. */
+  OMX_U64 written_bytes;   /**< Payload bytes written to the ring so far. */
+  OMX_U64 lag_bytes;       /**< Ring bytes between the reader and the
+                                writer. */
+  OMX_U64 read_records;    /**< Records consumed by the reader. */
+  OMX_U64 dropped_records; /**< Records the reader lost. */
+  OMX_U64 dropped_bytes;   /**< Ring bytes the reader lost. */
+  OMX_U64 overruns;        /**< Times the writer overtook the reader. */
+  tiz_shmring_policy_t policy;
+};
+
+/**
+ * Create a ring, and publish it under a name. The name is a file in
+ * $XDG_RUNTIME_DIR, or in /tmp; readers only accept names published by the
+ * same user.
+ *
+ * @ingroup tizshmring
+ * @param app_ring A ring handle to be initialised.
+ * @param ap_name The name of the ring (letters, digits, '-', '_' and '.').
+ * Any ring with the same name is replaced.
+ * @param a_capacity The size of the ring, in bytes (rounded up to the page
+ * size). It bounds the size of a record (see tiz_shmring_max_record).
+ * @return OMX_ErrorNone on success, OMX_ErrorBadParameter if the name is not
+ * valid, or OMX_ErrorInsufficientResources.
+ */
+OMX_ERRORTYPE
+tiz_shmring_create (tiz_shmring_ptr_t * app_ring, const char * ap_name,
+                    const size_t a_capacity);
+
+/**
+ * Open a ring published by a writer (possibly in another process).
+ *
+ * @ingroup tizshmring
+ * @param app_ring A ring handle to be initialised.
+ * @param ap_name The name of the ring.
+ * @return OMX_ErrorNone on success, OMX_ErrorNotReady if the ring does not
+ * exist (yet), or OMX_ErrorInsufficientResources.
+ */
+OMX_ERRORTYPE
+tiz_shmring_open (tiz_shmring_ptr_t * app_ring, const char * ap_name);
+
+/**
+ * Destroy a ring handle. When the handle is the writer's, the ring is closed
+ * (readers get OMX_ErrorNoMore once they have read what was left) and its
+ * name is unpublished. The memory goes away with the last handle.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_shmring_destroy (tiz_shmring_t * ap_ring);
+
+/**
+ * The size of the largest record that can be written to the ring.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+size_t
+tiz_shmring_max_record (const tiz_shmring_t * ap_ring);
+
+/**
+ * Append a record to the ring. Only the handle that created the ring can
+ * write to it.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param ap_data The payload.
+ * @param a_nbytes The payload size (at most tiz_shmring_max_record bytes).
+ * @param a_flags Flags delivered with the record (e.g. OMX buffer flags).
+ * @param a_timeout_ms How long to wait for backpressure readers to make
+ * room: 0 does not wait, a negative value waits for as long as needed.
+ * @return OMX_ErrorNone on success, OMX_ErrorNotReady if there is no room
+ * after a_timeout_ms, OMX_ErrorBadParameter if the record is too large.
+ */
+OMX_ERRORTYPE
+tiz_shmring_write (tiz_shmring_t * ap_ring, const void * ap_data,
+                   const size_t a_nbytes, const OMX_U32 a_flags,
+                   const int a_timeout_ms);
+
+/**
+ * Attach a reader to the ring. The reader starts at the next record that is
+ * written.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param a_policy What to do when the reader falls a full ring behind.
+ * @param ap_reader The reader id (output).
+ * @return OMX_ErrorNone on success, OMX_ErrorInsufficientResources if
+ * TIZ_SHMRING_MAX_READERS readers are already attached.
+ */
+OMX_ERRORTYPE
+tiz_shmring_attach (tiz_shmring_t * ap_ring, const tiz_shmring_policy_t a_policy,
+                    int * ap_reader);
+
+/**
+ * Detach a reader from the ring.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param a_reader The reader id.
+ */
+void
+tiz_shmring_detach (tiz_shmring_t * ap_ring, const int a_reader);
+
+/**
+ * Copy the next record, or the next part of it, to a buffer. When the record
+ * does not fit, the rest of it is returned by the following calls, and its
+ * flags with the last part. If the writer overtakes a drop-oldest reader
+ * while it is in the middle of a record, the rest of that record is lost:
+ * the call returns OMX_ErrorOverflow, and the next one starts at the oldest
+ * record still in the ring.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param a_reader The reader id.
+ * @param ap_buf The destination buffer.
+ * @param a_size The size of the destination buffer.
+ * @param ap_nbytes The number of bytes copied (output).
+ * @param ap_flags The record's flags, or 0 if the record continues (output).
+ * @param ap_end OMX_TRUE if this was the last part of the record (output).
+ * @param a_timeout_ms How long to wait for a record: 0 does not wait, a
+ * negative value waits for as long as needed.
+ * @return OMX_ErrorNone on success, OMX_ErrorNotReady if there was no record
+ * after a_timeout_ms, OMX_ErrorNoMore if the writer has closed the ring and
+ * every record has been read, OMX_ErrorOverflow if the parts of a record
+ * returned so far will not be completed.
+ */
+OMX_ERRORTYPE
+tiz_shmring_read (tiz_shmring_t * ap_ring, const int a_reader, void * ap_buf,
+                  const size_t a_size, size_t * ap_nbytes, OMX_U32 * ap_flags,
+                  OMX_BOOL * ap_end, const int a_timeout_ms);
+
+/**
+ * Wait until the reader has a record to read.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param a_reader The reader id.
+ * @param a_timeout_ms 0 does not wait, a negative value waits for as long as
+ * needed.
+ * @return OMX_ErrorNone if there is a record, OMX_ErrorNotReady on timeout
+ * (or after tiz_shmring_wake), OMX_ErrorNoMore if the ring is closed and
+ * every record has been read.
+ */
+OMX_ERRORTYPE
+tiz_shmring_wait (tiz_shmring_t * ap_ring, const int a_reader,
+                  const int a_timeout_ms);
+
+/**
+ * Wake up every reader waiting on the ring (e.g. to stop a thread that waits
+ * in tiz_shmring_wait).
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_shmring_wake (tiz_shmring_t * ap_ring);
+
+/**
+ * Retrieve the statistics of a reader.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param a_reader The reader id (any attached reader, not only those attached
+ * through this handle).
+ * @param ap_stats The statistics (output).
+ * @return OMX_ErrorNone on success, OMX_ErrorNoMore if there is no reader
+ * with that id.
+ */
+OMX_ERRORTYPE
+tiz_shmring_stats (const tiz_shmring_t * ap_ring, const int a_reader,
+                   tiz_shmring_stats_t * ap_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSHMRING_H */
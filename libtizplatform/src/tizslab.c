@@ -0,0 +1,610 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizslab.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Thread-safe slab allocator
+ *
+ * Three layers:
+ *
+ * - Thread caches: one magazine (a small stack of free objects) per size
+ *   class and thread, reached through a pthread key. Allocations pop from the
+ *   magazine, frees push to it, no matter which thread allocated the object.
+ *
+ * - Depots: one per size class, protected by a mutex. An empty magazine is
+ *   refilled with SLAB_BATCH objects, and a full one gives SLAB_BATCH objects
+ *   back, so the lock is taken at most once every SLAB_BATCH operations.
+ *
+ * - Chunks: SLAB_CHUNK_SZ blocks carved into equally-sized slots. Each chunk
+ *   keeps its own free list and a count of the objects handed out of it; a
+ *   chunk whose objects have all come back is released, unless it is the
+ *   only empty chunk of its class.
+ *
+ * Every slot starts with a small header that points back to its chunk, so
+ * tiz_slab_free needs no size.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "tizplatform.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.slab"
+#endif
+
+#define SLAB_CHUNK_SZ (64 * 1024)
+#define SLAB_MAG_SZ 32
+#define SLAB_BATCH (SLAB_MAG_SZ / 2)
+#define SLAB_MAX_EMPTY_CHUNKS 1
+#define SLAB_HDR_SZ 16
+#define SLAB_MAGIC 0x51ab51abU
+#define SLAB_LARGE_CLASS 0xffffffffU
+#define SLAB_ROUND_UP(x) (((x) + 15) & ~((size_t) 15))
+
+/* Objects up to 128 bytes are 16 bytes apart, then the spacing doubles every
+   four classes */
+static const size_t class_sz_tbl[TIZ_SLAB_NUM_CLASSES]
+  = {16,  32,  48,  64,  80,  96,   112,  128,  160,  192,  224,  256,
+     320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048};
+
+typedef struct slab_chunk slab_chunk_t;
+
+typedef struct slab_hdr slab_hdr_t;
+struct slab_hdr
+{
+  slab_chunk_t * p_chunk; /* NULL for large objects */
+  uint32_t class;
+  uint32_t magic;
+};
+
+struct slab_chunk
+{
+  /* Links in the class's list of chunks with free slots */
+  slab_chunk_t * p_prev;
+  slab_chunk_t * p_next;
+  bool avail;
+  /* Slots given back, linked through their first word */
+  void * p_free;
+  /* Slots never handed out yet */
+  uint8_t * p_bump;
+  uint8_t * p_end;
+  int32_t n_out;
+};
+#define SLAB_CHUNK_HDR_SZ SLAB_ROUND_UP (sizeof (slab_chunk_t))
+
+typedef struct slab_class slab_class_t;
+struct slab_class
+{
+  pthread_mutex_t mutex;
+  size_t slot_sz;
+  slab_chunk_t * p_avail;
+  int32_t n_chunks;
+  int32_t n_empty;
+  int32_t n_out;
+  uint64_t allocs;
+  uint64_t frees;
+  uint64_t refills;
+  uint64_t flushes;
+  uint64_t chunks_released;
+} __attribute__ ((aligned (64)));
+
+typedef struct slab_mag slab_mag_t;
+struct slab_mag
+{
+  int32_t n;
+  void * objs[SLAB_MAG_SZ];
+};
+
+typedef struct slab_tcache slab_tcache_t;
+struct slab_tcache
+{
+  slab_mag_t mags[TIZ_SLAB_NUM_CLASSES];
+  uint64_t allocs[TIZ_SLAB_NUM_CLASSES];
+  uint64_t frees[TIZ_SLAB_NUM_CLASSES];
+};
+
+static struct
+{
+  slab_class_t classes[TIZ_SLAB_NUM_CLASSES];
+  /* Size class of each request size, in 16-byte steps */
+  uint8_t class_of[TIZ_SLAB_MAX_SIZE / 16 + 1];
+  pthread_key_t key;
+  bool key_ok;
+  uint64_t large_allocs;
+  uint64_t large_frees;
+} g_slab;
+
+static pthread_once_t g_slab_once = PTHREAD_ONCE_INIT;
+
+static inline slab_hdr_t *
+get_hdr (void * ap_usr)
+{
+  return (slab_hdr_t *) ((uint8_t *) ap_usr - SLAB_HDR_SZ);
+}
+
+static inline void *
+get_usr (slab_hdr_t * ap_hdr)
+{
+  return (uint8_t *) ap_hdr + SLAB_HDR_SZ;
+}
+
+/*
+ * Chunks and depots. These run with the class lock held.
+ */
+
+static void
+avail_link (slab_class_t * ap_cls, slab_chunk_t * ap_chunk)
+{
+  assert (!ap_chunk->avail);
+  ap_chunk->p_prev = NULL;
+  ap_chunk->p_next = ap_cls->p_avail;
+  if (ap_cls->p_avail)
+    {
+      ap_cls->p_avail->p_prev = ap_chunk;
+    }
+  ap_cls->p_avail = ap_chunk;
+  ap_chunk->avail = true;
+}
+
+static void
+avail_unlink (slab_class_t * ap_cls, slab_chunk_t * ap_chunk)
+{
+  assert (ap_chunk->avail);
+  if (ap_chunk->p_prev)
+    {
+      ap_chunk->p_prev->p_next = ap_chunk->p_next;
+    }
+  else
+    {
+      ap_cls->p_avail = ap_chunk->p_next;
+    }
+  if (ap_chunk->p_next)
+    {
+      ap_chunk->p_next->p_prev = ap_chunk->p_prev;
+    }
+  ap_chunk->p_prev = ap_chunk->p_next = NULL;
+  ap_chunk->avail = false;
+}
+
+/*@null@*/ static slab_chunk_t *
+alloc_chunk (slab_class_t * ap_cls)
+{
+  slab_chunk_t * p_chunk = NULL;
+
+  if ((p_chunk = tiz_mem_alloc (SLAB_CHUNK_SZ)))
+    {
+      p_chunk->p_prev = p_chunk->p_next = NULL;
+      p_chunk->avail = false;
+      p_chunk->p_free = NULL;
+      p_chunk->p_bump = (uint8_t *) p_chunk + SLAB_CHUNK_HDR_SZ;
+      p_chunk->p_end = (uint8_t *) p_chunk + SLAB_CHUNK_SZ;
+      p_chunk->n_out = 0;
+      avail_link (ap_cls, p_chunk);
+      ap_cls->n_chunks += 1;
+      ap_cls->n_empty += 1;
+    }
+
+  return p_chunk;
+}
+
+static void
+release_chunk (slab_class_t * ap_cls, slab_chunk_t * ap_chunk)
+{
+  assert (0 == ap_chunk->n_out);
+  avail_unlink (ap_cls, ap_chunk);
+  ap_cls->n_chunks -= 1;
+  ap_cls->n_empty -= 1;
+  ap_cls->chunks_released += 1;
+  tiz_mem_free (ap_chunk);
+}
+
+static inline bool
+chunk_is_full (const slab_chunk_t * ap_chunk, const size_t a_slot_sz)
+{
+  return !ap_chunk->p_free && ap_chunk->p_bump + a_slot_sz > ap_chunk->p_end;
+}
+
+/* Takes up to a_count objects out of the class's chunks */
+static int32_t
+depot_take (slab_class_t * ap_cls, const uint32_t a_class, void ** app_objs,
+            const int32_t a_count)
+{
+  int32_t n = 0;
+
+  while (n < a_count)
+    {
+      slab_chunk_t * p_chunk = ap_cls->p_avail;
+
+      if (!p_chunk && !(p_chunk = alloc_chunk (ap_cls)))
+        {
+          break;
+        }
+
+      if (0 == p_chunk->n_out)
+        {
+          ap_cls->n_empty -= 1;
+        }
+
+      while (n < a_count && !chunk_is_full (p_chunk, ap_cls->slot_sz))
+        {
+          void * p_usr = NULL;
+          if (p_chunk->p_free)
+            {
+              p_usr = p_chunk->p_free;
+              p_chunk->p_free = *(void **) p_usr;
+            }
+          else
+            {
+              slab_hdr_t * p_hdr = (slab_hdr_t *) p_chunk->p_bump;
+              p_chunk->p_bump += ap_cls->slot_sz;
+              p_hdr->p_chunk = p_chunk;
+              p_hdr->class = a_class;
+              p_hdr->magic = SLAB_MAGIC;
+              p_usr = get_usr (p_hdr);
+            }
+          p_chunk->n_out += 1;
+          app_objs[n++] = p_usr;
+        }
+
+      if (chunk_is_full (p_chunk, ap_cls->slot_sz))
+        {
+          avail_unlink (ap_cls, p_chunk);
+        }
+    }
+
+  ap_cls->n_out += n;
+  return n;
+}
+
+/* Gives objects back to their chunks */
+static void
+depot_give (slab_class_t * ap_cls, void ** app_objs, const int32_t a_count)
+{
+  int32_t i = 0;
+
+  for (i = 0; i < a_count; ++i)
+    {
+      void * p_usr = app_objs[i];
+      slab_chunk_t * p_chunk = get_hdr (p_usr)->p_chunk;
+
+      assert (p_chunk);
+      assert (p_chunk->n_out > 0);
+
+      *(void **) p_usr = p_chunk->p_free;
+      p_chunk->p_free = p_usr;
+      if (!p_chunk->avail)
+        {
+          avail_link (ap_cls, p_chunk);
+        }
+
+      if (0 == --p_chunk->n_out)
+        {
+          ap_cls->n_empty += 1;
+          if (ap_cls->n_empty > SLAB_MAX_EMPTY_CHUNKS)
+            {
+              release_chunk (ap_cls, p_chunk);
+            }
+        }
+    }
+
+  ap_cls->n_out -= a_count;
+}
+
+/*
+ * Thread caches
+ */
+
+static void
+flush_mag (slab_tcache_t * ap_tc, const uint32_t a_class, const int32_t a_count)
+{
+  slab_class_t * p_cls = &(g_slab.classes[a_class]);
+  slab_mag_t * p_mag = &(ap_tc->mags[a_class]);
+
+  assert (a_count <= p_mag->n);
+
+  /* The oldest objects go back; the most recently freed ones are likely to
+     still be in this CPU's cache */
+  (void) pthread_mutex_lock (&(p_cls->mutex));
+  depot_give (p_cls, p_mag->objs, a_count);
+  p_cls->allocs += ap_tc->allocs[a_class];
+  p_cls->frees += ap_tc->frees[a_class];
+  p_cls->flushes += 1;
+  (void) pthread_mutex_unlock (&(p_cls->mutex));
+
+  ap_tc->allocs[a_class] = 0;
+  ap_tc->frees[a_class] = 0;
+  p_mag->n -= a_count;
+  memmove (p_mag->objs, p_mag->objs + a_count, p_mag->n * sizeof (void *));
+}
+
+static void
+flush_tcache (slab_tcache_t * ap_tc)
+{
+  uint32_t i = 0;
+  for (i = 0; i < TIZ_SLAB_NUM_CLASSES; ++i)
+    {
+      if (ap_tc->mags[i].n > 0 || ap_tc->allocs[i] > 0 || ap_tc->frees[i] > 0)
+        {
+          flush_mag (ap_tc, i, ap_tc->mags[i].n);
+        }
+    }
+}
+
+static void
+tcache_destructor (void * ap_tc)
+{
+  if (ap_tc)
+    {
+      flush_tcache (ap_tc);
+      tiz_mem_free (ap_tc);
+    }
+}
+
+static void
+init_slab (void)
+{
+  uint32_t i = 0;
+  uint32_t class = 0;
+
+  for (i = 0; i < TIZ_SLAB_NUM_CLASSES; ++i)
+    {
+      (void) pthread_mutex_init (&(g_slab.classes[i].mutex), NULL);
+      g_slab.classes[i].slot_sz = class_sz_tbl[i] + SLAB_HDR_SZ;
+    }
+
+  for (i = 0; i <= TIZ_SLAB_MAX_SIZE / 16; ++i)
+    {
+      while (class_sz_tbl[class] < i * 16)
+        {
+          ++class;
+        }
+      g_slab.class_of[i] = (uint8_t) class;
+    }
+
+  g_slab.key_ok = (0 == pthread_key_create (&(g_slab.key), tcache_destructor));
+  if (!g_slab.key_ok)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "Could not create the thread cache key; "
+               "every operation will lock its size class.");
+    }
+}
+
+/*@null@*/ static inline slab_tcache_t *
+get_tcache (void)
+{
+  slab_tcache_t * p_tc = NULL;
+  if (g_slab.key_ok && !(p_tc = pthread_getspecific (g_slab.key)))
+    {
+      if ((p_tc = tiz_mem_calloc (1, sizeof (slab_tcache_t)))
+          && 0 != pthread_setspecific (g_slab.key, p_tc))
+        {
+          tiz_mem_free (p_tc);
+          p_tc = NULL;
+        }
+    }
+  return p_tc;
+}
+
+/*@null@*/ static void *
+large_calloc (size_t a_size)
+{
+  slab_hdr_t * p_hdr = tiz_mem_calloc (1, SLAB_HDR_SZ + a_size);
+  if (p_hdr)
+    {
+      p_hdr->p_chunk = NULL;
+      p_hdr->class = SLAB_LARGE_CLASS;
+      p_hdr->magic = SLAB_MAGIC;
+      (void) __atomic_add_fetch (&(g_slab.large_allocs), 1, __ATOMIC_RELAXED);
+      return get_usr (p_hdr);
+    }
+  return NULL;
+}
+
+/*@null@ */ void *
+tiz_slab_calloc (size_t a_size)
+{
+  void * p_usr = NULL;
+  uint32_t class = 0;
+  slab_tcache_t * p_tc = NULL;
+
+  (void) pthread_once (&g_slab_once, init_slab);
+
+  if (a_size > TIZ_SLAB_MAX_SIZE)
+    {
+      return large_calloc (a_size);
+    }
+
+  class = g_slab.class_of[(a_size + 15) >> 4];
+
+  if ((p_tc = get_tcache ()))
+    {
+      slab_mag_t * p_mag = &(p_tc->mags[class]);
+      if (0 == p_mag->n)
+        {
+          slab_class_t * p_cls = &(g_slab.classes[class]);
+          (void) pthread_mutex_lock (&(p_cls->mutex));
+          p_mag->n = depot_take (p_cls, class, p_mag->objs, SLAB_BATCH);
+          p_cls->allocs += p_tc->allocs[class];
+          p_cls->frees += p_tc->frees[class];
+          p_cls->refills += 1;
+          (void) pthread_mutex_unlock (&(p_cls->mutex));
+          p_tc->allocs[class] = 0;
+          p_tc->frees[class] = 0;
+        }
+      if (p_mag->n > 0)
+        {
+          p_usr = p_mag->objs[--p_mag->n];
+          p_tc->allocs[class] += 1;
+        }
+    }
+  else
+    {
+      /* No thread cache, go straight to the depot */
+      slab_class_t * p_cls = &(g_slab.classes[class]);
+      (void) pthread_mutex_lock (&(p_cls->mutex));
+      if (depot_take (p_cls, class, &p_usr, 1) > 0)
+        {
+          p_cls->allocs += 1;
+        }
+      (void) pthread_mutex_unlock (&(p_cls->mutex));
+    }
+
+  if (p_usr)
+    {
+      (void) tiz_mem_set (p_usr, 0, a_size);
+    }
+
+  return p_usr;
+}
+
+void
+tiz_slab_free (/*@null@ */ void * ap_addr)
+{
+  slab_hdr_t * p_hdr = NULL;
+  slab_tcache_t * p_tc = NULL;
+  uint32_t class = 0;
+
+  if (!ap_addr)
+    {
+      return;
+    }
+
+  p_hdr = get_hdr (ap_addr);
+  assert (SLAB_MAGIC == p_hdr->magic);
+  class = p_hdr->class;
+
+  if (SLAB_LARGE_CLASS == class)
+    {
+      (void) __atomic_add_fetch (&(g_slab.large_frees), 1, __ATOMIC_RELAXED);
+      tiz_mem_free (p_hdr);
+      return;
+    }
+
+  assert (class < TIZ_SLAB_NUM_CLASSES);
+
+  if ((p_tc = get_tcache ()))
+    {
+      slab_mag_t * p_mag = &(p_tc->mags[class]);
+      if (SLAB_MAG_SZ == p_mag->n)
+        {
+          flush_mag (p_tc, class, SLAB_BATCH);
+        }
+      p_mag->objs[p_mag->n++] = ap_addr;
+      p_tc->frees[class] += 1;
+    }
+  else
+    {
+      slab_class_t * p_cls = &(g_slab.classes[class]);
+      (void) pthread_mutex_lock (&(p_cls->mutex));
+      depot_give (p_cls, &ap_addr, 1);
+      p_cls->frees += 1;
+      (void) pthread_mutex_unlock (&(p_cls->mutex));
+    }
+}
+
+void
+tiz_slab_thread_flush (void)
+{
+  (void) pthread_once (&g_slab_once, init_slab);
+  if (g_slab.key_ok)
+    {
+      slab_tcache_t * p_tc = pthread_getspecific (g_slab.key);
+      if (p_tc)
+        {
+          flush_tcache (p_tc);
+        }
+    }
+}
+
+void
+tiz_slab_trim (void)
+{
+  uint32_t i = 0;
+
+  (void) pthread_once (&g_slab_once, init_slab);
+
+  for (i = 0; i < TIZ_SLAB_NUM_CLASSES; ++i)
+    {
+      slab_class_t * p_cls = &(g_slab.classes[i]);
+      slab_chunk_t * p_chunk = NULL;
+      slab_chunk_t * p_next = NULL;
+
+      (void) pthread_mutex_lock (&(p_cls->mutex));
+      for (p_chunk = p_cls->p_avail; p_chunk; p_chunk = p_next)
+        {
+          p_next = p_chunk->p_next;
+          if (0 == p_chunk->n_out)
+            {
+              release_chunk (p_cls, p_chunk);
+            }
+        }
+      (void) pthread_mutex_unlock (&(p_cls->mutex));
+    }
+}
+
+void
+tiz_slab_info (tiz_slab_info_t * p_info)
+{
+  uint32_t i = 0;
+
+  assert (p_info);
+
+  (void) pthread_once (&g_slab_once, init_slab);
+  (void) tiz_mem_set (p_info, 0, sizeof (tiz_slab_info_t));
+
+  for (i = 0; i < TIZ_SLAB_NUM_CLASSES; ++i)
+    {
+      slab_class_t * p_cls = &(g_slab.classes[i]);
+      tiz_slab_class_info_t * p_cinfo = &(p_info->classes[i]);
+
+      (void) pthread_mutex_lock (&(p_cls->mutex));
+      p_cinfo->size = class_sz_tbl[i];
+      p_cinfo->chunks = p_cls->n_chunks;
+      p_cinfo->objects = p_cls->n_out;
+      p_cinfo->allocs = p_cls->allocs;
+      p_cinfo->frees = p_cls->frees;
+      p_cinfo->refills = p_cls->refills;
+      p_cinfo->flushes = p_cls->flushes;
+      p_cinfo->chunks_released = p_cls->chunks_released;
+      (void) pthread_mutex_unlock (&(p_cls->mutex));
+
+      p_info->chunks += p_cinfo->chunks;
+      p_info->objects += p_cinfo->objects;
+    }
+
+  p_info->large_allocs
+    = __atomic_load_n (&(g_slab.large_allocs), __ATOMIC_RELAXED);
+  p_info->large_frees
+    = __atomic_load_n (&(g_slab.large_frees), __ATOMIC_RELAXED);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "objects [%d] chunks [%d]", p_info->objects,
+           p_info->chunks);
+}
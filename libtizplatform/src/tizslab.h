@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizslab.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Thread-safe slab allocator
+ *
+ * A process-wide allocator for the small, short-lived objects that travel
+ * between threads (scheduler and event loop messages, queue items). Objects
+ * may be freed from any thread. Each thread keeps a magazine of free objects
+ * per size class, so that most allocations and frees don't take a lock; the
+ * magazines are refilled from, and flushed to, per-class chunk depots in
+ * batches. Chunks that become empty are returned to the system.
+ *
+ * Requests larger than TIZ_SLAB_MAX_SIZE are served by tiz_mem_calloc, and
+ * must still be released with tiz_slab_free.
+ */
+
+#ifndef TIZSLAB_H
+#define TIZSLAB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <OMX_Types.h>
+#include <OMX_Core.h>
+
+#define TIZ_SLAB_NUM_CLASSES 24
+#define TIZ_SLAB_MAX_SIZE 2048
+
+/**
+ * Allocate a zero-initialised object. Can be called from any thread.
+ *
+ * @return The new object, or NULL if the system is out of memory.
+ */
+/*@null@ */ void *
+tiz_slab_calloc (size_t a_size);
+
+/**
+ * Release an object obtained from tiz_slab_calloc. The calling thread needs
+ * not be the one that allocated it.
+ */
+void
+tiz_slab_free (/*@null@ */ void * ap_addr);
+
+/**
+ * Return the objects cached in the calling thread's magazines to the depots.
+ * This happens automatically when a thread exits.
+ */
+void
+tiz_slab_thread_flush (void);
+
+/**
+ * Release every empty chunk to the system (normally one empty chunk per class
+ * is kept to absorb allocation bursts).
+ */
+void
+tiz_slab_trim (void);
+
+typedef struct tiz_slab_class_info tiz_slab_class_info_t;
+struct tiz_slab_class_info
+{
+  /* Largest object size served by the class */
+  size_t size;
+  /* Chunks currently allocated */
+  int32_t chunks;
+  /* Objects handed out of the chunks, i.e. in use or cached in magazines */
+  int32_t objects;
+  /* Allocations and frees, as reported by the threads' magazines when they
+     are refilled or flushed */
+  uint64_t allocs;
+  uint64_t frees;
+  /* Magazine refills and flushes (each one takes the class lock) */
+  uint64_t refills;
+  uint64_t flushes;
+  /* Chunks returned to the system so far */
+  uint64_t chunks_released;
+};
+
+typedef struct tiz_slab_info tiz_slab_info_t;
+struct tiz_slab_info
+{
+  tiz_slab_class_info_t classes[TIZ_SLAB_NUM_CLASSES];
+  /* Totals across all classes */
+  int32_t chunks;
+  int32_t objects;
+  /* Requests larger than TIZ_SLAB_MAX_SIZE */
+  uint64_t large_allocs;
+  uint64_t large_frees;
+};
+
+void
+tiz_slab_info (tiz_slab_info_t * p_info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSLAB_H */
@@ -35,10 +35,14 @@
 #include "tizplatform.h"
 
 #include <string.h>
+#include <strings.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include <assert.h>
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -191,6 +195,140 @@ tiz_thread_setname (tiz_thread_t * ap_thread, const OMX_STRING a_name)
   return rc;
 }
 
+static OMX_ERRORTYPE
+errno_to_omx (const int a_error)
+{
+  switch (a_error)
+    {
+      case 0:
+        return OMX_ErrorNone;
+      case EINVAL:
+        return OMX_ErrorBadParameter;
+      case EPERM:
+      case EACCES:
+        /* The process lacks CAP_SYS_NICE or RLIMIT_RTPRIO is too low */
+        return OMX_ErrorInsufficientResources;
+      default:
+        return OMX_ErrorUndefined;
+    }
+}
+
+OMX_ERRORTYPE
+tiz_thread_setschedparam (tiz_thread_t * ap_thread, const char * ap_policy,
+                          OMX_S32 a_priority)
+{
+  struct sched_param param;
+  int policy = SCHED_OTHER;
+  int error = 0;
+
+  assert (ap_thread);
+  assert (ap_policy);
+
+  if (0 == strcasecmp (ap_policy, "fifo"))
+    {
+      policy = SCHED_FIFO;
+    }
+  else if (0 == strcasecmp (ap_policy, "rr"))
+    {
+      policy = SCHED_RR;
+    }
+  else if (0 != strcasecmp (ap_policy, "other"))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unknown scheduling policy [%s].",
+               ap_policy);
+      return OMX_ErrorBadParameter;
+    }
+
+  if (a_priority < sched_get_priority_min (policy)
+      || a_priority > sched_get_priority_max (policy))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "Priority [%d] out of range for policy [%s] ([%d]-[%d]).",
+               (int) a_priority, ap_policy, sched_get_priority_min (policy),
+               sched_get_priority_max (policy));
+      return OMX_ErrorBadParameter;
+    }
+
+  param.sched_priority = (int) a_priority;
+  if (PTHREAD_SUCCESS
+      != (error = pthread_setschedparam (*ap_thread, policy, &param)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "Could not set the scheduling policy [%s] priority [%d] (%s).",
+               ap_policy, (int) a_priority, strerror (error));
+    }
+
+  return errno_to_omx (error);
+}
+
+OMX_ERRORTYPE
+tiz_thread_setaffinity (tiz_thread_t * ap_thread, const char * ap_cpu_list)
+{
+  cpu_set_t cpuset;
+  const char * p_next = NULL;
+  char * p_end = NULL;
+  int error = 0;
+
+  assert (ap_thread);
+  assert (ap_cpu_list);
+
+  CPU_ZERO (&cpuset);
+
+  /* Accept comma-separated cpu numbers and ranges, e.g. "0", "1,3" or "0-2" */
+  p_next = ap_cpu_list;
+  while (*p_next)
+    {
+      long first = strtol (p_next, &p_end, 10);
+      long last = first;
+      if (p_end == p_next || first < 0 || first >= CPU_SETSIZE)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Invalid cpu list [%s].", ap_cpu_list);
+          return OMX_ErrorBadParameter;
+        }
+      p_next = p_end;
+      if ('-' == *p_next)
+        {
+          ++p_next;
+          last = strtol (p_next, &p_end, 10);
+          if (p_end == p_next || last < first || last >= CPU_SETSIZE)
+            {
+              TIZ_LOG (TIZ_PRIORITY_ERROR, "Invalid cpu list [%s].",
+                       ap_cpu_list);
+              return OMX_ErrorBadParameter;
+            }
+          p_next = p_end;
+        }
+      for (; first <= last; ++first)
+        {
+          CPU_SET (first, &cpuset);
+        }
+      if (',' == *p_next)
+        {
+          ++p_next;
+        }
+      else if (*p_next)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Invalid cpu list [%s].", ap_cpu_list);
+          return OMX_ErrorBadParameter;
+        }
+    }
+
+  if (0 == CPU_COUNT (&cpuset))
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  if (PTHREAD_SUCCESS
+      != (error = pthread_setaffinity_np (*ap_thread, sizeof (cpu_set_t),
+                                          &cpuset)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Could not set the cpu affinity [%s] (%s).",
+               ap_cpu_list, strerror (error));
+    }
+
+  return errno_to_omx (error);
+}
+
 OMX_S32
 tiz_sleep (OMX_U32 usec)
 {
@@ -212,3 +350,11 @@ tiz_sleep (OMX_U32 usec)
 
   return rc;
 }
+
+OMX_U64
+tiz_monotonic_usec (void)
+{
+  struct timespec now;
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  return (OMX_U64) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
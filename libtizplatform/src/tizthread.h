@@ -86,6 +86,33 @@ tiz_thread_join (tiz_thread_t * ap_thread, void ** app_result);
 OMX_ERRORTYPE
 tiz_thread_setname (tiz_thread_t * ap_thread, const OMX_STRING a_name);
 
+/**
+ * Set the scheduling policy and priority of a thread. Valid policies are
+ * "other", "fifo" (SCHED_FIFO) and "rr" (SCHED_RR).
+ *
+ * @ingroup tizthread
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorBadParameter if the policy or
+ * the priority are not valid, OMX_ErrorInsufficientResources if the process
+ * lacks the privileges to use the policy, OMX_ErrorUndefined otherwise.
+ */
+OMX_ERRORTYPE
+tiz_thread_setschedparam (tiz_thread_t * ap_thread, const char * ap_policy,
+                          OMX_S32 a_priority);
+
+/**
+ * Restrict a thread to a set of CPUs. The list is made of comma-separated
+ * cpu numbers or ranges, e.g. "1", "0,2" or "0-3".
+ *
+ * @ingroup tizthread
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorBadParameter if the list is not
+ * valid, OMX_ErrorInsufficientResources if the process lacks the privileges
+ * to use those CPUs, OMX_ErrorUndefined otherwise.
+ */
+OMX_ERRORTYPE
+tiz_thread_setaffinity (tiz_thread_t * ap_thread, const char * ap_cpu_list);
+
 /**
  * Terminate the calling thread.
  *
@@ -114,6 +141,17 @@ tiz_thread_id (void);
 OMX_S32
 tiz_sleep (OMX_U32 a_usec);
 
+/**
+ * Read the system's monotonic clock.
+ *
+ * @ingroup tizthread
+ *
+ * @return The current time in micro seconds, from an unspecified starting
+ * point.
+ */
+OMX_U64
+tiz_monotonic_usec (void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,743 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlcache.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  On-disk cache of streamed resources
+ *
+ * Each entry is a pair of files named after the 64-bit FNV-1a hash of the
+ * key: '<hash>.data', a sparse file with the bytes of the resource at their
+ * own offsets, and '<hash>.idx', a text file with the key, the total size,
+ * the headers, and the ranges present in the data file. The access time of
+ * an entry is recorded in the data file's mtime, so that the LRU order
+ * survives across runs.
+ *
+ * An open entry holds a shared flock on its data file, and eviction only
+ * removes the entries on which it obtains an exclusive one, so that no entry
+ * is removed while a transfer, in this or another process, is using it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "tizurlcache.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.urlcache"
+#endif
+
+/* A resource rarely has more than a handful of holes; ranges that do not fit
+   are simply not recorded */
+#define URLCACHE_MAX_RANGES 64
+#define URLCACHE_MAX_HEADERS_LEN 1024
+#define URLCACHE_MAX_LINE_LEN 4096
+#define URLCACHE_NAME_LEN 16
+
+typedef struct urlcache_range urlcache_range_t;
+struct urlcache_range
+{
+  OMX_U64 start;
+  OMX_U64 end; /* exclusive */
+};
+
+struct tiz_urlcache
+{
+  char * p_dir_;
+  char * p_key_;
+  char name_[URLCACHE_NAME_LEN + 1];
+  OMX_U64 max_bytes_;
+  int fd_;
+  OMX_S64 total_;
+  char headers_[URLCACHE_MAX_HEADERS_LEN];
+  urlcache_range_t ranges_[URLCACHE_MAX_RANGES];
+  int nranges_;
+  bool dirty_;
+  bool failed_;
+  bool ok_response_; /* the last status line was a 2xx */
+};
+
+typedef struct urlcache_file urlcache_file_t;
+struct urlcache_file
+{
+  char name[URLCACHE_NAME_LEN + 1];
+  time_t mtime;
+  OMX_U64 size;
+};
+
+static char *
+dup_str (const char * ap_str)
+{
+  const size_t len = strlen (ap_str);
+  char * p_dup = tiz_mem_alloc (len + 1);
+  if (p_dup)
+    {
+      memcpy (p_dup, ap_str, len + 1);
+    }
+  return p_dup;
+}
+
+static char *
+default_cache_dir (void)
+{
+  char dir[PATH_MAX];
+  const char * p_xdg = getenv ("XDG_CACHE_HOME");
+  const char * p_home = getenv ("HOME");
+  if (p_xdg && *p_xdg)
+    {
+      snprintf (dir, sizeof (dir), "%s/tizonia/streams", p_xdg);
+    }
+  else if (p_home && *p_home)
+    {
+      snprintf (dir, sizeof (dir), "%s/.cache/tizonia/streams", p_home);
+    }
+  else
+    {
+      return NULL;
+    }
+  return dup_str (dir);
+}
+
+static int
+make_dirs (const char * ap_dir)
+{
+  char path[PATH_MAX];
+  char * p = NULL;
+  snprintf (path, sizeof (path), "%s", ap_dir);
+  for (p = path + 1; *p; ++p)
+    {
+      if ('/' == *p)
+        {
+          *p = '\0';
+          if (mkdir (path, 0700) < 0 && EEXIST != errno)
+            {
+              return -1;
+            }
+          *p = '/';
+        }
+    }
+  return (mkdir (path, 0700) < 0 && EEXIST != errno) ? -1 : 0;
+}
+
+static void
+entry_path (const tiz_urlcache_t * ap_cache, const char * ap_name,
+            const char * ap_ext, char * ap_path, const size_t a_len)
+{
+  assert (ap_cache);
+  snprintf (ap_path, a_len, "%s/%s.%s", ap_cache->p_dir_, ap_name, ap_ext);
+}
+
+static void
+hash_key (const char * ap_key, char * ap_name)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  const unsigned char * p = (const unsigned char *) ap_key;
+  for (; *p; ++p)
+    {
+      hash ^= *p;
+      hash *= 1099511628211ULL;
+    }
+  snprintf (ap_name, URLCACHE_NAME_LEN + 1, "%016llx",
+            (unsigned long long) hash);
+}
+
+static void
+add_range (tiz_urlcache_t * ap_cache, OMX_U64 a_start, OMX_U64 a_end)
+{
+  urlcache_range_t ranges[URLCACHE_MAX_RANGES + 1];
+  int count = 0;
+  int i = 0;
+  bool added = false;
+
+  assert (ap_cache);
+
+  /* Merge the new range with any range that it overlaps or touches */
+  for (i = 0; i < ap_cache->nranges_; ++i)
+    {
+      const urlcache_range_t * p_range = &(ap_cache->ranges_[i]);
+      if (p_range->end < a_start)
+        {
+          ranges[count++] = *p_range;
+        }
+      else if (p_range->start > a_end)
+        {
+          if (!added)
+            {
+              ranges[count].start = a_start;
+              ranges[count++].end = a_end;
+              added = true;
+            }
+          ranges[count++] = *p_range;
+        }
+      else
+        {
+          a_start = MIN (a_start, p_range->start);
+          a_end = MAX (a_end, p_range->end);
+        }
+      if (count > URLCACHE_MAX_RANGES)
+        {
+          return;
+        }
+    }
+
+  if (!added)
+    {
+      if (count >= URLCACHE_MAX_RANGES)
+        {
+          return;
+        }
+      ranges[count].start = a_start;
+      ranges[count++].end = a_end;
+    }
+
+  memcpy (ap_cache->ranges_, ranges, count * sizeof (urlcache_range_t));
+  ap_cache->nranges_ = count;
+  ap_cache->dirty_ = true;
+}
+
+static void
+reset_entry (tiz_urlcache_t * ap_cache)
+{
+  assert (ap_cache);
+  ap_cache->total_ = -1;
+  ap_cache->headers_[0] = '\0';
+  ap_cache->nranges_ = 0;
+  ap_cache->dirty_ = true;
+}
+
+static void
+append_header (tiz_urlcache_t * ap_cache, const char * ap_line,
+               const size_t a_len)
+{
+  size_t used = 0;
+  assert (ap_cache);
+  used = strlen (ap_cache->headers_);
+  if (used + a_len + 3 <= sizeof (ap_cache->headers_))
+    {
+      memcpy (ap_cache->headers_ + used, ap_line, a_len);
+      memcpy (ap_cache->headers_ + used + a_len, "\r\n", 3);
+    }
+}
+
+static void
+load_index (tiz_urlcache_t * ap_cache)
+{
+  char path[PATH_MAX];
+  char line[URLCACHE_MAX_LINE_LEN];
+  FILE * p_file = NULL;
+  bool key_found = false;
+
+  assert (ap_cache);
+
+  entry_path (ap_cache, ap_cache->name_, "idx", path, sizeof (path));
+  if (!(p_file = fopen (path, "r")))
+    {
+      return;
+    }
+
+  while (fgets (line, sizeof (line), p_file))
+    {
+      size_t len = strcspn (line, "\r\n");
+      unsigned long long start = 0;
+      unsigned long long end = 0;
+      long long total = 0;
+      line[len] = '\0';
+      if (0 == strncmp (line, "key ", 4))
+        {
+          key_found = (0 == strcmp (line + 4, ap_cache->p_key_));
+          if (!key_found)
+            {
+              break;
+            }
+        }
+      else if (1 == sscanf (line, "total %lld", &total))
+        {
+          ap_cache->total_ = total;
+        }
+      else if (0 == strncmp (line, "header ", 7))
+        {
+          append_header (ap_cache, line + 7, len - 7);
+        }
+      else if (2 == sscanf (line, "range %llu %llu", &start, &end)
+               && start < end)
+        {
+          add_range (ap_cache, start, end);
+        }
+    }
+  fclose (p_file);
+
+  if (!key_found)
+    {
+      /* A different resource with the same hash, or a damaged index */
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "discarding entry [%s]", ap_cache->name_);
+      reset_entry (ap_cache);
+    }
+  ap_cache->dirty_ = false;
+}
+
+static void
+save_index (tiz_urlcache_t * ap_cache)
+{
+  char path[PATH_MAX];
+  char tmp_path[PATH_MAX];
+  FILE * p_file = NULL;
+  const char * p_line = NULL;
+  int i = 0;
+
+  assert (ap_cache);
+
+  entry_path (ap_cache, ap_cache->name_, "idx", path, sizeof (path));
+  entry_path (ap_cache, ap_cache->name_, "idx.tmp", tmp_path,
+              sizeof (tmp_path));
+  if (!(p_file = fopen (tmp_path, "w")))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "unable to write [%s] (%s)", tmp_path,
+               strerror (errno));
+      return;
+    }
+
+  fprintf (p_file, "key %s\n", ap_cache->p_key_);
+  fprintf (p_file, "total %lld\n", (long long) ap_cache->total_);
+  for (p_line = ap_cache->headers_; *p_line;)
+    {
+      const size_t len = strcspn (p_line, "\r\n");
+      if (len > 0)
+        {
+          fprintf (p_file, "header %.*s\n", (int) len, p_line);
+        }
+      p_line += len;
+      p_line += strspn (p_line, "\r\n");
+    }
+  for (i = 0; i < ap_cache->nranges_; ++i)
+    {
+      fprintf (p_file, "range %llu %llu\n",
+               (unsigned long long) ap_cache->ranges_[i].start,
+               (unsigned long long) ap_cache->ranges_[i].end);
+    }
+
+  if (0 != fclose (p_file) || rename (tmp_path, path) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "unable to write [%s] (%s)", path,
+               strerror (errno));
+      (void) unlink (tmp_path);
+      return;
+    }
+  ap_cache->dirty_ = false;
+}
+
+static int
+cmp_files (const void * ap_left, const void * ap_right)
+{
+  const urlcache_file_t * p_left = ap_left;
+  const urlcache_file_t * p_right = ap_right;
+  return (p_left->mtime > p_right->mtime) - (p_left->mtime < p_right->mtime);
+}
+
+/* Opens the data file of an entry and marks it as in use. If the entry is
+   evicted between the open and the lock, the file that is locked is no longer
+   the entry's, so it is opened again. */
+static int
+open_data_file (const char * ap_path)
+{
+  int attempts = 0;
+  for (attempts = 0; attempts < 3; ++attempts)
+    {
+      struct stat st_fd;
+      struct stat st_path;
+      const int fd = open (ap_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+      if (fd < 0)
+        {
+          return -1;
+        }
+      if (flock (fd, LOCK_SH) < 0)
+        {
+          close (fd);
+          return -1;
+        }
+      if (0 == fstat (fd, &st_fd) && 0 == stat (ap_path, &st_path)
+          && st_fd.st_dev == st_path.st_dev && st_fd.st_ino == st_path.st_ino)
+        {
+          return fd;
+        }
+      close (fd);
+    }
+  errno = EBUSY;
+  return -1;
+}
+
+/* Removes an entry, unless it is in use. Returns true if the entry is
+   gone. */
+static bool
+remove_entry (const tiz_urlcache_t * ap_cache, const char * ap_name)
+{
+  char path[PATH_MAX];
+  int fd = -1;
+
+  assert (ap_cache);
+
+  entry_path (ap_cache, ap_name, "data", path, sizeof (path));
+  if ((fd = open (path, O_RDONLY | O_CLOEXEC)) < 0)
+    {
+      return (ENOENT == errno);
+    }
+  if (flock (fd, LOCK_EX | LOCK_NB) < 0)
+    {
+      close (fd);
+      return false;
+    }
+  (void) unlink (path);
+  entry_path (ap_cache, ap_name, "idx", path, sizeof (path));
+  (void) unlink (path);
+  close (fd);
+  return true;
+}
+
+/* Removes the least recently used entries until the directory fits in the
+   budget. Sizes are taken from the blocks actually allocated, as the data
+   files may have holes. */
+static void
+evict (tiz_urlcache_t * ap_cache)
+{
+  urlcache_file_t * p_files = NULL;
+  size_t nfiles = 0;
+  size_t capacity = 0;
+  OMX_U64 used = 0;
+  struct dirent * p_entry = NULL;
+  DIR * p_dir = NULL;
+  size_t i = 0;
+
+  assert (ap_cache);
+
+  if (!(p_dir = opendir (ap_cache->p_dir_)))
+    {
+      return;
+    }
+
+  while ((p_entry = readdir (p_dir)))
+    {
+      char path[PATH_MAX];
+      struct stat st;
+      const size_t len = strlen (p_entry->d_name);
+      if (URLCACHE_NAME_LEN + 5 != len
+          || 0 != strcmp (p_entry->d_name + URLCACHE_NAME_LEN, ".data"))
+        {
+          continue;
+        }
+      snprintf (path, sizeof (path), "%s/%s", ap_cache->p_dir_,
+                p_entry->d_name);
+      if (stat (path, &st) < 0)
+        {
+          continue;
+        }
+      if (nfiles == capacity)
+        {
+          urlcache_file_t * p_new = NULL;
+          capacity = capacity ? capacity * 2 : 64;
+          if (!(p_new = tiz_mem_realloc (p_files,
+                                         capacity * sizeof (urlcache_file_t))))
+            {
+              break;
+            }
+          p_files = p_new;
+        }
+      memcpy (p_files[nfiles].name, p_entry->d_name, URLCACHE_NAME_LEN);
+      p_files[nfiles].name[URLCACHE_NAME_LEN] = '\0';
+      p_files[nfiles].mtime = st.st_mtime;
+      p_files[nfiles].size = (OMX_U64) st.st_blocks * 512;
+      used += p_files[nfiles].size;
+      ++nfiles;
+    }
+  closedir (p_dir);
+
+  if (used > ap_cache->max_bytes_)
+    {
+      qsort (p_files, nfiles, sizeof (urlcache_file_t), cmp_files);
+      for (i = 0; i < nfiles && used > ap_cache->max_bytes_; ++i)
+        {
+          if (!remove_entry (ap_cache, p_files[i].name))
+            {
+              TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] is in use", p_files[i].name);
+              continue;
+            }
+          used -= p_files[i].size;
+          TIZ_LOG (TIZ_PRIORITY_TRACE, "evicted [%s] - [%llu] bytes in use",
+                   p_files[i].name, (unsigned long long) used);
+        }
+    }
+
+  tiz_mem_free (p_files);
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_open (tiz_urlcache_ptr_t * app_cache, const char * ap_dir,
+                   const char * ap_key, const OMX_U64 a_max_bytes)
+{
+  tiz_urlcache_t * p_cache = NULL;
+  char path[PATH_MAX];
+  struct stat st;
+  int i = 0;
+
+  assert (app_cache);
+  assert (ap_key);
+
+  tiz_check_null_ret_oom (
+    (p_cache = tiz_mem_calloc (1, sizeof (tiz_urlcache_t))));
+  p_cache->fd_ = -1;
+  p_cache->max_bytes_ = a_max_bytes;
+  p_cache->total_ = -1;
+  p_cache->p_dir_ = (ap_dir && *ap_dir) ? dup_str (ap_dir)
+                                        : default_cache_dir ();
+  p_cache->p_key_ = dup_str (ap_key);
+
+  if (!p_cache->p_dir_ || !p_cache->p_key_ || make_dirs (p_cache->p_dir_) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "unable to use the cache directory [%s]",
+               p_cache->p_dir_ ? p_cache->p_dir_ : "");
+      goto fail;
+    }
+
+  hash_key (ap_key, p_cache->name_);
+  entry_path (p_cache, p_cache->name_, "data", path, sizeof (path));
+  if ((p_cache->fd_ = open_data_file (path)) < 0
+      || fstat (p_cache->fd_, &st) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "unable to open [%s] (%s)", path,
+               strerror (errno));
+      goto fail;
+    }
+
+  load_index (p_cache);
+
+  /* Do not trust ranges that go past the end of the data file (e.g. if the
+     disk filled up after the index was saved) */
+  for (i = 0; i < p_cache->nranges_; ++i)
+    {
+      if (p_cache->ranges_[i].end > (OMX_U64) st.st_size)
+        {
+          p_cache->nranges_ = i;
+          p_cache->dirty_ = true;
+          break;
+        }
+    }
+
+  if (0 == p_cache->nranges_ && st.st_size > 0)
+    {
+      /* Leftovers of an entry whose index was lost */
+      (void) ftruncate (p_cache->fd_, 0);
+    }
+
+  /* Record the access, for the LRU order */
+  (void) futimens (p_cache->fd_, NULL);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] -> [%s] total [%lld] cached [%llu]",
+           ap_key, p_cache->name_, (long long) p_cache->total_,
+           (unsigned long long) tiz_urlcache_available (p_cache, 0));
+
+  *app_cache = p_cache;
+  return OMX_ErrorNone;
+
+fail:
+  if (p_cache->fd_ >= 0)
+    {
+      close (p_cache->fd_);
+    }
+  tiz_mem_free (p_cache->p_dir_);
+  tiz_mem_free (p_cache->p_key_);
+  tiz_mem_free (p_cache);
+  return OMX_ErrorInsufficientResources;
+}
+
+void
+tiz_urlcache_close (tiz_urlcache_t * ap_cache)
+{
+  if (ap_cache)
+    {
+      if (ap_cache->dirty_)
+        {
+          save_index (ap_cache);
+        }
+      close (ap_cache->fd_);
+      evict (ap_cache);
+      tiz_mem_free (ap_cache->p_dir_);
+      tiz_mem_free (ap_cache->p_key_);
+      tiz_mem_free (ap_cache);
+    }
+}
+
+OMX_S64
+tiz_urlcache_total (const tiz_urlcache_t * ap_cache)
+{
+  assert (ap_cache);
+  return ap_cache->total_;
+}
+
+const char *
+tiz_urlcache_headers (const tiz_urlcache_t * ap_cache)
+{
+  assert (ap_cache);
+  return ap_cache->headers_;
+}
+
+void
+tiz_urlcache_store_header (tiz_urlcache_t * ap_cache, const char * ap_header,
+                           const size_t a_nbytes)
+{
+  const size_t len = MIN (a_nbytes, URLCACHE_MAX_LINE_LEN - 1);
+  char line[URLCACHE_MAX_LINE_LEN];
+  long long total = 0;
+
+  assert (ap_cache);
+  assert (ap_header);
+
+  memcpy (line, ap_header, len);
+  line[len] = '\0';
+  line[strcspn (line, "\r\n")] = '\0';
+
+  if (0 == strncasecmp (line, "HTTP/", 5))
+    {
+      const char * p_code = strchr (line, ' ');
+      ap_cache->ok_response_ = (p_code && '2' == p_code[1]);
+      if (ap_cache->ok_response_)
+        {
+          ap_cache->headers_[0] = '\0';
+          ap_cache->dirty_ = true;
+        }
+    }
+  else if (!ap_cache->ok_response_)
+    {
+      /* e.g. a redirection */
+      return;
+    }
+  else if (0 == strncasecmp (line, "Content-Type:", 13))
+    {
+      ap_cache->headers_[0] = '\0';
+      append_header (ap_cache, line, strlen (line));
+      ap_cache->dirty_ = true;
+    }
+  else if (0 == strncasecmp (line, "Content-Length:", 15)
+           && 1 == sscanf (line + 15, " %lld", &total) && total >= 0
+           && total != ap_cache->total_)
+    {
+      if (ap_cache->total_ >= 0)
+        {
+          /* The resource has changed; what is cached is of no use */
+          ap_cache->nranges_ = 0;
+        }
+      ap_cache->total_ = total;
+      ap_cache->dirty_ = true;
+    }
+}
+
+OMX_U64
+tiz_urlcache_available (const tiz_urlcache_t * ap_cache,
+                        const OMX_U64 a_offset)
+{
+  int i = 0;
+  assert (ap_cache);
+  for (i = 0; i < ap_cache->nranges_; ++i)
+    {
+      if (ap_cache->ranges_[i].start <= a_offset
+          && a_offset < ap_cache->ranges_[i].end)
+        {
+          return ap_cache->ranges_[i].end - a_offset;
+        }
+    }
+  return 0;
+}
+
+bool
+tiz_urlcache_is_complete (const tiz_urlcache_t * ap_cache)
+{
+  assert (ap_cache);
+  return (ap_cache->total_ > 0
+          && tiz_urlcache_available (ap_cache, 0)
+               >= (OMX_U64) ap_cache->total_);
+}
+
+int
+tiz_urlcache_read (tiz_urlcache_t * ap_cache, const OMX_U64 a_offset,
+                   void * ap_buf, const size_t a_nbytes)
+{
+  ssize_t nread = 0;
+  assert (ap_cache);
+  assert (ap_buf);
+  do
+    {
+      nread = pread (ap_cache->fd_, ap_buf, a_nbytes, (off_t) a_offset);
+    }
+  while (nread < 0 && EINTR == errno);
+  return (int) nread;
+}
+
+void
+tiz_urlcache_write (tiz_urlcache_t * ap_cache, const OMX_U64 a_offset,
+                    const void * ap_data, const size_t a_nbytes)
+{
+  size_t written = 0;
+  assert (ap_cache);
+  assert (ap_data);
+
+  if (ap_cache->failed_ || 0 == a_nbytes)
+    {
+      return;
+    }
+
+  while (written < a_nbytes)
+    {
+      const ssize_t n
+        = pwrite (ap_cache->fd_, (const char *) ap_data + written,
+                  a_nbytes - written, (off_t) (a_offset + written));
+      if (n < 0 && EINTR == errno)
+        {
+          continue;
+        }
+      if (n <= 0)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : write error (%s)",
+                   ap_cache->name_, strerror (errno));
+          ap_cache->failed_ = true;
+          break;
+        }
+      written += n;
+    }
+
+  if (written > 0)
+    {
+      add_range (ap_cache, a_offset, a_offset + written);
+    }
+}
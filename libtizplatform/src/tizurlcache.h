@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlcache.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  On-disk cache of streamed resources (internal to tizurltransfer)
+ *
+ *
+ */
+
+#ifndef TIZURLCACHE_H
+#define TIZURLCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <OMX_Types.h>
+
+typedef struct tiz_urlcache tiz_urlcache_t;
+typedef /*@null@ */ tiz_urlcache_t * tiz_urlcache_ptr_t;
+
+/**
+ * Open (or create) the cache entry of a resource. Entries are named after the
+ * hash of ap_key, and hold the bytes of the resource that have been seen so
+ * far (as a sparse file), along with the list of ranges that are present,
+ * the total size of the resource, and the headers that describe it.
+ *
+ * @param app_cache The entry handle (output).
+ * @param ap_dir The cache directory. It is created if needed. If NULL or
+ * empty, $XDG_CACHE_HOME/tizonia/streams (or ~/.cache/tizonia/streams) is
+ * used.
+ * @param ap_key The key of the resource (e.g. its url or its id in the
+ * service).
+ * @param a_max_bytes The size budget of the whole cache directory.
+ * @return OMX_ErrorNone on success.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_open (tiz_urlcache_ptr_t * app_cache, const char * ap_dir,
+                   const char * ap_key, const OMX_U64 a_max_bytes);
+
+/**
+ * Save the entry's index, and remove the least recently used entries until
+ * the cache directory fits in its size budget. Entries that are open, in
+ * this or another process, are not removed.
+ */
+void
+tiz_urlcache_close (tiz_urlcache_t * ap_cache);
+
+/**
+ * The total size of the resource, or -1 if it is unknown.
+ */
+OMX_S64
+tiz_urlcache_total (const tiz_urlcache_t * ap_cache);
+
+/**
+ * The header lines (CRLF-terminated) that were recorded with
+ * tiz_urlcache_store_header, or an empty string.
+ */
+const char *
+tiz_urlcache_headers (const tiz_urlcache_t * ap_cache);
+
+/**
+ * Record a header line of the response. A status line discards the headers
+ * of any previous response (e.g. a redirection). Only Content-Type is kept;
+ * Content-Length gives the total size of the resource.
+ */
+void
+tiz_urlcache_store_header (tiz_urlcache_t * ap_cache, const char * ap_header,
+                           const size_t a_nbytes);
+
+/**
+ * The number of consecutive bytes present in the cache from a_offset.
+ */
+OMX_U64
+tiz_urlcache_available (const tiz_urlcache_t * ap_cache,
+                        const OMX_U64 a_offset);
+
+/**
+ * Whether the whole resource is present in the cache.
+ */
+bool
+tiz_urlcache_is_complete (const tiz_urlcache_t * ap_cache);
+
+/**
+ * Read up to a_nbytes from a_offset. Returns the number of bytes read, or -1
+ * on error.
+ */
+int
+tiz_urlcache_read (tiz_urlcache_t * ap_cache, const OMX_U64 a_offset,
+                   void * ap_buf, const size_t a_nbytes);
+
+/**
+ * Store a_nbytes at a_offset. After a write error, the entry stops accepting
+ * data.
+ */
+void
+tiz_urlcache_write (tiz_urlcache_t * ap_cache, const OMX_U64 a_offset,
+                    const void * ap_data, const size_t a_nbytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZURLCACHE_H */
@@ -32,6 +32,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -40,6 +41,8 @@
 #include <tizplatform.h>
 
 #include "tizurltransfer.h"
+#include "tizurlcache.h"
+#include "tizplatform_internal.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -65,6 +68,14 @@ static inline OMX_ERRORTYPE
 stop_io_watcher (tiz_urltrans_t * ap_trans);
 static void
 report_connection_lost_event (tiz_urltrans_t * ap_trans);
+static void
+reset_segments (tiz_urltrans_t * ap_trans);
+static OMX_ERRORTYPE
+service_segments (tiz_urltrans_t * ap_trans, int * ap_running_handles);
+static void
+close_cache (tiz_urltrans_t * ap_trans);
+static OMX_ERRORTYPE
+replay_from_cache (tiz_urltrans_t * ap_trans);
 
 /* These macros assume the existence of an "ap_trans" local variable */
 #define bail_on_curl_error(expr)                                           \
@@ -174,6 +185,40 @@ static const httpsrc_curl_state_id_str_t httpsrc_curl_state_id_str_tbl[]
      {ECurlStatePaused, (const OMX_STRING) "ECurlStatePaused"},
      {ECurlStateMax, (const OMX_STRING) "ECurlStateMax"}};
 
+/* Maximum number of parallel range requests in segmented downloads */
+#define URLTRANS_MAX_SEGMENTS 8
+
+/* A range request of a segmented download. The range is buffered in full
+   (segments are never paused) and moved to the transfer's store when all the
+   bytes before it have been delivered. */
+typedef struct urltrans_segment urltrans_segment_t;
+struct urltrans_segment
+{
+  tiz_urltrans_t * p_trans;
+  CURL * p_curl;
+  tiz_buffer_t * p_data;
+  curl_off_t offset;    /* first byte of the range */
+  curl_off_t end;       /* last byte of the range */
+  curl_off_t received;  /* bytes received so far */
+  curl_off_t delivered; /* bytes moved to the store so far */
+  OMX_U64 start_us;
+  int retries;
+  bool active;
+  bool done;
+};
+
+/* Size of the reads from the on-disk cache */
+#define URLTRANS_CACHE_CHUNK_BYTES (32 * 1024)
+
+/* I/O watcher of a socket that is used by a segment's easy handle */
+typedef struct urltrans_socket urltrans_socket_t;
+struct urltrans_socket
+{
+  int fd;
+  tiz_event_io_t * p_ev_io;
+  tiz_event_io_event_t io_type;
+};
+
 struct tiz_urltrans
 {
   void * p_parent_;                        /* not owned */
@@ -206,6 +251,30 @@ struct tiz_urltrans
   unsigned int curl_version_;
   char curl_err[CURL_ERROR_SIZE];
   bool handshake_error_found;
+  /* Segmented downloads */
+  int max_segments_;
+  int segment_bytes_;
+  int segment_limit_;         /* adaptive limit of parallel range requests */
+  double segment_rate_;       /* recent best bytes/s of a single range */
+  curl_off_t total_bytes_;    /* from Content-Range, or -1 if unknown */
+  curl_off_t next_offset_;    /* first byte of the next range to request */
+  curl_off_t ordered_offset_; /* bytes delivered in order so far */
+  bool range_response_;       /* the current response is a 206 */
+  bool main_done_;            /* the easy handle's request has completed */
+  bool segments_failed_;
+  urltrans_segment_t segments_[URLTRANS_MAX_SEGMENTS];
+  urltrans_socket_t sockets_[URLTRANS_MAX_SEGMENTS * 2];
+  /* On-disk cache */
+  char * p_cache_dir_;
+  char * p_cache_key_;
+  OMX_U64 cache_max_bytes_; /* 0 if the cache is disabled */
+  tiz_urlcache_t * p_cache_;
+  char * p_cache_chunk_;
+  bool cache_replay_;         /* the data comes from the cache */
+  bool cache_headers_sent_;   /* the cached headers have been delivered */
+  curl_off_t resume_offset_;  /* first byte requested from the server */
+  curl_off_t skip_bytes_;     /* bytes to drop from a response that ignored
+                                 the range */
 };
 
 /*@observer@*/ const char *
@@ -265,7 +334,8 @@ httpsrc_curl_state_to_str (const httpsrc_curl_state_id_t a_state)
 #define ASSERT_ASYNC_EVENTS(ap_trans)                       \
   do                                                        \
     {                                                       \
-      if (is_transfer_running (ap_trans))                   \
+      if (is_transfer_running (ap_trans)                    \
+          && !is_segmented (ap_trans))                      \
         {                                                   \
           assert (ap_trans->awaiting_curl_timer_ev_         \
                   || ap_trans->awaiting_reconnect_timer_ev_ \
@@ -304,6 +374,28 @@ is_transfer_running (tiz_urltrans_t * ap_trans)
   return (ECurlStateTransfering == ap_trans->curl_state_);
 }
 
+static inline bool
+is_segmented (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  return (ap_trans->max_segments_ > 0);
+}
+
+static inline bool
+is_transfer_finished (tiz_urltrans_t * ap_trans, const int a_running_handles)
+{
+  assert (ap_trans);
+  if (a_running_handles > 0)
+    {
+      return false;
+    }
+  /* In segmented downloads, the last ranges may still be waiting for room in
+     the store */
+  return (!is_segmented (ap_trans) || ap_trans->segments_failed_
+          || ap_trans->total_bytes_ < 0
+          || ap_trans->ordered_offset_ >= ap_trans->total_bytes_);
+}
+
 static inline bool
 is_passed_buffer_high_watermark (tiz_urltrans_t * ap_trans)
 {
@@ -322,7 +414,8 @@ start_curl (tiz_urltrans_t * ap_trans)
 
   assert (ap_trans->p_curl_);
   assert (ap_trans->p_curl_multi_);
-  assert (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans));
+  assert (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans)
+          || ap_trans->resume_offset_ > 0);
 
   set_curl_state (ap_trans, ECurlStateTransfering);
 
@@ -367,6 +460,34 @@ start_curl (tiz_urltrans_t * ap_trans)
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_HTTPHEADER,
                                         ap_trans->p_http_headers_));
 
+  /* In segmented downloads, only the first range is requested here. The
+     others are requested once the server has confirmed that it supports range
+     requests. When the beginning of the resource has come from the cache,
+     the rest is requested. */
+  if (is_segmented (ap_trans))
+    {
+      char range[64];
+      snprintf (range, sizeof (range),
+                "%" CURL_FORMAT_CURL_OFF_T "-%" CURL_FORMAT_CURL_OFF_T,
+                ap_trans->resume_offset_,
+                ap_trans->resume_offset_ + ap_trans->segment_bytes_ - 1);
+      bail_on_curl_error (
+        curl_easy_setopt (ap_trans->p_curl_, CURLOPT_RANGE, range));
+    }
+  else if (ap_trans->resume_offset_ > 0)
+    {
+      char range[64];
+      snprintf (range, sizeof (range), "%" CURL_FORMAT_CURL_OFF_T "-",
+                ap_trans->resume_offset_);
+      bail_on_curl_error (
+        curl_easy_setopt (ap_trans->p_curl_, CURLOPT_RANGE, range));
+    }
+  else
+    {
+      bail_on_curl_error (
+        curl_easy_setopt (ap_trans->p_curl_, CURLOPT_RANGE, NULL));
+    }
+
   /* #ifdef _DEBUG */
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_VERBOSE, 1));
   bail_on_curl_error (
@@ -465,6 +586,17 @@ stop_io_watcher (tiz_urltrans_t * ap_trans)
   return rc;
 }
 
+static inline void
+release_io_watcher (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  assert (ap_trans->io_cbacks_.pf_io_destroy);
+  (void) stop_io_watcher (ap_trans);
+  ap_trans->io_cbacks_.pf_io_destroy (ap_trans->p_parent_, ap_trans->p_ev_io_);
+  ap_trans->p_ev_io_ = NULL;
+  ap_trans->sockfd_ = -1;
+}
+
 static inline OMX_ERRORTYPE
 start_curl_timer_watcher (tiz_urltrans_t * ap_trans)
 {
@@ -572,7 +704,12 @@ resume_curl (tiz_urltrans_t * ap_trans)
 {
   assert (ap_trans);
 
-  if (is_transfer_paused (ap_trans))
+  if (is_transfer_paused (ap_trans) && ap_trans->cache_replay_)
+    {
+      set_curl_state (ap_trans, ECurlStateTransfering);
+      return replay_from_cache (ap_trans);
+    }
+  else if (is_transfer_paused (ap_trans))
     {
       int running_handles = 0;
 
@@ -598,7 +735,8 @@ resume_curl (tiz_urltrans_t * ap_trans)
             curl_multi_socket_all (ap_trans->p_curl_multi_, &running_handles));
         }
       tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
-      if (!running_handles)
+      tiz_check_omx (service_segments (ap_trans, &running_handles));
+      if (is_transfer_finished (ap_trans, running_handles))
         {
           report_connection_lost_event (ap_trans);
         }
@@ -643,28 +781,701 @@ send_from_internal_buffer (tiz_urltrans_t * p_trans)
 }
 
 static void
-reset_initial_buffer_size (tiz_urltrans_t * ap_trans)
+reset_initial_buffer_size (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  ap_trans->internal_buffer_size_initial_ = ap_trans->internal_buffer_size_;
+}
+
+static void
+report_connection_lost_event (tiz_urltrans_t * ap_trans)
+{
+  bool auto_reconnect = false;
+  assert (ap_trans);
+  stop_curl_timer_watcher (ap_trans);
+  assert (ap_trans->info_cbacks_.pf_connection_lost);
+  set_curl_state (ap_trans, ECurlStateStopped);
+  close_cache (ap_trans);
+  send_from_internal_buffer (ap_trans);
+  auto_reconnect
+    = ap_trans->info_cbacks_.pf_connection_lost (ap_trans->p_parent_);
+  reset_initial_buffer_size (ap_trans);
+  if (auto_reconnect)
+    {
+      (void) start_reconnect_timer_watcher (ap_trans);
+    }
+}
+
+/*
+ * Segmented downloads
+ */
+
+static urltrans_segment_t *
+find_segment (tiz_urltrans_t * ap_trans, CURL * ap_curl)
+{
+  int i = 0;
+  assert (ap_trans);
+  for (i = 0; i < URLTRANS_MAX_SEGMENTS; ++i)
+    {
+      if (ap_trans->segments_[i].p_curl == ap_curl)
+        {
+          return &(ap_trans->segments_[i]);
+        }
+    }
+  return NULL;
+}
+
+/* Returns the segment whose data follows what has already been delivered to
+   the store */
+static urltrans_segment_t *
+find_next_segment (tiz_urltrans_t * ap_trans)
+{
+  int i = 0;
+  assert (ap_trans);
+  for (i = 0; i < URLTRANS_MAX_SEGMENTS; ++i)
+    {
+      urltrans_segment_t * p_seg = &(ap_trans->segments_[i]);
+      if (p_seg->active
+          && p_seg->offset + p_seg->delivered == ap_trans->ordered_offset_)
+        {
+          return p_seg;
+        }
+    }
+  return NULL;
+}
+
+static int
+count_active_segments (tiz_urltrans_t * ap_trans)
+{
+  int i = 0;
+  int count = 0;
+  assert (ap_trans);
+  for (i = 0; i < URLTRANS_MAX_SEGMENTS; ++i)
+    {
+      if (ap_trans->segments_[i].active)
+        {
+          ++count;
+        }
+    }
+  return count;
+}
+
+static urltrans_socket_t *
+find_segment_socket (tiz_urltrans_t * ap_trans, const int a_fd)
+{
+  size_t i = 0;
+  assert (ap_trans);
+  for (i = 0; i < sizeof (ap_trans->sockets_) / sizeof (urltrans_socket_t);
+       ++i)
+    {
+      if (ap_trans->sockets_[i].fd == a_fd)
+        {
+          return &(ap_trans->sockets_[i]);
+        }
+    }
+  return NULL;
+}
+
+static void
+remove_segment_socket (tiz_urltrans_t * ap_trans, urltrans_socket_t * ap_sock)
+{
+  assert (ap_trans);
+  assert (ap_sock);
+  if (ap_sock->p_ev_io)
+    {
+      (void) ap_trans->io_cbacks_.pf_io_stop (ap_trans->p_parent_,
+                                              ap_sock->p_ev_io);
+      ap_trans->io_cbacks_.pf_io_destroy (ap_trans->p_parent_,
+                                          ap_sock->p_ev_io);
+      ap_sock->p_ev_io = NULL;
+    }
+  ap_sock->fd = -1;
+}
+
+static OMX_ERRORTYPE
+watch_segment_socket (tiz_urltrans_t * ap_trans, const int a_fd,
+                      const tiz_event_io_event_t a_io_type)
+{
+  urltrans_socket_t * p_sock = find_segment_socket (ap_trans, a_fd);
+  assert (ap_trans);
+
+  if (p_sock && p_sock->io_type != a_io_type)
+    {
+      /* We need to create a new watcher */
+      remove_segment_socket (ap_trans, p_sock);
+      p_sock = NULL;
+    }
+
+  if (!p_sock)
+    {
+      if (!(p_sock = find_segment_socket (ap_trans, -1)))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "No room to watch socket [%d]", a_fd);
+          return OMX_ErrorInsufficientResources;
+        }
+      tiz_check_omx (ap_trans->io_cbacks_.pf_io_init (
+        ap_trans->p_parent_, &(p_sock->p_ev_io), a_fd, a_io_type, true));
+      p_sock->fd = a_fd;
+      p_sock->io_type = a_io_type;
+    }
+
+  return ap_trans->io_cbacks_.pf_io_start (ap_trans->p_parent_,
+                                           p_sock->p_ev_io);
+}
+
+static void
+stop_segment_sockets (tiz_urltrans_t * ap_trans)
+{
+  size_t i = 0;
+  assert (ap_trans);
+  for (i = 0; i < sizeof (ap_trans->sockets_) / sizeof (urltrans_socket_t);
+       ++i)
+    {
+      if (ap_trans->sockets_[i].p_ev_io)
+        {
+          (void) ap_trans->io_cbacks_.pf_io_stop (
+            ap_trans->p_parent_, ap_trans->sockets_[i].p_ev_io);
+        }
+    }
+}
+
+static OMX_ERRORTYPE
+restart_segment_sockets (tiz_urltrans_t * ap_trans)
+{
+  size_t i = 0;
+  assert (ap_trans);
+  for (i = 0; i < sizeof (ap_trans->sockets_) / sizeof (urltrans_socket_t);
+       ++i)
+    {
+      if (ap_trans->sockets_[i].p_ev_io)
+        {
+          tiz_check_omx (ap_trans->io_cbacks_.pf_io_start (
+            ap_trans->p_parent_, ap_trans->sockets_[i].p_ev_io));
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static void
+release_segment (urltrans_segment_t * ap_seg)
+{
+  assert (ap_seg);
+  ap_seg->active = false;
+  ap_seg->done = false;
+  tiz_buffer_clear (ap_seg->p_data);
+}
+
+static void
+reset_segments (tiz_urltrans_t * ap_trans)
+{
+  size_t i = 0;
+  assert (ap_trans);
+
+  for (i = 0; i < URLTRANS_MAX_SEGMENTS; ++i)
+    {
+      urltrans_segment_t * p_seg = &(ap_trans->segments_[i]);
+      if (p_seg->active && !p_seg->done && ap_trans->p_curl_multi_)
+        {
+          (void) curl_multi_remove_handle (ap_trans->p_curl_multi_,
+                                           p_seg->p_curl);
+        }
+      release_segment (p_seg);
+    }
+
+  for (i = 0; i < sizeof (ap_trans->sockets_) / sizeof (urltrans_socket_t);
+       ++i)
+    {
+      if (ap_trans->sockets_[i].fd >= 0)
+        {
+          remove_segment_socket (ap_trans, &(ap_trans->sockets_[i]));
+        }
+    }
+
+  ap_trans->total_bytes_ = -1;
+  ap_trans->next_offset_ = 0;
+  ap_trans->ordered_offset_ = 0;
+  ap_trans->range_response_ = false;
+  ap_trans->main_done_ = false;
+  ap_trans->segments_failed_ = false;
+}
+
+static void
+destroy_segments (tiz_urltrans_t * ap_trans)
+{
+  size_t i = 0;
+  assert (ap_trans);
+  reset_segments (ap_trans);
+  for (i = 0; i < URLTRANS_MAX_SEGMENTS; ++i)
+    {
+      curl_easy_cleanup (ap_trans->segments_[i].p_curl);
+      ap_trans->segments_[i].p_curl = NULL;
+      tiz_buffer_destroy (ap_trans->segments_[i].p_data);
+      ap_trans->segments_[i].p_data = NULL;
+    }
+}
+
+/* Segments are never paused. Their size bounds the amount of data they
+   buffer. */
+static size_t
+segment_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+{
+  urltrans_segment_t * p_seg = userdata;
+  size_t nbytes = size * nmemb;
+  long response_code = 0;
+  assert (p_seg);
+
+  (void) curl_easy_getinfo (p_seg->p_curl, CURLINFO_RESPONSE_CODE,
+                            &response_code);
+  if (206 != response_code
+      || p_seg->offset + p_seg->received + (curl_off_t) nbytes
+           > p_seg->end + 1)
+    {
+      /* This is not the range that was requested; abort */
+      return 0;
+    }
+
+  if (nbytes > 0
+      && tiz_buffer_push (p_seg->p_data, ptr, nbytes) < (int) nbytes)
+    {
+      return 0;
+    }
+
+  if (p_seg->p_trans->p_cache_)
+    {
+      tiz_urlcache_write (p_seg->p_trans->p_cache_,
+                          p_seg->offset + p_seg->received, ptr, nbytes);
+    }
+
+  p_seg->received += nbytes;
+  return nbytes;
+}
+
+static OMX_ERRORTYPE
+launch_segment (tiz_urltrans_t * ap_trans, urltrans_segment_t * ap_seg)
+{
+  char * p_url = NULL;
+  char range[64];
+
+  assert (ap_trans);
+  assert (ap_seg);
+
+  ap_seg->p_trans = ap_trans;
+
+  if (!ap_seg->p_curl)
+    {
+      tiz_check_null_ret_oom ((ap_seg->p_curl = curl_easy_init ()));
+      (void) tiz_urltrans_use_shared_cache (ap_seg->p_curl);
+    }
+
+  if (!ap_seg->p_data)
+    {
+      tiz_check_omx (
+        tiz_buffer_init (&(ap_seg->p_data), ap_trans->segment_bytes_));
+    }
+
+  /* Request the url that the first range was finally served from, to skip
+     any redirections */
+  if (CURLE_OK
+        != curl_easy_getinfo (ap_trans->p_curl_, CURLINFO_EFFECTIVE_URL, &p_url)
+      || !p_url)
+    {
+      p_url = (char *) ap_trans->p_uri_param_->contentURI;
+    }
+
+  /* On a retry, only the bytes not received yet are requested */
+  snprintf (range, sizeof (range),
+            "%" CURL_FORMAT_CURL_OFF_T "-%" CURL_FORMAT_CURL_OFF_T,
+            ap_seg->offset + ap_seg->received, ap_seg->end);
+
+  on_curl_error_ret_omx_oom (curl_easy_setopt (ap_seg->p_curl, CURLOPT_URL, p_url));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_seg->p_curl, CURLOPT_RANGE, range));
+  on_curl_error_ret_omx_oom (curl_easy_setopt (
+    ap_seg->p_curl, CURLOPT_USERAGENT, ap_trans->p_comp_name_));
+  on_curl_error_ret_omx_oom (curl_easy_setopt (
+    ap_seg->p_curl, CURLOPT_WRITEFUNCTION, segment_write_cback));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_seg->p_curl, CURLOPT_WRITEDATA, ap_seg));
+  on_curl_error_ret_omx_oom (curl_easy_setopt (
+    ap_seg->p_curl, CURLOPT_HTTPHEADER, ap_trans->p_http_headers_));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_seg->p_curl, CURLOPT_FOLLOWLOCATION, 1));
+  on_curl_error_ret_omx_oom (curl_easy_setopt (ap_seg->p_curl, CURLOPT_NETRC, 1));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_seg->p_curl, CURLOPT_MAXREDIRS, 5));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_seg->p_curl, CURLOPT_FAILONERROR, 1));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_seg->p_curl, CURLOPT_NOPROGRESS, 1));
+  on_curl_error_ret_omx_oom (curl_easy_setopt (
+    ap_seg->p_curl, CURLOPT_CONNECTTIMEOUT, ap_trans->connect_timeout_));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_seg->p_curl, CURLOPT_SSL_VERIFYHOST, 0));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_seg->p_curl, CURLOPT_SSL_VERIFYPEER, 0));
+
+  ap_seg->start_us = tiz_monotonic_usec ();
+  ap_seg->active = true;
+  ap_seg->done = false;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "range [%s] limit [%d]", range,
+           ap_trans->segment_limit_);
+
+  on_curl_multi_error_ret_omx_oom (
+    curl_multi_add_handle (ap_trans->p_curl_multi_, ap_seg->p_curl));
+  return OMX_ErrorNone;
+}
+
+/* Ranges that are already in the cache are not requested again. Returns
+   true if the segment has been filled from the cache. */
+static bool
+load_segment_from_cache (tiz_urltrans_t * ap_trans,
+                         urltrans_segment_t * ap_seg)
+{
+  const curl_off_t nbytes = ap_seg->end + 1 - ap_seg->offset;
+
+  assert (ap_trans);
+  assert (ap_seg);
+
+  if (!ap_trans->p_cache_
+      || tiz_urlcache_available (ap_trans->p_cache_, ap_seg->offset)
+           < (OMX_U64) nbytes
+      || (!ap_seg->p_data
+          && OMX_ErrorNone
+               != tiz_buffer_init (&(ap_seg->p_data),
+                                   ap_trans->segment_bytes_))
+      || (!ap_trans->p_cache_chunk_
+          && !(ap_trans->p_cache_chunk_
+               = tiz_mem_alloc (URLTRANS_CACHE_CHUNK_BYTES))))
+    {
+      return false;
+    }
+
+  while (ap_seg->received < nbytes)
+    {
+      const int chunk
+        = MIN (nbytes - ap_seg->received, URLTRANS_CACHE_CHUNK_BYTES);
+      if (tiz_urlcache_read (ap_trans->p_cache_,
+                             ap_seg->offset + ap_seg->received,
+                             ap_trans->p_cache_chunk_, chunk)
+            != chunk
+          || tiz_buffer_push (ap_seg->p_data, ap_trans->p_cache_chunk_, chunk)
+               < chunk)
+        {
+          tiz_buffer_clear (ap_seg->p_data);
+          ap_seg->received = 0;
+          return false;
+        }
+      ap_seg->received += chunk;
+    }
+
+  ap_seg->p_trans = ap_trans;
+  ap_seg->active = true;
+  ap_seg->done = true;
+  return true;
+}
+
+static int
+launch_segments (tiz_urltrans_t * ap_trans)
+{
+  int launched = 0;
+  assert (ap_trans);
+
+  while (!ap_trans->segments_failed_ && ap_trans->total_bytes_ > 0
+         && ap_trans->next_offset_ < ap_trans->total_bytes_
+         && count_active_segments (ap_trans) < ap_trans->segment_limit_
+         && tiz_buffer_available (ap_trans->p_store_)
+              < ap_trans->internal_buffer_size_)
+    {
+      urltrans_segment_t * p_seg = NULL;
+      int i = 0;
+
+      for (i = 0; i < ap_trans->max_segments_ && !p_seg; ++i)
+        {
+          if (!ap_trans->segments_[i].active)
+            {
+              p_seg = &(ap_trans->segments_[i]);
+            }
+        }
+      assert (p_seg);
+
+      p_seg->offset = ap_trans->next_offset_;
+      p_seg->end = MIN (ap_trans->next_offset_ + ap_trans->segment_bytes_,
+                        ap_trans->total_bytes_)
+                   - 1;
+      p_seg->received = 0;
+      p_seg->delivered = 0;
+      p_seg->retries = 0;
+      tiz_buffer_clear (p_seg->p_data);
+
+      if (load_segment_from_cache (ap_trans, p_seg))
+        {
+          ap_trans->next_offset_ = p_seg->end + 1;
+          continue;
+        }
+
+      if (OMX_ErrorNone != launch_segment (ap_trans, p_seg))
+        {
+          ap_trans->segments_failed_ = true;
+          p_seg->active = false;
+          break;
+        }
+
+      ap_trans->next_offset_ = p_seg->end + 1;
+      ++launched;
+    }
+
+  return launched;
+}
+
+/* A range that completes as fast as the fastest one seen so far suggests
+   that the server throttles each connection, and that one more connection
+   will add throughput. A much slower range suggests that the link is
+   saturated, and that the connections are only competing with each other. */
+static void
+adapt_segment_limit (tiz_urltrans_t * ap_trans, const double a_rate)
+{
+  assert (ap_trans);
+  if (a_rate >= 0.75 * ap_trans->segment_rate_)
+    {
+      if (ap_trans->segment_limit_ < ap_trans->max_segments_)
+        {
+          ++ap_trans->segment_limit_;
+        }
+    }
+  else if (a_rate < 0.5 * ap_trans->segment_rate_
+           && ap_trans->segment_limit_ > 1)
+    {
+      --ap_trans->segment_limit_;
+    }
+  ap_trans->segment_rate_ = MAX (a_rate, 0.9 * ap_trans->segment_rate_);
+}
+
+/* Returns true if the segment has been requested again */
+static bool
+complete_segment (tiz_urltrans_t * ap_trans, urltrans_segment_t * ap_seg,
+                  const CURLcode a_result)
+{
+  assert (ap_trans);
+  assert (ap_seg);
+
+  (void) curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_seg->p_curl);
+
+  if (CURLE_OK == a_result && ap_seg->offset + ap_seg->received > ap_seg->end)
+    {
+      const OMX_U64 elapsed_us = tiz_monotonic_usec () - ap_seg->start_us;
+      ap_seg->done = true;
+      if (0 == ap_seg->retries && elapsed_us > 0)
+        {
+          adapt_segment_limit (ap_trans, (double) ap_seg->received * 1000000.0
+                                           / (double) elapsed_us);
+        }
+      return false;
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_ERROR,
+           "range [%" CURL_FORMAT_CURL_OFF_T "-%" CURL_FORMAT_CURL_OFF_T
+           "] failed (%s)",
+           ap_seg->offset, ap_seg->end, curl_easy_strerror (a_result));
+
+  /* Back off, and request the rest of the range again */
+  ap_trans->segment_limit_ = MAX (1, ap_trans->segment_limit_ / 2);
+  if (++ap_seg->retries > 3 || OMX_ErrorNone != launch_segment (ap_trans, ap_seg))
+    {
+      ap_trans->segments_failed_ = true;
+      ap_seg->active = false;
+      return false;
+    }
+  return true;
+}
+
+/* Moves to the store, in order, the data received by the segments */
+static void
+deliver_segments (tiz_urltrans_t * ap_trans)
+{
+  urltrans_segment_t * p_seg = NULL;
+  assert (ap_trans);
+
+  while (tiz_buffer_available (ap_trans->p_store_)
+           < ap_trans->internal_buffer_size_
+         && (p_seg = find_next_segment (ap_trans)))
+    {
+      const int nbytes = tiz_buffer_available (p_seg->p_data);
+      int nbytes_pushed = 0;
+
+      if (nbytes > 0)
+        {
+          nbytes_pushed = tiz_buffer_push (
+            ap_trans->p_store_, tiz_buffer_get (p_seg->p_data), nbytes);
+          (void) tiz_buffer_advance (p_seg->p_data, nbytes_pushed);
+          p_seg->delivered += nbytes_pushed;
+          ap_trans->ordered_offset_ += nbytes_pushed;
+        }
+
+      if (p_seg->done && p_seg->offset + p_seg->delivered > p_seg->end)
+        {
+          release_segment (p_seg);
+        }
+      else if (0 == nbytes_pushed)
+        {
+          break;
+        }
+    }
+}
+
+/* Processes completed requests, moves data to the store, and requests more
+   ranges. This must be called after curl_multi_socket_action, and never from
+   a curl callback. */
+static OMX_ERRORTYPE
+service_segments (tiz_urltrans_t * ap_trans, int * ap_running_handles)
+{
+  CURLMsg * p_msg = NULL;
+  int nmsgs = 0;
+  bool kickstart = false;
+
+  assert (ap_trans);
+  assert (ap_running_handles);
+
+  if (!is_segmented (ap_trans))
+    {
+      return OMX_ErrorNone;
+    }
+
+  while ((p_msg = curl_multi_info_read (ap_trans->p_curl_multi_, &nmsgs)))
+    {
+      if (CURLMSG_DONE == p_msg->msg)
+        {
+          urltrans_segment_t * p_seg = NULL;
+          if (p_msg->easy_handle == ap_trans->p_curl_)
+            {
+              ap_trans->main_done_ = true;
+              ap_trans->segments_failed_ |= (CURLE_OK != p_msg->data.result);
+            }
+          else if ((p_seg = find_segment (ap_trans, p_msg->easy_handle)))
+            {
+              kickstart |= complete_segment (ap_trans, p_seg,
+                                             p_msg->data.result);
+            }
+        }
+    }
+
+  deliver_segments (ap_trans);
+  kickstart |= (launch_segments (ap_trans) > 0);
+  /* In case the next ranges have been found in the cache */
+  deliver_segments (ap_trans);
+
+  if (kickstart)
+    {
+      tiz_check_omx (kickstart_curl_socket (ap_trans, ap_running_handles));
+    }
+
+  return OMX_ErrorNone;
+}
+
+static void
+forward_header (tiz_urltrans_t * ap_trans, const char * ap_header,
+                const size_t a_nbytes)
 {
   assert (ap_trans);
-  ap_trans->internal_buffer_size_initial_ = ap_trans->internal_buffer_size_;
+  if (ap_trans->p_cache_)
+    {
+      tiz_urlcache_store_header (ap_trans->p_cache_, ap_header, a_nbytes);
+    }
+  ap_trans->info_cbacks_.pf_header_avail (ap_trans->p_parent_, ap_header,
+                                          a_nbytes);
 }
 
-static void
-report_connection_lost_event (tiz_urltrans_t * ap_trans)
+bool
+tiz_urltrans_process_range_header (tiz_urltrans_range_t * ap_range,
+                                   const char * ap_header,
+                                   const size_t a_nbytes, char * ap_length,
+                                   const size_t a_length_size)
 {
-  bool auto_reconnect = false;
+  assert (ap_range);
+  assert (ap_header);
+  assert (ap_length);
+  assert (a_length_size > 0);
+
+  ap_length[0] = '\0';
+
+  if (a_nbytes > 5 && 0 == strncasecmp (ap_header, "HTTP/", 5))
+    {
+      const char * p_code = memchr (ap_header, ' ', a_nbytes);
+      ap_range->partial
+        = (p_code && (p_code + 4) <= (ap_header + a_nbytes)
+           && 0 == strncmp (p_code + 1, "206", 3));
+      /* A server that ignores the range sends the whole resource */
+      ap_range->skip_bytes = ap_range->partial ? 0 : ap_range->resume_offset;
+    }
+  else if (ap_range->partial)
+    {
+      if (a_nbytes > 15 && 0 == strncasecmp (ap_header, "Content-Length:", 15))
+        {
+          return true;
+        }
+      else if (a_nbytes > 14
+               && 0 == strncasecmp (ap_header, "Content-Range:", 14))
+        {
+          char value[128];
+          long long first = 0;
+          long long last = 0;
+          long long total = 0;
+          const size_t len = MIN (a_nbytes, sizeof (value) - 1);
+          memcpy (value, ap_header, len);
+          value[len] = '\0';
+          if (3
+                == sscanf (value + 14, " bytes %lld-%lld/%lld", &first, &last,
+                           &total)
+              && ap_range->resume_offset == first && last < total)
+            {
+              ap_range->total_bytes = total;
+              ap_range->next_offset = last + 1;
+              if (0 == ap_range->resume_offset)
+                {
+                  snprintf (ap_length, a_length_size,
+                            "Content-Length: %lld\r\n", total);
+                }
+              return true;
+            }
+        }
+    }
+  return false;
+}
+
+/* The status line and Content-Length of the response to the first range
+   describe that range. The Content-Length is replaced with the size of the
+   whole resource, as found in Content-Range, which is what the client
+   expects. Returns true if the header has been dealt with. */
+static bool
+process_range_header (tiz_urltrans_t * ap_trans, const char * ap_header,
+                      const size_t a_nbytes)
+{
+  tiz_urltrans_range_t range;
+  char length[64];
+  bool done = false;
+
   assert (ap_trans);
-  stop_curl_timer_watcher (ap_trans);
-  assert (ap_trans->info_cbacks_.pf_connection_lost);
-  set_curl_state (ap_trans, ECurlStateStopped);
-  send_from_internal_buffer (ap_trans);
-  auto_reconnect
-    = ap_trans->info_cbacks_.pf_connection_lost (ap_trans->p_parent_);
-  reset_initial_buffer_size (ap_trans);
-  if (auto_reconnect)
+
+  range.resume_offset = ap_trans->resume_offset_;
+  range.partial = ap_trans->range_response_;
+  range.skip_bytes = ap_trans->skip_bytes_;
+  range.total_bytes = ap_trans->total_bytes_;
+  range.next_offset = ap_trans->next_offset_;
+
+  done = tiz_urltrans_process_range_header (&range, ap_header, a_nbytes,
+                                            length, sizeof (length));
+
+  ap_trans->range_response_ = range.partial;
+  ap_trans->skip_bytes_ = range.skip_bytes;
+  ap_trans->total_bytes_ = range.total_bytes;
+  ap_trans->next_offset_ = range.next_offset;
+
+  if ('\0' != length[0])
     {
-      (void) start_reconnect_timer_watcher (ap_trans);
+      forward_header (ap_trans, ap_header, a_nbytes);
+      forward_header (ap_trans, length, strlen (length));
     }
+  return done;
 }
 
 /* This function gets called by libcurl as soon as it has received header
@@ -686,25 +1497,31 @@ curl_header_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
   assert (p_trans->info_cbacks_.pf_header_avail);
   URLTRANS_LOG_CBACK_START (p_trans);
   stop_reconnect_timer_watcher (p_trans);
-  p_trans->info_cbacks_.pf_header_avail (p_trans->p_parent_, ptr, nbytes);
+  /* When the transfer resumes where the cache ran out, the client has
+     already been given the headers */
+  if ((!is_segmented (p_trans) && 0 == p_trans->resume_offset_)
+      || !process_range_header (p_trans, ptr, nbytes))
+    {
+      if (0 == p_trans->resume_offset_)
+        {
+          forward_header (p_trans, ptr, nbytes);
+        }
+    }
   URLTRANS_LOG_CBACK_END (p_trans);
   return nbytes;
 }
 
-/* This function gets called by libcurl as soon as there is data received that
-   needs to be saved. The size of the data pointed to by ptr is size multiplied
-   with nmemb, it will not be zero terminated. Return the number of bytes
-   actually taken care of. If that amount differs from the amount passed to
-   your function, it'll signal an error to the library. This will abort the
-   transfer and return CURLE_WRITE_ERROR.  */
+/* Hands over data that follows what has already been delivered, whether it
+   comes from the network or from the cache. Returns a_nbytes, or
+   CURL_WRITEFUNC_PAUSE if none of the data could be taken, in which case the
+   same data must be offered again after resuming. */
 static size_t
-curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+process_data (tiz_urltrans_t * p_trans, void * ptr, const size_t a_nbytes)
 {
-  tiz_urltrans_t * p_trans = userdata;
-  size_t nbytes = size * nmemb;
+  void * p_data = ptr;
+  size_t nbytes = a_nbytes;
   size_t rc = nbytes;
   assert (p_trans);
-  URLTRANS_LOG_CBACK_START (p_trans);
 
   if (nbytes > 0)
     {
@@ -749,8 +1566,11 @@ curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
 
           if (nbytes > 0)
             {
-              if (tiz_buffer_available (p_trans->p_store_)
-                  > (p_trans->internal_buffer_size_))
+              /* Once part of the data has gone out, pausing would make curl
+                 deliver those bytes again, so the rest is always stored */
+              if (nbytes == a_nbytes
+                  && tiz_buffer_available (p_trans->p_store_)
+                       > (p_trans->internal_buffer_size_))
                 {
                   /* This is to pause curl */
                   TIZ_PRINTF_DBG_GRN ("Pausing curl - cache size [%d]",
@@ -778,10 +1598,210 @@ curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
         }
     }
 
+  if (CURL_WRITEFUNC_PAUSE != rc)
+    {
+      if (p_trans->p_cache_ && !p_trans->cache_replay_)
+        {
+          tiz_urlcache_write (p_trans->p_cache_, p_trans->ordered_offset_,
+                              p_data, a_nbytes);
+        }
+      p_trans->ordered_offset_ += a_nbytes;
+    }
+
+  return rc;
+}
+
+/* This function gets called by libcurl as soon as there is data received that
+   needs to be saved. The size of the data pointed to by ptr is size multiplied
+   with nmemb, it will not be zero terminated. Return the number of bytes
+   actually taken care of. If that amount differs from the amount passed to
+   your function, it'll signal an error to the library. This will abort the
+   transfer and return CURLE_WRITE_ERROR.  */
+static size_t
+curl_write_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+{
+  tiz_urltrans_t * p_trans = userdata;
+  const size_t nbytes = size * nmemb;
+  size_t skip = 0;
+  size_t rc = nbytes;
+  assert (p_trans);
+  URLTRANS_LOG_CBACK_START (p_trans);
+
+  /* The bytes before the resume offset have already been delivered from the
+     cache. A paused chunk is delivered again in full, so they are only
+     discounted once the chunk has been taken. */
+  skip = MIN ((size_t) p_trans->skip_bytes_, nbytes);
+  if (CURL_WRITEFUNC_PAUSE
+      != (rc = process_data (p_trans, (char *) ptr + skip, nbytes - skip)))
+    {
+      p_trans->skip_bytes_ -= skip;
+      rc = nbytes;
+    }
+
   URLTRANS_LOG_CBACK_END (p_trans);
   return rc;
 }
 
+/*
+ * On-disk cache
+ */
+
+static inline bool
+is_cache_enabled (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  return (ap_trans->cache_max_bytes_ > 0);
+}
+
+static void
+close_cache (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  tiz_urlcache_close (ap_trans->p_cache_);
+  ap_trans->p_cache_ = NULL;
+  ap_trans->cache_replay_ = false;
+}
+
+static void
+open_cache (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  close_cache (ap_trans);
+  if (is_cache_enabled (ap_trans))
+    {
+      const char * p_key = ap_trans->p_cache_key_
+                             ? ap_trans->p_cache_key_
+                             : (const char *) ap_trans->p_uri_param_->contentURI;
+      if (OMX_ErrorNone
+          != tiz_urlcache_open (&(ap_trans->p_cache_), ap_trans->p_cache_dir_,
+                                p_key, ap_trans->cache_max_bytes_))
+        {
+          /* Carry on without the cache */
+          ap_trans->p_cache_ = NULL;
+        }
+    }
+}
+
+static void
+send_cached_headers (tiz_urltrans_t * ap_trans)
+{
+  const char * p_line = NULL;
+  const OMX_S64 total = tiz_urlcache_total (ap_trans->p_cache_);
+
+  assert (ap_trans);
+
+  for (p_line = tiz_urlcache_headers (ap_trans->p_cache_); *p_line;)
+    {
+      const char * p_end = strstr (p_line, "\r\n");
+      const size_t len = p_end ? (size_t) (p_end - p_line) + 2 : strlen (p_line);
+      ap_trans->info_cbacks_.pf_header_avail (ap_trans->p_parent_, p_line,
+                                              len);
+      p_line += len;
+    }
+
+  if (total >= 0)
+    {
+      char length[64];
+      snprintf (length, sizeof (length), "Content-Length: %lld\r\n",
+                (long long) total);
+      ap_trans->info_cbacks_.pf_header_avail (ap_trans->p_parent_, length,
+                                              strlen (length));
+    }
+  ap_trans->cache_headers_sent_ = true;
+}
+
+/* Delivers the data found in the cache, the same way the data that comes from
+   the network is delivered, and continues from the network when the cache
+   runs out. */
+static OMX_ERRORTYPE
+replay_from_cache (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  assert (ap_trans->cache_replay_);
+  assert (ap_trans->p_cache_);
+
+  if (!ap_trans->p_cache_chunk_)
+    {
+      tiz_check_null_ret_oom ((ap_trans->p_cache_chunk_
+                               = tiz_mem_alloc (URLTRANS_CACHE_CHUNK_BYTES)));
+    }
+
+  if (!ap_trans->cache_headers_sent_)
+    {
+      send_cached_headers (ap_trans);
+    }
+
+  while (is_transfer_running (ap_trans))
+    {
+      const int nbytes = MIN (
+        tiz_urlcache_available (ap_trans->p_cache_, ap_trans->ordered_offset_),
+        URLTRANS_CACHE_CHUNK_BYTES);
+      if (0 == nbytes
+          || nbytes
+               != tiz_urlcache_read (ap_trans->p_cache_,
+                                     ap_trans->ordered_offset_,
+                                     ap_trans->p_cache_chunk_, nbytes))
+        {
+          break;
+        }
+      /* This pauses the transfer when the client can not take the data */
+      (void) process_data (ap_trans, ap_trans->p_cache_chunk_, nbytes);
+    }
+
+  if (is_transfer_running (ap_trans))
+    {
+      ap_trans->cache_replay_ = false;
+      if (tiz_urlcache_is_complete (ap_trans->p_cache_))
+        {
+          TIZ_LOG (TIZ_PRIORITY_TRACE,
+                   "[%s] : delivered from the cache",
+                   ap_trans->p_uri_param_->contentURI);
+          report_connection_lost_event (ap_trans);
+        }
+      else
+        {
+          int running_handles = 0;
+          TIZ_LOG (TIZ_PRIORITY_TRACE,
+                   "[%s] : resuming at [%" CURL_FORMAT_CURL_OFF_T "]",
+                   ap_trans->p_uri_param_->contentURI,
+                   ap_trans->ordered_offset_);
+          ap_trans->resume_offset_ = ap_trans->ordered_offset_;
+          tiz_check_omx (start_curl (ap_trans));
+          tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
+/* Starts a transfer from the beginning of the resource. If the cache has the
+   headers and the first bytes of the resource, the transfer begins there, on
+   the next tick of the curl timer. */
+static OMX_ERRORTYPE
+start_transfer (tiz_urltrans_t * ap_trans)
+{
+  int running_handles = 0;
+  assert (ap_trans);
+
+  reset_segments (ap_trans);
+  ap_trans->resume_offset_ = 0;
+  ap_trans->skip_bytes_ = 0;
+  ap_trans->cache_headers_sent_ = false;
+  open_cache (ap_trans);
+
+  if (ap_trans->p_cache_ && *tiz_urlcache_headers (ap_trans->p_cache_)
+      && tiz_urlcache_available (ap_trans->p_cache_, 0) > 0)
+    {
+      ap_trans->cache_replay_ = true;
+      set_curl_state (ap_trans, ECurlStateTransfering);
+      ap_trans->curl_timeout_ = 0.001;
+      return start_curl_timer_watcher (ap_trans);
+    }
+
+  tiz_check_omx (start_curl (ap_trans));
+  return kickstart_curl_socket (ap_trans, &running_handles);
+}
+
 /* #ifdef _DEBUG */
 /* Pass a pointer to a function that matches the following prototype: int
    curl_debug_callback (CURL *, curl_infotype, char *, size_t, void *);
@@ -865,6 +1885,42 @@ curl_socket_cback (CURL * easy, curl_socket_t s, int action, void * userp,
   TIZ_LOG (TIZ_PRIORITY_DEBUG,
            "socket [%d] action [%d] (1 READ, 2 WRITE, 3 READ/WRITE, 4 REMOVE)",
            s, action);
+  if (is_segmented (p_trans))
+    {
+      /* A pooled connection may move between the main handle and the
+         segments' handles */
+      urltrans_socket_t * p_sock = find_segment_socket (p_trans, s);
+      if (easy != p_trans->p_curl_)
+        {
+          if (s == p_trans->sockfd_)
+            {
+              release_io_watcher (p_trans);
+            }
+          if (CURL_POLL_IN == action)
+            {
+              (void) watch_segment_socket (p_trans, s, TIZ_EVENT_READ);
+            }
+          else if (CURL_POLL_OUT == action)
+            {
+              (void) watch_segment_socket (p_trans, s, TIZ_EVENT_WRITE);
+            }
+          else if (CURL_POLL_INOUT == action)
+            {
+              (void) watch_segment_socket (p_trans, s,
+                                           TIZ_EVENT_READ_OR_WRITE);
+            }
+          else if (CURL_POLL_REMOVE == action && p_sock)
+            {
+              remove_segment_socket (p_trans, p_sock);
+            }
+          URLTRANS_LOG_CBACK_END (p_trans);
+          return 0;
+        }
+      else if (p_sock)
+        {
+          remove_segment_socket (p_trans, p_sock);
+        }
+    }
   if (CURL_POLL_IN == action)
     {
       (void) start_io_watcher (p_trans, s, TIZ_EVENT_READ);
@@ -875,11 +1931,11 @@ curl_socket_cback (CURL * easy, curl_socket_t s, int action, void * userp,
     }
   else if (CURL_POLL_REMOVE == action)
     {
-      (void) stop_io_watcher (p_trans);
-      p_trans->io_cbacks_.pf_io_destroy (p_trans->p_parent_, p_trans->p_ev_io_);
-      p_trans->p_ev_io_ = NULL;
-      p_trans->sockfd_ = -1;
-      (void) stop_curl_timer_watcher (p_trans);
+      release_io_watcher (p_trans);
+      if (!is_segmented (p_trans))
+        {
+          (void) stop_curl_timer_watcher (p_trans);
+        }
     }
   URLTRANS_LOG_CBACK_END (p_trans);
   return 0;
@@ -928,6 +1984,85 @@ curl_timer_cback (CURLM * multi, long timeout_ms, void * userp)
   return 0;
 }
 
+/* Process-wide cache of DNS entries and TLS sessions, shared by all the
+   transfers. Streaming sources create a new transfer for every track, almost
+   always against the same few hosts, so this saves a name lookup and a full
+   TLS handshake per track. The share lives until the process exits, and holds
+   its own reference on libcurl's global state so that the
+   curl_global_cleanup calls made when transfers are destroyed can not tear
+   down the TLS library underneath it. Connections are not shared: libcurl
+   does not support sharing its connection cache between threads, and each
+   component runs its transfers on its own thread. */
+static pthread_once_t g_share_once = PTHREAD_ONCE_INIT;
+static CURLSH * gp_share = NULL;
+static pthread_mutex_t g_share_locks[CURL_LOCK_DATA_LAST];
+
+static void
+share_lock_cback (CURL * p_curl, curl_lock_data data, curl_lock_access access,
+                  void * userptr)
+{
+  (void) pthread_mutex_lock (&(g_share_locks[data]));
+}
+
+static void
+share_unlock_cback (CURL * p_curl, curl_lock_data data, void * userptr)
+{
+  (void) pthread_mutex_unlock (&(g_share_locks[data]));
+}
+
+static void
+init_curl_share (void)
+{
+  CURLSH * p_share = NULL;
+  int i = 0;
+
+  if (CURLE_OK != curl_global_init (CURL_GLOBAL_ALL))
+    {
+      return;
+    }
+
+  for (i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+    {
+      (void) pthread_mutex_init (&(g_share_locks[i]), NULL);
+    }
+
+  if ((p_share = curl_share_init ()))
+    {
+      if (CURLSHE_OK
+            == curl_share_setopt (p_share, CURLSHOPT_LOCKFUNC, share_lock_cback)
+          && CURLSHE_OK == curl_share_setopt (p_share, CURLSHOPT_UNLOCKFUNC,
+                                              share_unlock_cback)
+          && CURLSHE_OK
+               == curl_share_setopt (p_share, CURLSHOPT_SHARE,
+                                     CURL_LOCK_DATA_DNS)
+          && CURLSHE_OK == curl_share_setopt (p_share, CURLSHOPT_SHARE,
+                                              CURL_LOCK_DATA_SSL_SESSION))
+        {
+          gp_share = p_share;
+        }
+      else
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to configure the curl share");
+          (void) curl_share_cleanup (p_share);
+        }
+    }
+}
+
+OMX_ERRORTYPE
+tiz_urltrans_use_shared_cache (void * ap_curl)
+{
+  assert (ap_curl);
+  (void) pthread_once (&g_share_once, init_curl_share);
+  if (!gp_share)
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+  return (CURLE_OK == curl_easy_setopt ((CURL *) ap_curl, CURLOPT_SHARE,
+                                        gp_share)
+            ? OMX_ErrorNone
+            : OMX_ErrorUndefined);
+}
+
 static OMX_ERRORTYPE
 allocate_curl_global_resources (tiz_urltrans_t * ap_trans)
 {
@@ -1019,6 +2154,9 @@ allocate_curl_resources (tiz_urltrans_t * ap_trans)
 
   /* Init the curl easy handle */
   tiz_check_null_ret_oom ((ap_trans->p_curl_ = curl_easy_init ()));
+  /* A failure here only means that DNS lookups and TLS handshakes will not
+     be cached across transfers */
+  (void) tiz_urltrans_use_shared_cache (ap_trans->p_curl_);
   /* Now init the curl multi handle */
   bail_on_oom ((ap_trans->p_curl_multi_ = curl_multi_init ()));
   /* this is to ask libcurl to accept ICY OK headers*/
@@ -1050,6 +2188,7 @@ destroy_curl_resources (tiz_urltrans_t * ap_trans)
   ap_trans->p_http_ok_aliases_ = NULL;
   curl_slist_free_all (ap_trans->p_http_headers_);
   ap_trans->p_http_headers_ = NULL;
+  destroy_segments (ap_trans);
   curl_multi_cleanup (ap_trans->p_curl_multi_);
   ap_trans->p_curl_multi_ = NULL;
   curl_easy_cleanup (ap_trans->p_curl_);
@@ -1115,6 +2254,29 @@ tiz_urltrans_init (tiz_urltrans_ptr_t * app_trans, void * ap_parent,
           p_trans->curl_state_ = ECurlStateStopped;
           p_trans->curl_version_ = 0;
           p_trans->handshake_error_found = false;
+          p_trans->max_segments_ = 0;
+          p_trans->segment_bytes_ = 0;
+          p_trans->segment_limit_ = 0;
+          p_trans->segment_rate_ = 0;
+          p_trans->total_bytes_ = -1;
+          p_trans->p_cache_dir_ = NULL;
+          p_trans->p_cache_key_ = NULL;
+          p_trans->cache_max_bytes_ = 0;
+          p_trans->p_cache_ = NULL;
+          p_trans->p_cache_chunk_ = NULL;
+          p_trans->cache_replay_ = false;
+          p_trans->cache_headers_sent_ = false;
+          p_trans->resume_offset_ = 0;
+          p_trans->skip_bytes_ = 0;
+          {
+            size_t i = 0;
+            for (i = 0; i < sizeof (p_trans->sockets_)
+                              / sizeof (urltrans_socket_t);
+                 ++i)
+              {
+                p_trans->sockets_[i].fd = -1;
+              }
+          }
 
           rc = allocate_temp_data_store (p_trans);
           goto_end_on_omx_error (rc, "Unable to alloc the data store");
@@ -1143,6 +2305,10 @@ tiz_urltrans_destroy (tiz_urltrans_t * ap_trans)
 {
   if (ap_trans)
     {
+      close_cache (ap_trans);
+      tiz_mem_free (ap_trans->p_cache_dir_);
+      tiz_mem_free (ap_trans->p_cache_key_);
+      tiz_mem_free (ap_trans->p_cache_chunk_);
       destroy_temp_data_store (ap_trans);
       destroy_events (ap_trans);
       destroy_curl_resources (ap_trans);
@@ -1159,6 +2325,8 @@ tiz_urltrans_set_uri (tiz_urltrans_t * ap_trans,
   URLTRANS_LOG_API_START (ap_trans);
   ap_trans->p_uri_param_ = ap_uri_param;
   curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
+  reset_segments (ap_trans);
+  close_cache (ap_trans);
   bail_on_curl_error (curl_easy_setopt (ap_trans->p_curl_, CURLOPT_URL,
                                         ap_trans->p_uri_param_->contentURI));
   set_curl_state (ap_trans, ECurlStateStopped);
@@ -1190,13 +2358,74 @@ tiz_urltrans_set_internal_buffer_size (tiz_urltrans_t * ap_trans,
   URLTRANS_LOG_API_END (ap_trans);
 }
 
+void
+tiz_urltrans_set_segmented_download (tiz_urltrans_t * ap_trans,
+                                     const int a_max_segments,
+                                     const int a_segment_bytes)
+{
+  assert (ap_trans);
+  assert (a_max_segments >= 0);
+  assert (0 == a_max_segments || a_segment_bytes > 0);
+  URLTRANS_LOG_API_START (ap_trans);
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "max segments : [%d] segment bytes : [%d]",
+           a_max_segments, a_segment_bytes);
+  ap_trans->max_segments_ = MIN (a_max_segments, URLTRANS_MAX_SEGMENTS);
+  ap_trans->segment_bytes_ = a_segment_bytes;
+  ap_trans->segment_limit_ = MIN (2, ap_trans->max_segments_);
+  ap_trans->segment_rate_ = 0;
+  URLTRANS_LOG_API_END (ap_trans);
+}
+
+void
+tiz_urltrans_set_cache (tiz_urltrans_t * ap_trans, const char * ap_dir,
+                        const OMX_U64 a_max_bytes)
+{
+  assert (ap_trans);
+  URLTRANS_LOG_API_START (ap_trans);
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "cache dir : [%s] max bytes : [%llu]",
+           ap_dir ? ap_dir : "(default)", (unsigned long long) a_max_bytes);
+  tiz_mem_free (ap_trans->p_cache_dir_);
+  ap_trans->p_cache_dir_ = NULL;
+  if (ap_dir && *ap_dir)
+    {
+      ap_trans->p_cache_dir_ = tiz_mem_calloc (1, strlen (ap_dir) + 1);
+      if (ap_trans->p_cache_dir_)
+        {
+          strcpy (ap_trans->p_cache_dir_, ap_dir);
+        }
+    }
+  ap_trans->cache_max_bytes_ = a_max_bytes;
+  URLTRANS_LOG_API_END (ap_trans);
+}
+
+void
+tiz_urltrans_set_cache_key (tiz_urltrans_t * ap_trans, const char * ap_key)
+{
+  assert (ap_trans);
+  tiz_mem_free (ap_trans->p_cache_key_);
+  ap_trans->p_cache_key_ = NULL;
+  if (ap_key && *ap_key)
+    {
+      ap_trans->p_cache_key_ = tiz_mem_calloc (1, strlen (ap_key) + 1);
+      if (ap_trans->p_cache_key_)
+        {
+          strcpy (ap_trans->p_cache_key_, ap_key);
+        }
+    }
+}
+
 OMX_ERRORTYPE
 tiz_urltrans_start (tiz_urltrans_t * ap_trans)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_trans);
   URLTRANS_LOG_API_START (ap_trans);
-  if (is_transfer_stopped (ap_trans) || is_transfer_paused (ap_trans))
+  if (is_transfer_stopped (ap_trans))
+    {
+      ap_trans->handshake_error_found = false;
+      tiz_check_omx (start_transfer (ap_trans));
+    }
+  else if (is_transfer_paused (ap_trans) && !ap_trans->cache_replay_)
     {
       int running_handles = 0;
       tiz_check_omx (start_curl (ap_trans));
@@ -1218,6 +2447,7 @@ tiz_urltrans_pause (tiz_urltrans_t * ap_trans)
   URLTRANS_LOG_API_START (ap_trans);
   tiz_check_omx (stop_io_watcher (ap_trans));
   tiz_check_omx (stop_curl_timer_watcher (ap_trans));
+  stop_segment_sockets (ap_trans);
   rc = stop_reconnect_timer_watcher (ap_trans);
   URLTRANS_LOG_API_END (ap_trans);
   return rc;
@@ -1231,7 +2461,11 @@ tiz_urltrans_unpause (tiz_urltrans_t * ap_trans)
   assert (ap_trans);
   URLTRANS_LOG_API_START (ap_trans);
   tiz_check_omx (restart_curl_timer_watcher (ap_trans));
-  tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+  tiz_check_omx (restart_segment_sockets (ap_trans));
+  if (!ap_trans->cache_replay_)
+    {
+      tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+    }
   URLTRANS_LOG_API_END (ap_trans);
   ASSERT_ASYNC_EVENTS (ap_trans);
   return rc;
@@ -1248,6 +2482,8 @@ tiz_urltrans_cancel (tiz_urltrans_t * ap_trans)
     {
       curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
     }
+  reset_segments (ap_trans);
+  close_cache (ap_trans);
   ap_trans->sockfd_ = -1;
   ap_trans->awaiting_io_ev_ = false;
   ap_trans->awaiting_curl_timer_ev_ = false;
@@ -1283,6 +2519,20 @@ tiz_urltrans_on_buffers_ready (tiz_urltrans_t * ap_trans)
           rc = resume_curl (ap_trans);
         }
     }
+  else if (is_segmented (ap_trans) && is_transfer_running (ap_trans)
+           && !ap_trans->cache_replay_)
+    {
+      /* Make room in the store for the ranges that are already buffered, and
+         request more if needed */
+      int running_handles = 1;
+      tiz_check_omx (service_segments (ap_trans, &running_handles));
+      rc = send_from_internal_buffer (ap_trans);
+      if (ap_trans->main_done_ && ap_trans->total_bytes_ >= 0
+          && ap_trans->ordered_offset_ >= ap_trans->total_bytes_)
+        {
+          report_connection_lost_event (ap_trans);
+        }
+    }
   URLTRANS_LOG_API_END (ap_trans);
   /* This assertion is apparently not needed. See
      https://github.com/tizonia/tizonia-openmax-il/issues/472 */
@@ -1296,9 +2546,12 @@ tiz_urltrans_on_io_ready (tiz_urltrans_t * ap_trans, tiz_event_io_t * ap_ev_io,
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   int loop_count = 10000;
+  urltrans_socket_t * p_sock = NULL;
   assert (ap_trans);
   URLTRANS_LOG_API_START (ap_trans);
-  if (a_fd == ap_trans->sockfd_)
+  if (a_fd == ap_trans->sockfd_
+      || (is_segmented (ap_trans)
+          && (p_sock = find_segment_socket (ap_trans, a_fd))))
     {
       int running_handles = 0;
       int curl_ev_bitmask = 0;
@@ -1314,7 +2567,7 @@ tiz_urltrans_on_io_ready (tiz_urltrans_t * ap_trans, tiz_event_io_t * ap_ev_io,
       do
         {
           on_curl_multi_error_ret_omx_oom (curl_multi_socket_action (
-            ap_trans->p_curl_multi_, ap_trans->sockfd_, curl_ev_bitmask,
+            ap_trans->p_curl_multi_, a_fd, curl_ev_bitmask,
             &running_handles));
         }
       while (0 == ap_trans->curl_timeout_ && --loop_count > 0);
@@ -1328,7 +2581,17 @@ tiz_urltrans_on_io_ready (tiz_urltrans_t * ap_trans, tiz_event_io_t * ap_ev_io,
           ap_trans->curl_timeout_ = ((double) timeout_ms / (double) 1000);
         }
 
-      if (!running_handles)
+      /* The segment's watcher is one-shot; re-arm it unless curl has stopped
+         using the socket */
+      if (p_sock && (p_sock = find_segment_socket (ap_trans, a_fd)))
+        {
+          tiz_check_omx (ap_trans->io_cbacks_.pf_io_start (
+            ap_trans->p_parent_, p_sock->p_ev_io));
+        }
+
+      tiz_check_omx (service_segments (ap_trans, &running_handles));
+
+      if (is_transfer_finished (ap_trans, running_handles))
         {
           report_connection_lost_event (ap_trans);
         }
@@ -1360,10 +2623,22 @@ tiz_urltrans_on_timer_ready (tiz_urltrans_t * ap_trans,
   if (ap_trans->awaiting_curl_timer_ev_
       && ap_ev_timer == ap_trans->p_ev_curl_timer_)
     {
-      if (is_transfer_running (ap_trans))
+      if (ap_trans->cache_replay_)
+        {
+          (void) stop_curl_timer_watcher (ap_trans);
+          if (is_transfer_running (ap_trans))
+            {
+              tiz_check_omx (replay_from_cache (ap_trans));
+            }
+        }
+      /* In segmented downloads, the ranges keep going while the main
+         request is paused */
+      else if (is_transfer_running (ap_trans)
+          || (is_segmented (ap_trans) && is_transfer_paused (ap_trans)))
         {
           tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
-          if (!running_handles)
+          tiz_check_omx (service_segments (ap_trans, &running_handles));
+          if (is_transfer_finished (ap_trans, running_handles))
             {
               report_connection_lost_event (ap_trans);
             }
@@ -1384,8 +2659,8 @@ tiz_urltrans_on_timer_ready (tiz_urltrans_t * ap_trans,
       TIZ_PRINTF_C01 ("Re-connecting in %.1f seconds.\n",
                       ap_trans->reconnect_timeout_);
       curl_multi_remove_handle (ap_trans->p_curl_multi_, ap_trans->p_curl_);
-      start_curl (ap_trans);
-      tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+      set_curl_state (ap_trans, ECurlStateStopped);
+      tiz_check_omx (start_transfer (ap_trans));
     }
   URLTRANS_LOG_API_END (ap_trans);
   ASSERT_ASYNC_EVENTS (ap_trans);
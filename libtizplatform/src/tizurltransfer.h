@@ -307,6 +307,61 @@ void
 tiz_urltrans_set_internal_buffer_size (tiz_urltrans_t * ap_trans,
                                        const int a_nbytes);
 
+/**
+ * Enable segmented downloads. When the server honours range requests, the
+ * resource is fetched as consecutive ranges of a_segment_bytes, using up to
+ * a_max_segments extra connections at a time, and reassembled in order. The
+ * number of connections in use adapts to the throughput observed per
+ * connection. This is meant for on-demand content served by CDNs that
+ * throttle each connection; servers that ignore the Range header are
+ * streamed as usual.
+ *
+ * @ingroup tizurltransfer
+ *
+ * @param ap_trans The url transfer handle.
+ * @param a_max_segments Maximum number of parallel range requests (0
+ * disables segmented downloads).
+ * @param a_segment_bytes The size of each range request.
+ */
+void
+tiz_urltrans_set_segmented_download (tiz_urltrans_t * ap_trans,
+                                     const int a_max_segments,
+                                     const int a_segment_bytes);
+
+/**
+ * Enable the on-disk cache. The bytes received are kept on disk, keyed by
+ * url (or by the key given with tiz_urltrans_set_cache_key). A transfer of a
+ * resource that is already in the cache is served from disk without any
+ * network access. If only the beginning of the resource is in the cache, the
+ * rest is requested from the server with a range request. The least
+ * recently used resources are removed when the cache grows beyond
+ * a_max_bytes. This is meant for on-demand content; live streams must not
+ * use it.
+ *
+ * @ingroup tizurltransfer
+ *
+ * @param ap_trans The url transfer handle.
+ * @param ap_dir The cache directory (if NULL, $XDG_CACHE_HOME/tizonia/streams
+ * or ~/.cache/tizonia/streams).
+ * @param a_max_bytes The size budget of the cache (0 disables the cache).
+ */
+void
+tiz_urltrans_set_cache (tiz_urltrans_t * ap_trans, const char * ap_dir,
+                        const OMX_U64 a_max_bytes);
+
+/**
+ * Set the key that identifies the resource in the on-disk cache, for
+ * services whose urls change from one request to the next (e.g. signed urls
+ * that expire). It takes effect on the next tiz_urltrans_start.
+ *
+ * @ingroup tizurltransfer
+ *
+ * @param ap_trans The url transfer handle.
+ * @param ap_key The key (if NULL, the url is used).
+ */
+void
+tiz_urltrans_set_cache_key (tiz_urltrans_t * ap_trans, const char * ap_key);
+
 OMX_ERRORTYPE
 tiz_urltrans_start (tiz_urltrans_t * ap_trans);
 
@@ -339,6 +394,18 @@ tiz_urltrans_bytes_available (tiz_urltrans_t * ap_trans);
 bool
 tiz_urltrans_handshake_error_found (tiz_urltrans_t * ap_trans);
 
+/**
+ * Make a curl easy handle use the process-wide cache of DNS entries and TLS
+ * sessions that is shared by all URL transfers.
+ *
+ * @ingroup tizurltransfer
+ *
+ * @param ap_curl A CURL easy handle.
+ * @return OMX_ErrorNone on success.
+ */
+OMX_ERRORTYPE
+tiz_urltrans_use_shared_cache (void * ap_curl);
+
 #ifdef __cplusplus
 }
 #endif
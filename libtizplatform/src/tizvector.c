@@ -93,7 +93,7 @@ OMX_ERRORTYPE
 tiz_vector_insert (tiz_vector_t * p_vec, OMX_PTR ap_data, OMX_S32 a_pos)
 {
   assert (p_vec);
-  assert (a_pos > 0);
+  assert (a_pos >= 0);
   assert (ap_data);
   utarray_insert (p_vec->p_uta, ap_data, a_pos);
   return OMX_ErrorNone;
@@ -196,6 +196,51 @@ tiz_vector_find (const tiz_vector_t * p_vec, const OMX_PTR ap_data)
     }
 }
 
+OMX_PTR
+tiz_vector_bsearch (const tiz_vector_t * p_vec, const OMX_PTR ap_key,
+                    tiz_pv_cmp_f apf_cmp)
+{
+  assert (p_vec);
+  assert (ap_key);
+  assert (apf_cmp);
+
+  if (0 == utarray_len (p_vec->p_uta))
+    {
+      return NULL;
+    }
+  return utarray_find (p_vec->p_uta, ap_key, apf_cmp);
+}
+
+OMX_ERRORTYPE
+tiz_vector_insert_sorted (tiz_vector_t * p_vec, OMX_PTR ap_data,
+                          tiz_pv_cmp_f apf_cmp)
+{
+  OMX_S32 lo = 0;
+  OMX_S32 hi = 0;
+
+  assert (p_vec);
+  assert (ap_data);
+  assert (apf_cmp);
+
+  /* Find the first element not less than ap_data */
+  hi = utarray_len (p_vec->p_uta);
+  while (lo < hi)
+    {
+      const OMX_S32 mid = lo + (hi - lo) / 2;
+      if (apf_cmp (utarray_eltptr (p_vec->p_uta, mid), ap_data) < 0)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  utarray_insert (p_vec->p_uta, ap_data, lo);
+  return OMX_ErrorNone;
+}
+
 OMX_ERRORTYPE
 tiz_vector_append (tiz_vector_t * p_dst, const tiz_vector_t * p_src)
 {
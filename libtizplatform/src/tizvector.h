@@ -44,6 +44,9 @@ typedef void (*tiz_pv_print_item_f) (OMX_PTR ap_data);
 /* debug function to dump an item */
 typedef void (*tiz_pv_dump_item_f) (OMX_PTR ap_data);
 
+/* qsort/bsearch-style comparison function */
+typedef int (*tiz_pv_cmp_f) (const void * ap_left, const void * ap_right);
+
 OMX_ERRORTYPE
 tiz_vector_init (tiz_vector_t ** app_vector, size_t a_elem_size);
 void
@@ -68,6 +71,12 @@ void
 tiz_vector_clear (tiz_vector_t * ap_vector);
 OMX_PTR
 tiz_vector_find (const tiz_vector_t * ap_vector, const OMX_PTR ap_data);
+OMX_PTR
+tiz_vector_bsearch (const tiz_vector_t * ap_vector, const OMX_PTR ap_key,
+                    tiz_pv_cmp_f apf_cmp);
+OMX_ERRORTYPE
+tiz_vector_insert_sorted (tiz_vector_t * ap_vector, OMX_PTR ap_data,
+                          tiz_pv_cmp_f apf_cmp);
 OMX_ERRORTYPE
 tiz_vector_append (tiz_vector_t * app_dst, const tiz_vector_t * app_src);
 OMX_ERRORTYPE
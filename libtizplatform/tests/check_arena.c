@@ -0,0 +1,166 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_arena.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Arena allocator unit tests
+ *
+ *
+ */
+
+#define ARENA_TEST_BLOCK_SZ 256
+#define ARENA_TEST_NUM_OBJS 64
+
+START_TEST (test_arena_basic_life_cycle)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_arena_t *p_arena = NULL;
+  uint8_t *objs[ARENA_TEST_NUM_OBJS];
+  tiz_arena_info_t info;
+  int i = 0;
+  size_t j = 0;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_arena_basic_life_cycle - begin");
+
+  error = tiz_arena_init (&p_arena, ARENA_TEST_BLOCK_SZ);
+  fail_if (error != OMX_ErrorNone);
+
+  /* Nothing is allocated until the first request */
+  tiz_arena_info (p_arena, &info);
+  fail_if (info.blocks != 0);
+  fail_if (info.objects != 0);
+
+  /* 16-byte objects: 16 of them fill a block */
+  for (i = 0; i < ARENA_TEST_NUM_OBJS; i++)
+    {
+      fail_if (NULL == (objs[i] = tiz_arena_calloc (p_arena, 10)));
+      fail_if (0 != ((uintptr_t) objs[i] % 16));
+      for (j = 0; j < 10; j++)
+        {
+          fail_if (objs[i][j] != 0);
+        }
+      memset (objs[i], 0xAB, 10);
+      fail_if (OMX_TRUE != tiz_arena_owns (p_arena, objs[i]));
+    }
+
+  tiz_arena_info (p_arena, &info);
+  fail_if (info.blocks != 4);
+  fail_if (info.objects != ARENA_TEST_NUM_OBJS);
+  fail_if (info.used != ARENA_TEST_NUM_OBJS * 16);
+  fail_if (info.capacity != 4 * ARENA_TEST_BLOCK_SZ);
+
+  /* Objects don't overlap */
+  for (i = 1; i < ARENA_TEST_NUM_OBJS; i++)
+    {
+      fail_if (objs[i] == objs[i - 1]);
+      fail_if (objs[i - 1][9] != 0xAB);
+    }
+
+  /* Reset keeps the first block only */
+  tiz_arena_reset (p_arena);
+  tiz_arena_info (p_arena, &info);
+  fail_if (info.blocks != 1);
+  fail_if (info.objects != 0);
+  fail_if (info.used != 0);
+  fail_if (info.resets != 1);
+  fail_if (OMX_FALSE != tiz_arena_owns (p_arena, objs[0]));
+
+  /* ... and hands out zeroed memory again */
+  fail_if (NULL == (objs[0] = tiz_arena_calloc (p_arena, 10)));
+  for (j = 0; j < 10; j++)
+    {
+      fail_if (objs[0][j] != 0);
+    }
+
+  tiz_arena_destroy (p_arena);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_arena_basic_life_cycle - end");
+}
+END_TEST
+
+START_TEST (test_arena_oversized_and_strndup)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_arena_t *p_arena = NULL;
+  uint8_t *p_small = NULL;
+  uint8_t *p_big = NULL;
+  uint8_t *p_small2 = NULL;
+  char *p_str = NULL;
+  tiz_arena_info_t info;
+  int local = 0;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_arena_oversized_and_strndup - begin");
+
+  error = tiz_arena_init (&p_arena, ARENA_TEST_BLOCK_SZ);
+  fail_if (error != OMX_ErrorNone);
+
+  fail_if (NULL == (p_small = tiz_arena_calloc (p_arena, 16)));
+  fail_if (NULL == (p_big = tiz_arena_calloc (p_arena,
+                                              4 * ARENA_TEST_BLOCK_SZ)));
+  fail_if (NULL == (p_small2 = tiz_arena_calloc (p_arena, 16)));
+
+  /* The oversized request did not retire the current block */
+  fail_if (p_small2 != p_small + 16);
+
+  tiz_arena_info (p_arena, &info);
+  fail_if (info.blocks != 2);
+  fail_if (info.objects != 3);
+
+  fail_if (OMX_TRUE != tiz_arena_owns (p_arena, p_big));
+  fail_if (OMX_TRUE != tiz_arena_owns (p_arena,
+                                       p_big + 4 * ARENA_TEST_BLOCK_SZ - 1));
+  fail_if (OMX_FALSE != tiz_arena_owns (p_arena, &local));
+
+  p_str = tiz_arena_strndup (p_arena, "icy-name: Radio", 8);
+  fail_if (NULL == p_str);
+  fail_if (0 != strcmp (p_str, "icy-name"));
+  p_str = tiz_arena_strndup (p_arena, "short", 64);
+  fail_if (NULL == p_str);
+  fail_if (0 != strcmp (p_str, "short"));
+
+  tiz_arena_reset (p_arena);
+  tiz_arena_info (p_arena, &info);
+  fail_if (info.blocks != 1);
+  fail_if (OMX_FALSE != tiz_arena_owns (p_arena, p_big));
+
+  /* An oversized first request leaves nothing to retain */
+  tiz_arena_destroy (p_arena);
+  error = tiz_arena_init (&p_arena, 0);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (NULL == tiz_arena_calloc (p_arena,
+                                     2 * TIZ_ARENA_DEFAULT_BLOCK_SIZE));
+  tiz_arena_reset (p_arena);
+  tiz_arena_info (p_arena, &info);
+  fail_if (info.blocks != 0);
+  fail_if (info.capacity != 0);
+
+  tiz_arena_destroy (p_arena);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_arena_oversized_and_strndup - end");
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
@@ -85,6 +85,49 @@ START_TEST (test_queue_send_and_receive)
 }
 END_TEST
 
+START_TEST (test_queue_try_send)
+{
+
+  OMX_U32 i;
+  OMX_PTR p_received = NULL;
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  int items[3] = {0, 1, 2};
+  tiz_queue_t *p_queue = NULL;
+
+  error = tiz_queue_init (&p_queue, 2);
+
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 0; i < 2; i++)
+    {
+      error = tiz_queue_try_send (p_queue, &items[i]);
+      fail_if (error != OMX_ErrorNone);
+    }
+
+  /* The queue is full; the item must be refused, not waited on */
+  error = tiz_queue_try_send (p_queue, &items[2]);
+  fail_if (error != OMX_ErrorOverflow);
+  fail_if (2 != tiz_queue_length (p_queue));
+
+  error = tiz_queue_receive (p_queue, &p_received);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (p_received != &items[0]);
+
+  error = tiz_queue_try_send (p_queue, &items[2]);
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 1; i < 3; i++)
+    {
+      error = tiz_queue_receive (p_queue, &p_received);
+      fail_if (error != OMX_ErrorNone);
+      fail_if (p_received != &items[i]);
+    }
+
+  tiz_queue_destroy (p_queue);
+
+}
+END_TEST
+
 /* Local Variables: */
 /* c-default-style: gnu */
 /* fill-column: 79 */
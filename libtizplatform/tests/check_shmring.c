@@ -0,0 +1,411 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_shmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Shared memory ring unit tests
+ *
+ *
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SHMRING_TEST_CAPACITY 4096
+#define SHMRING_TEST_RECORDS 20000
+
+static void
+shmring_test_name (char * ap_name, const size_t a_size, const char * ap_tag)
+{
+  snprintf (ap_name, a_size, "check-%s-%d", ap_tag, (int) getpid ());
+}
+
+/* Records carry their index, repeated */
+static size_t
+shmring_test_fill (uint32_t * ap_rec, const uint32_t a_index)
+{
+  const size_t nwords = 1 + a_index % 37;
+  size_t i = 0;
+  for (i = 0; i < nwords; ++i)
+    {
+      ap_rec[i] = a_index;
+    }
+  return nwords * sizeof (uint32_t);
+}
+
+static void
+shmring_test_check (const uint32_t * ap_rec, const size_t a_nbytes,
+                    const uint32_t a_index)
+{
+  size_t i = 0;
+  fail_if (a_nbytes != (1 + a_index % 37) * sizeof (uint32_t));
+  for (i = 0; i < a_nbytes / sizeof (uint32_t); ++i)
+    {
+      fail_if (ap_rec[i] != a_index);
+    }
+}
+
+START_TEST (test_shmring_create_open_and_destroy)
+{
+  tiz_shmring_t * p_writer = NULL;
+  tiz_shmring_t * p_reader = NULL;
+  char name[64];
+
+  shmring_test_name (name, sizeof (name), "lifecycle");
+
+  fail_if (OMX_ErrorBadParameter
+           != tiz_shmring_create (&p_writer, "../escape", 0));
+  fail_if (OMX_ErrorBadParameter != tiz_shmring_create (&p_writer, "", 0));
+  fail_if (OMX_ErrorNotReady != tiz_shmring_open (&p_reader, name));
+
+  fail_if (OMX_ErrorNone != tiz_shmring_create (&p_writer, name, 100));
+  fail_if (tiz_shmring_max_record (p_writer) < 1024);
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_reader, name));
+  fail_if (tiz_shmring_max_record (p_reader)
+           != tiz_shmring_max_record (p_writer));
+
+  /* Readers can't write */
+  fail_if (OMX_ErrorIncorrectStateOperation
+           != tiz_shmring_write (p_reader, name, 1, 0, 0));
+  fail_if (OMX_ErrorBadParameter
+           != tiz_shmring_write (p_writer, name,
+                                 tiz_shmring_max_record (p_writer) + 1, 0, 0));
+
+  tiz_shmring_destroy (p_reader);
+  tiz_shmring_destroy (p_writer);
+
+  /* The name goes away with the writer */
+  fail_if (OMX_ErrorNotReady != tiz_shmring_open (&p_reader, name));
+}
+END_TEST
+
+START_TEST (test_shmring_write_and_read)
+{
+  tiz_shmring_t * p_writer = NULL;
+  tiz_shmring_t * p_ring = NULL;
+  tiz_shmring_stats_t stats;
+  uint32_t rec[64];
+  uint32_t out[64];
+  char name[64];
+  int readers[2];
+  size_t nbytes = 0;
+  OMX_U32 flags = 0;
+  OMX_BOOL end = OMX_FALSE;
+  uint32_t i = 0;
+  int r = 0;
+
+  shmring_test_name (name, sizeof (name), "readwrite");
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_create (&p_writer, name, SHMRING_TEST_CAPACITY));
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_ring, name));
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_attach (p_ring, ETIZShmringPolicyBackpressure,
+                                  &readers[0]));
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_attach (p_ring, ETIZShmringPolicyBackpressure,
+                                  &readers[1]));
+  fail_if (readers[0] == readers[1]);
+
+  fail_if (OMX_ErrorNotReady
+           != tiz_shmring_read (p_ring, readers[0], out, sizeof (out), &nbytes,
+                                &flags, &end, 0));
+  fail_if (OMX_ErrorNotReady != tiz_shmring_wait (p_ring, readers[0], 10));
+
+  /* Many times the capacity of the ring, so that records wrap around */
+  for (i = 0; i < 2000; ++i)
+    {
+      nbytes = shmring_test_fill (rec, i);
+      fail_if (OMX_ErrorNone
+               != tiz_shmring_write (p_writer, rec, nbytes, i, 0));
+      fail_if (OMX_ErrorNone != tiz_shmring_wait (p_ring, readers[0], 0));
+      for (r = 0; r < 2; ++r)
+        {
+          fail_if (OMX_ErrorNone
+                   != tiz_shmring_read (p_ring, readers[r], out, sizeof (out),
+                                        &nbytes, &flags, &end, 0));
+          shmring_test_check (out, nbytes, i);
+          fail_if (flags != i || OMX_TRUE != end);
+        }
+    }
+
+  /* A record larger than the destination buffer is read in parts, and the
+     flags come with the last one */
+  nbytes = shmring_test_fill (rec, 36);
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_write (p_writer, rec, nbytes, OMX_BUFFERFLAG_EOS, 0));
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_read (p_ring, readers[0], out, 100, &nbytes, &flags,
+                                &end, 0));
+  fail_if (100 != nbytes || 0 != flags || OMX_FALSE != end);
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_read (p_ring, readers[0], (uint8_t *) out + 100, 100,
+                                &nbytes, &flags, &end, 0));
+  fail_if (48 != nbytes || OMX_BUFFERFLAG_EOS != flags || OMX_TRUE != end);
+  shmring_test_check (out, 148, 36);
+
+  fail_if (OMX_ErrorNone != tiz_shmring_stats (p_writer, readers[0], &stats));
+  fail_if (2001 != stats.written_records || 2001 != stats.read_records);
+  fail_if (0 != stats.lag_bytes || 0 != stats.dropped_records);
+  fail_if (OMX_ErrorNone != tiz_shmring_stats (p_writer, readers[1], &stats));
+  fail_if (0 == stats.lag_bytes || 2000 != stats.read_records);
+
+  tiz_shmring_detach (p_ring, readers[1]);
+  fail_if (OMX_ErrorNoMore != tiz_shmring_stats (p_writer, readers[1], &stats));
+
+  /* Once the writer is gone, readers get what was left, and then NoMore */
+  nbytes = shmring_test_fill (rec, 7);
+  fail_if (OMX_ErrorNone != tiz_shmring_write (p_writer, rec, nbytes, 0, 0));
+  tiz_shmring_destroy (p_writer);
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_read (p_ring, readers[0], out, sizeof (out), &nbytes,
+                                &flags, &end, -1));
+  shmring_test_check (out, nbytes, 7);
+  fail_if (OMX_ErrorNoMore
+           != tiz_shmring_read (p_ring, readers[0], out, sizeof (out), &nbytes,
+                                &flags, &end, -1));
+
+  tiz_shmring_destroy (p_ring);
+}
+END_TEST
+
+typedef struct shmring_test_reader shmring_test_reader_t;
+struct shmring_test_reader
+{
+  tiz_shmring_t * p_ring;
+  int reader;
+  uint32_t nrecords;
+  bool in_order;
+};
+
+static void *
+shmring_test_reader_thread (void * ap_arg)
+{
+  shmring_test_reader_t * p_rdr = ap_arg;
+  uint32_t out[64];
+  size_t nbytes = 0;
+  OMX_U32 flags = 0;
+  OMX_BOOL end = OMX_FALSE;
+  uint32_t expected = 0;
+  p_rdr->in_order = true;
+  while (OMX_ErrorNone
+         == tiz_shmring_read (p_rdr->p_ring, p_rdr->reader, out, sizeof (out),
+                              &nbytes, &flags, &end, -1))
+    {
+      if (nbytes < sizeof (uint32_t) || out[0] < expected)
+        {
+          p_rdr->in_order = false;
+        }
+      expected = out[0] + 1;
+      p_rdr->nrecords++;
+    }
+  return NULL;
+}
+
+START_TEST (test_shmring_backpressure)
+{
+  tiz_shmring_t * p_writer = NULL;
+  tiz_shmring_t * p_ring = NULL;
+  shmring_test_reader_t rdr;
+  pthread_t thread;
+  uint32_t rec[64];
+  uint32_t out[64];
+  char name[64];
+  size_t nbytes = 0;
+  OMX_U32 flags = 0;
+  OMX_BOOL end = OMX_FALSE;
+  uint32_t i = 0;
+
+  shmring_test_name (name, sizeof (name), "backpressure");
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_create (&p_writer, name, SHMRING_TEST_CAPACITY));
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_ring, name));
+  memset (&rdr, 0, sizeof (rdr));
+  rdr.p_ring = p_ring;
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_attach (p_ring, ETIZShmringPolicyBackpressure,
+                                  &rdr.reader));
+
+  /* The writer stops when the reader is a full ring behind */
+  for (i = 0; i < SHMRING_TEST_CAPACITY; ++i)
+    {
+      nbytes = shmring_test_fill (rec, 0);
+      if (OMX_ErrorNone != tiz_shmring_write (p_writer, rec, nbytes, 0, 0))
+        {
+          break;
+        }
+    }
+  fail_if (0 == i || SHMRING_TEST_CAPACITY == i);
+  fail_if (OMX_ErrorNotReady
+           != tiz_shmring_write (p_writer, rec, nbytes, 0, 10));
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_read (p_ring, rdr.reader, out, sizeof (out), &nbytes,
+                                &flags, &end, 0));
+  fail_if (OMX_ErrorNone != tiz_shmring_write (p_writer, rec, nbytes, 0, 0));
+  while (OMX_ErrorNone
+         == tiz_shmring_read (p_ring, rdr.reader, out, sizeof (out), &nbytes,
+                              &flags, &end, 0))
+    {
+    }
+
+  /* Nothing is lost with a concurrent reader */
+  fail_if (0
+           != pthread_create (&thread, NULL, shmring_test_reader_thread,
+                              &rdr));
+  for (i = 0; i < SHMRING_TEST_RECORDS; ++i)
+    {
+      nbytes = shmring_test_fill (rec, i);
+      fail_if (OMX_ErrorNone
+               != tiz_shmring_write (p_writer, rec, nbytes, 0, -1));
+    }
+  tiz_shmring_destroy (p_writer);
+  fail_if (0 != pthread_join (thread, NULL));
+  fail_if (SHMRING_TEST_RECORDS != rdr.nrecords);
+  fail_if (!rdr.in_order);
+
+  tiz_shmring_destroy (p_ring);
+}
+END_TEST
+
+START_TEST (test_shmring_drop_oldest)
+{
+  tiz_shmring_t * p_writer = NULL;
+  tiz_shmring_t * p_ring = NULL;
+  tiz_shmring_stats_t stats;
+  uint32_t rec[64];
+  uint32_t out[64];
+  char name[64];
+  int slow = -1;
+  size_t nbytes = 0;
+  OMX_U32 flags = 0;
+  OMX_BOOL end = OMX_FALSE;
+  uint32_t last = 0;
+  uint32_t nread = 0;
+  uint32_t i = 0;
+
+  shmring_test_name (name, sizeof (name), "dropoldest");
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_create (&p_writer, name, SHMRING_TEST_CAPACITY));
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_ring, name));
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_attach (p_ring, ETIZShmringPolicyDropOldest, &slow));
+
+  /* A reader that falls behind does not hold the writer back... */
+  for (i = 0; i < 1000; ++i)
+    {
+      nbytes = shmring_test_fill (rec, i);
+      fail_if (OMX_ErrorNone
+               != tiz_shmring_write (p_writer, rec, nbytes, 0, 0));
+    }
+
+  /* ... it loses the oldest records, and reads the rest in order */
+  fail_if (OMX_ErrorNone != tiz_shmring_stats (p_ring, slow, &stats));
+  fail_if (stats.lag_bytes <= SHMRING_TEST_CAPACITY);
+  while (OMX_ErrorNone
+         == tiz_shmring_read (p_ring, slow, out, sizeof (out), &nbytes, &flags,
+                              &end, 0))
+    {
+      fail_if (nread > 0 && out[0] != last + 1);
+      shmring_test_check (out, nbytes, out[0]);
+      last = out[0];
+      nread++;
+    }
+  fail_if (999 != last);
+  fail_if (0 == nread || 1000 == nread);
+
+  fail_if (OMX_ErrorNone != tiz_shmring_stats (p_ring, slow, &stats));
+  fail_if (1 != stats.overruns);
+  fail_if (0 != stats.lag_bytes);
+  fail_if (0 == stats.dropped_bytes);
+  fail_if (nread != stats.read_records);
+  fail_if (1000 != stats.dropped_records + nread);
+
+  tiz_shmring_destroy (p_writer);
+  fail_if (OMX_ErrorNoMore
+           != tiz_shmring_read (p_ring, slow, out, sizeof (out), &nbytes,
+                                &flags, &end, 0));
+
+  tiz_shmring_destroy (p_ring);
+}
+END_TEST
+
+START_TEST (test_shmring_drop_oldest_torn_record)
+{
+  tiz_shmring_t * p_writer = NULL;
+  tiz_shmring_t * p_ring = NULL;
+  uint32_t rec[64];
+  uint32_t out[64];
+  char name[64];
+  int slow = -1;
+  size_t nbytes = 0;
+  OMX_U32 flags = 0;
+  OMX_BOOL end = OMX_FALSE;
+  uint32_t i = 0;
+
+  shmring_test_name (name, sizeof (name), "torn");
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_create (&p_writer, name, SHMRING_TEST_CAPACITY));
+  fail_if (OMX_ErrorNone != tiz_shmring_open (&p_ring, name));
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_attach (p_ring, ETIZShmringPolicyDropOldest, &slow));
+
+  /* Read the first part of a record... */
+  nbytes = shmring_test_fill (rec, 36);
+  fail_if (OMX_ErrorNone != tiz_shmring_write (p_writer, rec, nbytes, 0, 0));
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_read (p_ring, slow, out, 16, &nbytes, &flags, &end,
+                                0));
+  fail_if (16 != nbytes || OMX_FALSE != end);
+
+  /* ... then let the writer overtake the reader */
+  for (i = 37; i < 1000; ++i)
+    {
+      nbytes = shmring_test_fill (rec, i);
+      fail_if (OMX_ErrorNone
+               != tiz_shmring_write (p_writer, rec, nbytes, 0, 0));
+    }
+
+  /* The reader is told that the record it started will not be completed */
+  fail_if (OMX_ErrorOverflow
+           != tiz_shmring_read (p_ring, slow, out, sizeof (out), &nbytes,
+                                &flags, &end, 0));
+  fail_if (0 != nbytes);
+
+  /* ... and then carries on with whole records */
+  fail_if (OMX_ErrorNone
+           != tiz_shmring_read (p_ring, slow, out, sizeof (out), &nbytes,
+                                &flags, &end, 0));
+  fail_if (OMX_TRUE != end);
+  fail_if (out[0] <= 36);
+  shmring_test_check (out, nbytes, out[0]);
+
+  tiz_shmring_destroy (p_writer);
+  tiz_shmring_destroy (p_ring);
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
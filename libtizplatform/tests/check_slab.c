@@ -0,0 +1,210 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_slab.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Slab allocator unit tests
+ *
+ *
+ */
+
+#include <pthread.h>
+
+#define SLAB_TEST_NUM_OBJS 4096
+#define SLAB_TEST_XTHREAD_OBJS 100000
+#define SLAB_TEST_XTHREAD_PRODUCERS 3
+
+START_TEST (test_slab_basic_life_cycle)
+{
+  static uint8_t *objs[SLAB_TEST_NUM_OBJS];
+  tiz_slab_info_t before;
+  tiz_slab_info_t info;
+  size_t size = 0;
+  size_t j = 0;
+  int i = 0;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_slab_basic_life_cycle - begin");
+
+  tiz_slab_thread_flush ();
+  tiz_slab_info (&before);
+
+  /* Sizes from 1 to TIZ_SLAB_MAX_SIZE bytes, i.e. every class */
+  for (i = 0; i < SLAB_TEST_NUM_OBJS; i++)
+    {
+      size = 1 + (i * 7) % TIZ_SLAB_MAX_SIZE;
+      fail_if (NULL == (objs[i] = tiz_slab_calloc (size)));
+      fail_if (0 != ((uintptr_t) objs[i] % 16));
+      for (j = 0; j < size; j++)
+        {
+          fail_if (objs[i][j] != 0);
+        }
+      memset (objs[i], 0xCD, size);
+    }
+
+  tiz_slab_info (&info);
+  fail_if (info.objects < before.objects + SLAB_TEST_NUM_OBJS);
+  fail_if (info.chunks <= before.chunks);
+  for (i = 0; i < TIZ_SLAB_NUM_CLASSES; i++)
+    {
+      fail_if (info.classes[i].size == 0);
+      fail_if (i > 0 && info.classes[i].size <= info.classes[i - 1].size);
+    }
+  fail_if (info.classes[TIZ_SLAB_NUM_CLASSES - 1].size != TIZ_SLAB_MAX_SIZE);
+
+  for (i = 0; i < SLAB_TEST_NUM_OBJS; i++)
+    {
+      size = 1 + (i * 7) % TIZ_SLAB_MAX_SIZE;
+      fail_if (objs[i][size - 1] != 0xCD);
+      tiz_slab_free (objs[i]);
+    }
+  tiz_slab_free (NULL);
+
+  /* Everything is back in the depots once this thread's magazines are
+     flushed; after a trim, the chunks are gone too */
+  tiz_slab_thread_flush ();
+  tiz_slab_info (&info);
+  fail_if (info.objects != before.objects);
+  fail_if (info.classes[0].allocs < before.classes[0].allocs + 1);
+
+  tiz_slab_trim ();
+  tiz_slab_info (&info);
+  fail_if (info.chunks > before.chunks);
+  for (i = 0; i < TIZ_SLAB_NUM_CLASSES; i++)
+    {
+      fail_if (info.classes[i].chunks_released
+               < before.classes[i].chunks_released);
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_slab_basic_life_cycle - end");
+}
+END_TEST
+
+START_TEST (test_slab_large_objects)
+{
+  tiz_slab_info_t before;
+  tiz_slab_info_t info;
+  uint8_t *p_obj = NULL;
+  size_t j = 0;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_slab_large_objects - begin");
+
+  tiz_slab_info (&before);
+  fail_if (NULL == (p_obj = tiz_slab_calloc (TIZ_SLAB_MAX_SIZE + 1)));
+  for (j = 0; j < TIZ_SLAB_MAX_SIZE + 1; j++)
+    {
+      fail_if (p_obj[j] != 0);
+    }
+  tiz_slab_info (&info);
+  fail_if (info.large_allocs != before.large_allocs + 1);
+  fail_if (info.objects != before.objects);
+
+  tiz_slab_free (p_obj);
+  tiz_slab_info (&info);
+  fail_if (info.large_frees != before.large_frees + 1);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_slab_large_objects - end");
+}
+END_TEST
+
+static void *
+slab_producer_thread (void *ap_arg)
+{
+  tiz_queue_t *p_q = ap_arg;
+  int i = 0;
+  for (i = 0; i < SLAB_TEST_XTHREAD_OBJS; i++)
+    {
+      uint32_t *p_obj = tiz_slab_calloc (8 + (i % 200));
+      if (p_obj)
+        {
+          *p_obj = 0xfeedbeef;
+        }
+      (void) tiz_queue_send (p_q, p_obj);
+    }
+  return NULL;
+}
+
+static void *
+slab_consumer_thread (void *ap_arg)
+{
+  tiz_queue_t *p_q = ap_arg;
+  OMX_PTR p_data = NULL;
+  intptr_t bad = 0;
+  int i = 0;
+  for (i = 0; i < SLAB_TEST_XTHREAD_OBJS * SLAB_TEST_XTHREAD_PRODUCERS; i++)
+    {
+      (void) tiz_queue_receive (p_q, &p_data);
+      if (!p_data || *(uint32_t *) p_data != 0xfeedbeef)
+        {
+          ++bad;
+        }
+      tiz_slab_free (p_data);
+    }
+  return (void *) bad;
+}
+
+/* Objects allocated on some threads and freed on another one; the magazines
+   of exiting threads go back to the depots */
+START_TEST (test_slab_cross_thread_free)
+{
+  tiz_queue_t *p_q = NULL;
+  pthread_t producers[SLAB_TEST_XTHREAD_PRODUCERS];
+  pthread_t consumer;
+  tiz_slab_info_t before;
+  tiz_slab_info_t info;
+  void *p_bad = NULL;
+  int i = 0;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_slab_cross_thread_free - begin");
+
+  fail_if (OMX_ErrorNone != tiz_queue_init (&p_q, 64));
+  tiz_slab_thread_flush ();
+  tiz_slab_info (&before);
+
+  fail_if (0 != pthread_create (&consumer, NULL, slab_consumer_thread, p_q));
+  for (i = 0; i < SLAB_TEST_XTHREAD_PRODUCERS; i++)
+    {
+      fail_if (0 != pthread_create (&producers[i], NULL, slab_producer_thread,
+                                    p_q));
+    }
+  for (i = 0; i < SLAB_TEST_XTHREAD_PRODUCERS; i++)
+    {
+      pthread_join (producers[i], NULL);
+    }
+  pthread_join (consumer, &p_bad);
+  fail_if (NULL != p_bad);
+
+  tiz_slab_info (&info);
+  fail_if (info.objects != before.objects);
+  fail_if (info.classes[1].frees - before.classes[1].frees
+           != info.classes[1].allocs - before.classes[1].allocs);
+
+  tiz_queue_destroy (p_q);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_slab_cross_thread_free - end");
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
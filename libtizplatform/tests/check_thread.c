@@ -0,0 +1,60 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_thread.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Thread attributes API unit tests
+ *
+ *
+ */
+
+#include <pthread.h>
+
+START_TEST (test_thread_setschedparam)
+{
+  tiz_thread_t thread = pthread_self ();
+
+  fail_if (OMX_ErrorNone != tiz_thread_setschedparam (&thread, "other", 0));
+  fail_if (OMX_ErrorBadParameter
+           != tiz_thread_setschedparam (&thread, "unknown", 0));
+  /* Real-time policies need a priority > 0 */
+  fail_if (OMX_ErrorBadParameter
+           != tiz_thread_setschedparam (&thread, "fifo", 0));
+}
+END_TEST
+
+START_TEST (test_thread_setaffinity)
+{
+  tiz_thread_t thread = pthread_self ();
+
+  fail_if (OMX_ErrorNone != tiz_thread_setaffinity (&thread, "0"));
+  fail_if (OMX_ErrorBadParameter != tiz_thread_setaffinity (&thread, "0-"));
+  fail_if (OMX_ErrorBadParameter != tiz_thread_setaffinity (&thread, "1-0"));
+  fail_if (OMX_ErrorBadParameter != tiz_thread_setaffinity (&thread, "a"));
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
@@ -48,9 +48,15 @@
 #include "./check_vector.c"
 #include "./check_rc.c"
 #include "./check_soa.c"
+#include "./check_arena.c"
+#include "./check_slab.c"
 #include "./check_event.c"
 #include "./check_http_parser.c"
 #include "./check_map.c"
+#include "./check_thread.c"
+#include "./check_shmring.c"
+#include "./check_urltrans.c"
+#include "./check_urlcache.c"
 
 #define EVENT_API_TEST_TIMEOUT 100
 
@@ -103,6 +109,7 @@ platform_queue_suite (void)
   tc_queue = tcase_create ("queue");
   tcase_add_test (tc_queue, test_queue_init_and_destroy);
   tcase_add_test (tc_queue, test_queue_send_and_receive);
+  tcase_add_test (tc_queue, test_queue_try_send);
   suite_add_tcase (s, tc_queue);
 
   return s;
@@ -140,6 +147,7 @@ platform_vector_suite (void)
   tcase_add_test (tc_vector, test_vector_push_and_pop_length_front_back_ints);
   tcase_add_test (tc_vector, test_vector_push_and_pop_length_front_back_pointers);
   tcase_add_test (tc_vector, test_vector_push_back_vector);
+  tcase_add_test (tc_vector, test_vector_insert_sorted_and_bsearch);
   suite_add_tcase (s, tc_vector);
 
   return s;
@@ -178,6 +186,37 @@ platform_soa_suite (void)
   return s;
 }
 
+Suite *
+platform_arena_suite (void)
+{
+  TCase *tc_arena = NULL;
+  Suite *s = suite_create ("Arena allocation APIs");
+
+  /* arena allocation API test cases */
+  tc_arena = tcase_create ("arena");
+  tcase_add_test (tc_arena, test_arena_basic_life_cycle);
+  tcase_add_test (tc_arena, test_arena_oversized_and_strndup);
+  suite_add_tcase (s, tc_arena);
+
+  return s;
+}
+
+Suite *
+platform_slab_suite (void)
+{
+  TCase *tc_slab = NULL;
+  Suite *s = suite_create ("Slab allocation APIs");
+
+  /* slab allocation API test cases */
+  tc_slab = tcase_create ("slab");
+  tcase_add_test (tc_slab, test_slab_basic_life_cycle);
+  tcase_add_test (tc_slab, test_slab_large_objects);
+  tcase_add_test (tc_slab, test_slab_cross_thread_free);
+  suite_add_tcase (s, tc_slab);
+
+  return s;
+}
+
 Suite *
 platform_event_suite (void)
 {
@@ -227,6 +266,63 @@ platform_map_suite (void)
 
 }
 
+Suite *
+platform_thread_suite (void)
+{
+  TCase  *tc_thread;
+  Suite *s = suite_create ("thread");
+
+  /* thread attributes API test cases */
+  tc_thread = tcase_create ("thread attributes API");
+  tcase_add_test (tc_thread, test_thread_setschedparam);
+  tcase_add_test (tc_thread, test_thread_setaffinity);
+  suite_add_tcase (s, tc_thread);
+
+  return s;
+}
+
+Suite *
+platform_shmring_suite (void)
+{
+  TCase  *tc_shmring;
+  Suite *s = suite_create ("shmring");
+
+  /* shared memory ring API test cases */
+  tc_shmring = tcase_create ("shared memory ring API");
+  tcase_add_test (tc_shmring, test_shmring_create_open_and_destroy);
+  tcase_add_test (tc_shmring, test_shmring_write_and_read);
+  tcase_add_test (tc_shmring, test_shmring_backpressure);
+  tcase_add_test (tc_shmring, test_shmring_drop_oldest);
+  tcase_add_test (tc_shmring, test_shmring_drop_oldest_torn_record);
+  suite_add_tcase (s, tc_shmring);
+
+  return s;
+}
+
+Suite *
+platform_urltrans_suite (void)
+{
+  TCase  *tc_urltrans;
+  Suite *s = suite_create ("urltrans");
+
+  /* range request header test cases */
+  tc_urltrans = tcase_create ("range request headers");
+  tcase_add_test (tc_urltrans, test_urltrans_range_first_segment);
+  tcase_add_test (tc_urltrans, test_urltrans_range_resumed);
+  tcase_add_test (tc_urltrans, test_urltrans_range_ignored);
+  tcase_add_test (tc_urltrans, test_urltrans_range_mismatch);
+  suite_add_tcase (s, tc_urltrans);
+
+  /* on-disk cache test cases */
+  tc_urltrans = tcase_create ("on-disk cache");
+  tcase_add_test (tc_urltrans, test_urlcache_range_merge);
+  tcase_add_test (tc_urltrans, test_urlcache_index);
+  tcase_add_test (tc_urltrans, test_urlcache_eviction);
+  suite_add_tcase (s, tc_urltrans);
+
+  return s;
+}
+
 int
 main (void)
 {
@@ -244,8 +340,13 @@ main (void)
   srunner_add_suite (sr, platform_vector_suite ());
   srunner_add_suite (sr, platform_rcfile_suite ());
   srunner_add_suite (sr, platform_soa_suite ());
+  srunner_add_suite (sr, platform_arena_suite ());
+  srunner_add_suite (sr, platform_slab_suite ());
   srunner_add_suite (sr, platform_http_parser_suite ());
   srunner_add_suite (sr, platform_map_suite ());
+  srunner_add_suite (sr, platform_thread_suite ());
+  srunner_add_suite (sr, platform_shmring_suite ());
+  srunner_add_suite (sr, platform_urltrans_suite ());
 /*   srunner_add_suite (sr, platform_event_suite ()); */
   srunner_run_all (sr, CK_VERBOSE);
   number_failed = srunner_ntests_failed (sr);
@@ -0,0 +1,226 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_urlcache.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  On-disk cache of streamed resources unit tests
+ *
+ *
+ */
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../src/tizurlcache.h"
+
+#define URLCACHE_TEST_BUDGET (64 * 1024 * 1024)
+#define URLCACHE_TEST_CHUNK 65536
+
+static void
+urlcache_test_dir (char * ap_dir, const size_t a_size)
+{
+  snprintf (ap_dir, a_size, "/tmp/check-urlcache-XXXXXX");
+  fail_if (NULL == mkdtemp (ap_dir));
+}
+
+/* Returns the number of data files in the directory, and the path of the
+   last one found */
+static int
+urlcache_test_count (const char * ap_dir, char * ap_path, const size_t a_size)
+{
+  struct dirent * p_entry = NULL;
+  DIR * p_dir = opendir (ap_dir);
+  int count = 0;
+  fail_if (NULL == p_dir);
+  while ((p_entry = readdir (p_dir)))
+    {
+      const char * p_ext = strrchr (p_entry->d_name, '.');
+      if (p_ext && 0 == strcmp (p_ext, ".data"))
+        {
+          if (ap_path)
+            {
+              snprintf (ap_path, a_size, "%s/%s", ap_dir, p_entry->d_name);
+            }
+          ++count;
+        }
+    }
+  closedir (p_dir);
+  return count;
+}
+
+static void
+urlcache_test_cleanup (const char * ap_dir)
+{
+  struct dirent * p_entry = NULL;
+  DIR * p_dir = opendir (ap_dir);
+  fail_if (NULL == p_dir);
+  while ((p_entry = readdir (p_dir)))
+    {
+      char path[PATH_MAX];
+      if ('.' != p_entry->d_name[0])
+        {
+          snprintf (path, sizeof (path), "%s/%s", ap_dir, p_entry->d_name);
+          (void) unlink (path);
+        }
+    }
+  closedir (p_dir);
+  fail_if (0 != rmdir (ap_dir));
+}
+
+static void
+urlcache_test_write (tiz_urlcache_t * ap_cache, const OMX_U64 a_start,
+                     const OMX_U64 a_end)
+{
+  char data[1024];
+  OMX_U64 offset = a_start;
+  memset (data, 'x', sizeof (data));
+  while (offset < a_end)
+    {
+      const size_t len = MIN (sizeof (data), (size_t) (a_end - offset));
+      tiz_urlcache_write (ap_cache, offset, data, len);
+      offset += len;
+    }
+}
+
+START_TEST (test_urlcache_range_merge)
+{
+  char dir[PATH_MAX];
+  tiz_urlcache_t * p_cache = NULL;
+
+  urlcache_test_dir (dir, sizeof (dir));
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_open (&p_cache, dir, "check:merge",
+                                 URLCACHE_TEST_BUDGET));
+
+  /* Touching ranges are merged, whatever the order they arrive in */
+  urlcache_test_write (p_cache, 0, 100);
+  urlcache_test_write (p_cache, 200, 300);
+  fail_if (100 != tiz_urlcache_available (p_cache, 0));
+  fail_if (0 != tiz_urlcache_available (p_cache, 100));
+  urlcache_test_write (p_cache, 100, 200);
+  fail_if (300 != tiz_urlcache_available (p_cache, 0));
+  fail_if (150 != tiz_urlcache_available (p_cache, 150));
+
+  /* A hole is left alone, and a range that overlaps it and its neighbours
+     swallows them */
+  urlcache_test_write (p_cache, 500, 600);
+  fail_if (0 != tiz_urlcache_available (p_cache, 300));
+  fail_if (50 != tiz_urlcache_available (p_cache, 550));
+  urlcache_test_write (p_cache, 250, 550);
+  fail_if (600 != tiz_urlcache_available (p_cache, 0));
+  fail_if (0 != tiz_urlcache_available (p_cache, 600));
+
+  /* Complete once the total size is known and covered */
+  fail_if (tiz_urlcache_is_complete (p_cache));
+  tiz_urlcache_store_header (p_cache, "HTTP/1.1 200 OK\r\n", 17);
+  tiz_urlcache_store_header (p_cache, "Content-Length: 600\r\n", 21);
+  fail_if (600 != tiz_urlcache_total (p_cache));
+  fail_if (!tiz_urlcache_is_complete (p_cache));
+
+  tiz_urlcache_close (p_cache);
+  urlcache_test_cleanup (dir);
+}
+END_TEST
+
+START_TEST (test_urlcache_index)
+{
+  char dir[PATH_MAX];
+  char path[PATH_MAX];
+  char buf[16];
+  tiz_urlcache_t * p_cache = NULL;
+
+  urlcache_test_dir (dir, sizeof (dir));
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_open (&p_cache, dir, "check:index",
+                                 URLCACHE_TEST_BUDGET));
+  tiz_urlcache_store_header (p_cache, "HTTP/1.1 206 Partial Content\r\n", 31);
+  tiz_urlcache_store_header (p_cache, "Content-Type: audio/mpeg\r\n", 26);
+  tiz_urlcache_store_header (p_cache, "Content-Length: 4000\r\n", 22);
+  urlcache_test_write (p_cache, 0, 1000);
+  urlcache_test_write (p_cache, 2000, 3000);
+  tiz_urlcache_close (p_cache);
+
+  /* The index is read back */
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_open (&p_cache, dir, "check:index",
+                                 URLCACHE_TEST_BUDGET));
+  fail_if (4000 != tiz_urlcache_total (p_cache));
+  fail_if (0
+           != strcmp (tiz_urlcache_headers (p_cache),
+                      "Content-Type: audio/mpeg\r\n"));
+  fail_if (1000 != tiz_urlcache_available (p_cache, 0));
+  fail_if (0 != tiz_urlcache_available (p_cache, 1000));
+  fail_if (500 != tiz_urlcache_available (p_cache, 2500));
+  fail_if (sizeof (buf) != tiz_urlcache_read (p_cache, 2000, buf, sizeof (buf)));
+  fail_if ('x' != buf[0] || 'x' != buf[sizeof (buf) - 1]);
+  tiz_urlcache_close (p_cache);
+
+  /* Ranges past the end of the data file are not trusted */
+  fail_if (1 != urlcache_test_count (dir, path, sizeof (path)));
+  fail_if (0 != truncate (path, 2500));
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_open (&p_cache, dir, "check:index",
+                                 URLCACHE_TEST_BUDGET));
+  fail_if (1000 != tiz_urlcache_available (p_cache, 0));
+  fail_if (0 != tiz_urlcache_available (p_cache, 2000));
+  tiz_urlcache_close (p_cache);
+
+  /* A content length that changes invalidates what was cached */
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_open (&p_cache, dir, "check:index",
+                                 URLCACHE_TEST_BUDGET));
+  tiz_urlcache_store_header (p_cache, "HTTP/1.1 200 OK\r\n", 17);
+  tiz_urlcache_store_header (p_cache, "Content-Length: 5000\r\n", 22);
+  fail_if (5000 != tiz_urlcache_total (p_cache));
+  fail_if (0 != tiz_urlcache_available (p_cache, 0));
+  tiz_urlcache_close (p_cache);
+
+  urlcache_test_cleanup (dir);
+}
+END_TEST
+
+START_TEST (test_urlcache_eviction)
+{
+  char dir[PATH_MAX];
+  tiz_urlcache_t * p_used = NULL;
+  tiz_urlcache_t * p_cache = NULL;
+
+  urlcache_test_dir (dir, sizeof (dir));
+
+  /* An entry that is open is not evicted, however old it is */
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_open (&p_used, dir, "check:used", 1));
+  urlcache_test_write (p_used, 0, URLCACHE_TEST_CHUNK);
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_open (&p_cache, dir, "check:other", 1));
+  urlcache_test_write (p_cache, 0, URLCACHE_TEST_CHUNK);
+  tiz_urlcache_close (p_cache);
+  fail_if (1 != urlcache_test_count (dir, NULL, 0));
+  fail_if (URLCACHE_TEST_CHUNK != tiz_urlcache_available (p_used, 0));
+
+  /* Once closed, it goes too */
+  tiz_urlcache_close (p_used);
+  fail_if (0 != urlcache_test_count (dir, NULL, 0));
+
+  urlcache_test_cleanup (dir);
+}
+END_TEST
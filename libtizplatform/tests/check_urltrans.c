@@ -0,0 +1,159 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_urltrans.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  URL transfer range header unit tests
+ *
+ *
+ */
+
+#include <string.h>
+
+#include "../src/tizplatform_internal.h"
+
+static bool
+urltrans_test_header (tiz_urltrans_range_t * ap_range, const char * ap_header,
+                      char * ap_length, const size_t a_length_size)
+{
+  return tiz_urltrans_process_range_header (ap_range, ap_header,
+                                            strlen (ap_header), ap_length,
+                                            a_length_size);
+}
+
+static void
+urltrans_test_init (tiz_urltrans_range_t * ap_range, const long long a_offset)
+{
+  ap_range->resume_offset = a_offset;
+  ap_range->partial = false;
+  ap_range->skip_bytes = 0;
+  ap_range->total_bytes = -1;
+  ap_range->next_offset = a_offset;
+}
+
+START_TEST (test_urltrans_range_first_segment)
+{
+  tiz_urltrans_range_t range;
+  char length[64];
+
+  urltrans_test_init (&range, 0);
+
+  /* The status line is forwarded */
+  fail_if (urltrans_test_header (&range, "HTTP/1.1 206 Partial Content\r\n",
+                                 length, sizeof (length)));
+  fail_if (!range.partial);
+  fail_if (0 != range.skip_bytes);
+  fail_if ('\0' != length[0]);
+
+  /* The Content-Length of the range is dropped */
+  fail_if (!urltrans_test_header (&range, "Content-Length: 524288\r\n", length,
+                                  sizeof (length)));
+  fail_if ('\0' != length[0]);
+
+  /* Content-Range is forwarded with the length of the whole resource */
+  fail_if (!urltrans_test_header (
+    &range, "Content-Range: bytes 0-524287/3000000\r\n", length,
+    sizeof (length)));
+  fail_if (0 != strcmp (length, "Content-Length: 3000000\r\n"));
+  fail_if (3000000 != range.total_bytes);
+  fail_if (524288 != range.next_offset);
+
+  /* Other headers are forwarded */
+  fail_if (urltrans_test_header (&range, "Content-Type: audio/mpeg\r\n",
+                                 length, sizeof (length)));
+  fail_if ('\0' != length[0]);
+}
+END_TEST
+
+START_TEST (test_urltrans_range_resumed)
+{
+  tiz_urltrans_range_t range;
+  char length[64];
+
+  urltrans_test_init (&range, 1000);
+
+  fail_if (urltrans_test_header (&range, "http/1.1 206 Partial Content\r\n",
+                                 length, sizeof (length)));
+  fail_if (!range.partial);
+
+  /* The client has the headers already; no Content-Length is produced */
+  fail_if (!urltrans_test_header (&range, "content-range: bytes 1000-1999/5000",
+                                  length, sizeof (length)));
+  fail_if ('\0' != length[0]);
+  fail_if (5000 != range.total_bytes);
+  fail_if (2000 != range.next_offset);
+}
+END_TEST
+
+START_TEST (test_urltrans_range_ignored)
+{
+  tiz_urltrans_range_t range;
+  char length[64];
+
+  urltrans_test_init (&range, 1000);
+
+  /* A server that sends the whole resource: the requested offset must be
+     skipped, and the headers are not rewritten */
+  fail_if (urltrans_test_header (&range, "HTTP/1.1 200 OK\r\n", length,
+                                 sizeof (length)));
+  fail_if (range.partial);
+  fail_if (1000 != range.skip_bytes);
+  fail_if (urltrans_test_header (&range, "Content-Length: 5000\r\n", length,
+                                 sizeof (length)));
+  fail_if (urltrans_test_header (
+    &range, "Content-Range: bytes 1000-1999/5000\r\n", length,
+    sizeof (length)));
+  fail_if (-1 != range.total_bytes);
+}
+END_TEST
+
+START_TEST (test_urltrans_range_mismatch)
+{
+  tiz_urltrans_range_t range;
+  char length[64];
+  const char * p_header = "Content-Range: bytes 0-99/1000";
+
+  urltrans_test_init (&range, 0);
+
+  fail_if (urltrans_test_header (&range, "HTTP/1.1 206 Partial Content\r\n",
+                                 length, sizeof (length)));
+
+  /* A range that is not the one requested is left alone */
+  fail_if (urltrans_test_header (
+    &range, "Content-Range: bytes 10-99/100\r\n", length, sizeof (length)));
+  fail_if (urltrans_test_header (&range, "Content-Range: bytes */100\r\n",
+                                 length, sizeof (length)));
+  fail_if ('\0' != length[0]);
+  fail_if (-1 != range.total_bytes);
+
+  /* Headers are not null-terminated; only a_nbytes are looked at */
+  fail_if (!tiz_urltrans_process_range_header (&range, p_header, 29, length,
+                                               sizeof (length)));
+  fail_if (0 != strcmp (length, "Content-Length: 100\r\n"));
+  fail_if (100 != range.total_bytes);
+  fail_if (100 != range.next_offset);
+
+  /* A truncated status line is not taken as a 206 */
+  fail_if (tiz_urltrans_process_range_header (&range, "HTTP/1.1 20", 11,
+                                              length, sizeof (length)));
+  fail_if (range.partial);
+}
+END_TEST
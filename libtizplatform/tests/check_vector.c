@@ -210,3 +210,50 @@ START_TEST (test_vector_push_back_vector)
 }
 END_TEST
 
+
+static int
+vector_cmp_ints (const void * ap_left, const void * ap_right)
+{
+  const int left = *(const int *) ap_left;
+  const int right = *(const int *) ap_right;
+  return (left > right) - (left < right);
+}
+
+START_TEST (test_vector_insert_sorted_and_bsearch)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_vector_t *p_vector = NULL;
+  const int items[] = {7, 3, 9, 0, 5, 1, 8, 2, 6, 4};
+  int i;
+  int *p_item = NULL;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_vector_insert_sorted_and_bsearch");
+
+  error = tiz_vector_init (&p_vector, sizeof(int));
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 0; i < 10; i++)
+    {
+      error = tiz_vector_insert_sorted (p_vector, (OMX_PTR) &items[i],
+                                        vector_cmp_ints);
+      fail_if (error != OMX_ErrorNone);
+    }
+
+  fail_if (10 != tiz_vector_length (p_vector));
+
+  for (i = 0; i < 10; i++)
+    {
+      p_item = (int *) tiz_vector_at (p_vector, i);
+      fail_if (*p_item != i);
+
+      p_item = (int *) tiz_vector_bsearch (p_vector, &i, vector_cmp_ints);
+      fail_if (NULL == p_item);
+      fail_if (*p_item != i);
+    }
+
+  i = 10;
+  fail_if (NULL != tiz_vector_bsearch (p_vector, &i, vector_cmp_ints));
+
+  tiz_vector_destroy (p_vector);
+}
+END_TEST
@@ -0,0 +1,412 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmringbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Fan-out benchmark for the shared memory ring
+ *
+ * One writer (this process) streams records through a tiz_shmring_t to a
+ * number of reader processes, which open the ring by its name. Each reader
+ * checks that the records it receives are in order, and reports its
+ * throughput, the largest lag it has seen, and the records it has lost.
+ *
+ * With -d, the first reader sleeps after each record, to show the effect of
+ * a slow consumer: with backpressure the writer (and every other reader)
+ * slows down to its pace; with drop-oldest only the slow reader loses
+ * records.
+ *
+ * Usage: tizshmring-bench [-n readers] [-r record bytes] [-c ring KiB]
+ *                         [-m MiB to write] [-p backpressure|drop-oldest]
+ *                         [-d usecs per record in the first reader]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#define BENCH_STATS_INTERVAL 256
+
+typedef struct bench_result bench_result_t;
+struct bench_result
+{
+  int id;
+  int in_order;
+  double secs;
+  uint64_t records;
+  uint64_t bytes;
+  uint64_t max_lag;
+  uint64_t dropped;
+  uint64_t overruns;
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+write_all (int a_fd, const void * ap_buf, size_t a_len)
+{
+  const char * p = ap_buf;
+  while (a_len > 0)
+    {
+      ssize_t n = write (a_fd, p, a_len);
+      if (n <= 0)
+        {
+          return -1;
+        }
+      p += n;
+      a_len -= n;
+    }
+  return 0;
+}
+
+static int
+read_all (int a_fd, void * ap_buf, size_t a_len)
+{
+  char * p = ap_buf;
+  while (a_len > 0)
+    {
+      ssize_t n = read (a_fd, p, a_len);
+      if (n <= 0)
+        {
+          return -1;
+        }
+      p += n;
+      a_len -= n;
+    }
+  return 0;
+}
+
+static int
+run_reader (const int a_id, const char * ap_name,
+            const tiz_shmring_policy_t a_policy, const size_t a_record_bytes,
+            const int a_delay_us, const int a_ready_fd, const int a_result_fd)
+{
+  tiz_shmring_t * p_ring = NULL;
+  tiz_shmring_stats_t stats;
+  bench_result_t result;
+  unsigned char * p_buf = malloc (a_record_bytes);
+  uint64_t expected = 0;
+  double start = 0;
+  int reader = -1;
+  char ready = 'r';
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  memset (&result, 0, sizeof (result));
+  result.id = a_id;
+  result.in_order = 1;
+
+  /* The writer creates the ring after the readers have been forked */
+  while (OMX_ErrorNotReady == (rc = tiz_shmring_open (&p_ring, ap_name)))
+    {
+      usleep (1000);
+    }
+
+  if (!p_buf || OMX_ErrorNone != rc
+      || OMX_ErrorNone != tiz_shmring_attach (p_ring, a_policy, &reader)
+      || write_all (a_ready_fd, &ready, 1) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  for (;;)
+    {
+      size_t nbytes = 0;
+      OMX_U32 flags = 0;
+      OMX_BOOL end = OMX_FALSE;
+      uint64_t index = 0;
+
+      rc = tiz_shmring_read (p_ring, reader, p_buf, a_record_bytes, &nbytes,
+                             &flags, &end, -1);
+      if (OMX_ErrorNone != rc)
+        {
+          break;
+        }
+
+      if (0 == result.records)
+        {
+          start = now_secs ();
+        }
+
+      memcpy (&index, p_buf, sizeof (index));
+      if (index < expected || !end || nbytes != a_record_bytes
+          || (a_policy == ETIZShmringPolicyBackpressure && index != expected))
+        {
+          result.in_order = 0;
+        }
+      expected = index + 1;
+      result.records++;
+      result.bytes += nbytes;
+
+      if (0 == result.records % BENCH_STATS_INTERVAL
+          && OMX_ErrorNone == tiz_shmring_stats (p_ring, reader, &stats)
+          && stats.lag_bytes > result.max_lag)
+        {
+          result.max_lag = stats.lag_bytes;
+        }
+
+      if (a_delay_us > 0)
+        {
+          usleep (a_delay_us);
+        }
+    }
+
+  result.secs = result.records ? now_secs () - start : 0;
+  if (OMX_ErrorNone == tiz_shmring_stats (p_ring, reader, &stats))
+    {
+      result.dropped = stats.dropped_records;
+      result.overruns = stats.overruns;
+    }
+
+  tiz_shmring_detach (p_ring, reader);
+  tiz_shmring_destroy (p_ring);
+  free (p_buf);
+  return (OMX_ErrorNoMore == rc
+          && write_all (a_result_fd, &result, sizeof (result)) == 0)
+           ? EXIT_SUCCESS
+           : EXIT_FAILURE;
+}
+
+static int
+run_writer (const char * ap_name, const size_t a_capacity,
+            const size_t a_record_bytes, const uint64_t a_total_bytes,
+            const int a_readers, const int a_ready_fd, double * ap_secs,
+            uint64_t * ap_records)
+{
+  tiz_shmring_t * p_ring = NULL;
+  unsigned char * p_buf = NULL;
+  uint64_t index = 0;
+  double start = 0;
+  int i = 0;
+
+  if (OMX_ErrorNone != tiz_shmring_create (&p_ring, ap_name, a_capacity))
+    {
+      fprintf (stderr, "Unable to create the ring\n");
+      return -1;
+    }
+
+  if (a_record_bytes > tiz_shmring_max_record (p_ring)
+      || !(p_buf = malloc (a_record_bytes)))
+    {
+      fprintf (stderr, "Records are limited to %zu bytes with this ring\n",
+               tiz_shmring_max_record (p_ring));
+      tiz_shmring_destroy (p_ring);
+      return -1;
+    }
+  memset (p_buf, 0xa5, a_record_bytes);
+
+  /* Wait until every reader has attached */
+  for (i = 0; i < a_readers; ++i)
+    {
+      char ready = 0;
+      if (read_all (a_ready_fd, &ready, 1) < 0)
+        {
+          free (p_buf);
+          tiz_shmring_destroy (p_ring);
+          return -1;
+        }
+    }
+
+  start = now_secs ();
+  for (index = 0; index * a_record_bytes < a_total_bytes; ++index)
+    {
+      memcpy (p_buf, &index, sizeof (index));
+      if (OMX_ErrorNone
+          != tiz_shmring_write (p_ring, p_buf, a_record_bytes, 0, -1))
+        {
+          break;
+        }
+    }
+  *ap_secs = now_secs () - start;
+  *ap_records = index;
+
+  /* Closes the ring: readers get OMX_ErrorNoMore once they have caught up */
+  tiz_shmring_destroy (p_ring);
+  free (p_buf);
+  return 0;
+}
+
+int
+main (int argc, char ** argv)
+{
+  int readers = 4;
+  size_t record_bytes = 4096;
+  size_t capacity = 1024 * 1024;
+  uint64_t total_bytes = 1024 * 1024 * 1024;
+  tiz_shmring_policy_t policy = ETIZShmringPolicyBackpressure;
+  int delay_us = 0;
+  int ready_pipe[2];
+  int result_pipe[2];
+  pid_t pids[TIZ_SHMRING_MAX_READERS];
+  char name[64];
+  double writer_secs = 0;
+  uint64_t written = 0;
+  double aggregate = 0;
+  int failed = 0;
+  int opt = 0;
+  int i = 0;
+
+  while ((opt = getopt (argc, argv, "n:r:c:m:p:d:")) != -1)
+    {
+      switch (opt)
+        {
+          case 'n':
+            readers = atoi (optarg);
+            break;
+          case 'r':
+            record_bytes = strtoul (optarg, NULL, 10);
+            break;
+          case 'c':
+            capacity = strtoul (optarg, NULL, 10) * 1024;
+            break;
+          case 'm':
+            total_bytes = strtoull (optarg, NULL, 10) * 1024 * 1024;
+            break;
+          case 'p':
+            policy = (0 == strcmp (optarg, "drop-oldest"))
+                       ? ETIZShmringPolicyDropOldest
+                       : ETIZShmringPolicyBackpressure;
+            break;
+          case 'd':
+            delay_us = atoi (optarg);
+            break;
+          default:
+            fprintf (stderr,
+                     "Usage: %s [-n readers] [-r record bytes] [-c ring KiB] "
+                     "[-m MiB to write] [-p backpressure|drop-oldest] "
+                     "[-d usecs per record in the first reader]\n",
+                     argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (readers <= 0 || readers > TIZ_SHMRING_MAX_READERS
+      || record_bytes < sizeof (uint64_t) || capacity == 0)
+    {
+      fprintf (stderr, "Invalid arguments (at most %d readers)\n",
+               TIZ_SHMRING_MAX_READERS);
+      return EXIT_FAILURE;
+    }
+
+  if (pipe (ready_pipe) < 0 || pipe (result_pipe) < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  snprintf (name, sizeof (name), "bench-%d", (int) getpid ());
+  for (i = 0; i < readers; ++i)
+    {
+      pids[i] = fork ();
+      if (0 == pids[i])
+        {
+          close (ready_pipe[0]);
+          close (result_pipe[0]);
+          _exit (run_reader (i, name, policy, record_bytes,
+                             0 == i ? delay_us : 0, ready_pipe[1],
+                             result_pipe[1]));
+        }
+      else if (pids[i] < 0)
+        {
+          fprintf (stderr, "Unable to fork reader %d\n", i);
+          return EXIT_FAILURE;
+        }
+    }
+  close (ready_pipe[1]);
+  close (result_pipe[1]);
+
+  if (run_writer (name, capacity, record_bytes, total_bytes, readers,
+                  ready_pipe[0], &writer_secs, &written)
+      < 0)
+    {
+      for (i = 0; i < readers; ++i)
+        {
+          kill (pids[i], SIGTERM);
+        }
+      failed = 1;
+    }
+
+  printf ("%d readers, %zu-byte records, %zu KiB ring, %s\n", readers,
+          record_bytes, capacity / 1024,
+          ETIZShmringPolicyDropOldest == policy ? "drop-oldest"
+                                                : "backpressure");
+  printf ("%-8s %10s %10s %10s %12s %10s %10s %8s\n", "reader", "records",
+          "MiB", "MB/s", "max lag KiB", "dropped", "overruns", "in order");
+  printf ("%-8s %10llu %10.1f %10.1f\n", "writer",
+          (unsigned long long) written,
+          (double) written * record_bytes / (1024 * 1024),
+          writer_secs > 0 ? written * record_bytes / writer_secs / 1e6 : 0);
+
+  for (i = 0; i < readers && !failed; ++i)
+    {
+      bench_result_t result;
+      double mbps = 0;
+      if (read_all (result_pipe[0], &result, sizeof (result)) < 0)
+        {
+          failed = 1;
+          break;
+        }
+      mbps = result.secs > 0 ? result.bytes / result.secs / 1e6 : 0;
+      aggregate += mbps;
+      printf ("%-8d %10llu %10.1f %10.1f %12.1f %10llu %10llu %8s\n",
+              result.id, (unsigned long long) result.records,
+              (double) result.bytes / (1024 * 1024), mbps,
+              (double) result.max_lag / 1024,
+              (unsigned long long) result.dropped,
+              (unsigned long long) result.overruns,
+              result.in_order ? "yes" : "NO");
+      if (!result.in_order
+          || result.records + result.dropped != written)
+        {
+          failed = 1;
+        }
+    }
+
+  for (i = 0; i < readers; ++i)
+    {
+      int status = 0;
+      if (waitpid (pids[i], &status, 0) < 0 || !WIFEXITED (status)
+          || EXIT_SUCCESS != WEXITSTATUS (status))
+        {
+          failed = 1;
+        }
+    }
+
+  if (!failed)
+    {
+      printf ("aggregate %.1f MB/s\n", aggregate);
+    }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,710 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlsegbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Segmented download benchmark for URL transfers
+ *
+ * Downloads a resource with tiz_urltrans_t from a local HTTP server that
+ * throttles each connection, the way some CDNs do, first as a single stream
+ * and then with segmented downloads enabled. The received data is checked to
+ * be complete and in order.
+ *
+ * With -c, the on-disk cache is exercised too: a transfer is interrupted
+ * half-way, then played again (the rest is requested from the server), and
+ * then once more (no request reaches the server).
+ *
+ * Usage: tizurlseg-bench [-s bytes] [-r bytes/s per connection]
+ *                        [-m max segments] [-b segment bytes] [-c cache dir]
+ *
+ * The transfer's I/O and timer watchers are driven here by a poll loop, on a
+ * single thread, in place of the component's servant.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#define BENCH_MAX_WATCHERS 32
+#define BENCH_OUT_BUFFER_BYTES (64 * 1024)
+#define BENCH_CHUNK_BYTES 4096
+
+/*
+ * Rate-limiting HTTP server
+ */
+
+typedef struct bench_server bench_server_t;
+struct bench_server
+{
+  int listen_fd;
+  int port;
+  long size;
+  long rate;     /* bytes per second, per connection */
+  long requests; /* requests served so far */
+};
+
+static inline unsigned char
+pattern_byte (const long a_pos)
+{
+  return (unsigned char) ((a_pos * 31 + 7) & 0xff);
+}
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+send_all (const int a_fd, const char * ap_data, size_t a_len)
+{
+  while (a_len > 0)
+    {
+      const ssize_t n = send (a_fd, ap_data, a_len, MSG_NOSIGNAL);
+      if (n <= 0)
+        {
+          return -1;
+        }
+      ap_data += n;
+      a_len -= n;
+    }
+  return 0;
+}
+
+/* Serves GET requests, with or without a Range header, on a keep-alive
+   connection, at no more than the configured rate */
+static int
+serve_request (bench_server_t * ap_srv, const int a_fd,
+               const char * ap_request)
+{
+  const char * p_range = strstr (ap_request, "\r\nRange: bytes=");
+  char chunk[BENCH_CHUNK_BYTES];
+  char headers[256];
+  long first = 0;
+  long last = ap_srv->size - 1;
+  long pos = 0;
+  double start = now_secs ();
+
+  (void) __sync_fetch_and_add (&(ap_srv->requests), 1);
+
+  if (p_range)
+    {
+      (void) sscanf (p_range + 15, "%ld-%ld", &first, &last);
+      if (last >= ap_srv->size)
+        {
+          last = ap_srv->size - 1;
+        }
+      snprintf (headers, sizeof (headers),
+                "HTTP/1.1 206 Partial Content\r\n"
+                "Accept-Ranges: bytes\r\n"
+                "Content-Type: audio/mpeg\r\n"
+                "Content-Range: bytes %ld-%ld/%ld\r\n"
+                "Content-Length: %ld\r\n\r\n",
+                first, last, ap_srv->size, last - first + 1);
+    }
+  else
+    {
+      snprintf (headers, sizeof (headers),
+                "HTTP/1.1 200 OK\r\n"
+                "Accept-Ranges: bytes\r\n"
+                "Content-Type: audio/mpeg\r\n"
+                "Content-Length: %ld\r\n\r\n",
+                ap_srv->size);
+    }
+
+  if (send_all (a_fd, headers, strlen (headers)) < 0)
+    {
+      return -1;
+    }
+
+  for (pos = first; pos <= last;)
+    {
+      const long n = MIN (BENCH_CHUNK_BYTES, last - pos + 1);
+      const double due = start + (double) (pos - first + n) / ap_srv->rate;
+      const double wait = due - now_secs ();
+      long i = 0;
+      if (wait > 0)
+        {
+          usleep ((useconds_t) (wait * 1e6));
+        }
+      for (i = 0; i < n; ++i)
+        {
+          chunk[i] = pattern_byte (pos + i);
+        }
+      if (send_all (a_fd, chunk, n) < 0)
+        {
+          return -1;
+        }
+      pos += n;
+    }
+  return 0;
+}
+
+typedef struct bench_conn bench_conn_t;
+struct bench_conn
+{
+  bench_server_t * p_srv;
+  int fd;
+};
+
+static void *
+connection_thread (void * ap_arg)
+{
+  bench_conn_t * p_conn = ap_arg;
+  char request[4096];
+  size_t len = 0;
+
+  for (;;)
+    {
+      const ssize_t n
+        = recv (p_conn->fd, request + len, sizeof (request) - 1 - len, 0);
+      char * p_end = NULL;
+      if (n <= 0)
+        {
+          break;
+        }
+      len += n;
+      request[len] = '\0';
+      if ((p_end = strstr (request, "\r\n\r\n")))
+        {
+          if (serve_request (p_conn->p_srv, p_conn->fd, request) < 0)
+            {
+              break;
+            }
+          len = 0;
+        }
+      else if (len == sizeof (request) - 1)
+        {
+          break;
+        }
+    }
+
+  close (p_conn->fd);
+  free (p_conn);
+  return NULL;
+}
+
+static void *
+server_thread (void * ap_arg)
+{
+  bench_server_t * p_srv = ap_arg;
+  for (;;)
+    {
+      pthread_t thread;
+      bench_conn_t * p_conn = NULL;
+      const int fd = accept (p_srv->listen_fd, NULL, NULL);
+      if (fd < 0)
+        {
+          break;
+        }
+      if (!(p_conn = calloc (1, sizeof (bench_conn_t))))
+        {
+          close (fd);
+          continue;
+        }
+      p_conn->p_srv = p_srv;
+      p_conn->fd = fd;
+      if (0 != pthread_create (&thread, NULL, connection_thread, p_conn))
+        {
+          close (fd);
+          free (p_conn);
+          continue;
+        }
+      (void) pthread_detach (thread);
+    }
+  return NULL;
+}
+
+static int
+start_server (bench_server_t * ap_srv)
+{
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof (addr);
+  pthread_t thread;
+  const int one = 1;
+
+  if ((ap_srv->listen_fd = socket (AF_INET, SOCK_STREAM, 0)) < 0)
+    {
+      return -1;
+    }
+  (void) setsockopt (ap_srv->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one,
+                     sizeof (one));
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  if (bind (ap_srv->listen_fd, (struct sockaddr *) &addr, sizeof (addr)) < 0
+      || listen (ap_srv->listen_fd, 64) < 0
+      || getsockname (ap_srv->listen_fd, (struct sockaddr *) &addr, &addr_len)
+           < 0)
+    {
+      return -1;
+    }
+  ap_srv->port = ntohs (addr.sin_port);
+  if (0 != pthread_create (&thread, NULL, server_thread, ap_srv))
+    {
+      return -1;
+    }
+  (void) pthread_detach (thread);
+  return 0;
+}
+
+/*
+ * Client: a minimal stand-in for the servant's event watchers
+ */
+
+typedef struct bench_watcher bench_watcher_t;
+struct bench_watcher
+{
+  bool is_io;
+  bool started;
+  int fd;
+  tiz_event_io_event_t io_type;
+  double after;
+  double repeat;
+  double due;
+};
+
+typedef struct bench_client bench_client_t;
+struct bench_client
+{
+  tiz_urltrans_t * p_trans;
+  bench_watcher_t * watchers[BENCH_MAX_WATCHERS];
+  OMX_BUFFERHEADERTYPE hdr;
+  OMX_U8 data[BENCH_OUT_BUFFER_BYTES];
+  long received;
+  long stop_at; /* bytes after which the transfer is abandoned, or -1 */
+  long content_length;
+  bool in_order;
+  bool done;
+};
+
+static bench_watcher_t *
+add_watcher (bench_client_t * ap_client, const bool a_is_io)
+{
+  int i = 0;
+  for (i = 0; i < BENCH_MAX_WATCHERS; ++i)
+    {
+      if (!ap_client->watchers[i])
+        {
+          ap_client->watchers[i] = calloc (1, sizeof (bench_watcher_t));
+          if (ap_client->watchers[i])
+            {
+              ap_client->watchers[i]->is_io = a_is_io;
+            }
+          return ap_client->watchers[i];
+        }
+    }
+  return NULL;
+}
+
+static void
+remove_watcher (bench_client_t * ap_client, void * ap_watcher)
+{
+  int i = 0;
+  for (i = 0; i < BENCH_MAX_WATCHERS; ++i)
+    {
+      if (ap_client->watchers[i] && ap_client->watchers[i] == ap_watcher)
+        {
+          free (ap_client->watchers[i]);
+          ap_client->watchers[i] = NULL;
+        }
+    }
+}
+
+static OMX_ERRORTYPE
+io_init (void * ap_obj, tiz_event_io_t ** app_ev_io, int a_fd,
+         tiz_event_io_event_t a_event, bool only_once)
+{
+  bench_watcher_t * p_watcher = add_watcher (ap_obj, true);
+  if (!p_watcher)
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+  p_watcher->fd = a_fd;
+  p_watcher->io_type = a_event;
+  *app_ev_io = (tiz_event_io_t *) p_watcher;
+  return OMX_ErrorNone;
+}
+
+static void
+io_destroy (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  remove_watcher (ap_obj, ap_ev_io);
+}
+
+static OMX_ERRORTYPE
+io_start (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  ((bench_watcher_t *) ap_ev_io)->started = true;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+io_stop (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  ((bench_watcher_t *) ap_ev_io)->started = false;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+timer_init (void * ap_obj, tiz_event_timer_t ** app_ev_timer)
+{
+  bench_watcher_t * p_watcher = add_watcher (ap_obj, false);
+  *app_ev_timer = (tiz_event_timer_t *) p_watcher;
+  return p_watcher ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
+}
+
+static void
+timer_destroy (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  remove_watcher (ap_obj, ap_ev_timer);
+}
+
+static OMX_ERRORTYPE
+timer_start (void * ap_obj, tiz_event_timer_t * ap_ev_timer,
+             const double a_after, const double a_repeat)
+{
+  bench_watcher_t * p_watcher = (bench_watcher_t *) ap_ev_timer;
+  p_watcher->after = a_after;
+  p_watcher->repeat = a_repeat;
+  p_watcher->due = now_secs () + a_after;
+  p_watcher->started = true;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+timer_stop (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  ((bench_watcher_t *) ap_ev_timer)->started = false;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+timer_restart (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  bench_watcher_t * p_watcher = (bench_watcher_t *) ap_ev_timer;
+  return timer_start (ap_obj, ap_ev_timer, p_watcher->after,
+                      p_watcher->repeat);
+}
+
+static void
+buffer_filled (OMX_BUFFERHEADERTYPE * ap_hdr, OMX_PTR ap_arg)
+{
+  bench_client_t * p_client = ap_arg;
+  OMX_U32 i = 0;
+  for (i = 0; i < ap_hdr->nFilledLen; ++i)
+    {
+      if (ap_hdr->pBuffer[i] != pattern_byte (p_client->received + i))
+        {
+          p_client->in_order = false;
+          break;
+        }
+    }
+  p_client->received += ap_hdr->nFilledLen;
+  ap_hdr->nFilledLen = 0;
+}
+
+static OMX_BUFFERHEADERTYPE *
+buffer_emptied (OMX_PTR ap_arg)
+{
+  bench_client_t * p_client = ap_arg;
+  return &(p_client->hdr);
+}
+
+static void
+header_available (OMX_PTR ap_arg, const void * ap_ptr, const size_t a_nbytes)
+{
+  bench_client_t * p_client = ap_arg;
+  if (a_nbytes > 15 && 0 == strncasecmp (ap_ptr, "Content-Length:", 15))
+    {
+      p_client->content_length = atol ((const char *) ap_ptr + 15);
+    }
+}
+
+static bool
+data_available (OMX_PTR ap_arg, const void * ap_ptr, const size_t a_nbytes)
+{
+  return false;
+}
+
+static bool
+connection_lost (OMX_PTR ap_arg)
+{
+  bench_client_t * p_client = ap_arg;
+  p_client->done = true;
+  return false;
+}
+
+static void
+run_event_loop (bench_client_t * ap_client, const double a_deadline)
+{
+  /* After the connection is gone, the store may still hold data */
+  while ((!ap_client->done
+          || tiz_urltrans_bytes_available (ap_client->p_trans) > 0)
+         && (ap_client->stop_at < 0 || ap_client->received < ap_client->stop_at)
+         && now_secs () < a_deadline)
+    {
+      struct pollfd fds[BENCH_MAX_WATCHERS];
+      bench_watcher_t * polled[BENCH_MAX_WATCHERS];
+      double timeout = 0.1;
+      int nfds = 0;
+      int i = 0;
+
+      for (i = 0; i < BENCH_MAX_WATCHERS; ++i)
+        {
+          bench_watcher_t * p_watcher = ap_client->watchers[i];
+          if (p_watcher && p_watcher->started && p_watcher->is_io)
+            {
+              fds[nfds].fd = p_watcher->fd;
+              fds[nfds].events
+                = ((p_watcher->io_type & TIZ_EVENT_READ) ? POLLIN : 0)
+                  | ((p_watcher->io_type & TIZ_EVENT_WRITE) ? POLLOUT : 0);
+              fds[nfds].revents = 0;
+              polled[nfds++] = p_watcher;
+            }
+          else if (p_watcher && p_watcher->started)
+            {
+              timeout = MIN (timeout, MAX (0, p_watcher->due - now_secs ()));
+            }
+        }
+
+      (void) poll (fds, nfds, (int) (timeout * 1000));
+      (void) tiz_urltrans_on_buffers_ready (ap_client->p_trans);
+
+      for (i = 0; i < nfds; ++i)
+        {
+          int j = 0;
+          for (j = 0; j < BENCH_MAX_WATCHERS; ++j)
+            {
+              /* The watcher may be gone by now */
+              if (ap_client->watchers[j] == polled[i] && polled[i]->started
+                  && fds[i].revents)
+                {
+                  const int events
+                    = ((fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                         ? TIZ_EVENT_READ
+                         : 0)
+                      | ((fds[i].revents & POLLOUT) ? TIZ_EVENT_WRITE : 0);
+                  polled[i]->started = false;
+                  (void) tiz_urltrans_on_io_ready (
+                    ap_client->p_trans, (tiz_event_io_t *) polled[i],
+                    polled[i]->fd, events);
+                  break;
+                }
+            }
+        }
+
+      for (i = 0; i < BENCH_MAX_WATCHERS; ++i)
+        {
+          bench_watcher_t * p_watcher = ap_client->watchers[i];
+          if (p_watcher && p_watcher->started && !p_watcher->is_io
+              && p_watcher->due <= now_secs ())
+            {
+              p_watcher->started = (p_watcher->repeat > 0);
+              p_watcher->due = now_secs () + p_watcher->repeat;
+              (void) tiz_urltrans_on_timer_ready (
+                ap_client->p_trans, (tiz_event_timer_t *) p_watcher);
+            }
+        }
+    }
+}
+
+static int
+run (bench_server_t * ap_srv, const char * ap_mode, const int a_max_segments,
+     const int a_segment_bytes, const char * ap_cache_dir, const long a_stop_at)
+{
+  static bench_client_t client;
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+  const tiz_urltrans_buffer_cbacks_t buffer_cbacks
+    = {buffer_filled, buffer_emptied};
+  const tiz_urltrans_info_cbacks_t info_cbacks
+    = {header_available, data_available, connection_lost};
+  const tiz_urltrans_event_io_cbacks_t io_cbacks
+    = {io_init, io_destroy, io_start, io_stop};
+  const tiz_urltrans_event_timer_cbacks_t timer_cbacks
+    = {timer_init, timer_destroy, timer_start, timer_stop, timer_restart};
+  double start = 0;
+  double elapsed = 0;
+  long requests = 0;
+  long expected = 0;
+  int rc = 0;
+
+  if (!(p_uri = calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + 64)))
+    {
+      return -1;
+    }
+  snprintf ((char *) p_uri->contentURI, 64, "http://127.0.0.1:%d/track.mp3",
+            ap_srv->port);
+
+  memset (&client, 0, sizeof (client));
+  client.hdr.pBuffer = client.data;
+  client.hdr.nAllocLen = BENCH_OUT_BUFFER_BYTES;
+  client.in_order = true;
+  client.content_length = -1;
+  client.stop_at = a_stop_at;
+  expected = a_stop_at >= 0 ? a_stop_at : ap_srv->size;
+
+  if (OMX_ErrorNone
+      != tiz_urltrans_init (&(client.p_trans), &client, p_uri,
+                            (OMX_STRING) "tizurlseg-bench", 1024 * 1024, 3.0,
+                            buffer_cbacks, info_cbacks, io_cbacks,
+                            timer_cbacks))
+    {
+      free (p_uri);
+      return -1;
+    }
+
+  tiz_urltrans_set_internal_buffer_size (client.p_trans, 1024 * 1024);
+  tiz_urltrans_set_segmented_download (client.p_trans, a_max_segments,
+                                       a_segment_bytes);
+  if (ap_cache_dir)
+    {
+      tiz_urltrans_set_cache (client.p_trans, ap_cache_dir,
+                              4 * (OMX_U64) ap_srv->size);
+    }
+
+  requests = ap_srv->requests;
+  start = now_secs ();
+  if (OMX_ErrorNone == tiz_urltrans_start (client.p_trans))
+    {
+      run_event_loop (&client, start + 120);
+    }
+  elapsed = now_secs () - start;
+  tiz_urltrans_cancel (client.p_trans);
+  requests = ap_srv->requests - requests;
+
+  /* A transfer that is abandoned may have delivered a bit more */
+  if (a_stop_at >= 0 && client.received > a_stop_at)
+    {
+      expected = client.received;
+    }
+
+  printf ("%-10s %8d %10.2f %10.0f %10ld %8ld %8s\n", ap_mode, a_max_segments,
+          elapsed, client.received / elapsed / 1024, client.content_length,
+          requests,
+          (client.in_order && client.received == expected) ? "yes" : "NO");
+
+  rc = (client.in_order && client.received == expected
+        && client.content_length == ap_srv->size)
+         ? 0
+         : -1;
+
+  tiz_urltrans_destroy (client.p_trans);
+  free (p_uri);
+  return rc;
+}
+
+int
+main (int argc, char ** argv)
+{
+  static bench_server_t server;
+  int max_segments = 4;
+  int segment_bytes = 256 * 1024;
+  const char * p_cache_dir = NULL;
+  int opt = 0;
+
+  server.size = 4 * 1024 * 1024;
+  server.rate = 512 * 1024;
+
+  while ((opt = getopt (argc, argv, "s:r:m:b:c:")) != -1)
+    {
+      switch (opt)
+        {
+          case 's':
+            server.size = atol (optarg);
+            break;
+          case 'r':
+            server.rate = atol (optarg);
+            break;
+          case 'm':
+            max_segments = atoi (optarg);
+            break;
+          case 'b':
+            segment_bytes = atoi (optarg);
+            break;
+          case 'c':
+            p_cache_dir = optarg;
+            break;
+          default:
+            fprintf (stderr,
+                     "Usage: %s [-s bytes] [-r bytes/s per connection] "
+                     "[-m max segments] [-b segment bytes] [-c cache dir]\n",
+                     argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  if (server.size <= 0 || server.rate <= 0 || max_segments <= 0
+      || segment_bytes <= 0 || start_server (&server) < 0)
+    {
+      fprintf (stderr, "Unable to start the local HTTP server\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%ld bytes at %ld bytes/s per connection\n", server.size,
+          server.rate);
+  printf ("%-10s %8s %10s %10s %10s %8s %8s\n", "mode", "segments", "secs",
+          "KiB/s", "length", "requests", "intact");
+  if (run (&server, "single", 0, 0, NULL, -1) < 0
+      || run (&server, "segmented", max_segments, segment_bytes, NULL, -1)
+           < 0)
+    {
+      return EXIT_FAILURE;
+    }
+
+  if (p_cache_dir)
+    {
+      long requests = 0;
+      if (run (&server, "partial", max_segments, segment_bytes, p_cache_dir,
+               server.size / 2)
+            < 0
+          || run (&server, "resumed", max_segments, segment_bytes,
+                  p_cache_dir, -1)
+               < 0)
+        {
+          return EXIT_FAILURE;
+        }
+      requests = server.requests;
+      if (run (&server, "cached", max_segments, segment_bytes, p_cache_dir, -1)
+            < 0
+          || server.requests != requests)
+        {
+          return EXIT_FAILURE;
+        }
+    }
+  return EXIT_SUCCESS;
+}
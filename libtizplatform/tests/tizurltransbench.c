@@ -0,0 +1,323 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurltransbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Track-change latency benchmark for URL transfers
+ *
+ * Simulates what a streaming source does on every track change (a brand new
+ * curl handle against the same host), with and without the process-wide
+ * DNS/TLS session cache used by tiz_urltrans_t.
+ *
+ * Usage: tizurltrans-bench [-n iterations] [url]
+ *
+ * Without a url, a local TLS server is started with 'openssl s_server' and a
+ * self-signed certificate (the openssl command-line tool is required). Times
+ * are medians, in microseconds, measured from the start of each request.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <curl/curl.h>
+
+#include <tizplatform.h>
+
+#define BENCH_DEFAULT_ITERATIONS 50
+#define BENCH_SERVER_PORT 14443
+#define BENCH_PAYLOAD_BYTES (64 * 1024)
+
+typedef struct bench_times bench_times_t;
+struct bench_times
+{
+  double dns;
+  double connect;
+  double tls;
+  double first_byte;
+  double total;
+};
+
+static size_t
+discard_cback (void * ptr, size_t size, size_t nmemb, void * userdata)
+{
+  return size * nmemb;
+}
+
+static int
+cmp_doubles (const void * ap_left, const void * ap_right)
+{
+  const double left = *(const double *) ap_left;
+  const double right = *(const double *) ap_right;
+  return (left > right) - (left < right);
+}
+
+static double
+median (double * ap_values, const int a_count)
+{
+  qsort (ap_values, a_count, sizeof (double), cmp_doubles);
+  return ap_values[a_count / 2];
+}
+
+static int
+fetch (const char * ap_url, const int a_shared, bench_times_t * ap_times)
+{
+  CURL * p_curl = NULL;
+  CURLcode rc = CURLE_OK;
+
+  if (!(p_curl = curl_easy_init ()))
+    {
+      return -1;
+    }
+
+  if (a_shared && OMX_ErrorNone != tiz_urltrans_use_shared_cache (p_curl))
+    {
+      curl_easy_cleanup (p_curl);
+      return -1;
+    }
+
+  (void) curl_easy_setopt (p_curl, CURLOPT_URL, ap_url);
+  (void) curl_easy_setopt (p_curl, CURLOPT_WRITEFUNCTION, discard_cback);
+  (void) curl_easy_setopt (p_curl, CURLOPT_SSL_VERIFYHOST, 0L);
+  (void) curl_easy_setopt (p_curl, CURLOPT_SSL_VERIFYPEER, 0L);
+  (void) curl_easy_setopt (p_curl, CURLOPT_FAILONERROR, 1L);
+
+  if (CURLE_OK == (rc = curl_easy_perform (p_curl)))
+    {
+      (void) curl_easy_getinfo (p_curl, CURLINFO_NAMELOOKUP_TIME,
+                                &(ap_times->dns));
+      (void) curl_easy_getinfo (p_curl, CURLINFO_CONNECT_TIME,
+                                &(ap_times->connect));
+      (void) curl_easy_getinfo (p_curl, CURLINFO_APPCONNECT_TIME,
+                                &(ap_times->tls));
+      (void) curl_easy_getinfo (p_curl, CURLINFO_STARTTRANSFER_TIME,
+                                &(ap_times->first_byte));
+      (void) curl_easy_getinfo (p_curl, CURLINFO_TOTAL_TIME,
+                                &(ap_times->total));
+    }
+  else
+    {
+      fprintf (stderr, "%s : %s\n", ap_url, curl_easy_strerror (rc));
+    }
+
+  curl_easy_cleanup (p_curl);
+  return CURLE_OK == rc ? 0 : -1;
+}
+
+static int
+run (const char * ap_url, const int a_iterations, const int a_shared)
+{
+  double * p_vals = calloc (5 * a_iterations, sizeof (double));
+  bench_times_t times;
+  int i = 0;
+
+  if (!p_vals)
+    {
+      return -1;
+    }
+
+  /* The first request of the shared run warms up the cache, the same way the
+     first track of a playlist would */
+  if (a_shared && fetch (ap_url, a_shared, &times) < 0)
+    {
+      free (p_vals);
+      return -1;
+    }
+
+  for (i = 0; i < a_iterations; ++i)
+    {
+      if (fetch (ap_url, a_shared, &times) < 0)
+        {
+          free (p_vals);
+          return -1;
+        }
+      p_vals[i] = times.dns;
+      p_vals[a_iterations + i] = times.connect;
+      p_vals[2 * a_iterations + i] = times.tls;
+      p_vals[3 * a_iterations + i] = times.first_byte;
+      p_vals[4 * a_iterations + i] = times.total;
+    }
+
+  printf ("%-8s %10.0f %10.0f %10.0f %10.0f %10.0f\n",
+          a_shared ? "shared" : "private", median (p_vals, a_iterations) * 1e6,
+          median (p_vals + a_iterations, a_iterations) * 1e6,
+          median (p_vals + 2 * a_iterations, a_iterations) * 1e6,
+          median (p_vals + 3 * a_iterations, a_iterations) * 1e6,
+          median (p_vals + 4 * a_iterations, a_iterations) * 1e6);
+
+  free (p_vals);
+  return 0;
+}
+
+static int
+wait_for_port (const int a_port)
+{
+  int attempt = 0;
+  for (attempt = 0; attempt < 100; ++attempt)
+    {
+      struct sockaddr_in addr;
+      int fd = socket (AF_INET, SOCK_STREAM, 0);
+      memset (&addr, 0, sizeof (addr));
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons (a_port);
+      addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+      if (fd >= 0 && 0 == connect (fd, (struct sockaddr *) &addr, sizeof addr))
+        {
+          close (fd);
+          return 0;
+        }
+      if (fd >= 0)
+        {
+          close (fd);
+        }
+      usleep (50000);
+    }
+  return -1;
+}
+
+static pid_t
+start_local_server (const char * ap_dir, const int a_port)
+{
+  char cmd[1024];
+  char port[16];
+  FILE * p_file = NULL;
+  pid_t pid = -1;
+  int i = 0;
+
+  snprintf (cmd, sizeof (cmd),
+            "openssl req -x509 -newkey rsa:2048 -nodes -days 1 "
+            "-subj /CN=localhost -keyout %s/key.pem -out %s/cert.pem "
+            ">/dev/null 2>&1",
+            ap_dir, ap_dir);
+  if (0 != system (cmd))
+    {
+      fprintf (stderr, "Unable to create a certificate with openssl\n");
+      return -1;
+    }
+
+  snprintf (cmd, sizeof (cmd), "%s/track.bin", ap_dir);
+  if (!(p_file = fopen (cmd, "w")))
+    {
+      return -1;
+    }
+  for (i = 0; i < BENCH_PAYLOAD_BYTES; ++i)
+    {
+      fputc (i & 0xff, p_file);
+    }
+  fclose (p_file);
+
+  snprintf (port, sizeof (port), "%d", a_port);
+  if (0 == (pid = fork ()))
+    {
+      if (0 == chdir (ap_dir))
+        {
+          (void) freopen ("/dev/null", "w", stdout);
+          (void) freopen ("/dev/null", "w", stderr);
+          execlp ("openssl", "openssl", "s_server", "-quiet", "-accept", port,
+                  "-cert", "cert.pem", "-key", "key.pem", "-WWW", (char *) NULL);
+        }
+      _exit (EXIT_FAILURE);
+    }
+
+  if (pid > 0 && wait_for_port (a_port) < 0)
+    {
+      kill (pid, SIGTERM);
+      (void) waitpid (pid, NULL, 0);
+      pid = -1;
+    }
+
+  return pid;
+}
+
+int
+main (int argc, char ** argv)
+{
+  int iterations = BENCH_DEFAULT_ITERATIONS;
+  char dir[] = "/tmp/tizurltrans-bench-XXXXXX";
+  char url[256];
+  const char * p_url = NULL;
+  pid_t server = -1;
+  int rc = EXIT_SUCCESS;
+  int opt = 0;
+
+  while ((opt = getopt (argc, argv, "n:")) != -1)
+    {
+      if ('n' == opt && atoi (optarg) > 0)
+        {
+          iterations = atoi (optarg);
+        }
+      else
+        {
+          fprintf (stderr, "Usage: %s [-n iterations] [url]\n", argv[0]);
+          return EXIT_FAILURE;
+        }
+    }
+
+  curl_global_init (CURL_GLOBAL_ALL);
+
+  if (optind < argc)
+    {
+      p_url = argv[optind];
+    }
+  else
+    {
+      if (!mkdtemp (dir)
+          || (server = start_local_server (dir, BENCH_SERVER_PORT)) < 0)
+        {
+          fprintf (stderr, "Unable to start the local TLS server\n");
+          return EXIT_FAILURE;
+        }
+      snprintf (url, sizeof (url), "https://localhost:%d/track.bin",
+                BENCH_SERVER_PORT);
+      p_url = url;
+    }
+
+  printf ("%s - %d track changes\n", p_url, iterations);
+  printf ("%-8s %10s %10s %10s %10s %10s\n", "cache", "dns", "connect", "tls",
+          "1st byte", "total");
+  if (run (p_url, iterations, 0) < 0 || run (p_url, iterations, 1) < 0)
+    {
+      rc = EXIT_FAILURE;
+    }
+
+  if (server > 0)
+    {
+      char cmd[512];
+      kill (server, SIGTERM);
+      (void) waitpid (server, NULL, 0);
+      snprintf (cmd, sizeof (cmd), "rm -rf %s", dir);
+      (void) system (cmd);
+    }
+
+  curl_global_cleanup ();
+  return rc;
+}
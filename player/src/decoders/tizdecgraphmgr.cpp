@@ -30,10 +30,13 @@
 #endif
 
 #include <boost/assign/list_of.hpp> // for 'list_of()'
+#include <boost/make_shared.hpp>
 
 #include <tizplatform.h>
 
 #include "tizgraphmgrcaps.hpp"
+#include "tizpcmcache.hpp"
+#include "tizplaylist.hpp"
 #include "tizdecgraphmgr.hpp"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -93,3 +96,35 @@ graphmgr::decodemgrops::decodemgrops (mgr *p_mgr,
   : tiz::graphmgr::ops (p_mgr, playlist, termination_cback)
 {
 }
+
+tizplaylist_ptr_t graphmgr::decodemgrops::find_next_sub_list ()
+{
+  tizplaylist_ptr_t next_lst = graphmgr::ops::find_next_sub_list ();
+
+  // Play the decoded PCM instead, when the whole sub-list is in the cache
+  uri_lst_t cached;
+  if (next_lst
+      && tiz::pcmcache::instance ().lookup (next_lst->get_uri_list (), cached))
+  {
+    const int position = next_lst->position ();
+    next_lst = boost::make_shared< tiz::playlist >(cached);
+    next_lst->set_position (position);
+  }
+
+  return next_lst;
+}
+
+void graphmgr::decodemgrops::do_update_control_ifcs (
+    const control::playback_status_t status)
+{
+  // Decoding into the cache waits until nothing is being played
+  tiz::pcmcache::instance ().set_playing (tiz::control::Playing == status);
+  graphmgr::ops::do_update_control_ifcs (status);
+}
+
+bool graphmgr::decodemgrops::is_looped_by_graph () const
+{
+  // With the cache, each pass goes back to the manager, so that a new pass
+  // can switch to the cached PCM.
+  return !tiz::pcmcache::instance ().enabled ();
+}
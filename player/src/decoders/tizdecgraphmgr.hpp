@@ -62,6 +62,12 @@ namespace tiz
     public:
       decodemgrops (mgr *p_mgr, const tizplaylist_ptr_t &playlist,
                     const termination_callback_t &termination_cback);
+
+      tizplaylist_ptr_t find_next_sub_list ();
+      void do_update_control_ifcs (const control::playback_status_t status);
+
+    protected:
+      bool is_looped_by_graph () const;
     };
   }  // namespace graphmgr
 }  // namespace tiz
@@ -184,7 +184,8 @@ void graphmgr::ops::do_execute ()
   assert (playlist_);
   assert (next_playlist_);
 
-  next_playlist_->set_loop_playback (playlist_->single_format ());
+  next_playlist_->set_loop_playback (playlist_->single_format ()
+                                     && is_looped_by_graph ());
   graph_config_.reset ();
   graph_config_ = boost::make_shared< tiz::graph::config > (
       next_playlist_, unused_buffer_seconds);
@@ -368,7 +369,12 @@ std::string graphmgr::ops::internal_error_msg () const
   return error_msg_;
 }
 
-tizplaylist_ptr_t graphmgr::ops::find_next_sub_list () const
+bool graphmgr::ops::is_looped_by_graph () const
+{
+  return true;
+}
+
+tizplaylist_ptr_t graphmgr::ops::find_next_sub_list ()
 {
   tizplaylist_ptr_t next_lst;
 
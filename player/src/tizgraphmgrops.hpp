@@ -115,10 +115,13 @@ namespace tiz
       OMX_ERRORTYPE internal_error () const;
       std::string internal_error_msg () const;
 
-      tizplaylist_ptr_t find_next_sub_list () const;
+      virtual tizplaylist_ptr_t find_next_sub_list ();
 
     protected:
       virtual tizgraph_ptr_t get_graph (const std::string &uri);
+      // Whether a single-format playlist is looped by the graph itself, as
+      // opposed to returning to the manager at the end of each pass
+      virtual bool is_looped_by_graph () const;
 
     protected:
       mgr *p_mgr_;              // Not owned
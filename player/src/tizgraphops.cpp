@@ -73,6 +73,8 @@ graph::ops::ops (graph *p_graph, const omx_comp_name_lst_t &comp_lst,
     h2n_ (),
     config_ (),
     expected_transitions_lst_ (),
+    transitions_start_ (),
+    transitions_timed_ (false),
     expected_port_transitions_lst_ (),
     playlist_ (),
     position_ (INVALID_POSITION),
@@ -246,10 +248,13 @@ void graph::ops::do_loaded2idle ()
 {
   if (last_op_succeeded ())
   {
+    const boost::chrono::steady_clock::time_point issued_at
+        = boost::chrono::steady_clock::now ();
     G_OPS_BAIL_IF_ERROR (
         util::transition_all (handles_, OMX_StateIdle, OMX_StateLoaded),
         "Unable to transition from Loaded->Idle");
     record_expected_transitions (OMX_StateIdle);
+    time_expected_transitions (issued_at);
   }
 }
 
@@ -277,10 +282,13 @@ void graph::ops::do_idle2exe ()
 {
   if (last_op_succeeded ())
   {
+    const boost::chrono::steady_clock::time_point issued_at
+        = boost::chrono::steady_clock::now ();
     G_OPS_BAIL_IF_ERROR (
         util::transition_all (handles_, OMX_StateExecuting, OMX_StateIdle),
         "Unable to transition from Idle->Exe");
     record_expected_transitions (OMX_StateExecuting);
+    time_expected_transitions (issued_at);
   }
 }
 
@@ -407,10 +415,13 @@ void graph::ops::do_exe2idle ()
 {
   if (last_op_succeeded ())
   {
+    const boost::chrono::steady_clock::time_point issued_at
+        = boost::chrono::steady_clock::now ();
     G_OPS_BAIL_IF_ERROR (
         util::transition_all (handles_, OMX_StateIdle, OMX_StateExecuting),
         "Unable to transition from Exe->Idle");
     record_expected_transitions (OMX_StateIdle);
+    time_expected_transitions (issued_at);
   }
 }
 
@@ -427,10 +438,13 @@ void graph::ops::do_idle2loaded ()
 {
   if (last_op_succeeded ())
   {
+    const boost::chrono::steady_clock::time_point issued_at
+        = boost::chrono::steady_clock::now ();
     G_OPS_BAIL_IF_ERROR (
         util::transition_all (handles_, OMX_StateLoaded, OMX_StateIdle),
         "Unable to transition from Idle->Loaded");
     record_expected_transitions (OMX_StateLoaded);
+    time_expected_transitions (issued_at);
   }
 }
 
@@ -592,6 +606,10 @@ void graph::ops::do_tear_down_tunnels ()
 
 void graph::ops::do_destroy_graph ()
 {
+  if (util::is_buffer_flow_stats_enabled ())
+  {
+    util::dump_buffer_flow_stats (handles_, h2n_);
+  }
   util::destroy_list (handles_);
   handles_.clear ();
   h2n_.clear ();
@@ -799,8 +817,23 @@ bool graph::ops::is_trans_complete (const OMX_HANDLETYPE handle,
 
     if (expected_transitions_lst_.end () != it)
     {
+      // NOTE: The event already carries the new state; no need to query the
+      // component with OMX_GetState here, which would be a synchronous round
+      // trip through the component's scheduler for every completion.
       expected_transitions_lst_.erase (it);
-      assert (util::verify_transition_one (handle, to_state));
+      if (expected_transitions_lst_.empty () && transitions_timed_)
+      {
+        transitions_timed_ = false;
+        TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                 "All components reached [%s] in [%lld] usec",
+                 tiz_state_to_str (to_state),
+                 static_cast< long long > (
+                     boost::chrono::duration_cast<
+                         boost::chrono::microseconds > (
+                         boost::chrono::steady_clock::now ()
+                         - transitions_start_)
+                         .count ()));
+      }
     }
   }
 
@@ -900,6 +933,7 @@ void graph::ops::record_error (const OMX_ERRORTYPE err_code,
 void graph::ops::clear_expected_transitions ()
 {
   expected_transitions_lst_.clear ();
+  transitions_timed_ = false;
 }
 
 void graph::ops::record_expected_transitions (const OMX_STATETYPE to_state)
@@ -913,6 +947,15 @@ void graph::ops::record_expected_transitions (const OMX_STATETYPE to_state)
   }
 }
 
+// Only graph-wide transitions are timed: the interval runs from just before
+// the first command was sent until the last component completes.
+void graph::ops::time_expected_transitions (
+    const boost::chrono::steady_clock::time_point &issued_at)
+{
+  transitions_start_ = issued_at;
+  transitions_timed_ = !expected_transitions_lst_.empty ();
+}
+
 void graph::ops::add_expected_transition (
     const OMX_HANDLETYPE handle, const OMX_STATETYPE to_state,
     const OMX_ERRORTYPE error /* = OMX_ErrorNone */)
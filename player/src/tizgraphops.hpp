@@ -29,6 +29,7 @@
 #ifndef TIZGRAPHOPS_HPP
 #define TIZGRAPHOPS_HPP
 
+#include <boost/chrono.hpp>
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
@@ -197,6 +198,8 @@ namespace tiz
 
       virtual void clear_expected_transitions ();
       virtual void record_expected_transitions (const OMX_STATETYPE to_state);
+      void time_expected_transitions (
+          const boost::chrono::steady_clock::time_point &issued_at);
       virtual void add_expected_transition (const OMX_HANDLETYPE handle,
                                             const OMX_STATETYPE to_state,
                                             const OMX_ERRORTYPE error
@@ -246,6 +249,8 @@ namespace tiz
       omx_hdl2name_map_t h2n_;
       tizgraphconfig_ptr_t config_;
       omx_event_info_lst_t expected_transitions_lst_;
+      boost::chrono::steady_clock::time_point transitions_start_;
+      bool transitions_timed_;
       omx_event_info_lst_t expected_port_transitions_lst_;
       tizplaylist_ptr_t playlist_;
       int position_;
@@ -29,8 +29,11 @@
 #include <config.h>
 #endif
 
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 #include <string>
+#include <vector>
 
 #include <OMX_Component.h>
 #include <OMX_Core.h>
@@ -51,6 +54,9 @@ namespace graph = tiz::graph;
 namespace  // Unnamed namespace
 {
 
+  // Set by the 'buffer-stats' program option
+  bool buffer_flow_stats_enabled = false;
+
   struct transition_to
   {
     transition_to (const OMX_STATETYPE to_state, const OMX_U32 useconds = 0)
@@ -61,13 +67,65 @@ namespace  // Unnamed namespace
     {
       if (OMX_ErrorNone == error_)
         error_ = OMX_SendCommand (handle, OMX_CommandStateSet, to_state_, NULL);
-      tiz_sleep (delay_);
+      if (delay_ > 0)
+      {
+        tiz_sleep (delay_);
+      }
     }
     const OMX_STATETYPE to_state_;
     OMX_U32 delay_;
     OMX_ERRORTYPE error_;
   };
 
+  void send_state_command (const OMX_HANDLETYPE handle,
+                           const OMX_STATETYPE to_state, OMX_ERRORTYPE *p_error)
+  {
+    *p_error = OMX_SendCommand (handle, OMX_CommandStateSet, to_state, NULL);
+  }
+
+  // OMX_SendCommand returns once the component has dispatched the command
+  // (libtizonia is built with SENDCOMMAND_SHOULD_BLOCK), and on Loaded->Idle
+  // that includes the resource manager round trip. Sending the commands from
+  // one thread per component overlaps those round trips, and each tunnel
+  // starts populating as soon as both of its ends have the command, instead
+  // of waiting for the rest of the graph.
+  OMX_ERRORTYPE transition_concurrently (
+      const omx_comp_handle_lst_t &hdl_list, const OMX_STATETYPE to)
+  {
+    std::vector< OMX_ERRORTYPE > errors (hdl_list.size (), OMX_ErrorNone);
+    boost::thread_group senders;
+    std::size_t first_local = 0;
+    try
+    {
+      for (; first_local + 1 < hdl_list.size (); ++first_local)
+      {
+        senders.create_thread (boost::bind (&send_state_command,
+                                            hdl_list[first_local], to,
+                                            &errors[first_local]));
+      }
+    }
+    catch (boost::thread_resource_error &)
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE,
+               "Unable to create a thread; sending the remaining commands "
+               "from this one");
+    }
+    for (std::size_t i = first_local; i < hdl_list.size (); ++i)
+    {
+      send_state_command (hdl_list[i], to, &errors[i]);
+    }
+    senders.join_all ();
+
+    BOOST_FOREACH (const OMX_ERRORTYPE error, errors)
+    {
+      if (OMX_ErrorNone != error)
+      {
+        return error;
+      }
+    }
+    return OMX_ErrorNone;
+  }
+
   struct transition_verify
   {
     transition_verify (const OMX_STATETYPE to_state)
@@ -422,10 +480,16 @@ graph::util::transition_all (const omx_comp_handle_lst_t &hdl_list,
   if ((to == OMX_StateIdle && from == OMX_StateLoaded)
       || (to == OMX_StateExecuting && from == OMX_StateIdle))
   {
+    // The order does not matter here: a supplier only starts populating (or
+    // exchanging buffers) once its peer announces, through the tunneled port
+    // status, that it is ready for it. So the commands are sent to all the
+    // components at once.
+    error = transition_concurrently (hdl_list, to);
+
+    // NOTE: Leave this commented code here - for testing purposes
     // Suppliers first, hence back to front order
-    error = (std::for_each (hdl_list.rbegin (), hdl_list.rend (),
-                            transition_to (to)))
-                .error_;
+    //       error = (std::for_each(hdl_list.rbegin(), hdl_list.rend(),
+    //                              transition_to(to))).error_;
 
     // NOTE: Leave this commented code here - for testing purposes
     // Non-suppliers first, hence front to back order
@@ -434,7 +498,9 @@ graph::util::transition_all (const omx_comp_handle_lst_t &hdl_list,
   }
   else
   {
-    // Non-suppliers first, hence front to back order
+    // Non-suppliers first, hence front to back order. On the way down the
+    // order is kept: a supplier frees its buffers on the peer, and errors
+    // from a peer that is not yet depopulating would go unnoticed.
     error = (std::for_each (hdl_list.begin (), hdl_list.end (),
                             transition_to (to)))
                 .error_;
@@ -1206,6 +1272,74 @@ bool graph::util::is_mpris_enabled ()
   return is_enabled;
 }
 
+void graph::util::enable_buffer_flow_stats (const bool enabled)
+{
+  buffer_flow_stats_enabled = enabled;
+}
+
+bool graph::util::is_buffer_flow_stats_enabled ()
+{
+  return buffer_flow_stats_enabled;
+}
+
+void graph::util::dump_buffer_flow_stats (const omx_comp_handle_lst_t &hdl_list,
+                                          const omx_hdl2name_map_t &h2n_map)
+{
+  BOOST_FOREACH (const OMX_HANDLETYPE handle, hdl_list)
+  {
+    OMX_INDEXTYPE id = OMX_IndexMax;
+    omx_hdl2name_map_t::const_iterator it = h2n_map.find (handle);
+    const std::string name = it != h2n_map.end () ? it->second : "?";
+    if (OMX_ErrorNone
+        != OMX_GetExtensionIndex (
+               handle,
+               const_cast< OMX_STRING > (
+                   OMX_TIZONIA_INDEX_CONFIG_BUFFER_FLOW_STATS),
+               &id))
+    {
+      continue;
+    }
+
+    // Stop at the first port index the component does not know about
+    OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE stats;
+    for (OMX_U32 pid = 0;; ++pid)
+    {
+      TIZ_INIT_OMX_PORT_STRUCT (stats, pid);
+      if (OMX_ErrorNone != OMX_GetConfig (handle, id, &stats))
+      {
+        break;
+      }
+      if (0 == pid)
+      {
+        TIZ_PRINTF_C04 (
+            "[%s] msgs %llu, latency avg %llu us max %u us, queue max %u, "
+            "ticks %llu, tick avg %llu us max %u us",
+            name.c_str (), (unsigned long long)stats.nSchedMessages,
+            (unsigned long long)(stats.nSchedMessages
+                                     ? stats.nSchedLatency
+                                           / stats.nSchedMessages
+                                     : 0),
+            (unsigned)stats.nSchedLatencyMax,
+            (unsigned)stats.nSchedQueueDepthMax,
+            (unsigned long long)stats.nTicks,
+            (unsigned long long)(stats.nTicks ? stats.nTickTime / stats.nTicks
+                                              : 0),
+            (unsigned)stats.nTickTimeMax);
+      }
+      TIZ_PRINTF_C04 (
+          "   port %u : received %llu, claimed %llu, released %llu, returned "
+          "%llu, ingress max %u, owned %.3f s, peer %.3f s",
+          (unsigned)pid, (unsigned long long)stats.nBuffersReceived,
+          (unsigned long long)stats.nBuffersClaimed,
+          (unsigned long long)stats.nBuffersReleased,
+          (unsigned long long)stats.nBuffersReturned,
+          (unsigned)stats.nIngressDepthMax,
+          stats.nComponentBufferTime / 1000000.0,
+          stats.nPeerBufferTime / 1000000.0);
+    }
+  }
+}
+
 void graph::util::copy_omx_string (
     OMX_U8 *p_dest, const std::string &omx_string,
     const size_t max_length /*  = OMX_MAX_STRINGNAME_SIZE */
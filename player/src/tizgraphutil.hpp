@@ -261,6 +261,13 @@ namespace tiz
 
       static bool is_mpris_enabled ();
 
+      static void enable_buffer_flow_stats (const bool enabled);
+
+      static bool is_buffer_flow_stats_enabled ();
+
+      static void dump_buffer_flow_stats (const omx_comp_handle_lst_t &hdl_list,
+                                          const omx_hdl2name_map_t &h2n_map);
+
       static void copy_omx_string (OMX_U8 *p_dest,
                                    const std::string &omx_string,
                                    const size_t max_length
@@ -0,0 +1,558 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizmedialib.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Persistent index of local media files
+ *
+ * The index is a text file, one record per line, with tab-separated fields
+ * (tabs, newlines and backslashes inside fields are escaped):
+ *
+ *   D <dir path> <mtime> <entry>...
+ *   T <file path> <mtime> <size> <codec> <container> <samplerate> <bitrate>
+ *     <channels> <bitdepth> <endianness> <sign> <cbr> <stream title>
+ *     <stream genre> <title> <artist> <album> <year> <comment> <track>
+ *     <genre> <length>
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <fstream>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <tizplatform.h>
+
+#include "tizprobe.hpp"
+#include "tizmedialib.hpp"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.play.medialib"
+#endif
+
+#define MEDIALIB_INDEX_HEADER "# tizonia media library index v1"
+#define MEDIALIB_TRACK_FIELDS 24
+
+namespace  // unnamed namespace
+{
+  std::string escape_field (const std::string &field)
+  {
+    std::string escaped;
+    escaped.reserve (field.size ());
+    for (std::string::const_iterator it = field.begin (); it != field.end ();
+         ++it)
+    {
+      switch (*it)
+      {
+        case '\\':
+          escaped.append ("\\\\");
+          break;
+        case '\t':
+          escaped.append ("\\t");
+          break;
+        case '\n':
+          escaped.append ("\\n");
+          break;
+        default:
+          escaped.push_back (*it);
+          break;
+      };
+    }
+    return escaped;
+  }
+
+  void split_record (const std::string &line,
+                     std::vector< std::string > &fields)
+  {
+    std::string field;
+    fields.clear ();
+    for (std::string::size_type i = 0; i < line.size (); ++i)
+    {
+      const char c = line[i];
+      if (c == '\t')
+      {
+        fields.push_back (field);
+        field.clear ();
+      }
+      else if (c == '\\' && i + 1 < line.size ())
+      {
+        const char next = line[++i];
+        field.push_back (next == 't' ? '\t' : (next == 'n' ? '\n' : next));
+      }
+      else
+      {
+        field.push_back (c);
+      }
+    }
+    fields.push_back (field);
+  }
+
+  template < typename T >
+  T to_number (const std::string &str)
+  {
+    try
+    {
+      return boost::lexical_cast< T > (str);
+    }
+    catch (const boost::bad_lexical_cast &)
+    {
+      return T ();
+    }
+  }
+
+  bool read_config_flag (const char *p_key)
+  {
+    const char *p_value = tiz_rcfile_get_value ("tizonia", p_key);
+    return (p_value && std::string (p_value).compare ("true") == 0);
+  }
+
+  std::string default_index_file ()
+  {
+    std::string cache_dir;
+    const char *p_xdg = getenv ("XDG_CACHE_HOME");
+    const char *p_home = getenv ("HOME");
+    if (p_xdg && *p_xdg)
+    {
+      cache_dir.assign (p_xdg);
+    }
+    else if (p_home && *p_home)
+    {
+      cache_dir.assign (p_home).append ("/.cache");
+    }
+    else
+    {
+      return std::string ();
+    }
+    return cache_dir.append ("/tizonia/medialib.idx");
+  }
+}  // unnamed namespace
+
+//
+// medialib::track_info
+//
+tiz::medialib::track_info::track_info ()
+  : path (),
+    mtime (0),
+    size (0),
+    codec_id (0),
+    container (0),
+    samplerate (0),
+    bitrate (0),
+    nchannels (0),
+    bitdepth (0),
+    endianness (0),
+    sign (0),
+    cbr (false)
+{
+}
+
+//
+// medialib
+//
+tiz::medialib &tiz::medialib::instance ()
+{
+  static medialib lib;
+  return lib;
+}
+
+tiz::medialib::medialib ()
+  : enabled_ (read_config_flag ("media-library-index")),
+    index_file_ (),
+    nthreads_ (0),
+    dirty_ (false),
+    stopping_ (false),
+    dirs_ (),
+    tracks_ (),
+    pending_ (),
+    active_workers_ (0),
+    workers_ (),
+    mutex_ ()
+{
+  const char *p_file
+      = tiz_rcfile_get_value ("tizonia", "media-library-index-file");
+  const char *p_threads
+      = tiz_rcfile_get_value ("tizonia", "media-library-scan-threads");
+
+  index_file_.assign (p_file && *p_file ? std::string (p_file)
+                                        : default_index_file ());
+  if (index_file_.empty ())
+  {
+    enabled_ = false;
+  }
+
+  if (p_threads)
+  {
+    nthreads_ = to_number< unsigned int > (p_threads);
+  }
+  if (0 == nthreads_)
+  {
+    nthreads_ = boost::thread::hardware_concurrency ();
+  }
+  if (0 == nthreads_)
+  {
+    nthreads_ = 1;
+  }
+
+  if (enabled_)
+  {
+    load ();
+  }
+}
+
+tiz::medialib::~medialib ()
+{
+  // The index is saved by stop (), at shutdown; here, only make sure that no
+  // worker outlives the instance
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    stopping_ = true;
+    pending_.clear ();
+  }
+  workers_.join_all ();
+}
+
+bool tiz::medialib::enabled () const
+{
+  return enabled_;
+}
+
+bool tiz::medialib::list_directory (const std::string &dir,
+                                    const bool recurse, uri_lst_t &files)
+{
+  struct stat st;
+  std::vector< std::string > entries;
+  bool cached = false;
+
+  if (stat (dir.c_str (), &st) != 0 || !S_ISDIR (st.st_mode))
+  {
+    return false;
+  }
+
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    dir_map_t::const_iterator it = dirs_.find (dir);
+    if (it != dirs_.end () && it->second.mtime == st.st_mtime)
+    {
+      entries = it->second.entries;
+      cached = true;
+    }
+  }
+
+  if (!cached)
+  {
+    dir_info info;
+    boost::system::error_code ec;
+    info.mtime = st.st_mtime;
+    for (boost::filesystem::directory_iterator it (dir, ec), end;
+         !ec && it != end; it.increment (ec))
+    {
+      const std::string name (it->path ().filename ().string ());
+      // Symlinked directories are not followed, same as
+      // recursive_directory_iterator
+      const bool is_dir
+          = boost::filesystem::is_directory (it->symlink_status ());
+      info.entries.push_back ((is_dir ? "d" : "f") + name);
+    }
+    if (ec)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : %s", dir.c_str (),
+               ec.message ().c_str ());
+      return false;
+    }
+    entries = info.entries;
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    dirs_[dir] = info;
+    dirty_ = true;
+  }
+
+  // Sub-directories are listed too, same as boost's directory iterators do;
+  // the extension filter takes care of them later.
+  for (std::vector< std::string >::const_iterator it = entries.begin ();
+       it != entries.end (); ++it)
+  {
+    const std::string path (
+        (boost::filesystem::path (dir) / it->substr (1)).string ());
+    files.push_back (path);
+    if (recurse && (*it)[0] == 'd')
+    {
+      (void)list_directory (path, recurse, files);
+    }
+  }
+  return true;
+}
+
+void tiz::medialib::scan (const uri_lst_t &files)
+{
+  if (!enabled_)
+  {
+    return;
+  }
+
+  uri_lst_t stale;
+  for (uri_lst_t::const_iterator it = files.begin (); it != files.end ();
+       ++it)
+  {
+    track_info info;
+    if (!lookup (*it, info))
+    {
+      stale.push_back (*it);
+    }
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%lu] of [%lu] tracks need probing",
+           (unsigned long)stale.size (), (unsigned long)files.size ());
+
+  if (!stale.empty ())
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    if (!stopping_)
+    {
+      pending_.insert (pending_.end (), stale.begin (), stale.end ());
+      while (active_workers_ < nthreads_ && active_workers_ < pending_.size ())
+      {
+        ++active_workers_;
+        workers_.create_thread (boost::bind (&medialib::scan_worker, this));
+      }
+    }
+  }
+}
+
+bool tiz::medialib::lookup (const std::string &path, track_info &info)
+{
+  struct stat st;
+
+  if (!enabled_)
+  {
+    return false;
+  }
+
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    track_map_t::const_iterator it = tracks_.find (path);
+    if (it == tracks_.end ())
+    {
+      return false;
+    }
+    info = it->second;
+  }
+
+  return (stat (path.c_str (), &st) == 0 && st.st_mtime == info.mtime
+          && st.st_size == info.size);
+}
+
+void tiz::medialib::store (const track_info &info)
+{
+  boost::lock_guard< boost::mutex > lock (mutex_);
+  tracks_[info.path] = info;
+  dirty_ = true;
+}
+
+void tiz::medialib::stop ()
+{
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    stopping_ = true;
+    pending_.clear ();
+  }
+  workers_.join_all ();
+  (void)save ();
+}
+
+void tiz::medialib::load ()
+{
+  std::ifstream in (index_file_.c_str ());
+  std::string line;
+  std::vector< std::string > fields;
+
+  if (!in.is_open () || !std::getline (in, line)
+      || line.compare (MEDIALIB_INDEX_HEADER) != 0)
+  {
+    TIZ_LOG (TIZ_PRIORITY_NOTICE, "No usable media library index at [%s]",
+             index_file_.c_str ());
+    return;
+  }
+
+  while (std::getline (in, line))
+  {
+    split_record (line, fields);
+    if (fields.size () >= 3 && fields[0].compare ("D") == 0)
+    {
+      dir_info dir;
+      dir.mtime = to_number< time_t > (fields[2]);
+      dir.entries.assign (fields.begin () + 3, fields.end ());
+      dirs_[fields[1]] = dir;
+    }
+    else if (fields.size () == MEDIALIB_TRACK_FIELDS
+             && fields[0].compare ("T") == 0)
+    {
+      track_info t;
+      size_t i = 1;
+      t.path = fields[i++];
+      t.mtime = to_number< time_t > (fields[i++]);
+      t.size = to_number< off_t > (fields[i++]);
+      t.codec_id = to_number< int > (fields[i++]);
+      t.container = to_number< int > (fields[i++]);
+      t.samplerate = to_number< OMX_U32 > (fields[i++]);
+      t.bitrate = to_number< OMX_U32 > (fields[i++]);
+      t.nchannels = to_number< OMX_U32 > (fields[i++]);
+      t.bitdepth = to_number< OMX_U32 > (fields[i++]);
+      t.endianness = to_number< int > (fields[i++]);
+      t.sign = to_number< int > (fields[i++]);
+      t.cbr = to_number< int > (fields[i++]) != 0;
+      t.stream_title = fields[i++];
+      t.stream_genre = fields[i++];
+      t.title = fields[i++];
+      t.artist = fields[i++];
+      t.album = fields[i++];
+      t.year = fields[i++];
+      t.comment = fields[i++];
+      t.track = fields[i++];
+      t.genre = fields[i++];
+      t.length = fields[i++];
+      tracks_[t.path] = t;
+    }
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Loaded [%lu] directories, [%lu] tracks",
+           (unsigned long)dirs_.size (), (unsigned long)tracks_.size ());
+}
+
+bool tiz::medialib::save ()
+{
+  boost::lock_guard< boost::mutex > lock (mutex_);
+
+  if (!enabled_ || !dirty_)
+  {
+    return true;
+  }
+
+  const std::string tmp_file (index_file_ + ".tmp");
+  boost::system::error_code ec;
+  boost::filesystem::create_directories (
+      boost::filesystem::path (index_file_).parent_path (), ec);
+
+  {
+    std::ofstream out (tmp_file.c_str (), std::ios::out | std::ios::trunc);
+    if (!out.is_open ())
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to write [%s]", tmp_file.c_str ());
+      return false;
+    }
+
+    out << MEDIALIB_INDEX_HEADER << '\n';
+
+    for (dir_map_t::const_iterator it = dirs_.begin (); it != dirs_.end ();
+         ++it)
+    {
+      out << "D\t" << escape_field (it->first) << '\t' << it->second.mtime;
+      for (std::vector< std::string >::const_iterator e
+           = it->second.entries.begin ();
+           e != it->second.entries.end (); ++e)
+      {
+        out << '\t' << escape_field (*e);
+      }
+      out << '\n';
+    }
+
+    for (track_map_t::const_iterator it = tracks_.begin ();
+         it != tracks_.end (); ++it)
+    {
+      const track_info &t = it->second;
+      out << "T\t" << escape_field (t.path) << '\t' << t.mtime << '\t'
+          << t.size << '\t' << t.codec_id << '\t' << t.container << '\t'
+          << t.samplerate << '\t' << t.bitrate << '\t' << t.nchannels << '\t'
+          << t.bitdepth << '\t' << t.endianness << '\t' << t.sign << '\t'
+          << (t.cbr ? 1 : 0) << '\t' << escape_field (t.stream_title) << '\t'
+          << escape_field (t.stream_genre) << '\t' << escape_field (t.title)
+          << '\t' << escape_field (t.artist) << '\t' << escape_field (t.album)
+          << '\t' << escape_field (t.year) << '\t' << escape_field (t.comment)
+          << '\t' << escape_field (t.track) << '\t' << escape_field (t.genre)
+          << '\t' << escape_field (t.length) << '\n';
+    }
+
+    if (!out.good ())
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Error writing [%s]", tmp_file.c_str ());
+      return false;
+    }
+  }
+
+  if (rename (tmp_file.c_str (), index_file_.c_str ()) != 0)
+  {
+    TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to rename [%s]", tmp_file.c_str ());
+    return false;
+  }
+
+  dirty_ = false;
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Saved [%lu] directories, [%lu] tracks",
+           (unsigned long)dirs_.size (), (unsigned long)tracks_.size ());
+  return true;
+}
+
+void tiz::medialib::scan_worker ()
+{
+  for (;;)
+  {
+    std::string path;
+    {
+      boost::lock_guard< boost::mutex > lock (mutex_);
+      if (stopping_ || pending_.empty ())
+      {
+        --active_workers_;
+        break;
+      }
+      path = pending_.front ();
+      pending_.pop_front ();
+    }
+
+    track_info info;
+    tiz::probe probe (path, true);
+    if (probe.fill_track_info (info))
+    {
+      store (info);
+    }
+    else
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "Unable to probe [%s]", path.c_str ());
+    }
+  }
+
+  bool last_worker = false;
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    last_worker = (0 == active_workers_ && !stopping_);
+  }
+  if (last_worker)
+  {
+    // Persist what we have; the list may be picked up by a new scan later.
+    (void)save ();
+  }
+}
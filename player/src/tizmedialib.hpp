@@ -0,0 +1,157 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizmedialib.hpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Persistent index of local media files
+ *
+ *
+ */
+
+#ifndef TIZMEDIALIB_HPP
+#define TIZMEDIALIB_HPP
+
+#include <sys/types.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include <OMX_Types.h>
+
+#include "tizgraphtypes.hpp"
+
+namespace tiz
+{
+  /**
+   * On-disk index of the local media library. It remembers directory
+   * listings (keyed by the directory's mtime) and the result of probing each
+   * track (keyed by the file's mtime and size), so that playlists can be
+   * assembled and tracks probed without opening any media files.
+   *
+   * Stale or missing track entries are probed in the background by a small
+   * pool of threads.
+   */
+  class medialib
+  {
+  public:
+    struct track_info
+    {
+      track_info ();
+
+      std::string path;
+      time_t mtime;
+      off_t size;
+      int codec_id;
+      int container;
+      OMX_U32 samplerate;
+      OMX_U32 bitrate;
+      OMX_U32 nchannels;
+      OMX_U32 bitdepth;
+      int endianness;
+      int sign;
+      bool cbr;
+      std::string stream_title;
+      std::string stream_genre;
+      std::string title;
+      std::string artist;
+      std::string album;
+      std::string year;
+      std::string comment;
+      std::string track;
+      std::string genre;
+      std::string length;
+    };
+
+  public:
+    static medialib &instance ();
+
+    bool enabled () const;
+
+    /**
+     * List the files in a directory (recursively, if requested), using the
+     * cached listing for every directory that hasn't changed since the last
+     * run.
+     */
+    bool list_directory (const std::string &dir, const bool recurse,
+                         uri_lst_t &files);
+
+    /**
+     * Queue the files that have no up-to-date entry in the index for
+     * background probing.
+     */
+    void scan (const uri_lst_t &files);
+
+    /**
+     * Retrieve the entry for a file, if it's still valid (only stats the
+     * file).
+     */
+    bool lookup (const std::string &path, track_info &info);
+
+    void store (const track_info &info);
+
+    /**
+     * Stop the background probing and write the index to disk. This is to be
+     * called at shutdown, while the rest of the program is still up; the
+     * index is not saved when the instance is destroyed.
+     */
+    void stop ();
+
+  private:
+    struct dir_info
+    {
+      time_t mtime;
+      // Entry names, prefixed with 'd' (directory) or 'f' (anything else)
+      std::vector< std::string > entries;
+    };
+
+    typedef std::map< std::string, dir_info > dir_map_t;
+    typedef std::map< std::string, track_info > track_map_t;
+
+  private:
+    medialib ();
+    ~medialib ();
+    medialib (const medialib &);
+    medialib &operator= (const medialib &);
+
+    void load ();
+    bool save ();
+    void scan_worker ();
+
+  private:
+    bool enabled_;
+    std::string index_file_;
+    unsigned int nthreads_;
+    bool dirty_;
+    bool stopping_;
+    dir_map_t dirs_;
+    track_map_t tracks_;
+    std::deque< std::string > pending_;
+    unsigned int active_workers_;
+    boost::thread_group workers_;
+    boost::mutex mutex_;
+  };
+}  // namespace tiz
+
+#endif  // TIZMEDIALIB_HPP
@@ -38,25 +38,43 @@
 #include <stdio.h>
 #include <string>
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include "tizplatform.h"
 
 #include "tizomxutil.hpp"
 
+namespace
+{
+  // The IL Core is shared by the graph managers and the decoded PCM cache,
+  // which may come and go independently; it is only shut down when the last
+  // of them is done with it.
+  boost::mutex init_mutex;
+  unsigned int init_count = 0;
+}
+
 void tiz::omxutil::init ()
 {
   OMX_ERRORTYPE ret = OMX_ErrorNone;
+  boost::lock_guard< boost::mutex > lock (init_mutex);
 
-  if (OMX_ErrorNone != (ret = OMX_Init ()))
+  if (0 == init_count && OMX_ErrorNone != (ret = OMX_Init ()))
   {
     fprintf (stderr, "FATAL. Could not init OpenMAX IL : %s",
              tiz_err_to_str (ret));
     exit (EXIT_FAILURE);
   }
+  ++init_count;
 }
 
 void tiz::omxutil::deinit ()
 {
-  (void)OMX_Deinit ();
+  boost::lock_guard< boost::mutex > lock (init_mutex);
+  if (init_count > 0 && 0 == --init_count)
+  {
+    (void)OMX_Deinit ();
+  }
 }
 
 OMX_ERRORTYPE
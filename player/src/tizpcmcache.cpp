@@ -0,0 +1,605 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizpcmcache.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Bounded cache of decoded PCM
+ *
+ * Each entry is a canonical 44-byte header WAV file named after the 64-bit
+ * FNV-1a hash of "<path> <mtime> <size> <sample format>". The access time
+ * of an entry is recorded in the file's mtime, so that the LRU order
+ * survives across runs.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <fstream>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <OMX_Audio.h>
+#include <OMX_Component.h>
+
+#include <tizplatform.h>
+
+#include "tizmedialib.hpp"
+#include "tizomxutil.hpp"
+#include "tizprobe.hpp"
+#include "tiztranscoder.hpp"
+#include "tizpcmcache.hpp"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.play.pcmcache"
+#endif
+
+// Identifies the sample format of the cached data; part of the key, so that
+// changing it invalidates all existing entries.
+#define PCMCACHE_SAMPLE_FORMAT "s16le-interleaved"
+#define PCMCACHE_DEFAULT_MAX_SIZE_MB 1024
+#define PCMCACHE_WAV_HEADER_SIZE 44
+
+namespace  // unnamed namespace
+{
+  std::string default_cache_dir ()
+  {
+    std::string cache_dir;
+    const char *p_xdg = getenv ("XDG_CACHE_HOME");
+    const char *p_home = getenv ("HOME");
+    if (p_xdg && *p_xdg)
+    {
+      cache_dir.assign (p_xdg);
+    }
+    else if (p_home && *p_home)
+    {
+      cache_dir.assign (p_home).append ("/.cache");
+    }
+    else
+    {
+      return std::string ();
+    }
+    return cache_dir.append ("/tizonia/pcm");
+  }
+
+  uint64_t fnv1a (const std::string &str)
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for (std::string::const_iterator it = str.begin (); it != str.end (); ++it)
+    {
+      hash ^= static_cast< unsigned char >(*it);
+      hash *= 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  void put_le16 (std::string &buf, const uint32_t value)
+  {
+    buf.push_back (static_cast< char >(value & 0xff));
+    buf.push_back (static_cast< char >((value >> 8) & 0xff));
+  }
+
+  void put_le32 (std::string &buf, const uint32_t value)
+  {
+    put_le16 (buf, value & 0xffff);
+    put_le16 (buf, value >> 16);
+  }
+
+  std::string wav_header (const OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype,
+                          const uint32_t data_size)
+  {
+    const uint32_t block_align
+        = pcmtype.nChannels * (pcmtype.nBitPerSample / 8);
+    std::string header;
+    header.reserve (PCMCACHE_WAV_HEADER_SIZE);
+    header.append ("RIFF");
+    put_le32 (header, data_size + PCMCACHE_WAV_HEADER_SIZE - 8);
+    header.append ("WAVEfmt ");
+    put_le32 (header, 16);
+    put_le16 (header, 1);  // WAVE_FORMAT_PCM
+    put_le16 (header, pcmtype.nChannels);
+    put_le32 (header, pcmtype.nSamplingRate);
+    put_le32 (header, pcmtype.nSamplingRate * block_align);
+    put_le16 (header, block_align);
+    put_le16 (header, pcmtype.nBitPerSample);
+    header.append ("data");
+    put_le32 (header, data_size);
+    return header;
+  }
+
+  // Prepend a WAV header to the raw samples in 'raw_path'
+  bool write_wav_file (const std::string &raw_path, const std::string &wav_path,
+                       const OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype)
+  {
+    struct stat st;
+    if (stat (raw_path.c_str (), &st) != 0 || st.st_size == 0
+        || st.st_size > 0xffffffffLL - PCMCACHE_WAV_HEADER_SIZE)
+    {
+      return false;
+    }
+
+    std::ifstream in (raw_path.c_str (), std::ios::binary);
+    std::ofstream out (wav_path.c_str (), std::ios::binary | std::ios::trunc);
+    if (!in || !out)
+    {
+      return false;
+    }
+
+    const std::string header
+        = wav_header (pcmtype, static_cast< uint32_t >(st.st_size));
+    out.write (header.data (), header.size ());
+    out << in.rdbuf ();
+    out.close ();
+    return !out.fail ();
+  }
+
+  bool read_config_flag (const char *p_key)
+  {
+    const char *p_value = tiz_rcfile_get_value ("tizonia", p_key);
+    return (p_value && std::string (p_value).compare ("true") == 0);
+  }
+}  // unnamed namespace
+
+//
+// pcmcache::stats
+//
+tiz::pcmcache::stats::stats () : hits (0), misses (0), fills (0), evictions (0)
+{
+}
+
+//
+// pcmcache
+//
+tiz::pcmcache &tiz::pcmcache::instance ()
+{
+  static pcmcache cache;
+  return cache;
+}
+
+tiz::pcmcache::pcmcache ()
+  : enabled_ (read_config_flag ("pcm-cache")),
+    dir_ (),
+    max_bytes_ (0),
+    total_bytes_ (0),
+    entries_ (),
+    requested_ (),
+    pending_ (),
+    queued_ (),
+    pinned_ (),
+    stopping_ (false),
+    filling_ (false),
+    playing_ (false),
+    interrupted_ (false),
+    p_job_ (NULL),
+    stats_ (),
+    worker_ (),
+    mutex_ (),
+    cond_ ()
+{
+  const char *p_dir = tiz_rcfile_get_value ("tizonia", "pcm-cache-directory");
+  const char *p_size = tiz_rcfile_get_value ("tizonia", "pcm-cache-max-size");
+
+  dir_.assign (p_dir && *p_dir ? std::string (p_dir) : default_cache_dir ());
+  if (dir_.empty ())
+  {
+    enabled_ = false;
+  }
+
+  off_t max_mb = PCMCACHE_DEFAULT_MAX_SIZE_MB;
+  if (p_size)
+  {
+    try
+    {
+      max_mb = boost::lexical_cast< off_t >(p_size);
+    }
+    catch (const boost::bad_lexical_cast &)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Invalid pcm-cache-max-size [%s]", p_size);
+    }
+  }
+  max_bytes_ = max_mb * 1024 * 1024;
+
+  if (enabled_)
+  {
+    load ();
+  }
+}
+
+tiz::pcmcache::~pcmcache ()
+{
+  stop ();
+}
+
+bool tiz::pcmcache::enabled () const
+{
+  return enabled_;
+}
+
+bool tiz::pcmcache::lookup (const uri_lst_t &uris, uri_lst_t &cached)
+{
+  if (!enabled_ || uris.empty ())
+  {
+    return false;
+  }
+
+  std::vector< std::string > keys;
+  keys.reserve (uris.size ());
+  for (uri_lst_t::const_iterator it = uris.begin (); it != uris.end (); ++it)
+  {
+    keys.push_back (key (*it));
+    if (keys.back ().empty ())
+    {
+      // Not a local file
+      return false;
+    }
+  }
+
+  boost::lock_guard< boost::mutex > lock (mutex_);
+  // The previous list is done; its entries may go now. A fill waits until
+  // this one has been played.
+  pinned_.clear ();
+  playing_ = true;
+  bool all_cached = true;
+  for (std::size_t i = 0; i < keys.size () && all_cached; ++i)
+  {
+    all_cached = (entries_.find (keys[i]) != entries_.end ());
+  }
+
+  if (all_cached)
+  {
+    const time_t now = time (NULL);
+    cached.clear ();
+    for (std::size_t i = 0; i < keys.size (); ++i)
+    {
+      entry &e = entries_[keys[i]];
+      e.last_used = now;
+      (void)utime (e.path.c_str (), NULL);
+      cached.push_back (e.path);
+      pinned_.insert (keys[i]);
+    }
+    stats_.hits += keys.size ();
+    TIZ_LOG (TIZ_PRIORITY_NOTICE, "Playing [%lu] tracks from the cache",
+             (unsigned long)keys.size ());
+    return true;
+  }
+
+  stats_.misses += keys.size ();
+  for (std::size_t i = 0; i < keys.size (); ++i)
+  {
+    const std::string &k = keys[i];
+    if (entries_.find (k) != entries_.end () || queued_.count (k) > 0)
+    {
+      continue;
+    }
+    if (requested_.insert (k).second)
+    {
+      // First request; only remember it
+      continue;
+    }
+    pending_.push_back (std::make_pair (uris[i], k));
+    queued_.insert (k);
+  }
+
+  if (!pending_.empty () && !filling_ && !stopping_)
+  {
+    if (worker_.joinable ())
+    {
+      // The previous worker is exiting (or has exited) already
+      worker_.join ();
+    }
+    filling_ = true;
+    worker_ = boost::thread (boost::bind (&pcmcache::fill_worker, this));
+  }
+  return false;
+}
+
+void tiz::pcmcache::set_playing (const bool playing)
+{
+  boost::lock_guard< boost::mutex > lock (mutex_);
+  playing_ = playing;
+  if (playing_ && p_job_)
+  {
+    interrupted_ = true;
+    p_job_->cancel ();
+  }
+  cond_.notify_all ();
+}
+
+tiz::pcmcache::stats tiz::pcmcache::get_stats ()
+{
+  boost::lock_guard< boost::mutex > lock (mutex_);
+  return stats_;
+}
+
+void tiz::pcmcache::stop ()
+{
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    if (stopping_)
+    {
+      return;
+    }
+    stopping_ = true;
+    cond_.notify_all ();
+    pending_.clear ();
+    queued_.clear ();
+    if (p_job_)
+    {
+      p_job_->cancel ();
+    }
+  }
+
+  if (worker_.joinable ())
+  {
+    worker_.join ();
+  }
+
+  if (enabled_)
+  {
+    TIZ_LOG (TIZ_PRIORITY_NOTICE,
+             "hits [%lu] misses [%lu] fills [%lu] evictions [%lu] "
+             "entries [%lu] size [%lld]",
+             stats_.hits, stats_.misses, stats_.fills, stats_.evictions,
+             (unsigned long)entries_.size (), (long long)total_bytes_);
+  }
+}
+
+std::string tiz::pcmcache::key (const std::string &uri) const
+{
+  struct stat st;
+  if (stat (uri.c_str (), &st) != 0 || !S_ISREG (st.st_mode))
+  {
+    return std::string ();
+  }
+
+  std::ostringstream oss;
+  oss << uri << '\t' << st.st_mtime << '\t' << st.st_size << '\t'
+      << PCMCACHE_SAMPLE_FORMAT;
+
+  char hex[17];
+  snprintf (hex, sizeof (hex), "%016llx",
+            static_cast< unsigned long long >(fnv1a (oss.str ())));
+  return std::string (hex);
+}
+
+std::string tiz::pcmcache::entry_path (const std::string &key) const
+{
+  return dir_ + "/" + key + ".wav";
+}
+
+void tiz::pcmcache::load ()
+{
+  namespace bf = boost::filesystem;
+  boost::system::error_code ec;
+
+  bf::create_directories (dir_, ec);
+  if (!bf::is_directory (dir_, ec))
+  {
+    TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to use [%s]; cache disabled",
+             dir_.c_str ());
+    enabled_ = false;
+    return;
+  }
+
+  for (bf::directory_iterator it (dir_, ec), end; !ec && it != end;
+       it.increment (ec))
+  {
+    const bf::path &path = it->path ();
+    if (path.extension () == ".part")
+    {
+      // Leftovers from an interrupted fill
+      bf::remove (path, ec);
+      continue;
+    }
+
+    struct stat st;
+    if (path.extension () != ".wav" || path.stem ().string ().size () != 16
+        || stat (path.string ().c_str (), &st) != 0)
+    {
+      continue;
+    }
+
+    entry &e = entries_[path.stem ().string ()];
+    e.path = path.string ();
+    e.size = st.st_size;
+    e.last_used = st.st_mtime;
+    total_bytes_ += st.st_size;
+  }
+
+  evict ();
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%lu] entries, [%lld] bytes in [%s]",
+           (unsigned long)entries_.size (), (long long)total_bytes_,
+           dir_.c_str ());
+}
+
+void tiz::pcmcache::fill_worker ()
+{
+  // The OpenMAX IL core may be shut down by the graph manager while a fill
+  // is in progress; tiz::omxutil counts its users.
+  tiz::omxutil::init ();
+
+  for (;;)
+  {
+    std::pair< std::string, std::string > next;
+    {
+      boost::unique_lock< boost::mutex > lock (mutex_);
+      while (playing_ && !stopping_)
+      {
+        cond_.wait (lock);
+      }
+      if (stopping_ || pending_.empty ())
+      {
+        filling_ = false;
+        break;
+      }
+      next = pending_.front ();
+      pending_.pop_front ();
+    }
+
+    const bool filled = fill (next.first, next.second);
+
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    if (interrupted_ && !stopping_)
+    {
+      // Playback has started; try again when it stops
+      interrupted_ = false;
+      pending_.push_front (next);
+      continue;
+    }
+    queued_.erase (next.second);
+    if (filled)
+    {
+      ++stats_.fills;
+    }
+  }
+
+  tiz::omxutil::deinit ();
+}
+
+bool tiz::pcmcache::fill (const std::string &uri, const std::string &key)
+{
+  const std::string path (entry_path (key));
+  const std::string raw_path (path + ".pcm.part");
+  const std::string wav_path (path + ".part");
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmtype;
+  bool decoded = false;
+  double duration = 0.0;
+
+  {
+    // A bitrate of 0 means no encoder, i.e. the raw decoder output is
+    // written to the file
+    tiz::transcode_job job (uri, raw_path, 0);
+    {
+      boost::lock_guard< boost::mutex > lock (mutex_);
+      if (stopping_ || playing_)
+      {
+        interrupted_ = playing_;
+        return false;
+      }
+      p_job_ = &job;
+    }
+
+    decoded = job.run (duration);
+    pcmtype = job.pcm_info ();
+    if (!decoded)
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "Unable to decode [%s] : %s", uri.c_str (),
+               job.error_msg ().c_str ());
+    }
+
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    p_job_ = NULL;
+  }  // The graph is destroyed here, which closes the output file
+
+  const bool written
+      = decoded && write_wav_file (raw_path, wav_path, pcmtype)
+        && 0 == rename (wav_path.c_str (), path.c_str ());
+  (void)unlink (raw_path.c_str ());
+  (void)unlink (wav_path.c_str ());
+
+  struct stat st;
+  if (!written || stat (path.c_str (), &st) != 0)
+  {
+    return false;
+  }
+
+  // Index the cached file with the original track's tags, so that the
+  // track is displayed the same way when played from the cache.
+  tiz::medialib &lib = tiz::medialib::instance ();
+  if (lib.enabled ())
+  {
+    medialib::track_info info;
+    if (!lib.lookup (uri, info))
+    {
+      tiz::probe probe (uri, true);
+      (void)probe.fill_track_info (info);
+    }
+    info.path = path;
+    info.mtime = st.st_mtime;
+    info.size = st.st_size;
+    info.codec_id = OMX_AUDIO_CodingPCM;
+    info.container = OMX_FORMAT_RAW;
+    info.samplerate = pcmtype.nSamplingRate;
+    info.nchannels = pcmtype.nChannels;
+    info.bitdepth = pcmtype.nBitPerSample;
+    info.bitrate = pcmtype.nSamplingRate * pcmtype.nChannels
+                   * pcmtype.nBitPerSample;
+    info.endianness = OMX_EndianLittle;
+    info.sign = OMX_NumericalDataSigned;
+    info.cbr = true;
+    lib.store (info);
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "Cached [%s] as [%s] ([%lld] bytes)",
+           uri.c_str (), path.c_str (), (long long)st.st_size);
+
+  boost::lock_guard< boost::mutex > lock (mutex_);
+  entry &e = entries_[key];
+  e.path = path;
+  e.size = st.st_size;
+  e.last_used = st.st_mtime;
+  total_bytes_ += st.st_size;
+  evict ();
+  return true;
+}
+
+// NOTE: This must be called with mutex_ held (or before any other thread
+// can use the cache)
+void tiz::pcmcache::evict ()
+{
+  while (total_bytes_ > max_bytes_)
+  {
+    // The entries of the list that is being played are left alone
+    entry_map_t::iterator lru = entries_.end ();
+    for (entry_map_t::iterator it = entries_.begin (); it != entries_.end ();
+         ++it)
+    {
+      if (pinned_.count (it->first) == 0
+          && (lru == entries_.end ()
+              || it->second.last_used < lru->second.last_used))
+      {
+        lru = it;
+      }
+    }
+
+    if (lru == entries_.end ())
+    {
+      break;
+    }
+
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Evicting [%s]", lru->second.path.c_str ());
+    (void)unlink (lru->second.path.c_str ());
+    total_bytes_ -= lru->second.size;
+    entries_.erase (lru);
+    ++stats_.evictions;
+  }
+}
@@ -0,0 +1,148 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizpcmcache.hpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Bounded cache of decoded PCM
+ *
+ *
+ */
+
+#ifndef TIZPCMCACHE_HPP
+#define TIZPCMCACHE_HPP
+
+#include <sys/types.h>
+#include <time.h>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+
+#include <boost/thread.hpp>
+
+#include "tizgraphtypes.hpp"
+
+namespace tiz
+{
+  class transcode_job;
+
+  /**
+   * On-disk cache of decoded local tracks, stored as 16-bit WAV files and
+   * keyed by the track's path, mtime and size, and by the cached sample
+   * format. When every track of a playlist segment is in the cache, the
+   * segment can be played by the PCM decoder instead of the track's own
+   * decoder.
+   *
+   * Tracks are only decoded into the cache (by a background thread) the
+   * second time they are requested, so that playing through a playlist once
+   * costs nothing extra, and only while nothing is being played, so that a
+   * track is never decoded twice at the same time. The least recently used
+   * entries are evicted when the cache grows beyond its maximum size, except
+   * those that are being played.
+   */
+  class pcmcache
+  {
+  public:
+    struct stats
+    {
+      stats ();
+
+      unsigned long hits;       // tracks played from the cache
+      unsigned long misses;     // tracks played from the original file
+      unsigned long fills;      // tracks decoded into the cache
+      unsigned long evictions;  // entries removed to make room
+    };
+
+  public:
+    static pcmcache &instance ();
+
+    bool enabled () const;
+
+    /**
+     * Look up a list of tracks that is about to be played. Succeeds only if
+     * all of them are in the cache, in which case 'cached' receives the paths
+     * of the cached files, in the same order; these are not evicted until the
+     * next lookup. Tracks that have been requested before but are not in the
+     * cache yet are queued for decoding.
+     */
+    bool lookup (const uri_lst_t &uris, uri_lst_t &cached);
+
+    /**
+     * Tell the cache whether a track is being played. Decoding into the cache
+     * waits until playback is paused or stopped; a decoding that is in
+     * progress when playback starts is abandoned and retried later.
+     */
+    void set_playing (const bool playing);
+
+    stats get_stats ();
+
+    /**
+     * Cancel any pending or ongoing decoding.
+     */
+    void stop ();
+
+  private:
+    struct entry
+    {
+      std::string path;
+      off_t size;
+      time_t last_used;
+    };
+
+    typedef std::map< std::string, entry > entry_map_t;
+
+  private:
+    pcmcache ();
+    ~pcmcache ();
+    pcmcache (const pcmcache &);
+    pcmcache &operator= (const pcmcache &);
+
+    std::string key (const std::string &uri) const;
+    std::string entry_path (const std::string &key) const;
+    void load ();
+    void fill_worker ();
+    bool fill (const std::string &uri, const std::string &key);
+    void evict ();
+
+  private:
+    bool enabled_;
+    std::string dir_;
+    off_t max_bytes_;
+    off_t total_bytes_;
+    entry_map_t entries_;
+    std::set< std::string > requested_;
+    std::deque< std::pair< std::string, std::string > > pending_;
+    std::set< std::string > queued_;
+    std::set< std::string > pinned_;
+    bool stopping_;
+    bool filling_;
+    bool playing_;
+    bool interrupted_;
+    transcode_job *p_job_;
+    stats stats_;
+    boost::thread worker_;
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+  };
+}  // namespace tiz
+
+#endif  // TIZPCMCACHE_HPP
@@ -46,6 +46,7 @@
 #include <string.h>
 #include <sys/utsname.h>
 
+#include <algorithm>
 #include <cstdlib>
 
 #include <boost/algorithm/string/join.hpp>
@@ -67,7 +68,11 @@
 #include "tizdaemon.hpp"
 #include "tizgraphmgr.hpp"
 #include "tizgraphtypes.hpp"
+#include "tizgraphutil.hpp"
+#include "tizmedialib.hpp"
 #include "tizomxutil.hpp"
+#include "tizpcmcache.hpp"
+#include "tiztranscoder.hpp"
 #include <decoders/tizdecgraphmgr.hpp>
 #include <httpclnt/tizhttpclntmgr.hpp>
 #include <httpserv/tizhttpservconfig.hpp>
@@ -643,6 +648,8 @@ void tiz::playapp::set_option_handlers ()
       "log-directory", boost::bind (&tiz::playapp::unique_log_file, this));
   popts_.set_option_handler (
       "debug-info", boost::bind (&tiz::playapp::print_debug_info, this));
+  popts_.set_option_handler (
+      "buffer-stats", boost::bind (&tiz::playapp::enable_buffer_stats, this));
   // OMX-related program options
   popts_.set_option_handler ("comp-list",
                              boost::bind (&tiz::playapp::list_of_comps, this));
@@ -656,6 +663,9 @@ void tiz::playapp::set_option_handlers ()
   // streaming audio server program options
   popts_.set_option_handler ("serve-stream",
                              boost::bind (&tiz::playapp::serve_stream, this));
+  // offline batch transcoding program options
+  popts_.set_option_handler ("transcode",
+                             boost::bind (&tiz::playapp::transcode, this));
   // streaming audio client program options
   popts_.set_option_handler ("decode-stream",
                              boost::bind (&tiz::playapp::decode_stream, this));
@@ -751,6 +761,13 @@ tiz::playapp::unique_log_file () const
   return OMX_ErrorNone;
 }
 
+OMX_ERRORTYPE
+tiz::playapp::enable_buffer_stats () const
+{
+  tiz::graph::util::enable_buffer_flow_stats (popts_.buffer_stats ());
+  return OMX_ErrorNone;
+}
+
 OMX_ERRORTYPE
 tiz::playapp::print_debug_info () const
 {
@@ -966,6 +983,10 @@ tiz::playapp::decode_local ()
 
   (void)daemonize_if_requested ();
 
+  // Probe new or modified tracks in the background, so that they can be
+  // served from the media library index.
+  tiz::medialib::instance ().scan (file_list);
+
   tizplaylist_ptr_t playlist
       = boost::make_shared< tiz::playlist > (tiz::playlist (file_list));
 
@@ -986,6 +1007,19 @@ tiz::playapp::decode_local ()
   p_mgr->quit ();
   p_mgr->deinit ();
 
+  tiz::pcmcache &cache = tiz::pcmcache::instance ();
+  if (cache.enabled ())
+  {
+    cache.stop ();
+    const tiz::pcmcache::stats stats = cache.get_stats ();
+    fprintf (stdout,
+             "PCM cache: %lu hits, %lu misses, %lu tracks decoded, "
+             "%lu evicted.\n",
+             stats.hits, stats.misses, stats.fills, stats.evictions);
+  }
+
+  tiz::medialib::instance ().stop ();
+
   return rc;
 }
 
@@ -1027,6 +1061,8 @@ tiz::playapp::serve_stream ()
 
   (void)daemonize_if_requested ();
 
+  tiz::medialib::instance ().scan (file_list);
+
   // Retrieve the hostname and ip address
   if (!get_host_name_and_ip (hostname, ip_address, error_msg))
   {
@@ -1079,6 +1115,115 @@ tiz::playapp::serve_stream ()
   p_mgr->quit ();
   p_mgr->deinit ();
 
+  tiz::medialib::instance ().stop ();
+
+  return rc;
+}
+
+OMX_ERRORTYPE
+tiz::playapp::transcode ()
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  const uri_lst_t &uri_list = popts_.uri_list ();
+  const bool recurse = popts_.recurse ();
+  const std::string &output_dir = popts_.transcode_output_dir ();
+  const uint32_t bitrate = popts_.transcode_bitrate ();
+  const bool benchmark = popts_.transcode_benchmark ();
+  const std::string &bench_json = popts_.transcode_benchmark_json ();
+  const bool overwrite = popts_.transcode_force ();
+  uint32_t jobs = popts_.transcode_jobs ();
+  if (benchmark)
+  {
+    // Benchmark figures are sampled process-wide, so graphs run one at a
+    // time (the options parser has rejected any other number of jobs)
+    jobs = 1;
+  }
+  else if (0 == jobs)
+  {
+    jobs = std::max (1u, boost::thread::hardware_concurrency ());
+  }
+
+  uri_lst_t file_list;
+  std::string error_msg;
+
+  print_banner ();
+
+  file_extension_lst_t extension_list;
+  // These are the formats that can be decoded to 16-bit PCM
+  extension_list.insert (".mp3");
+  extension_list.insert (".opus");
+  extension_list.insert (".flac");
+  extension_list.insert (".aac");
+  extension_list.insert (".wav");
+  if (benchmark)
+  {
+    // The null renderer takes any decoder output, so Vorbis, Ogg FLAC and
+    // MPEG layer II files can be benchmarked too
+    extension_list.insert (".ogg");
+    extension_list.insert (".oga");
+    extension_list.insert (".mp2");
+  }
+
+  BOOST_FOREACH (std::string uri, uri_list)
+  {
+    if (!tizplaylist_t::assemble_play_list (uri, false, recurse,
+                                            extension_list, file_list,
+                                            error_msg))
+    {
+      TIZ_PRINTF_C01 ("%s (%s).", error_msg.c_str (), uri.c_str ());
+      player_exit_failure ();
+    }
+  }
+
+  if (!benchmark)
+  {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories (output_dir, ec);
+    if (!boost::filesystem::is_directory (output_dir))
+    {
+      TIZ_PRINTF_C01 ("Unable to use the output directory (%s).",
+                      output_dir.c_str ());
+      player_exit_failure ();
+    }
+  }
+
+  (void)daemonize_if_requested ();
+
+  if (benchmark)
+  {
+    fprintf (stdout,
+             "Decoding %lu files into a null renderer, one at a time.\n\n",
+             (unsigned long)file_list.size ());
+  }
+  else
+  {
+    fprintf (stdout, "Transcoding %lu files to MP3 (%u kbps), %u jobs.\n\n",
+             (unsigned long)file_list.size (), bitrate, jobs);
+  }
+
+  tiz::omxutil::init ();
+  tiz::transcoder transcoder (file_list, output_dir, jobs, bitrate,
+                              benchmark, bench_json, overwrite);
+  const tiz::transcoder::stats stats = transcoder.run ();
+  tiz::omxutil::deinit ();
+
+  tiz::medialib::instance ().stop ();
+
+  const double wall = stats.wall_seconds > 0.0 ? stats.wall_seconds : 1e-6;
+  fprintf (stdout, "\n");
+  fprintf (stdout, "Files          : %u ok, %u failed\n", stats.files_ok,
+           stats.files_failed);
+  fprintf (stdout, "Audio duration : %.1f s\n", stats.audio_seconds);
+  fprintf (stdout, "Elapsed time   : %.1f s\n", stats.wall_seconds);
+  fprintf (stdout, "Realtime factor: %.1fx\n", stats.audio_seconds / wall);
+  fprintf (stdout, "Throughput     : %.2f files/s\n",
+           (stats.files_ok + stats.files_failed) / wall);
+
+  if (stats.files_failed > 0)
+  {
+    rc = OMX_ErrorUndefined;
+  }
+
   return rc;
 }
 
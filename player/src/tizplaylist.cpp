@@ -41,6 +41,7 @@
 
 #include <tizplatform.h>
 
+#include "tizmedialib.hpp"
 #include "tizplaylist.hpp"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -83,7 +84,18 @@ namespace  // unnamed namespace
     if (boost::filesystem::exists (uri)
         && boost::filesystem::is_directory (uri))
     {
-      if (!recurse)
+      if (tiz::medialib::instance ().enabled ())
+      {
+        // Directory listings that haven't changed since the last run are
+        // served from the media library index.
+        if (!tiz::medialib::instance ().list_directory (uri, recurse,
+                                                        uri_list))
+        {
+          return OMX_ErrorContentURIError;
+        }
+        return uri_list.empty () ? OMX_ErrorContentURIError : OMX_ErrorNone;
+      }
+      else if (!recurse)
       {
         std::for_each (boost::filesystem::directory_iterator (
                            boost::filesystem::path (uri)),
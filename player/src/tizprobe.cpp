@@ -30,6 +30,8 @@
 #include <config.h>
 #endif
 
+#include <sys/stat.h>
+
 #include <string>
 
 #include <boost/algorithm/string/trim.hpp>
@@ -44,6 +46,7 @@
 #include <tizplatform.h>
 
 #include "tizprobe.hpp"
+#include "tizsniffer.hpp"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -101,20 +104,11 @@ namespace  // unnamed
     return (mi.Open (file_uri) > 0);
   }
 
-  void obtain_stream_title_and_genre (MediaInfoLib::MediaInfo &mi,
-                                      const bool quiet,
-                                      std::string &stream_title,
-                                      std::string &stream_genre)
+  std::string compose_stream_title (const std::string &artist,
+                                    const std::string &album,
+                                    const std::string &title)
   {
-    std::string artist (
-        mi_stream_general_info_to_std_string (mi, L"Performer"));
-    std::string title (mi_stream_general_info_to_std_string (mi, L"Track"));
-    std::string album (mi_stream_general_info_to_std_string (mi, L"Album"));
-    std::string genre (mi_stream_general_info_to_std_string (mi, L"Genre"));
-    std::string full_track_name (
-        mi_stream_general_info_to_std_string (mi, L"CompleteName"));
-
-    stream_title.assign (artist);
+    std::string stream_title (artist);
     if (!album.empty ())
     {
       stream_title.append (" - ");
@@ -126,16 +120,21 @@ namespace  // unnamed
       stream_title.append (" - ");
       stream_title.append (title);
     }
-    stream_genre.assign (genre);
+    return stream_title;
+  }
 
-    if (!quiet)
-    {
-      if (stream_title.empty ())
-      {
-        stream_title.assign (full_track_name);
-      }
-      boost::replace_all (stream_title, "_", " ");
-    }
+  void obtain_stream_title_and_genre (MediaInfoLib::MediaInfo &mi,
+                                      std::string &stream_title,
+                                      std::string &stream_genre)
+  {
+    std::string artist (
+        mi_stream_general_info_to_std_string (mi, L"Performer"));
+    std::string title (mi_stream_general_info_to_std_string (mi, L"Track"));
+    std::string album (mi_stream_general_info_to_std_string (mi, L"Album"));
+    std::string genre (mi_stream_general_info_to_std_string (mi, L"Genre"));
+
+    stream_title.assign (compose_stream_title (artist, album, title));
+    stream_genre.assign (genre);
   }
 
   OMX_AUDIO_CODINGTYPE obtain_codec_id (MediaInfoLib::MediaInfo &mi)
@@ -252,10 +251,14 @@ tiz::probe::probe (const std::string &uri, const bool quiet)
     vorbistype_ (),
     aactype_ (),
     vp8type_ (),
-    meta_file_ (uri.c_str ()),
+    meta_file_ (),
+    meta_file_opened_ (false),
     stream_title_ (),
     stream_genre_ (),
-    stream_is_cbr_ (false)
+    stream_is_cbr_ (false),
+    stream_tags_pending_ (false),
+    track_info_ (),
+    indexed_ (tiz::medialib::instance ().lookup (uri, track_info_))
 {
   // Defaults are the same as in the standard pcm renderer
   pcmtype_.nSize = sizeof(OMX_AUDIO_PARAM_PCMMODETYPE);
@@ -406,81 +409,158 @@ tiz::probe::get_container_type ()
 }
 
 void tiz::probe::probe_stream ()
+{
+  if (!indexed_)
+  {
+    if (tiz::sniffer::sniff (uri_, track_info_))
+    {
+      // Only the codec headers have been read; the stream title and genre
+      // are obtained from the tags when they are first needed.
+      stream_tags_pending_ = true;
+    }
+    else if (!probe_with_mediainfo ())
+    {
+      return;
+    }
+  }
+
+  container_type_
+      = static_cast< OMX_MEDIACONTAINER_FORMATTYPE > (track_info_.container);
+  stream_is_cbr_ = track_info_.cbr;
+
+  if (!stream_tags_pending_)
+  {
+    set_stream_title_and_genre ();
+  }
+
+  TIZ_PRINTF_DBG_RED ("uri [%s] codec_id [%0x] indexed [%s] sniffed [%s]\n",
+                      uri_.c_str (), track_info_.codec_id,
+                      indexed_ ? "YES" : "NO",
+                      stream_tags_pending_ ? "YES" : "NO");
+
+  set_codec_info ();
+}
+
+bool tiz::probe::probe_with_mediainfo ()
 {
   MediaInfoLib::MediaInfo mi;
+  OMX_ENDIANTYPE endianness = OMX_EndianLittle;
+  OMX_NUMERICALDATATYPE sign = OMX_NumericalDataSigned;
 
-  if (open_media (uri_, mi))
+  if (!open_media (uri_, mi))
   {
-    OMX_U32 samplerate = 48000;
-    OMX_U32 bitrate = 0;
-    OMX_U32 nchannels = 2;
-    OMX_U32 bitdepth = 16;
-    OMX_ENDIANTYPE endianness = OMX_EndianLittle;
-    OMX_NUMERICALDATATYPE sign = OMX_NumericalDataSigned;
+    TIZ_LOG (TIZ_PRIORITY_NOTICE, "Unable to open media file : %s",
+             uri_.c_str ());
+    return false;
+  }
 
-    // Get an idea of the container format
-    container_type_ = obtain_container_format (mi);
+  track_info_.samplerate = 48000;
+  track_info_.bitrate = 0;
+  track_info_.nchannels = 2;
+  track_info_.bitdepth = 16;
 
-    // Get the codec type
-    const OMX_AUDIO_CODINGTYPE codec_id = obtain_codec_id (mi);
+  // Get an idea of the container format
+  track_info_.container = obtain_container_format (mi);
 
-    // Get the stream title and genre
-    obtain_stream_title_and_genre (mi, quiet_, stream_title_, stream_genre_);
+  // Get the codec type
+  track_info_.codec_id = obtain_codec_id (mi);
 
-    TIZ_PRINTF_DBG_RED ("uri [%s] codec_id [%0x]\n", uri_.c_str (), codec_id);
+  // Get the stream title and genre
+  obtain_stream_title_and_genre (mi, track_info_.stream_title,
+                                 track_info_.stream_genre);
 
-    // Grab the sample rate, bitrate, num channels, and sample format (when
-    // available), and cbr flag
-    obtain_stream_properties (mi, samplerate, bitrate, nchannels, bitdepth,
-                              endianness, sign, stream_is_cbr_);
+  // Grab the sample rate, bitrate, num channels, and sample format (when
+  // available), and cbr flag
+  obtain_stream_properties (mi, track_info_.samplerate, track_info_.bitrate,
+                            track_info_.nchannels, track_info_.bitdepth,
+                            endianness, sign, track_info_.cbr);
+  track_info_.endianness = endianness;
+  track_info_.sign = sign;
 
-    if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingMP2)
-    {
-      set_mp2_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                          sign);
-    }
-    else if (codec_id == OMX_AUDIO_CodingMP3)
-    {
-      set_mp3_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                          sign);
-    }
-    else if (codec_id == OMX_AUDIO_CodingAAC)
-    {
-      set_aac_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                          sign);
-    }
-    else if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingFLAC)
-    {
-      set_flac_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                           sign);
-    }
-    else if (codec_id == OMX_AUDIO_CodingVORBIS)
-    {
-      set_vorbis_codec_info (samplerate, bitrate, nchannels, bitdepth,
-                             endianness, sign);
-    }
-    else if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingOPUS)
-    {
-      set_opus_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                           sign);
-    }
-    else if (is_pcm_codec (codec_id))
+  mi.Close ();
+  return true;
+}
+
+void tiz::probe::obtain_stream_tags ()
+{
+  if (stream_tags_pending_)
+  {
+    stream_tags_pending_ = false;
+    track_info_.stream_title.assign (
+        compose_stream_title (artist (), album (), title ()));
+    track_info_.stream_genre.assign (genre ());
+    set_stream_title_and_genre ();
+  }
+}
+
+void tiz::probe::set_stream_title_and_genre ()
+{
+  stream_title_.assign (track_info_.stream_title);
+  stream_genre_.assign (track_info_.stream_genre);
+
+  if (!quiet_)
+  {
+    if (stream_title_.empty ())
     {
-      domain_ = OMX_PortDomainAudio;
-      audio_coding_type_
-          = static_cast< OMX_AUDIO_CODINGTYPE >(OMX_AUDIO_CodingPCM);
-      pcmtype_.nSamplingRate = samplerate;
-      pcmtype_.nChannels = nchannels;
-      pcmtype_.nBitPerSample = bitdepth;
-      pcmtype_.eEndian = endianness;
-      pcmtype_.eNumData = sign;
+      stream_title_.assign (uri_);
     }
+    boost::replace_all (stream_title_, "_", " ");
+  }
+}
 
-    mi.Close ();
+void tiz::probe::set_codec_info ()
+{
+  const OMX_AUDIO_CODINGTYPE codec_id
+      = static_cast< OMX_AUDIO_CODINGTYPE > (track_info_.codec_id);
+  const OMX_U32 samplerate = track_info_.samplerate;
+  const OMX_U32 bitrate = track_info_.bitrate;
+  const OMX_U32 nchannels = track_info_.nchannels;
+  const OMX_U32 bitdepth = track_info_.bitdepth;
+  const OMX_ENDIANTYPE endianness
+      = static_cast< OMX_ENDIANTYPE > (track_info_.endianness);
+  const OMX_NUMERICALDATATYPE sign
+      = static_cast< OMX_NUMERICALDATATYPE > (track_info_.sign);
+
+  if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingMP2)
+  {
+    set_mp2_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                        sign);
+  }
+  else if (codec_id == OMX_AUDIO_CodingMP3)
+  {
+    set_mp3_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                        sign);
+  }
+  else if (codec_id == OMX_AUDIO_CodingAAC)
+  {
+    set_aac_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                        sign);
+  }
+  else if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingFLAC)
+  {
+    set_flac_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                         sign);
+  }
+  else if (codec_id == OMX_AUDIO_CodingVORBIS)
+  {
+    set_vorbis_codec_info (samplerate, bitrate, nchannels, bitdepth,
+                           endianness, sign);
   }
-  else
+  else if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingOPUS)
   {
-    TIZ_LOG (TIZ_PRIORITY_NOTICE, "Unable to open media file : %s", uri_.c_str());
+    set_opus_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                         sign);
+  }
+  else if (is_pcm_codec (codec_id))
+  {
+    domain_ = OMX_PortDomainAudio;
+    audio_coding_type_
+        = static_cast< OMX_AUDIO_CODINGTYPE >(OMX_AUDIO_CodingPCM);
+    pcmtype_.nSamplingRate = samplerate;
+    pcmtype_.nChannels = nchannels;
+    pcmtype_.nBitPerSample = bitdepth;
+    pcmtype_.eEndian = endianness;
+    pcmtype_.eNumData = sign;
   }
 }
 
@@ -725,6 +805,7 @@ std::string tiz::probe::get_stream_title ()
   {
     probe_stream ();
   }
+  obtain_stream_tags ();
   if (stream_title_.empty ())
   {
     stream_title_.assign (uri_.c_str ());
@@ -739,6 +820,7 @@ std::string tiz::probe::get_stream_genre ()
   {
     probe_stream ();
   }
+  obtain_stream_tags ();
   return stream_genre_;
 }
 
@@ -755,9 +837,9 @@ std::string tiz::probe::retrieve_meta_data_str (
     TagLib::String (TagLib::Tag::*TagFunction)() const) const
 {
   assert (TagFunction);
-  if (!meta_file_.isNull () && meta_file_.tag ())
+  if (!meta_file ().isNull () && meta_file ().tag ())
   {
-    TagLib::Tag *tag = meta_file_.tag ();
+    TagLib::Tag *tag = meta_file ().tag ();
     return (tag->*TagFunction)().stripWhiteSpace ().to8Bit ();
   }
   return std::string ();
@@ -767,9 +849,9 @@ unsigned int tiz::probe::retrieve_meta_data_uint (
     TagLib::uint (TagLib::Tag::*TagFunction)() const) const
 {
   assert (TagFunction);
-  if (!meta_file_.isNull () && meta_file_.tag ())
+  if (!meta_file ().isNull () && meta_file ().tag ())
   {
-    TagLib::Tag *tag = meta_file_.tag ();
+    TagLib::Tag *tag = meta_file ().tag ();
     return (tag->*TagFunction)();
   }
   return 0;
@@ -777,38 +859,66 @@ unsigned int tiz::probe::retrieve_meta_data_uint (
 
 std::string tiz::probe::title () const
 {
+  if (indexed_)
+  {
+    return track_info_.title;
+  }
   return retrieve_meta_data_str (&TagLib::Tag::title);
 }
 
 std::string tiz::probe::artist () const
 {
+  if (indexed_)
+  {
+    return track_info_.artist;
+  }
   return retrieve_meta_data_str (&TagLib::Tag::artist);
 }
 
 std::string tiz::probe::album () const
 {
+  if (indexed_)
+  {
+    return track_info_.album;
+  }
   return retrieve_meta_data_str (&TagLib::Tag::album);
 }
 
 std::string tiz::probe::year () const
 {
+  if (indexed_)
+  {
+    return track_info_.year;
+  }
   return boost::lexical_cast< std::string >(
       retrieve_meta_data_uint (&TagLib::Tag::year));
 }
 
 std::string tiz::probe::comment () const
 {
+  if (indexed_)
+  {
+    return track_info_.comment;
+  }
   return retrieve_meta_data_str (&TagLib::Tag::comment);
 }
 
 std::string tiz::probe::track () const
 {
+  if (indexed_)
+  {
+    return track_info_.track;
+  }
   return boost::lexical_cast< std::string >(
       retrieve_meta_data_uint (&TagLib::Tag::track));
 }
 
 std::string tiz::probe::genre () const
 {
+  if (indexed_)
+  {
+    return track_info_.genre;
+  }
   return retrieve_meta_data_str (&TagLib::Tag::genre);
 }
 
@@ -816,9 +926,14 @@ std::string tiz::probe::stream_length () const
 {
   std::string length_str;
 
-  if (!meta_file_.isNull () && meta_file_.audioProperties ())
+  if (indexed_)
+  {
+    return track_info_.length;
+  }
+
+  if (!meta_file ().isNull () && meta_file ().audioProperties ())
   {
-    TagLib::AudioProperties *properties = meta_file_.audioProperties ();
+    TagLib::AudioProperties *properties = meta_file ().audioProperties ();
     int seconds = properties->length () % 60;
     int minutes = (properties->length () - seconds) / 60;
     int hours = 0;
@@ -850,6 +965,62 @@ std::string tiz::probe::stream_length () const
   return length_str;
 }
 
+int tiz::probe::stream_duration () const
+{
+  if (!meta_file ().isNull () && meta_file ().audioProperties ())
+  {
+    return meta_file ().audioProperties ()->length ();
+  }
+  return 0;
+}
+
+bool tiz::probe::fill_track_info (medialib::track_info &info)
+{
+  struct stat st;
+  if (stat (uri_.c_str (), &st) != 0)
+  {
+    return false;
+  }
+
+  if (OMX_PortDomainMax == domain_)
+  {
+    probe_stream ();
+  }
+
+  if (OMX_PortDomainMax == domain_)
+  {
+    // Unable to open or identify the media
+    return false;
+  }
+
+  obtain_stream_tags ();
+  info = track_info_;
+  info.path = uri_;
+  info.mtime = st.st_mtime;
+  info.size = st.st_size;
+  info.title = title ();
+  info.artist = artist ();
+  info.album = album ();
+  info.year = year ();
+  info.comment = comment ();
+  info.track = track ();
+  info.genre = genre ();
+  info.length = stream_length ();
+  return true;
+}
+
+const TagLib::FileRef &tiz::probe::meta_file () const
+{
+  // Opened on first use, so that probing served from the media library
+  // index doesn't touch the file.
+  if (!meta_file_opened_)
+  {
+    meta_file_ = TagLib::FileRef (uri_.c_str ());
+    meta_file_opened_ = true;
+  }
+  return meta_file_;
+}
+
 void tiz::probe::dump_pcm_info ()
 {
   if (OMX_PortDomainMax == domain_)
@@ -41,6 +41,8 @@
 #include <OMX_Video.h>
 #include <OMX_TizoniaExt.h>
 
+#include "tizmedialib.hpp"
+
 namespace tiz
 {
   class probe
@@ -82,6 +84,7 @@ namespace tiz
 
     /* Duration */
     std::string stream_length () const;
+    int stream_duration () const;  // in seconds, or 0 if unknown
 
     void dump_pcm_info ();
     void dump_mp3_info ();
@@ -90,8 +93,17 @@ namespace tiz
     void dump_aac_and_pcm_info ();
     void dump_stream_metadata ();
 
+    /* Probe the stream and collect everything the media library index
+       needs to know about it. */
+    bool fill_track_info (medialib::track_info &info);
+
   private:
     void probe_stream ();
+    bool probe_with_mediainfo ();
+    void obtain_stream_tags ();
+    void set_stream_title_and_genre ();
+    void set_codec_info ();
+    const TagLib::FileRef &meta_file () const;
     void set_mp2_codec_info (const OMX_U32 samplerate, const OMX_U32 bitrate,
                              const OMX_U32 nchannels, const OMX_U32 bitdepth,
                              const OMX_ENDIANTYPE endianness,
@@ -137,10 +149,14 @@ namespace tiz
     OMX_AUDIO_PARAM_VORBISTYPE vorbistype_;
     OMX_AUDIO_PARAM_AACPROFILETYPE aactype_;
     OMX_VIDEO_PARAM_VP8TYPE vp8type_;
-    TagLib::FileRef meta_file_;
+    mutable TagLib::FileRef meta_file_;
+    mutable bool meta_file_opened_;
     std::string stream_title_;
     std::string stream_genre_;
     bool stream_is_cbr_;
+    bool stream_tags_pending_;  // stream title and genre still to be read
+    medialib::track_info track_info_;
+    bool indexed_;  // whether track_info_ comes from the media library index
   };
 }  // namespace tiz
 
@@ -0,0 +1,196 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizprobebench.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Probe latency benchmark
+ *
+ * Measures how long it takes to identify local media files with the native
+ * header sniffer, and with the MediaInfo analysis that is used as a fallback.
+ *
+ * Usage: tizonia-probe-bench [-n iterations] file...
+ *
+ * Results are grouped by file extension. Times are in microseconds; 'first'
+ * is the first probe of each file (i.e. the one most likely to hit the
+ * disk), 'median' is over all the remaining iterations.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+
+#include <ZenLib/Ztring.h>
+#include <MediaInfo/MediaInfo.h>
+#include <MediaInfo/MediaInfo_Const.h>
+
+#include <tizplatform.h>
+
+#include "tizsniffer.hpp"
+
+namespace  // unnamed
+{
+  const int PROBE_BENCH_DEFAULT_ITERATIONS = 20;
+
+  struct latencies
+  {
+    latencies () : files (0), sniffed (0)
+    {
+    }
+
+    int files;
+    int sniffed;
+    std::vector< double > sniff_first;
+    std::vector< double > sniff;
+    std::vector< double > mediainfo_first;
+    std::vector< double > mediainfo;
+  };
+
+  double now_us ()
+  {
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+  }
+
+  double median (std::vector< double > values)
+  {
+    if (values.empty ())
+    {
+      return 0.0;
+    }
+    std::sort (values.begin (), values.end ());
+    return values[values.size () / 2];
+  }
+
+  bool sniff_once (const std::string &file, double &elapsed)
+  {
+    tiz::medialib::track_info info;
+    const double start = now_us ();
+    const bool found = tiz::sniffer::sniff (file, info);
+    elapsed = now_us () - start;
+    return found;
+  }
+
+  void mediainfo_once (const std::string &file, double &elapsed)
+  {
+    const double start = now_us ();
+    MediaInfoLib::MediaInfo mi;
+    ZenLib::Ztring file_uri = file.c_str ();
+    if (mi.Open (file_uri) > 0)
+    {
+      (void)mi.Get (MediaInfoLib::Stream_Audio, 0, L"Format",
+                    MediaInfoLib::Info_Text, MediaInfoLib::Info_Name);
+      mi.Close ();
+    }
+    elapsed = now_us () - start;
+  }
+
+  void usage (const char *p_prog)
+  {
+    fprintf (stderr, "Usage: %s [-n iterations] file...\n", p_prog);
+  }
+}
+
+int main (int argc, char **argv)
+{
+  int iterations = PROBE_BENCH_DEFAULT_ITERATIONS;
+  int first_file = 1;
+
+  if (argc > 2 && 0 == strcmp (argv[1], "-n"))
+  {
+    iterations = std::max (1, atoi (argv[2]));
+    first_file = 3;
+  }
+
+  if (first_file >= argc)
+  {
+    usage (argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  tiz_log_init ();
+
+  std::map< std::string, latencies > results;
+  for (int i = first_file; i < argc; ++i)
+  {
+    const std::string file (argv[i]);
+    std::string format (boost::filesystem::path (file).extension ().string ());
+    boost::algorithm::to_lower (format);
+    if (!format.empty ())
+    {
+      format.erase (0, 1);
+    }
+
+    latencies &lat = results[format.empty () ? "-" : format];
+    double elapsed = 0.0;
+    ++lat.files;
+
+    if (sniff_once (file, elapsed))
+    {
+      ++lat.sniffed;
+    }
+    lat.sniff_first.push_back (elapsed);
+    mediainfo_once (file, elapsed);
+    lat.mediainfo_first.push_back (elapsed);
+
+    for (int j = 1; j < iterations; ++j)
+    {
+      (void)sniff_once (file, elapsed);
+      lat.sniff.push_back (elapsed);
+      mediainfo_once (file, elapsed);
+      lat.mediainfo.push_back (elapsed);
+    }
+  }
+
+  printf ("%-8s %6s %8s %12s %12s %12s %12s %8s\n", "format", "files",
+          "sniffed", "sniff-first", "sniff-med", "mi-first", "mi-med",
+          "speedup");
+  for (std::map< std::string, latencies >::const_iterator it
+       = results.begin ();
+       it != results.end (); ++it)
+  {
+    const latencies &lat = it->second;
+    const double sniff_med = median (lat.sniff.empty () ? lat.sniff_first
+                                                        : lat.sniff);
+    const double mi_med = median (lat.mediainfo.empty () ? lat.mediainfo_first
+                                                         : lat.mediainfo);
+    printf ("%-8s %6d %8d %12.1f %12.1f %12.1f %12.1f %7.1fx\n",
+            it->first.c_str (), lat.files, lat.sniffed,
+            median (lat.sniff_first), sniff_med, median (lat.mediainfo_first),
+            mi_med, sniff_med > 0.0 ? mi_med / sniff_med : 0.0);
+  }
+
+  tiz_log_deinit ();
+  return EXIT_SUCCESS;
+}
@@ -317,6 +317,7 @@ tiz::programopts::programopts (int argc, char *argv[])
     debug_ ("Debug options"),
     omx_ ("OpenMAX IL options"),
     server_ ("Audio streaming server options"),
+    transcode_ ("Transcoding options"),
     client_ ("Audio streaming client options"),
     spotify_ ("Spotify options (Spotify Premium required)"),
     gmusic_ ("Google Play Music options"),
@@ -342,6 +343,7 @@ tiz::programopts::programopts (int argc, char *argv[])
     proxy_password_(),
     log_dir_ (),
     debug_info_ (false),
+    buffer_stats_ (false),
     comp_name_ (),
     role_name_ (),
     port_ (TIZ_STREAMING_SERVER_DEFAULT_PORT),
@@ -352,6 +354,12 @@ tiz::programopts::programopts (int argc, char *argv[])
     bitrate_list_ (),
     sampling_rates_ (),
     sampling_rate_list_ (),
+    transcode_output_dir_ ("."),
+    transcode_jobs_ (0),
+    transcode_bitrate_ (192),
+    transcode_benchmark_ (false),
+    transcode_benchmark_json_ (),
+    transcode_force_ (false),
     uri_list_ (),
     spotify_user_ (),
     spotify_pass_ (),
@@ -462,6 +470,7 @@ tiz::programopts::programopts (int argc, char *argv[])
     all_debug_options_ (),
     all_omx_options_ (),
     all_streaming_server_options_ (),
+    all_transcode_options_ (),
     all_streaming_client_options_ (),
     all_spotify_client_options_ (),
     all_gmusic_client_options_ (),
@@ -479,6 +488,7 @@ tiz::programopts::programopts (int argc, char *argv[])
   init_debug_options ();
   init_omx_options ();
   init_streaming_server_options ();
+  init_transcode_options ();
   init_streaming_client_options ();
   init_spotify_options ();
   init_gmusic_options ();
@@ -574,6 +584,9 @@ void tiz::programopts::print_usage_help () const
   std::cout << "  "
             << "server        SHOUTcast/ICEcast streaming server options."
             << "\n";
+  std::cout << "  "
+            << "transcode     Offline batch transcoding options."
+            << "\n";
   std::cout << "  "
             << "client        SHOUTcast/ICEcast streaming client options."
             << "\n";
@@ -746,6 +759,11 @@ bool tiz::programopts::debug_info () const
   return debug_info_;
 }
 
+bool tiz::programopts::buffer_stats () const
+{
+  return buffer_stats_;
+}
+
 const std::string &tiz::programopts::component_name () const
 {
   return comp_name_;
@@ -796,6 +814,36 @@ const std::vector< int > &tiz::programopts::sampling_rate_list () const
   return sampling_rate_list_;
 }
 
+const std::string &tiz::programopts::transcode_output_dir () const
+{
+  return transcode_output_dir_;
+}
+
+uint32_t tiz::programopts::transcode_jobs () const
+{
+  return transcode_jobs_;
+}
+
+uint32_t tiz::programopts::transcode_bitrate () const
+{
+  return transcode_bitrate_;
+}
+
+bool tiz::programopts::transcode_benchmark () const
+{
+  return transcode_benchmark_ || !transcode_benchmark_json_.empty ();
+}
+
+const std::string &tiz::programopts::transcode_benchmark_json () const
+{
+  return transcode_benchmark_json_;
+}
+
+bool tiz::programopts::transcode_force () const
+{
+  return transcode_force_;
+}
+
 const std::vector< std::string > &tiz::programopts::uri_list () const
 {
   return uri_list_;
@@ -1630,10 +1678,16 @@ void tiz::programopts::init_debug_options ()
           "debug-info", po::bool_switch (&debug_info_)->default_value (false),
           "Print debug-related information.")
       /* TIZ_CLASS_COMMENT: */
+      ("buffer-stats",
+       po::bool_switch (&buffer_stats_)->default_value (false),
+       "Print the buffer flow and scheduling statistics of each component "
+       "when its graph is destroyed.")
+      /* TIZ_CLASS_COMMENT: */
       ;
   register_consume_function (&tiz::programopts::consume_debug_options);
   all_debug_options_
-      = boost::assign::list_of ("log-directory") ("debug-info")
+      = boost::assign::list_of ("log-directory") ("debug-info") (
+          "buffer-stats")
             .convert_to_container< std::vector< std::string > > ();
 }
 
@@ -1700,6 +1754,52 @@ void tiz::programopts::init_streaming_server_options ()
             .convert_to_container< std::vector< std::string > > ();
 }
 
+void tiz::programopts::init_transcode_options ()
+{
+  transcode_.add_options ()
+      /* TIZ_CLASS_COMMENT: This is to avoid the clang formatter messing up
+         these lines*/
+      ("transcode",
+       "Convert local media files to MP3, as fast as possible (i.e. not in "
+       "real time), running several conversions in parallel.")
+      /* TIZ_CLASS_COMMENT: */
+      ("transcode-output-dir", po::value (&transcode_output_dir_),
+       "Directory where the MP3 files will be written. Optional. "
+       "Default: the current directory.")
+      /* TIZ_CLASS_COMMENT: */
+      ("transcode-jobs", po::value (&transcode_jobs_),
+       "Number of files to be converted concurrently. Optional. "
+       "Default: the number of CPU cores (1, the only value allowed, with "
+       "--transcode-benchmark).")
+      /* TIZ_CLASS_COMMENT: */
+      ("transcode-bitrate", po::value (&transcode_bitrate_),
+       "MP3 bitrate, in kbps. Optional. Default: 192.")
+      /* TIZ_CLASS_COMMENT: */
+      ("transcode-force",
+       po::bool_switch (&transcode_force_)->default_value (false),
+       "Overwrite MP3 files that already exist in the output directory; "
+       "otherwise, those inputs are skipped and reported as failed. "
+       "Optional. Default: false.")
+      /* TIZ_CLASS_COMMENT: */
+      ("transcode-benchmark",
+       po::bool_switch (&transcode_benchmark_)->default_value (false),
+       "Write nothing; decode the files into a null renderer instead, and "
+       "report the graph's startup time, the realtime factor, and the CPU "
+       "time, buffer exchange rate and memory of each component. Files are "
+       "processed one at a time. Optional. Default: false.")
+      /* TIZ_CLASS_COMMENT: */
+      ("transcode-benchmark-json", po::value (&transcode_benchmark_json_),
+       "Also write the benchmark results to this file, as JSON. Implies "
+       "--transcode-benchmark. Optional.");
+
+  register_consume_function (&tiz::programopts::consume_transcode_options);
+  all_transcode_options_
+      = boost::assign::list_of ("transcode") ("transcode-output-dir") (
+            "transcode-jobs") ("transcode-bitrate") ("transcode-force") (
+            "transcode-benchmark") ("transcode-benchmark-json")
+            .convert_to_container< std::vector< std::string > > ();
+}
+
 void tiz::programopts::init_streaming_client_options ()
 {
   client_.add_options ()
@@ -2126,6 +2226,7 @@ uint32_t tiz::programopts::parse_command_line (int argc, char *argv[])
       .add (debug_)
       .add (omx_)
       .add (server_)
+      .add (transcode_)
       .add (client_)
 #ifdef HAVE_LIBSPOTIFY
       .add (spotify_)
@@ -2173,6 +2274,11 @@ int tiz::programopts::consume_debug_options (bool &done, std::string &msg)
     (void)call_handler (option_handlers_map_.find ("log-directory"));
     rc = EXIT_SUCCESS;
   }
+  if (vm_.count ("buffer-stats") && buffer_stats_)
+  {
+    (void)call_handler (option_handlers_map_.find ("buffer-stats"));
+    rc = EXIT_SUCCESS;
+  }
   if (vm_.count ("debug-info") && debug_info_)
   {
     (void)call_handler (option_handlers_map_.find ("debug-info"));
@@ -2205,6 +2311,10 @@ int tiz::programopts::consume_global_options (bool &done,
     {
       print_usage_feature (server_);
     }
+    else if (0 == help_option_.compare ("transcode"))
+    {
+      print_usage_feature (transcode_);
+    }
     else if (0 == help_option_.compare ("client"))
     {
       print_usage_feature (client_);
@@ -2361,6 +2471,28 @@ int tiz::programopts::consume_streaming_server_options (bool &done,
   return rc;
 }
 
+int tiz::programopts::consume_transcode_options (bool &done,
+                                                 std::string &msg)
+{
+  int rc = EXIT_FAILURE;
+  done = false;
+
+  if (validate_transcode_options ())
+  {
+    done = true;
+    PO_RETURN_IF_FAIL (validate_transcode_bitrate_argument (msg));
+    PO_RETURN_IF_FAIL (validate_transcode_jobs_argument (msg));
+    rc = consume_input_file_uris_option ();
+    if (EXIT_SUCCESS == rc)
+    {
+      rc = call_handler (option_handlers_map_.find ("transcode"));
+    }
+  }
+  TIZ_PRINTF_DBG_RED ("transcode ; rc = [%s]\n",
+                      rc == EXIT_SUCCESS ? "SUCCESS" : "FAILURE");
+  return rc;
+}
+
 int tiz::programopts::consume_streaming_client_options (bool &done,
                                                         std::string &msg)
 {
@@ -3208,6 +3340,23 @@ bool tiz::programopts::validate_streaming_server_options () const
   return outcome;
 }
 
+bool tiz::programopts::validate_transcode_options () const
+{
+  bool outcome = false;
+
+  std::vector< std::string > all_valid_options = all_transcode_options_;
+  concat_option_lists (all_valid_options, all_global_options_);
+  concat_option_lists (all_valid_options, all_debug_options_);
+  concat_option_lists (all_valid_options, all_input_uri_options_);
+
+  if (vm_.count ("transcode")
+      && is_valid_options_combination (all_valid_options, all_given_options_))
+  {
+    outcome = true;
+  }
+  return outcome;
+}
+
 bool tiz::programopts::validate_spotify_client_options () const
 {
   bool outcome = false;
@@ -3410,6 +3559,43 @@ bool tiz::programopts::validate_port_argument (std::string &msg) const
   return rc;
 }
 
+bool tiz::programopts::validate_transcode_bitrate_argument (
+    std::string &msg) const
+{
+  bool rc = true;
+  if (vm_.count ("transcode-bitrate"))
+  {
+    if (transcode_bitrate_ < 32 || transcode_bitrate_ > 320)
+    {
+      rc = false;
+      std::ostringstream oss;
+      oss << "Invalid argument : " << transcode_bitrate_ << "\n"
+          << "Please provide a bitrate in the range [32-320] kbps";
+      msg.assign (oss.str ());
+    }
+  }
+  return rc;
+}
+
+bool tiz::programopts::validate_transcode_jobs_argument (
+    std::string &msg) const
+{
+  bool rc = true;
+  // The benchmark's CPU time and memory figures are sampled process-wide,
+  // so they would be mixed up between concurrent graphs
+  if (vm_.count ("transcode-jobs") && transcode_jobs_ > 1
+      && transcode_benchmark ())
+  {
+    rc = false;
+    std::ostringstream oss;
+    oss << "Invalid argument : " << transcode_jobs_ << "\n"
+        << "--transcode-benchmark runs one file at a time; "
+        << "please use --transcode-jobs 1 or leave it out";
+    msg.assign (oss.str ());
+  }
+  return rc;
+}
+
 bool tiz::programopts::validate_bitrates_argument (std::string &msg)
 {
   bool rc = true;
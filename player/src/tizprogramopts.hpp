@@ -68,6 +68,7 @@ namespace tiz
     const std::string &proxy_password () const;
     const std::string &log_dir () const;
     bool debug_info () const;
+    bool buffer_stats () const;
     const std::string &component_name () const;
     const std::string &component_role () const;
     int port () const;
@@ -78,6 +79,12 @@ namespace tiz
     const std::vector< std::string > &bitrate_list () const;
     const std::string &sampling_rates () const;
     const std::vector< int > &sampling_rate_list () const;
+    const std::string &transcode_output_dir () const;
+    uint32_t transcode_jobs () const;
+    uint32_t transcode_bitrate () const;
+    bool transcode_benchmark () const;
+    const std::string &transcode_benchmark_json () const;
+    bool transcode_force () const;
     const std::vector< std::string > &uri_list () const;
     const std::string &spotify_user () const;
     const std::string &spotify_password () const;
@@ -129,6 +136,7 @@ namespace tiz
     void init_debug_options ();
     void init_omx_options ();
     void init_streaming_server_options ();
+    void init_transcode_options ();
     void init_streaming_client_options ();
     void init_spotify_options ();
     void init_gmusic_options ();
@@ -150,6 +158,7 @@ namespace tiz
     int consume_global_options (bool &done, std::string &msg);
     int consume_omx_options (bool &done, std::string &msg);
     int consume_streaming_server_options (bool &done, std::string &msg);
+    int consume_transcode_options (bool &done, std::string &msg);
     int consume_streaming_client_options (bool &done, std::string &msg);
     int consume_spotify_client_options (bool &done, std::string &msg);
     int consume_gmusic_client_options (bool &done, std::string &msg);
@@ -166,6 +175,7 @@ namespace tiz
 
     bool validate_omx_options () const;
     bool validate_streaming_server_options () const;
+    bool validate_transcode_options () const;
     bool validate_spotify_client_options () const;
     bool validate_gmusic_client_options () const;
 #ifdef HAVE_SOUNDCLOUD
@@ -178,6 +188,8 @@ namespace tiz
     bool validate_port_argument (std::string &msg) const;
     bool validate_bitrates_argument (std::string &msg);
     bool validate_sampling_rates_argument (std::string &msg);
+    bool validate_transcode_bitrate_argument (std::string &msg) const;
+    bool validate_transcode_jobs_argument (std::string &msg) const;
 
     int call_handler (const option_handlers_map_t::const_iterator &handler_it);
 
@@ -192,6 +204,7 @@ namespace tiz
     boost::program_options::options_description debug_;
     boost::program_options::options_description omx_;
     boost::program_options::options_description server_;
+    boost::program_options::options_description transcode_;
     boost::program_options::options_description client_;
     boost::program_options::options_description spotify_;
     boost::program_options::options_description gmusic_;
@@ -219,6 +232,7 @@ namespace tiz
     std::string proxy_password_;
     std::string log_dir_;
     bool debug_info_;
+    bool buffer_stats_;
     std::string comp_name_;
     std::string role_name_;
     int port_;
@@ -229,6 +243,12 @@ namespace tiz
     std::vector< std::string > bitrate_list_;
     std::string sampling_rates_;
     std::vector< int > sampling_rate_list_;
+    std::string transcode_output_dir_;
+    uint32_t transcode_jobs_;
+    uint32_t transcode_bitrate_;
+    bool transcode_benchmark_;
+    std::string transcode_benchmark_json_;
+    bool transcode_force_;
     std::vector< std::string > uri_list_;
     std::string spotify_user_;
     std::string spotify_pass_;
@@ -340,6 +360,7 @@ namespace tiz
     std::vector< std::string > all_debug_options_;
     std::vector< std::string > all_omx_options_;
     std::vector< std::string > all_streaming_server_options_;
+    std::vector< std::string > all_transcode_options_;
     std::vector< std::string > all_streaming_client_options_;
     std::vector< std::string > all_spotify_client_options_;
     std::vector< std::string > all_gmusic_client_options_;
@@ -0,0 +1,930 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizsniffer.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Native container and codec header parsing
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <OMX_Audio.h>
+#include <OMX_Component.h>
+#include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
+
+#include <tizplatform.h>
+
+#include "tizsniffer.hpp"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.play.sniffer"
+#endif
+
+namespace  // unnamed
+{
+  typedef tiz::medialib::track_info track_info_t;
+
+  // Amount of data that is read at the start of the file (or right after the
+  // ID3v2 tag). This is enough for the headers of every supported format,
+  // except for MP4 files, whose boxes are read separately.
+  const size_t SNIFF_BUFFER_SIZE = 4096;
+
+  // Number of consecutive MPEG audio or ADTS frames that must be found to
+  // accept a frame sync as genuine.
+  const int SNIFF_MIN_SYNC_FRAMES = 3;
+
+  // Number of frames inspected to decide whether an MPEG audio stream without
+  // a Xing/Info/VBRI header is CBR.
+  const int SNIFF_MAX_CBR_FRAMES = 8;
+
+  // Largest MP4 'stsd' payload that is read
+  const size_t SNIFF_MAX_STSD_SIZE = 1024;
+
+  class reader
+  {
+  public:
+    explicit reader (const std::string &uri)
+      : fd_ (open (uri.c_str (), O_RDONLY | O_CLOEXEC)), size_ (0)
+    {
+      struct stat st;
+      if (fd_ >= 0 && fstat (fd_, &st) == 0)
+      {
+        size_ = st.st_size;
+      }
+    }
+
+    ~reader ()
+    {
+      if (fd_ >= 0)
+      {
+        close (fd_);
+      }
+    }
+
+    bool is_open () const
+    {
+      return fd_ >= 0;
+    }
+
+    off_t size () const
+    {
+      return size_;
+    }
+
+    size_t read (const off_t offset, unsigned char *p_buf,
+                 const size_t len) const
+    {
+      size_t total = 0;
+      while (total < len)
+      {
+        const ssize_t n = pread (fd_, p_buf + total, len - total,
+                                 offset + static_cast< off_t > (total));
+        if (n < 0 && EINTR == errno)
+        {
+          continue;
+        }
+        if (n <= 0)
+        {
+          break;
+        }
+        total += static_cast< size_t > (n);
+      }
+      return total;
+    }
+
+  private:
+    reader (const reader &);
+    reader &operator= (const reader &);
+
+  private:
+    int fd_;
+    off_t size_;
+  };
+
+  // The data read at the start of the stream, and where it was read from
+  struct window
+  {
+    unsigned char data[SNIFF_BUFFER_SIZE];
+    size_t len;
+    off_t offset;
+  };
+
+  inline OMX_U32 be16 (const unsigned char *p)
+  {
+    return (static_cast< OMX_U32 > (p[0]) << 8) | p[1];
+  }
+
+  inline OMX_U32 be32 (const unsigned char *p)
+  {
+    return (static_cast< OMX_U32 > (p[0]) << 24)
+           | (static_cast< OMX_U32 > (p[1]) << 16)
+           | (static_cast< OMX_U32 > (p[2]) << 8) | p[3];
+  }
+
+  inline OMX_U64 be64 (const unsigned char *p)
+  {
+    return (static_cast< OMX_U64 > (be32 (p)) << 32) | be32 (p + 4);
+  }
+
+  inline OMX_U32 le16 (const unsigned char *p)
+  {
+    return (static_cast< OMX_U32 > (p[1]) << 8) | p[0];
+  }
+
+  inline OMX_U32 le32 (const unsigned char *p)
+  {
+    return (static_cast< OMX_U32 > (p[3]) << 24)
+           | (static_cast< OMX_U32 > (p[2]) << 16)
+           | (static_cast< OMX_U32 > (p[1]) << 8) | p[0];
+  }
+
+  inline bool has_magic (const unsigned char *p, const size_t len,
+                         const char *p_magic)
+  {
+    const size_t magic_len = strlen (p_magic);
+    return len >= magic_len && 0 == memcmp (p, p_magic, magic_len);
+  }
+
+  /* ID3v2 */
+
+  // Returns the size of the ID3v2 tag at the start of the buffer, or zero
+  off_t id3v2_size (const unsigned char *p, const size_t len)
+  {
+    if (len < 10 || !has_magic (p, len, "ID3") || 0xff == p[3]
+        || ((p[6] | p[7] | p[8] | p[9]) & 0x80))
+    {
+      return 0;
+    }
+    const off_t size = (static_cast< off_t > (p[6]) << 21)
+                       | (static_cast< off_t > (p[7]) << 14)
+                       | (static_cast< off_t > (p[8]) << 7) | p[9];
+    // The footer flag adds another 10 bytes
+    return 10 + size + ((p[5] & 0x10) ? 10 : 0);
+  }
+
+  /* MPEG audio (Layer I, II and III) */
+
+  struct mpa_frame
+  {
+    int version;  // 10 = MPEG-1, 20 = MPEG-2, 25 = MPEG-2.5
+    int layer;
+    OMX_U32 bitrate;  // bits per second
+    OMX_U32 samplerate;
+    OMX_U32 nchannels;
+    OMX_U32 samples;  // samples per frame
+    size_t length;    // frame length in bytes
+  };
+
+  bool parse_mpa_header (const unsigned char *p, mpa_frame &frame)
+  {
+    static const OMX_U32 bitrates[5][15]
+        = {// MPEG-1, Layer I
+           {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416,
+            448},
+           // MPEG-1, Layer II
+           {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+           // MPEG-1, Layer III
+           {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+           // MPEG-2/2.5, Layer I
+           {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+           // MPEG-2/2.5, Layer II and III
+           {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}};
+    static const OMX_U32 samplerates[3][3] = {{44100, 48000, 32000},
+                                              {22050, 24000, 16000},
+                                              {11025, 12000, 8000}};
+
+    if (0xff != p[0] || 0xe0 != (p[1] & 0xe0))
+    {
+      return false;
+    }
+
+    const int version_bits = (p[1] >> 3) & 0x03;
+    const int layer_bits = (p[1] >> 1) & 0x03;
+    const int bitrate_idx = (p[2] >> 4) & 0x0f;
+    const int samplerate_idx = (p[2] >> 2) & 0x03;
+    const int padding = (p[2] >> 1) & 0x01;
+
+    // Reject the reserved values, and free format streams (bitrate index 0)
+    if (1 == version_bits || 0 == layer_bits || 0 == bitrate_idx
+        || 15 == bitrate_idx || 3 == samplerate_idx)
+    {
+      return false;
+    }
+
+    frame.version = (3 == version_bits ? 10 : (2 == version_bits ? 20 : 25));
+    frame.layer = 4 - layer_bits;
+
+    const int table
+        = (10 == frame.version ? frame.layer - 1 : (1 == frame.layer ? 3 : 4));
+    frame.bitrate = bitrates[table][bitrate_idx] * 1000;
+    frame.samplerate
+        = samplerates[10 == frame.version ? 0 : (20 == frame.version ? 1 : 2)]
+                     [samplerate_idx];
+    frame.nchannels = (3 == ((p[3] >> 6) & 0x03)) ? 1 : 2;
+
+    if (1 == frame.layer)
+    {
+      frame.samples = 384;
+      frame.length = (12 * frame.bitrate / frame.samplerate + padding) * 4;
+    }
+    else
+    {
+      frame.samples = (3 == frame.layer && 10 != frame.version) ? 576 : 1152;
+      frame.length
+          = frame.samples / 8 * frame.bitrate / frame.samplerate + padding;
+    }
+
+    return frame.length >= 4;
+  }
+
+  bool same_mpa_stream (const mpa_frame &a, const mpa_frame &b)
+  {
+    return a.version == b.version && a.layer == b.layer
+           && a.samplerate == b.samplerate;
+  }
+
+  // Read the four header bytes at 'offset', from the window if possible
+  bool read_header (const reader &r, const window &w, const off_t offset,
+                    unsigned char *p_hdr, const size_t len)
+  {
+    if (offset >= w.offset
+        && offset + static_cast< off_t > (len)
+               <= w.offset + static_cast< off_t > (w.len))
+    {
+      memcpy (p_hdr, w.data + (offset - w.offset), len);
+      return true;
+    }
+    return r.read (offset, p_hdr, len) == len;
+  }
+
+  void mpa_bitrate_mode (const reader &r, const window &w, const size_t pos,
+                         const mpa_frame &first, track_info_t &info)
+  {
+    // Look for a Xing/Info header after the side information of the first
+    // frame, or for a VBRI header at a fixed position.
+    const unsigned char *p = w.data + pos;
+    const size_t avail = w.len - pos;
+    const size_t side_info
+        = (10 == first.version) ? (1 == first.nchannels ? 17 : 32)
+                                : (1 == first.nchannels ? 9 : 17);
+    const size_t xing = 4 + side_info;
+    const size_t vbri = 4 + 32;
+
+    info.bitrate = first.bitrate;
+    info.cbr = true;
+
+    if (3 == first.layer && avail >= xing + 16
+        && (has_magic (p + xing, 4, "Xing") || has_magic (p + xing, 4, "Info")))
+    {
+      const OMX_U32 flags = be32 (p + xing + 4);
+      info.cbr = has_magic (p + xing, 4, "Info");
+      if (!info.cbr && (flags & 0x01) && (flags & 0x02))
+      {
+        const OMX_U64 nframes = be32 (p + xing + 8);
+        const OMX_U64 nbytes = be32 (p + xing + 12);
+        if (nframes > 0)
+        {
+          info.bitrate = static_cast< OMX_U32 > (
+              nbytes * 8 * first.samplerate / (nframes * first.samples));
+        }
+      }
+      return;
+    }
+
+    if (3 == first.layer && avail >= vbri + 18
+        && has_magic (p + vbri, 4, "VBRI"))
+    {
+      const OMX_U64 nbytes = be32 (p + vbri + 10);
+      const OMX_U64 nframes = be32 (p + vbri + 14);
+      info.cbr = false;
+      if (nframes > 0)
+      {
+        info.bitrate = static_cast< OMX_U32 > (
+            nbytes * 8 * first.samplerate / (nframes * first.samples));
+      }
+      return;
+    }
+
+    // No header; compare the bitrates of the first few frames
+    off_t offset = w.offset + static_cast< off_t > (pos);
+    mpa_frame frame = first;
+    for (int i = 0; i < SNIFF_MAX_CBR_FRAMES; ++i)
+    {
+      unsigned char hdr[4];
+      offset += static_cast< off_t > (frame.length);
+      if (!read_header (r, w, offset, hdr, sizeof (hdr))
+          || !parse_mpa_header (hdr, frame) || !same_mpa_stream (first, frame))
+      {
+        break;
+      }
+      if (frame.bitrate != first.bitrate)
+      {
+        info.cbr = false;
+        break;
+      }
+    }
+  }
+
+  bool sniff_mpa (const reader &r, const window &w, track_info_t &info)
+  {
+    for (size_t pos = 0; pos + 4 <= w.len; ++pos)
+    {
+      mpa_frame first;
+      if (!parse_mpa_header (w.data + pos, first))
+      {
+        continue;
+      }
+
+      // Accept the sync only if it's followed by more frames of the same
+      // stream
+      off_t offset = w.offset + static_cast< off_t > (pos);
+      mpa_frame frame = first;
+      int nframes = 1;
+      while (nframes < SNIFF_MIN_SYNC_FRAMES)
+      {
+        unsigned char hdr[4];
+        offset += static_cast< off_t > (frame.length);
+        if (!read_header (r, w, offset, hdr, sizeof (hdr))
+            || !parse_mpa_header (hdr, frame)
+            || !same_mpa_stream (first, frame))
+        {
+          break;
+        }
+        ++nframes;
+      }
+
+      if (nframes < SNIFF_MIN_SYNC_FRAMES)
+      {
+        continue;
+      }
+
+      // Same mapping as for MediaInfo's results: only MPEG-1 Layer II
+      // streams go to the MP2 decoder.
+      info.codec_id = (2 == first.layer && 10 == first.version)
+                          ? static_cast< int > (OMX_AUDIO_CodingMP2)
+                          : static_cast< int > (OMX_AUDIO_CodingMP3);
+      info.container = OMX_FORMAT_MP3;
+      info.samplerate = first.samplerate;
+      info.nchannels = first.nchannels;
+      mpa_bitrate_mode (r, w, pos, first, info);
+      return true;
+    }
+    return false;
+  }
+
+  /* AAC */
+
+  const OMX_U32 aac_samplerates[]
+      = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
+         22050, 16000, 12000, 11025, 8000,  7350};
+
+  // Number of channels for each MPEG-4 audio channel configuration
+  const OMX_U32 aac_channels[] = {0, 1, 2, 3, 4, 5, 6, 8};
+
+  bool parse_adts_header (const unsigned char *p, OMX_U32 &samplerate,
+                          OMX_U32 &nchannels, size_t &length)
+  {
+    if (0xff != p[0] || 0xf0 != (p[1] & 0xf6))
+    {
+      return false;
+    }
+
+    const unsigned int samplerate_idx = (p[2] >> 2) & 0x0f;
+    const unsigned int channel_config = ((p[2] & 0x01) << 2) | (p[3] >> 6);
+    length = ((p[3] & 0x03) << 11) | (p[4] << 3) | (p[5] >> 5);
+
+    if (samplerate_idx >= sizeof (aac_samplerates) / sizeof (OMX_U32)
+        || 0 == channel_config || length < 7)
+    {
+      return false;
+    }
+
+    samplerate = aac_samplerates[samplerate_idx];
+    nchannels = aac_channels[channel_config];
+    return true;
+  }
+
+  bool sniff_adts (const reader &r, const window &w, track_info_t &info)
+  {
+    for (size_t pos = 0; pos + 7 <= w.len; ++pos)
+    {
+      OMX_U32 samplerate = 0;
+      OMX_U32 nchannels = 0;
+      size_t length = 0;
+      if (!parse_adts_header (w.data + pos, samplerate, nchannels, length))
+      {
+        continue;
+      }
+
+      off_t offset = w.offset + static_cast< off_t > (pos);
+      OMX_U64 nbytes = length;
+      int nframes = 1;
+      while (nframes < SNIFF_MAX_CBR_FRAMES)
+      {
+        unsigned char hdr[7];
+        OMX_U32 next_samplerate = 0;
+        OMX_U32 next_nchannels = 0;
+        offset += static_cast< off_t > (length);
+        if (!read_header (r, w, offset, hdr, sizeof (hdr))
+            || !parse_adts_header (hdr, next_samplerate, next_nchannels,
+                                   length)
+            || next_samplerate != samplerate)
+        {
+          break;
+        }
+        nbytes += length;
+        ++nframes;
+      }
+
+      if (nframes < SNIFF_MIN_SYNC_FRAMES)
+      {
+        continue;
+      }
+
+      info.codec_id = OMX_AUDIO_CodingAAC;
+      info.container = OMX_FORMAT_RAW;
+      info.samplerate = samplerate;
+      info.nchannels = nchannels;
+      // Average over the frames seen, 1024 samples per frame
+      info.bitrate = static_cast< OMX_U32 > (nbytes * 8 * samplerate
+                                             / (nframes * 1024));
+      info.cbr = false;
+      return true;
+    }
+    return false;
+  }
+
+  /* FLAC */
+
+  // Parse a STREAMINFO metadata block (without the block header)
+  bool parse_flac_streaminfo (const unsigned char *p, const size_t len,
+                              const off_t file_size, track_info_t &info)
+  {
+    if (len < 18)
+    {
+      return false;
+    }
+
+    const OMX_U32 samplerate = (static_cast< OMX_U32 > (p[10]) << 12)
+                               | (static_cast< OMX_U32 > (p[11]) << 4)
+                               | (p[12] >> 4);
+    const OMX_U32 nchannels = ((p[12] >> 1) & 0x07) + 1;
+    const OMX_U32 bitdepth = (((p[12] & 0x01) << 4) | (p[13] >> 4)) + 1;
+    const OMX_U64 nsamples = (static_cast< OMX_U64 > (p[13] & 0x0f) << 32)
+                             | be32 (p + 14);
+
+    if (0 == samplerate)
+    {
+      return false;
+    }
+
+    info.codec_id = OMX_AUDIO_CodingFLAC;
+    info.samplerate = samplerate;
+    info.nchannels = nchannels;
+    info.bitdepth = bitdepth;
+    info.bitrate = nsamples > 0 ? static_cast< OMX_U32 > (
+                                      static_cast< OMX_U64 > (file_size) * 8
+                                      * samplerate / nsamples)
+                                : 0;
+    info.cbr = false;
+    return true;
+  }
+
+  bool sniff_flac (const reader &r, const window &w, track_info_t &info)
+  {
+    // "fLaC", then the STREAMINFO block, which is always the first one
+    if (!has_magic (w.data, w.len, "fLaC") || w.len < 8 + 34
+        || 0 != (w.data[4] & 0x7f))
+    {
+      return false;
+    }
+    info.container = OMX_FORMAT_RAW;
+    return parse_flac_streaminfo (w.data + 8, w.len - 8, r.size (), info);
+  }
+
+  /* Ogg (Vorbis, Opus and FLAC) */
+
+  bool sniff_ogg (const reader &r, const window &w, track_info_t &info)
+  {
+    // The first page of an Ogg stream carries just the codec's
+    // identification header
+    if (!has_magic (w.data, w.len, "OggS") || w.len < 27
+        || 0 == (w.data[5] & 0x02))
+    {
+      return false;
+    }
+
+    const size_t nsegments = w.data[26];
+    if (w.len < 27 + nsegments)
+    {
+      return false;
+    }
+
+    size_t packet_len = 0;
+    for (size_t i = 0; i < nsegments; ++i)
+    {
+      packet_len += w.data[27 + i];
+    }
+
+    const unsigned char *p = w.data + 27 + nsegments;
+    const size_t len = std::min (packet_len, w.len - 27 - nsegments);
+
+    info.container = OMX_FORMAT_OGG;
+
+    if (len >= 30 && 0x01 == p[0] && has_magic (p + 1, len - 1, "vorbis"))
+    {
+      const int32_t max_bitrate = static_cast< int32_t > (le32 (p + 16));
+      const int32_t nominal_bitrate = static_cast< int32_t > (le32 (p + 20));
+      const int32_t min_bitrate = static_cast< int32_t > (le32 (p + 24));
+      info.codec_id = OMX_AUDIO_CodingVORBIS;
+      info.nchannels = p[11];
+      info.samplerate = le32 (p + 12);
+      info.bitrate = nominal_bitrate > 0 ? nominal_bitrate : 0;
+      info.cbr = nominal_bitrate > 0 && max_bitrate == nominal_bitrate
+                 && min_bitrate == nominal_bitrate;
+      return info.nchannels > 0 && info.samplerate > 0;
+    }
+
+    if (len >= 19 && has_magic (p, len, "OpusHead"))
+    {
+      // Opus is always decoded at 48 kHz; the rate in the header is just
+      // the rate of the original input.
+      info.codec_id = OMX_AUDIO_CodingOPUS;
+      info.nchannels = p[9];
+      info.samplerate = 48000;
+      info.bitrate = 0;
+      info.cbr = false;
+      return info.nchannels > 0;
+    }
+
+    if (len >= 13 + 4 + 34 && 0x7f == p[0] && has_magic (p + 1, len - 1, "FLAC")
+        && has_magic (p + 9, len - 9, "fLaC") && 0 == (p[13] & 0x7f))
+    {
+      return parse_flac_streaminfo (p + 17, len - 17, r.size (), info);
+    }
+
+    return false;
+  }
+
+  /* WAV */
+
+  bool sniff_wav (const reader &r, const window &w, track_info_t &info)
+  {
+    if (w.len < 12 || !has_magic (w.data, w.len, "RIFF")
+        || !has_magic (w.data + 8, w.len - 8, "WAVE"))
+    {
+      return false;
+    }
+
+    // Walk the chunk headers until 'fmt ' is found
+    off_t offset = w.offset + 12;
+    while (offset + 8 <= r.size ())
+    {
+      unsigned char hdr[8];
+      if (!read_header (r, w, offset, hdr, sizeof (hdr)))
+      {
+        return false;
+      }
+
+      const off_t chunk_len = le32 (hdr + 4);
+      if (has_magic (hdr, sizeof (hdr), "fmt "))
+      {
+        unsigned char fmt[40];
+        const size_t fmt_len
+            = std::min (sizeof (fmt), static_cast< size_t > (chunk_len));
+        if (fmt_len < 16 || !read_header (r, w, offset + 8, fmt, fmt_len))
+        {
+          return false;
+        }
+
+        OMX_U32 format_tag = le16 (fmt);
+        if (0xfffe == format_tag && fmt_len >= 26)
+        {
+          // WAVE_FORMAT_EXTENSIBLE; the format is in the sub-format GUID
+          format_tag = le16 (fmt + 24);
+        }
+
+        // Only integer PCM is handled by the PCM graph
+        if (1 != format_tag)
+        {
+          return false;
+        }
+
+        info.codec_id = OMX_AUDIO_CodingPCM;
+        info.container = OMX_FORMAT_RAW;
+        info.nchannels = le16 (fmt + 2);
+        info.samplerate = le32 (fmt + 4);
+        info.bitrate = le32 (fmt + 8) * 8;
+        info.bitdepth = le16 (fmt + 14);
+        info.endianness = OMX_EndianLittle;
+        info.sign = (8 == info.bitdepth) ? OMX_NumericalDataUnsigned
+                                         : OMX_NumericalDataSigned;
+        info.cbr = true;
+        return info.nchannels > 0 && info.samplerate > 0 && info.bitdepth > 0;
+      }
+
+      offset += 8 + chunk_len + (chunk_len & 1);
+    }
+    return false;
+  }
+
+  /* MP4 */
+
+  // Find the first box of the given type in [begin, end). On success,
+  // 'payload' and 'box_end' delimit the contents of the box.
+  bool find_box (const reader &r, const window &w, off_t begin,
+                 const off_t end, const char *p_type, off_t &payload,
+                 off_t &box_end)
+  {
+    while (begin + 8 <= end)
+    {
+      unsigned char hdr[16];
+      if (!read_header (r, w, begin, hdr, 8))
+      {
+        return false;
+      }
+
+      off_t size = be32 (hdr);
+      off_t header_len = 8;
+      if (1 == size)
+      {
+        if (!read_header (r, w, begin + 8, hdr + 8, 8))
+        {
+          return false;
+        }
+        size = static_cast< off_t > (be64 (hdr + 8));
+        header_len = 16;
+      }
+      else if (0 == size)
+      {
+        size = end - begin;
+      }
+
+      if (size < header_len || begin + size > end)
+      {
+        return false;
+      }
+
+      if (0 == memcmp (hdr + 4, p_type, 4))
+      {
+        payload = begin + header_len;
+        box_end = begin + size;
+        return true;
+      }
+      begin += size;
+    }
+    return false;
+  }
+
+  // Read an MPEG-4 descriptor's tag and length
+  bool read_descriptor (const unsigned char *&p, const unsigned char *p_end,
+                        unsigned int &tag, size_t &len)
+  {
+    if (p >= p_end)
+    {
+      return false;
+    }
+    tag = *p++;
+    len = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (p >= p_end)
+      {
+        return false;
+      }
+      const unsigned char b = *p++;
+      len = (len << 7) | (b & 0x7f);
+      if (0 == (b & 0x80))
+      {
+        break;
+      }
+    }
+    return true;
+  }
+
+  // Parse the 'esds' box of an 'mp4a' sample entry
+  bool parse_esds (const unsigned char *p, const unsigned char *p_end,
+                   track_info_t &info)
+  {
+    unsigned int tag = 0;
+    size_t len = 0;
+
+    p += 4;  // version and flags
+    if (!read_descriptor (p, p_end, tag, len) || 0x03 != tag || p + 3 > p_end)
+    {
+      return false;
+    }
+
+    // ES_Descriptor
+    const unsigned int flags = p[2];
+    p += 3;
+    if (flags & 0x80)
+    {
+      p += 2;
+    }
+    if ((flags & 0x40) && p < p_end)
+    {
+      p += 1 + *p;
+    }
+    if (flags & 0x20)
+    {
+      p += 2;
+    }
+
+    // DecoderConfigDescriptor
+    if (!read_descriptor (p, p_end, tag, len) || 0x04 != tag || p + 13 > p_end)
+    {
+      return false;
+    }
+
+    // MPEG-4 audio, or one of the MPEG-2 AAC profiles
+    const unsigned int object_type = p[0];
+    if (0x40 != object_type && 0x66 != object_type && 0x67 != object_type
+        && 0x68 != object_type)
+    {
+      return false;
+    }
+
+    const OMX_U32 max_bitrate = be32 (p + 5);
+    const OMX_U32 avg_bitrate = be32 (p + 9);
+    p += 13;
+
+    // DecoderSpecificInfo, i.e. the AudioSpecificConfig
+    if (!read_descriptor (p, p_end, tag, len) || 0x05 != tag || len < 2
+        || p + 2 > p_end)
+    {
+      return false;
+    }
+
+    const unsigned int samplerate_idx = ((p[0] & 0x07) << 1) | (p[1] >> 7);
+    const unsigned int channel_config = (p[1] >> 3) & 0x0f;
+    if (31 == (p[0] >> 3)
+        || samplerate_idx >= sizeof (aac_samplerates) / sizeof (OMX_U32))
+    {
+      return false;
+    }
+
+    info.codec_id = OMX_AUDIO_CodingAAC;
+    info.samplerate = aac_samplerates[samplerate_idx];
+    if (channel_config > 0
+        && channel_config < sizeof (aac_channels) / sizeof (OMX_U32))
+    {
+      info.nchannels = aac_channels[channel_config];
+    }
+    info.bitrate = avg_bitrate > 0 ? avg_bitrate : max_bitrate;
+    info.cbr = false;
+    return true;
+  }
+
+  bool sniff_mp4_track (const reader &r, const window &w, const off_t begin,
+                        const off_t end, track_info_t &info)
+  {
+    off_t mdia = 0, mdia_end = 0, hdlr = 0, hdlr_end = 0, minf = 0,
+          minf_end = 0, stbl = 0, stbl_end = 0, stsd = 0, stsd_end = 0;
+    unsigned char handler[12];
+
+    if (!find_box (r, w, begin, end, "mdia", mdia, mdia_end)
+        || !find_box (r, w, mdia, mdia_end, "hdlr", hdlr, hdlr_end)
+        || !read_header (r, w, hdlr, handler, sizeof (handler))
+        || 0 != memcmp (handler + 8, "soun", 4)
+        || !find_box (r, w, mdia, mdia_end, "minf", minf, minf_end)
+        || !find_box (r, w, minf, minf_end, "stbl", stbl, stbl_end)
+        || !find_box (r, w, stbl, stbl_end, "stsd", stsd, stsd_end))
+    {
+      return false;
+    }
+
+    unsigned char entries[SNIFF_MAX_STSD_SIZE];
+    const size_t len = std::min (sizeof (entries),
+                                 static_cast< size_t > (stsd_end - stsd));
+    // version/flags, entry count, then the first sample entry: size, format,
+    // 8 bytes of SampleEntry and 20 of AudioSampleEntry
+    if (len < 8 + 36 || !read_header (r, w, stsd, entries, len)
+        || 0 != memcmp (entries + 12, "mp4a", 4))
+    {
+      return false;
+    }
+
+    const size_t entry_len
+        = std::min (static_cast< size_t > (be32 (entries + 8)), len - 8);
+    const unsigned char *p_entry = entries + 8;
+    const unsigned char *p_end = p_entry + entry_len;
+    info.nchannels = be16 (p_entry + 24);
+
+    // The child boxes follow the AudioSampleEntry, whose size depends on its
+    // version (QuickTime files); just look for the 'esds' box.
+    for (const unsigned char *p = p_entry + 36; p + 8 <= p_end; ++p)
+    {
+      const size_t box_len = be32 (p);
+      if (0 == memcmp (p + 4, "esds", 4) && box_len >= 8
+          && p + box_len <= p_end)
+      {
+        return parse_esds (p + 8, p + box_len, info);
+      }
+    }
+    return false;
+  }
+
+  bool sniff_mp4 (const reader &r, const window &w, track_info_t &info)
+  {
+    if (w.len < 8 || !has_magic (w.data + 4, w.len - 4, "ftyp"))
+    {
+      return false;
+    }
+
+    // The 'moov' box may be anywhere in the file; only the box headers are
+    // read until it's found.
+    off_t moov = 0, moov_end = 0;
+    if (!find_box (r, w, w.offset, r.size (), "moov", moov, moov_end))
+    {
+      return false;
+    }
+
+    off_t trak = 0, trak_end = moov;
+    while (find_box (r, w, trak_end, moov_end, "trak", trak, trak_end))
+    {
+      if (sniff_mp4_track (r, w, trak, trak_end, info))
+      {
+        info.container = OMX_FORMAT_RAW;
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+bool tiz::sniffer::sniff (const std::string &uri, medialib::track_info &info)
+{
+  reader r (uri);
+  if (!r.is_open ())
+  {
+    return false;
+  }
+
+  window w;
+  w.offset = 0;
+  w.len = r.read (w.offset, w.data, sizeof (w.data));
+
+  const off_t tag_len = id3v2_size (w.data, w.len);
+  if (tag_len > 0)
+  {
+    w.offset = tag_len;
+    w.len = r.read (w.offset, w.data, sizeof (w.data));
+  }
+
+  // Same defaults as when probing with MediaInfo
+  info.samplerate = 48000;
+  info.bitrate = 0;
+  info.nchannels = 2;
+  info.bitdepth = 16;
+  info.endianness = OMX_EndianLittle;
+  info.sign = OMX_NumericalDataSigned;
+  info.cbr = false;
+
+  // The formats with a magic number first, then the frame sync based ones
+  const bool found = sniff_flac (r, w, info) || sniff_ogg (r, w, info)
+                     || sniff_wav (r, w, info) || sniff_mp4 (r, w, info)
+                     || sniff_adts (r, w, info) || sniff_mpa (r, w, info);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE,
+           "[%s] : found [%s] codec [%0x] container [%0x] rate [%lu] ch [%lu] "
+           "bits [%lu] bitrate [%lu] cbr [%s]",
+           uri.c_str (), found ? "YES" : "NO", info.codec_id, info.container,
+           info.samplerate, info.nchannels, info.bitdepth, info.bitrate,
+           info.cbr ? "YES" : "NO");
+
+  return found;
+}
@@ -0,0 +1,63 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizsniffer.hpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Native container and codec header parsing
+ *
+ *
+ */
+
+#ifndef TIZSNIFFER_HPP
+#define TIZSNIFFER_HPP
+
+#include <string>
+
+#include "tizmedialib.hpp"
+
+namespace tiz
+{
+  /**
+   * Identifies local media files by parsing the container and codec headers
+   * found at the start of the file. Recognises MPEG audio (MP2/MP3, with or
+   * without ID3v2 tags), ADTS AAC, native and Ogg FLAC, Ogg Vorbis, Ogg Opus,
+   * AAC in MP4/M4A and PCM WAV files.
+   *
+   * Only a few KB are read (plus a handful of box headers for MP4 files whose
+   * 'moov' box is at the end), which makes this much cheaper than a full
+   * MediaInfo analysis. Anything not recognised should be probed with
+   * MediaInfo instead.
+   */
+  class sniffer
+  {
+  public:
+    /**
+     * Fill in the container, codec and stream properties of a track
+     * (codec_id, container, samplerate, bitrate, nchannels, bitdepth,
+     * endianness, sign and cbr). The remaining fields are not modified.
+     *
+     * @return true if the format was recognised.
+     */
+    static bool sniff (const std::string &uri, medialib::track_info &info);
+  };
+}  // namespace tiz
+
+#endif  // TIZSNIFFER_HPP
@@ -0,0 +1,1193 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tiztranscoder.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Offline decoding and transcoding of local media files
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/make_shared.hpp>
+
+#include <OMX_Component.h>
+#include <OMX_Core.h>
+#include <OMX_TizoniaExt.h>
+
+#include <tizplatform.h>
+
+#include "tizgraphutil.hpp"
+#include "tizprobe.hpp"
+#include "tiztranscoder.hpp"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.play.transcoder"
+#endif
+
+namespace graph = tiz::graph;
+
+namespace  // unnamed
+{
+  // Maximum time allowed for all the components in a graph to complete a
+  // state transition
+  const int TRANSCODER_TRANSITION_TIMEOUT_SECS = 30;
+
+  const OMX_U32 TRANSCODER_PCM_BITS_PER_SAMPLE = 16;
+
+  // The ogg demuxer's video port is not used by any of these graphs
+  const OMX_U32 TRANSCODER_DEMUXER_VIDEO_PORT = 1;
+
+  const OMX_U32 TRANSCODER_DECODER_OUTPUT_PORT = 1;
+
+  typedef std::map< std::string, double > thread_cpu_map_t;
+
+  double now_secs ()
+  {
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+  }
+
+  // A JSON string literal, quotes included
+  std::string json_string (const std::string &str)
+  {
+    std::string quoted ("\"");
+    BOOST_FOREACH (const char c, str)
+    {
+      if ('"' == c || '\\' == c)
+      {
+        quoted += '\\';
+        quoted += c;
+      }
+      else if (static_cast< unsigned char >(c) < 0x20)
+      {
+        char escaped[8];
+        snprintf (escaped, sizeof (escaped), "\\u%04x", c);
+        quoted += escaped;
+      }
+      else
+      {
+        quoted += c;
+      }
+    }
+    return quoted + "\"";
+  }
+
+  // Both the mp3 encoder and the cache of decoded PCM consume 16-bit signed
+  // interleaved samples, so the decoder output must be in that format.
+  void get_decoded_pcm_info (tizprobe_ptr_t probe,
+                             OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype)
+  {
+    probe->get_pcm_codec_info (pcmtype);
+    pcmtype.nBitPerSample = TRANSCODER_PCM_BITS_PER_SAMPLE;
+    pcmtype.eNumData = OMX_NumericalDataSigned;
+    pcmtype.eEndian = OMX_EndianLittle;
+    pcmtype.bInterleaved = OMX_TRUE;
+  }
+
+  // The name libtizonia gives to a component's scheduler thread: the
+  // component name without the 'OMX.Company.' prefix, up to the next dot, and
+  // at most 15 characters long.
+  std::string scheduler_thread_name (const std::string &comp_name)
+  {
+    std::string name;
+    const std::size_t first_dot = comp_name.find ('.');
+    const std::size_t second_dot = first_dot == std::string::npos
+                                       ? std::string::npos
+                                       : comp_name.find ('.', first_dot + 1);
+    if (second_dot != std::string::npos)
+    {
+      const std::size_t third_dot = comp_name.find ('.', second_dot + 1);
+      name = comp_name.substr (second_dot + 1,
+                               third_dot == std::string::npos
+                                   ? std::string::npos
+                                   : third_dot - second_dot - 1);
+      if (name.length () > 15)
+      {
+        name.resize (15);
+      }
+    }
+    return name;
+  }
+
+  // CPU time (user + system, in seconds) used so far by the threads of this
+  // process, added up by thread name.
+  void sample_thread_cpu (thread_cpu_map_t &cpu)
+  {
+    namespace bf = boost::filesystem;
+    const double ticks_per_sec = sysconf (_SC_CLK_TCK);
+    boost::system::error_code ec;
+    cpu.clear ();
+    for (bf::directory_iterator it ("/proc/self/task", ec), end;
+         !ec && it != end; it.increment (ec))
+    {
+      std::ifstream comm ((it->path () / "comm").string ().c_str ());
+      std::ifstream stat ((it->path () / "stat").string ().c_str ());
+      std::string name;
+      std::string line;
+      if (std::getline (comm, name) && std::getline (stat, line))
+      {
+        // The thread name may contain spaces; the numeric fields start after
+        // the closing parenthesis. utime and stime are the 12th and 13th of
+        // them.
+        const std::size_t pos = line.rfind (')');
+        if (pos != std::string::npos)
+        {
+          std::istringstream fields (line.substr (pos + 1));
+          std::string field;
+          unsigned long long utime = 0;
+          unsigned long long stime = 0;
+          for (int i = 0; i < 11 && (fields >> field); ++i)
+          {
+          }
+          if (fields >> utime >> stime)
+          {
+            cpu[name] += (utime + stime) / ticks_per_sec;
+          }
+        }
+      }
+    }
+  }
+
+  // Reads one of the memory fields (e.g. VmRSS or VmHWM) in
+  // /proc/self/status. Returns KiB, or -1 if not available.
+  long read_proc_status_kib (const std::string &field)
+  {
+    std::ifstream status ("/proc/self/status");
+    const std::string key (field + ":");
+    std::string line;
+    while (std::getline (status, line))
+    {
+      if (0 == line.compare (0, key.length (), key))
+      {
+        return strtol (line.c_str () + key.length (), NULL, 10);
+      }
+    }
+    return -1;
+  }
+
+  // Sets the process' peak RSS (VmHWM) back to its current RSS (Linux >=
+  // 4.0).
+  bool reset_peak_rss ()
+  {
+    std::ofstream clear_refs ("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.flush ();
+    return clear_refs.good ();
+  }
+
+  OMX_ERRORTYPE get_flow_stats_index (const OMX_HANDLETYPE handle,
+                                      OMX_INDEXTYPE &id)
+  {
+    return OMX_GetExtensionIndex (
+        handle,
+        const_cast< OMX_STRING > (OMX_TIZONIA_INDEX_CONFIG_BUFFER_FLOW_STATS),
+        &id);
+  }
+
+  // Adds up the buffers handed over to the peers on all the ports of a
+  // component, and retrieves the time spent by its scheduler running the
+  // servants (in microseconds).
+  void read_flow_stats (const OMX_HANDLETYPE handle, OMX_U64 &buffers,
+                        OMX_U64 &tick_time)
+  {
+    OMX_INDEXTYPE id = OMX_IndexMax;
+    buffers = 0;
+    tick_time = 0;
+    if (OMX_ErrorNone != get_flow_stats_index (handle, id))
+    {
+      return;
+    }
+
+    // Stop at the first port index the component does not know about
+    OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE stats;
+    for (OMX_U32 pid = 0;; ++pid)
+    {
+      TIZ_INIT_OMX_PORT_STRUCT (stats, pid);
+      if (OMX_ErrorNone != OMX_GetConfig (handle, id, &stats))
+      {
+        break;
+      }
+      buffers += stats.nBuffersReturned;
+      tick_time = stats.nTickTime;
+    }
+  }
+}
+
+//
+// component_stats
+//
+tiz::component_stats::component_stats ()
+  : name (),
+    cpu_seconds (-1.0),
+    busy_seconds (0.0),
+    buffers_per_sec (0.0),
+    rss_kib (-1)
+{
+}
+
+//
+// transcode_job
+//
+tiz::transcode_job::transcode_job (const std::string &uri,
+                                   const std::string &output,
+                                   const OMX_U32 bitrate_kbps,
+                                   const bool benchmark /* = false */)
+  : uri_ (uri),
+    output_ (output),
+    bitrate_kbps_ (benchmark ? 0 : bitrate_kbps),
+    benchmark_ (benchmark),
+    probe_ (),
+    handles_ (),
+    h2n_ (),
+    tunnelled_ (false),
+    state_ (OMX_StateLoaded),
+    transitions_ (0),
+    port_disables_ (0),
+    eos_ (false),
+    error_ (OMX_ErrorNone),
+    error_msg_ (),
+    bench_stats_ (),
+    start_cpu_ (),
+    start_time_ (0.0),
+    startup_ (0.0),
+    elapsed_ (0.0),
+    peak_rss_kib_ (-1)
+{
+  TIZ_INIT_OMX_PORT_STRUCT (pcmtype_, 0);
+  callbacks_.EventHandler = &transcode_job::event_handler;
+  callbacks_.EmptyBufferDone = &transcode_job::empty_buffer_done;
+  callbacks_.FillBufferDone = &transcode_job::fill_buffer_done;
+}
+
+tiz::transcode_job::~transcode_job ()
+{
+  tear_down ();
+}
+
+bool tiz::transcode_job::run (double &duration)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  probe_ = boost::make_shared< tiz::probe >(uri_, true);
+  // Only used if the decoder's output can't be measured
+  duration = probe_->stream_duration ();
+
+  omx_comp_name_lst_t comp_list;
+  omx_comp_role_lst_t role_list;
+  if (!select_components (comp_list, role_list))
+  {
+    return false;
+  }
+
+  omx_comp_role_pos_lst_t role_positions;
+  if (OMX_ErrorNone != (rc = graph::util::verify_comp_list (comp_list))
+      || OMX_ErrorNone
+             != (rc = graph::util::verify_role_list (comp_list, role_list,
+                                                     role_positions)))
+  {
+    return fail (rc, "Unable to find the required components");
+  }
+
+  if (benchmark_ && !reset_peak_rss ())
+  {
+    TIZ_LOG (TIZ_PRIORITY_NOTICE, "Unable to reset the peak RSS");
+  }
+
+  if (OMX_ErrorNone != (rc = instantiate (comp_list)))
+  {
+    return fail (rc, "Unable to instantiate the graph");
+  }
+
+  if (OMX_ErrorNone
+          != (rc = graph::util::set_role_list (handles_, role_list,
+                                               role_positions))
+      || OMX_ErrorNone != (rc = configure ()))
+  {
+    return fail (rc, "Unable to configure the graph");
+  }
+
+  if (OMX_ErrorNone != (rc = graph::util::setup_suppliers (handles_))
+      || OMX_ErrorNone != (rc = graph::util::setup_tunnels (handles_)))
+  {
+    return fail (rc, "Unable to set up the tunnels");
+  }
+  tunnelled_ = true;
+
+  if (role_list[0] == "source.container_demuxer.ogg"
+      && !disable_port (handles_[0], TRANSCODER_DEMUXER_VIDEO_PORT))
+  {
+    return false;
+  }
+
+  const double startup_begin = now_secs ();
+  if (!transition (OMX_StateIdle))
+  {
+    return false;
+  }
+
+  if (benchmark_)
+  {
+    sample_thread_cpu (start_cpu_);
+  }
+  start_time_ = now_secs ();
+
+  if (!transition (OMX_StateExecuting))
+  {
+    return false;
+  }
+  startup_ = now_secs () - startup_begin;
+
+  // The file writer signals OMX_BUFFERFLAG_EOS once the last buffer has been
+  // written to disk (and the null renderer, once it has been received).
+  {
+    boost::unique_lock< boost::mutex > lock (mutex_);
+    while (!eos_ && OMX_ErrorNone == error_)
+    {
+      cond_.wait (lock);
+    }
+    elapsed_ = now_secs () - start_time_;
+    if (OMX_ErrorNone != error_)
+    {
+      return false;
+    }
+  }
+
+  const double decoded = decoded_seconds ();
+  if (decoded >= 0.0)
+  {
+    duration = decoded;
+  }
+
+  if (benchmark_)
+  {
+    collect_bench_stats ();
+  }
+  return true;
+}
+
+void tiz::transcode_job::cancel ()
+{
+  boost::lock_guard< boost::mutex > lock (mutex_);
+  if (OMX_ErrorNone == error_)
+  {
+    error_ = OMX_ErrorCommandCanceled;
+    error_msg_ = "Cancelled";
+  }
+  cond_.notify_all ();
+}
+
+const OMX_AUDIO_PARAM_PCMMODETYPE &tiz::transcode_job::pcm_info () const
+{
+  return pcmtype_;
+}
+
+const std::string &tiz::transcode_job::error_msg () const
+{
+  return error_msg_;
+}
+
+const tiz::component_stats_lst_t &tiz::transcode_job::bench_stats () const
+{
+  return bench_stats_;
+}
+
+double tiz::transcode_job::startup () const
+{
+  return startup_;
+}
+
+double tiz::transcode_job::elapsed () const
+{
+  return elapsed_;
+}
+
+long tiz::transcode_job::peak_rss_kib () const
+{
+  return peak_rss_kib_;
+}
+
+bool tiz::transcode_job::select_components (omx_comp_name_lst_t &comp_list,
+                                            omx_comp_role_lst_t &role_list)
+{
+  if (probe_->get_omx_domain () != OMX_PortDomainAudio)
+  {
+    return fail (OMX_ErrorFormatNotDetected, "Not an audio file");
+  }
+
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (pcmtype, 0);
+  probe_->get_pcm_codec_info (pcmtype);
+
+  // The null renderer takes whatever the decoder produces; the encoder and
+  // the file writer need 16-bit samples.
+  const bool is_16bit
+      = pcmtype.nBitPerSample == TRANSCODER_PCM_BITS_PER_SAMPLE;
+  bool use_demuxer = false;
+  std::string decoder;
+  std::string decoder_role;
+
+  // NOTE: Some of the codings used here are Tizonia extensions that lie
+  // outside the OMX_AUDIO_CODINGTYPE enumeration
+  switch (static_cast< OMX_U32 >(probe_->get_audio_coding_type ()))
+  {
+    case OMX_AUDIO_CodingMP3:
+    {
+      decoder = "OMX.Aratelia.audio_decoder.mp3";
+      decoder_role = "audio_decoder.mp3";
+    }
+    break;
+    case OMX_AUDIO_CodingMP2:
+    {
+      if (!benchmark_)
+      {
+        return fail (OMX_ErrorFormatNotDetected, "Unsupported format");
+      }
+      decoder = "OMX.Aratelia.audio_decoder.mpeg";
+      decoder_role = "audio_decoder.mp2";
+    }
+    break;
+    case OMX_AUDIO_CodingAAC:
+    {
+      decoder = "OMX.Aratelia.audio_decoder.aac";
+      decoder_role = "audio_decoder.aac";
+    }
+    break;
+    case OMX_AUDIO_CodingFLAC:
+    {
+      if (!benchmark_
+          && (probe_->get_container_type () == OMX_FORMAT_OGG || !is_16bit))
+      {
+        return fail (OMX_ErrorFormatNotDetected,
+                     "Only native 16-bit FLAC files are supported");
+      }
+      use_demuxer = probe_->get_container_type () == OMX_FORMAT_OGG;
+      decoder = "OMX.Aratelia.audio_decoder.flac";
+      decoder_role = "audio_decoder.flac";
+    }
+    break;
+    case OMX_AUDIO_CodingOPUS:
+    {
+      decoder = "OMX.Aratelia.audio_decoder.opusfile.opus";
+      decoder_role = "audio_decoder.opus";
+    }
+    break;
+    case OMX_AUDIO_CodingVORBIS:
+    {
+      // NOTE: The vorbis decoder produces floating point samples, which
+      // the mp3 encoder can't consume.
+      if (!benchmark_)
+      {
+        return fail (OMX_ErrorFormatNotDetected, "Unsupported format");
+      }
+      use_demuxer = true;
+      decoder = "OMX.Aratelia.audio_decoder.vorbis";
+      decoder_role = "audio_decoder.vorbis";
+    }
+    break;
+    case OMX_AUDIO_CodingPCM:
+    {
+      if (!benchmark_ && !is_16bit)
+      {
+        return fail (OMX_ErrorFormatNotDetected,
+                     "Only 16-bit PCM files are supported");
+      }
+      decoder = "OMX.Aratelia.audio_decoder.pcm";
+      decoder_role = "audio_decoder.pcm";
+    }
+    break;
+    default:
+    {
+      return fail (OMX_ErrorFormatNotDetected, "Unsupported format");
+    }
+  };
+
+  if (use_demuxer)
+  {
+    comp_list.push_back ("OMX.Aratelia.container_demuxer.ogg");
+    role_list.push_back ("source.container_demuxer.ogg");
+  }
+  else
+  {
+    comp_list.push_back ("OMX.Aratelia.file_reader.binary");
+    role_list.push_back ("audio_reader.binary");
+  }
+  comp_list.push_back (decoder);
+  role_list.push_back (decoder_role);
+
+  if (benchmark_)
+  {
+    comp_list.push_back ("OMX.Aratelia.audio_renderer.null.pcm");
+    role_list.push_back ("audio_renderer.pcm");
+    return true;
+  }
+
+  if (bitrate_kbps_ > 0)
+  {
+    comp_list.push_back ("OMX.Aratelia.audio_encoder.mp3");
+    role_list.push_back ("audio_encoder.mp3");
+  }
+  comp_list.push_back ("OMX.Aratelia.file_writer.binary");
+  role_list.push_back ("audio_writer.binary");
+  return true;
+}
+
+// Components are loaded one at a time, so that the memory taken by each of
+// them can be told apart.
+OMX_ERRORTYPE tiz::transcode_job::instantiate (
+    const omx_comp_name_lst_t &comp_list)
+{
+  for (std::size_t i = 0; i < comp_list.size (); ++i)
+  {
+    component_stats stats;
+    const long rss_before = read_proc_status_kib ("VmRSS");
+    handles_.push_back (OMX_HANDLETYPE (NULL));
+    tiz_check_omx (graph::util::instantiate_component (
+        comp_list[i], i, this, &callbacks_, handles_, h2n_));
+    const long rss_after = read_proc_status_kib ("VmRSS");
+    if (benchmark_)
+    {
+      stats.name = comp_list[i];
+      if (rss_before >= 0 && rss_after >= 0)
+      {
+        stats.rss_kib = rss_after - rss_before;
+      }
+      bench_stats_.push_back (stats);
+    }
+  }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE tiz::transcode_job::configure ()
+{
+  tiz_check_omx (configure_decoder ());
+  tiz_check_omx (graph::util::set_content_uri (handles_[0], uri_));
+
+  if (benchmark_)
+  {
+    get_sink_pcm_info (pcmtype_);
+    return graph::util::set_pcm_mode (
+        handles_.back (), 0,
+        boost::bind (&tiz::transcode_job::get_sink_pcm_info, this, _1));
+  }
+
+  tiz_check_omx (graph::util::set_content_uri (handles_.back (), output_));
+
+  get_decoded_pcm_info (probe_, pcmtype_);
+
+  if (bitrate_kbps_ > 0)
+  {
+    const OMX_HANDLETYPE encoder = handles_[2];
+    tiz_check_omx (graph::util::set_pcm_mode (
+        encoder, 0, boost::bind (&get_decoded_pcm_info, probe_, _1)));
+
+    OMX_AUDIO_PARAM_MP3TYPE mp3type;
+    TIZ_INIT_OMX_PORT_STRUCT (mp3type, 1);
+    tiz_check_omx (
+        OMX_GetParameter (encoder, OMX_IndexParamAudioMp3, &mp3type));
+    mp3type.nChannels = pcmtype_.nChannels;
+    mp3type.nSampleRate = pcmtype_.nSamplingRate;
+    mp3type.nBitRate = bitrate_kbps_;
+    mp3type.eChannelMode = pcmtype_.nChannels == 1
+                               ? OMX_AUDIO_ChannelModeMono
+                               : OMX_AUDIO_ChannelModeStereo;
+    tiz_check_omx (
+        OMX_SetParameter (encoder, OMX_IndexParamAudioMp3, &mp3type));
+  }
+
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE tiz::transcode_job::configure_decoder ()
+{
+  bool need_port_settings_changed_evt = false;
+  const OMX_HANDLETYPE decoder = handles_[1];
+
+  switch (static_cast< OMX_U32 >(probe_->get_audio_coding_type ()))
+  {
+    case OMX_AUDIO_CodingMP3:
+    {
+      tiz_check_omx (graph::util::set_mp3_type (
+          decoder, 0, boost::bind (&tiz::probe::get_mp3_codec_info, probe_, _1),
+          need_port_settings_changed_evt));
+    }
+    break;
+    case OMX_AUDIO_CodingAAC:
+    {
+      tiz_check_omx (graph::util::set_aac_type (
+          decoder, 0, boost::bind (&tiz::probe::get_aac_codec_info, probe_, _1),
+          need_port_settings_changed_evt));
+    }
+    break;
+    case OMX_AUDIO_CodingFLAC:
+    {
+      tiz_check_omx (graph::util::set_flac_type (
+          decoder, 0,
+          boost::bind (&tiz::probe::get_flac_codec_info, probe_, _1),
+          need_port_settings_changed_evt));
+    }
+    break;
+    case OMX_AUDIO_CodingVORBIS:
+    {
+      OMX_AUDIO_PARAM_VORBISTYPE vorbistype;
+      TIZ_INIT_OMX_PORT_STRUCT (vorbistype, 0);
+      tiz_check_omx (
+          OMX_GetParameter (decoder, OMX_IndexParamAudioVorbis, &vorbistype));
+      probe_->get_vorbis_codec_info (vorbistype);
+      vorbistype.nPortIndex = 0;
+      tiz_check_omx (
+          OMX_SetParameter (decoder, OMX_IndexParamAudioVorbis, &vorbistype));
+    }
+    break;
+    default:
+    {
+      // The opus, mpeg and pcm decoders find out the stream properties
+      // themselves
+    }
+    break;
+  };
+
+  return OMX_ErrorNone;
+}
+
+// The stream's rate and channels, in the sample format the decoder produces
+void tiz::transcode_job::get_sink_pcm_info (
+    OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype)
+{
+  OMX_AUDIO_PARAM_PCMMODETYPE dec_pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (dec_pcmtype, 1);
+  probe_->get_pcm_codec_info (pcmtype);
+  if (OMX_ErrorNone
+      == OMX_GetParameter (handles_[1], OMX_IndexParamAudioPcm, &dec_pcmtype))
+  {
+    pcmtype.eEndian = dec_pcmtype.eEndian;
+    pcmtype.nBitPerSample = dec_pcmtype.nBitPerSample;
+    pcmtype.eNumData = dec_pcmtype.eNumData;
+    pcmtype.bInterleaved = dec_pcmtype.bInterleaved;
+  }
+}
+
+// The amount of audio the decoder has delivered so far, worked out from the
+// bytes that left its output port. The probe's duration comes from TagLib,
+// in whole seconds, and is not known at all for ADTS AAC files. Returns < 0
+// if it can't be measured.
+double tiz::transcode_job::decoded_seconds () const
+{
+  const OMX_HANDLETYPE decoder = handles_[1];
+  OMX_INDEXTYPE id = OMX_IndexMax;
+  OMX_TIZONIA_CONFIG_BUFFERFLOWSTATSTYPE stats;
+  OMX_AUDIO_PARAM_PCMMODETYPE dec_pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (stats, TRANSCODER_DECODER_OUTPUT_PORT);
+  TIZ_INIT_OMX_PORT_STRUCT (dec_pcmtype, TRANSCODER_DECODER_OUTPUT_PORT);
+  if (OMX_ErrorNone != get_flow_stats_index (decoder, id)
+      || OMX_ErrorNone != OMX_GetConfig (decoder, id, &stats)
+      || OMX_ErrorNone != OMX_GetParameter (decoder, OMX_IndexParamAudioPcm,
+                                            &dec_pcmtype))
+  {
+    return -1.0;
+  }
+
+  const OMX_U64 frame_size
+      = dec_pcmtype.nChannels * (dec_pcmtype.nBitPerSample / 8);
+  if (0 == frame_size || 0 == dec_pcmtype.nSamplingRate)
+  {
+    return -1.0;
+  }
+  return static_cast< double >(stats.nBytesReturned / frame_size)
+         / dec_pcmtype.nSamplingRate;
+}
+
+// The decoder may reconfigure its output port once it has seen the actual
+// stream. There is no renderer in this graph that could follow the change,
+// so the new settings must match what the rest of the graph was told.
+void tiz::transcode_job::check_decoder_output ()
+{
+  OMX_AUDIO_PARAM_PCMMODETYPE dec_pcmtype;
+  TIZ_INIT_OMX_PORT_STRUCT (dec_pcmtype, 1);
+  if (OMX_ErrorNone
+          != OMX_GetParameter (handles_[1], OMX_IndexParamAudioPcm,
+                               &dec_pcmtype)
+      || dec_pcmtype.nChannels != pcmtype_.nChannels
+      || dec_pcmtype.nSamplingRate != pcmtype_.nSamplingRate
+      || dec_pcmtype.nBitPerSample != pcmtype_.nBitPerSample)
+  {
+    error_msg_ = "Decoder output format changed mid-stream";
+    error_ = OMX_ErrorFormatNotDetected;
+  }
+}
+
+bool tiz::transcode_job::disable_port (const OMX_HANDLETYPE handle,
+                                       const OMX_U32 pid)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    port_disables_ = 0;
+  }
+  if (OMX_ErrorNone != (rc = graph::util::disable_port (handle, pid)))
+  {
+    return fail (rc, "Unable to disable a port");
+  }
+  return wait_for_completion (port_disables_, 1);
+}
+
+bool tiz::transcode_job::wait_for_completion (std::size_t &counter,
+                                              const std::size_t count)
+{
+  boost::unique_lock< boost::mutex > lock (mutex_);
+  const boost::system_time deadline
+      = boost::get_system_time ()
+        + boost::posix_time::seconds (TRANSCODER_TRANSITION_TIMEOUT_SECS);
+  while (counter < count && OMX_ErrorNone == error_)
+  {
+    if (!cond_.timed_wait (lock, deadline))
+    {
+      error_ = OMX_ErrorTimeout;
+      error_msg_ = "Timed out waiting for a command to complete";
+    }
+  }
+  return OMX_ErrorNone == error_;
+}
+
+bool tiz::transcode_job::transition (const OMX_STATETYPE to)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    transitions_ = 0;
+  }
+  if (OMX_ErrorNone
+      != (rc = graph::util::transition_all (handles_, to, state_)))
+  {
+    return fail (rc, "Unable to send a state transition command");
+  }
+
+  if (!wait_for_completion (transitions_, handles_.size ()))
+  {
+    return false;
+  }
+  state_ = to;
+  return true;
+}
+
+// NOTE: This is called once the end of stream has been reached, with the
+// graph still in OMX_StateExecuting
+void tiz::transcode_job::collect_bench_stats ()
+{
+  thread_cpu_map_t cpu;
+  sample_thread_cpu (cpu);
+  const double wall = elapsed_ > 0.0 ? elapsed_ : 1e-6;
+
+  for (std::size_t i = 0; i < handles_.size () && i < bench_stats_.size ();
+       ++i)
+  {
+    component_stats &stats = bench_stats_[i];
+
+    // With the scheduler's worker pool enabled, components don't have a
+    // thread of their own and their CPU time remains unknown.
+    const std::string thread = scheduler_thread_name (stats.name);
+    thread_cpu_map_t::const_iterator end_it = cpu.find (thread);
+    thread_cpu_map_t::const_iterator start_it = start_cpu_.find (thread);
+    if (end_it != cpu.end () && start_it != start_cpu_.end ())
+    {
+      stats.cpu_seconds = end_it->second - start_it->second;
+    }
+
+    OMX_U64 buffers = 0;
+    OMX_U64 tick_time = 0;
+    read_flow_stats (handles_[i], buffers, tick_time);
+    stats.busy_seconds = tick_time / 1000000.0;
+    stats.buffers_per_sec = buffers / wall;
+  }
+
+  peak_rss_kib_ = read_proc_status_kib ("VmHWM");
+}
+
+void tiz::transcode_job::tear_down ()
+{
+  // Errors are no longer relevant here; just wind the graph down as far as
+  // it will go.
+  {
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    error_ = OMX_ErrorNone;
+  }
+  if (OMX_StateExecuting == state_)
+  {
+    (void)transition (OMX_StateIdle);
+  }
+  if (OMX_StateIdle == state_)
+  {
+    (void)transition (OMX_StateLoaded);
+  }
+  if (tunnelled_)
+  {
+    (void)graph::util::tear_down_tunnels (handles_);
+    tunnelled_ = false;
+  }
+  graph::util::destroy_list (handles_);
+  handles_.clear ();
+}
+
+bool tiz::transcode_job::fail (const OMX_ERRORTYPE error,
+                               const std::string &msg)
+{
+  boost::lock_guard< boost::mutex > lock (mutex_);
+  if (OMX_ErrorNone == error_)
+  {
+    error_ = error;
+    error_msg_ = msg;
+  }
+  return false;
+}
+
+void tiz::transcode_job::on_event (OMX_HANDLETYPE hComponent,
+                                   OMX_EVENTTYPE eEvent, OMX_U32 nData1,
+                                   OMX_U32 nData2)
+{
+  boost::lock_guard< boost::mutex > lock (mutex_);
+  switch (eEvent)
+  {
+    case OMX_EventCmdComplete:
+    {
+      if (OMX_CommandStateSet == nData1)
+      {
+        ++transitions_;
+      }
+      else if (OMX_CommandPortDisable == nData1)
+      {
+        ++port_disables_;
+      }
+    }
+    break;
+    case OMX_EventBufferFlag:
+    {
+      if (!handles_.empty () && hComponent == handles_.back ()
+          && (nData2 & OMX_BUFFERFLAG_EOS))
+      {
+        eos_ = true;
+      }
+    }
+    break;
+    case OMX_EventPortSettingsChanged:
+    {
+      // The null renderer doesn't care about the sample format, so in
+      // benchmark mode there is nothing to check.
+      if (!benchmark_ && handles_.size () > 1 && hComponent == handles_[1]
+          && OMX_ErrorNone == error_)
+      {
+        check_decoder_output ();
+      }
+    }
+    break;
+    case OMX_EventError:
+    {
+      const OMX_ERRORTYPE error = static_cast< OMX_ERRORTYPE >(nData1);
+      if (graph::util::is_fatal_error (error) && OMX_ErrorNone == error_)
+      {
+        error_ = error;
+        error_msg_ = std::string ("Error reported by ") + h2n_[hComponent]
+                     + " : " + tiz_err_to_str (error);
+      }
+    }
+    break;
+    default:
+    {
+    }
+    break;
+  };
+  cond_.notify_all ();
+}
+
+OMX_ERRORTYPE tiz::transcode_job::event_handler (
+    OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_EVENTTYPE eEvent,
+    OMX_U32 nData1, OMX_U32 nData2, OMX_PTR pEventData)
+{
+  assert (pAppData);
+  static_cast< transcode_job * >(pAppData)->on_event (hComponent, eEvent,
+                                                      nData1, nData2);
+  return OMX_ErrorNone;
+}
+
+// All the ports in the graph are tunnelled, so these are never called
+OMX_ERRORTYPE tiz::transcode_job::empty_buffer_done (
+    OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_BUFFERHEADERTYPE *pBuffer)
+{
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE tiz::transcode_job::fill_buffer_done (
+    OMX_HANDLETYPE hComponent, OMX_PTR pAppData, OMX_BUFFERHEADERTYPE *pBuffer)
+{
+  return OMX_ErrorNone;
+}
+
+//
+// transcoder
+//
+tiz::transcoder::stats::stats ()
+  : files_ok (0), files_failed (0), audio_seconds (0.0), wall_seconds (0.0)
+{
+}
+
+tiz::transcoder::transcoder (const uri_lst_t &files,
+                             const std::string &output_dir,
+                             const unsigned int jobs,
+                             const OMX_U32 bitrate_kbps,
+                             const bool benchmark /* = false */,
+                             const std::string &bench_json /* = "" */,
+                             const bool overwrite /* = false */)
+  : files_ (files),
+    output_dir_ (output_dir),
+    jobs_ ((jobs > 0 && !benchmark) ? jobs : 1),
+    bitrate_kbps_ (bitrate_kbps),
+    benchmark_ (benchmark),
+    bench_json_ (bench_json),
+    overwrite_ (overwrite),
+    next_ (0),
+    outputs_ (),
+    stats_ (),
+    bench_results_ (),
+    mutex_ ()
+{
+}
+
+tiz::transcoder::stats tiz::transcoder::run ()
+{
+  const double start = now_secs ();
+  boost::thread_group workers;
+  const std::size_t nworkers = std::min< std::size_t >(jobs_, files_.size ());
+  for (std::size_t i = 0; i < nworkers; ++i)
+  {
+    workers.create_thread (boost::bind (&tiz::transcoder::worker, this));
+  }
+  workers.join_all ();
+  stats_.wall_seconds = now_secs () - start;
+  if (benchmark_ && !bench_json_.empty () && !write_bench_json ())
+  {
+    printf ("   Unable to write the benchmark results to %s\n",
+            bench_json_.c_str ());
+  }
+  return stats_;
+}
+
+void tiz::transcoder::worker ()
+{
+  for (;;)
+  {
+    std::string uri;
+    std::string output;
+    std::string error_msg;
+    {
+      boost::lock_guard< boost::mutex > lock (mutex_);
+      if (next_ >= files_.size ())
+      {
+        break;
+      }
+      uri = files_[next_++];
+      if (!benchmark_)
+      {
+        output = output_path (uri, error_msg);
+      }
+    }
+
+    bool success = false;
+    double duration = 0.0;
+    transcode_job job (uri, output, bitrate_kbps_, benchmark_);
+    if (benchmark_ || !output.empty ())
+    {
+      success = job.run (duration);
+      error_msg = job.error_msg ();
+    }
+
+    boost::lock_guard< boost::mutex > lock (mutex_);
+    if (benchmark_)
+    {
+      bench_result result;
+      result.uri = uri;
+      result.ok = success;
+      result.audio_seconds = duration;
+      result.elapsed = job.elapsed ();
+      result.startup = job.startup ();
+      result.peak_rss_kib = job.peak_rss_kib ();
+      result.components = job.bench_stats ();
+      bench_results_.push_back (result);
+    }
+    if (success)
+    {
+      ++stats_.files_ok;
+      stats_.audio_seconds += duration;
+      if (benchmark_)
+      {
+        printf ("   [ok] %s\n", uri.c_str ());
+        print_bench_report (job, duration);
+      }
+      else
+      {
+        printf ("   [ok] %s -> %s\n", uri.c_str (), output.c_str ());
+      }
+    }
+    else
+    {
+      ++stats_.files_failed;
+      printf ("   [failed] %s : %s\n", uri.c_str (), error_msg.c_str ());
+    }
+    fflush (stdout);
+  }
+}
+
+// NOTE: This must be called with mutex_ held
+void tiz::transcoder::print_bench_report (const transcode_job &job,
+                                          const double duration)
+{
+  const double elapsed = job.elapsed () > 0.0 ? job.elapsed () : 1e-6;
+  printf ("        %.1f s of audio decoded in %.3f s, realtime factor %.1fx",
+          duration, job.elapsed (), duration / elapsed);
+  printf (", startup %.1f ms", job.startup () * 1000.0);
+  if (job.peak_rss_kib () >= 0)
+  {
+    printf (", peak RSS %ld KiB", job.peak_rss_kib ());
+  }
+  printf ("\n");
+  printf ("        %-42s %8s %9s %10s %10s\n", "component", "cpu (s)",
+          "busy (s)", "buffers/s", "load (KiB)");
+  BOOST_FOREACH (const component_stats &stats, job.bench_stats ())
+  {
+    char cpu[16];
+    if (stats.cpu_seconds >= 0.0)
+    {
+      snprintf (cpu, sizeof (cpu), "%.3f", stats.cpu_seconds);
+    }
+    else
+    {
+      snprintf (cpu, sizeof (cpu), "-");
+    }
+    printf ("        %-42s %8s %9.3f %10.1f %10ld\n", stats.name.c_str (), cpu,
+            stats.busy_seconds, stats.buffers_per_sec, stats.rss_kib);
+  }
+}
+
+// NOTE: This must be called once the workers are done
+bool tiz::transcoder::write_bench_json () const
+{
+  FILE *p_out = fopen (bench_json_.c_str (), "w");
+  if (!p_out)
+  {
+    return false;
+  }
+
+  fprintf (p_out,
+           "{\n  \"suite\": \"tizonia-transcode\",\n  \"cpus\": %ld,\n"
+           "  \"files_ok\": %u,\n  \"files_failed\": %u,\n"
+           "  \"audio_seconds\": %.3f,\n  \"wall_seconds\": %.3f,\n"
+           "  \"results\": [",
+           sysconf (_SC_NPROCESSORS_ONLN), stats_.files_ok,
+           stats_.files_failed, stats_.audio_seconds, stats_.wall_seconds);
+  for (std::size_t i = 0; i < bench_results_.size (); ++i)
+  {
+    const bench_result &result = bench_results_[i];
+    const double elapsed = result.elapsed > 0.0 ? result.elapsed : 1e-6;
+    fprintf (p_out,
+             "%s\n    {\"uri\": %s, \"ok\": %s, \"audio_seconds\": %.3f, "
+             "\"secs\": %.6f, \"realtime_factor\": %.1f, "
+             "\"startup_ms\": %.1f, \"peak_rss_kib\": %ld,\n"
+             "     \"components\": [",
+             i > 0 ? "," : "", json_string (result.uri).c_str (),
+             result.ok ? "true" : "false", result.audio_seconds,
+             result.elapsed, result.ok ? result.audio_seconds / elapsed : 0.0,
+             result.startup * 1000.0, result.peak_rss_kib);
+    for (std::size_t j = 0; j < result.components.size (); ++j)
+    {
+      const component_stats &stats = result.components[j];
+      char cpu[32];
+      if (stats.cpu_seconds >= 0.0)
+      {
+        snprintf (cpu, sizeof (cpu), "%.6f", stats.cpu_seconds);
+      }
+      else
+      {
+        snprintf (cpu, sizeof (cpu), "null");
+      }
+      fprintf (p_out,
+               "%s\n       {\"name\": %s, \"cpu_seconds\": %s, "
+               "\"busy_seconds\": %.6f, \"buffers_per_sec\": %.1f, "
+               "\"load_kib\": %ld}",
+               j > 0 ? "," : "", json_string (stats.name).c_str (), cpu,
+               stats.busy_seconds, stats.buffers_per_sec, stats.rss_kib);
+    }
+    fprintf (p_out, "]}");
+  }
+  fprintf (p_out, "\n  ]\n}\n");
+  return 0 == fclose (p_out);
+}
+
+// NOTE: This must be called with mutex_ held. Returns an empty string if the
+// file must not be written.
+std::string tiz::transcoder::output_path (const std::string &uri,
+                                          std::string &error_msg)
+{
+  namespace bf = boost::filesystem;
+  const std::string stem (bf::path (uri).stem ().string ());
+  bf::path output (bf::path (output_dir_) / (stem + ".mp3"));
+
+  // Files with the same name from different directories must not clobber
+  // each other.
+  for (int suffix = 1; outputs_.count (output.string ()) > 0; ++suffix)
+  {
+    output = bf::path (output_dir_)
+             / (stem + "-" + boost::lexical_cast< std::string >(suffix)
+                + ".mp3");
+  }
+
+  boost::system::error_code ec;
+  if (bf::equivalent (bf::path (uri), output, ec))
+  {
+    error_msg = "Output file would overwrite the input file";
+    return std::string ();
+  }
+
+  if (!overwrite_ && bf::exists (output, ec))
+  {
+    error_msg = "Output file " + output.string ()
+                + " already exists (use --transcode-force to overwrite it)";
+    return std::string ();
+  }
+
+  outputs_.insert (output.string ());
+  return output.string ();
+}
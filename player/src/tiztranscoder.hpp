@@ -0,0 +1,242 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tiztranscoder.hpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Offline decoding and transcoding of local media files
+ *
+ *
+ */
+
+#ifndef TIZTRANSCODER_HPP
+#define TIZTRANSCODER_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include <OMX_Audio.h>
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#include "tizgraphtypes.hpp"
+
+namespace tiz
+{
+  /**
+   * What a benchmark run measured for one of the components of a graph.
+   */
+  struct component_stats
+  {
+    component_stats ();
+
+    std::string name;
+    double cpu_seconds;      // CPU time of its scheduler thread (< 0: unknown)
+    double busy_seconds;     // Time spent running its servants
+    double buffers_per_sec;  // Buffers handed over to its peers
+    long rss_kib;            // RSS growth caused by loading the component
+  };
+
+  typedef std::vector< component_stats > component_stats_lst_t;
+
+  /**
+   * A single file_reader -> decoder [-> mp3 encoder] -> file_writer graph,
+   * driven synchronously from the calling thread. Without an encoder (i.e.
+   * when the bitrate is 0), the output file receives the decoder's raw
+   * 16-bit interleaved PCM samples.
+   *
+   * In benchmark mode, the graph is source -> decoder -> null pcm renderer
+   * instead, any decoder output format is accepted, and the job measures the
+   * cost of each component while it runs.
+   */
+  class transcode_job
+  {
+  public:
+    transcode_job (const std::string &uri, const std::string &output,
+                   const OMX_U32 bitrate_kbps, const bool benchmark = false);
+    ~transcode_job ();
+
+    /**
+     * Run the graph until the whole file has been written. Blocks until
+     * done, failed or cancelled.
+     *
+     * @param duration The duration of the decoded audio, in seconds.
+     */
+    bool run (double &duration);
+
+    /**
+     * Make a running job fail as soon as possible. May be called from any
+     * thread.
+     */
+    void cancel ();
+
+    /**
+     * The format of the samples produced by the decoder (only valid once
+     * the job has started).
+     */
+    const OMX_AUDIO_PARAM_PCMMODETYPE &pcm_info () const;
+
+    const std::string &error_msg () const;
+
+    /**
+     * Benchmark mode only: the per-component measurements, the time the
+     * graph took to go from Loaded to Executing, the time from the start of
+     * execution to the end of stream, both in seconds, and the peak RSS of
+     * the process while the graph existed, in KiB (< 0 if unknown).
+     */
+    const component_stats_lst_t &bench_stats () const;
+    double startup () const;
+    double elapsed () const;
+    long peak_rss_kib () const;
+
+  private:
+    bool select_components (omx_comp_name_lst_t &comp_list,
+                            omx_comp_role_lst_t &role_list);
+    OMX_ERRORTYPE instantiate (const omx_comp_name_lst_t &comp_list);
+    OMX_ERRORTYPE configure ();
+    OMX_ERRORTYPE configure_decoder ();
+    void get_sink_pcm_info (OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype);
+    double decoded_seconds () const;
+    void check_decoder_output ();
+    bool disable_port (const OMX_HANDLETYPE handle, const OMX_U32 pid);
+    bool wait_for_completion (std::size_t &counter, const std::size_t count);
+    bool transition (const OMX_STATETYPE to);
+    void collect_bench_stats ();
+    void tear_down ();
+    bool fail (const OMX_ERRORTYPE error, const std::string &msg);
+    void on_event (OMX_HANDLETYPE hComponent, OMX_EVENTTYPE eEvent,
+                   OMX_U32 nData1, OMX_U32 nData2);
+
+    static OMX_ERRORTYPE event_handler (OMX_HANDLETYPE hComponent,
+                                        OMX_PTR pAppData, OMX_EVENTTYPE eEvent,
+                                        OMX_U32 nData1, OMX_U32 nData2,
+                                        OMX_PTR pEventData);
+    static OMX_ERRORTYPE empty_buffer_done (OMX_HANDLETYPE hComponent,
+                                            OMX_PTR pAppData,
+                                            OMX_BUFFERHEADERTYPE *pBuffer);
+    static OMX_ERRORTYPE fill_buffer_done (OMX_HANDLETYPE hComponent,
+                                           OMX_PTR pAppData,
+                                           OMX_BUFFERHEADERTYPE *pBuffer);
+
+  private:
+    const std::string uri_;
+    const std::string output_;
+    const OMX_U32 bitrate_kbps_;
+    const bool benchmark_;
+    tizprobe_ptr_t probe_;
+    OMX_AUDIO_PARAM_PCMMODETYPE pcmtype_;
+    OMX_CALLBACKTYPE callbacks_;
+    omx_comp_handle_lst_t handles_;
+    omx_hdl2name_map_t h2n_;
+    bool tunnelled_;
+    OMX_STATETYPE state_;
+    std::size_t transitions_;
+    std::size_t port_disables_;
+    bool eos_;
+    OMX_ERRORTYPE error_;
+    std::string error_msg_;
+    component_stats_lst_t bench_stats_;
+    std::map< std::string, double > start_cpu_;
+    double start_time_;
+    double startup_;
+    double elapsed_;
+    long peak_rss_kib_;
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+  };
+
+  /**
+   * Converts a list of local media files to MP3, as fast as the machine
+   * allows. Each file is processed by its own
+   * reader -> decoder -> mp3 encoder -> file writer graph, with no renderer
+   * (and therefore no clock) in the pipeline. Several graphs run
+   * concurrently, one per worker thread.
+   *
+   * In benchmark mode, nothing is written: each file is decoded into a null
+   * pcm renderer, and a breakdown of the cost of every component in the
+   * graph is printed, and optionally saved as JSON. The CPU time and memory
+   * figures are sampled process-wide, so benchmarks always run one graph at
+   * a time, whatever the number of jobs requested.
+   */
+  class transcoder
+  {
+  public:
+    struct stats
+    {
+      stats ();
+
+      unsigned int files_ok;
+      unsigned int files_failed;
+      double audio_seconds;  // Duration of the media successfully transcoded
+      double wall_seconds;
+    };
+
+  public:
+    transcoder (const uri_lst_t &files, const std::string &output_dir,
+                const unsigned int jobs, const OMX_U32 bitrate_kbps,
+                const bool benchmark = false,
+                const std::string &bench_json = std::string (),
+                const bool overwrite = false);
+
+    /**
+     * Transcode all the files. Blocks until done.
+     */
+    stats run ();
+
+  private:
+    // What a benchmark run measured for one file
+    struct bench_result
+    {
+      std::string uri;
+      bool ok;
+      double audio_seconds;
+      double elapsed;
+      double startup;
+      long peak_rss_kib;
+      component_stats_lst_t components;
+    };
+
+  private:
+    void worker ();
+    void print_bench_report (const transcode_job &job, const double duration);
+    bool write_bench_json () const;
+    std::string output_path (const std::string &uri, std::string &error_msg);
+
+  private:
+    const uri_lst_t files_;
+    const std::string output_dir_;
+    const unsigned int jobs_;
+    const OMX_U32 bitrate_kbps_;
+    const bool benchmark_;
+    const std::string bench_json_;
+    const bool overwrite_;
+    std::size_t next_;
+    std::set< std::string > outputs_;
+    stats stats_;
+    std::vector< bench_result > bench_results_;
+    boost::mutex mutex_;
+  };
+}  // namespace tiz
+
+#endif  // TIZTRANSCODER_HPP
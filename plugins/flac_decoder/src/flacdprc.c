@@ -37,6 +37,7 @@
 #include <tizplatform.h>
 
 #include <tizkernel.h>
+#include <tizpcmpack.h>
 
 #include "flacd.h"
 #include "flacdprc.h"
@@ -422,61 +423,21 @@ read_cb (const FLAC__StreamDecoder * ap_decoder, FLAC__byte buffer[],
   return rc;
 }
 
-static void
-write_pcm_block_8 (uint8_t * ap_to, const FLAC__int32 * const ap_buffer[],
-                   const unsigned int a_nsamples,
-                   const unsigned int a_nchannels)
-{
-  size_t i = 0;
-  size_t j = 0;
-  for (i = 0; i < a_nsamples; i += 2, ++j)
-    {
-      FLAC__int8 * out = (FLAC__int8 *) (ap_to) + i;
-      int k;
-      for (k = 0; k < a_nchannels; ++k)
-        {
-          out[k] = (FLAC__int8) ap_buffer[k][j];
-        }
-    }
-}
-
-static void
-write_pcm_block_16 (uint8_t * ap_to, const FLAC__int32 * const ap_buffer[],
-                    const unsigned int a_nsamples,
-                    const unsigned int a_nchannels)
-{
-  size_t i = 0;
-  size_t j = 0;
-  for (i = 0; i < a_nsamples; i += 2, ++j)
-    {
-      FLAC__int16 * out = (FLAC__int16 *) (ap_to) + i;
-      int k;
-      for (k = 0; k < a_nchannels; ++k)
-        {
-          out[k] = (FLAC__int16) ap_buffer[k][j];
-        }
-    }
-}
-
-static void
-write_pcm_block_24 (uint8_t * ap_to, const FLAC__int32 * const ap_buffer[],
-                    const unsigned int a_nsamples,
-                    const unsigned int a_nchannels)
+/* NOTE: write_cb rejects any other depth, so samples are never requantized
+   and there is nothing to dither */
+static tiz_pcm_fmt_t
+pcm_fmt_from_bps (const unsigned int a_bps)
 {
-  size_t i = 0;
-  size_t j = 0;
-  for (i = 0; i < a_nsamples; i += 2, ++j)
+  switch (a_bps)
     {
-      unsigned char * out = (unsigned char *) (ap_to) + (i * 3);
-      int k;
-      for (k = 0; k < a_nchannels; ++k)
-        {
-          unsigned long word32 = (unsigned long) ap_buffer[k][j];
-          *out++ = (unsigned char) (word32 >> 0);
-          *out++ = (unsigned char) (word32 >> 8);
-          *out++ = (unsigned char) (word32 >> 16);
-        }
-    }
+      case 8:
+        return TIZ_PCM_FMT_S8;
+      case 24:
+        return TIZ_PCM_FMT_S24_LE;
+      case 16:
+      default:
+        return TIZ_PCM_FMT_S16_LE;
+    };
 }
 
 static FLAC__StreamDecoderWriteStatus
@@ -522,33 +483,14 @@ write_cb (const FLAC__StreamDecoder * ap_decoder, const FLAC__Frame * ap_frame,
 
       {
         uint8_t * p_to = p_out->pBuffer + p_out->nOffset;
-
-        switch (ap_frame->header.bits_per_sample)
-          {
-            case 8:
-              {
-                write_pcm_block_8 (p_to, ap_buffer, nsamples,
-                                   ap_frame->header.channels);
-              }
-              break;
-            case 16:
-              {
-                write_pcm_block_16 (p_to, ap_buffer, nsamples,
-                                    ap_frame->header.channels);
-              }
-              break;
-            case 24:
-              {
-                write_pcm_block_24 (p_to, ap_buffer, nsamples,
-                                    ap_frame->header.channels);
-              }
-              break;
-            default:
-              {
-                assert (0);
-              }
-              break;
-          };
+        const unsigned int nchannels = ap_frame->header.channels;
+
+        /* Only whole frames are written out */
+        nsamples -= nsamples % nchannels;
+        tiz_pcm_pack_s32 (p_to, ap_buffer, nsamples / nchannels, nchannels,
+                          ap_frame->header.bits_per_sample,
+                          pcm_fmt_from_bps (ap_frame->header.bits_per_sample),
+                          NULL);
 
         p_out->nFilledLen = nsamples * (p_prc->bps_ / 8);
         if ((p_prc->eos_ && p_prc->store_offset_ == 0))
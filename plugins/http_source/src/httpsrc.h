@@ -64,6 +64,14 @@ extern "C" {
 #define ARATELIA_HTTP_SOURCE_DEFAULT_BUFFER_SECONDS_YOUTUBE 60
 #define ARATELIA_HTTP_SOURCE_DEFAULT_BUFFER_SECONDS_PLEX 60
 #define ARATELIA_HTTP_SOURCE_DEFAULT_BUFFER_SECONDS_IHEART 120
+#define ARATELIA_HTTP_SOURCE_DEFAULT_MAX_SEGMENTS 4
+#define ARATELIA_HTTP_SOURCE_DEFAULT_SEGMENT_BYTES (512 * 1024)
+#define ARATELIA_HTTP_SOURCE_SEGMENTED_DOWNLOAD_KEY \
+  ARATELIA_HTTP_SOURCE_COMPONENT_NAME ".segmented_download"
+#define ARATELIA_HTTP_SOURCE_STREAM_CACHE_DIR_KEY \
+  ARATELIA_HTTP_SOURCE_COMPONENT_NAME ".stream_cache_dir"
+#define ARATELIA_HTTP_SOURCE_STREAM_CACHE_SIZE_KEY \
+  ARATELIA_HTTP_SOURCE_COMPONENT_NAME ".stream_cache_size"
 
 #ifdef __cplusplus
 }
@@ -409,8 +409,9 @@ store_metadata (httpsrc_prc_t * ap_prc, const char * ap_header_name,
   info_len = strnlen (ap_header_info, OMX_MAX_STRINGNAME_SIZE - 1) + 1;
   metadata_len = sizeof (OMX_CONFIG_METADATAITEMTYPE) + info_len;
 
-  if (!(p_meta
-        = (OMX_CONFIG_METADATAITEMTYPE *) tiz_mem_calloc (1, metadata_len)))
+  /* The item is owned by the processor's arena, and is released with it */
+  if (!(p_meta = (OMX_CONFIG_METADATAITEMTYPE *) tiz_srv_arena_calloc (
+          ap_prc, metadata_len)))
     {
       rc = OMX_ErrorInsufficientResources;
     }
@@ -473,7 +474,13 @@ obtain_audio_encoding_from_headers (httpsrc_prc_t * ap_prc,
           }
 
         {
+          /* Scratch copy; this runs once per header line and per connection
+             attempt, so keep it off the arena */
           char * p_info = tiz_mem_calloc (1, (p_end - p_value) + 1);
+          if (!p_info)
+            {
+              return;
+            }
           memcpy (p_info, p_value, p_end - p_value);
           p_info[(p_end - p_value)] = '\0';
           TIZ_TRACE (handleOf (ap_prc), "header name  : [%s]", name);
@@ -659,6 +666,15 @@ header_available (OMX_PTR ap_arg, const void * ap_ptr, const size_t a_nbytes)
 
   TIZ_PRINTF_DBG_CYN("[%s]\n", ap_ptr);
 
+  if (a_nbytes > 5 && 0 == strncmp (ap_ptr, "HTTP/", 5))
+    {
+      /* A status line starts a new response (e.g. after a reconnection);
+         the previous response's header metadata live in the arena, so drop
+         them before storing this response's */
+      tiz_krn_clear_metadata (tiz_get_krn (handleOf (p_prc)));
+      tiz_srv_arena_reset (p_prc);
+    }
+
   if (p_prc->auto_detect_on_)
     {
       obtain_audio_encoding_from_headers (p_prc, ap_ptr, a_nbytes);
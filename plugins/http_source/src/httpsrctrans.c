@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   httpsrctrans.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  HTTP streaming client - URL transfer settings
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+
+#include "httpsrc.h"
+#include "httpsrctrans.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.http_source.trans"
+#endif
+
+static bool
+is_enabled (const char * ap_key)
+{
+  const char * p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  return (p_value && 0 == strncmp (p_value, "true", OMX_MAX_STRINGNAME_SIZE));
+}
+
+void
+httpsrc_trans_configure (OMX_HANDLETYPE ap_hdl, tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+
+  /* Parallel range requests (off by default) */
+  if (is_enabled (ARATELIA_HTTP_SOURCE_SEGMENTED_DOWNLOAD_KEY))
+    {
+      tiz_urltrans_set_segmented_download (
+        ap_trans, ARATELIA_HTTP_SOURCE_DEFAULT_MAX_SEGMENTS,
+        ARATELIA_HTTP_SOURCE_DEFAULT_SEGMENT_BYTES);
+      TIZ_DEBUG (ap_hdl, "segmented download [%d x %d bytes]",
+                 ARATELIA_HTTP_SOURCE_DEFAULT_MAX_SEGMENTS,
+                 ARATELIA_HTTP_SOURCE_DEFAULT_SEGMENT_BYTES);
+    }
+
+  /* Keep the tracks on disk, so that playing them again does not need the
+     network (size in MiB; 0 or unset disables the cache) */
+  {
+    const char * p_size = tiz_rcfile_get_value (
+      TIZ_RCFILE_PLUGINS_DATA_SECTION, ARATELIA_HTTP_SOURCE_STREAM_CACHE_SIZE_KEY);
+    const long size_mib = p_size ? atol (p_size) : 0;
+    if (size_mib > 0)
+      {
+        tiz_urltrans_set_cache (
+          ap_trans,
+          tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                                ARATELIA_HTTP_SOURCE_STREAM_CACHE_DIR_KEY),
+          (OMX_U64) size_mib * 1024 * 1024);
+        TIZ_DEBUG (ap_hdl, "stream cache [%ld MiB]", size_mib);
+      }
+  }
+}
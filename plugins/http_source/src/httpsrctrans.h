@@ -0,0 +1,54 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   httpsrctrans.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  HTTP streaming client - URL transfer settings
+ *
+ *
+ */
+
+#ifndef HTTPSRCTRANS_H
+#define HTTPSRCTRANS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#include <tizplatform.h>
+
+/**
+ * Apply the settings found in the plugins-data section of tizonia.conf
+ * (segmented download and on-disk cache) to the transfer of an on-demand
+ * service, i.e. a service that serves whole files, which may be requested in
+ * ranges.
+ */
+void
+httpsrc_trans_configure (OMX_HANDLETYPE ap_hdl, tiz_urltrans_t * ap_trans);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPSRCTRANS_H */
@@ -44,6 +44,7 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "plexprc.h"
 #include "plexprc_decls.h"
 
@@ -814,6 +815,10 @@ plex_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
                            p_prc->buffer_bytes_,
                            ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT,
                            buffer_cbacks, info_cbacks, io_cbacks, timer_cbacks);
+    if (OMX_ErrorNone == rc)
+      {
+        httpsrc_trans_configure (handleOf (p_prc), p_prc->p_trans_);
+      }
   }
   return rc;
 }
@@ -43,6 +43,7 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "scloudprc.h"
 #include "scloudprc_decls.h"
 
@@ -749,6 +750,10 @@ scloud_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
                            p_prc->buffer_bytes_,
                            ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT,
                            buffer_cbacks, info_cbacks, io_cbacks, timer_cbacks);
+    if (OMX_ErrorNone == rc)
+      {
+        httpsrc_trans_configure (handleOf (p_prc), p_prc->p_trans_);
+      }
   }
   return rc;
 }
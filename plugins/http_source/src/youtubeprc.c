@@ -44,6 +44,7 @@
 #include <tizscheduler.h>
 
 #include "httpsrc.h"
+#include "httpsrctrans.h"
 #include "youtubeprc.h"
 #include "youtubeprc_decls.h"
 
@@ -419,6 +420,30 @@ update_metadata (youtube_prc_t * ap_prc)
   return OMX_ErrorNone;
 }
 
+/* Stream urls expire, so tracks are kept in the on-disk cache under their
+   video id and format */
+static void
+update_cache_key (youtube_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_trans_)
+    {
+      const char * p_id
+        = tiz_youtube_get_current_audio_stream_video_id (ap_prc->p_youtube_);
+      const char * p_itag
+        = tiz_youtube_get_current_audio_stream_itag (ap_prc->p_youtube_);
+      char key[OMX_MAX_STRINGNAME_SIZE];
+      if (p_id && *p_id)
+        {
+          /* The same video may be served in other formats */
+          snprintf (key, sizeof (key), "youtube:%s:%s", p_id,
+                    p_itag ? p_itag : "");
+        }
+      tiz_urltrans_set_cache_key (ap_prc->p_trans_,
+                                  (p_id && *p_id) ? key : NULL);
+    }
+}
+
 static OMX_ERRORTYPE
 obtain_next_url (youtube_prc_t * ap_prc, int a_skip_value,
                  const int a_position_value)
@@ -482,6 +507,7 @@ obtain_next_url (youtube_prc_t * ap_prc, int a_skip_value,
 
           /* Song metadata is now available, update the IL client */
           rc = update_metadata (ap_prc);
+          update_cache_key (ap_prc);
         }
     }
   }
@@ -841,6 +867,11 @@ youtube_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
       ARATELIA_HTTP_SOURCE_COMPONENT_NAME, p_prc->buffer_bytes_,
       ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT, buffer_cbacks,
       info_cbacks, io_cbacks, timer_cbacks);
+    if (OMX_ErrorNone == rc)
+      {
+        httpsrc_trans_configure (handleOf (p_prc), p_prc->p_trans_);
+        update_cache_key (p_prc);
+      }
   }
   return rc;
 }
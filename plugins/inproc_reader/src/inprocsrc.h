@@ -21,7 +21,7 @@
  * @file   inprocsrc.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader constants
+ * @brief  Tizonia - Shared memory ring reader constants
  *
  *
  */
@@ -47,6 +47,9 @@ extern "C"
 #define ARATELIA_INPROC_READER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_INPROC_READER_PORT_ALIGNMENT     0
 #define ARATELIA_INPROC_READER_PORT_SUPPLIERPREF  OMX_BufferSupplyInput
+#define ARATELIA_INPROC_READER_DEFAULT_RING_NAME  "broadcast"
+#define ARATELIA_INPROC_READER_RETRY_SECONDS      0.1
+#define ARATELIA_INPROC_READER_WAIT_MS            250
 
 #ifdef __cplusplus
 }
@@ -21,7 +21,7 @@
  * @file   inprocsrcprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader
+ * @brief  Tizonia - Shared memory ring reader processor
  *
  *
  */
@@ -31,6 +31,9 @@
 #endif
 
 #include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
 
 #include <tizplatform.h>
 
@@ -46,6 +49,404 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.inproc_reader.prc"
 #endif
 
+#define INPROC_URI_SCHEME "inproc://"
+
+static OMX_ERRORTYPE
+connect_ring (inprocsrc_prc_t * ap_prc);
+static void
+disconnect_ring (inprocsrc_prc_t * ap_prc);
+
+static OMX_BUFFERHEADERTYPE *
+get_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (!ap_prc->port_disabled_ && !ap_prc->p_outhdr_)
+    {
+      (void) tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                   ARATELIA_INPROC_READER_PORT_INDEX, 0,
+                                   &ap_prc->p_outhdr_);
+      if (ap_prc->p_outhdr_)
+        {
+          TIZ_TRACE (handleOf (ap_prc), "Claimed HEADER [%p]...",
+                     ap_prc->p_outhdr_);
+        }
+    }
+  return ap_prc->port_disabled_ ? NULL : ap_prc->p_outhdr_;
+}
+
+static OMX_ERRORTYPE
+release_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->p_outhdr_)
+    {
+      TIZ_TRACE (handleOf (ap_prc), "Releasing HEADER [%p] nFilledLen [%u]",
+                 ap_prc->p_outhdr_, ap_prc->p_outhdr_->nFilledLen);
+      tiz_check_omx (tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                             ARATELIA_INPROC_READER_PORT_INDEX,
+                                             ap_prc->p_outhdr_));
+      ap_prc->p_outhdr_ = NULL;
+    }
+  return OMX_ErrorNone;
+}
+
+static bool
+ready_to_process (const inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return (!ap_prc->paused_ && !ap_prc->port_disabled_ && !ap_prc->stopped_
+          && ap_prc->p_ring_);
+}
+
+/* Let the waiter thread go back to waiting on the ring */
+static void
+unpark_waiter (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->waiter_parked_)
+    {
+      ap_prc->waiter_parked_ = false;
+      tiz_sem_post (&(ap_prc->waiter_sem_));
+    }
+}
+
+/* Copies records to output buffers. A record that fits goes in a buffer of
+   its own, with its flags; a larger one continues in the next buffer. */
+static OMX_ERRORTYPE
+read_from_ring (inprocsrc_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  assert (ap_prc);
+
+  while (ready_to_process (ap_prc) && (p_hdr = get_header (ap_prc)))
+    {
+      OMX_U8 * p_dst = p_hdr->pBuffer + p_hdr->nOffset + p_hdr->nFilledLen;
+      const size_t room
+        = p_hdr->nAllocLen - p_hdr->nOffset - p_hdr->nFilledLen;
+      size_t nbytes = 0;
+      OMX_U32 flags = 0;
+      OMX_BOOL end = OMX_FALSE;
+      OMX_ERRORTYPE rc = tiz_shmring_read (ap_prc->p_ring_, ap_prc->reader_,
+                                           p_dst, room, &nbytes, &flags, &end,
+                                           0);
+      if (OMX_ErrorNotReady == rc)
+        {
+          /* Drained */
+          unpark_waiter (ap_prc);
+          break;
+        }
+      else if (OMX_ErrorNoMore == rc)
+        {
+          /* The writer has gone away: finish the stream, and wait for the
+             ring to come back */
+          TIZ_NOTICE (handleOf (ap_prc), "[%s] ring closed by the writer",
+                      ap_prc->ring_name_);
+          if (!ap_prc->eos_)
+            {
+              p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+              ap_prc->eos_ = true;
+            }
+          tiz_check_omx (release_header (ap_prc));
+          disconnect_ring (ap_prc);
+          return connect_ring (ap_prc);
+        }
+      else if (OMX_ErrorOverflow == rc)
+        {
+          /* The writer overtook this reader in the middle of a record: drop
+             what this buffer holds of it (earlier parts are gone already) */
+          TIZ_NOTICE (handleOf (ap_prc), "[%s] overrun; dropped [%u] bytes",
+                      ap_prc->ring_name_, (unsigned) p_hdr->nFilledLen);
+          p_hdr->nFilledLen = 0;
+          continue;
+        }
+      else if (OMX_ErrorNone != rc)
+        {
+          TIZ_ERROR (handleOf (ap_prc), "[%s] : while reading from [%s]",
+                     tiz_err_to_str (rc), ap_prc->ring_name_);
+          return rc;
+        }
+
+      p_hdr->nFilledLen += nbytes;
+      if (end)
+        {
+          p_hdr->nFlags |= flags;
+          ap_prc->eos_ = ((flags & OMX_BUFFERFLAG_EOS) != 0);
+          tiz_check_omx (release_header (ap_prc));
+        }
+      else if (nbytes == room)
+        {
+          tiz_check_omx (release_header (ap_prc));
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
+static void
+ring_ready_handler (OMX_PTR ap_prc, tiz_event_pluggable_t * ap_event)
+{
+  inprocsrc_prc_t * p_prc = ap_prc;
+  assert (p_prc);
+  assert (ap_event);
+
+  /* Ignore events from a waiter thread that has been stopped since */
+  if (p_prc->waiter_running_
+      && (uintptr_t) ap_event->p_data == p_prc->waiter_gen_)
+    {
+      p_prc->waiter_parked_ = true;
+      (void) read_from_ring (p_prc);
+    }
+  tiz_mem_free (ap_event);
+}
+
+static bool
+post_ring_event (inprocsrc_prc_t * ap_prc)
+{
+  tiz_event_pluggable_t * p_event = NULL;
+  assert (ap_prc);
+
+  p_event = tiz_mem_calloc (1, sizeof (tiz_event_pluggable_t));
+  if (p_event)
+    {
+      p_event->p_servant = ap_prc;
+      p_event->pf_hdlr = ring_ready_handler;
+      p_event->p_data = (void *) ap_prc->waiter_gen_;
+      tiz_comp_event_pluggable (handleOf (ap_prc), p_event);
+    }
+  return p_event != NULL;
+}
+
+static void *
+waiter_thread_func (void * ap_arg)
+{
+  inprocsrc_prc_t * p_prc = ap_arg;
+  assert (p_prc);
+
+  (void) tiz_thread_setname (&(p_prc->waiter_), (char *) "tizinprocsrc");
+
+  while (!__atomic_load_n (&(p_prc->waiter_stop_), __ATOMIC_SEQ_CST))
+    {
+      /* The timeout only bounds the time it takes to notice a stop request
+         that raced with tiz_shmring_wake */
+      const OMX_ERRORTYPE rc = tiz_shmring_wait (
+        p_prc->p_ring_, p_prc->reader_, ARATELIA_INPROC_READER_WAIT_MS);
+      if (OMX_ErrorNotReady == rc
+          || __atomic_load_n (&(p_prc->waiter_stop_), __ATOMIC_SEQ_CST))
+        {
+          continue;
+        }
+
+      /* There is data (or the ring has been closed). Stay parked until the
+         component thread has drained the ring. */
+      if (post_ring_event (p_prc))
+        {
+          (void) tiz_sem_wait (&(p_prc->waiter_sem_));
+        }
+      else
+        {
+          (void) tiz_sem_timedwait (&(p_prc->waiter_sem_),
+                                    ARATELIA_INPROC_READER_WAIT_MS);
+        }
+    }
+
+  return NULL;
+}
+
+static OMX_ERRORTYPE
+start_waiter (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (!ap_prc->waiter_running_);
+
+  tiz_check_omx (tiz_sem_init (&(ap_prc->waiter_sem_), 0));
+  ap_prc->waiter_stop_ = false;
+  ap_prc->waiter_parked_ = false;
+  if (OMX_ErrorNone
+      != tiz_thread_create (&(ap_prc->waiter_), 0, 0, waiter_thread_func,
+                            ap_prc))
+    {
+      tiz_sem_destroy (&(ap_prc->waiter_sem_));
+      return OMX_ErrorInsufficientResources;
+    }
+  ap_prc->waiter_running_ = true;
+  return OMX_ErrorNone;
+}
+
+static void
+stop_waiter (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->waiter_running_)
+    {
+      OMX_PTR p_result = NULL;
+      __atomic_store_n (&(ap_prc->waiter_stop_), true, __ATOMIC_SEQ_CST);
+      tiz_shmring_wake (ap_prc->p_ring_);
+      tiz_sem_post (&(ap_prc->waiter_sem_));
+      tiz_thread_join (&(ap_prc->waiter_), &p_result);
+      tiz_sem_destroy (&(ap_prc->waiter_sem_));
+      ap_prc->waiter_running_ = false;
+      ap_prc->waiter_parked_ = false;
+      /* Events still queued by this thread are now stale */
+      ap_prc->waiter_gen_++;
+    }
+}
+
+static void
+stop_retry_timer (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->awaiting_ring_)
+    {
+      (void) tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_ev_timer_);
+      ap_prc->awaiting_ring_ = false;
+    }
+}
+
+static OMX_ERRORTYPE
+connect_ring (inprocsrc_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+
+  if (ap_prc->p_ring_)
+    {
+      return OMX_ErrorNone;
+    }
+
+  rc = tiz_shmring_open (&(ap_prc->p_ring_), ap_prc->ring_name_);
+  if (OMX_ErrorNotReady == rc)
+    {
+      /* No writer yet; try again later */
+      if (!ap_prc->awaiting_ring_)
+        {
+          TIZ_NOTICE (handleOf (ap_prc), "Waiting for ring [%s]",
+                      ap_prc->ring_name_);
+          tiz_check_omx (tiz_srv_timer_watcher_start (
+            ap_prc, ap_prc->p_ev_timer_, ARATELIA_INPROC_READER_RETRY_SECONDS,
+            ARATELIA_INPROC_READER_RETRY_SECONDS));
+          ap_prc->awaiting_ring_ = true;
+        }
+      return OMX_ErrorNone;
+    }
+  else if (OMX_ErrorNone != rc)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "[%s] : Unable to open the ring [%s]",
+                 tiz_err_to_str (rc), ap_prc->ring_name_);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  stop_retry_timer (ap_prc);
+
+  rc = tiz_shmring_attach (ap_prc->p_ring_, ap_prc->policy_,
+                           &(ap_prc->reader_));
+  if (OMX_ErrorNone == rc)
+    {
+      rc = start_waiter (ap_prc);
+      if (OMX_ErrorNone != rc)
+        {
+          tiz_shmring_detach (ap_prc->p_ring_, ap_prc->reader_);
+        }
+    }
+
+  if (OMX_ErrorNone != rc)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "[%s] : Unable to read from ring [%s]",
+                 tiz_err_to_str (rc), ap_prc->ring_name_);
+      tiz_shmring_destroy (ap_prc->p_ring_);
+      ap_prc->p_ring_ = NULL;
+      ap_prc->reader_ = -1;
+      return rc;
+    }
+
+  TIZ_NOTICE (handleOf (ap_prc), "ring [%s] reader [%d] policy [%s]",
+              ap_prc->ring_name_, ap_prc->reader_,
+              ETIZShmringPolicyDropOldest == ap_prc->policy_ ? "drop-oldest"
+                                                             : "backpressure");
+  ap_prc->eos_ = false;
+  return OMX_ErrorNone;
+}
+
+static void
+disconnect_ring (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  stop_retry_timer (ap_prc);
+  if (ap_prc->p_ring_)
+    {
+      tiz_shmring_stats_t stats;
+      stop_waiter (ap_prc);
+      if (OMX_ErrorNone
+          == tiz_shmring_stats (ap_prc->p_ring_, ap_prc->reader_, &stats))
+        {
+          TIZ_NOTICE (handleOf (ap_prc),
+                      "[%s] read [%llu/%llu] dropped [%llu] overruns [%llu]",
+                      ap_prc->ring_name_,
+                      (unsigned long long) stats.read_records,
+                      (unsigned long long) stats.written_records,
+                      (unsigned long long) stats.dropped_records,
+                      (unsigned long long) stats.overruns);
+        }
+      tiz_shmring_detach (ap_prc->p_ring_, ap_prc->reader_);
+      tiz_shmring_destroy (ap_prc->p_ring_);
+      ap_prc->p_ring_ = NULL;
+      ap_prc->reader_ = -1;
+    }
+}
+
+static OMX_ERRORTYPE
+obtain_ring_name (inprocsrc_prc_t * ap_prc)
+{
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+  const size_t uri_size = sizeof (OMX_PARAM_CONTENTURITYPE) + PATH_MAX + 1;
+  const char * p_name = ARATELIA_INPROC_READER_DEFAULT_RING_NAME;
+  assert (ap_prc);
+
+  if (!(p_uri = tiz_mem_calloc (1, uri_size)))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_uri->nSize = uri_size;
+  p_uri->nVersion.nVersion = OMX_VERSION;
+  if (OMX_ErrorNone
+      == tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                               handleOf (ap_prc), OMX_IndexParamContentURI,
+                               p_uri))
+    {
+      /* e.g. inproc://broadcast */
+      const char * p_uri_str = (const char *) p_uri->contentURI;
+      if (0
+          == strncmp (p_uri_str, INPROC_URI_SCHEME, strlen (INPROC_URI_SCHEME)))
+        {
+          p_uri_str += strlen (INPROC_URI_SCHEME);
+        }
+      if (p_uri_str[0])
+        {
+          p_name = p_uri_str;
+        }
+    }
+
+  snprintf (ap_prc->ring_name_, sizeof (ap_prc->ring_name_), "%s", p_name);
+  tiz_mem_free (p_uri);
+  return OMX_ErrorNone;
+}
+
+static tiz_shmring_policy_t
+obtain_policy (inprocsrc_prc_t * ap_prc)
+{
+  const char * p_policy = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    ARATELIA_INPROC_READER_COMPONENT_NAME ".overflow_policy");
+  (void) ap_prc;
+  return (p_policy && 0 == strcmp (p_policy, "drop-oldest"))
+           ? ETIZShmringPolicyDropOldest
+           : ETIZShmringPolicyBackpressure;
+}
+
 /*
  * inprocsrcprc
  */
@@ -54,7 +455,21 @@ static void *
 inprocsrc_prc_ctor (void *ap_obj, va_list * app)
 {
   inprocsrc_prc_t *p_obj = super_ctor (typeOf (ap_obj, "inprocsrcprc"), ap_obj, app);
+  p_obj->p_outhdr_ = NULL;
+  p_obj->port_disabled_ = false;
+  p_obj->paused_ = false;
+  p_obj->stopped_ = true;
   p_obj->eos_ = false;
+  p_obj->ring_name_[0] = '\0';
+  p_obj->policy_ = ETIZShmringPolicyBackpressure;
+  p_obj->p_ring_ = NULL;
+  p_obj->reader_ = -1;
+  p_obj->p_ev_timer_ = NULL;
+  p_obj->awaiting_ring_ = false;
+  p_obj->waiter_running_ = false;
+  p_obj->waiter_parked_ = false;
+  p_obj->waiter_stop_ = false;
+  p_obj->waiter_gen_ = 0;
   return p_obj;
 }
 
@@ -64,12 +479,6 @@ inprocsrc_prc_dtor (void *ap_obj)
   return super_dtor (typeOf (ap_obj, "inprocsrcprc"), ap_obj);
 }
 
-static OMX_ERRORTYPE
-inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
-{
-  return OMX_ErrorNone;
-}
-
 /*
  * from tizsrv class
  */
@@ -77,30 +486,69 @@ inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
 static OMX_ERRORTYPE
 inprocsrc_prc_allocate_resources (void *ap_obj, OMX_U32 a_pid)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  tiz_check_omx (obtain_ring_name (p_prc));
+  p_prc->policy_ = obtain_policy (p_prc);
+  if (!p_prc->p_ev_timer_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
+    }
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_deallocate_resources (void *ap_obj)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  disconnect_ring (p_prc);
+  if (p_prc->p_ev_timer_)
+    {
+      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_ev_timer_);
+      p_prc->p_ev_timer_ = NULL;
+    }
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_prepare_to_transfer (void *ap_obj, OMX_U32 a_pid)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->eos_ = false;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_transfer_and_process (void *ap_obj, OMX_U32 a_pid)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = false;
+  /* The reader starts with the next record the writer produces */
+  return connect_ring (p_prc);
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_stop_and_return (void *ap_obj)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  disconnect_ring (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_timer_ready (void *ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  if (!p_prc->stopped_ && !p_prc->port_disabled_)
+    {
+      tiz_check_omx (connect_ring (p_prc));
+    }
   return OMX_ErrorNone;
 }
 
@@ -111,9 +559,55 @@ inprocsrc_prc_stop_and_return (void *ap_obj)
 static OMX_ERRORTYPE
 inprocsrc_prc_buffers_ready (const void *ap_obj)
 {
+  return read_from_ring ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_pause (const void *ap_obj)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  /* Records keep arriving: a backpressure reader stops the writer, a
+     drop-oldest one will lose the oldest ones */
+  p_prc->paused_ = true;
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+inprocsrc_prc_resume (const void *ap_obj)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  return read_from_ring (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_flush (const void *ap_obj, OMX_U32 a_pid)
+{
+  return release_header ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_disable (const void *ap_obj, OMX_U32 a_pid)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  /* Don't hold the writer back while the port is disabled */
+  disconnect_ring (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_port_enable (const void *ap_obj, OMX_U32 a_pid)
+{
+  inprocsrc_prc_t *p_prc = (inprocsrc_prc_t *) ap_obj;
+  assert (p_prc);
+  p_prc->port_disabled_ = false;
+  return p_prc->stopped_ ? OMX_ErrorNone : connect_ring (p_prc);
+}
+
 /*
  * inprocsrc_prc_class
  */
@@ -171,7 +665,19 @@ inprocsrc_prc_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_stop_and_return, inprocsrc_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
+     tiz_srv_timer_ready, inprocsrc_prc_timer_ready,
+     /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, inprocsrc_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_pause, inprocsrc_prc_pause,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_resume, inprocsrc_prc_resume,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_flush, inprocsrc_prc_port_flush,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, inprocsrc_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, inprocsrc_prc_port_enable,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
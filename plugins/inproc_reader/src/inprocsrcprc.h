@@ -21,7 +21,7 @@
  * @file   inprocsrcprc.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader
+ * @brief  Tizonia - Shared memory ring reader
  *
  *
  */
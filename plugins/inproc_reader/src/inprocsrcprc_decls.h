@@ -20,7 +20,7 @@
  * @file   inprocsrcprc_decls.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader declarations
+ * @brief  Tizonia - Shared memory ring reader declarations
  *
  *
  */
@@ -34,9 +34,12 @@ extern "C"
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
+
 #include <tizprc_decls.h>
 
   typedef struct inprocsrc_prc inprocsrc_prc_t;
@@ -44,7 +47,24 @@ extern "C"
   {
     /* Object */
     const tiz_prc_t _;
+    OMX_BUFFERHEADERTYPE *p_outhdr_;
+    bool port_disabled_;
+    bool paused_;
+    bool stopped_;
     bool eos_;
+    char ring_name_[OMX_MAX_STRINGNAME_SIZE];
+    tiz_shmring_policy_t policy_;
+    tiz_shmring_t *p_ring_;
+    int reader_;
+    tiz_event_timer_t *p_ev_timer_;
+    bool awaiting_ring_;
+    /* Waits on the ring, and tells the component thread when there is data */
+    tiz_thread_t waiter_;
+    tiz_sem_t waiter_sem_;
+    bool waiter_running_;
+    bool waiter_parked_;
+    bool waiter_stop_;
+    uintptr_t waiter_gen_;
   };
 
   typedef struct inprocsrc_prc_class inprocsrc_prc_class_t;
@@ -21,7 +21,7 @@
  * @file   inprocrnd.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer constants
+ * @brief  Tizonia - Shared memory ring writer constants
  *
  *
  */
@@ -47,6 +47,9 @@ extern "C"
 #define ARATELIA_INPROC_WRITER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_INPROC_WRITER_PORT_ALIGNMENT     0
 #define ARATELIA_INPROC_WRITER_PORT_SUPPLIERPREF  OMX_BufferSupplyInput
+#define ARATELIA_INPROC_WRITER_DEFAULT_RING_NAME  "broadcast"
+#define ARATELIA_INPROC_WRITER_DEFAULT_RING_SIZE  (1024 * 1024)
+#define ARATELIA_INPROC_WRITER_RETRY_SECONDS      0.005
 
 #ifdef __cplusplus
 }
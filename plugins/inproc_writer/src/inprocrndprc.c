@@ -21,7 +21,7 @@
  * @file   inprocrndprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer processor
+ * @brief  Tizonia - Shared memory ring writer processor
  *
  *
  */
@@ -31,6 +31,9 @@
 #endif
 
 #include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <tizplatform.h>
 
@@ -46,27 +49,7 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.inproc_writer.prc"
 #endif
 
-#define goto_end_on_zmq_null_pointer(expr, prc, msg)  \
-  do                                                  \
-    {                                                 \
-      if (NULL == (expr))                             \
-        {                                             \
-          TIZ_ERROR (handleOf (prc), "%s (%s)", msg); \
-          goto end;                                   \
-        }                                             \
-    }                                                 \
-  while (0)
-
-#define goto_end_on_zmq_error(expr, prc, msg)         \
-  do                                                  \
-    {                                                 \
-      if (0 != (expr))                                \
-        {                                             \
-          TIZ_ERROR (handleOf (prc), "%s (%s)", msg); \
-          goto end;                                   \
-        }                                             \
-    }                                                 \
-  while (0)
+#define INPROC_URI_SCHEME "inproc://"
 
 static OMX_BUFFERHEADERTYPE *get_header (inprocrnd_prc_t *ap_prc)
 {
@@ -100,31 +83,7 @@ static bool ready_to_process (inprocrnd_prc_t *ap_prc)
              ap_prc->port_disabled_ ? "YES" : "NO",
              ap_prc->stopped_ ? "YES" : "NO");
   return (!ap_prc->paused_ && !ap_prc->port_disabled_ && !ap_prc->stopped_
-          && get_header (ap_prc));
-}
-
-static bool ready_to_write_to_zmq_sock (inprocrnd_prc_t *ap_prc)
-{
-  int zmq_rc = 0;
-  int zevents = 0;
-  size_t zevents_len = sizeof(zevents);
-  bool sock_ready = false;
-  assert (ap_prc);
-
-  if (ap_prc->p_zmq_sock_)
-    {
-      zmq_rc = zmq_getsockopt (ap_prc->p_zmq_sock_, ZMQ_EVENTS, &zevents,
-                               &zevents_len);
-      if (!zmq_rc)
-        {
-          if (zevents & ZMQ_POLLOUT)
-            {
-              // We can write to the ZeroMQ socket
-              sock_ready = true;
-            }
-        }
-    }
-  return sock_ready;
+          && ap_prc->p_ring_ && get_header (ap_prc));
 }
 
 static OMX_ERRORTYPE release_header (inprocrnd_prc_t *ap_prc)
@@ -155,6 +114,7 @@ static OMX_ERRORTYPE buffer_emptied (inprocrnd_prc_t *ap_prc)
     {
       TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
                  ap_prc->p_inhdr_);
+      ap_prc->eos_ = true;
       tiz_srv_issue_event ((OMX_PTR)ap_prc, OMX_EventBufferFlag, 0,
                            ap_prc->p_inhdr_->nFlags, NULL);
     }
@@ -162,29 +122,152 @@ static OMX_ERRORTYPE buffer_emptied (inprocrnd_prc_t *ap_prc)
   return release_header (ap_prc);
 }
 
+static void log_reader_stats (inprocrnd_prc_t *ap_prc)
+{
+  tiz_shmring_stats_t stats;
+  int i = 0;
+  assert (ap_prc);
+
+  if (ap_prc->p_ring_)
+    {
+      for (i = 0; i < TIZ_SHMRING_MAX_READERS; ++i)
+        {
+          if (OMX_ErrorNone == tiz_shmring_stats (ap_prc->p_ring_, i, &stats))
+            {
+              TIZ_NOTICE (handleOf (ap_prc),
+                          "[%s] reader [%d] (%s) : read [%llu/%llu] "
+                          "lag [%llu] dropped [%llu] overruns [%llu]",
+                          ap_prc->ring_name_, i,
+                          ETIZShmringPolicyDropOldest == stats.policy
+                              ? "drop-oldest"
+                              : "backpressure",
+                          (unsigned long long)stats.read_records,
+                          (unsigned long long)stats.written_records,
+                          (unsigned long long)stats.lag_bytes,
+                          (unsigned long long)stats.dropped_records,
+                          (unsigned long long)stats.overruns);
+            }
+        }
+    }
+}
+
+static OMX_ERRORTYPE start_retry_timer (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  if (!ap_prc->awaiting_room_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_start (
+          ap_prc, ap_prc->p_ev_timer_, ARATELIA_INPROC_WRITER_RETRY_SECONDS,
+          0));
+      ap_prc->awaiting_room_ = true;
+    }
+  return OMX_ErrorNone;
+}
+
+static void stop_retry_timer (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->awaiting_room_)
+    {
+      (void)tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_ev_timer_);
+      ap_prc->awaiting_room_ = false;
+    }
+}
+
+/* Each buffer goes to the ring as a record (or as several, if larger than
+   the largest record); its flags go with the last one. The component thread
+   never blocks on the ring: when a backpressure reader has left no room, the
+   write is retried from a timer. */
 static OMX_ERRORTYPE write_buffer (inprocrnd_prc_t *ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
   assert (ap_prc);
 
-  while ((p_hdr = get_header (ap_prc)))
+  while (OMX_ErrorNone == rc && ready_to_process (ap_prc))
     {
-      if (p_hdr->nFilledLen > 0)
+      p_hdr = ap_prc->p_inhdr_;
+      if (p_hdr->nFilledLen > 0 || p_hdr->nFlags != 0)
         {
-          const int bytes_to_write = 0;
+          const size_t max_record = tiz_shmring_max_record (ap_prc->p_ring_);
+          const size_t bytes_to_write
+              = p_hdr->nFilledLen > max_record ? max_record : p_hdr->nFilledLen;
+          const bool last = (bytes_to_write == p_hdr->nFilledLen);
+          rc = tiz_shmring_write (ap_prc->p_ring_,
+                                  p_hdr->pBuffer + p_hdr->nOffset,
+                                  bytes_to_write, last ? p_hdr->nFlags : 0, 0);
+          if (OMX_ErrorNotReady == rc)
+            {
+              TIZ_TRACE (handleOf (ap_prc), "[%s] ring full",
+                         ap_prc->ring_name_);
+              return start_retry_timer (ap_prc);
+            }
+          else if (OMX_ErrorNone != rc)
+            {
+              TIZ_ERROR (handleOf (ap_prc), "[%s] : while writing to [%s]",
+                         tiz_err_to_str (rc), ap_prc->ring_name_);
+              break;
+            }
           p_hdr->nFilledLen -= bytes_to_write;
           p_hdr->nOffset += bytes_to_write;
+          if (p_hdr->nFilledLen > 0)
+            {
+              continue;
+            }
         }
 
-      if (0 == p_hdr->nFilledLen)
+      rc = buffer_emptied (ap_prc);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE obtain_ring_name (inprocrnd_prc_t *ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_PARAM_CONTENTURITYPE *p_uri = NULL;
+  const size_t uri_size = sizeof(OMX_PARAM_CONTENTURITYPE) + PATH_MAX + 1;
+  const char *p_name = ARATELIA_INPROC_WRITER_DEFAULT_RING_NAME;
+  assert (ap_prc);
+
+  if (!(p_uri = tiz_mem_calloc (1, uri_size)))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_uri->nSize = uri_size;
+  p_uri->nVersion.nVersion = OMX_VERSION;
+  rc = tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)),
+                             handleOf (ap_prc), OMX_IndexParamContentURI,
+                             p_uri);
+  if (OMX_ErrorNone == rc)
+    {
+      /* e.g. inproc://broadcast */
+      const char *p_uri_str = (const char *)p_uri->contentURI;
+      if (0 == strncmp (p_uri_str, INPROC_URI_SCHEME,
+                        strlen (INPROC_URI_SCHEME)))
+        {
+          p_uri_str += strlen (INPROC_URI_SCHEME);
+        }
+      if (p_uri_str[0])
         {
-          rc = buffer_emptied (ap_prc);
-          p_hdr = NULL;
+          p_name = p_uri_str;
         }
     }
 
-  return rc;
+  snprintf (ap_prc->ring_name_, sizeof(ap_prc->ring_name_), "%s", p_name);
+  tiz_mem_free (p_uri);
+  return OMX_ErrorNone;
+}
+
+static size_t obtain_ring_size (inprocrnd_prc_t *ap_prc)
+{
+  const char *p_size = tiz_rcfile_get_value (
+      TIZ_RCFILE_PLUGINS_DATA_SECTION,
+      ARATELIA_INPROC_WRITER_COMPONENT_NAME ".ring_size");
+  const long kib = p_size ? strtol (p_size, NULL, 10) : 0;
+  (void)ap_prc;
+  return kib > 0 ? (size_t)kib * 1024 : ARATELIA_INPROC_WRITER_DEFAULT_RING_SIZE;
 }
 
 /*
@@ -195,12 +278,15 @@ static void *inprocrnd_prc_ctor (void *ap_prc, va_list *app)
 {
   inprocrnd_prc_t *p_prc
       = super_ctor (typeOf (ap_prc, "inprocrndprc"), ap_prc, app);
+  p_prc->p_inhdr_ = NULL;
   p_prc->port_disabled_ = false;
   p_prc->paused_ = false;
   p_prc->stopped_ = true;
-  p_prc->p_zmq_ctx_ = NULL;
-  p_prc->p_zmq_sock_ = NULL;
-  p_prc->zmq_fd_ = -1;
+  p_prc->p_ring_ = NULL;
+  p_prc->ring_name_[0] = '\0';
+  p_prc->ring_size_ = ARATELIA_INPROC_WRITER_DEFAULT_RING_SIZE;
+  p_prc->p_ev_timer_ = NULL;
+  p_prc->awaiting_room_ = false;
   p_prc->eos_ = false;
   return p_prc;
 }
@@ -218,47 +304,49 @@ static OMX_ERRORTYPE inprocrnd_prc_allocate_resources (void *ap_prc,
                                                        OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
+  assert (!p_prc->p_ring_);
 
-  /* Create the zmq context */
-  p_prc->p_zmq_ctx_ = zmq_ctx_new ();
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_ctx_, p_prc, zmq_strerror (errno));
-
-  /* No need for io threads (since inproc transport) */
-  zmq_ctx_set (p_prc->p_zmq_ctx_, ZMQ_IO_THREADS, 0);
+  tiz_check_omx (obtain_ring_name (p_prc));
+  p_prc->ring_size_ = obtain_ring_size (p_prc);
 
-  /* Create the zmq PUB socket */
-  p_prc->p_zmq_sock_ = zmq_socket (p_prc->p_zmq_ctx_, ZMQ_PUB);
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_sock_, p_prc,
-                                zmq_strerror (errno));
-
-  /* Bind the socket to the inproc address */
-  zmq_rc = zmq_bind (p_prc->p_zmq_sock_, "inproc://broadcast");
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
-
-  /* All good */
-  rc = OMX_ErrorNone;
+  if (!p_prc->p_ev_timer_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_ev_timer_)));
+    }
 
-end:
+  /* Readers (in this process or in others) find the ring by its name */
+  rc = tiz_shmring_create (&(p_prc->p_ring_), p_prc->ring_name_,
+                           p_prc->ring_size_);
+  if (OMX_ErrorNone != rc)
+    {
+      TIZ_ERROR (handleOf (p_prc), "[%s] : Unable to create the ring [%s]",
+                 tiz_err_to_str (rc), p_prc->ring_name_);
+      return OMX_ErrorInsufficientResources;
+    }
 
-  return rc;
+  TIZ_NOTICE (handleOf (p_prc), "ring [%s] size [%lu] max record [%lu]",
+              p_prc->ring_name_, (unsigned long)p_prc->ring_size_,
+              (unsigned long)tiz_shmring_max_record (p_prc->p_ring_));
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_deallocate_resources (void *ap_prc)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
   assert (p_prc);
-  if (p_prc->p_zmq_sock_)
+  stop_retry_timer (p_prc);
+  if (p_prc->p_ev_timer_)
     {
-      zmq_close (p_prc->p_zmq_sock_);
-      p_prc->p_zmq_sock_ = NULL;
+      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_ev_timer_);
+      p_prc->p_ev_timer_ = NULL;
     }
-  if (p_prc->p_zmq_ctx_)
+  if (p_prc->p_ring_)
     {
-      zmq_ctx_shutdown (p_prc->p_zmq_ctx_);
-      p_prc->p_zmq_ctx_ = NULL;
+      /* Readers see the end of the stream once they have read what is left */
+      tiz_shmring_destroy (p_prc->p_ring_);
+      p_prc->p_ring_ = NULL;
     }
   return OMX_ErrorNone;
 }
@@ -267,63 +355,98 @@ static OMX_ERRORTYPE inprocrnd_prc_prepare_to_transfer (void *ap_prc,
                                                         OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
-  size_t fd_len = 0;
   assert (p_prc);
-
-  fd_len = sizeof(p_prc->zmq_fd_);
-  zmq_rc
-      = zmq_getsockopt (p_prc->p_zmq_sock_, ZMQ_FD, &p_prc->zmq_fd_, &fd_len);
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
-
-  /* All goood */
-  rc = OMX_ErrorNone;
-
-end:
-
-  return rc;
+  p_prc->eos_ = false;
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_transfer_and_process (void *ap_prc,
                                                          OMX_U32 a_pid)
 {
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = false;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_stop_and_return (void *ap_prc)
 {
-  return OMX_ErrorNone;
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  stop_retry_timer (p_prc);
+  log_reader_stats (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_timer_ready (void *ap_prc,
+                                                tiz_event_timer_t *ap_ev_timer)
+{
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->awaiting_room_ = false;
+  return write_buffer (p_prc);
 }
 
 /*
  * from tizprc class
  */
 
-static OMX_ERRORTYPE inprocrnd_prc_io_ready (void *ap_prc,
-                                             tiz_event_io_t *ap_ev_io, int a_fd,
-                                             int a_events)
+static OMX_ERRORTYPE inprocrnd_prc_buffers_ready (const void *ap_prc)
 {
   inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  if (ready_to_process (p_prc) && ready_to_write_to_zmq_sock (p_prc))
+  if (p_prc->awaiting_room_)
     {
-      rc = write_buffer (p_prc);
+      /* The retry timer will resume writing */
+      return OMX_ErrorNone;
     }
-  return rc;
+  return write_buffer (p_prc);
 }
 
-static OMX_ERRORTYPE inprocrnd_prc_buffers_ready (const void *ap_prc)
+static OMX_ERRORTYPE inprocrnd_prc_pause (const void *ap_prc)
 {
   inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  if (ready_to_process (p_prc))
-    {
-      rc = write_buffer (p_prc);
-    }
-  return rc;
+  p_prc->paused_ = true;
+  stop_retry_timer (p_prc);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_resume (const void *ap_prc)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->paused_ = false;
+  return write_buffer (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_flush (const void *ap_prc,
+                                               OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  stop_retry_timer (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_disable (const void *ap_prc,
+                                                 OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->port_disabled_ = true;
+  stop_retry_timer (p_prc);
+  return release_header (p_prc);
+}
+
+static OMX_ERRORTYPE inprocrnd_prc_port_enable (const void *ap_prc,
+                                                OMX_U32 a_pid)
+{
+  inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
+  assert (p_prc);
+  p_prc->port_disabled_ = false;
+  return OMX_ErrorNone;
 }
 
 /*
@@ -381,9 +504,19 @@ void *inprocrnd_prc_init (void *ap_tos, void *ap_hdl)
        /* TIZ_CLASS_COMMENT: */
        tiz_srv_stop_and_return, inprocrnd_prc_stop_and_return,
        /* TIZ_CLASS_COMMENT: */
-       tiz_srv_io_ready, inprocrnd_prc_io_ready,
+       tiz_srv_timer_ready, inprocrnd_prc_timer_ready,
        /* TIZ_CLASS_COMMENT: */
        tiz_prc_buffers_ready, inprocrnd_prc_buffers_ready,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_pause, inprocrnd_prc_pause,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_resume, inprocrnd_prc_resume,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_flush, inprocrnd_prc_port_flush,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_disable, inprocrnd_prc_port_disable,
+       /* TIZ_CLASS_COMMENT: */
+       tiz_prc_port_enable, inprocrnd_prc_port_enable,
        /* TIZ_CLASS_COMMENT: stop value */
        0);
 
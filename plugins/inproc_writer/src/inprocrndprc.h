@@ -21,7 +21,7 @@
  * @file   inprocrndprc.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer class
+ * @brief  Tizonia - Shared memory ring writer class
  *
  *
  */
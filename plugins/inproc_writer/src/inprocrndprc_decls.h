@@ -20,7 +20,7 @@
  * @file   inprocrndprc_decls.h
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer class declarations
+ * @brief  Tizonia - Shared memory ring writer class declarations
  *
  *
  */
@@ -35,11 +35,10 @@ extern "C"
 
 #include <stdbool.h>
 
-#include <zmq.h>
-#include <zmq_utils.h>
-
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
+
 #include <tizprc_decls.h>
 
   typedef struct inprocrnd_prc inprocrnd_prc_t;
@@ -51,9 +50,11 @@ extern "C"
     bool port_disabled_;
     bool paused_;
     bool stopped_;
-    void * p_zmq_ctx_;
-    void * p_zmq_sock_;
-    int zmq_fd_;
+    tiz_shmring_t * p_ring_;
+    char ring_name_[OMX_MAX_STRINGNAME_SIZE];
+    size_t ring_size_;
+    tiz_event_timer_t * p_ev_timer_;
+    bool awaiting_room_;
     bool eos_;
   };
 
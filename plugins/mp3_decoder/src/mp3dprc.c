@@ -37,6 +37,7 @@
 #include <tizplatform.h>
 
 #include <tizkernel.h>
+#include <tizpcmpack.h>
 
 #include "mp3d.h"
 #include "mp3dprc.h"
@@ -47,6 +48,9 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.mp3_decoder.prc"
 #endif
 
+/* Interleaved S16 stereo */
+#define MP3D_OUTPUT_FRAME_SIZE 4
+
 static void
 reset_stream_parameters (mp3d_prc_t * ap_prc)
 {
@@ -145,8 +149,11 @@ store_metadata (mp3d_prc_t * ap_prc, const char * ap_header_name,
       info_len = strnlen (ap_header_info, OMX_MAX_STRINGNAME_SIZE - 1) + 1;
       metadata_len = sizeof (OMX_CONFIG_METADATAITEMTYPE) + info_len;
 
-      if (NULL == (p_meta = (OMX_CONFIG_METADATAITEMTYPE *) tiz_mem_calloc (
-                     1, metadata_len)))
+      /* The item is owned by the processor's arena, and is released with it
+         at the next track change */
+      if (NULL
+          == (p_meta = (OMX_CONFIG_METADATAITEMTYPE *) tiz_srv_arena_calloc (
+                ap_prc, metadata_len)))
         {
           rc = OMX_ErrorInsufficientResources;
         }
@@ -253,6 +260,7 @@ store_stream_metadata (mp3d_prc_t * ap_prc, struct mad_header * Header)
     char info[100];
 
     (void) tiz_krn_clear_metadata (tiz_get_krn (handleOf (ap_prc)));
+    tiz_srv_arena_reset (ap_prc);
 
     snprintf (
       info, 99, "%lu kbit/s, %d Hz",
@@ -280,46 +288,6 @@ store_stream_metadata (mp3d_prc_t * ap_prc, struct mad_header * Header)
              Emphasis, Header->samplerate);
 }
 
-static signed short
-mad_fixed_to_sshort (mad_fixed_t fixed)
-{
-  /* A fixed point number is formed of the following bit pattern:
-   *
-   * SWWWFFFFFFFFFFFFFFFFFFFFFFFFFFFF
-   * MSB                          LSB
-   * S ==> Sign (0 is positive, 1 is negative)
-   * W ==> Whole part bits
-   * F ==> Fractional part bits
-   *
-   * This pattern contains MAD_F_FRACBITS fractional bits, one
-   * should alway use this macro when working on the bits of a fixed
-   * point number. It is not guaranteed to be constant over the
-   * different platforms supported by libmad.
-   *
-   * The signed short value is formed, after clipping, by the least
-   * significant whole part bit, followed by the 15 most significant
-   * fractional part bits. Warning: this is a quick and dirty way to
-   * compute the 16-bit number, madplay includes much better
-   * algorithms.
-   */
-
-  /* Clipping */
-  if (fixed >= MAD_F_ONE)
-    {
-      return (SHRT_MAX);
-    }
-
-  if (fixed <= -MAD_F_ONE)
-    {
-      return (-SHRT_MAX);
-    }
-
-  /* Conversion. */
-  fixed = fixed >> (MAD_F_FRACBITS - 15);
-
-  return (signed short) fixed;
-}
-
 static size_t
 read_from_omx_buffer (const mp3d_prc_t * ap_prc, void * ap_dst, size_t bytes,
                       OMX_BUFFERHEADERTYPE * ap_hdr)
@@ -389,48 +357,62 @@ synthesize_samples (const void * ap_obj, int next_sample)
     = p_prc->p_outhdr_->pBuffer + p_prc->p_outhdr_->nAllocLen;
   unsigned char * p_output
     = p_prc->p_outhdr_->pBuffer + p_prc->p_outhdr_->nFilledLen;
-  bool buffer_full = (p_bufend == p_output);
-  int i;
-
-  for (i = next_sample; i < p_prc->synth_.pcm.length && !buffer_full; i++)
+  bool buffer_full = (p_bufend - p_output < MP3D_OUTPUT_FRAME_SIZE);
+  /* We're outputting two channels, also for mono streams. If the decoded
+   * stream is monophonic then the right output channel is the same as the
+   * left one. */
+  const int32_t * p_left = (const int32_t *) p_prc->synth_.pcm.samples[0];
+  const int32_t * p_right
+    = (const int32_t *) p_prc->synth_
+        .pcm.samples[MAD_NCHANNELS (&p_prc->frame_.header) == 2 ? 1 : 0];
+  int i = next_sample;
+
+  if (i < p_prc->synth_.pcm.length && !buffer_full
+      && (p_prc->frame_.header.samplerate != p_prc->pcmmode_.nSamplingRate
+          || p_prc->pcmmode_.nChannels < 2))
     {
-      signed short sample;
+      const OMX_U32 nchannels = 2;
+      TIZ_PRINTF_DBG_GRN ("samplerate [%d] NCHANNELS [%d] channels [%d].",
+                          p_prc->frame_.header.samplerate,
+                          MAD_NCHANNELS (&p_prc->frame_.header),
+                          p_prc->synth_.pcm.channels);
+      store_stream_metadata (p_prc, &(p_prc->frame_.header));
+      (void) update_pcm_mode (p_prc, p_prc->synth_.pcm.samplerate, nchannels);
+    }
 
-      /* Left channel */
-      sample = mad_fixed_to_sshort (p_prc->synth_.pcm.samples[0][i]);
-      *(p_output++) = sample >> 8;
-      *(p_output++) = sample & 0xff;
+  while (i < p_prc->synth_.pcm.length && !buffer_full)
+    {
+      const int32_t * channels[2];
+      size_t nframes
+        = MIN ((size_t) (p_prc->synth_.pcm.length - i),
+               (size_t) (p_bufend - p_output) / MP3D_OUTPUT_FRAME_SIZE);
 
-      /* Right channel. If the decoded stream is monophonic then
-       * the right output channel is the same as the left one.
-       */
-      if (MAD_NCHANNELS (&p_prc->frame_.header) == 2)
+      if (p_prc->frame_count_ < 5)
         {
-          sample = mad_fixed_to_sshort (p_prc->synth_.pcm.samples[1][i]);
+          /* At the early stages of the decoding, stop at the point where the
+             buffer gets released */
+          const OMX_U32 early_len
+            = (OMX_U32) (ARATELIA_MP3_DECODER_PORT_MIN_OUTPUT_BUF_SIZE * .2);
+          const OMX_U32 filled = p_prc->p_outhdr_->nFilledLen;
+          nframes = MIN (nframes, filled >= early_len
+                                    ? 1
+                                    : (early_len - filled
+                                       + MP3D_OUTPUT_FRAME_SIZE - 1)
+                                        / MP3D_OUTPUT_FRAME_SIZE);
         }
-      *(p_output++) = sample >> 8;
-      *(p_output++) = sample & 0xff;
-
-      p_prc->p_outhdr_->nFilledLen += 4;
 
-      if (p_prc->frame_.header.samplerate != p_prc->pcmmode_.nSamplingRate
-          || p_prc->pcmmode_.nChannels < 2)
-        {
-          /* We're outputting two channels, also for mono streams.
-           */
-          const OMX_U32 nchannels = 2;
-          TIZ_PRINTF_DBG_GRN ("samplerate [%d] NCHANNELS [%d] channels [%d].",
-                              p_prc->frame_.header.samplerate,
-                              MAD_NCHANNELS (&p_prc->frame_.header),
-                              p_prc->synth_.pcm.channels);
-          store_stream_metadata (p_prc, &(p_prc->frame_.header));
-          (void) update_pcm_mode (p_prc, p_prc->synth_.pcm.samplerate,
-                                  nchannels);
-        }
+      channels[0] = p_left + i;
+      channels[1] = p_right + i;
+      tiz_pcm_pack_fixed (p_output, channels, nframes, 2, MAD_F_FRACBITS,
+                          TIZ_PCM_FMT_S16_BE,
+                          p_prc->dither_enabled_ ? &p_prc->dither_ : NULL);
+      p_output += nframes * MP3D_OUTPUT_FRAME_SIZE;
+      p_prc->p_outhdr_->nFilledLen += nframes * MP3D_OUTPUT_FRAME_SIZE;
+      i += nframes;
 
       /* release the output buffer if it is full, or if we are at the early stages
          of the decoding */
-      if (p_output == p_bufend)
+      if (p_bufend - p_output < MP3D_OUTPUT_FRAME_SIZE)
         {
           p_output = p_prc->p_outhdr_->pBuffer;
           p_prc->p_outhdr_->nFilledLen = p_prc->p_outhdr_->nAllocLen;
@@ -711,6 +693,8 @@ mp3d_proc_ctor (void * ap_obj, va_list * app)
   p_obj->p_inhdr_ = 0;
   p_obj->p_outhdr_ = 0;
   p_obj->next_synth_sample_ = 0;
+  tiz_pcm_dither_init (&p_obj->dither_, 0);
+  p_obj->dither_enabled_ = false;
   p_obj->eos_ = false;
   p_obj->in_port_disabled_ = false;
   p_obj->out_port_disabled_ = false;
@@ -753,6 +737,17 @@ mp3d_proc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
      transition Exe->Idle */
   init_mad_decoder (ap_obj);
 
+  {
+    /* TPDF dither on the 16-bit output (off by default) */
+    const char * p_dither
+      = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                              ARATELIA_MP3_DECODER_COMPONENT_NAME ".dither");
+    p_prc->dither_enabled_
+      = (p_dither && 0 == strncmp (p_dither, "true", OMX_MAX_STRINGNAME_SIZE));
+    TIZ_DEBUG (handleOf (p_prc), "dither [%s]",
+               p_prc->dither_enabled_ ? "on" : "off");
+  }
+
   TIZ_INIT_OMX_PORT_STRUCT (mp3type, ARATELIA_MP3_DECODER_INPUT_PORT_INDEX);
   tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (p_prc)),
                                        handleOf (p_prc), OMX_IndexParamAudioMp3,
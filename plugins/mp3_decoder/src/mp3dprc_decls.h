@@ -39,6 +39,7 @@ extern "C" {
 #include <OMX_Core.h>
 
 #include <tizprc_decls.h>
+#include <tizpcmpack.h>
 
 #define INPUT_BUFFER_SIZE (5 * 8192)
 #define OUTPUT_BUFFER_SIZE 8192 /* Must be an integer multiple of 4. */
@@ -59,6 +60,8 @@ struct mp3d_prc
   OMX_BUFFERHEADERTYPE * p_inhdr_;
   OMX_BUFFERHEADERTYPE * p_outhdr_;
   int next_synth_sample_;
+  tiz_pcm_dither_t dither_;
+  bool dither_enabled_;
   bool eos_;
   bool in_port_disabled_;
   bool out_port_disabled_;
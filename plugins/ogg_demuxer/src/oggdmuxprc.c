@@ -103,6 +103,47 @@ is_video_content (const OggzStreamContent content)
     };
 }
 
+/* Stream discovery reads the head of the input (up to the first non-BOS
+   page) once. Those bytes are kept in p_head_, and the seek back to the start
+   of the stream that follows discovery is served from memory. This way the
+   input is not read twice and does not need to be seekable. The head is
+   dropped as soon as demuxing reads past it. */
+static void
+drop_head (oggdmux_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->head_valid_ = false;
+  ap_prc->head_recording_ = false;
+  tiz_buffer_clear (ap_prc->p_head_);
+}
+
+static inline bool
+is_reading_head (const oggdmux_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return ap_prc->head_valid_ && tiz_buffer_available (ap_prc->p_head_) > 0;
+}
+
+static void
+record_head (oggdmux_prc_t * ap_prc, const void * ap_data,
+             const size_t a_nbytes)
+{
+  assert (ap_prc);
+  if (tiz_buffer_offset (ap_prc->p_head_) + a_nbytes
+        > TIZ_OGG_DEMUXER_MAX_HEAD_BYTES
+      || tiz_buffer_push (ap_prc->p_head_, ap_data, a_nbytes)
+           < (int) a_nbytes)
+    {
+      /* Discovery will need to seek back on the input instead */
+      TIZ_DEBUG (handleOf (ap_prc), "Stream head too large - not recorded");
+      drop_head (ap_prc);
+    }
+  else
+    {
+      (void) tiz_buffer_advance (ap_prc->p_head_, a_nbytes);
+    }
+}
+
 static size_t
 og_io_read (void * ap_user_handle, void * ap_buf, size_t n)
 {
@@ -113,8 +154,30 @@ og_io_read (void * ap_user_handle, void * ap_buf, size_t n)
   assert (p_prc);
   f = p_prc->p_file_;
 
+  if (is_reading_head (p_prc))
+    {
+      bytes_read = MIN (n, (size_t) tiz_buffer_available (p_prc->p_head_));
+      memcpy (ap_buf, tiz_buffer_get (p_prc->p_head_), bytes_read);
+      (void) tiz_buffer_advance (p_prc->p_head_, bytes_read);
+      return bytes_read;
+    }
+
+  if (p_prc->head_valid_ && !p_prc->head_recording_)
+    {
+      /* Demuxing has gone past the head of the stream */
+      drop_head (p_prc);
+    }
+
   bytes_read = read (fileno (f), ap_buf, n);
-  if (0 == bytes_read)
+  if (bytes_read > 0)
+    {
+      p_prc->file_pos_ += bytes_read;
+      if (p_prc->head_recording_)
+        {
+          record_head (p_prc, ap_buf, bytes_read);
+        }
+    }
+  else if (0 == bytes_read)
     {
       TIZ_TRACE (handleOf (p_prc), "Zero bytes_read buf [%p] n [%d]", ap_buf,
                  n);
@@ -122,24 +185,49 @@ og_io_read (void * ap_user_handle, void * ap_buf, size_t n)
   return bytes_read;
 }
 
-static int
-og_io_seek (void * ap_user_handle, long offset, int whence)
+static long
+og_io_tell (void * ap_user_handle)
 {
   oggdmux_prc_t * p_prc = ap_user_handle;
-  FILE * f = NULL;
   assert (p_prc);
-  f = p_prc->p_file_;
-  return (fseek (f, offset, whence));
+  return is_reading_head (p_prc) ? tiz_buffer_offset (p_prc->p_head_)
+                                 : p_prc->file_pos_;
 }
 
-static long
-og_io_tell (void * ap_user_handle)
+static int
+og_io_seek (void * ap_user_handle, long offset, int whence)
 {
   oggdmux_prc_t * p_prc = ap_user_handle;
   FILE * f = NULL;
   assert (p_prc);
   f = p_prc->p_file_;
-  return ftell (f);
+
+  if (SEEK_CUR == whence)
+    {
+      offset += og_io_tell (p_prc);
+      whence = SEEK_SET;
+    }
+
+  if (SEEK_SET == whence && p_prc->head_valid_ && !p_prc->head_recording_
+      && offset <= tiz_buffer_offset (p_prc->p_head_)
+                     + tiz_buffer_available (p_prc->p_head_))
+    {
+      return tiz_buffer_seek (p_prc->p_head_, offset, TIZ_BUFFER_SEEK_SET);
+    }
+
+  if (SEEK_SET == whence && offset == og_io_tell (p_prc))
+    {
+      /* Nothing to do; this also spares a seek on non-seekable input */
+      return 0;
+    }
+
+  drop_head (p_prc);
+  if (0 != fseek (f, offset, whence))
+    {
+      return -1;
+    }
+  p_prc->file_pos_ = ftell (f);
+  return 0;
 }
 
 static OMX_ERRORTYPE
@@ -190,9 +278,25 @@ alloc_file (oggdmux_prc_t * ap_prc)
   assert (!ap_prc->p_file_);
   tiz_check_null_ret_oom (
     (ap_prc->p_file_ = fopen ((const char *) ap_prc->p_uri_->contentURI, "r")));
+  ap_prc->file_pos_ = 0;
   return rc;
 }
 
+static OMX_ERRORTYPE
+alloc_head (oggdmux_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (!ap_prc->p_head_);
+  tiz_check_omx (tiz_buffer_init (&(ap_prc->p_head_),
+                                  TIZ_OGG_DEMUXER_INITIAL_READ_BLOCKSIZE * 2));
+  ap_prc->head_valid_ = false;
+  ap_prc->head_recording_ = false;
+  /* The head is replayed from the start after discovery */
+  return tiz_buffer_seek_mode (ap_prc->p_head_, TIZ_BUFFER_SEEKABLE) < 0
+           ? OMX_ErrorInsufficientResources
+           : OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 alloc_data_stores (oggdmux_prc_t * ap_prc)
 {
@@ -264,6 +368,18 @@ dealloc_file (/*@special@ */ oggdmux_prc_t * ap_prc)
     }
 }
 
+static inline void
+dealloc_head (/*@special@ */ oggdmux_prc_t * ap_prc)
+/*@releases ap_prc->p_head_ @ */
+/*@ensures isnull ap_prc->p_head_ @ */
+{
+  assert (ap_prc);
+  tiz_buffer_destroy (ap_prc->p_head_);
+  ap_prc->p_head_ = NULL;
+  ap_prc->head_valid_ = false;
+  ap_prc->head_recording_ = false;
+}
+
 static inline void
 dealloc_oggz (/*@special@ */ oggdmux_prc_t * ap_prc)
 /*@releases ap_prc->p_oggz_, ap_prc->p_tracks_ @ */
@@ -346,6 +462,19 @@ get_store_offset_ptr (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid)
   return p_offset;
 }
 
+static inline OMX_TICKS *
+get_store_ts_ptr (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  OMX_TICKS * p_ts = NULL;
+  assert (ap_prc);
+  assert (a_pid <= ARATELIA_OGG_DEMUXER_VIDEO_PORT_BASE_INDEX);
+  p_ts = a_pid == ARATELIA_OGG_DEMUXER_AUDIO_PORT_BASE_INDEX
+           ? &(ap_prc->aud_store_ts_)
+           : &(ap_prc->vid_store_ts_);
+  assert (p_ts);
+  return p_ts;
+}
+
 static inline bool *
 get_port_disabled_ptr (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid)
 {
@@ -385,6 +514,74 @@ get_eos_ptr (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid)
   return p_eos;
 }
 
+/* Buffers are packet-aligned: each buffer carries bytes of one Ogg packet
+   only, and the one that carries the last byte of the packet is flagged with
+   OMX_BUFFERFLAG_ENDOFFRAME and time-stamped with the packet's granule
+   position converted to OMX ticks. That is the time at the end of the
+   packet's samples, not its presentation time, and codec-specific offsets
+   (e.g. Opus pre-skip) are not removed; the decoders take care of both. A
+   packet that does not fit in one buffer spans several, and only the last of
+   them is flagged. Decoders can then decode straight from the buffer
+   whenever the flag is present. */
+static void
+mark_packet_end (OMX_BUFFERHEADERTYPE * ap_hdr, const bool a_end,
+                 const OMX_TICKS a_timestamp)
+{
+  assert (ap_hdr);
+  if (a_end)
+    {
+      ap_hdr->nFlags |= OMX_BUFFERFLAG_ENDOFFRAME;
+      if (a_timestamp >= 0)
+        {
+          ap_hdr->nTimeStamp = a_timestamp;
+          ap_hdr->nFlags &= ~OMX_BUFFERFLAG_TIMESTAMPINVALID;
+        }
+      else
+        {
+          ap_hdr->nTimeStamp = 0;
+          ap_hdr->nFlags |= OMX_BUFFERFLAG_TIMESTAMPINVALID;
+        }
+    }
+  else
+    {
+      ap_hdr->nFlags &= ~OMX_BUFFERFLAG_ENDOFFRAME;
+    }
+}
+
+/* Returns the time of a granule position (i.e. the end of the packet that
+   carries it), or -1 if it is unknown */
+static OMX_TICKS
+granulepos_to_timestamp (oggdmux_prc_t * ap_prc, const long a_serialno,
+                         const ogg_int64_t a_granulepos)
+{
+  ogg_int64_t granulerate_n = 0;
+  ogg_int64_t granulerate_d = 0;
+  ogg_int64_t units = a_granulepos;
+  int granuleshift = 0;
+
+  assert (ap_prc);
+
+  if (a_granulepos < 0
+      || 0 != oggz_get_granulerate (ap_prc->p_oggz_, a_serialno,
+                                    &granulerate_n, &granulerate_d)
+      || granulerate_n <= 0)
+    {
+      return -1;
+    }
+
+  /* Video codecs split the granule in keyframe number and frames since the
+     keyframe */
+  granuleshift = oggz_get_granuleshift (ap_prc->p_oggz_, a_serialno);
+  if (granuleshift > 0)
+    {
+      units = (a_granulepos >> granuleshift)
+              + (a_granulepos & ((((ogg_int64_t) 1) << granuleshift) - 1));
+    }
+
+  return (OMX_TICKS) (units * granulerate_d * OMX_TICKS_PER_SECOND
+                      / granulerate_n);
+}
+
 static int
 store_data (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid, const OMX_U8 * ap_data,
             OMX_U32 a_nbytes)
@@ -467,6 +664,9 @@ dump_temp_store (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid,
         {
           memmove (p_store, p_store + nbytes_to_copy, *p_offset);
         }
+      /* The temp store only ever holds the tail of one packet */
+      mark_packet_end (ap_hdr, 0 == *p_offset,
+                       *(get_store_ts_ptr (ap_prc, a_pid)));
       TIZ_TRACE (handleOf (ap_prc),
                  "HEADER [%p] pid [%d] nFilledLen [%d] "
                  "offset [%d]",
@@ -635,7 +835,8 @@ flush_temp_store (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid)
 
 static int
 flush_ogg_packet (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid,
-                  const OMX_U8 * ap_ogg_data, const OMX_U32 nbytes)
+                  const OMX_U8 * ap_ogg_data, const OMX_U32 nbytes,
+                  const OMX_TICKS a_timestamp)
 {
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
   OMX_U32 nbytes_remaining = nbytes;
@@ -648,6 +849,7 @@ flush_ogg_packet (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid,
                                      nbytes_remaining, p_hdr);
       nbytes_remaining -= nbytes_copied;
       op_offset += nbytes_copied;
+      mark_packet_end (p_hdr, 0 == nbytes_remaining, a_timestamp);
 #ifdef _DEBUG
       if (a_pid == ARATELIA_OGG_DEMUXER_AUDIO_PORT_BASE_INDEX)
         {
@@ -676,6 +878,7 @@ flush_ogg_packet (oggdmux_prc_t * ap_prc, const OMX_U32 a_pid,
        * available */
       TIZ_TRACE (handleOf (ap_prc), "Need to store [%d] bytes - pid [%d]",
                  nbytes_remaining, a_pid);
+      *(get_store_ts_ptr (ap_prc, a_pid)) = a_timestamp;
       nbytes_remaining
         = store_data (ap_prc, a_pid, ap_ogg_data + op_offset, nbytes_remaining);
     }
@@ -702,6 +905,7 @@ read_packet (OGGZ * ap_oggz, oggz_packet * ap_zp, long serialno,
   OMX_U32 op_offset = 0;
   bool * p_eos = NULL;
   ogg_packet * p_op = NULL;
+  ogg_int64_t granulepos = -1;
   int rc = OGGZ_CONTINUE;
 
   assert (ap_oggz);
@@ -729,8 +933,18 @@ read_packet (OGGZ * ap_oggz, oggz_packet * ap_zp, long serialno,
       *p_eos = true;
     }
 
+  /* Only the last packet of a page carries a granule position in the
+     stream; oggz calculates the others */
+  granulepos = ap_zp->pos.calc_granulepos;
+  if (granulepos < 0)
+    {
+      granulepos = p_op->granulepos;
+    }
+
   /* Try to empty the ogg packet out to an omx buffer */
-  op_offset = flush_ogg_packet (p_prc, a_pid, p_op->packet, p_op->bytes);
+  op_offset = flush_ogg_packet (
+    p_prc, a_pid, p_op->packet, p_op->bytes,
+    granulepos_to_timestamp (p_prc, serialno, granulepos));
 
   if (0 == op_offset)
     {
@@ -936,17 +1150,29 @@ obtain_tracks (oggdmux_prc_t * ap_prc)
   long n = 0;
   assert (p_prc);
 
-  /* Seek to beginning of file and set the first pass callback that will help
-   * with the discovery of the codecs */
+  /* Seek to beginning of file (only an actual seek if the stream has been
+   * demuxed before) and set the first pass callback that will help with the
+   * discovery of the codecs */
   tiz_check_omx (seek_to_byte_offset (p_prc, 0));
   tiz_check_omx (set_read_page_callback (p_prc, read_page_first_pass));
 
+  if (!p_prc->head_valid_)
+    {
+      /* Record the head of the stream while it is being read */
+      tiz_buffer_clear (p_prc->p_head_);
+      p_prc->head_valid_ = true;
+      p_prc->head_recording_ = true;
+    }
+
   while (
     (n = oggz_read (p_prc->p_oggz_, TIZ_OGG_DEMUXER_INITIAL_READ_BLOCKSIZE))
     > 0)
     ;
 
-  /* Seek to beginning of file and set the normal callback (no-op function) */
+  p_prc->head_recording_ = false;
+
+  /* Seek to beginning of file (served from the recorded head) and set the
+   * normal callback (no-op function) */
   tiz_check_omx (seek_to_byte_offset (p_prc, 0));
   tiz_check_omx (set_read_page_callback (p_prc, read_page_normal));
 
@@ -1081,6 +1307,10 @@ oggdmux_prc_ctor (void * ap_obj, va_list * app)
     = super_ctor (typeOf (ap_obj, "oggdmuxprc"), ap_obj, app);
   assert (p_prc);
   p_prc->p_file_ = NULL;
+  p_prc->file_pos_ = 0;
+  p_prc->p_head_ = NULL;
+  p_prc->head_valid_ = false;
+  p_prc->head_recording_ = false;
   p_prc->p_uri_ = NULL;
   p_prc->p_oggz_ = NULL;
 
@@ -1096,6 +1326,8 @@ oggdmux_prc_ctor (void * ap_obj, va_list * app)
   p_prc->vid_store_size_ = 0;
   p_prc->aud_store_offset_ = 0;
   p_prc->vid_store_offset_ = 0;
+  p_prc->aud_store_ts_ = 0;
+  p_prc->vid_store_ts_ = 0;
   p_prc->file_eos_ = false;
   p_prc->aud_eos_ = false;
   p_prc->vid_eos_ = false;
@@ -1122,6 +1354,7 @@ oggdmux_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
   assert (p_prc);
   tiz_check_omx (alloc_uri (p_prc));
   tiz_check_omx (alloc_file (p_prc));
+  tiz_check_omx (alloc_head (p_prc));
   tiz_check_omx (alloc_data_stores (p_prc));
   tiz_check_omx (alloc_oggz (p_prc));
   return OMX_ErrorNone;
@@ -1134,6 +1367,7 @@ oggdmux_prc_deallocate_resources (void * ap_obj)
   assert (p_prc);
   dealloc_oggz (p_prc);
   dealloc_data_stores (p_prc);
+  dealloc_head (p_prc);
   dealloc_file (p_prc);
   dealloc_uri (p_prc);
   return OMX_ErrorNone;
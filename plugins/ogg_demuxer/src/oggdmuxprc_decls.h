@@ -36,6 +36,8 @@ extern "C" {
 #include <stdbool.h>
 #include <oggz/oggz.h>
 
+#include <tizplatform.h>
+
 #include <tizprc_decls.h>
 
 typedef struct oggdmux_prc oggdmux_prc_t;
@@ -44,6 +46,10 @@ struct oggdmux_prc
   /* Object */
   const tiz_prc_t _;
   FILE * p_file_;
+  long file_pos_;
+  tiz_buffer_t * p_head_;
+  bool head_valid_;
+  bool head_recording_;
   OMX_PARAM_CONTENTURITYPE * p_uri_;
   OGGZ * p_oggz_;
   OggzTable * p_tracks_;
@@ -58,6 +64,8 @@ struct oggdmux_prc
   OMX_U32 vid_store_size_;
   OMX_U32 aud_store_offset_;
   OMX_U32 vid_store_offset_;
+  OMX_TICKS aud_store_ts_;
+  OMX_TICKS vid_store_ts_;
   bool file_eos_;
   bool aud_eos_;
   bool vid_eos_;
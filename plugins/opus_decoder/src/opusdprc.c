@@ -38,26 +38,13 @@
 #include <tizplatform.h>
 
 #include <tizkernel.h>
+#include <tizpcmpack.h>
 
 #include "opusd.h"
 #include "opusutils.h"
 #include "opusdprc.h"
 #include "opusdprc_decls.h"
 
-#ifdef HAVE_LRINTF
-#define float2int(x) lrintf (x)
-#else
-#define float2int(flt) ((int) (floor (.5 + flt)))
-#endif
-
-#ifndef HAVE_FMINF
-#define fminf(_x, _y) ((_x) < (_y) ? (_x) : (_y))
-#endif
-
-#ifndef HAVE_FMAXF
-#define fmaxf(_x, _y) ((_x) > (_y) ? (_x) : (_y))
-#endif
-
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
 #define TIZ_LOG_CATEGORY_NAME "tiz.opus_decoder.prc"
@@ -139,7 +126,11 @@ release_header (opusd_prc_t * ap_prc, const OMX_U32 a_pid)
              "nFilledLen [%d] nFlags [%d]",
              p_hdr, a_pid, p_hdr->nFilledLen, p_hdr->nFlags);
 
-  if (a_pid == ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX)
+  /* With packet-aligned input, only the buffer that completes a packet
+     counts */
+  if (a_pid == ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX
+      && (!ap_prc->pkt_store_.packetized
+          || (p_hdr->nFlags & OMX_BUFFERFLAG_ENDOFFRAME) > 0))
     {
       ap_prc->packet_count_++;
     }
@@ -316,6 +307,10 @@ init_opus_decoder (opusd_prc_t * ap_prc)
                ap_prc->rate_, ap_prc->mapping_family_, ap_prc->channels_,
                ap_prc->preskip_, gain, streams);
 
+    /* Pre-skip is always expressed in 48 kHz samples */
+    ap_prc->preskip_time_
+      = ((OMX_TICKS) ap_prc->preskip_ * OMX_TICKS_PER_SECOND) / 48000;
+
     store_stream_metadata (ap_prc);
     (void) update_pcm_mode (ap_prc, ap_prc->rate_, ap_prc->channels_);
 
@@ -334,6 +329,8 @@ static OMX_ERRORTYPE
 parse_opus_comments (opusd_prc_t * ap_prc)
 {
   int comments_offset = 0;
+  const OMX_U8 * p_data = NULL;
+  OMX_U32 len = 0;
   OMX_BUFFERHEADERTYPE * p_in
     = get_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX);
 
@@ -342,9 +339,41 @@ parse_opus_comments (opusd_prc_t * ap_prc)
       return OMX_ErrorNoMore;
     }
 
+  tiz_check_omx (
+    tiz_pkt_store_obtain (&ap_prc->pkt_store_, p_in, &p_data, &len, NULL));
+
+  if (0 == len)
+    {
+      /* Part of a packet has been staged; wait for the rest */
+      if (0 == p_in->nFilledLen && 0 == (p_in->nFlags & OMX_BUFFERFLAG_EOS))
+        {
+          tiz_check_omx (
+            release_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX));
+          return OMX_ErrorNoMore;
+        }
+      return OMX_ErrorNone;
+    }
+
   comments_offset
-    = process_opus_comments (handleOf (ap_prc), (char *) TIZ_OMX_BUF_PTR (p_in),
-                             TIZ_OMX_BUF_FILL_LEN (p_in));
+    = process_opus_comments (handleOf (ap_prc), (char *) p_data, len);
+
+  if (comments_offset > 0 && ap_prc->pkt_store_.packetized)
+    {
+      /* The whole packet holds the comments */
+      comments_offset = len;
+    }
+
+  if (0 == p_in->nFilledLen)
+    {
+      /* The packet was assembled in the packet store */
+      if (comments_offset > 0)
+        {
+          tiz_pkt_store_clear (&ap_prc->pkt_store_);
+          return release_header (ap_prc,
+                                 ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX);
+        }
+      return OMX_ErrorNone;
+    }
 
   p_in->nOffset += comments_offset;
   p_in->nFilledLen -= comments_offset;
@@ -390,6 +419,9 @@ transform_buffer (opusd_prc_t * ap_prc)
     = get_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX);
   OMX_BUFFERHEADERTYPE * p_out
     = get_header (ap_prc, ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX);
+  const OMX_U8 * p_data = NULL;
+  OMX_U32 len = 0;
+  OMX_TICKS end_time = -1;
 
   assert (ap_prc);
 
@@ -400,7 +432,10 @@ transform_buffer (opusd_prc_t * ap_prc)
       return OMX_ErrorNone;
     }
 
-  if (0 == p_in->nFilledLen)
+  tiz_check_omx (tiz_pkt_store_obtain (&ap_prc->pkt_store_, p_in, &p_data,
+                                       &len, &end_time));
+
+  if (0 == len)
     {
       TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFlags [%d] is empty", p_in,
                  p_in->nFlags);
@@ -418,13 +453,9 @@ transform_buffer (opusd_prc_t * ap_prc)
     }
 
   {
-    const unsigned char * p_data = p_in->pBuffer + p_in->nOffset;
-    opus_int32 len = p_in->nFilledLen;
     int fec = 0;
     float * output = NULL;
-    short * out = NULL;
     unsigned out_len = 0;
-    int i = 0;
     int tmp_skip = 0;
     int frame_size = opus_multistream_decode_float (ap_prc->p_opus_dec_, p_data,
                                                     len, ap_prc->p_out_buf_,
@@ -445,12 +476,11 @@ transform_buffer (opusd_prc_t * ap_prc)
         out_len = frame_size - tmp_skip;
 
         /* Convert to short and save to output file */
-        out = (short *) (p_out->pBuffer + p_out->nOffset);
-        for (i = 0; i < (int) out_len * ap_prc->channels_; ++i)
-          {
-            out[i] = (short) float2int (
-              fmaxf (-32768, fminf (output[i] * 32768.f, 32767)));
-          }
+        tiz_pcm_pack_float_ilv (p_out->pBuffer + p_out->nOffset, output,
+                                out_len, ap_prc->channels_,
+                                TIZ_PCM_FMT_S16_LE,
+                                ap_prc->dither_enabled_ ? &ap_prc->dither_
+                                                        : NULL);
 
         if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
           {
@@ -460,11 +490,28 @@ transform_buffer (opusd_prc_t * ap_prc)
           }
 
         p_out->nFilledLen = out_len * ap_prc->channels_ * 2;
+
+        /* The demuxer stamps the end of the packet, and Opus granule
+           positions count the pre-skip samples too. The output starts
+           out_len samples before the end of the packet. */
+        if (end_time >= 0)
+          {
+            end_time -= ap_prc->preskip_time_
+                        + ((OMX_TICKS) out_len * OMX_TICKS_PER_SECOND)
+                            / ap_prc->rate_;
+            p_out->nTimeStamp = end_time > 0 ? end_time : 0;
+            p_out->nFlags &= ~OMX_BUFFERFLAG_TIMESTAMPINVALID;
+          }
+        else
+          {
+            p_out->nFlags |= OMX_BUFFERFLAG_TIMESTAMPINVALID;
+          }
         TIZ_TRACE (handleOf (ap_prc),
                    "frame_size [%d] len [%d] - error [%s] nFilledLen [%d]",
                    frame_size, len, opus_strerror (frame_size),
                    p_out->nFilledLen);
         p_in->nFilledLen = 0;
+        tiz_pkt_store_clear (&ap_prc->pkt_store_);
         tiz_check_omx (
           release_header (ap_prc, ARATELIA_OPUS_DECODER_INPUT_PORT_INDEX));
         tiz_check_omx (
@@ -525,6 +572,8 @@ reset_stream_parameters (opusd_prc_t * ap_prc)
   ap_prc->eos_ = false;
   ap_prc->opus_header_parsed_ = false;
   ap_prc->opus_comments_parsed_ = false;
+  ap_prc->preskip_time_ = 0;
+  tiz_pkt_store_reset (&ap_prc->pkt_store_);
   if (ap_prc->p_opus_dec_)
     {
       opus_multistream_decoder_ctl (ap_prc->p_opus_dec_, OPUS_RESET_STATE);
@@ -548,6 +597,9 @@ opusd_prc_ctor (void * ap_obj, va_list * app)
   p_prc->p_in_hdr_ = NULL;
   p_prc->p_out_hdr_ = NULL;
   p_prc->p_out_buf_ = NULL;
+  tiz_pcm_dither_init (&p_prc->dither_, 0);
+  p_prc->dither_enabled_ = false;
+  tiz_pkt_store_init (&p_prc->pkt_store_);
   reset_stream_parameters (p_prc);
   p_prc->in_port_disabled_ = false;
   p_prc->out_port_disabled_ = false;
@@ -584,6 +636,7 @@ opusd_prc_deallocate_resources (void * ap_obj)
       p_prc->p_opus_dec_ = NULL;
     }
   deallocate_output_buffer (p_prc);
+  tiz_pkt_store_destroy (&p_prc->pkt_store_);
   return OMX_ErrorNone;
 }
 
@@ -591,6 +644,18 @@ static OMX_ERRORTYPE
 opusd_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
 {
   opusd_prc_t * p_prc = ap_obj;
+
+  {
+    /* TPDF dither on the 16-bit output (off by default) */
+    const char * p_dither
+      = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                              ARATELIA_OPUS_DECODER_COMPONENT_NAME ".dither");
+    p_prc->dither_enabled_
+      = (p_dither && 0 == strncmp (p_dither, "true", OMX_MAX_STRINGNAME_SIZE));
+    TIZ_DEBUG (handleOf (p_prc), "dither [%s]",
+               p_prc->dither_enabled_ ? "on" : "off");
+  }
+
   TIZ_INIT_OMX_PORT_STRUCT (p_prc->pcmmode_,
                             ARATELIA_OPUS_DECODER_OUTPUT_PORT_INDEX);
   tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (p_prc)),
@@ -38,6 +38,8 @@ extern "C" {
 #include <opus_multistream.h>
 
 #include <tizprc_decls.h>
+#include <tizpcmpack.h>
+#include <tizpktstore.h>
 
 typedef struct opusd_prc opusd_prc_t;
 struct opusd_prc
@@ -49,11 +51,15 @@ struct opusd_prc
   OMX_BUFFERHEADERTYPE * p_out_hdr_;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
   float * p_out_buf_;
+  tiz_pcm_dither_t dither_;
+  bool dither_enabled_;
+  tiz_pkt_store_t pkt_store_;
   opus_int64 packet_count_;
   int rate_;
   int mapping_family_;
   int channels_;
   int preskip_;
+  OMX_TICKS preskip_time_;
   bool eos_;
   bool in_port_disabled_;
   bool out_port_disabled_;
@@ -0,0 +1,573 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   arbench.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Benchmarks for the ALSA audio renderer
+ *
+ * Measures the per-sample cost of the renderer's gain, byte swapping and
+ * channel expansion at each bit depth, as done in the read/write path (in
+ * place, before snd_pcm_writei) and in the mmap path (while filling the
+ * ring buffer). With -d, it also plays silence on an ALSA device with each
+ * access mode and latency profile, configured like the renderer configures
+ * it, and reports the io wakeups, CPU time and context switches per second
+ * of audio. Not built by default: 'make bench' builds and runs it.
+ *
+ * Usage: tizalsaar-bench [-b name prefix] [-d alsa device] [-s seconds]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <alsa/asoundlib.h>
+
+#include "ar.h"
+#include "arpcm.h"
+
+/* A decoder's worth of stereo output per call */
+#define SAMPLES_BENCH_RATE 44100
+#define SAMPLES_BENCH_FRAMES 4608
+#define SAMPLES_BENCH_ITERATIONS 2000
+/* -1 dB */
+#define SAMPLES_BENCH_GAIN 0.891f
+
+#define DEVICE_BENCH_RATE 44100
+#define DEVICE_BENCH_CHANNELS 2
+#define DEVICE_BENCH_DEFAULT_SECS 5
+#define DEVICE_BENCH_MAX_FDS 16
+
+typedef struct bench_format bench_format_t;
+struct bench_format
+{
+  const char * p_name;
+  unsigned int bits;
+  bool big_endian;
+};
+
+typedef struct bench_profile bench_profile_t;
+struct bench_profile
+{
+  const char * p_name;
+  unsigned int buffer_time;
+  unsigned int period_time;
+};
+
+static const bench_format_t bench_formats[] = {
+  {"s16", 16, false},
+  {"s16be", 16, true},
+  {"s24", 24, false},
+  {"f32", 32, false},
+};
+
+static const bench_profile_t bench_profiles[] = {
+  {"default", ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME,
+   ARATELIA_AUDIO_RENDERER_DEFAULT_PERIOD_TIME},
+  {"low-latency", ARATELIA_AUDIO_RENDERER_LOW_LATENCY_BUFFER_TIME,
+   ARATELIA_AUDIO_RENDERER_LOW_LATENCY_PERIOD_TIME},
+  {"power-saving", ARATELIA_AUDIO_RENDERER_POWER_SAVING_BUFFER_TIME,
+   ARATELIA_AUDIO_RENDERER_POWER_SAVING_PERIOD_TIME},
+};
+
+#define BENCH_NUM_ELEMS(a) (sizeof (a) / sizeof (a[0]))
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double
+cpu_seconds (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static long
+context_switches (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+static void
+report (const char * ap_name, const long a_ops, const double a_secs)
+{
+  fprintf (stdout, "%-32s %10ld %8.3f %12.0f\n", ap_name, a_ops, a_secs,
+           a_secs > 0 ? a_ops / a_secs : 0);
+}
+
+static bool
+selected (const char * ap_name, const char * ap_prefix)
+{
+  return !ap_prefix || 0 == strncmp (ap_name, ap_prefix, strlen (ap_prefix));
+}
+
+/*
+ * Sample processing: the same work per buffer as in the renderer, with a
+ * gain set and the byte order swapped
+ */
+
+static void
+report_samples_rtf (const char * ap_name, const double a_start)
+{
+  const double elapsed = now_secs () - a_start;
+  const double audio = (double) SAMPLES_BENCH_FRAMES * SAMPLES_BENCH_ITERATIONS
+                       / SAMPLES_BENCH_RATE;
+  report (ap_name, (long) SAMPLES_BENCH_FRAMES * SAMPLES_BENCH_ITERATIONS,
+          elapsed);
+  fprintf (stdout, "%-32s %10s %8.1f %12.0f x realtime\n", "  audio secs", "",
+           audio, elapsed > 0 ? audio / elapsed : 0);
+}
+
+static int
+bench_samples (const char * ap_prefix)
+{
+  const size_t max_bytes = SAMPLES_BENCH_FRAMES * 2 * 4;
+  uint8_t * p_src = malloc (max_bytes);
+  uint8_t * p_hdr = malloc (max_bytes);
+  uint8_t * p_ring = malloc (max_bytes * 2);
+  char name[64];
+  size_t f = 0;
+  int i = 0;
+
+  if (!p_src || !p_hdr || !p_ring)
+    {
+      free (p_src);
+      free (p_hdr);
+      free (p_ring);
+      return -1;
+    }
+
+  for (i = 0; i < (int) max_bytes; ++i)
+    {
+      p_src[i] = (uint8_t) ((i * 7919) & 0xff);
+    }
+
+  for (f = 0; f < BENCH_NUM_ELEMS (bench_formats); ++f)
+    {
+      const bench_format_t * p_fmt = &bench_formats[f];
+      const size_t sample_size = p_fmt->bits / 8;
+      const size_t nsamples = SAMPLES_BENCH_FRAMES * 2;
+      const size_t nbytes = nsamples * sample_size;
+      double start = 0;
+
+      /* 32-bit samples are floats: keep them in range */
+      if (32 == p_fmt->bits)
+        {
+          for (i = 0; i < (int) nsamples; ++i)
+            {
+              const float v = ((i * 7919) % 65536 - 32768) / 32768.0f;
+              memcpy (p_src + i * sizeof (float), &v, sizeof (float));
+            }
+        }
+
+      /* rw: the header's samples are processed in place, and writei copies
+         them into the ring buffer */
+      snprintf (name, sizeof (name), "samples.rw.%s", p_fmt->p_name);
+      if (selected (name, ap_prefix))
+        {
+          start = now_secs ();
+          for (i = 0; i < SAMPLES_BENCH_ITERATIONS; ++i)
+            {
+              memcpy (p_hdr, p_src, nbytes);
+              ar_pcm_apply_gain (p_hdr, nsamples, p_fmt->bits,
+                                 p_fmt->big_endian, SAMPLES_BENCH_GAIN);
+              ar_pcm_swap_byte_order (p_hdr, nsamples, p_fmt->bits);
+              memcpy (p_ring, p_hdr, nbytes);
+            }
+          report_samples_rtf (name, start);
+        }
+
+      /* mmap: the samples are copied into the ring buffer and processed
+         there */
+      snprintf (name, sizeof (name), "samples.mmap.%s", p_fmt->p_name);
+      if (selected (name, ap_prefix))
+        {
+          start = now_secs ();
+          for (i = 0; i < SAMPLES_BENCH_ITERATIONS; ++i)
+            {
+              memcpy (p_hdr, p_src, nbytes);
+              ar_pcm_copy_frames (p_ring, p_hdr, SAMPLES_BENCH_FRAMES, 2, 2,
+                                  sample_size);
+              ar_pcm_apply_gain (p_ring, nsamples, p_fmt->bits,
+                                 p_fmt->big_endian, SAMPLES_BENCH_GAIN);
+              ar_pcm_swap_byte_order (p_ring, nsamples, p_fmt->bits);
+            }
+          report_samples_rtf (name, start);
+        }
+
+      /* mmap on a device with more channels than the stream */
+      snprintf (name, sizeof (name), "samples.mmap_expand.%s", p_fmt->p_name);
+      if (selected (name, ap_prefix))
+        {
+          start = now_secs ();
+          for (i = 0; i < SAMPLES_BENCH_ITERATIONS; ++i)
+            {
+              memcpy (p_hdr, p_src, nbytes / 2);
+              ar_pcm_copy_frames (p_ring, p_hdr, SAMPLES_BENCH_FRAMES, 1, 2,
+                                  sample_size);
+              ar_pcm_apply_gain (p_ring, nsamples, p_fmt->bits,
+                                 p_fmt->big_endian, SAMPLES_BENCH_GAIN);
+              ar_pcm_swap_byte_order (p_ring, nsamples, p_fmt->bits);
+            }
+          report_samples_rtf (name, start);
+        }
+    }
+
+  free (p_src);
+  free (p_hdr);
+  free (p_ring);
+  return 0;
+}
+
+/*
+ * Device playback: io wakeups, CPU time and context switches per second of
+ * audio for each access mode and latency profile
+ */
+
+static int
+open_device (const char * ap_device, const bool a_mmap,
+             const bench_profile_t * ap_profile, snd_pcm_t ** app_pcm,
+             snd_pcm_uframes_t * ap_period_size)
+{
+  snd_pcm_hw_params_t * p_hw = NULL;
+  snd_pcm_sw_params_t * p_sw = NULL;
+  snd_pcm_uframes_t buffer_size = 0;
+  unsigned int rate = DEVICE_BENCH_RATE;
+  unsigned int buffer_time = ap_profile->buffer_time;
+  unsigned int period_time = ap_profile->period_time;
+  int dir = 0;
+  int err = 0;
+
+  if ((err = snd_pcm_open (app_pcm, ap_device, SND_PCM_STREAM_PLAYBACK,
+                           SND_PCM_NONBLOCK))
+      < 0)
+    {
+      fprintf (stderr, "%s: %s\n", ap_device, snd_strerror (err));
+      return -1;
+    }
+
+  /* Same hw/sw params as the renderer's non-default configuration */
+  if ((err = snd_pcm_hw_params_malloc (&p_hw)) < 0
+      || (err = snd_pcm_hw_params_any (*app_pcm, p_hw)) < 0
+      || (err = snd_pcm_hw_params_set_rate_resample (*app_pcm, p_hw, 1)) < 0
+      || (err = snd_pcm_hw_params_set_access (
+            *app_pcm, p_hw,
+            a_mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED
+                   : SND_PCM_ACCESS_RW_INTERLEAVED))
+           < 0
+      || (err = snd_pcm_hw_params_set_format (*app_pcm, p_hw,
+                                              SND_PCM_FORMAT_S16_LE))
+           < 0
+      || (err = snd_pcm_hw_params_set_channels (*app_pcm, p_hw,
+                                                DEVICE_BENCH_CHANNELS))
+           < 0
+      || (err = snd_pcm_hw_params_set_rate_near (*app_pcm, p_hw, &rate, 0))
+           < 0
+      || (err = snd_pcm_hw_params_set_buffer_time_near (*app_pcm, p_hw,
+                                                        &buffer_time, &dir))
+           < 0
+      || (err = snd_pcm_hw_params_set_period_time_near (*app_pcm, p_hw,
+                                                        &period_time, &dir))
+           < 0
+      || (err = snd_pcm_hw_params (*app_pcm, p_hw)) < 0
+      || (err = snd_pcm_hw_params_get_buffer_size (p_hw, &buffer_size)) < 0
+      || (err = snd_pcm_hw_params_get_period_size (p_hw, ap_period_size,
+                                                   &dir))
+           < 0)
+    {
+      fprintf (stderr, "%s: hw params: %s\n", ap_device, snd_strerror (err));
+      snd_pcm_hw_params_free (p_hw);
+      return -1;
+    }
+  snd_pcm_hw_params_free (p_hw);
+
+  snd_pcm_sw_params_alloca (&p_sw);
+  if ((err = snd_pcm_sw_params_current (*app_pcm, p_sw)) < 0
+      || (err = snd_pcm_sw_params_set_avail_min (*app_pcm, p_sw,
+                                                 *ap_period_size))
+           < 0
+      || (err = snd_pcm_sw_params_set_start_threshold (
+            *app_pcm, p_sw,
+            (buffer_size / *ap_period_size) * *ap_period_size))
+           < 0
+      || (err = snd_pcm_sw_params (*app_pcm, p_sw)) < 0)
+    {
+      fprintf (stderr, "%s: sw params: %s\n", ap_device, snd_strerror (err));
+      return -1;
+    }
+
+  return 0;
+}
+
+/* Fill as much of the ring buffer as possible. Returns the frames written,
+   or a negative alsa error */
+static snd_pcm_sframes_t
+write_frames (snd_pcm_t * ap_pcm, const bool a_mmap, const int16_t * ap_src,
+              snd_pcm_uframes_t a_frames)
+{
+  snd_pcm_sframes_t total = 0;
+
+  if (!a_mmap)
+    {
+      total = snd_pcm_writei (ap_pcm, ap_src, a_frames);
+      return -EAGAIN == total ? 0 : total;
+    }
+
+  while (a_frames > 0)
+    {
+      const snd_pcm_channel_area_t * p_areas = NULL;
+      snd_pcm_uframes_t offset = 0;
+      snd_pcm_uframes_t to_write = 0;
+      snd_pcm_sframes_t err = 0;
+      uint8_t * p_dst = NULL;
+      const snd_pcm_sframes_t avail = snd_pcm_avail_update (ap_pcm);
+
+      if (avail <= 0)
+        {
+          return avail < 0 ? avail : total;
+        }
+      to_write = a_frames < (snd_pcm_uframes_t) avail
+                   ? a_frames
+                   : (snd_pcm_uframes_t) avail;
+      if ((err = snd_pcm_mmap_begin (ap_pcm, &p_areas, &offset, &to_write))
+          < 0)
+        {
+          return err;
+        }
+      p_dst = (uint8_t *) p_areas[0].addr
+              + ((p_areas[0].first + offset * p_areas[0].step) / 8);
+      ar_pcm_copy_frames (p_dst, ap_src + total * DEVICE_BENCH_CHANNELS,
+                          to_write, DEVICE_BENCH_CHANNELS,
+                          DEVICE_BENCH_CHANNELS, sizeof (int16_t));
+      if ((err = snd_pcm_mmap_commit (ap_pcm, offset, to_write)) < 0)
+        {
+          return err;
+        }
+      total += err;
+      a_frames -= err;
+    }
+  return total;
+}
+
+static int
+run_device_mode (const char * ap_name, const char * ap_device,
+                 const bool a_mmap, const bench_profile_t * ap_profile,
+                 const int a_secs)
+{
+  const snd_pcm_uframes_t total
+    = (snd_pcm_uframes_t) a_secs * DEVICE_BENCH_RATE;
+  struct pollfd fds[DEVICE_BENCH_MAX_FDS];
+  snd_pcm_t * p_pcm = NULL;
+  snd_pcm_uframes_t period_size = 0;
+  snd_pcm_uframes_t written = 0;
+  int16_t * p_silence = NULL;
+  long wakeups = 0;
+  long csw = 0;
+  double start = 0;
+  double cpu = 0;
+  int nfds = 0;
+  int rc = -1;
+
+  if (open_device (ap_device, a_mmap, ap_profile, &p_pcm, &period_size) < 0)
+    {
+      goto end;
+    }
+
+  nfds = snd_pcm_poll_descriptors_count (p_pcm);
+  if (nfds <= 0 || nfds > DEVICE_BENCH_MAX_FDS
+      || snd_pcm_poll_descriptors (p_pcm, fds, nfds) != nfds
+      || !(p_silence
+             = calloc (total * DEVICE_BENCH_CHANNELS, sizeof (int16_t))))
+    {
+      goto end;
+    }
+
+  start = now_secs ();
+  cpu = cpu_seconds ();
+  csw = context_switches ();
+  while (written < total)
+    {
+      unsigned short revents = 0;
+      snd_pcm_sframes_t n = write_frames (
+        p_pcm, a_mmap, p_silence + written * DEVICE_BENCH_CHANNELS,
+        total - written);
+      if (n < 0)
+        {
+          if (snd_pcm_recover (p_pcm, (int) n, 1) < 0)
+            {
+              goto end;
+            }
+          continue;
+        }
+      written += n;
+      if (SND_PCM_STATE_PREPARED == snd_pcm_state (p_pcm)
+          && (written == total || 0 == snd_pcm_avail_update (p_pcm)))
+        {
+          (void) snd_pcm_start (p_pcm);
+        }
+      if (written == total)
+        {
+          break;
+        }
+
+      /* Wait until alsa has consumed at least one period, as the
+         renderer's io watcher does */
+      if (poll (fds, nfds, 1000) < 0 && EINTR != errno)
+        {
+          goto end;
+        }
+      if (snd_pcm_poll_descriptors_revents (p_pcm, fds, nfds, &revents) < 0)
+        {
+          goto end;
+        }
+      if (revents & POLLOUT)
+        {
+          ++wakeups;
+        }
+    }
+
+  (void) snd_pcm_nonblock (p_pcm, 0);
+  (void) snd_pcm_drain (p_pcm);
+
+  start = now_secs () - start;
+  cpu = cpu_seconds () - cpu;
+  csw = context_switches () - csw;
+  report (ap_name, wakeups, start);
+  fprintf (stdout, "%-32s %10lu %8s %12s frames\n", "  period", period_size,
+           "", "");
+  fprintf (stdout, "%-32s %10s %8.3f %12.2f ms/audio sec\n", "  cpu", "", cpu,
+           cpu * 1e3 / a_secs);
+  fprintf (stdout, "%-32s %10ld %8s %12.1f /audio sec\n", "  wakeups", wakeups,
+           "", (double) wakeups / a_secs);
+  fprintf (stdout, "%-32s %10ld %8s %12.1f /audio sec\n", "  context switches",
+           csw, "", (double) csw / a_secs);
+  rc = 0;
+
+end:
+  if (p_pcm)
+    {
+      (void) snd_pcm_close (p_pcm);
+    }
+  free (p_silence);
+  return rc;
+}
+
+static int
+bench_device (const char * ap_prefix, const char * ap_device, const int a_secs)
+{
+  char name[64];
+  size_t p = 0;
+  int failed = 0;
+  int m = 0;
+
+  for (m = 0; m < 2; ++m)
+    {
+      for (p = 0; p < BENCH_NUM_ELEMS (bench_profiles); ++p)
+        {
+          snprintf (name, sizeof (name), "device.%s.%s", m ? "mmap" : "rw",
+                    bench_profiles[p].p_name);
+          if (selected (name, ap_prefix)
+              && run_device_mode (name, ap_device, m, &bench_profiles[p],
+                                  a_secs)
+                   < 0)
+            {
+              fprintf (stderr, "%s: failed\n", name);
+              ++failed;
+            }
+        }
+    }
+  return failed ? -1 : 0;
+}
+
+int
+main (int argc, char ** argv)
+{
+  const char * p_prefix = NULL;
+  const char * p_device = NULL;
+  int secs = DEVICE_BENCH_DEFAULT_SECS;
+  int failed = 0;
+  int opt = 0;
+
+  while ((opt = getopt (argc, argv, "b:d:s:")) != -1)
+    {
+      switch (opt)
+        {
+          case 'b':
+            p_prefix = optarg;
+            break;
+          case 'd':
+            p_device = optarg;
+            break;
+          case 's':
+            secs = atoi (optarg);
+            if (secs > 0)
+              {
+                break;
+              }
+            /* fall through */
+          default:
+            fprintf (stderr,
+                     "Usage: %s [-b name prefix] [-d alsa device] "
+                     "[-s seconds]\n",
+                     argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+  fprintf (stdout, "%-32s %10s %8s %12s\n", "name", "ops", "secs", "ops/s");
+  if (bench_samples (p_prefix) < 0)
+    {
+      fprintf (stderr, "samples: failed\n");
+      ++failed;
+    }
+  if (p_device && bench_device (p_prefix, p_device, secs) < 0)
+    {
+      ++failed;
+    }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make bench" */
+/* End: */
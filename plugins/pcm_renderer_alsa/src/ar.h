@@ -57,6 +57,16 @@ extern "C" {
 #define ARATELIA_AUDIO_RENDERER_DEFAULT_ALSA_MIXER "Master"
 
 #define ARATELIA_AUDIO_RENDERER_DEFAULT_RAMP_STEP_COUNT 20
+/* How often (in seconds) the xrun count is published as metadata */
+#define ARATELIA_AUDIO_RENDERER_XRUN_PUBLISH_PERIOD 1.0
+
+/* ALSA buffer and period times (in usec) for each latency profile */
+#define ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME 100000
+#define ARATELIA_AUDIO_RENDERER_DEFAULT_PERIOD_TIME 25000
+#define ARATELIA_AUDIO_RENDERER_LOW_LATENCY_BUFFER_TIME 20000
+#define ARATELIA_AUDIO_RENDERER_LOW_LATENCY_PERIOD_TIME 5000
+#define ARATELIA_AUDIO_RENDERER_POWER_SAVING_BUFFER_TIME 500000
+#define ARATELIA_AUDIO_RENDERER_POWER_SAVING_PERIOD_TIME 125000
 
 #ifdef __cplusplus
 }
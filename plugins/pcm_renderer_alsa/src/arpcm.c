@@ -0,0 +1,201 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   arpcm.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - ALSA audio renderer sample processing
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arpcm.h"
+
+static inline int32_t
+clamp_sample (const float a_value, const int32_t a_min, const int32_t a_max)
+{
+  if (a_value <= a_min)
+    {
+      return a_min;
+    }
+  if (a_value >= a_max)
+    {
+      return a_max;
+    }
+  return (int32_t) a_value;
+}
+
+static void
+gain_s16 (uint8_t * ap_buf, size_t a_nsamples, const bool a_big_endian,
+          const float a_gain)
+{
+  const int hi = a_big_endian ? 0 : 1;
+  const int lo = 1 - hi;
+  for (; a_nsamples > 0; --a_nsamples, ap_buf += 2)
+    {
+      const int16_t s = (int16_t) ((ap_buf[hi] << 8) | ap_buf[lo]);
+      const int32_t v = clamp_sample (s * a_gain, INT16_MIN, INT16_MAX);
+      ap_buf[hi] = (uint8_t) ((v >> 8) & 0xff);
+      ap_buf[lo] = (uint8_t) (v & 0xff);
+    }
+}
+
+static void
+gain_s24 (uint8_t * ap_buf, size_t a_nsamples, const bool a_big_endian,
+          const float a_gain)
+{
+  const int hi = a_big_endian ? 0 : 2;
+  const int lo = 2 - hi;
+  for (; a_nsamples > 0; --a_nsamples, ap_buf += 3)
+    {
+      int32_t s = (ap_buf[hi] << 16) | (ap_buf[1] << 8) | ap_buf[lo];
+      int32_t v = 0;
+      if (s & 0x800000)
+        {
+          s -= 0x1000000;
+        }
+      v = clamp_sample (s * a_gain, -8388608, 8388607);
+      ap_buf[hi] = (uint8_t) ((v >> 16) & 0xff);
+      ap_buf[1] = (uint8_t) ((v >> 8) & 0xff);
+      ap_buf[lo] = (uint8_t) (v & 0xff);
+    }
+}
+
+static void
+gain_f32 (uint8_t * ap_buf, size_t a_nsamples, const bool a_big_endian,
+          const float a_gain)
+{
+  for (; a_nsamples > 0; --a_nsamples, ap_buf += 4)
+    {
+      uint32_t u = 0;
+      float f = 0;
+      if (a_big_endian)
+        {
+          u = ((uint32_t) ap_buf[0] << 24) | ((uint32_t) ap_buf[1] << 16)
+              | ((uint32_t) ap_buf[2] << 8) | ap_buf[3];
+        }
+      else
+        {
+          u = ((uint32_t) ap_buf[3] << 24) | ((uint32_t) ap_buf[2] << 16)
+              | ((uint32_t) ap_buf[1] << 8) | ap_buf[0];
+        }
+      memcpy (&f, &u, sizeof (f));
+      /* Float output is not clipped here; ALSA saturates on conversion */
+      f *= a_gain;
+      memcpy (&u, &f, sizeof (u));
+      if (a_big_endian)
+        {
+          ap_buf[0] = (uint8_t) (u >> 24);
+          ap_buf[1] = (uint8_t) (u >> 16);
+          ap_buf[2] = (uint8_t) (u >> 8);
+          ap_buf[3] = (uint8_t) u;
+        }
+      else
+        {
+          ap_buf[3] = (uint8_t) (u >> 24);
+          ap_buf[2] = (uint8_t) (u >> 16);
+          ap_buf[1] = (uint8_t) (u >> 8);
+          ap_buf[0] = (uint8_t) u;
+        }
+    }
+}
+
+void
+ar_pcm_apply_gain (void * ap_buf, size_t a_nsamples, unsigned int a_bits,
+                   bool a_big_endian, float a_gain)
+{
+  assert (ap_buf || 0 == a_nsamples);
+  switch (a_bits)
+    {
+      case 16:
+        {
+          gain_s16 (ap_buf, a_nsamples, a_big_endian, a_gain);
+        }
+        break;
+      case 24:
+        {
+          gain_s24 (ap_buf, a_nsamples, a_big_endian, a_gain);
+        }
+        break;
+      case 32:
+        {
+          gain_f32 (ap_buf, a_nsamples, a_big_endian, a_gain);
+        }
+        break;
+      default:
+        {
+          assert (0);
+        }
+        break;
+    };
+}
+
+void
+ar_pcm_swap_byte_order (void * ap_buf, size_t a_nsamples, unsigned int a_bits)
+{
+  const size_t sample_size = a_bits / 8;
+  uint8_t * p_sample = ap_buf;
+  assert (ap_buf || 0 == a_nsamples);
+  for (; a_nsamples > 0; --a_nsamples, p_sample += sample_size)
+    {
+      size_t i = 0;
+      for (i = 0; i < sample_size / 2; ++i)
+        {
+          const uint8_t tmp = p_sample[i];
+          p_sample[i] = p_sample[sample_size - 1 - i];
+          p_sample[sample_size - 1 - i] = tmp;
+        }
+    }
+}
+
+void
+ar_pcm_copy_frames (void * ap_dst, const void * ap_src, size_t a_nframes,
+                    unsigned int a_in_channels, unsigned int a_out_channels,
+                    size_t a_sample_size)
+{
+  uint8_t * p_dst = ap_dst;
+  const uint8_t * p_src = ap_src;
+  assert (ap_dst);
+  assert (ap_src);
+
+  if (a_in_channels == a_out_channels)
+    {
+      memcpy (p_dst, p_src, a_nframes * a_in_channels * a_sample_size);
+      return;
+    }
+
+  for (; a_nframes > 0; --a_nframes, p_src += a_in_channels * a_sample_size)
+    {
+      unsigned int j = 0;
+      for (j = 0; j < a_out_channels; ++j, p_dst += a_sample_size)
+        {
+          memcpy (p_dst, p_src + (j < a_in_channels ? j : 0) * a_sample_size,
+                  a_sample_size);
+        }
+    }
+}
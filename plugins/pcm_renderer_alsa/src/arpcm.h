@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   arpcm.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - ALSA audio renderer sample processing
+ *
+ * Gain, byte swapping and channel expansion of interleaved samples, as
+ * 16-bit integer, 24-bit integer packed in 3 bytes or 32-bit float. Used
+ * by both the read/write and the mmap rendering paths.
+ */
+#ifndef ARPCM_H
+#define ARPCM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Scale a_nsamples samples by a_gain, in place. a_big_endian is the byte
+   order the samples are stored in. Integer samples are saturated. */
+void
+ar_pcm_apply_gain (void * ap_buf, size_t a_nsamples, unsigned int a_bits,
+                   bool a_big_endian, float a_gain);
+
+/* Reverse the byte order of a_nsamples samples, in place */
+void
+ar_pcm_swap_byte_order (void * ap_buf, size_t a_nsamples, unsigned int a_bits);
+
+/* Copy a_nframes frames, adding a copy of the first channel of each frame
+   whenever the output has more channels than the input */
+void
+ar_pcm_copy_frames (void * ap_dst, const void * ap_src, size_t a_nframes,
+                    unsigned int a_in_channels, unsigned int a_out_channels,
+                    size_t a_sample_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARPCM_H */
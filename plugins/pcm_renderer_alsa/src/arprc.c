@@ -34,7 +34,6 @@
 #include <errno.h>
 #include <math.h>
 #include <string.h>
-#include <byteswap.h>
 
 #include <tizplatform.h>
 
@@ -44,6 +43,7 @@
 #include "ar.h"
 #include "arprc.h"
 #include "arprc_decls.h"
+#include "arpcm.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -379,6 +379,48 @@ using_null_alsa_device (ar_prc_t * ap_prc)
                       OMX_MAX_STRINGNAME_SIZE));
 }
 
+static void
+get_alsa_access_and_latency_profile (ar_prc_t * ap_prc)
+{
+  const char * p_access = NULL;
+  const char * p_profile = NULL;
+  assert (ap_prc);
+
+  p_access
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                            "OMX.Aratelia.audio_renderer.alsa.pcm.access");
+  ap_prc->use_mmap_
+    = (p_access && 0 == strncmp (p_access, "mmap", OMX_MAX_STRINGNAME_SIZE));
+
+  p_profile = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.audio_renderer.alsa.pcm.latency_profile");
+
+  if (p_profile
+      && 0 == strncmp (p_profile, "low-latency", OMX_MAX_STRINGNAME_SIZE))
+    {
+      ap_prc->buffer_time_ = ARATELIA_AUDIO_RENDERER_LOW_LATENCY_BUFFER_TIME;
+      ap_prc->period_time_ = ARATELIA_AUDIO_RENDERER_LOW_LATENCY_PERIOD_TIME;
+    }
+  else if (p_profile
+           && 0 == strncmp (p_profile, "power-saving",
+                            OMX_MAX_STRINGNAME_SIZE))
+    {
+      ap_prc->buffer_time_ = ARATELIA_AUDIO_RENDERER_POWER_SAVING_BUFFER_TIME;
+      ap_prc->period_time_ = ARATELIA_AUDIO_RENDERER_POWER_SAVING_PERIOD_TIME;
+    }
+  else
+    {
+      ap_prc->buffer_time_ = ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME;
+      ap_prc->period_time_ = ARATELIA_AUDIO_RENDERER_DEFAULT_PERIOD_TIME;
+    }
+
+  TIZ_TRACE (handleOf (ap_prc),
+             "ALSA access [%s] buffer time [%u] usec period time [%u] usec",
+             ap_prc->use_mmap_ ? "mmap" : "rw", ap_prc->buffer_time_,
+             ap_prc->period_time_);
+}
+
 static inline OMX_ERRORTYPE
 start_io_watcher (ar_prc_t * ap_prc)
 {
@@ -419,6 +461,7 @@ release_header (ar_prc_t * ap_prc)
                                              ap_prc->p_inhdr_));
       ap_prc->p_inhdr_ = NULL;
     }
+  ap_prc->p_processed_hdr_ = NULL;
   return OMX_ErrorNone;
 }
 
@@ -436,115 +479,27 @@ do_flush (ar_prc_t * ap_prc)
   return release_header (ap_prc);
 }
 
-static float
-sint_to_float (const int a_sample)
-{
-  float f;
-  if (a_sample >= 0)
-    {
-      f = a_sample / 32767.0;
-    }
-  else
-    {
-      f = a_sample / 32768.0;
-    }
-  return f;
-}
-
-static int
-float_to_sint (const float a_sample)
-{
-  float f;
-  f = a_sample * 32767;
-  if (f < -32768)
-    {
-      f = -32768;
-    }
-  if (f > 32767)
-    {
-      f = 32767;
-    }
-  return (int) f;
-}
-
 static void
-adjust_gain (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
-             const snd_pcm_uframes_t a_samples_per_channel)
+process_samples (const ar_prc_t * ap_prc, OMX_U8 * ap_samples,
+                 const size_t a_nsamples)
 {
+  const unsigned int bits = ap_prc->pcmmode_.nBitPerSample;
   assert (ap_prc);
-  assert (ap_hdr);
+  assert (ap_samples);
 
+  /* The samples are still in the stream's byte order: apply the gain first,
+     then convert them to the order the pcm accepts */
   if (ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE != ap_prc->gain_)
     {
-      int i;
-      int gainadj = (int) (ap_prc->gain_ * 256.);
-      float gain = pow (10., gainadj / 5120.);
-      /*       gain = 3.1f; */
-      /*       fprintf (stderr, "%f samples %ld\n", gain, a_samples_per_channel); */
-      OMX_S16 * pcm = (OMX_S16 *) (ap_hdr->pBuffer + ap_hdr->nOffset);
-      for (i = 0; i < a_samples_per_channel; i++)
-        {
-          float f = sint_to_float (*pcm);
-          f *= gain;
-          int v = float_to_sint (f);
-          *(pcm++) = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
-          f = sint_to_float (*pcm);
-          f *= gain;
-          v = float_to_sint (f);
-          *(pcm++) = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
-        }
+      const int gainadj = (int) (ap_prc->gain_ * 256.);
+      ar_pcm_apply_gain (ap_samples, a_nsamples, bits,
+                         OMX_EndianBig == ap_prc->pcmmode_.eEndian,
+                         pow (10., gainadj / 5120.));
     }
-}
 
-static void
-swap_byte_order_s16 (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
-                     const int a_samples)
-{
-  assert (ap_prc);
-  assert (ap_hdr);
-  assert (ap_hdr->pBuffer);
-
-  {
-    OMX_S16 * p_pcm = (OMX_S16 *) (ap_hdr->pBuffer + ap_hdr->nOffset);
-    int i = 0;
-    for (i = 0; i < a_samples; ++i)
-      {
-        *p_pcm = bswap_16 (*p_pcm);
-        p_pcm++;
-      }
-  }
-}
-
-static void
-swap_byte_order (const ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
-{
-  assert (ap_prc);
-  assert (ap_hdr);
-
-  if (ap_prc->swap_byte_order_ && !ap_hdr->nOffset)
+  if (ap_prc->swap_byte_order_)
     {
-      const int bytes_per_sample = ap_prc->pcmmode_.nBitPerSample / 8;
-      const int samples = ap_hdr->nFilledLen / bytes_per_sample;
-      TIZ_DEBUG (handleOf (ap_prc),
-                 "nBitPerSample = [%d] "
-                 "nFilledLen = [%d] "
-                 "samples = [%d]"
-                 "nOffset = [%d]",
-                 ap_prc->pcmmode_.nBitPerSample, ap_hdr->nFilledLen, samples,
-                 ap_hdr->nOffset);
-
-      switch (ap_prc->pcmmode_.nBitPerSample)
-        {
-          case 16:
-            {
-              swap_byte_order_s16 (ap_prc, ap_hdr, samples);
-            }
-            break;
-          default:
-            {
-            }
-            break;
-        };
+      ar_pcm_swap_byte_order (ap_samples, a_nsamples, bits);
     }
 }
 
@@ -780,6 +735,26 @@ stop_eos_timer (ar_prc_t * ap_prc)
     }
 }
 
+static OMX_ERRORTYPE
+start_xrun_timer (ar_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (ap_prc->p_xrun_timer_);
+  return tiz_srv_timer_watcher_start (
+    ap_prc, ap_prc->p_xrun_timer_, ARATELIA_AUDIO_RENDERER_XRUN_PUBLISH_PERIOD,
+    ARATELIA_AUDIO_RENDERER_XRUN_PUBLISH_PERIOD);
+}
+
+static void
+stop_xrun_timer (ar_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_xrun_timer_)
+    {
+      (void) tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_xrun_timer_);
+    }
+}
+
 static OMX_ERRORTYPE
 apply_ramp_step (ar_prc_t * ap_prc)
 {
@@ -852,7 +827,53 @@ arrange_samples_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr,
 }
 
 static OMX_ERRORTYPE
-render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
+store_xrun_count (ar_prc_t * ap_prc)
+{
+  OMX_CONFIG_METADATAITEMTYPE * p_meta = NULL;
+  char value[32];
+
+  assert (ap_prc);
+
+  if (ap_prc->xruns_ == ap_prc->xruns_published_)
+    {
+      return OMX_ErrorNone;
+    }
+  ap_prc->xruns_published_ = ap_prc->xruns_;
+
+  (void) snprintf (value, sizeof (value), "%lu", ap_prc->xruns_);
+  tiz_check_null_ret_oom ((p_meta = tiz_metadata_item_new ("ALSA xruns", value)));
+  /* The xrun counter is the only metadata item this component stores */
+  tiz_krn_clear_metadata (tiz_get_krn (handleOf (ap_prc)));
+  return tiz_krn_store_metadata (tiz_get_krn (handleOf (ap_prc)), p_meta);
+}
+
+static OMX_ERRORTYPE
+recover_from_pcm_error (ar_prc_t * ap_prc, int a_err)
+{
+  assert (ap_prc);
+
+  if (-EPIPE == a_err)
+    {
+      ap_prc->xruns_++;
+      TIZ_WARN (handleOf (ap_prc), "ALSA underrun (xruns so far: %lu)",
+                ap_prc->xruns_);
+      /* The count is published as metadata from the xrun timer, not here */
+    }
+
+  /* This should handle -EINTR (interrupted system call), -EPIPE
+   * (overrun or underrun) and -ESTRPIPE (stream is suspended) */
+  a_err = snd_pcm_recover (ap_prc->p_pcm_, a_err, 0);
+  if (a_err < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "snd_pcm_recover error: %s",
+                 snd_strerror (a_err));
+      return OMX_ErrorUnderflow;
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+render_buffer_rw (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   unsigned long int sample_size = 0;
@@ -867,8 +888,13 @@ render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
   assert (ap_hdr->nFilledLen > 0);
   samples_per_channel = ap_hdr->nFilledLen / step;
 
-  adjust_gain (ap_prc, ap_hdr, samples_per_channel);
-  swap_byte_order (ap_prc, ap_hdr);
+  /* A partially written buffer has been processed already */
+  if (ap_prc->p_processed_hdr_ != ap_hdr)
+    {
+      process_samples (ap_prc, ap_hdr->pBuffer + ap_hdr->nOffset,
+                       samples_per_channel * ap_prc->pcmmode_.nChannels);
+      ap_prc->p_processed_hdr_ = ap_hdr;
+    }
 
   while (samples_per_channel > 0 && OMX_ErrorNone == rc)
     {
@@ -887,15 +913,7 @@ render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
         }
       else if (err < 0)
         {
-          /* This should handle -EINTR (interrupted system call), -EPIPE
-           * (overrun or underrun) and -ESTRPIPE (stream is suspended) */
-          err = snd_pcm_recover (ap_prc->p_pcm_, (int) err, 0);
-          if (err < 0)
-            {
-              TIZ_ERROR (handleOf (ap_prc), "snd_pcm_recover error: %s",
-                         snd_strerror ((int) err));
-              rc = OMX_ErrorUnderflow;
-            }
+          rc = recover_from_pcm_error (ap_prc, (int) err);
         }
       else
         {
@@ -908,6 +926,103 @@ render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
   return rc;
 }
 
+static OMX_ERRORTYPE
+start_mmap_pcm (ar_prc_t * ap_prc, const bool a_force)
+{
+  assert (ap_prc);
+  /* Start playback once the ring buffer is full, or earlier if no more data
+     is coming (e.g. the end of stream has been reached) */
+  if (SND_PCM_STATE_PREPARED == snd_pcm_state (ap_prc->p_pcm_)
+      && (a_force || 0 == snd_pcm_avail_update (ap_prc->p_pcm_)))
+    {
+      bail_on_snd_pcm_error (snd_pcm_start (ap_prc->p_pcm_));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+render_buffer_mmap (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  unsigned long int sample_size = 0;
+  unsigned long int step = 0;
+  snd_pcm_uframes_t frames = 0;
+
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  sample_size = ap_prc->pcmmode_.nBitPerSample / 8;
+  step = sample_size * ap_prc->pcmmode_.nChannels;
+  assert (ap_hdr->nFilledLen > 0);
+  frames = ap_hdr->nFilledLen / step;
+
+  while (frames > 0)
+    {
+      const snd_pcm_channel_area_t * p_areas = NULL;
+      OMX_U8 * p_dst = NULL;
+      snd_pcm_uframes_t offset = 0;
+      snd_pcm_uframes_t to_write = 0;
+      snd_pcm_sframes_t committed = 0;
+      snd_pcm_sframes_t avail = snd_pcm_avail_update (ap_prc->p_pcm_);
+
+      if (avail < 0)
+        {
+          tiz_check_omx (recover_from_pcm_error (ap_prc, (int) avail));
+          continue;
+        }
+
+      if (0 == avail)
+        {
+          /* The ring buffer is full; wait until alsa has consumed at least
+             one period (see avail_min) */
+          tiz_check_omx (start_mmap_pcm (ap_prc, false));
+          return OMX_ErrorNoMore;
+        }
+
+      to_write = MIN (frames, (snd_pcm_uframes_t) avail);
+      committed
+        = snd_pcm_mmap_begin (ap_prc->p_pcm_, &p_areas, &offset, &to_write);
+      if (committed < 0)
+        {
+          tiz_check_omx (recover_from_pcm_error (ap_prc, (int) committed));
+          continue;
+        }
+
+      /* Interleaved access: all channels share the first area. The samples
+         are processed in the mmap area, in the same order as in the rw
+         path. */
+      p_dst = (OMX_U8 *) p_areas[0].addr
+              + ((p_areas[0].first + offset * p_areas[0].step) / 8);
+      ar_pcm_copy_frames (p_dst, ap_hdr->pBuffer + ap_hdr->nOffset, to_write,
+                          ap_prc->pcmmode_.nChannels,
+                          ap_prc->num_channels_supported_, sample_size);
+      process_samples (ap_prc, p_dst,
+                       to_write * ap_prc->num_channels_supported_);
+
+      committed = snd_pcm_mmap_commit (ap_prc->p_pcm_, offset, to_write);
+      if (committed < 0 || (snd_pcm_uframes_t) committed != to_write)
+        {
+          tiz_check_omx (recover_from_pcm_error (
+            ap_prc, committed < 0 ? (int) committed : -EPIPE));
+          continue;
+        }
+
+      ap_hdr->nOffset += committed * step;
+      ap_hdr->nFilledLen -= committed * step;
+      frames -= committed;
+    }
+
+  return start_mmap_pcm (ap_prc,
+                         (ap_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0);
+}
+
+static OMX_ERRORTYPE
+render_buffer (ar_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  assert (ap_prc);
+  return ap_prc->use_mmap_ ? render_buffer_mmap (ap_prc, ap_hdr)
+                           : render_buffer_rw (ap_prc, ap_hdr);
+}
+
 static OMX_BUFFERHEADERTYPE *
 get_header (ar_prc_t * ap_prc)
 {
@@ -992,6 +1107,80 @@ render_pcm_data (ar_prc_t * ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE
+set_alsa_hw_and_sw_params (ar_prc_t * ap_prc,
+                           const snd_pcm_format_t a_snd_pcm_format)
+{
+  snd_pcm_sw_params_t * p_sw_params = NULL;
+  unsigned int rate = 0;
+  unsigned int buffer_time = 0;
+  unsigned int period_time = 0;
+  int dir = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_pcm_);
+  assert (ap_prc->p_hw_params_);
+
+  rate = ap_prc->pcmmode_.nSamplingRate;
+  buffer_time = ap_prc->buffer_time_;
+  period_time = ap_prc->period_time_;
+
+  /* Allow alsa-lib resampling */
+  bail_on_snd_pcm_error (
+    snd_pcm_hw_params_set_rate_resample (ap_prc->p_pcm_, ap_prc->p_hw_params_,
+                                         1));
+
+  if (ap_prc->use_mmap_
+      && snd_pcm_hw_params_set_access (ap_prc->p_pcm_, ap_prc->p_hw_params_,
+                                       SND_PCM_ACCESS_MMAP_INTERLEAVED)
+           < 0)
+    {
+      TIZ_NOTICE (handleOf (ap_prc),
+                  "mmap access not supported by this ALSA pcm; "
+                  "falling back to read/write access");
+      ap_prc->use_mmap_ = false;
+    }
+
+  if (!ap_prc->use_mmap_)
+    {
+      bail_on_snd_pcm_error (snd_pcm_hw_params_set_access (
+        ap_prc->p_pcm_, ap_prc->p_hw_params_, SND_PCM_ACCESS_RW_INTERLEAVED));
+    }
+
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_format (
+    ap_prc->p_pcm_, ap_prc->p_hw_params_, a_snd_pcm_format));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_channels (
+    ap_prc->p_pcm_, ap_prc->p_hw_params_,
+    (unsigned int) ap_prc->num_channels_supported_));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_rate_near (
+    ap_prc->p_pcm_, ap_prc->p_hw_params_, &rate, 0));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_buffer_time_near (
+    ap_prc->p_pcm_, ap_prc->p_hw_params_, &buffer_time, &dir));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_set_period_time_near (
+    ap_prc->p_pcm_, ap_prc->p_hw_params_, &period_time, &dir));
+  bail_on_snd_pcm_error (snd_pcm_hw_params (ap_prc->p_pcm_,
+                                            ap_prc->p_hw_params_));
+
+  bail_on_snd_pcm_error (snd_pcm_hw_params_get_buffer_size (
+    ap_prc->p_hw_params_, &ap_prc->buffer_size_));
+  bail_on_snd_pcm_error (snd_pcm_hw_params_get_period_size (
+    ap_prc->p_hw_params_, &ap_prc->period_size_, &dir));
+
+  /* Software params: only wake up the component when there is at least one
+     full period of free space in the ring buffer. */
+  snd_pcm_sw_params_alloca (&p_sw_params);
+  bail_on_snd_pcm_error (snd_pcm_sw_params_current (ap_prc->p_pcm_,
+                                                    p_sw_params));
+  bail_on_snd_pcm_error (snd_pcm_sw_params_set_avail_min (
+    ap_prc->p_pcm_, p_sw_params, ap_prc->period_size_));
+  bail_on_snd_pcm_error (snd_pcm_sw_params_set_start_threshold (
+    ap_prc->p_pcm_, p_sw_params,
+    (ap_prc->buffer_size_ / ap_prc->period_size_) * ap_prc->period_size_));
+  bail_on_snd_pcm_error (snd_pcm_sw_params (ap_prc->p_pcm_, p_sw_params));
+
+  return OMX_ErrorNone;
+}
+
 /*
  * arprc
  */
@@ -1012,7 +1201,9 @@ ar_prc_ctor (void * ap_prc, va_list * app)
   p_prc->p_ev_io_ = NULL;
   p_prc->p_vol_ramp_timer_ = NULL;
   p_prc->p_eos_timer_ = NULL;
+  p_prc->p_xrun_timer_ = NULL;
   p_prc->p_inhdr_ = NULL;
+  p_prc->p_processed_hdr_ = NULL;
   p_prc->port_disabled_ = false;
   p_prc->awaiting_io_ev_ = false;
   p_prc->nflags_ = 0;
@@ -1022,6 +1213,14 @@ ar_prc_ctor (void * ap_prc, va_list * app)
   p_prc->ramp_step_ = 0;
   p_prc->ramp_step_count_ = ARATELIA_AUDIO_RENDERER_DEFAULT_RAMP_STEP_COUNT;
   p_prc->ramp_volume_ = 0;
+  p_prc->xruns_ = 0;
+  p_prc->xruns_published_ = 0;
+  p_prc->wakeups_ = 0;
+  p_prc->use_mmap_ = false;
+  p_prc->buffer_time_ = ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME;
+  p_prc->period_time_ = ARATELIA_AUDIO_RENDERER_DEFAULT_PERIOD_TIME;
+  p_prc->buffer_size_ = 0;
+  p_prc->period_size_ = 0;
   return p_prc;
 }
 
@@ -1053,6 +1252,8 @@ ar_prc_allocate_resources (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
       char * p_device = get_alsa_device (p_prc);
       assert (p_device);
 
+      get_alsa_access_and_latency_profile (p_prc);
+
       /* Open a PCM in non-blocking mode */
       bail_on_snd_pcm_error (snd_pcm_open (
         &p_prc->p_pcm_, p_device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK));
@@ -1084,6 +1285,10 @@ ar_prc_allocate_resources (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
       /* This is to produce accurate EOS flag events */
       tiz_check_omx (
         tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_eos_timer_)));
+
+      /* This is to publish the xrun count outside the render path */
+      tiz_check_omx (
+        tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_xrun_timer_)));
     }
 
   assert (p_prc->p_pcm_);
@@ -1115,13 +1320,29 @@ ar_prc_prepare_to_transfer (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
       tiz_check_omx (retrieve_alsa_pcm_format_and_num_channels (
         p_prc, &snd_pcm_format, &p_prc->num_channels_supported_));
 
-      /* This sets the hardware and software parameters in a convenient way. */
-      bail_on_snd_pcm_error (snd_pcm_set_params (
-        p_prc->p_pcm_, snd_pcm_format, SND_PCM_ACCESS_RW_INTERLEAVED,
-        (unsigned int) p_prc->num_channels_supported_,
-        p_prc->pcmmode_.nSamplingRate, 0, /* allow alsa-lib resampling */
-        100000                            /* overall latency in us */
-        ));
+      if (!p_prc->use_mmap_
+          && ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME == p_prc->buffer_time_)
+        {
+          /* This sets the hardware and software parameters in a convenient
+           * way. */
+          bail_on_snd_pcm_error (snd_pcm_set_params (
+            p_prc->p_pcm_, snd_pcm_format, SND_PCM_ACCESS_RW_INTERLEAVED,
+            (unsigned int) p_prc->num_channels_supported_,
+            p_prc->pcmmode_.nSamplingRate, 0, /* allow alsa-lib resampling */
+            ARATELIA_AUDIO_RENDERER_DEFAULT_BUFFER_TIME /* latency in us */
+            ));
+          bail_on_snd_pcm_error (snd_pcm_get_params (
+            p_prc->p_pcm_, &p_prc->buffer_size_, &p_prc->period_size_));
+        }
+      else
+        {
+          tiz_check_omx (set_alsa_hw_and_sw_params (p_prc, snd_pcm_format));
+        }
+
+      TIZ_DEBUG (handleOf (p_prc),
+                 "ALSA access [%s] buffer size [%lu] period size [%lu] frames",
+                 p_prc->use_mmap_ ? "mmap" : "rw", p_prc->buffer_size_,
+                 p_prc->period_size_);
 
       bail_on_snd_pcm_error (snd_pcm_poll_descriptors (
         p_prc->p_pcm_, p_prc->p_fds_, p_prc->descriptor_count_));
@@ -1158,6 +1379,7 @@ ar_prc_transfer_and_process (void * ap_prc, OMX_U32 TIZ_UNUSED (a_pid))
   log_alsa_pcm_state (p_prc);
   prepare_volume_ramp (p_prc);
   tiz_check_omx (start_volume_ramp (p_prc));
+  tiz_check_omx (start_xrun_timer (p_prc));
   tiz_check_omx (apply_ramp_step (p_prc));
   return OMX_ErrorNone;
 }
@@ -1166,8 +1388,12 @@ static OMX_ERRORTYPE
 ar_prc_stop_and_return (void * ap_prc)
 {
   log_alsa_pcm_state (ap_prc);
+  TIZ_NOTICE (handleOf (ap_prc), "ALSA xruns : [%lu] io wakeups : [%lu]",
+              ((ar_prc_t *) ap_prc)->xruns_, ((ar_prc_t *) ap_prc)->wakeups_);
   stop_volume_ramp (ap_prc);
   stop_eos_timer (ap_prc);
+  stop_xrun_timer (ap_prc);
+  (void) store_xrun_count (ap_prc);
   return do_flush (ap_prc);
 }
 
@@ -1179,6 +1405,8 @@ ar_prc_deallocate_resources (void * ap_prc)
 
   tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_eos_timer_);
   p_prc->p_eos_timer_ = NULL;
+  tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_xrun_timer_);
+  p_prc->p_xrun_timer_ = NULL;
 
   if (p_prc->ramp_enabled_)
     {
@@ -1244,6 +1472,7 @@ ar_prc_io_ready (void * ap_prc, tiz_event_io_t * ap_ev_io, int a_fd,
   if (p_prc->awaiting_io_ev_)
     {
       p_prc->awaiting_io_ev_ = false;
+      p_prc->wakeups_++;
       rc = render_pcm_data (ap_prc);
     }
   return rc;
@@ -1268,6 +1497,10 @@ ar_prc_timer_ready (void * ap_prc, tiz_event_timer_t * ap_ev_timer,
     {
       rc = apply_ramp_step (ap_prc);
     }
+  else if (ap_ev_timer == p_prc->p_xrun_timer_)
+    {
+      rc = store_xrun_count (p_prc);
+    }
   else
     {
       assert (0);
@@ -59,7 +59,10 @@ struct ar_prc
   tiz_event_io_t * p_ev_io_;
   tiz_event_timer_t * p_vol_ramp_timer_;
   tiz_event_timer_t * p_eos_timer_;
+  tiz_event_timer_t * p_xrun_timer_;
   OMX_BUFFERHEADERTYPE * p_inhdr_;
+  /* The claimed header whose samples have been through process_samples */
+  OMX_BUFFERHEADERTYPE * p_processed_hdr_;
   bool port_disabled_;
   bool awaiting_io_ev_;
   OMX_U32 nflags_;
@@ -69,6 +72,14 @@ struct ar_prc
   long ramp_step_;
   long ramp_step_count_;
   long ramp_volume_;
+  unsigned long xruns_;
+  unsigned long xruns_published_;
+  unsigned long wakeups_;
+  bool use_mmap_;
+  unsigned int buffer_time_;
+  unsigned int period_time_;
+  snd_pcm_uframes_t buffer_size_;
+  snd_pcm_uframes_t period_size_;
 };
 
 typedef struct ar_prc_class ar_prc_class_t;
@@ -0,0 +1,57 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   nullar.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Null PCM Audio Renderer constants
+ *
+ *
+ */
+
+#ifndef NULLAR_H
+#define NULLAR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+#define ARATELIA_NULL_RENDERER_DEFAULT_ROLE "audio_renderer.pcm"
+#define ARATELIA_NULL_RENDERER_COMPONENT_NAME \
+  "OMX.Aratelia.audio_renderer.null.pcm"
+/* With libtizonia, port indexes must start at index 0 */
+#define ARATELIA_NULL_RENDERER_PORT_INDEX 0
+#define ARATELIA_NULL_RENDERER_PORT_MIN_BUF_COUNT 2
+#define ARATELIA_NULL_RENDERER_PORT_MIN_BUF_SIZE 1024 * 4
+#define ARATELIA_NULL_RENDERER_PORT_NONCONTIGUOUS OMX_FALSE
+#define ARATELIA_NULL_RENDERER_PORT_ALIGNMENT 0
+#define ARATELIA_NULL_RENDERER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+#define ARATELIA_NULL_RENDERER_MAX_VOLUME_VALUE 100
+#define ARATELIA_NULL_RENDERER_MIN_VOLUME_VALUE 0
+#define ARATELIA_NULL_RENDERER_DEFAULT_VOLUME_VALUE 75
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NULLAR_H */
@@ -0,0 +1,270 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   nullarprc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Null PCM Audio Renderer processor
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <string.h>
+
+#include <OMX_Core.h>
+
+#include <tizplatform.h>
+
+#include <tizkernel.h>
+#include <tizscheduler.h>
+
+#include "nullar.h"
+#include "nullarprc_decls.h"
+#include "nullarprc.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.null_renderer.prc"
+#endif
+
+static OMX_ERRORTYPE
+retrieve_pcm_mode (nullar_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (ap_prc->pcmmode_,
+                            ARATELIA_NULL_RENDERER_PORT_INDEX);
+  tiz_check_omx (
+    tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+                          OMX_IndexParamAudioPcm, &ap_prc->pcmmode_));
+  TIZ_DEBUG (handleOf (ap_prc),
+             "nChannels [%u] nBitPerSample [%u] nSamplingRate [%u]",
+             ap_prc->pcmmode_.nChannels, ap_prc->pcmmode_.nBitPerSample,
+             ap_prc->pcmmode_.nSamplingRate);
+  return OMX_ErrorNone;
+}
+
+static void
+log_totals (nullar_prc_t * ap_prc)
+{
+  OMX_U64 bytes_per_sec = 0;
+  assert (ap_prc);
+  bytes_per_sec = (OMX_U64) ap_prc->pcmmode_.nSamplingRate
+                  * ap_prc->pcmmode_.nChannels
+                  * (ap_prc->pcmmode_.nBitPerSample / 8);
+  TIZ_NOTICE (handleOf (ap_prc),
+              "Rendered [%llu] bytes in [%llu] buffers ([%.3f] secs of audio)",
+              (unsigned long long) ap_prc->bytes_,
+              (unsigned long long) ap_prc->buffers_,
+              bytes_per_sec ? (double) ap_prc->bytes_ / bytes_per_sec : 0.0);
+}
+
+/*
+ * nullarprc
+ */
+
+static void *
+nullar_prc_ctor (void * ap_obj, va_list * app)
+{
+  nullar_prc_t * p_prc
+    = super_ctor (typeOf (ap_obj, "nullarprc"), ap_obj, app);
+  assert (p_prc);
+  TIZ_INIT_OMX_PORT_STRUCT (p_prc->pcmmode_,
+                            ARATELIA_NULL_RENDERER_PORT_INDEX);
+  p_prc->bytes_ = 0;
+  p_prc->buffers_ = 0;
+  p_prc->eos_ = false;
+  return p_prc;
+}
+
+static void *
+nullar_prc_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "nullarprc"), ap_obj);
+}
+
+/*
+ * from tiz_srv class
+ */
+
+static OMX_ERRORTYPE
+nullar_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+nullar_prc_deallocate_resources (void * ap_obj)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+nullar_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
+{
+  nullar_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->bytes_ = 0;
+  p_prc->buffers_ = 0;
+  p_prc->eos_ = false;
+  return retrieve_pcm_mode (p_prc);
+}
+
+static OMX_ERRORTYPE
+nullar_prc_transfer_and_process (void * ap_obj, OMX_U32 a_pid)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+nullar_prc_stop_and_return (void * ap_obj)
+{
+  nullar_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  if (!p_prc->eos_ && p_prc->buffers_ > 0)
+    {
+      log_totals (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
+/*
+ * from tiz_prc class
+ */
+
+static OMX_ERRORTYPE
+nullar_prc_buffers_ready (const void * ap_obj)
+{
+  nullar_prc_t * p_prc = (nullar_prc_t *) ap_obj;
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  void * p_krn = tiz_get_krn (handleOf (p_prc));
+  assert (p_prc);
+
+  /* There is no clock to wait for; consume everything that is available
+     right away */
+  do
+    {
+      p_hdr = NULL;
+      tiz_check_omx (tiz_krn_claim_buffer (
+        p_krn, ARATELIA_NULL_RENDERER_PORT_INDEX, 0, &p_hdr));
+      if (p_hdr)
+        {
+          TIZ_TRACE (handleOf (p_prc), "Claimed HEADER [%p] nFilledLen [%u]",
+                     p_hdr, p_hdr->nFilledLen);
+          p_prc->bytes_ += p_hdr->nFilledLen;
+          p_prc->buffers_++;
+          p_hdr->nFilledLen = 0;
+          p_hdr->nOffset = 0;
+          if (p_hdr->nFlags & OMX_BUFFERFLAG_EOS)
+            {
+              TIZ_DEBUG (handleOf (p_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
+                         p_hdr);
+              p_prc->eos_ = true;
+              log_totals (p_prc);
+              tiz_srv_issue_event ((OMX_PTR) p_prc, OMX_EventBufferFlag,
+                                   ARATELIA_NULL_RENDERER_PORT_INDEX,
+                                   p_hdr->nFlags, NULL);
+            }
+          tiz_check_omx (tiz_krn_release_buffer (
+            p_krn, ARATELIA_NULL_RENDERER_PORT_INDEX, p_hdr));
+        }
+    }
+  while (p_hdr);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+nullar_prc_port_enable (const void * ap_obj, OMX_U32 a_pid)
+{
+  /* The pcm settings may have changed while the port was disabled */
+  return retrieve_pcm_mode ((nullar_prc_t *) ap_obj);
+}
+
+/*
+ * nullar_prc_class
+ */
+
+static void *
+nullar_prc_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "nullarprc_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+nullar_prc_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * nullarprc_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizprc), "nullarprc_class", classOf (tizprc),
+     sizeof (nullar_prc_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, nullar_prc_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+  return nullarprc_class;
+}
+
+void *
+nullar_prc_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizprc = tiz_get_type (ap_hdl, "tizprc");
+  void * nullarprc_class = tiz_get_type (ap_hdl, "nullarprc_class");
+  TIZ_LOG_CLASS (nullarprc_class);
+  void * nullarprc = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (nullarprc_class, "nullarprc", tizprc, sizeof (nullar_prc_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, nullar_prc_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, nullar_prc_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_allocate_resources, nullar_prc_allocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_deallocate_resources, nullar_prc_deallocate_resources,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_prepare_to_transfer, nullar_prc_prepare_to_transfer,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_transfer_and_process, nullar_prc_transfer_and_process,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_stop_and_return, nullar_prc_stop_and_return,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_buffers_ready, nullar_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, nullar_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: stop value */
+     0);
+
+  return nullarprc;
+}
@@ -0,0 +1,66 @@
+/**
+ * Copyright (C) 2011-2020 Aratelia Limited - Juan A. Rubio and contributors
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   nullarprc_decls.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Null PCM Audio Renderer processor class decls
+ *
+ *
+ */
+
+#ifndef NULLARPRC_DECLS_H
+#define NULLARPRC_DECLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Audio.h>
+
+#include "nullarprc.h"
+#include "tizprc_decls.h"
+
+typedef struct nullar_prc nullar_prc_t;
+struct nullar_prc
+{
+  /* Object */
+  const tiz_prc_t _;
+  OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
+  OMX_U64 bytes_;
+  OMX_U64 buffers_;
+  bool eos_;
+};
+
+typedef struct nullar_prc_class nullar_prc_class_t;
+struct nullar_prc_class
+{
+  /* Class */
+  const tiz_prc_class_t _;
+  /* NOTE: Class methods might be added in the future */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NULLARPRC_DECLS_H */
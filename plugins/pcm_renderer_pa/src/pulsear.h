@@ -54,6 +54,14 @@ extern "C"
 #define ARATELIA_PCM_RENDERER_DEFAULT_VOLUME_VALUE    75
 #define ARATELIA_PCM_RENDERER_DEFAULT_RAMP_STEP_COUNT 10
 
+/* Pulseaudio buffer attributes (in usec) for each latency profile */
+#define ARATELIA_PCM_RENDERER_LOW_LATENCY_TLENGTH     20000
+#define ARATELIA_PCM_RENDERER_LOW_LATENCY_MINREQ      5000
+#define ARATELIA_PCM_RENDERER_BATTERY_TLENGTH         2000000
+#define ARATELIA_PCM_RENDERER_BATTERY_MINREQ          500000
+/* Minimum time (in usec) between two stream latency metadata updates */
+#define ARATELIA_PCM_RENDERER_LATENCY_UPDATE_INTERVAL 1000000
+
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_APP_NAME    "Tizonia PulseAudio PCM Renderer"
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_STREAM_NAME "Tizonia Pulseadio PCM renderer (playback stream)"
 #define ARATELIA_PCM_RENDERER_PULSEAUDIO_SINK_NAME   NULL
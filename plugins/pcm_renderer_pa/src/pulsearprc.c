@@ -33,8 +33,11 @@
 #include <stdio.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+#include <pulse/rtclock.h>
+
 #include <tizplatform.h>
 
 #include <tizkernel.h>
@@ -292,29 +295,89 @@ buffer_emptied (pulsear_prc_t * ap_prc)
   return release_header (ap_prc);
 }
 
+static OMX_ERRORTYPE
+store_latency_metadata (pulsear_prc_t * ap_prc)
+{
+  OMX_CONFIG_METADATAITEMTYPE * p_meta = NULL;
+  char value[32];
+
+  assert (ap_prc);
+
+  (void) snprintf (value, sizeof (value), "%.1f ms",
+                   (double) ap_prc->pa_latency_ / 1000.0);
+  tiz_check_null_ret_oom (
+    (p_meta = tiz_metadata_item_new ("PulseAudio latency", value)));
+  /* The stream latency is the only metadata item this component stores */
+  tiz_krn_clear_metadata (tiz_get_krn (handleOf (ap_prc)));
+  return tiz_krn_store_metadata (tiz_get_krn (handleOf (ap_prc)), p_meta);
+}
+
+/* Pulseaudio mainloop lock must have been acquired before calling this
+   function. Returns true if the latency has been refreshed. */
+static bool
+update_stream_latency (pulsear_prc_t * ap_prc)
+{
+  const pa_usec_t now = pa_rtclock_now ();
+  pa_usec_t latency = 0;
+  int negative = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_pa_stream_);
+
+  if (now - ap_prc->pa_latency_stamp_
+        < ARATELIA_PCM_RENDERER_LATENCY_UPDATE_INTERVAL
+      || pa_stream_get_latency (ap_prc->p_pa_stream_, &latency, &negative)
+           < 0)
+    {
+      /* Too soon, or no timing info received from the server yet */
+      return false;
+    }
+
+  ap_prc->pa_latency_stamp_ = now;
+  ap_prc->pa_latency_ = negative ? 0 : latency;
+  return true;
+}
+
 static OMX_ERRORTYPE
 render_pcm_data (pulsear_prc_t * ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  bool latency_updated = false;
   assert (ap_prc);
 
   while ((p_hdr = get_header (ap_prc)) && ap_prc->pa_nbytes_ > 0)
     {
       if (p_hdr->nFilledLen > 0)
         {
-          const int bytes_to_write
+          const size_t bytes_to_write
             = MIN (ap_prc->pa_nbytes_, p_hdr->nFilledLen);
+          int result = PA_OK;
           assert (ap_prc->p_pa_loop_);
           assert (ap_prc->p_pa_context_);
 
           pa_threaded_mainloop_lock (ap_prc->p_pa_loop_);
-          int result = pa_stream_write (
+          result = pa_stream_write (
             ap_prc->p_pa_stream_, p_hdr->pBuffer + p_hdr->nOffset,
             bytes_to_write, NULL, 0, PA_SEEK_RELATIVE);
-          /* TODO : Check return code */
-          (void) result;
+          if (ap_prc->pa_report_latency_)
+            {
+              latency_updated |= update_stream_latency (ap_prc);
+            }
           pa_threaded_mainloop_unlock (ap_prc->p_pa_loop_);
+
+          if (PA_OK != result)
+            {
+              /* The data can't be played; drop it, so that the header goes
+                 back to the supplier, and let the client know */
+              TIZ_ERROR (handleOf (ap_prc), "pa_stream_write : %s",
+                         pa_strerror (result));
+              p_hdr->nFilledLen = 0;
+              (void) buffer_emptied (ap_prc);
+              rc = OMX_ErrorHardware;
+              break;
+            }
+
           p_hdr->nFilledLen -= bytes_to_write;
           p_hdr->nOffset += bytes_to_write;
           ap_prc->pa_nbytes_ -= bytes_to_write;
@@ -327,6 +390,11 @@ render_pcm_data (pulsear_prc_t * ap_prc)
         }
     }
 
+  if (latency_updated)
+    {
+      (void) store_latency_metadata (ap_prc);
+    }
+
   return rc;
 }
 
@@ -384,6 +452,21 @@ pulseaudio_stream_state_cback_handler (OMX_PTR ap_prc,
       TIZ_DEBUG (handleOf (p_prc), "PA STREAM STATE : [%s]",
                  pulseaudio_stream_state_to_str (p_prc->pa_stream_state_));
 
+      if (PA_STREAM_READY == p_prc->pa_stream_state_ && p_prc->p_pa_stream_)
+        {
+          const pa_buffer_attr * p_attr = NULL;
+          pa_threaded_mainloop_lock (p_prc->p_pa_loop_);
+          if ((p_attr = pa_stream_get_buffer_attr (p_prc->p_pa_stream_)))
+            {
+              TIZ_NOTICE (handleOf (p_prc),
+                          "PA buffer attr : maxlength [%u] tlength [%u] "
+                          "minreq [%u] prebuf [%u] (bytes)",
+                          p_attr->maxlength, p_attr->tlength, p_attr->minreq,
+                          p_attr->prebuf);
+            }
+          pa_threaded_mainloop_unlock (p_prc->p_pa_loop_);
+        }
+
       if (PA_STREAM_READY == p_prc->pa_stream_state_ && p_prc->pending_volume_)
         {
           /* There is a  pending volume request, process it now */
@@ -440,7 +523,12 @@ pulseaudio_stream_write_cback_handler (OMX_PTR ap_prc,
      allows it */
   if (ready_to_process (p_prc))
     {
-      (void) render_pcm_data (p_prc);
+      const OMX_ERRORTYPE rc = render_pcm_data (p_prc);
+      /* There is no caller to hand the error to; report it here */
+      if (OMX_ErrorNone != rc)
+        {
+          tiz_srv_issue_err_event ((OMX_PTR) p_prc, rc);
+        }
     }
   tiz_mem_free (ap_event->p_data);
   tiz_mem_free (ap_event);
@@ -647,6 +735,97 @@ init_pulseaudio_sample_spec (pulsear_prc_t * ap_prc, pa_sample_spec * ap_spec)
   return rc;
 }
 
+static bool
+get_usec_value (pulsear_prc_t * ap_prc, const char * ap_key,
+                pa_usec_t * ap_usec)
+{
+  const char * p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  assert (ap_prc);
+  assert (ap_usec);
+
+  if (p_value)
+    {
+      char * p_end = NULL;
+      unsigned long usec = 0;
+      errno = 0;
+      usec = strtoul (p_value, &p_end, 10);
+      if (p_end != p_value && 0 == errno)
+        {
+          *ap_usec = usec;
+          return true;
+        }
+      TIZ_NOTICE (handleOf (ap_prc), "Ignoring invalid value [%s] for [%s]",
+                  p_value, ap_key);
+    }
+  return false;
+}
+
+static uint32_t
+usec_to_buffer_attr (const pa_usec_t a_usec, const pa_sample_spec * ap_spec)
+{
+  /* Zero means 'let the server decide' */
+  return a_usec > 0 ? (uint32_t) pa_usec_to_bytes (a_usec, ap_spec)
+                    : (uint32_t) -1;
+}
+
+static void
+init_pulseaudio_buffer_attr (pulsear_prc_t * ap_prc,
+                             const pa_sample_spec * ap_spec)
+{
+  const char * p_profile = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.audio_renderer.pulseaudio.pcm.latency_profile");
+  pa_usec_t tlength = 0;
+  pa_usec_t minreq = 0;
+  pa_usec_t prebuf = 0;
+  bool custom = false;
+
+  assert (ap_prc);
+  assert (ap_spec);
+
+  if (p_profile && 0 == strcmp (p_profile, "low-latency"))
+    {
+      tlength = ARATELIA_PCM_RENDERER_LOW_LATENCY_TLENGTH;
+      minreq = ARATELIA_PCM_RENDERER_LOW_LATENCY_MINREQ;
+      custom = true;
+    }
+  else if (p_profile && 0 == strcmp (p_profile, "battery"))
+    {
+      tlength = ARATELIA_PCM_RENDERER_BATTERY_TLENGTH;
+      minreq = ARATELIA_PCM_RENDERER_BATTERY_MINREQ;
+      custom = true;
+    }
+
+  /* Individual values override the profile */
+  custom |= get_usec_value (
+    ap_prc, "OMX.Aratelia.audio_renderer.pulseaudio.pcm.tlength", &tlength);
+  custom |= get_usec_value (
+    ap_prc, "OMX.Aratelia.audio_renderer.pulseaudio.pcm.minreq", &minreq);
+  custom |= get_usec_value (
+    ap_prc, "OMX.Aratelia.audio_renderer.pulseaudio.pcm.prebuf", &prebuf);
+
+  ap_prc->pa_buf_attr_.maxlength = (uint32_t) -1;
+  ap_prc->pa_buf_attr_.tlength = usec_to_buffer_attr (tlength, ap_spec);
+  ap_prc->pa_buf_attr_.minreq = usec_to_buffer_attr (minreq, ap_spec);
+  ap_prc->pa_buf_attr_.prebuf = usec_to_buffer_attr (prebuf, ap_spec);
+  ap_prc->pa_buf_attr_.fragsize = (uint32_t) -1;
+  ap_prc->pa_custom_buf_attr_ = custom;
+
+  {
+    const char * p_report = tiz_rcfile_get_value (
+      TIZ_RCFILE_PLUGINS_DATA_SECTION,
+      "OMX.Aratelia.audio_renderer.pulseaudio.pcm.report_latency");
+    ap_prc->pa_report_latency_
+      = (p_report && 0 == strncmp (p_report, "true", OMX_MAX_STRINGNAME_SIZE));
+  }
+
+  TIZ_DEBUG (handleOf (ap_prc),
+             "profile [%s] tlength [%llu] minreq [%llu] prebuf [%llu] usec",
+             p_profile ? p_profile : "default", (unsigned long long) tlength,
+             (unsigned long long) minreq, (unsigned long long) prebuf);
+}
+
 /* Pulseaudio mainloop lock must have been acquired before calling this
    function */
 static int
@@ -688,6 +867,7 @@ init_pulseaudio_stream (pulsear_prc_t * ap_prc)
     goto_end_on_pa_error (await_pulseaudio_context_connection (ap_prc));
 
     goto_end_on_pa_error (init_pulseaudio_sample_spec (ap_prc, &spec));
+    init_pulseaudio_buffer_attr (ap_prc, &spec);
 
     ap_prc->p_pa_stream_ = pa_stream_new (
       ap_prc->p_pa_context_, ARATELIA_PCM_RENDERER_PULSEAUDIO_STREAM_NAME,
@@ -706,8 +886,14 @@ init_pulseaudio_stream (pulsear_prc_t * ap_prc)
       ARATELIA_PCM_RENDERER_PULSEAUDIO_SINK_NAME, /* Name of the sink to
                                                        connect to, or NULL for
                                                        default */
-      NULL,   /* Buffering attributes, or NULL for default */
-      0,      /* Additional flags, or 0 for default */
+      /* Buffering attributes, or NULL for default */
+      ap_prc->pa_custom_buf_attr_ ? &ap_prc->pa_buf_attr_ : NULL,
+      /* Additional flags; timing updates (an extra request to the server
+         every now and then) are only needed to report the latency */
+      (ap_prc->pa_report_latency_
+         ? PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE
+         : 0)
+        | (ap_prc->pa_custom_buf_attr_ ? PA_STREAM_ADJUST_LATENCY : 0),
       NULL,   /* Initial volume, or NULL for default */
       NULL)); /* Synchronize this stream with the specified one, or NULL for
                    a standalone stream  */
@@ -1043,6 +1229,11 @@ pulsear_prc_ctor (void * ap_prc, va_list * app)
   p_prc->p_pa_stream_ = NULL;
   p_prc->pa_stream_state_ = PA_STREAM_UNCONNECTED;
   p_prc->pa_nbytes_ = 0;
+  memset (&p_prc->pa_buf_attr_, 0, sizeof (p_prc->pa_buf_attr_));
+  p_prc->pa_custom_buf_attr_ = false;
+  p_prc->pa_report_latency_ = false;
+  p_prc->pa_latency_ = 0;
+  p_prc->pa_latency_stamp_ = 0;
   p_prc->p_ev_timer_ = NULL;
   p_prc->gain_ = ARATELIA_PCM_RENDERER_DEFAULT_GAIN_VALUE;
   p_prc->volume_ = get_default_volume (ap_prc);
@@ -63,6 +63,11 @@ struct pulsear_prc
   struct pa_cvolume pa_vol_;
   pa_stream_state_t pa_stream_state_;
   size_t pa_nbytes_;
+  pa_buffer_attr pa_buf_attr_;
+  bool pa_custom_buf_attr_;
+  bool pa_report_latency_;
+  pa_usec_t pa_latency_;
+  pa_usec_t pa_latency_stamp_;
   tiz_event_timer_t *p_ev_timer_;
   float gain_;
   long volume_;
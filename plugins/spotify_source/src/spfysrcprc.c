@@ -335,9 +335,11 @@ store_metadata (spfysrc_prc_t * ap_prc, const char * ap_key,
   info_len = strnlen (ap_value, SPFYSRC_MAX_STRING_SIZE - 1) + 1;
   metadata_len = sizeof (OMX_CONFIG_METADATAITEMTYPE) + info_len;
 
+  /* The item is owned by the processor's arena, and is released with it
+     at the next track change */
   if (NULL
-      == (p_meta
-          = (OMX_CONFIG_METADATAITEMTYPE *) tiz_mem_calloc (1, metadata_len)))
+      == (p_meta = (OMX_CONFIG_METADATAITEMTYPE *) tiz_srv_arena_calloc (
+            ap_prc, metadata_len)))
     {
       rc = OMX_ErrorInsufficientResources;
     }
@@ -483,6 +485,7 @@ store_relevant_track_metadata (spfysrc_prc_t * ap_prc)
 {
   assert (ap_prc);
   (void) tiz_krn_clear_metadata (tiz_get_krn (handleOf (ap_prc)));
+  tiz_srv_arena_reset (ap_prc);
   store_metadata_track_name (ap_prc, sp_track_name (ap_prc->p_sp_track_));
   store_metadata_artist (ap_prc, sp_artist_name (sp_track_artist (ap_prc->p_sp_track_, 0)));
   store_metadata_album (ap_prc, sp_album_name (sp_track_album (ap_prc->p_sp_track_)));
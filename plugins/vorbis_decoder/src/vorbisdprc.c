@@ -40,6 +40,7 @@
 #include <tizplatform.h>
 
 #include <tizkernel.h>
+#include <tizpcmpack.h>
 
 #include "vorbisd.h"
 #include "vorbisdprc.h"
@@ -104,6 +105,7 @@ dealloc_temp_data_store (
   ap_prc->p_store_ = NULL;
   ap_prc->store_size_ = 0;
   ap_prc->store_offset_ = 0;
+  tiz_pkt_store_destroy (&ap_prc->pkt_store_);
 }
 
 static inline OMX_U8 **
@@ -174,18 +176,6 @@ store_data (vorbisd_prc_t * ap_prc, const OMX_U8 * ap_data, OMX_U32 a_nbytes)
   return a_nbytes - nbytes_to_copy;
 }
 
-static inline void
-write_frame_float_ilv (float * to, const float * from, const int channels)
-{
-  int i = 0;
-  assert (to);
-  assert (from);
-  for (i = 0; i < channels; ++i)
-    {
-      to[i] = from[i];
-    }
-}
-
 static OMX_ERRORTYPE
 update_pcm_mode (vorbisd_prc_t * ap_prc, const OMX_U32 a_samplerate,
                  const OMX_U32 a_channels)
@@ -344,22 +334,34 @@ fishsound_decoded_callback (FishSound * ap_fsound, float * app_pcm[],
 
   {
     /* write decoded PCM samples */
-    size_t i = 0;
     size_t frame_len = sizeof (float) * p_prc->fsinfo_.channels;
     size_t frames_alloc = ((p_out->nAllocLen - p_out->nOffset) / frame_len);
     size_t frames_to_write = (frames > frames_alloc) ? frames_alloc : frames;
     size_t bytes_to_write = frames_to_write * frame_len;
     assert (p_out);
 
-    for (i = 0; i < frames_to_write; ++i)
+    /* The demuxer stamps the end of the packet; the packet's samples start
+       frames samples earlier */
+    if (0 == p_out->nFilledLen)
       {
-        size_t frame_offset = i * frame_len;
-        size_t float_offset = i * p_prc->fsinfo_.channels;
-        float * out
-          = (float *) (p_out->pBuffer + p_out->nOffset + frame_offset);
-        write_frame_float_ilv (out, ((float *) app_pcm) + float_offset,
-                               p_prc->fsinfo_.channels);
+        if (p_prc->pkt_end_time_ >= 0 && p_prc->fsinfo_.samplerate > 0)
+          {
+            const OMX_TICKS start_time
+              = p_prc->pkt_end_time_
+                - ((OMX_TICKS) frames * OMX_TICKS_PER_SECOND)
+                    / p_prc->fsinfo_.samplerate;
+            p_out->nTimeStamp = start_time > 0 ? start_time : 0;
+            p_out->nFlags &= ~OMX_BUFFERFLAG_TIMESTAMPINVALID;
+          }
+        else
+          {
+            p_out->nFlags |= OMX_BUFFERFLAG_TIMESTAMPINVALID;
+          }
       }
+
+    tiz_pcm_pack_float_ilv (p_out->pBuffer + p_out->nOffset,
+                            (const float *) app_pcm, frames_to_write,
+                            p_prc->fsinfo_.channels, TIZ_PCM_FMT_F32, NULL);
     p_out->nFilledLen += bytes_to_write;
     p_out->nOffset += bytes_to_write;
 
@@ -432,6 +434,8 @@ transform_buffer (vorbisd_prc_t * ap_prc)
     ap_prc, ARATELIA_VORBIS_DECODER_INPUT_PORT_INDEX);
   OMX_BUFFERHEADERTYPE * p_out = tiz_filter_prc_get_header (
     ap_prc, ARATELIA_VORBIS_DECODER_OUTPUT_PORT_INDEX);
+  const OMX_U8 * p_data = NULL;
+  OMX_U32 len = 0;
 
   if (!p_in || !p_out)
     {
@@ -445,7 +449,10 @@ transform_buffer (vorbisd_prc_t * ap_prc)
   TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFilledLen [%d] nFlags [%d] ",
              p_in, p_in->nFilledLen, p_in->nFlags);
 
-  if (0 == p_in->nFilledLen)
+  tiz_check_omx (tiz_pkt_store_obtain (&ap_prc->pkt_store_, p_in, &p_data,
+                                       &len, &ap_prc->pkt_end_time_));
+
+  if (0 == len)
     {
       TIZ_TRACE (handleOf (ap_prc), "HEADER [%p] nFlags [%d] is empty", p_in,
                  p_in->nFlags);
@@ -461,19 +468,19 @@ transform_buffer (vorbisd_prc_t * ap_prc)
     }
   /*   raise(SIGTRAP); */
 
-  if (p_in->nFilledLen > 0)
+  if (len > 0)
     {
-      unsigned char * p_data = p_in->pBuffer + p_in->nOffset;
-      const long len = p_in->nFilledLen;
-      long bytes_consumed = fish_sound_decode (ap_prc->p_fsnd_, p_data, len);
-      TIZ_TRACE (handleOf (ap_prc), "p_in->nFilledLen [%d] ", p_in->nFilledLen);
+      long bytes_consumed
+        = fish_sound_decode (ap_prc->p_fsnd_, (unsigned char *) p_data, len);
+      TIZ_TRACE (handleOf (ap_prc), "len [%d] ", len);
       TIZ_TRACE (handleOf (ap_prc), "bytes_consumed [%d] ", bytes_consumed);
 
       if (bytes_consumed >= 0)
         {
-          assert (p_in->nFilledLen >= bytes_consumed);
+          assert (len >= bytes_consumed);
           p_in->nFilledLen = 0;
           p_in->nOffset = 0;
+          tiz_pkt_store_clear (&ap_prc->pkt_store_);
         }
       else
         {
@@ -555,6 +562,8 @@ reset_stream_parameters (vorbisd_prc_t * ap_prc)
       tiz_mem_set (ap_prc->p_store_, 0, ap_prc->store_size_);
       ap_prc->store_offset_ = 0;
     }
+  tiz_pkt_store_reset (&ap_prc->pkt_store_);
+  ap_prc->pkt_end_time_ = -1;
 }
 
 static inline OMX_ERRORTYPE
@@ -584,6 +593,8 @@ vorbisd_prc_ctor (void * ap_obj, va_list * app)
   p_prc->p_store_ = NULL;
   p_prc->store_size_ = 0;
   p_prc->store_offset_ = 0;
+  tiz_pkt_store_init (&p_prc->pkt_store_);
+  p_prc->pkt_end_time_ = -1;
   return p_prc;
 }
 
@@ -38,6 +38,7 @@ extern "C" {
 
 #include <tizfilterprc.h>
 #include <tizfilterprc_decls.h>
+#include <tizpktstore.h>
 
 typedef struct vorbisd_prc vorbisd_prc_t;
 struct vorbisd_prc
@@ -51,6 +52,8 @@ struct vorbisd_prc
   OMX_U8 * p_store_;
   OMX_U32 store_size_;
   OMX_U32 store_offset_;
+  tiz_pkt_store_t pkt_store_;
+  OMX_TICKS pkt_end_time_;
 };
 
 typedef struct vorbisd_prc_class vorbisd_prc_class_t;